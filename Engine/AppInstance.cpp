@@ -24,8 +24,10 @@
 
 #include "AppInstance.h"
 
+#include <algorithm>
 #include <fstream>
 #include <list>
+#include <set>
 #include <cassert>
 #include <stdexcept>
 
@@ -37,6 +39,8 @@
 #include <QtCore/QFileInfo>
 #include <QtCore/QEventLoop>
 #include <QtCore/QSettings>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
 #include <QtNetwork/QNetworkReply>
 
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
@@ -65,8 +69,10 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/ReadNode.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/Settings.h"
+#include "Engine/Timer.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/WriteNode.h"
+#include "Engine/WritersRenderGroup.h"
 
 NATRON_NAMESPACE_ENTER;
 
@@ -157,6 +163,14 @@ public:
 
     //When a node tree is created
     int _creatingTree;
+
+    //Number of hash batches currently opened. MT-safe: main-thread only
+    int _nodesHashBatch;
+
+    //The nodes that requested a hash computation while a batch is opened or from another thread
+    mutable QMutex nodesPendingHashMutex;
+    NodesWList _nodesPendingHash;
+    bool _nodesHashRequestedFromOtherThread;
     mutable QMutex renderQueueMutex;
     std::list<RenderQueueItem> renderQueue, activeRenders;
     mutable QMutex invalidExprKnobsMutex;
@@ -176,6 +190,10 @@ public:
         , _creatingInternalNode(false)
         , _creatingNodeQueue()
         , _creatingTree(0)
+        , _nodesHashBatch(0)
+        , nodesPendingHashMutex()
+        , _nodesPendingHash()
+        , _nodesHashRequestedFromOtherThread(false)
         , renderQueueMutex()
         , renderQueue()
         , activeRenders()
@@ -200,10 +218,41 @@ public:
     void startRenderingFullSequence(bool blocking, const RenderQueueItem& writerWork);
 };
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+class BlockingRenderRunnable
+    : public QRunnable
+{
+    AppInstancePrivate* _app;
+    RenderQueueItem _item;
+
+public:
+
+    BlockingRenderRunnable(AppInstancePrivate* app,
+                           const RenderQueueItem& item)
+        : QRunnable()
+        , _app(app)
+        , _item(item)
+    {
+    }
+
+    virtual ~BlockingRenderRunnable()
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        _app->startRenderingFullSequence(true, _item);
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 AppInstance::AppInstance(int appID)
     : QObject()
     , _imp( new AppInstancePrivate(appID, this) )
 {
+    QObject::connect( this, SIGNAL(nodesHashRequestedFromOtherThread()), this, SLOT(onNodesHashRequestedFromOtherThread()) );
 }
 
 AppInstance::~AppInstance()
@@ -257,6 +306,110 @@ AppInstance::setIsCreatingNodeTree(bool b)
     }
 }
 
+bool
+AppInstance::isBatchingNodesHash() const
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    return _imp->_nodesHashBatch > 0;
+}
+
+void
+AppInstance::setIsBatchingNodesHash(bool b)
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    if (b) {
+        ++_imp->_nodesHashBatch;
+
+        return;
+    }
+    if (_imp->_nodesHashBatch <= 0) {
+        _imp->_nodesHashBatch = 0;
+
+        return;
+    }
+    --_imp->_nodesHashBatch;
+    if (_imp->_nodesHashBatch > 0) {
+        return;
+    }
+    computePendingNodesHash();
+}
+
+void
+AppInstance::computePendingNodesHash()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    NodesWList pending;
+    {
+        QMutexLocker k(&_imp->nodesPendingHashMutex);
+        pending.swap(_imp->_nodesPendingHash);
+        _imp->_nodesHashRequestedFromOtherThread = false;
+    }
+
+    NodesList nodes;
+    std::set<Node*> added;
+    for (NodesWList::iterator it = pending.begin(); it != pending.end(); ++it) {
+        NodePtr node = it->lock();
+        if ( node && added.insert( node.get() ).second ) {
+            nodes.push_back(node);
+        }
+    }
+    if ( !nodes.empty() ) {
+        Node::computeHashes(nodes);
+    }
+}
+
+void
+AppInstance::addNodeToHashBatch(const NodePtr& node)
+{
+    bool isMainThread = QThread::currentThread() == qApp->thread();
+
+    assert( !isMainThread || _imp->_nodesHashBatch > 0 );
+    bool mustNotify = false;
+    {
+        QMutexLocker k(&_imp->nodesPendingHashMutex);
+        _imp->_nodesPendingHash.push_back(node);
+        if (!isMainThread && !_imp->_nodesHashRequestedFromOtherThread) {
+            _imp->_nodesHashRequestedFromOtherThread = true;
+            mustNotify = true;
+        }
+    }
+    if (mustNotify) {
+        Q_EMIT nodesHashRequestedFromOtherThread();
+    }
+}
+
+void
+AppInstance::onNodesHashRequestedFromOtherThread()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    if (_imp->_nodesHashBatch > 0) {
+        // Propagated when the batch is closed
+        return;
+    }
+    computePendingNodesHash();
+}
+
+NodesHashBatch_RAII::NodesHashBatch_RAII(const AppInstPtr& app)
+    : _app()
+{
+    if ( app && ( QThread::currentThread() == qApp->thread() ) ) {
+        _app = app;
+        app->setIsBatchingNodesHash(true);
+    }
+}
+
+NodesHashBatch_RAII::~NodesHashBatch_RAII()
+{
+    AppInstPtr a = _app.lock();
+
+    if (a) {
+        a->setIsBatchingNodesHash(false);
+    }
+}
+
 void
 AppInstance::checkForNewVersion() const
 {
@@ -622,9 +775,20 @@ AppInstance::loadInternal(const CLArgs& cl,
 
         if ( info.suffix() == QString::fromUtf8(NATRON_PROJECT_FILE_EXT) ) {
             ///Load the project
+            TimeLapse loadTime;
             if ( !_imp->_currentProject->loadProject( info.path(), info.fileName() ) ) {
                 throw std::invalid_argument( tr("Project file loading failed.").toStdString() );
             }
+
+            const QString& convertPath = cl.getConvertProjectPath();
+            if ( !convertPath.isEmpty() ) {
+                double loadSeconds = loadTime.getTimeElapsedReset();
+                _imp->_currentProject->exportProjectFile( convertPath, cl.getConvertProjectFormat() );
+                double writeSeconds = loadTime.getTimeElapsedReset();
+                std::cout << tr("Project loaded in %1 s, written to %2 in %3 s.").arg(loadSeconds).arg(convertPath).arg(writeSeconds).toStdString() << std::endl;
+
+                return;
+            }
         } else if ( info.suffix() == QString::fromUtf8("py") ) {
             ///Load the python script
             loadPythonScript(info);
@@ -1342,6 +1506,10 @@ AppInstance::createNodeInternal(CreateNodeArgs& args)
         }
     }
 
+    if ( node && ( QThread::currentThread() == qApp->thread() ) ) {
+        _imp->_currentProject->journalNodeChanged(node);
+    }
+
     return node;
 } // createNodeInternal
 
@@ -1679,7 +1847,30 @@ AppInstance::startWritersRendering(bool doBlockingRender,
         return;
     }
 
-    if (appPTR->isBackground() || doBlockingRender) {
+    ///Render the writers together, frame by frame, so that the nodes upstream of several of them are rendered once per frame.
+    ///They must all be rendering at the same time, so they are not queued.
+    bool renderTogether = !renderInSeparateProcess && (itemsToQueue.size() > 1) && appPTR->getCurrentSettings()->isRenderWritersTogetherEnabled();
+    if (renderTogether) {
+        WritersRenderGroupPtr group( new WritersRenderGroup( appPTR->getCurrentSettings()->getRenderWritersTogetherMemoryBudget() ) );
+        for (std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
+            group->addWriter(it->work.writer, it->work.firstFrame, it->work.lastFrame, it->work.frameStep);
+        }
+        group->start();
+    }
+
+    if ( renderTogether && (appPTR->isBackground() || doBlockingRender) ) {
+        ///blocking call: each render needs its own thread since they wait for each other
+        QThreadPool pool;
+        pool.setMaxThreadCount( (int)itemsToQueue.size() );
+        for (std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
+            pool.start( new BlockingRenderRunnable(_imp.get(), *it) );
+        }
+        pool.waitForDone();
+    } else if (renderTogether) {
+        for (std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
+            _imp->startRenderingFullSequence(false, *it);
+        }
+    } else if (appPTR->isBackground() || doBlockingRender) {
         //blocking call, we don't want this function to return pre-maturely, in which case it would kill the app
         QtConcurrent::blockingMap( itemsToQueue, boost::bind(&AppInstancePrivate::startRenderingFullSequence, _imp.get(), true, _1) );
     } else {
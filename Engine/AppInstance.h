@@ -377,6 +377,22 @@ public:
 
     void setIsCreatingNodeTree(bool b);
 
+    /**
+     * @brief While a hash batch is opened, Node::computeHash() only registers the node: the hash of all
+     * registered nodes is propagated downstream in a single pass when the outermost batch is closed.
+     * This is used so that a burst of knob changes only walks the graph once.
+     * Only called on the main-thread.
+     **/
+    bool isBatchingNodesHash() const;
+
+    void setIsBatchingNodesHash(bool b);
+
+    /**
+     * @brief Registers the node in the opened hash batch. When called from another thread, the nodes registered
+     * until the main-thread processes them are propagated in a single pass. MT-safe.
+     **/
+    void addNodeToHashBatch(const NodePtr& node);
+
     virtual void appendToScriptEditor(const std::string& str);
     virtual void printAutoDeclaredVariable(const std::string& str);
 
@@ -490,10 +506,14 @@ public Q_SLOTS:
 
     void onQueuedRenderFinished(int retCode);
 
+    void onNodesHashRequestedFromOtherThread();
+
 Q_SIGNALS:
 
     void pluginsPopulated();
 
+    void nodesHashRequestedFromOtherThread();
+
 protected:
 
     virtual void onGroupCreationFinished(const NodePtr& node, CreateNodeReason reason);
@@ -507,6 +527,8 @@ private:
 
     void startNextQueuedRender(OutputEffectInstance* finishedWriter);
 
+    void computePendingNodesHash();
+
 
     void getWritersWorkForCL(const CLArgs& cl, std::list<AppInstance::RenderWork>& requests);
 
@@ -523,6 +545,21 @@ private:
     boost::scoped_ptr<AppInstancePrivate> _imp;
 };
 
+/**
+ * @brief Opens a hash batch on the app. Does nothing outside of the main-thread: the hash requests made from
+ * other threads are already coalesced (see AppInstance::addNodeToHashBatch).
+ **/
+class NodesHashBatch_RAII
+{
+    AppInstWPtr _app;
+
+public:
+
+    NodesHashBatch_RAII(const AppInstPtr& app);
+
+    ~NodesHashBatch_RAII();
+};
+
 class CreatingNodeTreeFlag_RAII
 {
     AppInstWPtr _app;
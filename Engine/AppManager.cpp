@@ -31,6 +31,8 @@
 #include <cassert>
 #include <stdexcept>
 #include <cstring> // for std::memcpy
+#include <iostream>
+#include <sstream>
 
 #if defined(Q_OS_LINUX)
 #include <sys/signal.h>
@@ -60,6 +62,7 @@
 #include <QtCore/QCoreApplication>
 #include <QtCore/QSettings>
 #include <QtCore/QThreadPool>
+#include <QtCore/QThreadStorage>
 #include <QtCore/QTextStream>
 #include <QtNetwork/QAbstractSocket>
 #include <QtNetwork/QLocalServer>
@@ -77,6 +80,7 @@
 #include "Engine/ExistenceCheckThread.h"
 #include "Engine/GroupInput.h"
 #include "Engine/GroupOutput.h"
+#include "Engine/Hash64.h"
 #include "Engine/LibraryBinary.h"
 #include "Engine/Log.h"
 #include "Engine/Node.h"
@@ -91,6 +95,7 @@
 #include "Engine/Project.h"
 #include "Engine/PrecompNode.h"
 #include "Engine/ReadNode.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoSmear.h"
 #include "Engine/StandardPaths.h"
@@ -239,18 +244,46 @@ AppManager::AppManager()
 #endif
 }
 
+// Number of times the current thread took the Natron GIL, which is recursive
+static QThreadStorage<int> natronGILDepth;
+
 void
 AppManager::takeNatronGIL()
 {
     _imp->natronPythonGIL.lock();
+    ++natronGILDepth.localData();
 }
 
 void
 AppManager::releaseNatronGIL()
 {
+    --natronGILDepth.localData();
     _imp->natronPythonGIL.unlock();
 }
 
+bool
+AppManager::isPythonGILHeldByCurrentThread() const
+{
+    if ( natronGILDepth.hasLocalData() && (natronGILDepth.localData() > 0) ) {
+        return true;
+    }
+#ifndef NATRON_RUN_WITHOUT_PYTHON
+    if ( !Py_IsInitialized() ) {
+        return false;
+    }
+#if PY_VERSION_HEX >= 0x030400F0
+    return PyGILState_Check() == 1;
+#else
+    // PyGILState_Check() is not available prior to Python 3.4, this is what it does
+    PyThreadState* tstate = PyGILState_GetThisThreadState();
+
+    return tstate && (tstate == _PyThreadState_Current);
+#endif
+#else
+    return false;
+#endif
+}
+
 bool
 AppManager::load(int &argc,
                  char *argv[],
@@ -359,6 +392,18 @@ AppManager::~AppManager()
 
     _imp->_backgroundIPC.reset();
 
+    // All the renders are stopped now
+    if ( !RenderTrace::stop() ) {
+        std::cerr << tr("Could not write the render trace file").toStdString() << std::endl;
+    }
+
+    // Report how the caches were used by the render so that their sizes can be tuned
+    if ( (_imp->_appType == eAppTypeBackgroundAutoRun) && _imp->_nodeCache && _imp->_diskCache && _imp->_viewerCache ) {
+        printCacheStatistics( _imp->_nodeCache->cacheName(), _imp->_nodeCache->getStatistics() );
+        printCacheStatistics( _imp->_diskCache->cacheName(), _imp->_diskCache->getStatistics() );
+        printCacheStatistics( _imp->_viewerCache->cacheName(), _imp->_viewerCache->getStatistics() );
+    }
+
     try {
         _imp->saveCaches(false);
     } catch (std::runtime_error) {
@@ -367,6 +412,10 @@ AppManager::~AppManager()
 
     ///Caches may have launched some threads to delete images, wait for them to be done
     QThreadPool::globalInstance()->waitForDone();
+    _imp->renderThreadPool->quit();
+
+    ///Images queued for the persistent store hold a pointer to the NodeCache
+    _imp->persistentNodeCache.reset();
 
     ///Kill caches now because decreaseNCacheFilesOpened can be called
     _imp->_nodeCache->waitForDeleterThread();
@@ -739,33 +788,59 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         size_t maxCacheRAM = _imp->_settings->getRamMaximumPercent() * getSystemTotalRAM();
         U64 viewerCacheSize = _imp->_settings->getMaximumViewerDiskCacheSize();
         U64 maxDiskCacheNode = _imp->_settings->getMaximumDiskCacheNodeSize();
+        int nCacheShards = _imp->_settings->getCacheShardsCount();
+
+        // The hash algorithm must be set before any hash is computed
+        Hash64::setAlgorithm( _imp->_settings->isLegacyCacheHashingEnabled() ? Hash64::eHashAlgorithmCRC64 : Hash64::eHashAlgorithmStreaming );
 
-        _imp->_nodeCache.reset( new Cache<Image>("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1.) );
-        _imp->_diskCache.reset( new Cache<Image>("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0.) );
-        _imp->_viewerCache.reset( new Cache<FrameEntry>("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0.) );
+        _imp->_nodeCache.reset( new Cache<Image>("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1., nCacheShards) );
+        _imp->_diskCache.reset( new Cache<Image>("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0., nCacheShards) );
+        _imp->_viewerCache.reset( new Cache<FrameEntry>("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0., nCacheShards) );
         _imp->setViewerCacheTileSize();
     } catch (std::logic_error) {
         // ignore
     }
 
     int oldCacheVersion = 0;
+    // Caches written before the hash algorithm was stored used CRC-64
+    int oldCacheHashAlgorithm = (int)Hash64::eHashAlgorithmCRC64;
     {
         QSettings settings( QString::fromUtf8(NATRON_ORGANIZATION_NAME), QString::fromUtf8(NATRON_APPLICATION_NAME) );
 
         if ( settings.contains( QString::fromUtf8(kNatronCacheVersionSettingsKey) ) ) {
             oldCacheVersion = settings.value( QString::fromUtf8(kNatronCacheVersionSettingsKey) ).toInt();
         }
+        if ( settings.contains( QString::fromUtf8(kNatronCacheHashAlgorithmSettingsKey) ) ) {
+            oldCacheHashAlgorithm = settings.value( QString::fromUtf8(kNatronCacheHashAlgorithmSettingsKey) ).toInt();
+        }
         settings.setValue(QString::fromUtf8(kNatronCacheVersionSettingsKey), NATRON_CACHE_VERSION);
+        settings.setValue(QString::fromUtf8(kNatronCacheHashAlgorithmSettingsKey), (int)Hash64::getAlgorithm());
     }
 
     setLoadingStatus( tr("Restoring the image cache...") );
 
-    if (oldCacheVersion != NATRON_CACHE_VERSION) {
+    // Entries hashed with another algorithm can never be looked-up again
+    if ( (oldCacheVersion != NATRON_CACHE_VERSION) || (oldCacheHashAlgorithm != (int)Hash64::getAlgorithm()) ) {
         wipeAndCreateDiskCacheStructure();
     } else {
         _imp->restoreCaches();
     }
 
+    if ( _imp->_settings->isPersistentNodeCacheEnabled() ) {
+        // Only the index is mapped here, images are read from the store when the NodeCache does not have them
+        QString persistentCachePath = QString::fromUtf8( _imp->_settings->getPersistentNodeCachePath().c_str() );
+        if ( persistentCachePath.isEmpty() ) {
+            persistentCachePath = getDiskCacheLocation() + QLatin1Char('/') + QString::fromUtf8("PersistentNodeCache");
+        }
+        _imp->persistentNodeCache.reset( new PersistentImageStore(persistentCachePath) );
+        if ( _imp->persistentNodeCache->isValid() ) {
+            _imp->persistentNodeCache->setLimits( _imp->_settings->getMaximumPersistentNodeCacheSize(),
+                                                  _imp->_settings->getPersistentNodeCacheMaximumAge() );
+        } else {
+            _imp->persistentNodeCache.reset();
+        }
+    }
+
     setLoadingStatus( tr("Restoring user settings...") );
 
 
@@ -814,6 +889,10 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         args = cl;
     }
 
+    if ( !args.getRenderTraceFilePath().isEmpty() ) {
+        RenderTrace::start( args.getRenderTraceFilePath() );
+    }
+
     AppInstPtr mainInstance = newAppInstance(args, false);
 
     hideSplashScreen();
@@ -874,7 +953,6 @@ AppManagerPrivate::setViewerCacheTileSize()
     ImageBitDepthEnum viewerDepth = _settings->getViewersBitDepth();
     switch (viewerDepth) {
         case eImageBitDepthFloat:
-        case eImageBitDepthHalf:
             tileSize *= sizeof(float);
             break;
         default:
@@ -1087,6 +1165,9 @@ AppManager::wipeAndCreateDiskCacheStructure()
     _imp->cleanUpCacheDiskStructure( _imp->_diskCache->getCachePath(), false );
     assert(_imp->_viewerCache);
     _imp->cleanUpCacheDiskStructure( _imp->_viewerCache->getCachePath() , true);
+    if (_imp->persistentNodeCache) {
+        _imp->persistentNodeCache->clear();
+    }
 }
 
 AppInstPtr
@@ -1163,6 +1244,15 @@ AppManager::setApplicationsCachesMaximumDiskSpace(unsigned long long size)
     _imp->_diskCache->setMaximumCacheSize(size);
 }
 
+void
+AppManager::setPersistentNodeCacheLimits(U64 maximumSize,
+                                         int maximumAgeDays)
+{
+    if (_imp->persistentNodeCache) {
+        _imp->persistentNodeCache->setLimits(maximumSize, maximumAgeDays);
+    }
+}
+
 void
 AppManager::loadAllPlugins()
 {
@@ -1489,6 +1579,24 @@ operateOnPathRecursive(NatronPathFunctor functor,
     }
 }
 
+static void
+printCacheStatistics(const std::string& cacheName,
+                     const CacheStatistics& stats)
+{
+    std::stringstream ss;
+
+    ss << cacheName << " statistics:\n"
+       << "  Hit rate: " << stats.getHitRate() * 100. << "% (" << stats.memoryHits << " in memory, " << stats.diskHits << " on disk, "
+       << stats.misses << " misses)\n"
+       << "  Evicted: " << stats.memoryEvictions << " entries from memory (" << printAsRAM(stats.memoryEvictedBytes).toStdString() << "), "
+       << stats.diskEvictions << " from disk (" << printAsRAM(stats.diskEvictedBytes).toStdString() << ")\n"
+       << "  Swapped to disk: " << printAsRAM(stats.swappedToDiskBytes).toStdString() << ", reloaded from disk: "
+       << printAsRAM(stats.reloadedFromDiskBytes).toStdString() << '\n'
+       << "  Waits for free memory: " << stats.memoryFullWaits << " (" << stats.memoryFullWaitMSecs << " ms)\n"
+       << "  Entries waiting for deletion: " << stats.deleterQueueSize << " (peak: " << stats.deleterQueuePeakSize << ")";
+    std::cout << ss.str() << std::endl;
+}
+
 static void
 addToPythonPathFunctor(const QDir& directory)
 {
@@ -2041,7 +2149,14 @@ bool
 AppManager::getImage(const ImageKey & key,
                      std::list<boost::shared_ptr<Image> >* returnValue) const
 {
-    return _imp->_nodeCache->get(key, returnValue);
+    if ( _imp->_nodeCache->get(key, returnValue) ) {
+        return true;
+    }
+    if (_imp->persistentNodeCache) {
+        return _imp->persistentNodeCache->loadImages(key, _imp->_nodeCache.get(), returnValue);
+    }
+
+    return false;
 }
 
 bool
@@ -2088,6 +2203,21 @@ AppManager::getTextureOrCreate(const FrameKey & key,
     return _imp->_viewerCache->getOrCreate(key, params, locker, returnValue);
 }
 
+bool
+AppManager::prefetchTexture(const FrameKey & key) const
+{
+    return _imp->_viewerCache->prefetch(key);
+}
+
+void
+AppManager::persistImageIfNeeded(const boost::shared_ptr<Image>& image) const
+{
+    if ( !_imp->persistentNodeCache || !image || ( image->getCacheAPI() != _imp->_nodeCache.get() ) ) {
+        return;
+    }
+    _imp->persistentNodeCache->appendToWriteQueue(image);
+}
+
 bool
 AppManager::isAggressiveCachingEnabled() const
 {
@@ -2100,6 +2230,31 @@ AppManager::getCachesTotalMemorySize() const
     return  _imp->_nodeCache->getMemoryCacheSize();
 }
 
+bool
+AppManager::getCacheStatistics(const std::string& cacheName,
+                               CacheStatistics* stats) const
+{
+    if ( _imp->_nodeCache && (cacheName == _imp->_nodeCache->cacheName()) ) {
+        *stats = _imp->_nodeCache->getStatistics();
+    } else if ( _imp->_diskCache && (cacheName == _imp->_diskCache->cacheName()) ) {
+        *stats = _imp->_diskCache->getStatistics();
+    } else if ( _imp->_viewerCache && (cacheName == _imp->_viewerCache->cacheName()) ) {
+        *stats = _imp->_viewerCache->getStatistics();
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+void
+AppManager::resetCachesStatistics()
+{
+    _imp->_nodeCache->resetStatistics();
+    _imp->_diskCache->resetStatistics();
+    _imp->_viewerCache->resetStatistics();
+}
+
 U64
 AppManager::getCachesTotalDiskSize() const
 {
@@ -2438,6 +2593,8 @@ AppManager::setNThreadsToRender(int nThreads)
     QMutexLocker l(&_imp->nThreadsMutex);
 
     _imp->nThreadsToRender = nThreads;
+    // -1 means no multi-threading, 0 means the ideal thread count
+    _imp->renderThreadPool->setMaxThreadCount(nThreads == -1 ? 1 : nThreads);
 }
 
 void
@@ -3252,6 +3409,12 @@ AppManager::getGPUContextPool() const
     return _imp->renderingContextPool.get();
 }
 
+RenderThreadPool*
+AppManager::getRenderThreadPool() const
+{
+    return _imp->renderThreadPool.get();
+}
+
 void
 AppManager::refreshOpenGLRenderingFlagOnAllInstances()
 {
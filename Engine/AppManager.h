@@ -210,9 +210,31 @@ public:
                             FrameEntryLocker* locker,
                             FrameEntryPtr* returnValue) const;
 
+    /**
+     * @brief Hints the OS that the viewer cache tiles matching the key will be displayed soon, so that they are
+     * read from the tile cache files in the background. Returns true if a matching tile is in the cache.
+     **/
+    bool prefetchTexture(const FrameKey & key) const;
+
+    /**
+     * @brief If the persistent node cache is enabled and the given image belongs to the NodeCache, queue it to be written
+     * to the persistent store once it is entirely rendered.
+     **/
+    void persistImageIfNeeded(const boost::shared_ptr<Image>& image) const;
+
+    void setPersistentNodeCacheLimits(U64 maximumSize, int maximumAgeDays);
+
 
     U64 getCachesTotalMemorySize() const;
     U64 getCachesTotalDiskSize() const;
+
+    /**
+     * @brief Returns the statistics of the cache with the given name: NodeCache, DiskCache or ViewerCache.
+     * Returns false if there is no such cache.
+     **/
+    bool getCacheStatistics(const std::string& cacheName, CacheStatistics* stats) const;
+
+    void resetCachesStatistics();
     boost::shared_ptr<CacheSignalEmitter> getOrActivateViewerCacheSignalEmitter() const;
 
     void setApplicationsCachesMaximumMemoryPercent(double p);
@@ -466,6 +488,12 @@ public:
 
     void releaseNatronGIL();
 
+    /**
+     * @brief Returns true if the current thread holds the Natron GIL or the Python GIL, in which case it must not
+     * wait on a thread that may need to run Python.
+     **/
+    bool isPythonGILHeldByCurrentThread() const;
+
 #ifdef __NATRON_WIN32__
     void registerUNCPath(const QString& path, const QChar& driveLetter);
     QString mapUNCPathToPathWithDriveLetter(const QString& uncPath) const;
@@ -487,6 +515,11 @@ public:
     const OfxHost* getOFXHost() const;
     GPUContextPool* getGPUContextPool() const;
 
+    /**
+     * @brief Returns the work-stealing thread pool used to render tiles in parallel
+     **/
+    RenderThreadPool* getRenderThreadPool() const;
+
 
     /**
      * @brief Return the concatenation of all search paths of Natron, i.e:
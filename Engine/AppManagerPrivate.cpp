@@ -86,6 +86,7 @@ AppManagerPrivate::AppManagerPrivate()
     , _nodeCache()
     , _diskCache()
     , _viewerCache()
+    , persistentNodeCache()
     , diskCachesLocationMutex()
     , diskCachesLocation()
     , _backgroundIPC()
@@ -103,6 +104,7 @@ AppManagerPrivate::AppManagerPrivate()
     , useThreadPool(true)
     , nThreadsMutex()
     , runningThreadsCount()
+    , renderThreadPool( new RenderThreadPool() )
     , lastProjectLoadedCreatedDuringRC2Or3(false)
     , args()
     , mainModule(0)
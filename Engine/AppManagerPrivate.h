@@ -62,12 +62,14 @@ GCC_DIAG_ON(deprecated)
 
 #include "Engine/AppManager.h"
 #include "Engine/Cache.h"
+#include "Engine/PersistentImageStore.h"
 #include "Engine/FrameEntry.h"
 #include "Engine/Image.h"
 #include "Engine/GPUContextPool.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
 #include "Engine/EngineFwd.h"
 #include "Engine/TLSHolder.h"
+#include "Engine/ThreadPool.h"
 
 NATRON_NAMESPACE_ENTER;
 
@@ -93,6 +95,7 @@ public:
     boost::shared_ptr<Cache<Image> >  _nodeCache; //< Images cache
     boost::shared_ptr<Cache<Image> >  _diskCache; //< Images disk cache (used by DiskCache nodes)
     boost::shared_ptr<Cache<FrameEntry> > _viewerCache; //< Viewer textures cache
+    boost::scoped_ptr<PersistentImageStore> persistentNodeCache; //< On-disk store of the NodeCache images, NULL if disabled
     mutable QMutex diskCachesLocationMutex;
     QString diskCachesLocation;
     boost::scoped_ptr<ProcessInputChannel> _backgroundIPC; //< object used to communicate with the main app
@@ -125,6 +128,9 @@ public:
     // Another method could be to analyse all cores running, but this is way more expensive and would impair performances.
     QAtomicInt runningThreadsCount;
 
+    // The work-stealing pool running the tiles of host frame threading renders
+    boost::scoped_ptr<RenderThreadPool> renderThreadPool;
+
     //To by-pass a bug introduced in RC2 / RC3 with the serialization of bezier curves
     bool lastProjectLoadedCreatedDuringRC2Or3;
 
@@ -1071,6 +1071,7 @@ Bezier::clone(const RotoItem* other)
 
 Bezier::~Bezier()
 {
+    RotoContextPrivate::removeShapeGeometries(this);
 }
 
 boost::shared_ptr<BezierCP>
@@ -2807,6 +2808,53 @@ Bezier::getMotionBlurSettings(const double time,
 #endif
 }
 
+U64
+Bezier::computeGeometryHash(double time,
+                            unsigned int mipMapLevel) const
+{
+    Transform::Matrix3x3 transform;
+
+    getTransformAtTime(time, &transform);
+    double featherDist = getFeatherDistance(time);
+    bool clockWise = isFeatherPolygonClockwiseOriented(false, time);
+
+    Hash64 hash;
+    hash.append(mipMapLevel);
+    hash.append(featherDist);
+    hash.append(clockWise);
+    hash.append(transform.a);
+    hash.append(transform.b);
+    hash.append(transform.c);
+    hash.append(transform.d);
+    hash.append(transform.e);
+    hash.append(transform.f);
+    hash.append(transform.g);
+    hash.append(transform.h);
+    hash.append(transform.i);
+
+    QMutexLocker l(&itemMutex);
+    hash.append(_imp->finished);
+    const BezierCPs* lists[2] = {&_imp->points, &_imp->featherPoints};
+    for (int i = 0; i < 2; ++i) {
+        hash.append( lists[i]->size() );
+        for (BezierCPs::const_iterator it = lists[i]->begin(); it != lists[i]->end(); ++it) {
+            double x, y, lx, ly, rx, ry;
+            (*it)->getPositionAtTime(false, time, ViewIdx(0), &x, &y);
+            (*it)->getLeftBezierPointAtTime(false, time, ViewIdx(0), &lx, &ly);
+            (*it)->getRightBezierPointAtTime(false, time, ViewIdx(0), &rx, &ry);
+            hash.append(x);
+            hash.append(y);
+            hash.append(lx);
+            hash.append(ly);
+            hash.append(rx);
+            hash.append(ry);
+        }
+    }
+    hash.computeHash();
+
+    return hash.value();
+} // Bezier::computeGeometryHash
+
 RectD
 Bezier::getBoundingBox(double time) const
 {
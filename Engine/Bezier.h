@@ -471,6 +471,14 @@ public:
      * otherwise if it has never been called, evaluateAtTime_DeCasteljau will be called to compute the bounding box.
      **/
     virtual RectD getBoundingBox(double time) const OVERRIDE;
+
+    /**
+     * @brief Returns a hash of all that the rendered polygon and feather depend on at the given time and mipmap level:
+     * the control and feather points, the transform, the orientation and the feather distance.
+     * It changes only when the shape is edited, so it identifies its tessellation (see RotoContextPrivate::getShapeGeometry).
+     **/
+    U64 computeGeometryHash(double time, unsigned int mipMapLevel) const;
+
     static void bezierSegmentListBboxUpdate(bool useGuiCurves,
                                             const std::list<boost::shared_ptr<BezierCP> > & points,
                                             bool finished,
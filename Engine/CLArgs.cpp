@@ -68,6 +68,9 @@ public:
     QString breakpadProcessFilePath;
     qint64 breakpadProcessPID;
     QString exportDocsPath;
+    QString convertProjectPath;
+    ProjectFileFormatEnum convertProjectFormat;
+    QString renderTraceFilePath;
 
     CLArgsPrivate()
         : args()
@@ -92,6 +95,9 @@ public:
         , breakpadProcessFilePath()
         , breakpadProcessPID(-1)
         , exportDocsPath()
+        , convertProjectPath()
+        , convertProjectFormat(eProjectFileFormatXML)
+        , renderTraceFilePath()
     {
     }
 
@@ -183,6 +189,9 @@ CLArgs::operator=(const CLArgs& other)
     _imp->isEmpty = other._imp->isEmpty;
     _imp->imageFilename = other._imp->imageFilename;
     _imp->exportDocsPath = other._imp->exportDocsPath;
+    _imp->convertProjectPath = other._imp->convertProjectPath;
+    _imp->convertProjectFormat = other._imp->convertProjectFormat;
+    _imp->renderTraceFilePath = other._imp->renderTraceFilePath;
 }
 
 bool
@@ -275,7 +284,17 @@ CLArgs::printUsage(const std::string& programName)
         "     breakdown contains informations about each nodes, render times etc...\n"
         "     This option is useful for debugging purposes or to control that a render\n"
         "     is working correctly.\n"
-        "     **Please note** that it does not work when writing video files."
+        "     **Please note** that it does not work when writing video files.\n"
+        "  --render-trace <json file path>\n"
+        "     Record the time spent by each node in its actions (region of\n"
+        "     definition, identity, cache lookups and renders), for each thread,\n"
+        "     and write it to the given file when the process exits. The file is\n"
+        "     in the Chrome trace event format and can be opened with\n"
+        "     chrome://tracing or https://ui.perfetto.dev\n"
+        "  --convert-project <xml|binary> <output project file path>\n"
+        "     Load the project and write it to the given file in the given format\n"
+        "     instead of rendering. The times taken to load the project and to write\n"
+        "     it are printed. See the \"Save projects in binary format\" preference.\n"
         "Sample uses:\n"
         "  %1 /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "  %1 -b -w MyWriter /Users/Me/MyNatronProjects/MyProject.ntp\n"
@@ -283,6 +302,8 @@ CLArgs::printUsage(const std::string& programName)
         "  %1Renderer -w MyWriter /FastDisk/Pictures/sequence'###'.exr 1-100 /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "  %1Renderer -w MyWriter -w MySecondWriter 1-10 /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "  %1Renderer -w MyWriter 1-10 -l /Users/Me/Scripts/onProjectLoaded.py /Users/Me/MyNatronProjects/MyProject.ntp\n"
+        "  %1Renderer -w MyWriter --render-trace /Users/Me/trace.json /Users/Me/MyNatronProjects/MyProject.ntp\n"
+        "  %1Renderer --convert-project binary /Users/Me/MyNatronProjects/MyProjectBinary.ntp /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "\n"
         /* Text must hold in 80 columns ************************************************/
         "Options for the execution of Python scripts:\n"
@@ -481,6 +502,24 @@ CLArgs::getExportDocsPath() const
     return _imp->exportDocsPath;
 }
 
+const QString&
+CLArgs::getConvertProjectPath() const
+{
+    return _imp->convertProjectPath;
+}
+
+ProjectFileFormatEnum
+CLArgs::getConvertProjectFormat() const
+{
+    return _imp->convertProjectFormat;
+}
+
+const QString&
+CLArgs::getRenderTraceFilePath() const
+{
+    return _imp->renderTraceFilePath;
+}
+
 QStringList::iterator
 CLArgsPrivate::findFileNameWithExtension(const QString& extension)
 {
@@ -701,6 +740,23 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("render-trace"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            if ( next == args.end() ) {
+                std::cout << tr("You must specify the file path of --render-trace").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            renderTraceFilePath = *next;
+            ++next;
+            args.erase(it, next);
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8(NATRON_BREAKPAD_PROCESS_PID), QString() );
         if ( it != args.end() ) {
@@ -797,6 +853,34 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("convert-project"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            if ( ( next == args.end() ) || ( next + 1 == args.end() ) ) {
+                std::cout << tr("You must specify the format and the output file path of --convert-project").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            if ( *next == QString::fromUtf8("binary") ) {
+                convertProjectFormat = eProjectFileFormatBinary;
+            } else if ( *next == QString::fromUtf8("xml") ) {
+                convertProjectFormat = eProjectFileFormatXML;
+            } else {
+                std::cout << tr("The format of --convert-project must be xml or binary").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            ++next;
+            convertProjectPath = *next;
+            ++next;
+            args.erase(it, next);
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8("IPCpipe"), QString() );
         if ( it != args.end() ) {
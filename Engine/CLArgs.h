@@ -130,6 +130,19 @@ public:
     const QString& getBreakpadComPipeFilePath() const;
     const QString& getExportDocsPath() const;
 
+    /*
+     * @brief If not empty, the project given on the command line is written to this file in the format
+     * returned by getConvertProjectFormat() instead of being rendered.
+     */
+    const QString& getConvertProjectPath() const;
+    ProjectFileFormatEnum getConvertProjectFormat() const;
+
+    /*
+     * @brief If not empty, the actions of the renders are recorded and written to this file in the
+     * Chrome trace event format when the process exits. See RenderTrace.
+     */
+    const QString& getRenderTraceFilePath() const;
+
 private:
 
     boost::scoped_ptr<CLArgsPrivate> _imp;
@@ -41,6 +41,7 @@
 #include "Global/MemoryInfo.h"
 
 GCC_DIAG_OFF(deprecated)
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QMutex>
 #include <QtCore/QThread>
 #include <QtCore/QWaitCondition>
@@ -82,6 +83,7 @@ class DeleterThread
 {
     mutable QMutex _entriesQueueMutex;
     std::list<boost::shared_ptr<T> >_entriesQueue;
+    std::size_t _entriesQueuePeakSize;
     QWaitCondition _entriesQueueNotEmptyCond;
     CacheAPI* cache;
     QMutex mustQuitMutex;
@@ -94,6 +96,7 @@ public:
         : QThread()
         , _entriesQueueMutex()
         , _entriesQueue()
+        , _entriesQueuePeakSize(0)
         , _entriesQueueNotEmptyCond()
         , cache(cache)
         , mustQuitMutex()
@@ -116,6 +119,7 @@ public:
         {
             QMutexLocker k(&_entriesQueueMutex);
             _entriesQueue.insert( _entriesQueue.begin(), entriesToDelete.begin(), entriesToDelete.end() );
+            _entriesQueuePeakSize = std::max( _entriesQueuePeakSize, _entriesQueue.size() );
         }
         if ( !isRunning() ) {
             start();
@@ -151,6 +155,22 @@ public:
         return !_entriesQueue.empty();
     }
 
+    void getQueueSizes(std::size_t* size,
+                       std::size_t* peakSize) const
+    {
+        QMutexLocker k(&_entriesQueueMutex);
+
+        *size = _entriesQueue.size();
+        *peakSize = _entriesQueuePeakSize;
+    }
+
+    void resetQueuePeakSize()
+    {
+        QMutexLocker k(&_entriesQueueMutex);
+
+        _entriesQueuePeakSize = _entriesQueue.size();
+    }
+
 private:
 
     virtual void run() OVERRIDE FINAL
@@ -320,6 +340,62 @@ private:
 };
 
 
+/**
+ * @brief The counters behind CacheStatistics. Each shard has its own counters, protected by the shard lock, and the
+ * counters of the cache itself are protected by its size lock, so that they are accumulated as 64-bit integers
+ * without adding a lock to the look-ups.
+ **/
+struct CacheStatisticsCounters
+{
+    U64 memoryHits;
+    U64 diskHits;
+    U64 misses;
+    U64 memoryEvictions;
+    U64 memoryEvictedBytes;
+    U64 diskEvictions;
+    U64 diskEvictedBytes;
+    U64 swappedToDiskBytes;
+    U64 reloadedFromDiskBytes;
+    U64 memoryFullWaits;
+    U64 memoryFullWaitMSecs;
+
+    CacheStatisticsCounters()
+        : memoryHits(0)
+        , diskHits(0)
+        , misses(0)
+        , memoryEvictions(0)
+        , memoryEvictedBytes(0)
+        , diskEvictions(0)
+        , diskEvictedBytes(0)
+        , swappedToDiskBytes(0)
+        , reloadedFromDiskBytes(0)
+        , memoryFullWaits(0)
+        , memoryFullWaitMSecs(0)
+    {
+    }
+
+    void addTo(CacheStatistics* stats) const
+    {
+        stats->memoryHits += memoryHits;
+        stats->diskHits += diskHits;
+        stats->misses += misses;
+        stats->memoryEvictions += memoryEvictions;
+        stats->memoryEvictedBytes += memoryEvictedBytes;
+        stats->diskEvictions += diskEvictions;
+        stats->diskEvictedBytes += diskEvictedBytes;
+        stats->swappedToDiskBytes += swappedToDiskBytes;
+        stats->reloadedFromDiskBytes += reloadedFromDiskBytes;
+        stats->memoryFullWaits += memoryFullWaits;
+        stats->memoryFullWaitMSecs += memoryFullWaitMSecs;
+    }
+
+    void reset()
+    {
+        *this = CacheStatisticsCounters();
+    }
+};
+
+
 class CacheSignalEmitter
     : public QObject
 {
@@ -460,6 +536,34 @@ public:
 
 private:
 
+    /**
+     * @brief A shard owns the entries of a portion of the hash space, with its own LRU containers and locks.
+     * A non-sharded cache has a single shard, in which case all lookups serialize on the same locks.
+     **/
+    struct CacheShard
+    {
+        mutable QMutex lock; //protects memoryCache & diskCache
+        mutable QMutex getLock;  //prevents get() and getOrCreate() to be called simultaneously for entries of this shard
+
+        /*These 2 are mutable because we need to modify the LRU list even
+             when we call get() and we want this function to be const.*/
+        mutable CacheContainer memoryCache;
+        mutable CacheContainer diskCache;
+
+        // The look-ups and evictions of this shard, protected by lock
+        mutable CacheStatisticsCounters statistics;
+
+        CacheShard()
+            : lock()
+            , getLock()
+            , memoryCache()
+            , diskCache()
+            , statistics()
+        {
+        }
+    };
+
+    typedef boost::shared_ptr<CacheShard> CacheShardPtr;
 
     std::size_t _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
     std::size_t _maximumCacheSize;     // maximum size allowed for the cache
@@ -469,15 +573,14 @@ private:
      */
     mutable std::size_t _memoryCacheSize;     // current size of the cache in bytes
     mutable std::size_t _diskCacheSize;
-    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize
-    mutable QMutex _lock; //protects _memoryCache & _diskCache
-    mutable QMutex _getLock;  //prevents get() and getOrCreate() to be called simultaneously
+    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize & _nextEvictedShard
 
+    // The hash space is partitioned across these shards. This vector is never modified after the constructor
+    // hence it does not need to be protected.
+    std::vector<CacheShardPtr> _shards;
 
-    /*These 2 are mutable because we need to modify the LRU list even
-         when we call get() and we want this function to be const.*/
-    mutable CacheContainer _memoryCache;
-    mutable CacheContainer _diskCache;
+    // Index of the shard from which the next LRU entry will be evicted when the global memory budget is exceeded
+    mutable std::size_t _nextEvictedShard;
     const std::string _cacheName;
     const unsigned int _version;
 
@@ -491,6 +594,7 @@ private:
     mutable DeleterThread<EntryType> _deleterThread;
     mutable QWaitCondition _memoryFullCondition; //< protected by _sizeLock
     mutable CacheCleanerThread _cleanerThread;
+    mutable CacheStatisticsCounters _statistics;
 
     // If tiled, the cache will consist only of a few large files that each contain tiles of the same size.
     // This is useful to cache chunks of data that always have the same size.
@@ -511,7 +615,8 @@ public:
     Cache(const std::string & cacheName,
           unsigned int version,
           U64 maximumCacheSize,      // total size
-          double maximumInMemoryPercentage //how much should live in RAM
+          double maximumInMemoryPercentage, //how much should live in RAM
+          int nShards = 1 // number of independently locked partitions of the hash space
           )
         : CacheAPI()
         , _maximumInMemorySize(maximumCacheSize * maximumInMemoryPercentage)
@@ -519,10 +624,8 @@ public:
         , _memoryCacheSize(0)
         , _diskCacheSize(0)
         , _sizeLock()
-        , _lock()
-        , _getLock()
-        , _memoryCache()
-        , _diskCache()
+        , _shards()
+        , _nextEvictedShard(0)
         , _cacheName(cacheName)
         , _version(version)
         , _signalEmitter(new CacheSignalEmitter)
@@ -531,6 +634,7 @@ public:
         , _deleterThread(this)
         , _memoryFullCondition()
         , _cleanerThread(this)
+        , _statistics()
         , _tileCacheMutex()
         , _isTiled(false)
         , _tileByteSize(0)
@@ -538,15 +642,65 @@ public:
         , _nextAvailableCacheFile()
         , _nextAvailableCacheFileIndex(-1)
     {
+        nShards = std::max(1, nShards);
+        for (int i = 0; i < nShards; ++i) {
+            _shards.push_back( CacheShardPtr(new CacheShard) );
+        }
     }
 
     virtual ~Cache()
     {
-        QMutexLocker locker(&_lock);
-
         _tearingDown = true;
-        _memoryCache.clear();
-        _diskCache.clear();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            shard.memoryCache.clear();
+            shard.diskCache.clear();
+        }
+    }
+
+    /**
+     * @brief Returns the number of independently locked partitions of the cache
+     **/
+    int getShardsCount() const
+    {
+        return (int)_shards.size();
+    }
+
+    /**
+     * @brief Returns the hits, misses, evictions and waits counted since the cache was created or since resetStatistics().
+     **/
+    CacheStatistics getStatistics() const
+    {
+        CacheStatistics ret;
+        std::size_t queueSize, queuePeakSize;
+
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            QMutexLocker k(&_shards[i]->lock);
+            _shards[i]->statistics.addTo(&ret);
+        }
+        {
+            QMutexLocker k(&_sizeLock);
+            _statistics.addTo(&ret);
+        }
+        _deleterThread.getQueueSizes(&queueSize, &queuePeakSize);
+        ret.deleterQueueSize = queueSize;
+        ret.deleterQueuePeakSize = queuePeakSize;
+
+        return ret;
+    }
+
+    void resetStatistics()
+    {
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            QMutexLocker k(&_shards[i]->lock);
+            _shards[i]->statistics.reset();
+        }
+        {
+            QMutexLocker k(&_sizeLock);
+            _statistics.reset();
+        }
+        _deleterThread.resetQueuePeakSize();
     }
 
     virtual bool isTileCache() const OVERRIDE FINAL
@@ -595,15 +749,65 @@ public:
     bool get(const typename EntryType::key_type & key,
              std::list<EntryTypePtr>* returnValue) const
     {
+        CacheShard& shard = getShardForHash( key.getHash() );
+
         ///Be atomic, so it cannot be created by another thread in the meantime
-        QMutexLocker getlocker(&_getLock);
+        QMutexLocker getlocker(&shard.getLock);
 
-        ///lock the cache before reading it.
-        QMutexLocker locker(&_lock);
+        bool promotedFromDisk = false;
+        bool ret;
+        {
+            ///lock the shard before reading it.
+            QMutexLocker locker(&shard.lock);
+            ret = getInternal(shard, key, returnValue, &promotedFromDisk);
+        }
+        if (promotedFromDisk) {
+            evictInMemoryEntriesIfNeeded();
+        }
 
-        return getInternal(key, returnValue);
+        return ret;
     } // get
 
+    /**
+     * @brief Hints the OS that the entries matching the key will be read soon (see CacheEntryHelper::prefetchData).
+     * Contrary to get(), this never re-opens the file mapping of entries living in the disk portion of the cache
+     * and does not notify that entries were accessed: for a tiled cache, the entries are always mapped and this
+     * just schedules reading them back from the tile cache files in the background.
+     * @returns True if an entry matching the key was found.
+     **/
+    bool prefetch(const typename EntryType::key_type & key) const
+    {
+        std::list<EntryTypePtr> entries;
+        {
+            CacheShard& shard = getShardForHash( key.getHash() );
+            QMutexLocker locker(&shard.lock);
+            // find() does not move the entries in the LRU order, since they were not accessed yet
+            CacheIterator found = shard.memoryCache.find( key.getHash() );
+            if ( found == shard.memoryCache.end() ) {
+                if (!_isTiled) {
+                    return false;
+                }
+                found = shard.diskCache.find( key.getHash() );
+                if ( found == shard.diskCache.end() ) {
+                    return false;
+                }
+            }
+            const std::list<EntryTypePtr> & ret = getValueFromIterator(found);
+            for (typename std::list<EntryTypePtr>::const_iterator it = ret.begin(); it != ret.end(); ++it) {
+                if ( (*it)->getKey() == key ) {
+                    entries.push_back(*it);
+                }
+            }
+        }
+
+        // Do not hold the shard lock while taking the entries lock
+        for (typename std::list<EntryTypePtr>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+            (*it)->prefetchData();
+        }
+
+        return !entries.empty();
+    }
+
 private:
 
 
@@ -761,12 +965,62 @@ private:
     }
 
 
-    void createInternal(const typename EntryType::key_type & key,
+    /**
+     * @brief While the in-memory portion of the cache is over its budget, evict the least recently used entries
+     * of any shard. This is done before inserting a new entry and after moving an entry from the disk portion back
+     * to memory. No shard lock must be taken by the caller.
+     **/
+    void evictInMemoryEntriesIfNeeded() const
+    {
+        U64 memoryCacheSize, maximumInMemorySize;
+        {
+            QMutexLocker k(&_sizeLock);
+            memoryCacheSize = _memoryCacheSize;
+            maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
+        }
+        std::list<EntryTypePtr> entriesToBeDeleted;
+        double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
+        ///While the current cache size can't fit the new entry, erase the last recently used entries.
+        ///Also if the total free RAM is under the limit of the system free RAM to keep free, erase LRU entries.
+        while (occupationPercentage > NATRON_CACHE_LIMIT_PERCENT) {
+            std::list<EntryTypePtr> deleted;
+            if ( !tryEvictInMemoryEntryFromAnyShard(deleted) ) {
+                break;
+            }
+
+            //Refresh now memory cache size && maximum in memory size as they might have been changed
+            //in tryEvictEntry
+            {
+                QMutexLocker k(&_sizeLock);
+                memoryCacheSize = _memoryCacheSize;
+                maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
+            }
+
+
+            for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
+                entriesToBeDeleted.push_back(*it);
+            }
+
+            occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
+        }
+
+        if ( !entriesToBeDeleted.empty() ) {
+            ///Launch a separate thread whose function will be to delete all the entries to be deleted
+            _deleterThread.appendToQueue(entriesToBeDeleted);
+
+            ///Clearing the list here will not delete the objects pointing to by the shared_ptr's because we made a copy
+            ///that the separate thread will delete
+            entriesToBeDeleted.clear();
+        }
+    }
+
+    void createInternal(CacheShard& shard,
+                        const typename EntryType::key_type & key,
                         const ParamsTypePtr & params,
                         ImageLockerHelper<EntryType>* entryLocker,
                         EntryTypePtr* returnValue) const
     {
-        //_lock must not be taken here
+        //No shard lock must be taken here
 
         ///Before allocating the memory check that there's enough space to fit in memory
         appPTR->checkCacheFreeMemoryIsGoodEnough();
@@ -785,49 +1039,7 @@ private:
             ++safeCounter;
         }
 
-        U64 memoryCacheSize, maximumInMemorySize;
-        {
-            QMutexLocker k(&_sizeLock);
-            memoryCacheSize = _memoryCacheSize;
-            maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-        }
-        {
-            QMutexLocker locker(&_lock);
-            std::list<EntryTypePtr> entriesToBeDeleted;
-            double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
-            ///While the current cache size can't fit the new entry, erase the last recently used entries.
-            ///Also if the total free RAM is under the limit of the system free RAM to keep free, erase LRU entries.
-            while (occupationPercentage > NATRON_CACHE_LIMIT_PERCENT) {
-                std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
-                    break;
-                }
-
-                //Refresh now memory cache size && maximum in memory size as they might have been changed
-                //in tryEvictEntry
-                {
-                    QMutexLocker k(&_sizeLock);
-                    memoryCacheSize = _memoryCacheSize;
-                    maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-                }
-
-
-                for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    entriesToBeDeleted.push_back(*it);
-                }
-
-                occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
-            }
-
-            if ( !entriesToBeDeleted.empty() ) {
-                ///Launch a separate thread whose function will be to delete all the entries to be deleted
-                _deleterThread.appendToQueue(entriesToBeDeleted);
-
-                ///Clearing the list here will not delete the objects pointing to by the shared_ptr's because we made a copy
-                ///that the separate thread will delete
-                entriesToBeDeleted.clear();
-            }
-        }
+        evictInMemoryEntriesIfNeeded();
         {
             //If _maximumcacheSize == 0 we don't return 1 otherwise we would cause a deadlock
             QMutexLocker k(&_sizeLock);
@@ -835,14 +1047,19 @@ private:
 
             //_memoryCacheSize member will get updated while images are being destroyed by the parallel thread.
             //we wait for cache memory occupation to be < 100% to be sure we don't hit swap here
-            while ( occupationPercentage >= 1. && _deleterThread.isWorking() ) {
-                _memoryFullCondition.wait(&_sizeLock);
-                occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+            if ( occupationPercentage >= 1. && _deleterThread.isWorking() ) {
+                QElapsedTimer waitTimer;
+                waitTimer.start();
+                while ( occupationPercentage >= 1. && _deleterThread.isWorking() ) {
+                    _memoryFullCondition.wait(&_sizeLock);
+                    occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+                }
+                ++_statistics.memoryFullWaits;
+                _statistics.memoryFullWaitMSecs += (U64)waitTimer.elapsed();
             }
         }
         if (_isTiled) {
 
-            QMutexLocker locker(&_lock);
             // For tiled caches, we insert directly into the disk cache, so make sure there is room for it
             std::list<EntryTypePtr> entriesToBeDeleted;
             U64 diskCacheSize, maximumDiskCacheSize;
@@ -854,7 +1071,7 @@ private:
             double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
             while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
+                if ( !tryEvictDiskEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
@@ -875,7 +1092,7 @@ private:
 
         }
         {
-            QMutexLocker locker(&_lock);
+            QMutexLocker locker(&shard.lock);
 
             try {
                 returnValue->reset( new EntryType(key, params, this ) );
@@ -894,7 +1111,7 @@ private:
                 if (entryLocker) {
                     entryLocker->lock(*returnValue);
                 }
-                sealEntry(*returnValue, _isTiled ? false : true);
+                sealEntry(shard, *returnValue, _isTiled ? false : true);
             }
         }
     } // createInternal
@@ -904,13 +1121,14 @@ public:
     void swapOrInsert(const EntryTypePtr& entryToBeEvicted,
                       const EntryTypePtr& newEntry)
     {
-        QMutexLocker locker(&_lock);
-
         const typename EntryType::key_type& key = entryToBeEvicted->getKey();
         typename EntryType::hash_type hash = entryToBeEvicted->getHashKey();
+        CacheShard& shard = getShardForHash(hash);
+        QMutexLocker locker(&shard.lock);
+
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache(hash);
-        if ( memoryCached != _memoryCache.end() ) {
+        CacheIterator memoryCached = shard.memoryCache(hash);
+        if ( memoryCached != shard.memoryCache.end() ) {
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
             for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( ( (*it)->getKey() == key ) && ( (*it)->getParams() == entryToBeEvicted->getParams() ) ) {
@@ -922,8 +1140,8 @@ public:
             ret.push_back(newEntry);
         } else {
             ///Look in disk cache
-            CacheIterator diskCached = _diskCache(hash);
-            if ( diskCached != _diskCache.end() ) {
+            CacheIterator diskCached = shard.diskCache(hash);
+            if ( diskCached != shard.diskCache.end() ) {
                 ///Remove the old entry
                 std::list<EntryTypePtr> & ret = getValueFromIterator(diskCached);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
@@ -934,7 +1152,7 @@ public:
                 }
             }
             ///Insert in mem cache
-            _memoryCache.insert(hash, newEntry);
+            shard.memoryCache.insert(hash, newEntry);
         }
     }
 
@@ -974,13 +1192,20 @@ public:
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
 
         {
-            ///Be atomic, so it cannot be created by another thread in the meantime
-            QMutexLocker getlocker(&_getLock);
+            CacheShard& shard = getShardForHash( key.getHash() );
+
+            ///Be atomic, so it cannot be created by another thread in the meantime.
+            ///Only lookups falling in the same shard are serialized.
+            QMutexLocker getlocker(&shard.getLock);
             std::list<EntryTypePtr> entries;
             bool didGetSucceed;
+            bool promotedFromDisk = false;
             {
-                QMutexLocker locker(&_lock);
-                didGetSucceed = getInternal(key, &entries);
+                QMutexLocker locker(&shard.lock);
+                didGetSucceed = getInternal(shard, key, &entries, &promotedFromDisk);
+            }
+            if (promotedFromDisk) {
+                evictInMemoryEntriesIfNeeded();
             }
             if (didGetSucceed) {
                 for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
@@ -992,7 +1217,7 @@ public:
                 }
             }
 
-            createInternal(key, params, locker, returnValue);
+            createInternal(shard, key, params, locker, returnValue);
 
             return false;
         } // getlocker
@@ -1010,13 +1235,16 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
-                evictedFromMemory.second->removeAnyBackingFile();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
+                    evictedFromMemory.second->removeAnyBackingFile();
+                }
+                evictedFromMemory = shard.memoryCache.evict();
             }
-            evictedFromMemory = _memoryCache.evict();
         }
 
         if (_signalEmitter) {
@@ -1035,19 +1263,22 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-
-        /// An entry which has a use_count greater than 1 is not removable:
-        /// The backing file must not be removed because it might be read/written to
-        /// at the same time. The best we can do is just let it here in the cache.
-        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        while (evictedFromDisk.second) {
-            if (!_isTiled) {
-                evictedFromDisk.second->removeAnyBackingFile();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+
+            /// An entry which has a use_count greater than 1 is not removable:
+            /// The backing file must not be removed because it might be read/written to
+            /// at the same time. The best we can do is just let it here in the cache.
+            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            while (evictedFromDisk.second) {
+                if (!_isTiled) {
+                    evictedFromDisk.second->removeAnyBackingFile();
+                }
+                evictedFromDisk = shard.diskCache.evict();
             }
-            evictedFromDisk = _diskCache.evict();
         }
 
 
@@ -1064,51 +1295,54 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            // Move back the entry on disk if it can be store on disk
-            // For tiled caches, the tile is sharing the same file with other entries
-            // so we cannot close it, just remove the entry
-            if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
-                evictedFromMemory.second->deallocate();
-                /*insert it back into the disk portion */
-
-                U64 diskCacheSize, maximumCacheSize;
-                {
-                    QMutexLocker k(&_sizeLock);
-                    diskCacheSize = _diskCacheSize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
-
-                /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-                while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
-                    {
-                        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-                        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-                        //we'll let the user of these entries purge the extra entries left in the cache later on
-                        if (!evictedFromDisk.second) {
-                            break;
-                        }
-                        ///Erase the file from the disk if we reach the limit.
-                        evictedFromDisk.second->removeAnyBackingFile();
-                    }
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                // Move back the entry on disk if it can be store on disk
+                // For tiled caches, the tile is sharing the same file with other entries
+                // so we cannot close it, just remove the entry
+                if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
+                    evictedFromMemory.second->deallocate();
+                    /*insert it back into the disk portion */
+
+                    U64 diskCacheSize, maximumCacheSize;
                     {
                         QMutexLocker k(&_sizeLock);
                         diskCacheSize = _diskCacheSize;
                         maximumCacheSize = _maximumCacheSize;
                     }
-                }
 
-                /*update the disk cache size*/
-                CacheIterator existingDiskCacheEntry = _diskCache( evictedFromMemory.second->getHashKey() );
-                /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-                if ( existingDiskCacheEntry == _diskCache.end() ) {
-                    _diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
+                    /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
+                    while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
+                        {
+                            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+                            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+                            //we'll let the user of these entries purge the extra entries left in the cache later on
+                            if (!evictedFromDisk.second) {
+                                break;
+                            }
+                            ///Erase the file from the disk if we reach the limit.
+                            evictedFromDisk.second->removeAnyBackingFile();
+                        }
+                        {
+                            QMutexLocker k(&_sizeLock);
+                            diskCacheSize = _diskCacheSize;
+                            maximumCacheSize = _maximumCacheSize;
+                        }
+                    }
+
+                    /*update the disk cache size*/
+                    CacheIterator existingDiskCacheEntry = shard.diskCache( evictedFromMemory.second->getHashKey() );
+                    /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
+                    if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                        shard.diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
+                    }
                 }
-            }
 
-            evictedFromMemory = _memoryCache.evict();
+                evictedFromMemory = shard.memoryCache.evict();
+            }
         }
 
         _signalEmitter->blockSignals(false);
@@ -1124,7 +1358,6 @@ public:
         std::list<EntryTypePtr> entriesToBeDeleted;
 
         {
-            QMutexLocker locker(&_lock);
             U64 memoryCacheSize, maximumInMemorySize;
             {
                 QMutexLocker k(&_sizeLock);
@@ -1134,7 +1367,7 @@ public:
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             while (occupationPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
+                if ( !tryEvictInMemoryEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
@@ -1156,7 +1389,7 @@ public:
             double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
             while (diskCacheSize >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
+                if ( !tryEvictDiskEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
@@ -1178,15 +1411,18 @@ public:
      **/
     void getCopy(std::list<EntryTypePtr>* copy) const
     {
-        QMutexLocker locker(&_lock);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
 
-        for (CacheIterator it = _memoryCache.begin(); it != _memoryCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
-        }
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
+            for (CacheIterator it = shard.memoryCache.begin(); it != shard.memoryCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
+            for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
         }
     }
 
@@ -1200,11 +1436,7 @@ public:
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
         std::list<EntryTypePtr> entriesToBeDeleted;
-        bool ret;
-        {
-            QMutexLocker locker(&_lock);
-            ret = tryEvictInMemoryEntry(entriesToBeDeleted);
-        }
+        bool ret = tryEvictInMemoryEntryFromAnyShard(entriesToBeDeleted);
 
         return ret;
     }
@@ -1216,10 +1448,8 @@ public:
      **/
     bool evictLRUDiskEntry() const
     {
-
-        QMutexLocker locker(&_lock);
         std::list<EntryTypePtr> entriesToBeDeleted;
-        return tryEvictDiskEntry(entriesToBeDeleted);
+        return tryEvictDiskEntryFromAnyShard(entriesToBeDeleted);
     }
 
     /**
@@ -1330,6 +1560,7 @@ public:
         assert(oldStorage != newStorage);
         assert(newStorage != eStorageModeNone);
         if (oldStorage == eStorageModeRAM) {
+            _statistics.swappedToDiskBytes += size;
             _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
             _diskCacheSize += size;
 #ifdef NATRON_DEBUG_CACHE
@@ -1339,6 +1570,7 @@ public:
             ///We switched from RAM to DISK that means the MemoryFile object has been destroyed hence the file has been closed.
             appPTR->decreaseNCacheFilesOpened();
         } else if (oldStorage == eStorageModeDisk) {
+            _statistics.reloadedFromDiskBytes += size;
             _memoryCacheSize += size;
             _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
 #ifdef NATRON_DEBUG_CACHE
@@ -1459,9 +1691,10 @@ public:
         std::list<EntryTypePtr> toRemove;
 
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( entry->getHashKey() );
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShardForHash( entry->getHashKey() );
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( entry->getHashKey() );
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( (*it)->getKey() == entry->getKey() ) {
@@ -1471,11 +1704,11 @@ public:
                     }
                 }
                 if ( ret.empty() ) {
-                    _memoryCache.erase(existingEntry);
+                    shard.memoryCache.erase(existingEntry);
                 }
             } else {
-                existingEntry = _diskCache( entry->getHashKey() );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( entry->getHashKey() );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         if ( (*it)->getKey() == entry->getKey() ) {
@@ -1485,11 +1718,11 @@ public:
                         }
                     }
                     if ( ret.empty() ) {
-                        _diskCache.erase(existingEntry);
+                        shard.diskCache.erase(existingEntry);
                     }
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
 
@@ -1503,25 +1736,26 @@ public:
     {
         std::list<EntryTypePtr> toRemove;
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( hash);
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShardForHash(hash);
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( hash);
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     toRemove.push_back(*it);
                 }
-                _memoryCache.erase(existingEntry);
+                shard.memoryCache.erase(existingEntry);
             } else {
-                existingEntry = _diskCache( hash );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( hash );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         toRemove.push_back(*it);
                     }
-                    _diskCache.erase(existingEntry);
+                    shard.diskCache.erase(existingEntry);
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
 
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
@@ -1573,29 +1807,32 @@ public:
         *diskOccupied = 0;
 
         std::string holderID = holder->getCacheID();
-        QMutexLocker locker(&_lock);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
 
-        for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *ramOccupied += (*it)->size();
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *ramOccupied += (*it)->size();
+                        }
                     }
                 }
             }
-        }
 
-        for (CacheIterator memIt = _diskCache.begin(); memIt != _diskCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+            for (CacheIterator memIt = shard.diskCache.begin(); memIt != shard.diskCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *diskOccupied += (*it)->size();
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *diskOccupied += (*it)->size();
+                        }
                     }
                 }
             }
@@ -1609,11 +1846,12 @@ private:
                                                                        bool removeAll) OVERRIDE FINAL
     {
         std::list<EntryTypePtr> toDelete;
-        CacheContainer newMemCache, newDiskCache;
-        {
-            QMutexLocker locker(&_lock);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            CacheContainer newMemCache, newDiskCache;
+            QMutexLocker locker(&shard.lock);
 
-            for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1630,7 +1868,7 @@ private:
                 }
             }
 
-            for (CacheIterator dIt = _diskCache.begin(); dIt != _diskCache.end(); ++dIt) {
+            for (CacheIterator dIt = shard.diskCache.begin(); dIt != shard.diskCache.end(); ++dIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(dIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1647,9 +1885,9 @@ private:
                 }
             }
 
-            _memoryCache = newMemCache;
-            _diskCache = newDiskCache;
-        } // QMutexLocker locker(&_lock);
+            shard.memoryCache = newMemCache;
+            shard.diskCache = newDiskCache;
+        } // for all shards
 
         if ( !toDelete.empty() ) {
             _deleterThread.appendToQueue(toDelete);
@@ -1660,16 +1898,91 @@ private:
         }
     } // removeAllEntriesWithDifferentNodeHashForHolderPrivate
 
-    bool getInternal(const typename EntryType::key_type & key,
-                     std::list<EntryTypePtr>* returnValue) const
+    /**
+     * @brief Returns the shard owning the given hash.
+     **/
+    CacheShard& getShardForHash(hash_type hash) const
+    {
+        if (_shards.size() == 1) {
+            return *_shards.front();
+        }
+        // Fold the high bits so that the shard index does not only depend on the low bits of the hash
+        U64 h = (U64)hash;
+
+        return *_shards[(std::size_t)( ( h ^ (h >> 32) ) % _shards.size() )];
+    }
+
+    /**
+     * @brief Returns the index of the shard from which an LRU entry should be evicted first.
+     * Shards are picked in a round-robin fashion so that the global memory budget is reclaimed evenly.
+     **/
+    std::size_t getNextShardToEvict() const
     {
-        ///Private should be locked
-        assert( !_lock.tryLock() );
+        QMutexLocker k(&_sizeLock);
+        std::size_t ret = _nextEvictedShard;
+
+        _nextEvictedShard = (_nextEvictedShard + 1) % _shards.size();
+
+        return ret;
+    }
+
+    /**
+     * @brief Same as tryEvictInMemoryEntry except that it will try each shard until one can evict an entry.
+     * No shard lock must be taken by the caller.
+     **/
+    bool tryEvictInMemoryEntryFromAnyShard(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        const std::size_t nShards = _shards.size();
+        const std::size_t first = getNextShardToEvict();
+
+        for (std::size_t i = 0; i < nShards; ++i) {
+            CacheShard& shard = *_shards[(first + i) % nShards];
+            QMutexLocker locker(&shard.lock);
+            if ( tryEvictInMemoryEntry(shard, entriesToBeDeleted) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Same as tryEvictDiskEntry except that it will try each shard until one can evict an entry.
+     * No shard lock must be taken by the caller.
+     **/
+    bool tryEvictDiskEntryFromAnyShard(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        const std::size_t nShards = _shards.size();
+        const std::size_t first = getNextShardToEvict();
+
+        for (std::size_t i = 0; i < nShards; ++i) {
+            CacheShard& shard = *_shards[(first + i) % nShards];
+            QMutexLocker locker(&shard.lock);
+            if ( tryEvictDiskEntry(shard, entriesToBeDeleted) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Looks-up the entries matching the key in the shard, which must be locked. If an entry of the disk
+     * portion is moved back to memory, promotedFromDisk is set to true: the caller must then call
+     * evictInMemoryEntriesIfNeeded() once the shard lock is released.
+     **/
+    bool getInternal(CacheShard& shard,
+                     const typename EntryType::key_type & key,
+                     std::list<EntryTypePtr>* returnValue,
+                     bool* promotedFromDisk) const
+    {
+        ///The shard should be locked
+        assert( !shard.lock.tryLock() );
 
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache( key.getHash() );
+        CacheIterator memoryCached = shard.memoryCache( key.getHash() );
 
-        if ( memoryCached != _memoryCache.end() ) {
+        if ( memoryCached != shard.memoryCache.end() ) {
             ///we found something with a matching hash key. There may be several entries linked to
             ///this key, we need to find one with matching params
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
@@ -1684,14 +1997,17 @@ private:
                     }
                 }
             }
+            ++( returnValue->empty() ? shard.statistics.misses : shard.statistics.memoryHits );
 
             return returnValue->size() > 0;
         } else {
             ///fallback on the disk cache internal container
-            CacheIterator diskCached = _diskCache( key.getHash() );
+            CacheIterator diskCached = shard.diskCache( key.getHash() );
 
-            if ( diskCached == _diskCache.end() ) {
+            if ( diskCached == shard.diskCache.end() ) {
                 /*the entry was neither in memory or disk, just allocate a new one*/
+                ++shard.statistics.misses;
+
                 return false;
             } else {
                 /*we found something with a matching hash key. There may be several entries linked to
@@ -1712,42 +2028,25 @@ private:
                             } catch (const std::exception & e) {
                                 qDebug() << "Error while reopening cache file: " << e.what();
                                 ret.erase(it);
+                                ++shard.statistics.misses;
 
                                 return false;
                             } catch (...) {
                                 qDebug() << "Error while reopening cache file";
                                 ret.erase(it);
+                                ++shard.statistics.misses;
 
                                 return false;
                             }
 
-                            //put it back into the RAM
-                            _memoryCache.insert( (*it)->getHashKey(), *it );
-
-
-                            U64 memoryCacheSize, maximumInMemorySize;
-                            {
-                                QMutexLocker k(&_sizeLock);
-                                memoryCacheSize = _memoryCacheSize;
-                                maximumInMemorySize = _maximumInMemorySize;
-                            }
-                            std::list<EntryTypePtr> entriesToBeDeleted;
-
-                            //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
-                            while (memoryCacheSize > maximumInMemorySize) {
-                                if ( !tryEvictInMemoryEntry(entriesToBeDeleted) ) {
-                                    break;
-                                }
-
-                                {
-                                    QMutexLocker k(&_sizeLock);
-                                    memoryCacheSize = _memoryCacheSize;
-                                    maximumInMemorySize = _maximumInMemorySize;
-                                }
-                            }
+                            //put it back into the RAM. The memory budget is shared by all shards: the caller
+                            //evicts from any of them once this shard lock is released.
+                            shard.memoryCache.insert( (*it)->getHashKey(), *it );
+                            *promotedFromDisk = true;
                         }
                         
                         returnValue->push_back(*it);
+                        ++shard.statistics.diskHits;
                         ///Q_EMIT te added signal otherwise when first reading something that's already cached
                         ///the timeline wouldn't update
                         if (_signalEmitter) {
@@ -1759,7 +2058,7 @@ private:
                             ret.erase(it);
 
                             ///Remove it from the disk cache
-                            _diskCache.erase(diskCached);
+                            shard.diskCache.erase(diskCached);
                         }
 
                         return true;
@@ -1768,6 +2067,8 @@ private:
 
                 /*if we reache here it means no entries linked to the hash key matches the params,then
                    we allocate a new one*/
+                ++shard.statistics.misses;
+
                 return false;
             }
         }
@@ -1776,25 +2077,26 @@ private:
     /** @brief Inserts into the cache an entry that was previously allocated by the createInternal()
      * function. This is called directly by createInternal() if the allocation was successful
      **/
-    void sealEntry(const EntryTypePtr & entry,
+    void sealEntry(CacheShard& shard,
+                   const EntryTypePtr & entry,
                    bool inMemory) const
     {
-        assert( !_lock.tryLock() );   // must be locked
+        assert( !shard.lock.tryLock() );   // must be locked
         typename EntryType::hash_type hash = entry->getHashKey();
 
         if (inMemory) {
             /*if the entry doesn't exist on the memory cache,make a new list and insert it*/
-            CacheIterator existingEntry = _memoryCache(hash);
-            if ( existingEntry == _memoryCache.end() ) {
-                _memoryCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.memoryCache(hash);
+            if ( existingEntry == shard.memoryCache.end() ) {
+                shard.memoryCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
             }
         } else {
-            CacheIterator existingEntry = _diskCache(hash);
-            if ( existingEntry == _diskCache.end() ) {
-                _diskCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.diskCache(hash);
+            if ( existingEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
@@ -1802,15 +2104,18 @@ private:
         }
     }
 
-    bool tryEvictInMemoryEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    bool tryEvictInMemoryEntry(CacheShard& shard,
+                               std::list<EntryTypePtr> & entriesToBeDeleted) const
     {
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _memoryCache.evict();
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.memoryCache.evict();
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
             return false;
         }
+        ++shard.statistics.memoryEvictions;
+        shard.statistics.memoryEvictedBytes += evicted.second->getSizeInBytesFromParams();
 
         // If it is stored on disk, remove it from memory
         // If the cache is tiled, the entry is sharing the same file with other entries so we cannot close the file.
@@ -1836,7 +2141,7 @@ private:
 
             /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
             while ( ( diskCacheSize  + evicted.second->size() ) >= (maximumCacheSize - maximumInMemorySize) ) {
-                std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
+                std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
                 //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
                 //we'll let the user of these entries purge the extra entries left in the cache later on
                 if (!evictedFromDisk.second) {
@@ -1845,6 +2150,8 @@ private:
 
                 ///Erase the file from the disk if we reach the limit.
                 evictedFromDisk.second->removeAnyBackingFile();
+                ++shard.statistics.diskEvictions;
+                shard.statistics.diskEvictedBytes += evictedFromDisk.second->getSizeInBytesFromParams();
 
                 entriesToBeDeleted.push_back(evictedFromDisk.second);
 
@@ -1860,10 +2167,10 @@ private:
                 diskCacheSize -= fsize;
             }
 
-            CacheIterator existingDiskCacheEntry = _diskCache(evicted.first);
+            CacheIterator existingDiskCacheEntry = shard.diskCache(evicted.first);
             /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-            if ( existingDiskCacheEntry == _diskCache.end() ) {
-                _diskCache.insert(evicted.first, evicted.second);
+            if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(evicted.first, evicted.second);
             } else {   /*append to the existing list*/
                 getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
             }
@@ -1872,16 +2179,19 @@ private:
         return true;
     } // tryEvictEntry
 
-    bool tryEvictDiskEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    bool tryEvictDiskEntry(CacheShard& shard,
+                           std::list<EntryTypePtr> & entriesToBeDeleted) const
     {
 
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _diskCache.evict();
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.diskCache.evict();
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
             return false;
         }
+        ++shard.statistics.diskEvictions;
+        shard.statistics.diskEvictedBytes += evicted.second->getSizeInBytesFromParams();
         if (!_isTiled) {
             // Erase the file from the disk if we reach the limit.
             evicted.second->removeAnyBackingFile();
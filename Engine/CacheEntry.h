@@ -146,6 +146,51 @@ struct TileCacheFile
 
 typedef boost::shared_ptr<TileCacheFile> TileCacheFilePtr;
 
+/**
+ * @brief A snapshot of the activity of a cache since it was created or since its statistics were reset.
+ * See Cache::getStatistics()
+ **/
+struct CacheStatistics
+{
+    U64 memoryHits; // look-ups that found the entry in the memory portion
+    U64 diskHits; // look-ups that found the entry in the disk portion and mapped it back to memory
+    U64 misses;
+    U64 memoryEvictions; // LRU entries evicted from the memory portion, whether deleted or swapped to disk
+    U64 memoryEvictedBytes;
+    U64 diskEvictions; // LRU entries evicted from the disk portion
+    U64 diskEvictedBytes;
+    U64 swappedToDiskBytes;
+    U64 reloadedFromDiskBytes;
+    U64 memoryFullWaits; // times a thread waited for the deleter thread to free memory before creating an entry
+    U64 memoryFullWaitMSecs;
+    U64 deleterQueueSize; // entries waiting to be freed by the deleter thread
+    U64 deleterQueuePeakSize;
+
+    CacheStatistics()
+        : memoryHits(0)
+        , diskHits(0)
+        , misses(0)
+        , memoryEvictions(0)
+        , memoryEvictedBytes(0)
+        , diskEvictions(0)
+        , diskEvictedBytes(0)
+        , swappedToDiskBytes(0)
+        , reloadedFromDiskBytes(0)
+        , memoryFullWaits(0)
+        , memoryFullWaitMSecs(0)
+        , deleterQueueSize(0)
+        , deleterQueuePeakSize(0)
+    {
+    }
+
+    double getHitRate() const
+    {
+        U64 lookups = memoryHits + diskHits + misses;
+
+        return lookups == 0 ? 0. : (double)(memoryHits + diskHits) / lookups;
+    }
+};
+
 /**
  * @brief Defines the API of the Cache as seen by the cache entries
  **/
@@ -543,6 +588,23 @@ public:
         }
     }
 
+    /**
+     * @brief If the buffer is a memory mapped file or a tile of a tile cache file, hint the OS that
+     * it will be read soon. This does not block.
+     **/
+    void prefetch() const
+    {
+        if (_storageMode != eStorageModeDisk) {
+            return;
+        }
+        if (_backingFile) {
+            _backingFile->prefetch( 0, _backingFile->size() );
+        } else if (_cacheFile) {
+            assert(_entry);
+            _cacheFile->file->prefetch( _cacheFileDataOffset, _entry->getCacheTileSizeBytes() );
+        }
+    }
+
     void restoreBufferFromFile(const std::string & path, std::size_t dataOffset, AbstractCacheEntryBase* entry, bool isTileCache)
     {
         _entry = entry;
@@ -928,6 +990,17 @@ public:
         }
     }
 
+    /**
+     * @brief Hints the OS that the data of this entry will be read soon, so that if it lives in a memory mapped
+     * file and was paged out, it is read back in the background instead of on the first access.
+     **/
+    void prefetchData() const
+    {
+        QReadLocker k(&_entryLock);
+
+        _data.prefetch();
+    }
+
     /**
      * @brief Can be called several times without harm
      **/
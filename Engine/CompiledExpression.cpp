@@ -0,0 +1,1295 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CompiledExpression.h"
+
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "Engine/EffectInstance.h"
+#include "Engine/Knob.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
+
+// Beyond this magnitude ints can no longer be represented exactly by a double, Python would switch to long
+#define NATRON_COMPILED_EXPRESSION_MAX_EXACT_INT 9007199254740992.
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846264338327950288
+#endif
+
+#ifndef M_E
+#define M_E 2.71828182845904523536028747135266250
+#endif
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+enum TokenTypeEnum
+{
+    eTokenTypeEnd = 0,
+    eTokenTypeNumber,
+    eTokenTypeName,
+    eTokenTypeOperator
+};
+
+struct Token
+{
+    TokenTypeEnum type;
+    std::string text;
+    CompiledExpression::Value number;
+};
+
+enum OpEnum
+{
+    eOpConstant = 0,
+    eOpFrame,
+    eOpView,
+    eOpNegate,
+    eOpPositive,
+    eOpNot,
+    eOpAdd,
+    eOpSubtract,
+    eOpMultiply,
+    eOpDivide,
+    eOpFloorDivide,
+    eOpModulo,
+    eOpPower,
+    eOpCompare, // children are the operands, compareOps the operators between them
+    eOpAnd,
+    eOpOr,
+    eOpIfElse, // children are: value if true, condition, value if false
+    eOpFunction,
+    eOpKnobValue
+};
+
+enum CompareOpEnum
+{
+    eCompareOpLess = 0,
+    eCompareOpLessEqual,
+    eCompareOpGreater,
+    eCompareOpGreaterEqual,
+    eCompareOpEqual,
+    eCompareOpNotEqual
+};
+
+enum FunctionEnum
+{
+    eFunctionSin = 0,
+    eFunctionCos,
+    eFunctionTan,
+    eFunctionAsin,
+    eFunctionAcos,
+    eFunctionAtan,
+    eFunctionSinh,
+    eFunctionCosh,
+    eFunctionTanh,
+    eFunctionExp,
+    eFunctionSqrt,
+    eFunctionLog,
+    eFunctionLog10,
+    eFunctionFabs,
+    eFunctionFloor,
+    eFunctionCeil,
+    eFunctionDegrees,
+    eFunctionRadians,
+    eFunctionAtan2,
+    eFunctionHypot,
+    eFunctionFmod,
+    eFunctionPow,
+    eFunctionAbs,
+    eFunctionInt,
+    eFunctionFloat,
+    eFunctionRound,
+    eFunctionMin,
+    eFunctionMax
+};
+
+struct FunctionDescriptor
+{
+    const char* name;
+    FunctionEnum function;
+    int minArgs;
+    int maxArgs; // -1 for any number
+};
+
+// Bare names since the interpreter does "from math import *": note that pow is math.pow and not the builtin
+const FunctionDescriptor functions[] = {
+    { "sin", eFunctionSin, 1, 1 },
+    { "cos", eFunctionCos, 1, 1 },
+    { "tan", eFunctionTan, 1, 1 },
+    { "asin", eFunctionAsin, 1, 1 },
+    { "acos", eFunctionAcos, 1, 1 },
+    { "atan", eFunctionAtan, 1, 1 },
+    { "sinh", eFunctionSinh, 1, 1 },
+    { "cosh", eFunctionCosh, 1, 1 },
+    { "tanh", eFunctionTanh, 1, 1 },
+    { "exp", eFunctionExp, 1, 1 },
+    { "sqrt", eFunctionSqrt, 1, 1 },
+    { "log", eFunctionLog, 1, 1 },
+    { "log10", eFunctionLog10, 1, 1 },
+    { "fabs", eFunctionFabs, 1, 1 },
+    { "floor", eFunctionFloor, 1, 1 },
+    { "ceil", eFunctionCeil, 1, 1 },
+    { "degrees", eFunctionDegrees, 1, 1 },
+    { "radians", eFunctionRadians, 1, 1 },
+    { "atan2", eFunctionAtan2, 2, 2 },
+    { "hypot", eFunctionHypot, 2, 2 },
+    { "fmod", eFunctionFmod, 2, 2 },
+    { "pow", eFunctionPow, 2, 2 },
+    { "abs", eFunctionAbs, 1, 1 },
+    { "int", eFunctionInt, 1, 1 },
+    { "float", eFunctionFloat, 1, 1 },
+    { "round", eFunctionRound, 1, 1 },
+    { "min", eFunctionMin, 2, -1 },
+    { "max", eFunctionMax, 2, -1 },
+    { 0, eFunctionSin, 0, 0 }
+};
+
+enum KnobMethodEnum
+{
+    eKnobMethodGetValue = 0, // getValue(dimension = 0)
+    eKnobMethodGetValueAtTime, // getValueAtTime(time, dimension = 0)
+    eKnobMethodGet, // get().member
+    eKnobMethodGetAtTime // get(time).member
+};
+
+struct ExprNode
+{
+    OpEnum op;
+    CompiledExpression::Value constant;
+    std::vector<int> children;
+    std::vector<CompareOpEnum> compareOps;
+    FunctionEnum function;
+    KnobWPtr knob;
+    KnobMethodEnum method;
+    int memberDimension; // dimension selected by get().member
+
+    ExprNode()
+        : op(eOpConstant)
+        , constant()
+        , children()
+        , compareOps()
+        , function(eFunctionSin)
+        , knob()
+        , method(eKnobMethodGetValue)
+        , memberDimension(0)
+    {
+    }
+};
+
+class CompileError
+    : public std::runtime_error
+{
+public:
+
+    CompileError(const std::string& what)
+        : std::runtime_error(what)
+    {
+    }
+};
+
+class EvaluationError
+{
+public:
+
+    std::string reason;
+
+    EvaluationError(const std::string& reason)
+        : reason(reason)
+    {
+    }
+};
+
+inline bool
+isTrue(const CompiledExpression::Value& v)
+{
+    return v.value != 0.;
+}
+
+inline CompiledExpression::Value
+makeBool(bool b)
+{
+    return CompiledExpression::Value(b ? 1. : 0., true);
+}
+
+inline CompiledExpression::Value
+makeInt(double v)
+{
+    if (std::fabs(v) >= NATRON_COMPILED_EXPRESSION_MAX_EXACT_INT) {
+        throw EvaluationError("integer overflow");
+    }
+
+    return CompiledExpression::Value(v, true);
+}
+
+inline CompiledExpression::Value
+makeFloat(double v)
+{
+    return CompiledExpression::Value(v, false);
+}
+
+inline CompiledExpression::Value
+makeCheckedFloat(double v,
+                 const char* error)
+{
+    // Python raises ValueError or OverflowError where the C library returns NaN or infinity
+    if ( (v != v) || (std::fabs(v) > 1.7976931348623157e308) ) {
+        throw EvaluationError(error);
+    }
+
+    return CompiledExpression::Value(v, false);
+}
+
+/**
+ * @brief Python 2 floor division and modulo of two ints
+ **/
+inline long long
+intFloorDivide(long long a,
+               long long b)
+{
+    long long q = a / b;
+
+    if ( ( (a % b) != 0 ) && ( (a < 0) != (b < 0) ) ) {
+        --q;
+    }
+
+    return q;
+}
+
+inline long long
+intModulo(long long a,
+          long long b)
+{
+    long long r = a % b;
+
+    if ( (r != 0) && ( (r < 0) != (b < 0) ) ) {
+        r += b;
+    }
+
+    return r;
+}
+
+/**
+ * @brief Python float_divmod
+ **/
+void
+floatDivMod(double a,
+            double b,
+            double* floorDiv,
+            double* mod)
+{
+    double m = std::fmod(a, b);
+    double div = (a - m) / b;
+
+    if (m != 0.) {
+        if ( (b < 0) != (m < 0) ) {
+            m += b;
+            div -= 1.;
+        }
+    } else {
+        m = (b < 0) ? -0. : 0.;
+    }
+    double fd;
+    if (div != 0.) {
+        fd = std::floor(div);
+        if (div - fd > 0.5) {
+            fd += 1.;
+        }
+    } else {
+        fd = (a / b < 0) ? -0. : 0.;
+    }
+    *floorDiv = fd;
+    *mod = m;
+}
+} // anon namespace
+
+struct CompiledExpressionPrivate
+{
+    std::vector<ExprNode> nodes;
+    int root;
+    int dimension;
+
+    CompiledExpressionPrivate()
+        : nodes()
+        , root(-1)
+        , dimension(0)
+    {
+    }
+
+    CompiledExpression::Value evaluate(int nodeIndex, double time, ViewIdx view) const;
+
+    CompiledExpression::Value evaluateBinary(OpEnum op, const CompiledExpression::Value& a, const CompiledExpression::Value& b) const;
+
+    CompiledExpression::Value evaluateFunction(const ExprNode& node, double time, ViewIdx view) const;
+
+    CompiledExpression::Value evaluateKnob(const ExprNode& node, double time, ViewIdx view) const;
+};
+
+namespace {
+/**
+ * @brief Recursive descent parser following the precedence of the Python grammar
+ **/
+class ExpressionParser
+{
+    std::vector<Token> _tokens;
+    std::size_t _pos;
+    CompiledExpressionPrivate* _expr;
+    KnobPtr _thisParam;
+    NodePtr _thisNode;
+    NodesList _siblings;
+
+public:
+
+    ExpressionParser(CompiledExpressionPrivate* expr,
+                     const KnobPtr& thisParam)
+        : _tokens()
+        , _pos(0)
+        , _expr(expr)
+        , _thisParam(thisParam)
+        , _thisNode()
+        , _siblings()
+    {
+        if (thisParam) {
+            EffectInstance* effect = dynamic_cast<EffectInstance*>( thisParam->getHolder() );
+            if (effect) {
+                _thisNode = effect->getNode();
+                boost::shared_ptr<NodeCollection> collection = _thisNode ? _thisNode->getGroup() : boost::shared_ptr<NodeCollection>();
+                if (collection) {
+                    // Same nodes as the ones declared by KnobHelperPrivate::declarePythonVariables
+                    NodesList nodes = collection->getNodes();
+                    for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+                        if ( (*it)->isActivated() && !(*it)->getParentMultiInstance() ) {
+                            _siblings.push_back(*it);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void tokenize(const std::string& str)
+    {
+        std::size_t i = 0;
+
+        while ( i < str.size() ) {
+            char c = str[i];
+            if ( std::isspace( (unsigned char)c ) ) {
+                ++i;
+                continue;
+            }
+            Token t;
+            if ( std::isdigit( (unsigned char)c ) || ( (c == '.') && ( i + 1 < str.size() ) && std::isdigit( (unsigned char)str[i + 1] ) ) ) {
+                std::size_t start = i;
+                bool isFloat = false;
+                while ( i < str.size() && std::isdigit( (unsigned char)str[i] ) ) {
+                    ++i;
+                }
+                if ( ( i < str.size() ) && (str[i] == '.') ) {
+                    isFloat = true;
+                    ++i;
+                    while ( i < str.size() && std::isdigit( (unsigned char)str[i] ) ) {
+                        ++i;
+                    }
+                }
+                if ( ( i < str.size() ) && ( (str[i] == 'e') || (str[i] == 'E') ) ) {
+                    isFloat = true;
+                    ++i;
+                    if ( ( i < str.size() ) && ( (str[i] == '+') || (str[i] == '-') ) ) {
+                        ++i;
+                    }
+                    if ( ( i >= str.size() ) || !std::isdigit( (unsigned char)str[i] ) ) {
+                        throw CompileError("invalid number");
+                    }
+                    while ( i < str.size() && std::isdigit( (unsigned char)str[i] ) ) {
+                        ++i;
+                    }
+                }
+                if ( ( i < str.size() ) && ( std::isalnum( (unsigned char)str[i] ) || (str[i] == '_') ) ) {
+                    // hexadecimal, octal, long or complex literals
+                    throw CompileError("unsupported number literal");
+                }
+                t.type = eTokenTypeNumber;
+                t.text = str.substr(start, i - start);
+                if ( !isFloat && (t.text.size() > 1) && (t.text[0] == '0') ) {
+                    // Python 2 octal literal
+                    throw CompileError("unsupported number literal");
+                }
+                double v = std::strtod(t.text.c_str(), 0);
+                t.number = isFloat ? makeFloat(v) : CompiledExpression::Value(v, true);
+                if ( !isFloat && (v >= NATRON_COMPILED_EXPRESSION_MAX_EXACT_INT) ) {
+                    throw CompileError("integer literal too large");
+                }
+            } else if ( std::isalpha( (unsigned char)c ) || (c == '_') ) {
+                std::size_t start = i;
+                while ( i < str.size() && ( std::isalnum( (unsigned char)str[i] ) || (str[i] == '_') ) ) {
+                    ++i;
+                }
+                t.type = eTokenTypeName;
+                t.text = str.substr(start, i - start);
+            } else {
+                static const char* const operators[] = {
+                    "**", "//", "<=", ">=", "==", "!=", "<", ">", "+", "-", "*", "/", "%", "(", ")", ",", ".", 0
+                };
+                t.type = eTokenTypeOperator;
+                for (int j = 0; operators[j]; ++j) {
+                    std::size_t len = std::strlen(operators[j]);
+                    if (str.compare(i, len, operators[j]) == 0) {
+                        t.text = operators[j];
+                        break;
+                    }
+                }
+                if ( t.text.empty() ) {
+                    throw CompileError( std::string("unsupported character '") + c + "'" );
+                }
+                i += t.text.size();
+            }
+            _tokens.push_back(t);
+        }
+        Token end;
+        end.type = eTokenTypeEnd;
+        _tokens.push_back(end);
+    } // tokenize
+
+    int parse()
+    {
+        int ret = parseTernary();
+
+        if (peek().type != eTokenTypeEnd) {
+            throw CompileError("unexpected '" + peek().text + "'");
+        }
+
+        return ret;
+    }
+
+private:
+
+    const Token& peek() const
+    {
+        return _tokens[_pos];
+    }
+
+    bool peekIs(const char* text) const
+    {
+        const Token& t = _tokens[_pos];
+
+        return (t.type == eTokenTypeOperator || t.type == eTokenTypeName) && t.text == text;
+    }
+
+    bool accept(const char* text)
+    {
+        if ( peekIs(text) ) {
+            ++_pos;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void expect(const char* text)
+    {
+        if ( !accept(text) ) {
+            throw CompileError(std::string("expected '") + text + "'");
+        }
+    }
+
+    std::string expectName()
+    {
+        if (peek().type != eTokenTypeName) {
+            throw CompileError("expected a name");
+        }
+
+        return _tokens[_pos++].text;
+    }
+
+    int addNode(const ExprNode& node)
+    {
+        _expr->nodes.push_back(node);
+
+        return (int)_expr->nodes.size() - 1;
+    }
+
+    int addNode(OpEnum op,
+                int a = -1,
+                int b = -1,
+                int c = -1)
+    {
+        ExprNode node;
+
+        node.op = op;
+        if (a != -1) {
+            node.children.push_back(a);
+        }
+        if (b != -1) {
+            node.children.push_back(b);
+        }
+        if (c != -1) {
+            node.children.push_back(c);
+        }
+
+        return addNode(node);
+    }
+
+    int addConstant(const CompiledExpression::Value& v)
+    {
+        ExprNode node;
+
+        node.op = eOpConstant;
+        node.constant = v;
+
+        return addNode(node);
+    }
+
+    int parseTernary()
+    {
+        int ifTrue = parseOr();
+
+        if ( accept("if") ) {
+            int condition = parseOr();
+            expect("else");
+            int ifFalse = parseTernary();
+
+            return addNode(eOpIfElse, ifTrue, condition, ifFalse);
+        }
+
+        return ifTrue;
+    }
+
+    int parseOr()
+    {
+        int ret = parseAnd();
+
+        while ( accept("or") ) {
+            ret = addNode( eOpOr, ret, parseAnd() );
+        }
+
+        return ret;
+    }
+
+    int parseAnd()
+    {
+        int ret = parseNot();
+
+        while ( accept("and") ) {
+            ret = addNode( eOpAnd, ret, parseNot() );
+        }
+
+        return ret;
+    }
+
+    int parseNot()
+    {
+        if ( accept("not") ) {
+            return addNode( eOpNot, parseNot() );
+        }
+
+        return parseComparison();
+    }
+
+    bool acceptCompareOp(CompareOpEnum* op)
+    {
+        if ( accept("<") ) {
+            *op = eCompareOpLess;
+        } else if ( accept("<=") ) {
+            *op = eCompareOpLessEqual;
+        } else if ( accept(">") ) {
+            *op = eCompareOpGreater;
+        } else if ( accept(">=") ) {
+            *op = eCompareOpGreaterEqual;
+        } else if ( accept("==") ) {
+            *op = eCompareOpEqual;
+        } else if ( accept("!=") ) {
+            *op = eCompareOpNotEqual;
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    int parseComparison()
+    {
+        int first = parseArith();
+        CompareOpEnum op;
+
+        if ( !acceptCompareOp(&op) ) {
+            return first;
+        }
+        ExprNode node;
+        node.op = eOpCompare;
+        node.children.push_back(first);
+        node.compareOps.push_back(op);
+        node.children.push_back( parseArith() );
+        while ( acceptCompareOp(&op) ) {
+            node.compareOps.push_back(op);
+            node.children.push_back( parseArith() );
+        }
+
+        return addNode(node);
+    }
+
+    int parseArith()
+    {
+        int ret = parseTerm();
+
+        for (;; ) {
+            if ( accept("+") ) {
+                ret = addNode( eOpAdd, ret, parseTerm() );
+            } else if ( accept("-") ) {
+                ret = addNode( eOpSubtract, ret, parseTerm() );
+            } else {
+                return ret;
+            }
+        }
+    }
+
+    int parseTerm()
+    {
+        int ret = parseFactor();
+
+        for (;; ) {
+            if ( accept("*") ) {
+                ret = addNode( eOpMultiply, ret, parseFactor() );
+            } else if ( accept("/") ) {
+                ret = addNode( eOpDivide, ret, parseFactor() );
+            } else if ( accept("//") ) {
+                ret = addNode( eOpFloorDivide, ret, parseFactor() );
+            } else if ( accept("%") ) {
+                ret = addNode( eOpModulo, ret, parseFactor() );
+            } else {
+                return ret;
+            }
+        }
+    }
+
+    int parseFactor()
+    {
+        if ( accept("-") ) {
+            return addNode( eOpNegate, parseFactor() );
+        } else if ( accept("+") ) {
+            return addNode( eOpPositive, parseFactor() );
+        }
+
+        return parsePower();
+    }
+
+    int parsePower()
+    {
+        int ret = parsePrimary();
+
+        if ( accept("**") ) {
+            // Right associative, and binds tighter than a unary operator on its left only
+            return addNode( eOpPower, ret, parseFactor() );
+        }
+
+        return ret;
+    }
+
+    std::vector<int> parseArguments()
+    {
+        std::vector<int> args;
+
+        expect("(");
+        if ( accept(")") ) {
+            return args;
+        }
+        for (;; ) {
+            args.push_back( parseTernary() );
+            if ( accept(")") ) {
+                return args;
+            }
+            expect(",");
+        }
+    }
+
+    int parsePrimary()
+    {
+        const Token& t = peek();
+
+        if (t.type == eTokenTypeNumber) {
+            ++_pos;
+
+            return addConstant(t.number);
+        }
+        if ( accept("(") ) {
+            int ret = parseTernary();
+            expect(")");
+            if ( peekIs(",") ) {
+                throw CompileError("tuples are not supported");
+            }
+
+            return ret;
+        }
+        if (t.type != eTokenTypeName) {
+            throw CompileError("unexpected '" + t.text + "'");
+        }
+
+        std::string name = expectName();
+
+        // Names are resolved in the same order as the local variables of the Python function wrapping the expression
+        if (name == "thisParam") {
+            return parseKnobAccess(_thisParam);
+        } else if (name == "thisNode") {
+            return parseNodeAccess(_thisNode);
+        }
+        for (NodesList::const_iterator it = _siblings.begin(); it != _siblings.end(); ++it) {
+            if ( (*it)->getScriptName_mt_safe() == name ) {
+                return parseNodeAccess(*it);
+            }
+        }
+        if ( (name == "thisGroup") || (name == "app") || (name == "random") || (name == "randomInt") || (name == "curve") ) {
+            throw CompileError("unsupported name '" + name + "'");
+        } else if (name == "dimension") {
+            return addConstant( CompiledExpression::Value(_expr->dimension, true) );
+        } else if (name == "frame") {
+            return addNode(eOpFrame);
+        } else if (name == "view") {
+            return addNode(eOpView);
+        } else if (name == "True") {
+            return addConstant( makeBool(true) );
+        } else if (name == "False") {
+            return addConstant( makeBool(false) );
+        } else if (name == "pi") {
+            return addConstant( makeFloat(M_PI) );
+        } else if (name == "e") {
+            return addConstant( makeFloat(M_E) );
+        }
+
+        for (int i = 0; functions[i].name; ++i) {
+            if (name == functions[i].name) {
+                ExprNode node;
+                node.op = eOpFunction;
+                node.function = functions[i].function;
+                node.children = parseArguments();
+                int nArgs = (int)node.children.size();
+                if ( (nArgs < functions[i].minArgs) || ( (functions[i].maxArgs != -1) && (nArgs > functions[i].maxArgs) ) ) {
+                    throw CompileError("unsupported number of arguments for '" + name + "'");
+                }
+
+                return addNode(node);
+            }
+        }
+
+        throw CompileError("unsupported name '" + name + "'");
+    } // parsePrimary
+
+    int parseNodeAccess(const NodePtr& node)
+    {
+        if (!node) {
+            throw CompileError("no node");
+        }
+        expect(".");
+        std::string knobName = expectName();
+        KnobPtr knob = node->getKnobByName(knobName);
+        if (!knob) {
+            throw CompileError("unknown parameter '" + knobName + "'");
+        }
+
+        return parseKnobAccess(knob);
+    }
+
+    int parseKnobAccess(const KnobPtr& knob)
+    {
+        if (!knob) {
+            throw CompileError("no parameter");
+        }
+
+        // Only the parameters whose Python class has getValue(dimension), getValueAtTime(time, dimension) and get()
+        KnobI* k = knob.get();
+        bool isColor = dynamic_cast<KnobColor*>(k) != 0;
+        if ( !dynamic_cast<KnobInt*>(k) && !dynamic_cast<KnobDouble*>(k) && !isColor && !dynamic_cast<KnobBool*>(k) &&
+             !dynamic_cast<KnobChoice*>(k) ) {
+            throw CompileError("unsupported parameter type for '" + knob->getName() + "'");
+        }
+
+        expect(".");
+        std::string method = expectName();
+        ExprNode node;
+        node.op = eOpKnobValue;
+        node.knob = knob;
+        node.children = parseArguments();
+        int nArgs = (int)node.children.size();
+        if (method == "getValue") {
+            node.method = eKnobMethodGetValue;
+            if (nArgs > 1) {
+                throw CompileError("unsupported number of arguments for 'getValue'");
+            }
+        } else if (method == "getValueAtTime") {
+            node.method = eKnobMethodGetValueAtTime;
+            if ( (nArgs < 1) || (nArgs > 2) ) {
+                throw CompileError("unsupported number of arguments for 'getValueAtTime'");
+            }
+        } else if (method == "get") {
+            node.method = nArgs == 0 ? eKnobMethodGet : eKnobMethodGetAtTime;
+            if (nArgs > 1) {
+                throw CompileError("unsupported number of arguments for 'get'");
+            }
+            int nDims = knob->getDimension();
+            if ( accept(".") ) {
+                std::string member = expectName();
+                static const char* const xyz[] = { "x", "y", "z", 0 };
+                static const char* const rgba[] = { "r", "g", "b", "a", 0 };
+                const char* const* members = isColor ? rgba : xyz;
+                node.memberDimension = -1;
+                for (int i = 0; members[i]; ++i) {
+                    if (member == members[i]) {
+                        node.memberDimension = i;
+                    }
+                }
+                if ( (nDims == 1) || (node.memberDimension == -1) || (node.memberDimension >= nDims) ) {
+                    throw CompileError("unsupported member '" + member + "'");
+                }
+            } else if (nDims != 1) {
+                throw CompileError("tuples are not supported");
+            }
+        } else {
+            throw CompileError("unsupported function '" + method + "'");
+        }
+
+        return addNode(node);
+    } // parseKnobAccess
+};
+} // anon namespace
+
+CompiledExpression::Value
+CompiledExpressionPrivate::evaluateBinary(OpEnum op,
+                                          const CompiledExpression::Value& a,
+                                          const CompiledExpression::Value& b) const
+{
+    bool ints = a.isInt && b.isInt;
+
+    switch (op) {
+    case eOpAdd:
+
+        return ints ? makeInt(a.value + b.value) : makeFloat(a.value + b.value);
+    case eOpSubtract:
+
+        return ints ? makeInt(a.value - b.value) : makeFloat(a.value - b.value);
+    case eOpMultiply:
+
+        return ints ? makeInt(a.value * b.value) : makeFloat(a.value * b.value);
+    case eOpDivide:
+        if (b.value == 0.) {
+            throw EvaluationError("division by zero");
+        }
+        // Python 2: the division of two ints is a floor division
+        if (ints) {
+            return makeInt( (double)intFloorDivide( (long long)a.value, (long long)b.value ) );
+        }
+
+        return makeFloat(a.value / b.value);
+    case eOpFloorDivide:
+    case eOpModulo: {
+        if (b.value == 0.) {
+            throw EvaluationError("division by zero");
+        }
+        if (ints) {
+            long long r = (op == eOpFloorDivide) ? intFloorDivide( (long long)a.value, (long long)b.value ) : intModulo( (long long)a.value, (long long)b.value );
+
+            return makeInt( (double)r );
+        }
+        double floorDiv, mod;
+        floatDivMod(a.value, b.value, &floorDiv, &mod);
+
+        return makeFloat(op == eOpFloorDivide ? floorDiv : mod);
+    }
+    case eOpPower: {
+        if ( ints && (b.value >= 0) ) {
+            return makeInt( std::pow(a.value, b.value) );
+        }
+        if (a.value == 0. && b.value < 0.) {
+            throw EvaluationError("0.0 cannot be raised to a negative power");
+        }
+        if ( (a.value < 0.) && (b.value != std::floor(b.value) ) ) {
+            throw EvaluationError("negative number cannot be raised to a fractional power");
+        }
+
+        return makeCheckedFloat(std::pow(a.value, b.value), "numerical result out of range");
+    }
+    default:
+        assert(false);
+        break;
+    }
+
+    return CompiledExpression::Value();
+} // CompiledExpressionPrivate::evaluateBinary
+
+CompiledExpression::Value
+CompiledExpressionPrivate::evaluateFunction(const ExprNode& node,
+                                            double time,
+                                            ViewIdx view) const
+{
+    std::vector<CompiledExpression::Value> args( node.children.size() );
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        args[i] = evaluate(node.children[i], time, view);
+    }
+    double x = args[0].value;
+
+    switch (node.function) {
+    case eFunctionSin:
+
+        return makeCheckedFloat(std::sin(x), "math domain error");
+    case eFunctionCos:
+
+        return makeCheckedFloat(std::cos(x), "math domain error");
+    case eFunctionTan:
+
+        return makeCheckedFloat(std::tan(x), "math domain error");
+    case eFunctionAsin:
+
+        return makeCheckedFloat(std::asin(x), "math domain error");
+    case eFunctionAcos:
+
+        return makeCheckedFloat(std::acos(x), "math domain error");
+    case eFunctionAtan:
+
+        return makeCheckedFloat(std::atan(x), "math domain error");
+    case eFunctionSinh:
+
+        return makeCheckedFloat(std::sinh(x), "math range error");
+    case eFunctionCosh:
+
+        return makeCheckedFloat(std::cosh(x), "math range error");
+    case eFunctionTanh:
+
+        return makeCheckedFloat(std::tanh(x), "math domain error");
+    case eFunctionExp:
+
+        return makeCheckedFloat(std::exp(x), "math range error");
+    case eFunctionSqrt:
+
+        return makeCheckedFloat(std::sqrt(x), "math domain error");
+    case eFunctionLog:
+        if (x <= 0.) {
+            throw EvaluationError("math domain error");
+        }
+
+        return makeCheckedFloat(std::log(x), "math domain error");
+    case eFunctionLog10:
+        if (x <= 0.) {
+            throw EvaluationError("math domain error");
+        }
+
+        return makeCheckedFloat(std::log10(x), "math domain error");
+    case eFunctionFabs:
+
+        return makeFloat( std::fabs(x) );
+    case eFunctionFloor:
+
+        // Python 2 math.floor returns a float
+        return makeFloat( std::floor(x) );
+    case eFunctionCeil:
+
+        return makeFloat( std::ceil(x) );
+    case eFunctionDegrees:
+
+        return makeFloat(x * 180. / M_PI);
+    case eFunctionRadians:
+
+        return makeFloat(x * M_PI / 180.);
+    case eFunctionAtan2:
+
+        return makeFloat( std::atan2(x, args[1].value) );
+    case eFunctionHypot:
+
+        return makeCheckedFloat(std::sqrt(x * x + args[1].value * args[1].value), "math range error");
+    case eFunctionFmod:
+        if (args[1].value == 0.) {
+            throw EvaluationError("math domain error");
+        }
+
+        return makeFloat( std::fmod(x, args[1].value) );
+    case eFunctionPow: {
+        double y = args[1].value;
+        if ( ( (x == 0.) && (y < 0.) ) || ( (x < 0.) && ( y != std::floor(y) ) ) ) {
+            throw EvaluationError("math domain error");
+        }
+
+        return makeCheckedFloat(std::pow(x, y), "math range error");
+    }
+    case eFunctionAbs:
+
+        return CompiledExpression::Value(std::fabs(x), args[0].isInt);
+    case eFunctionInt:
+
+        // Truncates towards zero
+        return makeInt( x < 0 ? std::ceil(x) : std::floor(x) );
+    case eFunctionFloat:
+
+        return makeFloat(x);
+    case eFunctionRound: {
+        // Python 2 rounds half away from zero and returns a float
+        double ax = std::fabs(x);
+        double r = std::floor(ax);
+        if (ax - r >= 0.5) {
+            r += 1.;
+        }
+
+        return makeFloat(x < 0 ? -r : r);
+    }
+    case eFunctionMin:
+    case eFunctionMax: {
+        // Returns the first of the equal extrema, with its type
+        std::size_t best = 0;
+        for (std::size_t i = 1; i < args.size(); ++i) {
+            if ( (node.function == eFunctionMin) ? (args[i].value < args[best].value) : (args[i].value > args[best].value) ) {
+                best = i;
+            }
+        }
+
+        return args[best];
+    }
+    } // switch
+
+    return CompiledExpression::Value();
+} // CompiledExpressionPrivate::evaluateFunction
+
+CompiledExpression::Value
+CompiledExpressionPrivate::evaluateKnob(const ExprNode& node,
+                                        double time,
+                                        ViewIdx view) const
+{
+    KnobPtr knob = node.knob.lock();
+
+    if (!knob) {
+        throw EvaluationError("the parameter was deleted");
+    }
+
+    // The nodes were bound at compile time: Python raises if the node was removed since
+    EffectInstance* effect = dynamic_cast<EffectInstance*>( knob->getHolder() );
+    NodePtr holderNode = effect ? effect->getNode() : NodePtr();
+    if ( !holderNode || !holderNode->isActivated() ) {
+        throw EvaluationError("the node of the parameter is not active");
+    }
+
+    int dimension = 0;
+    bool hasTime = false;
+    double atTime = 0.;
+    switch (node.method) {
+    case eKnobMethodGetValue:
+        if ( !node.children.empty() ) {
+            CompiledExpression::Value dim = evaluate(node.children[0], time, view);
+            if (!dim.isInt) {
+                throw EvaluationError("the dimension must be an int");
+            }
+            dimension = (int)dim.value;
+        }
+        break;
+    case eKnobMethodGetValueAtTime:
+        hasTime = true;
+        atTime = evaluate(node.children[0], time, view).value;
+        if (node.children.size() > 1) {
+            CompiledExpression::Value dim = evaluate(node.children[1], time, view);
+            if (!dim.isInt) {
+                throw EvaluationError("the dimension must be an int");
+            }
+            dimension = (int)dim.value;
+        }
+        break;
+    case eKnobMethodGet:
+        dimension = node.memberDimension;
+        break;
+    case eKnobMethodGetAtTime:
+        hasTime = true;
+        atTime = evaluate(node.children[0], time, view).value;
+        dimension = node.memberDimension;
+        break;
+    }
+    if ( (dimension < 0) || ( dimension >= knob->getDimension() ) ) {
+        throw EvaluationError("dimension out of range");
+    }
+
+    // Same calls as the ones of the Python Param classes
+    KnobI* k = knob.get();
+    Knob<double>* isDouble = dynamic_cast<Knob<double>*>(k);
+    if (isDouble) {
+        return makeFloat( hasTime ? isDouble->getValueAtTime(atTime, dimension) : isDouble->getValue(dimension) );
+    }
+    Knob<int>* isInt = dynamic_cast<Knob<int>*>(k);
+    if (isInt) {
+        return CompiledExpression::Value(hasTime ? isInt->getValueAtTime(atTime, dimension) : isInt->getValue(dimension), true);
+    }
+    Knob<bool>* isBool = dynamic_cast<Knob<bool>*>(k);
+    if (isBool) {
+        return makeBool( hasTime ? isBool->getValueAtTime(atTime, dimension) : isBool->getValue(dimension) );
+    }
+    throw EvaluationError("unsupported parameter type");
+} // CompiledExpressionPrivate::evaluateKnob
+
+CompiledExpression::Value
+CompiledExpressionPrivate::evaluate(int nodeIndex,
+                                    double time,
+                                    ViewIdx view) const
+{
+    const ExprNode& node = nodes[nodeIndex];
+
+    switch (node.op) {
+    case eOpConstant:
+
+        return node.constant;
+    case eOpFrame:
+
+        // The frame is passed to Python as written by an ostream: integral times are ints
+        return CompiledExpression::Value( time, time == std::floor(time) );
+    case eOpView:
+
+        return CompiledExpression::Value( (double)view.value(), true );
+    case eOpNegate: {
+        CompiledExpression::Value v = evaluate(node.children[0], time, view);
+        v.value = -v.value;
+
+        return v;
+    }
+    case eOpPositive:
+
+        return evaluate(node.children[0], time, view);
+    case eOpNot:
+
+        return makeBool( !isTrue( evaluate(node.children[0], time, view) ) );
+    case eOpAdd:
+    case eOpSubtract:
+    case eOpMultiply:
+    case eOpDivide:
+    case eOpFloorDivide:
+    case eOpModulo:
+    case eOpPower:
+
+        return evaluateBinary( node.op, evaluate(node.children[0], time, view), evaluate(node.children[1], time, view) );
+    case eOpCompare: {
+        // a < b < c is a < b and b < c, each operand being evaluated once
+        CompiledExpression::Value left = evaluate(node.children[0], time, view);
+        for (std::size_t i = 0; i < node.compareOps.size(); ++i) {
+            CompiledExpression::Value right = evaluate(node.children[i + 1], time, view);
+            bool r = false;
+            switch (node.compareOps[i]) {
+            case eCompareOpLess:
+                r = left.value < right.value;
+                break;
+            case eCompareOpLessEqual:
+                r = left.value <= right.value;
+                break;
+            case eCompareOpGreater:
+                r = left.value > right.value;
+                break;
+            case eCompareOpGreaterEqual:
+                r = left.value >= right.value;
+                break;
+            case eCompareOpEqual:
+                r = left.value == right.value;
+                break;
+            case eCompareOpNotEqual:
+                r = left.value != right.value;
+                break;
+            }
+            if (!r) {
+                return makeBool(false);
+            }
+            left = right;
+        }
+
+        return makeBool(true);
+    }
+    case eOpAnd: {
+        // Python returns the operand itself, not a bool
+        CompiledExpression::Value a = evaluate(node.children[0], time, view);
+
+        return isTrue(a) ? evaluate(node.children[1], time, view) : a;
+    }
+    case eOpOr: {
+        CompiledExpression::Value a = evaluate(node.children[0], time, view);
+
+        return isTrue(a) ? a : evaluate(node.children[1], time, view);
+    }
+    case eOpIfElse:
+
+        return isTrue( evaluate(node.children[1], time, view) ) ? evaluate(node.children[0], time, view) : evaluate(node.children[2], time, view);
+    case eOpFunction:
+
+        return evaluateFunction(node, time, view);
+    case eOpKnobValue:
+
+        return evaluateKnob(node, time, view);
+    } // switch
+    assert(false);
+
+    return CompiledExpression::Value();
+} // CompiledExpressionPrivate::evaluate
+
+CompiledExpression::CompiledExpression()
+    : _imp( new CompiledExpressionPrivate() )
+{
+}
+
+CompiledExpression::~CompiledExpression()
+{
+}
+
+CompiledExpressionPtr
+CompiledExpression::compile(const std::string& expression,
+                            const KnobPtr& thisParam,
+                            int dimension,
+                            std::string* reason)
+{
+    CompiledExpressionPtr ret( new CompiledExpression() );
+
+    ret->_imp->dimension = dimension;
+    try {
+        ExpressionParser parser(ret->_imp.get(), thisParam);
+        parser.tokenize(expression);
+        ret->_imp->root = parser.parse();
+    } catch (const CompileError& e) {
+        *reason = e.what();
+
+        return CompiledExpressionPtr();
+    }
+
+    return ret;
+}
+
+bool
+CompiledExpression::evaluate(double time,
+                             ViewIdx view,
+                             Value* ret,
+                             std::string* reason) const
+{
+    try {
+        *ret = _imp->evaluate(_imp->root, time, view);
+    } catch (const EvaluationError& e) {
+        *reason = e.reason;
+
+        return false;
+    }
+
+    return true;
+}
+
+NATRON_NAMESPACE_EXIT;
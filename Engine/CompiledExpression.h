@@ -0,0 +1,115 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_COMPILEDEXPRESSION_H
+#define NATRON_ENGINE_COMPILEDEXPRESSION_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+struct CompiledExpressionPrivate;
+
+/**
+ * @brief A native evaluator for the arithmetic subset of the Python expressions of knobs.
+ *
+ * Evaluating a Python expression requires the GIL, which serializes all the render threads reading expression-driven knobs.
+ * Most expressions only do arithmetic on other knobs and on the frame, so they are parsed here once and then evaluated
+ * without the interpreter. The subset is:
+ * - int and float literals, True, False, and the variables frame, view and dimension
+ * - the + - * / // % ** operators, comparisons (which may be chained), not, and, or, and x if c else y
+ * - the functions imported from the math module (sin, sqrt, floor, pi...) and the abs, min, max, int, float and round builtins
+ * - thisParam.getValue(...), getValueAtTime(...) and get(...) and the same functions on thisNode.param or Node.param,
+ * where Node is a node of the same group, with the .x/.y/.z or .r/.g/.b/.a members of the tuples returned by get()
+ *
+ * Python 2 semantics are preserved: ints and floats are distinguished, so that int / int is a floor division,
+ * and math functions return floats.
+ * Anything else is refused by compile(), and the knob keeps evaluating the expression with Python.
+ * Errors that Python would raise at evaluation time (division by zero, math domain errors, deleted parameters...) make
+ * evaluate() fail, so that the Python evaluation reports them.
+ **/
+class CompiledExpression
+{
+public:
+
+    struct Value
+    {
+        double value;
+        bool isInt; // int or bool in Python
+
+        Value()
+            : value(0.)
+            , isInt(true)
+        {
+        }
+
+        Value(double value,
+              bool isInt)
+            : value(value)
+            , isInt(isInt)
+        {
+        }
+    };
+
+    /**
+     * @brief Compiles the given single-line expression of the given dimension of thisParam. The names of the expression are
+     * resolved against the node holding thisParam and its siblings, which may be NULL in which case parameters cannot be referenced.
+     * Returns NULL and sets reason when the expression is not in the subset.
+     **/
+    static boost::shared_ptr<CompiledExpression> compile(const std::string& expression,
+                                                         const KnobPtr& thisParam,
+                                                         int dimension,
+                                                         std::string* reason);
+
+    ~CompiledExpression();
+
+    /**
+     * @brief Evaluates the expression for the given frame and view. This does not need the Python GIL and may be called
+     * concurrently from any thread. Returns false and sets reason when the expression must be evaluated by Python instead.
+     **/
+    bool evaluate(double time, ViewIdx view, Value* ret, std::string* reason) const;
+
+private:
+
+    CompiledExpression();
+
+    boost::scoped_ptr<CompiledExpressionPrivate> _imp;
+};
+
+typedef boost::shared_ptr<CompiledExpression> CompiledExpressionPtr;
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_COMPILEDEXPRESSION_H
@@ -309,6 +309,7 @@ Curve::clearKeyFrames()
     QMutexLocker l(&_imp->_lock);
 
     _imp->keyFrames.clear();
+    _imp->invalidateKeyFramesSnapshot();
 }
 
 bool
@@ -794,39 +795,114 @@ interParams(const KeyFrameSet &keyFrames,
     }
 }
 
-double
-Curve::getValueAt(double t,
-                  bool doClamp) const
+/// same as interParams, on the flat arrays of a snapshot.
+/// up is the index of the next keyframe (the first with time > t)
+static void
+interParamsFlat(const CurveKeyFramesSnapshot &snapshot,
+                double t,
+                std::size_t up,
+                double *tcur,
+                double *vcur,
+                double *vcurDerivRight,
+                KeyframeTypeEnum *interp,
+                double *tnext,
+                double *vnext,
+                double *vnextDerivLeft,
+                KeyframeTypeEnum *interpNext)
 {
-    QMutexLocker l(&_imp->_lock);
+    Q_UNUSED(t);
+    const std::vector<KeyFrame>& keys = snapshot.keys;
+    assert( up == keys.size() || t < keys[up].getTime() );
+    if (up == 0) {
+        //if all keys have a greater time
+        // get the first keyframe
+        const KeyFrame& next = keys[0];
+        *tnext = next.getTime();
+        *vnext = next.getValue();
+        *vnextDerivLeft = next.getLeftDerivative();
+        *interpNext = next.getInterpolation();
+        *tcur = *tnext - 1.;
+        *vcur = *vnext;
+        *vcurDerivRight = 0.;
+        *interp = eKeyframeTypeNone;
+    } else if ( up == keys.size() ) {
+        //if we found no key that has a greater time
+        // get the last keyframe
+        const KeyFrame& last = keys.back();
+        *tcur = last.getTime();
+        *vcur = last.getValue();
+        *vcurDerivRight = last.getRightDerivative();
+        *interp = last.getInterpolation();
+        *tnext = *tcur + 1.;
+        *vnext = *vcur;
+        *vnextDerivLeft = 0.;
+        *interpNext = eKeyframeTypeNone;
+    } else {
+        // between two keyframes
+        const KeyFrame& cur = keys[up - 1];
+        const KeyFrame& next = keys[up];
+        assert(cur.getTime() <= t);
+        *tcur = cur.getTime();
+        *vcur = cur.getValue();
+        *vcurDerivRight = cur.getRightDerivative();
+        *interp = cur.getInterpolation();
+        *tnext = next.getTime();
+        *vnext = next.getValue();
+        *vnextDerivLeft = next.getLeftDerivative();
+        *interpNext = next.getInterpolation();
+    }
+}
 
-    if ( _imp->keyFrames.empty() ) {
-        throw std::runtime_error("Curve has no control points!");
+CurveKeyFramesSnapshotPtr
+CurvePrivate::getKeyFramesSnapshot() const
+{
+    CurveKeyFramesSnapshotPtr ret = boost::atomic_load(&keyFramesSnapshot);
+
+    if (ret) {
+        return ret;
     }
 
-    double v;
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double>::const_iterator foundCached = _imp->resultCache.find(t);
-    if ( foundCached != _imp->resultCache.end() ) {
-        v = foundCached->second;
-    } else
-#endif
-    {
-        // even when there is only one keyframe, there may be tangents!
-        //if (_imp->keyFrames.size() == 1) {
-        //    //if there's only 1 keyframe, don't bother interpolating
-        //    return (*_imp->keyFrames.begin()).getValue();
-        //}
-        double tcur, tnext;
-        double vcurDerivRight, vnextDerivLeft, vcur, vnext;
-        KeyframeTypeEnum interp, interpNext;
-        KeyFrame k(t, 0.);
-        // find the first keyframe with time greater than t
-        KeyFrameSet::const_iterator itup;
-        itup = _imp->keyFrames.upper_bound(k);
-        interParams(_imp->keyFrames,
+    QMutexLocker l(&_lock);
+    // Another thread may have built it while we were waiting for the lock
+    ret = boost::atomic_load(&keyFramesSnapshot);
+    if (ret) {
+        return ret;
+    }
+
+    boost::shared_ptr<CurveKeyFramesSnapshot> snapshot(new CurveKeyFramesSnapshot);
+    snapshot->times.reserve( keyFrames.size() );
+    snapshot->keys.reserve( keyFrames.size() );
+    for (KeyFrameSet::const_iterator it = keyFrames.begin(); it != keyFrames.end(); ++it) {
+        snapshot->times.push_back( it->getTime() );
+        snapshot->keys.push_back(*it);
+    }
+    snapshot->type = (int)type;
+    snapshot->mustClamp = owner && hasYRange;
+    if (snapshot->mustClamp) {
+        Curve::YRange range = getYRange();
+        snapshot->yMin = range.min;
+        snapshot->yMax = range.max;
+    }
+    ret = snapshot;
+    boost::atomic_store(&keyFramesSnapshot, ret);
+
+    return ret;
+}
+
+double
+Curve::interpolateSnapshot(const CurveKeyFramesSnapshot& snapshot,
+                           double t,
+                           std::size_t up,
+                           bool doClamp) const
+{
+    // even when there is only one keyframe, there may be tangents!
+    double tcur, tnext;
+    double vcurDerivRight, vnextDerivLeft, vcur, vnext;
+    KeyframeTypeEnum interp, interpNext;
+
+    interParamsFlat(snapshot,
                     t,
-                    itup,
+                    up,
                     &tcur,
                     &vcur,
                     &vcurDerivRight,
@@ -836,23 +912,23 @@ Curve::getValueAt(double t,
                     &vnextDerivLeft,
                     &interpNext);
 
-        v = Interpolation::interpolate(tcur, vcur,
-                                       vcurDerivRight,
-                                       vnextDerivLeft,
-                                       tnext, vnext,
-                                       t,
-                                       interp,
-                                       interpNext);
-#ifdef NATRON_CURVE_USE_CACHE
-        _imp->resultCache[t] = v;
-#endif
-    }
-
-    if ( doClamp && mustClamp() ) {
-        v = clampValueToCurveYRange(v);
+    double v = Interpolation::interpolate(tcur, vcur,
+                                          vcurDerivRight,
+                                          vnextDerivLeft,
+                                          tnext, vnext,
+                                          t,
+                                          interp,
+                                          interpNext);
+
+    if (doClamp && snapshot.mustClamp) {
+        if (v > snapshot.yMax) {
+            v = snapshot.yMax;
+        } else if (v < snapshot.yMin) {
+            v = snapshot.yMin;
+        }
     }
 
-    switch (_imp->type) {
+    switch ( (CurvePrivate::CurveTypeEnum)snapshot.type ) {
     case CurvePrivate::eCurveTypeString:
     case CurvePrivate::eCurveTypeInt:
 
@@ -867,8 +943,53 @@ Curve::getValueAt(double t,
 
         return v;
     }
+}
+
+double
+Curve::getValueAt(double t,
+                  bool doClamp) const
+{
+    // Lock-free: render threads call this for every animated parameter
+    CurveKeyFramesSnapshotPtr snapshot = _imp->getKeyFramesSnapshot();
+
+    if ( snapshot->keys.empty() ) {
+        throw std::runtime_error("Curve has no control points!");
+    }
+
+    // find the first keyframe with time greater than t
+    std::size_t up = std::upper_bound(snapshot->times.begin(), snapshot->times.end(), t) - snapshot->times.begin();
+
+    return interpolateSnapshot(*snapshot, t, up, doClamp);
 } // getValueAt
 
+void
+Curve::getValuesAt(const double* times,
+                   double* values,
+                   std::size_t count,
+                   bool doClamp) const
+{
+    CurveKeyFramesSnapshotPtr snapshot = _imp->getKeyFramesSnapshot();
+
+    if ( snapshot->keys.empty() ) {
+        throw std::runtime_error("Curve has no control points!");
+    }
+
+    const std::vector<double>& keyTimes = snapshot->times;
+    std::size_t up = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        double t = times[i];
+        if ( (i == 0) || (t < times[i - 1]) ) {
+            up = std::upper_bound(keyTimes.begin(), keyTimes.end(), t) - keyTimes.begin();
+        } else {
+            // times are usually increasing (curve editor, motion blur samples): walk forward from the previous keyframe
+            while ( up < keyTimes.size() && keyTimes[up] <= t ) {
+                ++up;
+            }
+        }
+        values[i] = interpolateSnapshot(*snapshot, t, up, doClamp);
+    }
+}
+
 double
 Curve::getDerivativeAt(double t) const
 {
@@ -1042,32 +1163,39 @@ Curve::YRange Curve::getCurveYRange() const
     if ( !mustClamp() ) {
         return YRange( -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() );
     }
-    if (_imp->owner) {
-        Knob<double>* isDouble = dynamic_cast<Knob<double>*>(_imp->owner);
-        Knob<int>* isInt = dynamic_cast<Knob<int>*>(_imp->owner);
+
+    return _imp->getYRange();
+}
+
+Curve::YRange
+CurvePrivate::getYRange() const
+{
+    if (owner) {
+        Knob<double>* isDouble = dynamic_cast<Knob<double>*>(owner);
+        Knob<int>* isInt = dynamic_cast<Knob<int>*>(owner);
         if (isDouble) {
-            double min = isDouble->getMinimum(_imp->dimensionInOwner);
+            double min = isDouble->getMinimum(dimensionInOwner);
             if (min <= -DBL_MAX) {
                 min = -std::numeric_limits<double>::infinity();
             }
-            double max = isDouble->getMaximum(_imp->dimensionInOwner);
+            double max = isDouble->getMaximum(dimensionInOwner);
             if (max >= DBL_MAX) {
                 max = std::numeric_limits<double>::infinity();
             }
 
-            return YRange(min, max);
+            return Curve::YRange(min, max);
         } else if (isInt) {
-            double min = isInt->getMinimum(_imp->dimensionInOwner);
-            double max = isInt->getMaximum(_imp->dimensionInOwner);
+            double min = isInt->getMinimum(dimensionInOwner);
+            double max = isInt->getMaximum(dimensionInOwner);
 
-            return YRange(min, max);
+            return Curve::YRange(min, max);
         } else {
-            return YRange( (double)INT_MIN, (double)INT_MAX );
+            return Curve::YRange( (double)INT_MIN, (double)INT_MAX );
         }
     }
-    assert( hasYRange() );
+    assert(hasYRange);
 
-    return YRange(_imp->yMin, _imp->yMax);
+    return Curve::YRange(yMin, yMax);
 }
 
 double
@@ -1080,7 +1208,7 @@ Curve::clampValueToCurveYRange(double v) const
     if (v > minmax.max) {
         return minmax.max;
     } else if (v < minmax.min) {
-        return minmax.max;
+        return minmax.min;
     }
 
     return v;
@@ -1584,6 +1712,15 @@ Curve::setYRange(double yMin,
     _imp->yMin = yMin;
     _imp->yMax = yMax;
     _imp->hasYRange = true;
+    _imp->invalidateKeyFramesSnapshot();
+}
+
+void
+Curve::onOwnerMinMaxChanged()
+{
+    QMutexLocker l(&_imp->_lock);
+
+    _imp->invalidateKeyFramesSnapshot();
 }
 
 bool
@@ -1607,9 +1744,7 @@ Curve::onCurveChanged()
     if (_imp->owner) {
         _imp->owner->clearExpressionsResults(_imp->dimensionInOwner);
     }
-#ifdef NATRON_CURVE_USE_CACHE
-    _imp->resultCache.clear();
-#endif
+    _imp->invalidateKeyFramesSnapshot();
 }
 
 NATRON_NAMESPACE_EXIT;
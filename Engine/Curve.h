@@ -128,6 +128,7 @@ typedef std::set<KeyFrame, KeyFrame_compare_time> KeyFrameSet;
 
 
 struct CurvePrivate;
+struct CurveKeyFramesSnapshot;
 
 class Curve
 {
@@ -237,8 +238,19 @@ public:
 
     double getMaximumTimeCovered() const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Interpolates the curve at the given time. This does not take the curve lock
+     * and may be called concurrently by any thread.
+     **/
     double getValueAt(double t, bool clamp = true) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Same as calling getValueAt for each of the count times, but the keyframes are read once for all
+     * the times and consecutive increasing times do not need a search. All the values are computed from the same
+     * version of the curve, even if it is modified concurrently.
+     **/
+    void getValuesAt(const double* times, double* values, std::size_t count, bool clamp = true) const;
+
     double getDerivativeAt(double t) const WARN_UNUSED_RETURN;
 
     double getIntegrateFromTo(double t1, double t2) const WARN_UNUSED_RETURN;
@@ -291,6 +303,9 @@ public:
     /// set the curve Y range (used for testing, when the Curve his not owned by a Knob)
     void setYRange(double yMin, double yMax);
 
+    /// called when the minimum or maximum of the owner knob changed, since they are the Y range of the curve
+    void onOwnerMinMaxChanged();
+
     static KeyFrameSet::const_iterator findWithTime(const KeyFrameSet& keys, double time);
 
 private:
@@ -303,12 +318,14 @@ private:
     KeyFrameSet::const_iterator atIndex(int index) const WARN_UNUSED_RETURN;
     KeyFrameSet::const_iterator begin() const WARN_UNUSED_RETURN;
     KeyFrameSet::const_iterator end() const WARN_UNUSED_RETURN;
-    YRange getCurveYRange_internal() const WARN_UNUSED_RETURN;
 
     void removeKeyFrame(KeyFrameSet::const_iterator it);
 
     double clampValueToCurveYRange(double v) const WARN_UNUSED_RETURN;
 
+    ///up is the index of the first keyframe of the snapshot with a time greater than t
+    double interpolateSnapshot(const CurveKeyFramesSnapshot& snapshot, double t, std::size_t up, bool clamp) const WARN_UNUSED_RETURN;
+
     ///returns an iterator to the new keyframe in the keyframe set and
     ///a boolean indicating whether it removed a keyframe already existing at this time or not
     std::pair<KeyFrameSet::iterator, bool> addKeyFrameNoUpdate(const KeyFrame & cp) WARN_UNUSED_RETURN;
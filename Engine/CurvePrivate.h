@@ -27,6 +27,8 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
+
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #endif
@@ -39,10 +41,34 @@
 #include "Engine/KnobFile.h"
 #include "Engine/EngineFwd.h"
 
-//#define NATRON_CURVE_USE_CACHE
-
 NATRON_NAMESPACE_ENTER;
 
+/**
+ * @brief An immutable copy of the keyframes of a curve, stored in flat arrays sorted by time.
+ * Render threads interpolate the curve from the current snapshot without taking the curve lock:
+ * any change to the curve discards the snapshot and the next reader builds a new one.
+ **/
+struct CurveKeyFramesSnapshot
+{
+    std::vector<double> times; //< the time of each keyframe, for the binary searches
+    std::vector<KeyFrame> keys;
+    int type; //< CurvePrivate::CurveTypeEnum
+    bool mustClamp;
+    double yMin, yMax; //< the range values are clamped to if mustClamp
+
+    CurveKeyFramesSnapshot()
+        : times()
+        , keys()
+        , type(0)
+        , mustClamp(false)
+        , yMin(0.)
+        , yMax(0.)
+    {
+    }
+};
+
+typedef boost::shared_ptr<const CurveKeyFramesSnapshot> CurveKeyFramesSnapshotPtr;
+
 struct CurvePrivate
 {
     enum CurveTypeEnum
@@ -57,9 +83,8 @@ struct CurvePrivate
 
     KeyFrameSet keyFrames;
 
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double> resultCache; //< a cache for interpolations
-#endif
+    ///Only accessed with boost::atomic_load/atomic_store, NULL when it must be rebuilt from keyFrames
+    mutable CurveKeyFramesSnapshotPtr keyFramesSnapshot;
 
     KnobI* owner;
     int dimensionInOwner;
@@ -73,9 +98,7 @@ struct CurvePrivate
 
     CurvePrivate()
         : keyFrames()
-#ifdef NATRON_CURVE_USE_CACHE
-        , resultCache()
-#endif
+        , keyFramesSnapshot()
         , owner(NULL)
         , dimensionInOwner(-1)
         , type(eCurveTypeDouble)
@@ -107,7 +130,26 @@ struct CurvePrivate
         yMin = other.yMin;
         yMax = other.yMax;
         hasYRange = other.hasYRange;
+        invalidateKeyFramesSnapshot();
     }
+
+    /**
+     * @brief Must be called with _lock held whenever keyFrames, type or the Y range change
+     **/
+    void invalidateKeyFramesSnapshot()
+    {
+        boost::atomic_store( &keyFramesSnapshot, CurveKeyFramesSnapshotPtr() );
+    }
+
+    /**
+     * @brief Returns the current snapshot of the keyframes, building it if needed. Only takes _lock if it must be built.
+     **/
+    CurveKeyFramesSnapshotPtr getKeyFramesSnapshot() const;
+
+    /**
+     * @brief Returns the range the values of the curve are clamped to. Must be called with _lock held
+     **/
+    Curve::YRange getYRange() const;
 };
 
 NATRON_NAMESPACE_EXIT;
@@ -73,6 +73,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/PluginMemory.h"
 #include "Engine/Project.h"
 #include "Engine/RenderStats.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/ReadNode.h"
@@ -1594,6 +1595,9 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
 {
     ImageList cachedImages;
     bool isCached = false;
+    RenderTrace::Scope traceScope( "cache", "cacheLookup", this, key.getTime(), key.getView() );
+
+    traceScope.addArg("mipMapLevel", mipMapLevel);
 
     ///Find first something in the input images list
     if ( !inputImages.empty() ) {
@@ -1620,7 +1624,9 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
         }
     }
 
-    if (stats && stats->isInDepthProfilingEnabled() && !isCached) {
+    traceScope.addArg("cached", isCached);
+
+    if (stats && !isCached) {
         stats->addCacheInfosForNode(getNode(), true, false);
     }
 
@@ -1779,7 +1785,7 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
                 *image = imageToConvert;
             }
             //assert(imageToConvert->getBounds().contains(bounds));
-            if ( stats && stats->isInDepthProfilingEnabled() ) {
+            if (stats) {
                 stats->addCacheInfosForNode(getNode(), false, true);
             }
         } else if (*image) { //  else if (imageToConvert && !*image)
@@ -1808,11 +1814,11 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
                 }
             }
 
-            if ( stats && stats->isInDepthProfilingEnabled() ) {
+            if (stats) {
                 stats->addCacheInfosForNode(getNode(), false, false);
             }
         } else {
-            if ( stats && stats->isInDepthProfilingEnabled() ) {
+            if (stats) {
                 stats->addCacheInfosForNode(getNode(), true, false);
             }
         }
@@ -2098,8 +2104,10 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
 {
     ///Make the thread-storage live as long as the render action is called if we're in a newly launched thread in eRenderSafetyFullySafeFrame mode
     QThread* curThread = QThread::currentThread();
+    ///The thread that started the tiles renders some of them itself while waiting for the others, it already has its TLS
+    const bool isSpawnedThread = callingThread != curThread;
 
-    if (callingThread != curThread) {
+    if (isSpawnedThread) {
         ///We are in the case of host frame threading, see kOfxImageEffectPluginPropHostFrameThreading
         ///We know that in the renderAction, TLS will be needed, so we do a deep copy of the TLS from the caller thread
         ///to this thread
@@ -2128,11 +2136,22 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
                                                                         args.planes);
 
     //Exit of the host frame threading thread
-    appPTR->getAppTLS()->cleanupTLSForThread();
+    if (isSpawnedThread) {
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
 
     return ret;
 }
 
+void
+EffectInstance::Implementation::tiledRenderingTask(TiledRenderingFunctorArgs* args,
+                                                   const RectToRender* specificData,
+                                                   QThread* callingThread,
+                                                   RenderingFunctorRetEnum* ret)
+{
+    *ret = tiledRenderingFunctor(*args, *specificData, callingThread);
+}
+
 EffectInstance::RenderingFunctorRetEnum
 EffectInstance::Implementation::tiledRenderingFunctor(const RectToRender & rectToRender,
                                                       const bool renderFullScaleThenDownscale,
@@ -2426,6 +2445,10 @@ EffectInstance::Implementation::renderHandler(const EffectDataTLSPtr& tls,
     const EffectInstance::PlaneToRender & firstPlane = planes.planes.begin()->second;
     const double time = tls->currentRenderArgs.time;
     const ViewIdx view = tls->currentRenderArgs.view;
+    RenderTrace::Scope traceScope("render", "render", _publicInterface, time, view);
+
+    traceScope.addArg("rect", renderMappedRectToRender);
+    traceScope.addArg("mipMapLevel", mipMapLevel);
 
     // at this point, it may be unnecessary to call render because it was done a long time ago => check the bitmap here!
 # ifndef NDEBUG
@@ -2724,7 +2747,9 @@ EffectInstance::Implementation::renderHandler(const EffectDataTLSPtr& tls,
             }
         }
 
+        TimeLapse renderActionTimer;
         StatusEnum st = _publicInterface->render_public(actionArgs);
+        double renderActionTime = renderActionTimer.getTimeSinceCreation();
 
         if (planes.useOpenGL) {
             glDisable(GL_SCISSOR_TEST);
@@ -2738,6 +2763,11 @@ EffectInstance::Implementation::renderHandler(const EffectDataTLSPtr& tls,
 
         renderAborted = _publicInterface->aborted();
 
+        if ( (st == eStatusOK) && !renderAborted && !planes.useOpenGL ) {
+            // GPU renders are asynchronous and their time cannot be compared to CPU tiles
+            _publicInterface->getNode()->getTilingHistory()->addTileRenderTime(actionArgs.roi, renderActionTime);
+        }
+
         /*
          * Since new planes can have been allocated on the fly by allocateImagePlaneAndSetInThreadLocalStorage(), refresh
          * the planes map from the thread local storage once the render action is finished
@@ -3053,6 +3083,9 @@ EffectInstance::onSignificantEvaluateAboutToBeCalled(KnobI* knob)
 
     bool isMT = QThread::currentThread() == qApp->thread();
 
+    if (isMT) {
+        getApp()->getProject()->journalNodeChanged(node);
+    }
     if ( isMT && ( !knob || knob->getEvaluateOnChange() ) ) {
         getApp()->triggerAutoSave();
     }
@@ -3729,6 +3762,8 @@ EffectInstance::isIdentity_public(bool useIdentityCache, // only set to true whe
     ///EDIT: We now allow isIdentity to be called recursively.
     RECURSIVE_ACTION();
 
+    RenderTrace::Scope traceScope("action", "isIdentity", this, time, view);
+
 
     bool ret = false;
     boost::shared_ptr<RotoDrawableItem> rotoItem = getNode()->getAttachedRotoItem();
@@ -3847,7 +3882,7 @@ EffectInstance::getRegionOfDefinition_public(U64 hash,
         RenderScale scaleOne(1.);
         {
             RECURSIVE_ACTION();
-
+            RenderTrace::Scope traceScope("action", "getRegionOfDefinition", this, time, view);
 
             ret = getRegionOfDefinition(hash, time, supportsRenderScaleMaybe() == eSupportsNo ? scaleOne : scale, view, rod);
 
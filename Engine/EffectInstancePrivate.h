@@ -320,6 +320,12 @@ public:
     RenderingFunctorRetEnum tiledRenderingFunctor(TiledRenderingFunctorArgs & args,  const RectToRender & specificData,
                                                   QThread* callingThread);
 
+    /**
+     * @brief Same as tiledRenderingFunctor, for the tasks of the RenderThreadPool: the return code is written in ret.
+     **/
+    void tiledRenderingTask(TiledRenderingFunctorArgs* args, const RectToRender* specificData,
+                            QThread* callingThread, RenderingFunctorRetEnum* ret);
+
     RenderingFunctorRetEnum tiledRenderingFunctor(const RectToRender & rectToRender,
                                                   const bool renderFullScaleThenDownscale,
                                                   const bool isSequentialRender,
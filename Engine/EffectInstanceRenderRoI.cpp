@@ -34,11 +34,8 @@
 
 #include <boost/scoped_ptr.hpp>
 
-#include <QtCore/QThreadPool>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QCoreApplication>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
-#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -65,6 +62,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxImageEffectInstance.h"
+#include "Engine/OutputEffectInstance.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/GPUContextPool.h"
@@ -74,10 +72,12 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/Settings.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/Timer.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerInstance.h"
+#include "Engine/WritersRenderGroup.h"
 
 //#define NATRON_ALWAYS_ALLOCATE_FULL_IMAGE_BOUNDS
 
@@ -163,6 +163,66 @@ optimizeRectsToRender(EffectInstance* self,
     }
 } // optimizeRectsToRender
 
+/**
+ * @brief Split the rectangles to render that are not identity in tiles rendered concurrently by the RenderThreadPool.
+ * The tiles count and shape depend on the time the render action of the node took so far, see NodeTilingHistory::splitIntoTiles.
+ * The input images and regions of interest were computed for the whole rectangles and are shared by their tiles.
+ **/
+static void
+splitRectsToRenderInTiles(EffectInstance* self,
+                          const boost::shared_ptr<RenderStats>& stats,
+                          const NodePtr& treeRoot,
+                          std::list<EffectInstance::RectToRender>* rectsToRender)
+{
+    NodePtr node = self->getNode();
+    NodeTilingHistory* history = node->getTilingHistory();
+    int nThreads = appPTR->getRenderThreadPool()->getMaxThreadCount();
+
+    // During a playback or a render on disk, the frames rendered concurrently share the threads of the pool
+    // as decided by the threads planner of the scheduler
+    NodePtr outputNode;
+#ifdef NATRON_ENABLE_IO_META_NODES
+    outputNode = treeRoot ? treeRoot->getIOContainer() : NodePtr();
+#endif
+    if (!outputNode) {
+        outputNode = treeRoot;
+    }
+    OutputEffectInstance* output = outputNode ? dynamic_cast<OutputEffectInstance*>( outputNode->getEffectInstance().get() ) : 0;
+    boost::shared_ptr<RenderEngine> engine = output ? output->getRenderEngine() : boost::shared_ptr<RenderEngine>();
+    if (engine) {
+        int nTileThreads = engine->getThreadsPlan().nbTileThreads;
+        if (nTileThreads > 0) {
+            nThreads = std::min(nThreads, nTileThreads);
+        }
+    }
+
+    const bool profileTiling = stats && stats->isInDepthProfilingEnabled();
+    std::list<EffectInstance::RectToRender> tiledRects;
+    std::vector<RectI> tiles;
+
+    for (std::list<EffectInstance::RectToRender>::const_iterator it = rectsToRender->begin(); it != rectsToRender->end(); ++it) {
+        if (it->isIdentity) {
+            tiledRects.push_back(*it);
+            continue;
+        }
+        TilingPolicyEnum policy = history->splitIntoTiles(it->rect, nThreads, &tiles);
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            EffectInstance::RectToRender r = *it;
+            r.rect = tiles[i];
+            tiledRects.push_back(r);
+        }
+        if (profileTiling) {
+            NodeTilingInfos infos;
+            infos.rect = it->rect;
+            infos.policy = policy;
+            infos.nbTiles = (int)tiles.size();
+            infos.timePerPixel = history->getTimePerPixel();
+            stats->addTilingInfosForNode(node, infos);
+        }
+    }
+    rectsToRender->swap(tiledRects);
+} // splitRectsToRenderInTiles
+
 ImagePtr
 EffectInstance::convertPlanesFormatsIfNeeded(const AppInstPtr& app,
                                              const ImagePtr& inputImage,
@@ -816,6 +876,17 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         // in Analysis, the node upstream of te analysis node should always cache
         createInCache = (frameArgs->isAnalysis && frameArgs->treeRoot->getEffectInstance().get() == args.caller) ? true : shouldCacheOutput(isFrameVaryingOrAnimated, args.time, args.view, frameArgs->visitsCount);
     }
+
+    /*
+     * The bitdepth of the images we store in the cache. If the user asked for it, 32-bit float images are stored as
+     * 16-bit half images: the plug-in still renders in float (see the temporary image in renderRoIInternal) and the
+     * image is converted back to float at the end of this function.
+     */
+    ImageBitDepthEnum cacheDepth = args.bitdepth;
+    if ( createInCache && (args.bitdepth == eImageBitDepthFloat) && (storage == eStorageModeRAM) && !renderFullScaleThenDownscale &&
+         !isPaintingOverItselfEnabled() && appPTR->getCurrentSettings()->isCacheFloatImagesAsHalfEnabled() ) {
+        cacheDepth = eImageBitDepthHalf;
+    }
     ///Do we want to render the graph upstream at scale 1 or at the requested render scale ? (user setting)
     bool renderScaleOneUpstreamIfRenderScaleSupportDisabled = false;
     if (renderFullScaleThenDownscale) {
@@ -893,7 +964,7 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
                     getImageFromCacheAndConvertIfNeeded(createInCache, storage, args.returnStorage, n == 0 ? *nonDraftKey : *key, renderMappedMipMapLevel,
                                                         renderFullScaleThenDownscale ? &upscaledImageBounds : &downscaledImageBounds,
                                                         &rod, roi,
-                                                        args.bitdepth, *it,
+                                                        cacheDepth, *it,
                                                         args.inputImagesList,
                                                         frameArgs->stats,
                                                         glContextLocker,
@@ -1295,7 +1366,7 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
             getImageFromCacheAndConvertIfNeeded(createInCache, storage, args.returnStorage, *key, renderMappedMipMapLevel,
                                                 renderFullScaleThenDownscale ? &upscaledImageBounds : &downscaledImageBounds,
                                                 &rod, roi,
-                                                args.bitdepth, it->first,
+                                                cacheDepth, it->first,
                                                 args.inputImagesList, frameArgs->stats, glContextLocker, &it->second.fullscaleImage);
 
             ///We must retrieve from the cache exactly the originally retrieved image, otherwise we might have to call  renderInputImagesForRoI
@@ -1419,7 +1490,7 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
                                    upscaledImageBounds,
                                    isProjectFormat,
                                    *components,
-                                   args.bitdepth,
+                                   cacheDepth,
                                    planesToRender->outputPremult,
                                    fieldingOrder,
                                    par,
@@ -1760,6 +1831,19 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
             }
         }
 
+        // Freshly rendered cached images are written to the persistent node cache, if enabled and once complete
+        if ( createInCache && hasSomethingToRender && !isDuringPaintStroke && (renderRetCode != eRenderRoIStatusRenderFailed) ) {
+            appPTR->persistImageIfNeeded(it->second.fullscaleImage);
+        }
+
+        // When rendered for several writers rendered together, keep the image in the cache until they all used it
+        if ( createInCache && (renderRetCode != eRenderRoIStatusRenderFailed) ) {
+            WritersRenderGroupPtr writersGroup = getNode()->getWritersRenderGroup();
+            if (writersGroup) {
+                writersGroup->pinImage(getNode().get(), it->second.fullscaleImage);
+            }
+        }
+
         //We have to return the downscale image, so make sure it has been computed
         if ( (renderRetCode != eRenderRoIStatusRenderFailed) &&
              renderFullScaleThenDownscale &&
@@ -1930,6 +2014,8 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
     ///If the project lock is already locked at this point, don't start any other thread
     ///as it would lead to a deadlock when the project is loading.
     ///Just fall back to Fully_safe
+    ///Tiles are rendered by the work-stealing RenderThreadPool: the thread waiting for the tiles renders them too,
+    ///so there is no need to fall back to a single thread when all the threads of the pool are busy.
     int nbThreads = appPTR->getCurrentSettings()->getNumberOfThreads();
     if (safety == eRenderSafetyFullySafeFrame) {
         ///If the plug-in is eRenderSafetyFullySafeFrame that means it wants the host to perform SMP aka slice up the RoI into chunks
@@ -1937,13 +2023,16 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
         ///Also check that the number of threads indicating by the settings are appropriate for this render mode.
         if ( !frameArgs->tilesSupported || (nbThreads == -1) || (nbThreads == 1) ||
              ( (nbThreads == 0) && (appPTR->getHardwareIdealThreadCount() == 1) ) ||
-             ( QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount() ) ||
              self->isRotoPaintNode() ) {
             safety = eRenderSafetyFullySafe;
         }
     }
 
 
+    if ( (safety == eRenderSafetyFullySafeFrame) && !planesToRender->useOpenGL ) {
+        splitRectsToRenderInTiles(self, frameArgs->stats, frameArgs->treeRoot, &planesToRender->rectsToRender);
+    }
+
     boost::shared_ptr<std::map<NodePtr, boost::shared_ptr<ParallelRenderArgs> > > tlsCopy;
     if (safety == eRenderSafetyFullySafeFrame) {
         tlsCopy.reset(new std::map<NodePtr, boost::shared_ptr<ParallelRenderArgs> >);
@@ -1991,6 +2080,7 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
             QThread* currentThread = QThread::currentThread();
             boost::scoped_ptr<Implementation::TiledRenderingFunctorArgs> tiledArgs(new Implementation::TiledRenderingFunctorArgs);
             tiledArgs->renderFullScaleThenDownscale = renderFullScaleThenDownscale;
+            tiledArgs->isSequentialRender = isSequentialRender;
             tiledArgs->isRenderResponseToUserInteraction = isRenderMadeInResponseToUserInteraction;
             tiledArgs->firstFrame = firstFrame;
             tiledArgs->lastFrame = lastFrame;
@@ -2022,14 +2112,24 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
 #else
 
 
-            QFuture<RenderingFunctorRetEnum> ret = QtConcurrent::mapped( planesToRender->rectsToRender,
-                                                                         boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
-                                                                                     self->_imp.get(),
-                                                                                     *tiledArgs,
-                                                                                     _1,
-                                                                                     currentThread) );
-            ret.waitForFinished();
-            QFuture<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
+            std::vector<EffectInstance::RenderingFunctorRetEnum> ret( planesToRender->rectsToRender.size() );
+            {
+                RenderThreadPool* pool = appPTR->getRenderThreadPool();
+                RenderThreadPool::TaskGroup tiles;
+                int i = 0;
+                for (std::list<RectToRender>::const_iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it, ++i) {
+                    pool->startTask( &tiles, boost::bind(&EffectInstance::Implementation::tiledRenderingTask,
+                                                         self->_imp.get(),
+                                                         tiledArgs.get(),
+                                                         &(*it),
+                                                         currentThread,
+                                                         &ret[i]) );
+                }
+                if ( !pool->waitForGroup(&tiles) ) {
+                    renderStatus = eRenderingFunctorRetFailed;
+                }
+            }
+            std::vector<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
 
 #endif
             for (it2 = ret.begin(); it2 != ret.end(); ++it2) {
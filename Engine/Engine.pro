@@ -78,6 +78,7 @@ SOURCES += \
     BlockingBackgroundRender.cpp \
     Cache.cpp \
     CLArgs.cpp \
+    CompiledExpression.cpp \
     CoonsRegularization.cpp \
     Curve.cpp \
     CurveSerialization.cpp \
@@ -121,6 +122,7 @@ SOURCES += \
     LibraryBinary.cpp \
     Log.cpp \
     Lut.cpp \
+    LutSIMD.cpp \
     Markdown.cpp \
     MemoryFile.cpp \
     Node.cpp \
@@ -145,11 +147,14 @@ SOURCES += \
     OutputEffectInstance.cpp \
     OutputSchedulerThread.cpp \
     ParallelRenderArgs.cpp \
+    PersistentImageStore.cpp \
     Plugin.cpp \
     PluginMemory.cpp \
     PrecompNode.cpp \
     ProcessHandler.cpp \
     Project.cpp \
+    ProjectBinaryArchive.cpp \
+    ProjectJournal.cpp \
     ProjectPrivate.cpp \
     ProjectSerialization.cpp \
     PyAppInstance.cpp \
@@ -163,14 +168,17 @@ SOURCES += \
     RectD.cpp \
     RectI.cpp \
     RenderStats.cpp \
+    RenderTrace.cpp \
     RotoContext.cpp \
     RotoDrawableItem.cpp \
     RotoItem.cpp \
     RotoLayer.cpp \
     RotoPaint.cpp \
     RotoPaintInteract.cpp \
+    RotoRasterizer.cpp \
     RotoSmear.cpp \
     RotoStrokeItem.cpp \
+    RotoStrokeRasterizer.cpp \
     RotoUndoCommand.cpp \
     ScriptObject.cpp \
     Settings.cpp \
@@ -192,6 +200,7 @@ SOURCES += \
     Transform.cpp \
     ViewerInstance.cpp \
     WriteNode.cpp \
+    WritersRenderGroup.cpp \
     ../Global/glad_source.c \
     ../Global/ProcInfo.cpp \
     ../libs/SequenceParsing/SequenceParsing.cpp \
@@ -256,6 +265,7 @@ HEADERS += \
     BufferableObject.h \
     CLArgs.h \
     Cache.h \
+    CompiledExpression.h \
     CacheEntry.h \
     CacheEntryHolder.h \
     CacheSerialization.h \
@@ -290,6 +300,7 @@ HEADERS += \
     GPUContextPool.h \
     GroupInput.h \
     GroupOutput.h \
+    Half.h \
     Hash64.h \
     HistogramCPU.h \
     HostOverlaySupport.h \
@@ -315,6 +326,7 @@ HEADERS += \
     LogEntry.h \
     LRUHashTable.h \
     Lut.h \
+    LutSIMD.h \
     Markdown.h \
     MemoryFile.h \
     MergingEnum.h \
@@ -345,12 +357,15 @@ HEADERS += \
     OutputSchedulerThread.h \
     OverlaySupport.h \
     ParallelRenderArgs.h \
+    PersistentImageStore.h \
     Plugin.h \
     PluginActionShortcut.h \
     PluginMemory.h \
     PrecompNode.h \
     ProcessHandler.h \
     Project.h \
+    ProjectBinaryArchive.h \
+    ProjectJournal.h \
     ProjectPrivate.h \
     ProjectSerialization.h \
     PyAppInstance.h \
@@ -367,6 +382,7 @@ HEADERS += \
     RectI.h \
     RectISerialization.h \
     RenderStats.h \
+    RenderTrace.h \
     RotoContext.h \
     RotoContextPrivate.h \
     RotoContextSerialization.h \
@@ -379,9 +395,11 @@ HEADERS += \
     RotoPaint.h \
     RotoPaintInteract.h \
     RotoPoint.h \
+    RotoRasterizer.h \
     RotoSmear.h \
     RotoStrokeItem.h \
     RotoStrokeItemSerialization.h \
+    RotoStrokeRasterizer.h \
     RotoUndoCommand.h \
     ScriptObject.h \
     Settings.h \
@@ -415,6 +433,7 @@ HEADERS += \
     ViewerInstancePrivate.h \
     ViewIdx.h \
     WriteNode.h \
+    WritersRenderGroup.h \
     ../Global/Enums.h \
     ../Global/GitVersion.h \
     ../Global/glad_include.h \
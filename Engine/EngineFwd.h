@@ -114,6 +114,7 @@ class BufferableObject;
 class CLArgs;
 class CacheEntryHolder;
 class CacheSignalEmitter;
+struct CacheStatistics;
 struct CreateNodeArgs;
 class ChoiceExtraData;
 class Curve;
@@ -169,6 +170,7 @@ class NodeGuiI;
 class NodeMetadata;
 class NodeSerialization;
 class NodeSettingsPanel;
+class NodeTilingHistory;
 class OSGLContext;
 class OSGLContextAttacher;
 struct GLRendererID;
@@ -186,6 +188,8 @@ class OpenGLViewerI;
 class OutputEffectInstance;
 class OverlaySupport;
 class ParallelRenderArgsSetter;
+struct ParametricPoint;
+class PersistentImageStore;
 class Plugin;
 class PluginGroupNode;
 class PluginMemory;
@@ -194,11 +198,15 @@ class ProcessHandler;
 class ProcessInputChannel;
 class Project;
 struct ProjectBeingLoadedInfo;
+class ProjectBinaryArchiveReader;
+class ProjectBinaryArchiveWriter;
 class ProjectSerialization;
 class RectD;
 class RectI;
 class RenderEngine;
+class RenderThreadPool;
 class RenderStats;
+struct RenderThreadsPlan;
 class RenderingFlagSetter;
 class RotoContext;
 class RotoPaint;
@@ -225,6 +233,7 @@ class UndoCommand;
 class ViewerInstance;
 class ViewerCurrentFrameRequestSchedulerStartArgs;
 class ViewIdx;
+class WritersRenderGroup;
 namespace Color {
 class Lut;
 }
@@ -297,6 +306,7 @@ typedef boost::shared_ptr<Image> ImagePtr;
 typedef std::list<ImagePtr> ImageList;
 typedef boost::shared_ptr<Texture> GLTexturePtr;
 typedef boost::shared_ptr<FrameEntry> FrameEntryPtr;
+typedef boost::shared_ptr<WritersRenderGroup> WritersRenderGroupPtr;
 NATRON_NAMESPACE_EXIT;
 
 #endif // Engine_EngineFwd_h
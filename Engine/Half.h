@@ -0,0 +1,199 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_HALF_H
+#define NATRON_ENGINE_HALF_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstring>
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief A 16-bit IEEE 754 floating point value (1 sign bit, 5 exponent bits, 10 mantissa bits), as found in
+ * OpenEXR and in OpenFX kOfxBitDepthHalf images. This is the pixel type of eImageBitDepthHalf images.
+ * It converts implicitly from and to float so that the pixel processing templates can be used with it:
+ * all arithmetic is done in float, only the storage is 16-bit.
+ * Conversions from float round to the nearest even value, overflows give infinities and NaNs are kept
+ * (the same results as the F16C instructions). Scan-lines should rather be converted with
+ * Color::halfToFloatRow and Color::floatToHalfRow from LutSIMD.h.
+ **/
+class Half
+{
+public:
+
+    Half()
+        : _bits(0)
+    {
+    }
+
+    Half(float f)
+        : _bits( floatToBits(f) )
+    {
+    }
+
+    operator float() const
+    {
+        return bitsToFloat(_bits);
+    }
+
+    Half& operator+=(float f)
+    {
+        _bits = floatToBits(bitsToFloat(_bits) + f);
+
+        return *this;
+    }
+
+    Half& operator-=(float f)
+    {
+        _bits = floatToBits(bitsToFloat(_bits) - f);
+
+        return *this;
+    }
+
+    Half& operator*=(float f)
+    {
+        _bits = floatToBits(bitsToFloat(_bits) * f);
+
+        return *this;
+    }
+
+    Half& operator/=(float f)
+    {
+        _bits = floatToBits(bitsToFloat(_bits) / f);
+
+        return *this;
+    }
+
+    unsigned short bits() const
+    {
+        return _bits;
+    }
+
+    void setBits(unsigned short bits)
+    {
+        _bits = bits;
+    }
+
+    static Half fromBits(unsigned short bits)
+    {
+        Half h;
+
+        h._bits = bits;
+
+        return h;
+    }
+
+    static unsigned short floatToBits(float f)
+    {
+        unsigned int x;
+
+        std::memcpy( &x, &f, sizeof(float) );
+
+        unsigned int sign = (x >> 16) & 0x8000;
+        unsigned int absx = x & 0x7fffffff;
+
+        if (absx >= 0x7f800000) {
+            // Inf or NaN. NaNs are made quiet and keep their 10 highest mantissa bits
+            if (absx > 0x7f800000) {
+                return (unsigned short)( sign | 0x7e00 | ( (absx >> 13) & 0x3ff ) );
+            }
+
+            return (unsigned short)(sign | 0x7c00);
+        }
+        if (absx >= 0x477ff000) {
+            // >= 65520 rounds to infinity
+            return (unsigned short)(sign | 0x7c00);
+        }
+        if (absx < 0x38800000) {
+            // Below the smallest normal half (2^-14): denormal half, or 0 below 2^-25
+            if (absx < 0x33000000) {
+                return (unsigned short)sign;
+            }
+            unsigned int e = absx >> 23;
+            unsigned int m = (absx & 0x7fffff) | 0x800000;
+            unsigned int shift = 126 - e;
+            unsigned int r = m >> shift;
+            unsigned int rem = m & ( (1u << shift) - 1 );
+            unsigned int halfway = 1u << (shift - 1);
+            if ( ( rem > halfway) || ( (rem == halfway) && (r & 1) ) ) {
+                ++r;
+            }
+
+            return (unsigned short)(sign | r);
+        }
+        // Normal: rebias the exponent and round the mantissa to nearest even. A carry goes into the exponent.
+        unsigned int r = (absx - 0x38000000) >> 13;
+        unsigned int rem = absx & 0x1fff;
+        if ( ( rem > 0x1000) || ( (rem == 0x1000) && (r & 1) ) ) {
+            ++r;
+        }
+
+        return (unsigned short)(sign | r);
+    } // floatToBits
+
+    static float bitsToFloat(unsigned short h)
+    {
+        unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+        int exponent = (h >> 10) & 0x1f;
+        unsigned int mantissa = h & 0x3ff;
+        unsigned int x;
+
+        if (exponent == 0) {
+            if (mantissa == 0) {
+                x = sign;
+            } else {
+                // Denormal half, normal float
+                exponent = 1;
+                while ( !(mantissa & 0x400) ) {
+                    mantissa <<= 1;
+                    --exponent;
+                }
+                mantissa &= 0x3ff;
+                x = sign | ( (unsigned int)(exponent + 112) << 23 ) | (mantissa << 13);
+            }
+        } else if (exponent == 31) {
+            // Inf or NaN, NaNs are made quiet
+            x = sign | 0x7f800000 | (mantissa << 13);
+            if (mantissa) {
+                x |= 0x400000;
+            }
+        } else {
+            x = sign | ( (unsigned int)(exponent + 112) << 23 ) | (mantissa << 13);
+        }
+        float f;
+        std::memcpy( &f, &x, sizeof(float) );
+
+        return f;
+    }
+
+private:
+
+    unsigned short _bits;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_HALF_H
@@ -37,23 +37,65 @@
 
 NATRON_NAMESPACE_ENTER;
 
+Hash64::HashAlgorithmEnum Hash64::_algorithm = Hash64::eHashAlgorithmStreaming;
+
+void
+Hash64::setAlgorithm(HashAlgorithmEnum algorithm)
+{
+    _algorithm = algorithm;
+}
+
+static U64
+finalizeHash64(U64 k)
+{
+    // MurmurHash3 64-bit finalizer: forces all bits of the lanes to avalanche
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+
+    return k;
+}
+
 void
 Hash64::computeHash()
 {
-    if ( node_values.empty() ) {
+    if (_algorithm == eHashAlgorithmCRC64) {
+        if ( node_values.empty() ) {
+            return;
+        }
+
+        const unsigned char* data = reinterpret_cast<const unsigned char*>( &node_values.front() );
+        boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> crc_64;
+        crc_64 = std::for_each( data, data + node_values.size() * sizeof(node_values[0]), crc_64 );
+        hash = crc_64();
+
         return;
     }
 
-    const unsigned char* data = reinterpret_cast<const unsigned char*>( &node_values.front() );
-    boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> crc_64;
-    crc_64 = std::for_each( data, data + node_values.size() * sizeof(node_values[0]), crc_64 );
-    hash = crc_64();
+    if (count == 0) {
+        return;
+    }
+
+    // Fold the lanes in order so that the position of each value matters
+    U64 h = count * 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < 4; ++i) {
+        h ^= finalizeHash64(lanes[i] + i);
+        h = rotl(h, 29) * 0x87c37b91114253d5ULL + 0x38495ab5;
+    }
+    h = finalizeHash64(h);
+
+    // 0 is reserved for invalid hashes
+    hash = h == 0 ? 1 : h;
 }
 
 void
 Hash64::reset()
 {
     node_values.clear();
+    lanes[0] = lanes[1] = lanes[2] = lanes[3] = 0;
+    count = 0;
     hash = 0;
 }
 
@@ -61,9 +103,31 @@ void
 Hash64_appendQString(Hash64* hash,
                      const QString & str)
 {
-    Q_FOREACH (QChar ch, str) {
-        hash->append<unsigned short>( ch.unicode() );
+    if (Hash64::getAlgorithm() == Hash64::eHashAlgorithmCRC64) {
+        Q_FOREACH (QChar ch, str) {
+            hash->append<unsigned short>( ch.unicode() );
+        }
+
+        return;
+    }
+
+    // Pack 4 UTF-16 code units per value rather than appending one value per character
+    const ushort* data = str.utf16();
+    const int n = str.size();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        U64 v = (U64)data[i] | ( (U64)data[i + 1] << 16 ) | ( (U64)data[i + 2] << 32 ) | ( (U64)data[i + 3] << 48 );
+        hash->append<U64>(v);
+    }
+    if (i < n) {
+        U64 v = 0;
+        for (int j = 0; i + j < n; ++j) {
+            v |= (U64)data[i + j] << (16 * j);
+        }
+        hash->append<U64>(v);
     }
+    // Append the length so that the packing does not make different strings collide
+    hash->append<int>(n);
 }
 
 NATRON_NAMESPACE_EXIT;
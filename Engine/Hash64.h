@@ -38,17 +38,34 @@
 
 NATRON_NAMESPACE_ENTER;
 
-/*The hash of a Node is the checksum of the vector of data containing:
+/*The hash of a Node is the checksum of the sequence of data containing:
     - the values of the current knob for this node + the name of the node
     - the hash values for the  tree upstream
+
+   By default the values are mixed into the hash as they are appended (streaming), so that no intermediate
+   storage is needed. The CRC-64 algorithm of older versions is kept so that keys of existing on-disk caches
+   can still be produced.
  */
 
 class Hash64
 {
 public:
+
+    enum HashAlgorithmEnum
+    {
+        // Multiply-mix of each appended value into 4 independent lanes, folded together in computeHash()
+        eHashAlgorithmStreaming = 0,
+
+        // Bytewise CRC-64 of all appended values, yields the same hashes as older versions
+        eHashAlgorithmCRC64
+    };
+
     Hash64()
+        : hash(0)
+        , count(0)
+        , node_values()
     {
-        hash = 0;
+        lanes[0] = lanes[1] = lanes[2] = lanes[3] = 0;
     }
 
     ~Hash64()
@@ -56,6 +73,16 @@ public:
         node_values.clear();
     }
 
+    /**
+     * @brief Set the algorithm used by all hashes. This must be called on startup before any hash is computed
+     * since hashes computed with different algorithms cannot be compared.
+     **/
+    static void setAlgorithm(HashAlgorithmEnum algorithm);
+    static HashAlgorithmEnum getAlgorithm()
+    {
+        return _algorithm;
+    }
+
     U64 value() const
     {
         return hash;
@@ -86,7 +113,11 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
     template<typename T>
     void append(T value)
     {
-        node_values.push_back( toU64(value) );
+        if (_algorithm == eHashAlgorithmCRC64) {
+            node_values.push_back( toU64(value) );
+        } else {
+            mix( toU64(value) );
+        }
     }
 
     bool operator== (const Hash64 & h) const
@@ -115,7 +146,36 @@ private:
         };
     };
 
+    static U64 rotl(U64 x,
+                    int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    /*
+     * Consecutive values go to different lanes so that the 4 multiply chains are independent
+     * and can be executed in parallel by the CPU.
+     */
+    void mix(U64 v)
+    {
+        U64& lane = lanes[count & 3];
+
+        v *= 0x87c37b91114253d5ULL;
+        v = rotl(v, 31);
+        v *= 0x4cf5ad432745937fULL;
+        lane ^= v;
+        lane = rotl(lane, 27) * 5 + 0x52dce729;
+        ++count;
+    }
+
+    static HashAlgorithmEnum _algorithm;
     U64 hash;
+
+    // Used by eHashAlgorithmStreaming
+    U64 lanes[4];
+    U64 count;
+
+    // Used by eHashAlgorithmCRC64
     std::vector<U64> node_values;
 };
 
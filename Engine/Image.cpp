@@ -32,6 +32,7 @@
 #include <QtCore/QDebug>
 
 #include "Engine/AppManager.h"
+#include "Engine/LutSIMD.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/GPUContextPool.h"
 #include "Engine/OSGLContext.h"
@@ -39,175 +40,415 @@
 
 NATRON_NAMESPACE_ENTER;
 
-#define BM_GET(i, j) & _map[( i - _bounds.bottom() ) * _bounds.width() + ( j - _bounds.left() )]
+// 2 bits per tile: the tile states are the BitmapStateEnum values, except this one
+#define BITMAP_TILE_MIXED 3
+// the low bit of each of the 32 tiles of a word
+#define BITMAP_TILES_LOW_BITS 0x5555555555555555ULL
 
-#define PIXEL_UNAVAILABLE 2
+void
+Bitmap::initialize(const RectI & bounds,
+                   int tileSizeLog2)
+{
+    assert(tileSizeLog2 >= 0 && tileSizeLog2 < 16);
+    _bounds = bounds;
+    _tileSizeLog2 = tileSizeLog2;
+    _mixedTiles.clear();
+    if ( bounds.isNull() ) {
+        _tilesBounds.clear();
+        _wordsPerRow = 0;
+        _tiles.clear();
+
+        return;
+    }
+    _tilesBounds.x1 = tileIndex(bounds.x1);
+    _tilesBounds.y1 = tileIndex(bounds.y1);
+    _tilesBounds.x2 = tileIndex(bounds.x2 - 1) + 1;
+    _tilesBounds.y2 = tileIndex(bounds.y2 - 1) + 1;
+    _wordsPerRow = (_tilesBounds.width() + 31) / 32;
+    _tiles.assign(_wordsPerRow * _tilesBounds.height(), 0);
+}
+
+void
+Bitmap::setTo1()
+{
+    std::fill(_tiles.begin(), _tiles.end(), BITMAP_TILES_LOW_BITS * eBitmapStateRendered);
+    _mixedTiles.clear();
+}
+
+std::size_t
+Bitmap::getMemorySize() const
+{
+    const std::size_t tileArea = 1 << (_tileSizeLog2 * 2);
+
+    return _tiles.size() * sizeof(U64) + _mixedTiles.size() * (tileArea + sizeof(std::vector<char>) + 4 * sizeof(void*));
+}
 
-template <int trimap>
 RectI
-minimalNonMarkedBbox_internal(const RectI& roi,
-                              const RectI& _bounds,
-                              const std::vector<char>& _map,
-                              bool* isBeingRenderedElsewhere)
+Bitmap::getTileRect(int tx,
+                    int ty) const
 {
-    RectI bbox;
+    const int tileSize = 1 << _tileSizeLog2;
 
-    assert( _bounds.contains(roi) );
-    bbox = roi;
+    return RectI(tx * tileSize, ty * tileSize, (tx + 1) * tileSize, (ty + 1) * tileSize);
+}
 
-    //find bottom
-    for (int i = bbox.bottom(); i < bbox.top(); ++i) {
-        const char* buf = BM_GET( i, bbox.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                ++bbox.y1;
-            } else {
-                ++bbox.y1;
-            }
-        } else {
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if ( !*buf || (*buf == PIXEL_UNAVAILABLE) ) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                ++bbox.y1;
-            }
+int
+Bitmap::getTileState(int tx,
+                     int ty) const
+{
+    const int i = tx - _tilesBounds.x1;
+    const U64 word = _tiles[(ty - _tilesBounds.y1) * _wordsPerRow + (i >> 5)];
+
+    return (int)( ( word >> ( (i & 31) * 2 ) ) & 3 );
+}
+
+void
+Bitmap::setTileState(int tx,
+                     int ty,
+                     int state)
+{
+    const int i = tx - _tilesBounds.x1;
+    U64& word = _tiles[(ty - _tilesBounds.y1) * _wordsPerRow + (i >> 5)];
+    const int shift = (i & 31) * 2;
+
+    word = ( word & ~(3ULL << shift) ) | ( (U64)state << shift );
+}
+
+void
+Bitmap::setTileRowStates(int ty,
+                         int tx1,
+                         int tx2,
+                         int state)
+{
+    if (tx1 >= tx2) {
+        return;
+    }
+    assert(state != BITMAP_TILE_MIXED);
+    U64* row = &_tiles[(ty - _tilesBounds.y1) * _wordsPerRow];
+    const int i1 = tx1 - _tilesBounds.x1;
+    const int i2 = tx2 - _tilesBounds.x1;
+    const U64 pattern = BITMAP_TILES_LOW_BITS * state;
+    for (int w = i1 >> 5; w <= ( (i2 - 1) >> 5 ); ++w) {
+        const int first = std::max(i1 - w * 32, 0);
+        const int last = std::min(i2 - w * 32, 32);
+        U64 mask = ~0ULL;
+        if (first > 0) {
+            mask &= ~( (1ULL << (first * 2) ) - 1 );
+        }
+        if (last < 32) {
+            mask &= (1ULL << (last * 2) ) - 1;
         }
+        row[w] = (row[w] & ~mask) | (pattern & mask);
     }
 
-    //find top (will do zero iteration if the bbox is already empty)
-    for (int i = bbox.top() - 1; i >= bbox.bottom(); --i) {
-        const char* buf = BM_GET( i, bbox.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                --bbox.y2;
-            } else {
-                --bbox.y2;
+    if ( !_mixedTiles.empty() ) {
+        _mixedTiles.erase( _mixedTiles.lower_bound( getTileKey(tx1, ty) ), _mixedTiles.lower_bound( getTileKey(tx2, ty) ) );
+    }
+}
+
+int
+Bitmap::getTileRowStates(int ty,
+                         int tx1,
+                         int tx2,
+                         const RectI& rect) const
+{
+    const U64* row = &_tiles[(ty - _tilesBounds.y1) * _wordsPerRow];
+    const int i1 = tx1 - _tilesBounds.x1;
+    const int i2 = tx2 - _tilesBounds.x1;
+    int flags = 0;
+
+    for (int w = i1 >> 5; w <= ( (i2 - 1) >> 5 ); ++w) {
+        const int first = std::max(i1 - w * 32, 0);
+        const int last = std::min(i2 - w * 32, 32);
+        U64 mask = BITMAP_TILES_LOW_BITS;
+        if (first > 0) {
+            mask &= ~( (1ULL << (first * 2) ) - 1 );
+        }
+        if (last < 32) {
+            mask &= (1ULL << (last * 2) ) - 1;
+        }
+        const U64 lo = row[w] & mask;
+        const U64 hi = (row[w] >> 1) & mask;
+        if (mask & ~lo & ~hi) {
+            flags |= eBitmapStateFlagUnrendered;
+        }
+        if (lo & ~hi) {
+            flags |= eBitmapStateFlagRendered;
+        }
+        if (hi & ~lo) {
+            flags |= eBitmapStateFlagRendering;
+        }
+        U64 mixed = lo & hi;
+        for (int lane = first; mixed && lane < last; ++lane) {
+            if ( !( ( mixed >> (lane * 2) ) & 1 ) ) {
+                continue;
             }
-        } else {
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if ( !*buf || (*buf == PIXEL_UNAVAILABLE) ) {
-                    buf = 0;
-                    break;
+            mixed &= ~( 1ULL << (lane * 2) );
+
+            const int tx = _tilesBounds.x1 + w * 32 + lane;
+            std::map<int, std::vector<char> >::const_iterator found = _mixedTiles.find( getTileKey(tx, ty) );
+            assert( found != _mixedTiles.end() );
+            const RectI tileRect = getTileRect(tx, ty);
+            RectI inter;
+            rect.intersect(tileRect, &inter);
+            const int tileSize = 1 << _tileSizeLog2;
+            for (int y = inter.y1; y < inter.y2; ++y) {
+                const char* pix = &found->second[(y - tileRect.y1) * tileSize + (inter.x1 - tileRect.x1)];
+                for (int x = inter.x1; x < inter.x2; ++x, ++pix) {
+                    flags |= 1 << *pix;
                 }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                --bbox.y2;
             }
         }
+        if ( flags == (eBitmapStateFlagUnrendered | eBitmapStateFlagRendered | eBitmapStateFlagRendering) ) {
+            break;
+        }
     }
 
-    // avoid making bbox.width() iterations for nothing
-    if ( bbox.isNull() ) {
-        return bbox;
+    return flags;
+} // Bitmap::getTileRowStates
+
+int
+Bitmap::getStatesInRect(const RectI& rect) const
+{
+    if ( rect.isNull() ) {
+        return 0;
+    }
+    assert( _bounds.contains(rect) );
+    const int tx1 = tileIndex(rect.x1);
+    const int tx2 = tileIndex(rect.x2 - 1) + 1;
+    const int ty1 = tileIndex(rect.y1);
+    const int ty2 = tileIndex(rect.y2 - 1) + 1;
+    int flags = 0;
+    for (int ty = ty1; ty < ty2; ++ty) {
+        flags |= getTileRowStates(ty, tx1, tx2, rect);
+        if ( flags == (eBitmapStateFlagUnrendered | eBitmapStateFlagRendered | eBitmapStateFlagRendering) ) {
+            break;
+        }
     }
 
-    //find left
-    for (int j = bbox.left(); j < bbox.right(); ++j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
-        bool metUnavailablePixel = false;
+    return flags;
+}
 
-        for ( int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width() ) {
-            if (!*pix) {
-                pix = 0;
-                break;
-            } else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
-                }
+Bitmap::BitmapStateEnum
+Bitmap::getPixelState(int x,
+                      int y) const
+{
+    assert( _bounds.contains(x, y) );
+    const int tx = tileIndex(x);
+    const int ty = tileIndex(y);
+    const int state = getTileState(tx, ty);
+    if (state != BITMAP_TILE_MIXED) {
+        return (BitmapStateEnum)state;
+    }
+    std::map<int, std::vector<char> >::const_iterator found = _mixedTiles.find( getTileKey(tx, ty) );
+    assert( found != _mixedTiles.end() );
+    const int tileSize = 1 << _tileSizeLog2;
+
+    return (BitmapStateEnum)found->second[(y - ty * tileSize) * tileSize + (x - tx * tileSize)];
+}
+
+char*
+Bitmap::getMixedTilePixels(int tx,
+                           int ty)
+{
+    std::vector<char>& pixels = _mixedTiles[getTileKey(tx, ty)];
+    const int state = getTileState(tx, ty);
+
+    if (state != BITMAP_TILE_MIXED) {
+        pixels.assign(1 << (_tileSizeLog2 * 2), (char)state);
+        setTileState(tx, ty, BITMAP_TILE_MIXED);
+    }
+
+    return &pixels.front();
+}
+
+void
+Bitmap::collapseMixedTile(int tx,
+                          int ty)
+{
+    std::map<int, std::vector<char> >::iterator found = _mixedTiles.find( getTileKey(tx, ty) );
+
+    assert( found != _mixedTiles.end() );
+    const RectI tileRect = getTileRect(tx, ty);
+    RectI inter;
+    _bounds.intersect(tileRect, &inter);
+    const int tileSize = 1 << _tileSizeLog2;
+    const char state = found->second[(inter.y1 - tileRect.y1) * tileSize + (inter.x1 - tileRect.x1)];
+    for (int y = inter.y1; y < inter.y2; ++y) {
+        const char* pix = &found->second[(y - tileRect.y1) * tileSize + (inter.x1 - tileRect.x1)];
+        for (int x = inter.x1; x < inter.x2; ++x, ++pix) {
+            if (*pix != state) {
+                return;
             }
         }
-        if (pix) {
-            ++bbox.x1;
-            if (trimap && metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
+    }
+    _mixedTiles.erase(found);
+    setTileState(tx, ty, state);
+}
+
+void
+Bitmap::fillTile(int tx,
+                 int ty,
+                 const RectI& rect,
+                 int state)
+{
+    const RectI tileRect = getTileRect(tx, ty);
+    RectI inter;
+
+    _bounds.intersect(tileRect, &inter);
+    if ( rect.contains(inter) ) {
+        setTileRowStates(ty, tx, tx + 1, state);
+
+        return;
+    }
+    if (getTileState(tx, ty) == state) {
+        return;
+    }
+    rect.intersect(tileRect, &inter);
+    const int tileSize = 1 << _tileSizeLog2;
+    char* pixels = getMixedTilePixels(tx, ty);
+    for (int y = inter.y1; y < inter.y2; ++y) {
+        std::memset( &pixels[(y - tileRect.y1) * tileSize + (inter.x1 - tileRect.x1)], state, inter.width() );
+    }
+    collapseMixedTile(tx, ty);
+}
+
+void
+Bitmap::fill(const RectI& roi,
+             int state)
+{
+    if ( roi.isNull() ) {
+        return;
+    }
+    assert( _bounds.contains(roi) );
+    const int tileSize = 1 << _tileSizeLog2;
+    const int tx1 = tileIndex(roi.x1);
+    const int tx2 = tileIndex(roi.x2 - 1) + 1;
+    const int ty1 = tileIndex(roi.y1);
+    const int ty2 = tileIndex(roi.y2 - 1) + 1;
+
+    // the tiles of a row which are entirely covered by the roi, the others being at most the first and the last one
+    const int fullTx1 = ( roi.x1 <= std::max(tx1 * tileSize, _bounds.x1) ) ? tx1 : tx1 + 1;
+    const int fullTx2 = ( roi.x2 >= std::min(tx2 * tileSize, _bounds.x2) ) ? tx2 : tx2 - 1;
+
+    for (int ty = ty1; ty < ty2; ++ty) {
+        const bool rowCovered = roi.y1 <= std::max(ty * tileSize, _bounds.y1) && roi.y2 >= std::min( (ty + 1) * tileSize, _bounds.y2 );
+        if ( rowCovered && (fullTx1 < fullTx2) ) {
+            setTileRowStates(ty, fullTx1, fullTx2, state);
+            for (int tx = tx1; tx < fullTx1; ++tx) {
+                fillTile(tx, ty, roi, state);
+            }
+            for (int tx = fullTx2; tx < tx2; ++tx) {
+                fillTile(tx, ty, roi, state);
             }
         } else {
-            break;
+            for (int tx = tx1; tx < tx2; ++tx) {
+                fillTile(tx, ty, roi, state);
+            }
         }
     }
+}
 
-    //find right
-    for (int j = bbox.right() - 1; j >= bbox.left(); --j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
-        bool metUnavailablePixel = false;
+int
+Bitmap::countAcceptedLines(const RectI& rect,
+                           bool horizontal,
+                           bool forward,
+                           int rejectFlags,
+                           int flagsIfAccepted,
+                           int flagsIfRejected,
+                           bool* isBeingRenderedElsewhere) const
+{
+    const int begin = horizontal ? rect.y1 : rect.x1;
+    const int end = horizontal ? rect.y2 : rect.x2;
+    const int tileSize = 1 << _tileSizeLog2;
+    int count = 0;
+    int i = forward ? begin : end - 1;
+
+    while ( forward ? (i < end) : (i >= begin) ) {
+        // first check all the lines of the current line of tiles at once
+        const int tileStart = tileIndex(i) * tileSize;
+        const int bandBegin = forward ? i : std::max(tileStart, begin);
+        const int bandEnd = forward ? std::min(tileStart + tileSize, end) : i + 1;
+        const RectI band = horizontal ? RectI(rect.x1, bandBegin, rect.x2, bandEnd) : RectI(bandBegin, rect.y1, bandEnd, rect.y2);
+        const int bandStates = getStatesInRect(band);
+        if ( !(bandStates & rejectFlags) ) {
+            if (bandStates & flagsIfAccepted) {
+                *isBeingRenderedElsewhere = true;
+            }
+            count += bandEnd - bandBegin;
+            i = forward ? bandEnd : bandBegin - 1;
+            continue;
+        }
 
-        for ( int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width() ) {
-            if (!*pix) {
-                pix = 0;
-                break;
-            } else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
+        // one of the lines is rejected, find which one
+        for ( int n = bandEnd - bandBegin; n > 0; --n, i += (forward ? 1 : -1) ) {
+            const RectI line = horizontal ? RectI(rect.x1, i, rect.x2, i + 1) : RectI(i, rect.y1, i + 1, rect.y2);
+            const int lineStates = getStatesInRect(line);
+            if (lineStates & rejectFlags) {
+                if (lineStates & flagsIfRejected) {
+                    // only flag if the first rejected pixel of the line is one of flagsIfRejected
+                    int firstRejected = lineStates & rejectFlags;
+                    for (int j = horizontal ? line.x1 : line.y1; ( firstRejected & (firstRejected - 1) ) != 0; ++j) {
+                        const int pixelState = 1 << ( horizontal ? getPixelState(j, i) : getPixelState(i, j) );
+                        if (pixelState & rejectFlags) {
+                            firstRejected = pixelState;
+                        }
+                    }
+                    if (firstRejected & flagsIfRejected) {
+                        *isBeingRenderedElsewhere = true;
+                    }
                 }
+
+                return count;
             }
-        }
-        if (pix) {
-            --bbox.x2;
-            if (trimap && metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
+            if (lineStates & flagsIfAccepted) {
+                *isBeingRenderedElsewhere = true;
             }
-        } else {
-            break;
+            ++count;
         }
     }
 
+    return count;
+} // Bitmap::countAcceptedLines
+
+template <int trimap>
+RectI
+Bitmap::minimalNonMarkedBbox_internal(const RectI& roi,
+                                      bool* isBeingRenderedElsewhere) const
+{
+    assert( _bounds.contains(roi) );
+    RectI bbox = roi;
+
+    // With the trimap, only lines without any pixel left to render are removed, and pixels being rendered elsewhere
+    // are only flagged. Otherwise lines are removed only if all their pixels are rendered.
+    const int rejectFlags = trimap ? eBitmapStateFlagUnrendered : (eBitmapStateFlagUnrendered | eBitmapStateFlagRendering);
+    const int flagsIfAccepted = trimap ? eBitmapStateFlagRendering : 0;
+
+    //find bottom
+    bbox.y1 += countAcceptedLines(bbox, true, true, rejectFlags, flagsIfAccepted, 0, isBeingRenderedElsewhere);
+
+    //find top (will do zero iteration if the bbox is already empty)
+    bbox.y2 -= countAcceptedLines(bbox, true, false, rejectFlags, flagsIfAccepted, 0, isBeingRenderedElsewhere);
+
+    // avoid making bbox.width() iterations for nothing
+    if ( bbox.isNull() ) {
+        return bbox;
+    }
+
+    //find left
+    bbox.x1 += countAcceptedLines(bbox, false, true, rejectFlags, flagsIfAccepted, 0, isBeingRenderedElsewhere);
+
+    //find right
+    bbox.x2 -= countAcceptedLines(bbox, false, false, rejectFlags, flagsIfAccepted, 0, isBeingRenderedElsewhere);
+
     return bbox;
 } // minimalNonMarkedBbox_internal
 
 template <int trimap>
 void
-minimalNonMarkedRects_internal(const RectI & roi,
-                               const RectI& _bounds,
-                               const std::vector<char>& _map,
-                               std::list<RectI>& ret,
-                               bool* isBeingRenderedElsewhere)
+Bitmap::minimalNonMarkedRects_internal(const RectI & roi,
+                                       std::list<RectI>& ret,
+                                       bool* isBeingRenderedElsewhere) const
 {
     ///Any out of bounds portion is pushed to the rectangles to render
     RectI intersection;
@@ -242,7 +483,7 @@ minimalNonMarkedRects_internal(const RectI & roi,
         return;
     }
 
-    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, _bounds, _map, isBeingRenderedElsewhere);
+    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, isBeingRenderedElsewhere);
     assert( (trimap && isBeingRenderedElsewhere) || (!trimap && !isBeingRenderedElsewhere) );
 
     //#define NATRON_BITMAP_DISABLE_OPTIMIZATION
@@ -276,45 +517,18 @@ minimalNonMarkedRects_internal(const RectI & roi,
     // CXXXXXXXXXXDDD
     // AAAAAAAAAAAAAA
 
+    // The A, B, C and D rectangles may not contain rendered pixels, nor pixels being rendered elsewhere
+    // with the trimap, in which case the caller is flagged.
+    const int rejectFlags = trimap ? (eBitmapStateFlagRendered | eBitmapStateFlagRendering) : eBitmapStateFlagRendered;
+    const int flagsIfRejected = trimap ? eBitmapStateFlagRendering : 0;
+
     // First, find if there's an "A" rectangle, and push it to the result
     //find bottom
     RectI bboxX = bboxM;
     RectI bboxA = bboxX;
     bboxA.set_top( bboxX.bottom() );
-    for (int i = bboxX.bottom(); i < bboxX.top(); ++i) {
-        const char* buf = BM_GET( i, bboxX.left() );
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if ( (*buf == PIXEL_UNAVAILABLE) && trimap ) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                break;
-            }
-        }
-    }
+    bboxX.y1 += countAcceptedLines(bboxX, true, true, rejectFlags, 0, flagsIfRejected, isBeingRenderedElsewhere);
+    bboxA.y2 = bboxX.y1;
     if ( !bboxA.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxA);
     }
@@ -323,41 +537,8 @@ minimalNonMarkedRects_internal(const RectI & roi,
     //find top
     RectI bboxB = bboxX;
     bboxB.set_bottom( bboxX.top() );
-    for (int i = bboxX.top() - 1; i >= bboxX.bottom(); --i) {
-        const char* buf = BM_GET( i, bboxX.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if ( (*buf == PIXEL_UNAVAILABLE) && trimap ) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                break;
-            }
-        }
-    }
+    bboxX.y2 -= countAcceptedLines(bboxX, true, false, rejectFlags, 0, flagsIfRejected, isBeingRenderedElsewhere);
+    bboxB.y1 = bboxX.y2;
     if ( !bboxB.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxB);
     }
@@ -366,30 +547,8 @@ minimalNonMarkedRects_internal(const RectI & roi,
     RectI bboxC = bboxX;
     bboxC.set_right( bboxX.left() );
     if ( bboxX.bottom() < bboxX.top() ) {
-        for (int j = bboxX.left(); j < bboxX.right(); ++j) {
-            const char* pix = BM_GET(bboxX.bottom(), j);
-            bool metUnavailablePixel = false;
-
-            for ( int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width() ) {
-                if (*pix == 1) {
-                    pix = 0;
-                    break;
-                } else if ( trimap && (*pix == PIXEL_UNAVAILABLE) ) {
-                    pix = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-            }
-            if (pix) {
-                ++bboxX.x1;
-                bboxC.x2 = bboxX.x1;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        }
+        bboxX.x1 += countAcceptedLines(bboxX, false, true, rejectFlags, 0, flagsIfRejected, isBeingRenderedElsewhere);
+        bboxC.x2 = bboxX.x1;
     }
     if ( !bboxC.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxC);
@@ -399,30 +558,8 @@ minimalNonMarkedRects_internal(const RectI & roi,
     RectI bboxD = bboxX;
     bboxD.set_left( bboxX.right() );
     if ( bboxX.bottom() < bboxX.top() ) {
-        for (int j = bboxX.right() - 1; j >= bboxX.left(); --j) {
-            const char* pix = BM_GET(bboxX.bottom(), j);
-            bool metUnavailablePixel = false;
-
-            for ( int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width() ) {
-                if (*pix == 1) {
-                    pix = 0;
-                    break;
-                } else if ( trimap && (*pix == PIXEL_UNAVAILABLE) ) {
-                    pix = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-            }
-            if (pix) {
-                --bboxX.x2;
-                bboxD.x1 = bboxX.x2;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        }
+        bboxX.x2 -= countAcceptedLines(bboxX, false, false, rejectFlags, 0, flagsIfRejected, isBeingRenderedElsewhere);
+        bboxD.x1 = bboxX.x2;
     }
     if ( !bboxD.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxD);
@@ -449,7 +586,7 @@ minimalNonMarkedRects_internal(const RectI & roi,
     assert( bboxD.bottom() == bboxX.bottom() );
 
     // get the bounding box of what's left (the X rectangle in the drawing above)
-    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX, _bounds, _map, isBeingRenderedElsewhere);
+    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX, isBeingRenderedElsewhere);
 
     if ( !bboxX.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxX);
@@ -467,9 +604,9 @@ Bitmap::minimalNonMarkedBbox(const RectI & roi) const
             return RectI();
         }
 
-        return minimalNonMarkedBbox_internal<0>(realRoi, _bounds, _map, NULL);
+        return minimalNonMarkedBbox_internal<0>(realRoi, NULL);
     } else {
-        return minimalNonMarkedBbox_internal<0>(roi, _bounds, _map, NULL);
+        return minimalNonMarkedBbox_internal<0>(roi, NULL);
     }
 }
 
@@ -482,9 +619,9 @@ Bitmap::minimalNonMarkedRects(const RectI & roi,
         if ( !roi.intersect(_dirtyZone, &realRoi) ) {
             return;
         }
-        minimalNonMarkedRects_internal<0>(realRoi, _bounds, _map, ret, NULL);
+        minimalNonMarkedRects_internal<0>(realRoi, ret, NULL);
     } else {
-        minimalNonMarkedRects_internal<0>(roi, _bounds, _map, ret, NULL);
+        minimalNonMarkedRects_internal<0>(roi, ret, NULL);
     }
 }
 
@@ -501,9 +638,9 @@ Bitmap::minimalNonMarkedBbox_trimap(const RectI & roi,
             return RectI();
         }
 
-        return minimalNonMarkedBbox_internal<1>(realRoi, _bounds, _map, isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(realRoi, isBeingRenderedElsewhere);
     } else {
-        return minimalNonMarkedBbox_internal<1>(roi, _bounds, _map, isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(roi, isBeingRenderedElsewhere);
     }
 }
 
@@ -519,9 +656,9 @@ Bitmap::minimalNonMarkedRects_trimap(const RectI & roi,
 
             return;
         }
-        minimalNonMarkedRects_internal<1>(realRoi, _bounds, _map, ret, isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(realRoi, ret, isBeingRenderedElsewhere);
     } else {
-        minimalNonMarkedRects_internal<1>(roi, _bounds, _map, ret, isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(roi, ret, isBeingRenderedElsewhere);
     }
 }
 
@@ -530,26 +667,14 @@ Bitmap::minimalNonMarkedRects_trimap(const RectI & roi,
 void
 Bitmap::markForRendered(const RectI & roi)
 {
-    char* buf = BM_GET( roi.bottom(), roi.left() );
-    int w = _bounds.width();
-    int roiw = roi.width();
-
-    for (int i = roi.y1; i < roi.y2; ++i, buf += w) {
-        std::memset( buf, 1, roiw);
-    }
+    fill(roi, eBitmapStateRendered);
 }
 
 #if NATRON_ENABLE_TRIMAP
 void
 Bitmap::markForRendering(const RectI & roi)
 {
-    char* buf = BM_GET( roi.bottom(), roi.left() );
-    int w = _bounds.width();
-    int roiw = roi.width();
-
-    for (int i = roi.y1; i < roi.y2; ++i, buf += w) {
-        std::memset( buf, PIXEL_UNAVAILABLE, roiw );
-    }
+    fill(roi, eBitmapStateRendering);
 }
 
 #endif
@@ -557,46 +682,22 @@ Bitmap::markForRendering(const RectI & roi)
 void
 Bitmap::clear(const RectI& roi)
 {
-    char* buf = BM_GET( roi.bottom(), roi.left() );
-    int w = _bounds.width();
-    int roiw = roi.width();
-
-    for (int i = roi.y1; i < roi.y2; ++i, buf += w) {
-        std::memset( buf, 0, roiw );
-    }
+    fill(roi, eBitmapStateUnrendered);
 }
 
 void
 Bitmap::swap(Bitmap& other)
 {
-    _map.swap(other._map);
-    _bounds = other._bounds;
+    _tiles.swap(other._tiles);
+    _mixedTiles.swap(other._mixedTiles);
+    std::swap(_bounds, other._bounds);
+    std::swap(_tileSizeLog2, other._tileSizeLog2);
+    std::swap(_tilesBounds, other._tilesBounds);
+    std::swap(_wordsPerRow, other._wordsPerRow);
     _dirtyZone.clear(); //merge(other._dirtyZone);
     _dirtyZoneSet = false;
 }
 
-const char*
-Bitmap::getBitmapAt(int x,
-                    int y) const
-{
-    if ( ( x >= _bounds.left() ) && ( x < _bounds.right() ) && ( y >= _bounds.bottom() ) && ( y < _bounds.top() ) ) {
-        return BM_GET(y, x);
-    } else {
-        return NULL;
-    }
-}
-
-char*
-Bitmap::getBitmapAt(int x,
-                    int y)
-{
-    if ( ( x >= _bounds.left() ) && ( x < _bounds.right() ) && ( y >= _bounds.bottom() ) && ( y < _bounds.top() ) ) {
-        return BM_GET(y, x);
-    } else {
-        return NULL;
-    }
-}
-
 #ifdef DEBUG
 void
 Image::printUnrenderedPixels(const RectI& roi) const
@@ -605,9 +706,10 @@ Image::printUnrenderedPixels(const RectI& roi) const
         return;
     }
     QReadLocker k(&_entryLock);
-    const char* bm = _bitmap.getBitmapAt(roi.x1, roi.y1);
-    int roiw = roi.x2 - roi.x1;
-    int boundsW = _bitmap.getBounds().width();
+    RectI bmRoi;
+    if ( !roi.intersect(_bitmap.getBounds(), &bmRoi) ) {
+        return;
+    }
     RectD bboxUnrendered;
     bboxUnrendered.setupInfinity();
     RectD bboxUnavailable;
@@ -616,10 +718,10 @@ Image::printUnrenderedPixels(const RectI& roi) const
     bool hasUnrendered = false;
     bool hasUnavailable = false;
 
-    for ( int y = roi.y1; y < roi.y2; ++y,
-          bm += (boundsW - roiw) ) {
-        for (int x = roi.x1; x < roi.x2; ++x, ++bm) {
-            if (*bm == 0) {
+    for (int y = bmRoi.y1; y < bmRoi.y2; ++y) {
+        for (int x = bmRoi.x1; x < bmRoi.x2; ++x) {
+            const Bitmap::BitmapStateEnum state = _bitmap.getPixelState(x, y);
+            if (state == Bitmap::eBitmapStateUnrendered) {
                 if (x < bboxUnrendered.x1) {
                     bboxUnrendered.x1 = x;
                 }
@@ -633,7 +735,7 @@ Image::printUnrenderedPixels(const RectI& roi) const
                     bboxUnrendered.y2 = y;
                 }
                 hasUnrendered = true;
-            } else if (*bm == PIXEL_UNAVAILABLE) {
+            } else if (state == Bitmap::eBitmapStateRendering) {
                 if (x < bboxUnavailable.x1) {
                     bboxUnavailable.x1 = x;
                 }
@@ -857,7 +959,7 @@ Image::pasteFromForDepth(const Image & srcImg,
     ///Cannot copy images with different bit depth, this is not the purpose of this function.
     ///@see convert
     assert( getBitDepth() == srcImg.getBitDepth() );
-    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
+    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthHalf && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
     // NOTE: before removing the following asserts, please explain why an empty image may happen
 
     QWriteLocker k(&_entryLock);
@@ -991,9 +1093,7 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t memsize = a * pixelSize;
             std::memset(pix, 0, memsize);
             if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
-                char* bm = wacc.bitmapAt(aRect.x1, aRect.y1);
-                assert(bm);
-                std::memset(bm, 1, a);
+                (*outputImage)->_bitmap.markForRendered(aRect);
             }
         }
         if ( !cRect.isNull() ) {
@@ -1003,9 +1103,7 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t memsize = a * pixelSize;
             std::memset(pix, 0, memsize);
             if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
-                char* bm = (char*)wacc.bitmapAt(cRect.x1, cRect.y1);
-                assert(bm);
-                std::memset(bm, 1, a);
+                (*outputImage)->_bitmap.markForRendered(cRect);
             }
         }
         if ( !bRect.isNull() ) {
@@ -1015,13 +1113,11 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t rowsize = mw * pixelSize;
             int bw = bRect.width();
             std::size_t rectRowSize = bw * pixelSize;
-            char* bm = ( setBitmapTo1 && (*outputImage)->usesBitMap() ) ? wacc.bitmapAt(bRect.x1, bRect.y1) : 0;
             for (int y = bRect.y1; y < bRect.y2; ++y, pix += rowsize) {
                 std::memset(pix, 0, rectRowSize);
-                if (bm) {
-                    std::memset(bm, 1, bw);
-                    bm += mw;
-                }
+            }
+            if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
+                (*outputImage)->_bitmap.markForRendered(bRect);
             }
         }
         if ( !dRect.isNull() ) {
@@ -1031,13 +1127,11 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t rowsize = mw * pixelSize;
             int dw = dRect.width();
             std::size_t rectRowSize = dw * pixelSize;
-            char* bm = ( setBitmapTo1 && (*outputImage)->usesBitMap() ) ? wacc.bitmapAt(dRect.x1, dRect.y1) : 0;
             for (int y = dRect.y1; y < dRect.y2; ++y, pix += rowsize) {
                 std::memset(pix, 0, rectRowSize);
-                if (bm) {
-                    std::memset(bm, 1, dw);
-                    bm += mw;
-                }
+            }
+            if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
+                (*outputImage)->_bitmap.markForRendered(dRect);
             }
         }
     } // fillWithBlackAndTransparent
@@ -1051,7 +1145,7 @@ Image::resizeInternal(const Image* srcImg,
         (*outputImage)->pasteFromForDepth<unsigned short>(*srcImg, srcBounds, srcImg->usesBitMap(), false);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        (*outputImage)->pasteFromForDepth<Half>(*srcImg, srcBounds, srcImg->usesBitMap(), false);
         break;
     case eImageBitDepthFloat:
         (*outputImage)->pasteFromForDepth<float>(*srcImg, srcBounds, srcImg->usesBitMap(), false);
@@ -1321,7 +1415,7 @@ Image::pasteFrom(const Image & src,
             pasteFromForDepth<unsigned short>(src, srcRoi, copyBitmap, true);
             break;
         case eImageBitDepthHalf:
-            assert(false);
+            pasteFromForDepth<Half>(src, srcRoi, copyBitmap, true);
             break;
         case eImageBitDepthFloat:
             pasteFromForDepth<float>(src, srcRoi, copyBitmap, true);
@@ -1340,7 +1434,7 @@ Image::fillForDepthForComponents(const RectI & roi_,
                                  float b,
                                  float a)
 {
-    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
+    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthHalf && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
 
     RectI roi = roi_;
     bool doInteresect = roi.intersect(_bounds, &roi);
@@ -1350,8 +1444,9 @@ Image::fillForDepthForComponents(const RectI & roi_,
     }
 
     int rowElems = (int)getComponentsCount() * _bounds.width();
-    const float fillValue[4] = {
-        nComps == 1 ? a * maxValue : r * maxValue, g * maxValue, b * maxValue, a * maxValue
+    // convert the fill values once, this matters for Half pixels
+    const PIX fillValue[4] = {
+        PIX(nComps == 1 ? a * maxValue : r * maxValue), PIX(g * maxValue), PIX(b * maxValue), PIX(a * maxValue)
     };
 
 
@@ -1457,7 +1552,7 @@ Image::fill(const RectI & roi,
         fillForDepth<unsigned short, 65535>(roi, r, g, b, a);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        fillForDepth<Half, 1>(roi, r, g, b, a);
         break;
     case eImageBitDepthFloat:
         fillForDepth<float, 1>(roi, r, g, b, a);
@@ -1746,6 +1841,7 @@ Image::halveRoIForDepth(const RectI & roi,
 {
     assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) ||
             (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) ||
+            (getBitDepth() == eImageBitDepthHalf && sizeof(PIX) == 2) ||
             (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
 
     ///handle case where there is only 1 column/row
@@ -1789,25 +1885,17 @@ Image::halveRoIForDepth(const RectI & roi,
 
 
     const PIX* const srcPixels      = (const PIX*)pixelAt(srcBounds.x1,   srcBounds.y1);
-    const char* const srcBmPixels   = _bitmap.getBitmapAt(srcBmBounds.x1, srcBmBounds.y1);
     PIX* const dstPixels          = (PIX*)output->pixelAt(dstBounds.x1,   dstBounds.y1);
-    char* const dstBmPixels = output->_bitmap.getBitmapAt(dstBmBounds.x1, dstBmBounds.y1);
     int srcRowSize = srcBounds.width() * _nbComponents;
     int dstRowSize = dstBounds.width() * _nbComponents;
 
     // offset pointers so that srcData and dstData correspond to pixel (0,0)
     const PIX* const srcData = srcPixels - (srcBounds.x1 * _nbComponents + srcRowSize * srcBounds.y1);
     PIX* const dstData       = dstPixels - (dstBounds.x1 * _nbComponents + dstRowSize * dstBounds.y1);
-    const int srcBmRowSize = srcBmBounds.width();
-    const int dstBmRowSize = dstBmBounds.width();
-    const char* const srcBmData = srcBmPixels - (srcBmBounds.x1 + srcBmRowSize * srcBmBounds.y1);
-    char* const dstBmData       = dstBmPixels - (dstBmBounds.x1 + dstBmRowSize * dstBmBounds.y1);
 
     for (int y = dstRoI.y1; y < dstRoI.y2; ++y) {
         const PIX* const srcLineStart    = srcData + y * 2 * srcRowSize;
         PIX* const dstLineStart          = dstData + y     * dstRowSize;
-        const char* const srcBmLineStart = srcBmData + y * 2 * srcBmRowSize;
-        char* const dstBmLineStart       = dstBmData + y     * dstBmRowSize;
 
         // The current dst row, at y, covers the src rows y*2 (thisRow) and y*2+1 (nextRow).
         // Check that if are within srcBounds.
@@ -1819,9 +1907,7 @@ Image::halveRoIForDepth(const RectI & roi,
 
         for (int x = dstRoI.x1; x < dstRoI.x2; ++x) {
             const PIX* const srcPixStart    = srcLineStart   + x * 2 * _nbComponents;
-            const char* const srcBmPixStart = srcBmLineStart + x * 2;
             PIX* const dstPixStart          = dstLineStart   + x * _nbComponents;
-            char* const dstBmPixStart       = dstBmLineStart + x;
 
             // The current dst col, at y, covers the src cols x*2 (thisCol) and x*2+1 (nextCol).
             // Check that if are within srcBounds.
@@ -1837,9 +1923,6 @@ Image::halveRoIForDepth(const RectI & roi,
                 for (int k = 0; k < _nbComponents; ++k) {
                     dstPixStart[k] = 0;
                 }
-                if (copyBitMap) {
-                    dstBmPixStart[0] = 0;
-                }
                 continue;
             }
 
@@ -1847,51 +1930,21 @@ Image::halveRoIForDepth(const RectI & roi,
                 ///a b
                 ///c d
 
-                const PIX a = (pickThisCol && pickThisRow) ? *(srcPixStart + k) : 0;
-                const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + _nbComponents) : 0;
-                const PIX c = (pickThisCol && pickNextRow) ? *(srcPixStart + k + srcRowSize) : 0;
-                const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + _nbComponents)  : 0;
+                const PIX a = (pickThisCol && pickThisRow) ? *(srcPixStart + k) : PIX(0);
+                const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + _nbComponents) : PIX(0);
+                const PIX c = (pickThisCol && pickNextRow) ? *(srcPixStart + k + srcRowSize) : PIX(0);
+                const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + _nbComponents)  : PIX(0);
 
                 assert( sumW == 2 || ( sumW == 1 && ( (a == 0 && c == 0) || (b == 0 && d == 0) ) ) );
                 assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
                 dstPixStart[k] = (a + b + c + d) / sum;
             }
-
-            if (copyBitMap) {
-                ///a b
-                ///c d
-
-                char a = (pickThisCol && pickThisRow) ? *(srcBmPixStart) : 0;
-                char b = (pickNextCol && pickThisRow) ? *(srcBmPixStart + 1) : 0;
-                char c = (pickThisCol && pickNextRow) ? *(srcBmPixStart + srcBmRowSize) : 0;
-                char d = (pickNextCol && pickNextRow) ? *(srcBmPixStart + srcBmRowSize  + 1)  : 0;
-#if NATRON_ENABLE_TRIMAP
-                /*
-                   The only correct solution is to convert pixels being rendered to 0 otherwise the caller
-                   would have to wait for the original fullscale image render to be finished and then re-downscale again.
-                 */
-                if (a == PIXEL_UNAVAILABLE) {
-                    a = 0;
-                }
-                if (b == PIXEL_UNAVAILABLE) {
-                    b = 0;
-                }
-                if (c == PIXEL_UNAVAILABLE) {
-                    c = 0;
-                }
-                if (d == PIXEL_UNAVAILABLE) {
-                    d = 0;
-                }
-#endif
-                assert( sumW == 2 || ( sumW == 1 && ( (a == 0 && c == 0) || (b == 0 && d == 0) ) ) );
-                assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
-                assert(a + b + c + d <= sum); // bitmaps are 0 or 1
-                // the following is an integer division, the result can be 0 or 1
-                dstBmPixStart[0] = (a + b + c + d) / sum;
-                assert(dstBmPixStart[0] == 0 || dstBmPixStart[0] == 1);
-            }
         }
     }
+
+    if (copyBitMap) {
+        output->_bitmap.halveFrom(_bitmap, dstRoI);
+    }
 } // halveRoIForDepth
 
 // code proofread and fixed by @devernay on 8/8/2014
@@ -1908,7 +1961,7 @@ Image::halveRoI(const RectI & roi,
         halveRoIForDepth<unsigned short, 65535>(roi, copyBitMap, output);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        halveRoIForDepth<Half, 1>(roi, copyBitMap, output);
         break;
     case eImageBitDepthFloat:
         halveRoIForDepth<float, 1>(roi, copyBitMap, output);
@@ -1984,7 +2037,7 @@ Image::halve1DImage(const RectI & roi,
         halve1DImageForDepth<unsigned short, 65535>(roi, output);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        halve1DImageForDepth<Half, 1>(roi, output);
         break;
     case eImageBitDepthFloat:
         halve1DImageForDepth<float, 1>(roi, output);
@@ -2017,7 +2070,7 @@ Image::downscaleMipMap(const RectD& dstRod,
 //    roiCanonical.toPixelEnclosing(toLevel, par , &dstRoI);
     unsigned int downscaleLvls = toLevel - fromLevel;
 
-    assert( !copyBitMap || _bitmap.getBitmap() );
+    assert( !copyBitMap || usesBitMap() );
 
     RectI dstRoI  = roi.downscalePowerOfTwoSmallestEnclosing(downscaleLvls);
     ImagePtr tmpImg( new Image( getComponents(), dstRod, dstRoI, toLevel, par, getBitDepth(), getPremultiplication(), getFieldingOrder(), true) );
@@ -2037,7 +2090,7 @@ Image::downscaleMipMap(const RectD& dstRod,
 bool
 Image::checkForNaNs(const RectI& roi)
 {
-    if (getBitDepth() != eImageBitDepthFloat) {
+    if ( (getBitDepth() != eImageBitDepthFloat) && (getBitDepth() != eImageBitDepthHalf) ) {
         return false;
     }
     if (getStorageMode() == eStorageModeGLTex) {
@@ -2047,6 +2100,23 @@ Image::checkForNaNs(const RectI& roi)
     QWriteLocker k(&_entryLock);
     unsigned int compsCount = getComponentsCount();
     bool hasnan = false;
+    if (getBitDepth() == eImageBitDepthHalf) {
+        const unsigned short one = Half(1.f).bits();
+        for (int y = roi.y1; y < roi.y2; ++y) {
+            unsigned short* pix = (unsigned short*)pixelAt(roi.x1, y);
+            unsigned short* const end = pix +  compsCount * roi.width();
+
+            for (; pix < end; ++pix) {
+                // NaN: all exponent bits set and a non-zero mantissa
+                if ( (*pix & 0x7fff) > 0x7c00 ) {
+                    *pix = one;
+                    hasnan = true;
+                }
+            }
+        }
+
+        return hasnan;
+    }
     for (int y = roi.y1; y < roi.y2; ++y) {
         float* pix = (float*)pixelAt(roi.x1, y);
         float* const end = pix +  compsCount * roi.width();
@@ -2073,7 +2143,7 @@ Image::upscaleMipMapForDepth(const RectI & roi,
                              Image* output) const
 {
     assert( getBitDepth() == output->getBitDepth() );
-    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
+    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthHalf && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
 
     ///You should not call this function with a level equal to 0.
     assert(fromLevel > toLevel);
@@ -2162,7 +2232,7 @@ Image::upscaleMipMap(const RectI & roi,
         upscaleMipMapForDepth<unsigned short, 65535>(roi, fromLevel, toLevel, output);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        upscaleMipMapForDepth<Half, 1>(roi, fromLevel, toLevel, output);
         break;
     case eImageBitDepthFloat:
         upscaleMipMapForDepth<float, 1>(roi, fromLevel, toLevel, output);
@@ -2268,15 +2338,7 @@ Bitmap::copyRowPortion(int x1,
                        int y,
                        const Bitmap& other)
 {
-    const char* srcBitmap = other.getBitmapAt(x1, y);
-    char* dstBitmap = getBitmapAt(x1, y);
-    const char* end = dstBitmap + (x2 - x1);
-
-    while (dstBitmap < end) {
-        *dstBitmap = /**srcBitmap == PIXEL_UNAVAILABLE ? 0 : */ *srcBitmap;
-        ++dstBitmap;
-        ++srcBitmap;
-    }
+    copyBitmapPortion(RectI(x1, y, x2, y + 1), other);
 }
 
 void
@@ -2292,25 +2354,99 @@ Bitmap::copyBitmapPortion(const RectI& roi,
 {
     assert(roi.x1 >= _bounds.x1 && roi.x2 <= _bounds.x2 && roi.y1 >= _bounds.y1 && roi.y2 <= _bounds.y2);
     assert(roi.x1 >= other._bounds.x1 && roi.x2 <= other._bounds.x2 && roi.y1 >= other._bounds.y1 && roi.y2 <= other._bounds.y2);
+    if ( roi.isNull() ) {
+        return;
+    }
+
+    const int tileSize = 1 << _tileSizeLog2;
+    const int tx1 = tileIndex(roi.x1);
+    const int tx2 = tileIndex(roi.x2 - 1) + 1;
+    const int ty1 = tileIndex(roi.y1);
+    const int ty2 = tileIndex(roi.y2 - 1) + 1;
+    for (int ty = ty1; ty < ty2; ++ty) {
+        for (int tx = tx1; tx < tx2; ++tx) {
+            const RectI tileRect = getTileRect(tx, ty);
+            RectI inter;
+            roi.intersect(tileRect, &inter);
+            const int states = other.getStatesInRect(inter);
+            switch (states) {
+            case eBitmapStateFlagUnrendered:
+                fillTile(tx, ty, inter, eBitmapStateUnrendered);
+                break;
+            case eBitmapStateFlagRendered:
+                fillTile(tx, ty, inter, eBitmapStateRendered);
+                break;
+            case eBitmapStateFlagRendering:
+                fillTile(tx, ty, inter, eBitmapStateRendering);
+                break;
+            default: {
+                // the source is not uniform on this portion of the tile
+                char* pixels = getMixedTilePixels(tx, ty);
+                for (int y = inter.y1; y < inter.y2; ++y) {
+                    char* pix = &pixels[(y - tileRect.y1) * tileSize + (inter.x1 - tileRect.x1)];
+                    for (int x = inter.x1; x < inter.x2; ++x, ++pix) {
+                        *pix = (char)other.getPixelState(x, y);
+                    }
+                }
+                collapseMixedTile(tx, ty);
+                break;
+            }
+            }
+        }
+    }
+} // Bitmap::copyBitmapPortion
 
-    int srcRowSize = other._bounds.width();
-    int dstRowSize = _bounds.width();
-    const char* srcBitmap = other.getBitmapAt(roi.x1, roi.y1);
-    char* dstBitmap = getBitmapAt(roi.x1, roi.y1);
-
-    for (int y = roi.y1; y < roi.y2; ++y,
-         srcBitmap += srcRowSize,
-         dstBitmap += dstRowSize) {
-        const char* srcCur = srcBitmap;
-        const char* srcEnd = srcBitmap + roi.width();
-        char* dstCur = dstBitmap;
-        while (srcCur < srcEnd) {
-            *dstCur = /**srcCur == PIXEL_UNAVAILABLE ? 0 : */ *srcCur;
-            ++srcCur;
-            ++dstCur;
+void
+Bitmap::halveFrom(const Bitmap& other,
+                  const RectI& roi)
+{
+    RectI dstRoi;
+
+    if ( !roi.intersect(_bounds, &dstRoi) ) {
+        return;
+    }
+
+    const int tileSize = 1 << _tileSizeLog2;
+    const int tx1 = tileIndex(dstRoi.x1);
+    const int tx2 = tileIndex(dstRoi.x2 - 1) + 1;
+    const int ty1 = tileIndex(dstRoi.y1);
+    const int ty2 = tileIndex(dstRoi.y2 - 1) + 1;
+    for (int ty = ty1; ty < ty2; ++ty) {
+        for (int tx = tx1; tx < tx2; ++tx) {
+            const RectI tileRect = getTileRect(tx, ty);
+            RectI inter;
+            dstRoi.intersect(tileRect, &inter);
+            RectI srcRect;
+            int states = 0;
+            if ( RectI(inter.x1 * 2, inter.y1 * 2, inter.x2 * 2, inter.y2 * 2).intersect(other._bounds, &srcRect) ) {
+                states = other.getStatesInRect(srcRect);
+            }
+            // pixels of inter without any corresponding pixel in other are not rendered
+            const bool allPixelsHaveSource = !srcRect.isNull() &&
+                                             inter.x1 * 2 + 2 > other._bounds.x1 && (inter.x2 - 1) * 2 < other._bounds.x2 &&
+                                             inter.y1 * 2 + 2 > other._bounds.y1 && (inter.y2 - 1) * 2 < other._bounds.y2;
+            if ( (states == eBitmapStateFlagRendered) && allPixelsHaveSource ) {
+                fillTile(tx, ty, inter, eBitmapStateRendered);
+            } else if ( !(states & eBitmapStateFlagRendered) ) {
+                fillTile(tx, ty, inter, eBitmapStateUnrendered);
+            } else {
+                char* pixels = getMixedTilePixels(tx, ty);
+                for (int y = inter.y1; y < inter.y2; ++y) {
+                    char* pix = &pixels[(y - tileRect.y1) * tileSize + (inter.x1 - tileRect.x1)];
+                    for (int x = inter.x1; x < inter.x2; ++x, ++pix) {
+                        RectI srcPixels;
+                        bool rendered = false;
+                        if ( RectI(x * 2, y * 2, x * 2 + 2, y * 2 + 2).intersect(other._bounds, &srcPixels) ) {
+                            rendered = other.getStatesInRect(srcPixels) == eBitmapStateFlagRendered;
+                        }
+                        *pix = rendered ? eBitmapStateRendered : eBitmapStateUnrendered;
+                    }
+                }
+                collapseMixedTile(tx, ty);
+            }
         }
     }
-}
+} // Bitmap::halveFrom
 
 template <typename PIX, bool doPremult>
 void
@@ -2325,6 +2461,36 @@ Image::premultInternal(const RectI& roi)
 
     int srcRowElements = 4 * _bounds.width();
     PIX* dstPix = (PIX*)acc.pixelAt(renderWindow.x1, renderWindow.y1);
+
+    if (getBitDepth() == eImageBitDepthFloat) {
+        ///Float images are processed by whole scan-lines with the SIMD kernels
+        for (int y = renderWindow.y1; y < renderWindow.y2; ++y, dstPix += srcRowElements) {
+            if (doPremult) {
+                Color::premultRGBARow( (float*)dstPix, renderWindow.x2 - renderWindow.x1 );
+            } else {
+                Color::unpremultRGBARow( (float*)dstPix, renderWindow.x2 - renderWindow.x1 );
+            }
+        }
+
+        return;
+    }
+
+    if (getBitDepth() == eImageBitDepthHalf) {
+        ///Half images are converted to float by scan-lines, processed and converted back
+        std::vector<float> row( (renderWindow.x2 - renderWindow.x1) * 4 );
+        for (int y = renderWindow.y1; y < renderWindow.y2; ++y, dstPix += srcRowElements) {
+            Color::halfToFloatRow( (const unsigned short*)dstPix, (int)row.size(), &row[0] );
+            if (doPremult) {
+                Color::premultRGBARow( &row[0], renderWindow.x2 - renderWindow.x1 );
+            } else {
+                Color::unpremultRGBARow( &row[0], renderWindow.x2 - renderWindow.x1 );
+            }
+            Color::floatToHalfRow( &row[0], (int)row.size(), (unsigned short*)dstPix );
+        }
+
+        return;
+    }
+
     for ( int y = renderWindow.y1; y < renderWindow.y2; ++y, dstPix += (srcRowElements - (renderWindow.x2 - renderWindow.x1) * 4) ) {
         for (int x = renderWindow.x1; x < renderWindow.x2; ++x, dstPix += 4) {
             for (int c = 0; c < 3; ++c) {
@@ -2355,6 +2521,9 @@ Image::premultForDepth(const RectI& roi)
     case eImageBitDepthShort:
         premultInternal<unsigned short, doPremult>(roi);
         break;
+    case eImageBitDepthHalf:
+        premultInternal<Half, doPremult>(roi);
+        break;
     case eImageBitDepthFloat:
         premultInternal<float, doPremult>(roi);
         break;
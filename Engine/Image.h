@@ -29,6 +29,7 @@
 
 #include <list>
 #include <map>
+#include <vector>
 #include <algorithm> // min, max
 #include <bitset>
 
@@ -46,6 +47,7 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/RectD.h"
 #include "Engine/ViewIdx.h"
+#include "Engine/Half.h"
 #include "Engine/EngineFwd.h"
 
 
@@ -63,12 +65,42 @@ public:
     }
 };
 
+/**
+ * @brief The bitmap keeps track of the render state of each pixel of an image: not rendered (0), rendered (1) or
+ * being rendered by another thread (2, only with NATRON_ENABLE_TRIMAP).
+ * The state is stored with 2 bits per square tile of 2^tileSizeLog2 pixels, tiles being aligned on multiples of
+ * the tile size, and packed in 64-bit words so that a whole row of tiles can be scanned a word at a time.
+ * A tile whose pixels do not all share the same state is flagged as mixed and the state of each of its pixels is kept
+ * on the side until the tile becomes uniform again: this is typically only the case of the tiles lying on the border
+ * of the rectangles marked by the renders, so that the results are the same as if the state was stored per pixel.
+ **/
 class Bitmap
 {
 public:
-    Bitmap(const RectI & bounds)
-        : _bounds(bounds)
-        , _map( bounds.area() )
+
+    enum BitmapStateEnum
+    {
+        eBitmapStateUnrendered = 0,
+        eBitmapStateRendered = 1,
+        eBitmapStateRendering = 2
+    };
+
+    ///Flags returned by getStatesInRect()
+    enum BitmapStateFlagEnum
+    {
+        eBitmapStateFlagUnrendered = 1 << eBitmapStateUnrendered,
+        eBitmapStateFlagRendered = 1 << eBitmapStateRendered,
+        eBitmapStateFlagRendering = 1 << eBitmapStateRendering
+    };
+
+    Bitmap(const RectI & bounds,
+           int tileSizeLog2 = NATRON_BITMAP_TILE_SIZE_LOG2)
+        : _bounds()
+        , _tileSizeLog2(tileSizeLog2)
+        , _tilesBounds()
+        , _wordsPerRow(0)
+        , _tiles()
+        , _mixedTiles()
         , _dirtyZone()
         , _dirtyZoneSet(false)
     {
@@ -76,39 +108,42 @@ public:
         // "identities" images (i.e: images that are just a link to another image). See EffectInstance :
         // "!!!Note that if isIdentity is true it will allocate an empty image object with 0 bytes of data."
         //assert(!rod.isNull());
-        std::fill(_map.begin(), _map.end(), 0);
+        initialize(bounds, tileSizeLog2);
     }
 
     Bitmap()
         : _bounds()
-        , _map()
+        , _tileSizeLog2(NATRON_BITMAP_TILE_SIZE_LOG2)
+        , _tilesBounds()
+        , _wordsPerRow(0)
+        , _tiles()
+        , _mixedTiles()
         , _dirtyZone()
         , _dirtyZoneSet(false)
     {
     }
 
-    void initialize(const RectI & bounds)
-    {
-        _bounds = bounds;
-        _map.resize( _bounds.area() );
-
-        std::fill(_map.begin(), _map.end(), 0);
-    }
+    void initialize(const RectI & bounds, int tileSizeLog2 = NATRON_BITMAP_TILE_SIZE_LOG2);
 
     ~Bitmap()
     {
     }
 
-    void setTo1()
-    {
-        std::fill(_map.begin(), _map.end(), 1);
-    }
+    void setTo1();
 
     const RectI & getBounds() const
     {
         return _bounds;
     }
 
+    int getTileSizeLog2() const
+    {
+        return _tileSizeLog2;
+    }
+
+    ///Returns the number of bytes used to store the states
+    std::size_t getMemorySize() const;
+
 #if NATRON_ENABLE_TRIMAP
     void minimalNonMarkedRects_trimap(const RectI & roi, std::list<RectI>& ret, bool* isBeingRenderedElsewhere) const;
     RectI minimalNonMarkedBbox_trimap(const RectI & roi, bool* isBeingRenderedElsewhere) const;
@@ -130,23 +165,24 @@ public:
 
     void swap(Bitmap& other);
 
-    const char* getBitmap() const
-    {
-        return &_map.front();
-    }
-
-    char* getBitmap()
-    {
-        return &_map.front();
-    }
+    ///Returns the state of the pixel (x,y) which must lie in the bounds
+    BitmapStateEnum getPixelState(int x, int y) const;
 
-    const char* getBitmapAt(int x, int y) const;
-    char* getBitmapAt(int x, int y);
+    ///Returns a combination of BitmapStateFlagEnum of all the states found in rect, which must lie in the bounds
+    int getStatesInRect(const RectI& rect) const;
 
     void copyRowPortion(int x1, int x2, int y, const Bitmap& other);
 
     void copyBitmapPortion(const RectI& roi, const Bitmap& other);
 
+    /**
+     * @brief Set the state of the pixels of roi from the 2x2 corresponding pixels of other, which is twice as large:
+     * a pixel is rendered only if all the corresponding pixels of other are rendered. Pixels being rendered in other
+     * are considered as not rendered, otherwise the caller would have to wait for the other render to be finished
+     * and then downscale again.
+     **/
+    void halveFrom(const Bitmap& other, const RectI& roi);
+
     void setDirtyZone(const RectI& zone)
     {
         _dirtyZone = zone;
@@ -154,8 +190,72 @@ public:
     }
 
 private:
+
+    int tileIndex(int coord) const
+    {
+        return coord >= 0 ? (coord >> _tileSizeLog2) : -( ( -coord + (1 << _tileSizeLog2) - 1 ) >> _tileSizeLog2 );
+    }
+
+    RectI getTileRect(int tx, int ty) const;
+
+    int getTileState(int tx, int ty) const;
+    void setTileState(int tx, int ty, int state);
+
+    ///Key of the tile in _mixedTiles
+    int getTileKey(int tx, int ty) const
+    {
+        return (ty - _tilesBounds.y1) * _tilesBounds.width() + (tx - _tilesBounds.x1);
+    }
+
+    ///Set the state of the tiles [tx1,tx2) of the row of tiles ty, a word at a time
+    void setTileRowStates(int ty, int tx1, int tx2, int state);
+
+    ///Returns the states found in the intersection of rect and the tiles [tx1,tx2) of the row of tiles ty
+    int getTileRowStates(int ty, int tx1, int tx2, const RectI& rect) const;
+
+    ///Set the state of the intersection of the tile (tx,ty) and rect
+    void fillTile(int tx, int ty, const RectI& rect, int state);
+
+    ///Flag the tile (tx,ty) as mixed and returns the states of its pixels
+    char* getMixedTilePixels(int tx, int ty);
+
+    ///If all the pixels of the mixed tile (tx,ty) have the same state, flag the tile with that state
+    void collapseMixedTile(int tx, int ty);
+
+    void fill(const RectI& roi, int state);
+
+    /**
+     * @brief Walks the lines of rect (rows if horizontal is true, columns otherwise) from its start if forward is true
+     * or from its end otherwise, and returns the number of consecutive lines which have none of the states in rejectFlags.
+     * isBeingRenderedElsewhere is set if one of the accepted lines has one of the states in flagsIfAccepted, or if
+     * the line that stopped the walk has one of the states in flagsIfRejected.
+     **/
+    int countAcceptedLines(const RectI& rect,
+                           bool horizontal,
+                           bool forward,
+                           int rejectFlags,
+                           int flagsIfAccepted,
+                           int flagsIfRejected,
+                           bool* isBeingRenderedElsewhere) const;
+
+    template <int trimap>
+    RectI minimalNonMarkedBbox_internal(const RectI& roi, bool* isBeingRenderedElsewhere) const;
+
+    template <int trimap>
+    void minimalNonMarkedRects_internal(const RectI & roi, std::list<RectI>& ret, bool* isBeingRenderedElsewhere) const;
+
     RectI _bounds;
-    std::vector<char> _map;
+    int _tileSizeLog2;
+
+    ///The tiles covering _bounds, in tile coordinates
+    RectI _tilesBounds;
+    int _wordsPerRow;
+
+    ///2 bits per tile, each row of tiles starting on a new word
+    std::vector<U64> _tiles;
+
+    ///The state of each pixel of the mixed tiles, indexed by getTileKey()
+    std::map<int, std::vector<char> > _mixedTiles;
 
     /**
      * This represents the zone that has potentially something to render. In minimalNonMarkedRects
@@ -297,7 +397,7 @@ public:
         std::size_t dt = dataSize();
         bool got = _entryLock.tryLockForRead();
 
-        dt += _bitmap.getBounds().area();
+        dt += _bitmap.getMemorySize();
         if (got) {
             _entryLock.unlock();
         }
@@ -404,14 +504,6 @@ public:
 
             return img->pixelAt(x, y);
         }
-
-        const char* bitmapAt(int x,
-                             int y) const
-        {
-            assert(img);
-
-            return img->getBitmapAt(x, y);
-        }
     };
 
     /**
@@ -454,14 +546,6 @@ public:
         {
             return img->pixelAt(x, y);
         }
-
-        char* bitmapAt(int x,
-                       int y) const
-        {
-            assert(img);
-
-            return img->getBitmapAt(x, y);
-        }
     };
 
     ReadAccess getReadRights() const
@@ -486,18 +570,6 @@ private:
      * of an image.
      **/
 
-    const char* getBitmapAt(int x,
-                            int y) const
-    {
-        return this->_bitmap.getBitmapAt(x, y);
-    }
-
-    char* getBitmapAt(int x,
-                      int y)
-    {
-        return this->_bitmap.getBitmapAt(x, y);
-    }
-
     /**
      * @brief Access pixels. The pointer must be cast to the appropriate type afterwards.
      **/
@@ -1061,6 +1133,10 @@ template<>
 inline float
 Image::clampIfInt(float v) { return v; }
 
+template<>
+inline Half
+Image::clampIfInt(float v) { return Half(v); }
+
 NATRON_NAMESPACE_EXIT;
 
 #endif // NATRON_ENGINE_IMAGE_H
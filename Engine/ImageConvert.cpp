@@ -26,7 +26,9 @@
 
 #include <algorithm> // min, max
 #include <cassert>
+#include <cstring> // for std::memcpy
 #include <stdexcept>
+#include <vector>
 
 #ifndef Q_MOC_RUN
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -38,6 +40,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include "Engine/AppManager.h"
 #include "Engine/Lut.h"
+#include "Engine/LutSIMD.h"
 
 NATRON_NAMESPACE_ENTER;
 
@@ -108,6 +111,255 @@ Image::convertPixelDepth(float pix)
     return pix;
 }
 
+template <>
+Half
+Image::convertPixelDepth(unsigned char pix)
+{
+    return Half( Color::intToFloat<256>(pix) );
+}
+
+template <>
+Half
+Image::convertPixelDepth(unsigned short pix)
+{
+    return Half( Color::intToFloat<65536>(pix) );
+}
+
+template <>
+Half
+Image::convertPixelDepth(float pix)
+{
+    return Half(pix);
+}
+
+template <>
+Half
+Image::convertPixelDepth(Half pix)
+{
+    return pix;
+}
+
+template <>
+unsigned char
+Image::convertPixelDepth(Half pix)
+{
+    return (unsigned char)Color::floatToInt<256>(pix);
+}
+
+template <>
+unsigned short
+Image::convertPixelDepth(Half pix)
+{
+    return (unsigned short)Color::floatToInt<65536>(pix);
+}
+
+template <>
+float
+Image::convertPixelDepth(Half pix)
+{
+    return pix;
+}
+
+///Converts n contiguous values, same as calling convertPixelDepth on each of them.
+///The conversions from/to float use the SIMD kernels of LutSIMD.h
+template <typename SRCPIX, typename DSTPIX>
+static void
+convertPixelDepthRow(const SRCPIX* src,
+                     DSTPIX* dst,
+                     int n)
+{
+    for (int i = 0; i < n; ++i) {
+        dst[i] = Image::convertPixelDepth<SRCPIX, DSTPIX>(src[i]);
+    }
+}
+
+template <typename PIX>
+static void
+copyPixelsRow(const PIX* src,
+              PIX* dst,
+              int n)
+{
+    std::memcpy( dst, src, n * sizeof(PIX) );
+}
+
+template <>
+void
+convertPixelDepthRow(const unsigned char* src,
+                     unsigned char* dst,
+                     int n)
+{
+    copyPixelsRow(src, dst, n);
+}
+
+template <>
+void
+convertPixelDepthRow(const unsigned short* src,
+                     unsigned short* dst,
+                     int n)
+{
+    copyPixelsRow(src, dst, n);
+}
+
+template <>
+void
+convertPixelDepthRow(const float* src,
+                     float* dst,
+                     int n)
+{
+    copyPixelsRow(src, dst, n);
+}
+
+template <>
+void
+convertPixelDepthRow(const Half* src,
+                     Half* dst,
+                     int n)
+{
+    copyPixelsRow(src, dst, n);
+}
+
+template <>
+void
+convertPixelDepthRow(const Half* src,
+                     float* dst,
+                     int n)
+{
+    Color::halfToFloatRow( (const unsigned short*)src, n, dst );
+}
+
+template <>
+void
+convertPixelDepthRow(const float* src,
+                     Half* dst,
+                     int n)
+{
+    Color::floatToHalfRow( src, n, (unsigned short*)dst );
+}
+
+template <>
+void
+convertPixelDepthRow(const unsigned char* src,
+                     float* dst,
+                     int n)
+{
+    Color::uint8ToFloatRow(src, n, dst);
+}
+
+template <>
+void
+convertPixelDepthRow(const unsigned short* src,
+                     float* dst,
+                     int n)
+{
+    Color::uint16ToFloatRow(src, n, dst);
+}
+
+template <typename DSTPIX, int maxValue>
+static void
+convertFloatPixelDepthRow(const float* src,
+                          DSTPIX* dst,
+                          int n)
+{
+    // process by chunks to keep the intermediate buffer on the stack
+    const int chunkSize = 256;
+    int values[chunkSize];
+
+    for (int i = 0; i < n; i += chunkSize) {
+        int count = std::min(chunkSize, n - i);
+        Color::floatToIntRow(src + i, count, maxValue, values);
+        for (int j = 0; j < count; ++j) {
+            dst[i + j] = (DSTPIX)values[j];
+        }
+    }
+}
+
+template <>
+void
+convertPixelDepthRow(const float* src,
+                     unsigned char* dst,
+                     int n)
+{
+    convertFloatPixelDepthRow<unsigned char, 255>(src, dst, n);
+}
+
+template <>
+void
+convertPixelDepthRow(const float* src,
+                     unsigned short* dst,
+                     int n)
+{
+    convertFloatPixelDepthRow<unsigned short, 65535>(src, dst, n);
+}
+
+///Half <-> integer conversions go through float, by chunks
+template <typename DSTPIX, int maxValue>
+static void
+convertHalfPixelDepthRow(const Half* src,
+                         DSTPIX* dst,
+                         int n)
+{
+    const int chunkSize = 256;
+    float values[chunkSize];
+
+    for (int i = 0; i < n; i += chunkSize) {
+        int count = std::min(chunkSize, n - i);
+        Color::halfToFloatRow( (const unsigned short*)(src + i), count, values );
+        convertFloatPixelDepthRow<DSTPIX, maxValue>(values, dst + i, count);
+    }
+}
+
+template <typename SRCPIX>
+static void
+convertToHalfPixelDepthRow(const SRCPIX* src,
+                           Half* dst,
+                           int n)
+{
+    const int chunkSize = 256;
+    float values[chunkSize];
+
+    for (int i = 0; i < n; i += chunkSize) {
+        int count = std::min(chunkSize, n - i);
+        convertPixelDepthRow<SRCPIX, float>(src + i, values, count);
+        Color::floatToHalfRow( values, count, (unsigned short*)(dst + i) );
+    }
+}
+
+template <>
+void
+convertPixelDepthRow(const Half* src,
+                     unsigned char* dst,
+                     int n)
+{
+    convertHalfPixelDepthRow<unsigned char, 255>(src, dst, n);
+}
+
+template <>
+void
+convertPixelDepthRow(const Half* src,
+                     unsigned short* dst,
+                     int n)
+{
+    convertHalfPixelDepthRow<unsigned short, 65535>(src, dst, n);
+}
+
+template <>
+void
+convertPixelDepthRow(const unsigned char* src,
+                     Half* dst,
+                     int n)
+{
+    convertToHalfPixelDepthRow<unsigned char>(src, dst, n);
+}
+
+template <>
+void
+convertPixelDepthRow(const unsigned short* src,
+                     Half* dst,
+                     int n)
+{
+    convertToHalfPixelDepthRow<unsigned short>(src, dst, n);
+}
+
 static const Color::Lut*
 lutFromColorspace(ViewerColorSpaceEnum cs)
 {
@@ -162,6 +414,29 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
     if ( intersection.isNull() ) {
         return;
     }
+
+    if (!srcLut && !dstLut) {
+        ///No color-space conversion and no error diffusion: convert whole scan-lines at once
+        for (int y = 0; y < intersection.height(); ++y) {
+            const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(intersection.x1, intersection.y1 + y);
+            DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(intersection.x1, intersection.y1 + y);
+            convertPixelDepthRow<SRCPIX, DSTPIX>(srcPixels, dstPixels, intersection.width() * nComp);
+            if (copyBitmap) {
+                dstImg.copyBitmapRowPortion(intersection.x1, intersection.x2, intersection.y1 + y, srcImg);
+            }
+        }
+
+        return;
+    }
+
+    ///Linear float to 8-bit: the look-up of the destination color-space is done on whole scan-lines
+    ///before the error diffusion
+    const bool useRowLut = dstLut && !srcLut && srcDepth == eImageBitDepthFloat && dstDepth == eImageBitDepthByte;
+    std::vector<unsigned short> rowLut;
+    if (useRowLut) {
+        rowLut.resize(intersection.width() * nComp);
+    }
+
     for (int y = 0; y < intersection.height(); ++y) {
         // coverity[dont_call]
         int start = rand() % intersection.width();
@@ -170,6 +445,10 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
         const SRCPIX* srcStart = srcPixels;
         DSTPIX* dstStart = dstPixels;
 
+        if (useRowLut) {
+            dstLut->toColorSpaceUint8xxFromLinearFloatFast( (const float*)srcImg.pixelAt(intersection.x1, intersection.y1 + y), intersection.width() * nComp, &rowLut[0] );
+        }
+
         for (int backward = 0; backward < 2; ++backward) {
             int x = backward ? start - 1 : start;
             int end = backward ? -1 : intersection.width();
@@ -202,11 +481,15 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
 
                         if (dstDepth == eImageBitDepthByte) {
                             ///small increase in perf we use Luts. This should be anyway the most used case.
-                            error[k] = (error[k] & 0xff) + ( dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
-                                                             Color::floatToInt<0xff01>(pixFloat) );
+                            if (useRowLut) {
+                                error[k] = (error[k] & 0xff) + rowLut[x * nComp + k];
+                            } else {
+                                error[k] = (error[k] & 0xff) + ( dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
+                                                                 Color::floatToInt<0xff01>(pixFloat) );
+                            }
                             pix = error[k] >> 8;
                         } else if (dstDepth == eImageBitDepthShort) {
-                            pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
+                            pix = dstLut ? DSTPIX( dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) ) :
                                   convertPixelDepth<float, DSTPIX>(pixFloat);
                         } else {
                             if (dstLut) {
@@ -297,7 +580,7 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
         }
         for (int y = 0; y < renderWindow.height();
              ++y, dstPixels += dstRowSize) {
-            std::fill(dstPixels, dstPixels + renderWindow.width() * dstNComps, 0.);
+            std::fill( dstPixels, dstPixels + renderWindow.width() * dstNComps, DSTPIX(0) );
         }
 
         return;
@@ -306,6 +589,25 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
     const Color::Lut* const srcLut = useColorspaces ? lutFromColorspace( (ViewerColorSpaceEnum)srcColorSpace ) : 0;
     const Color::Lut* const dstLut = useColorspaces ? lutFromColorspace( (ViewerColorSpaceEnum)dstColorSpace ) : 0;
 
+    ///Float RGB <-> RGBA without color-space conversion is a plain component shuffle, done on whole scan-lines
+    if ( (srcImg.getBitDepth() == eImageBitDepthFloat) && (dstImg.getBitDepth() == eImageBitDepthFloat) && !srcLut && !dstLut &&
+         ( ( (srcNComps == 3) && (dstNComps == 4) ) || ( (srcNComps == 4) && (dstNComps == 3) ) ) ) {
+        for (int y = 0; y < renderWindow.height(); ++y) {
+            const float* srcPixels = (const float*)srcImg.pixelAt(renderWindow.x1, renderWindow.y1 + y);
+            float* dstPixels = (float*)dstImg.pixelAt(renderWindow.x1, renderWindow.y1 + y);
+            if (srcNComps == 3) {
+                Color::shuffleRGBToRGBARow(srcPixels, renderWindow.width(), useAlpha0 ? 0.f : 1.f, dstPixels);
+            } else {
+                Color::shuffleRGBAToRGBRow(srcPixels, renderWindow.width(), dstPixels);
+            }
+        }
+        if (copyBitmap) {
+            dstImg.copyBitmapPortion(renderWindow, srcImg);
+        }
+
+        return;
+    }
+
     for (int y = 0; y < renderWindow.height(); ++y) {
         ///Start of the line for error diffusion
         // coverity[dont_call]
@@ -340,11 +642,11 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
                         break;
                     case 3:
                         // RGB is opaque, so no alpha, unless channelForAlpha is 0-2
-                        pix = convertPixelDepth<SRCPIX, DSTPIX>(channelForAlpha == -1 ? 0. : srcPixels[channelForAlpha]);
+                        pix = convertPixelDepth<SRCPIX, DSTPIX>(channelForAlpha == -1 ? SRCPIX(0) : srcPixels[channelForAlpha]);
                         break;
                     case 2:
                         // XY is opaque unless channelForAlpha is  0-1
-                        pix = convertPixelDepth<SRCPIX, DSTPIX>(channelForAlpha == -1 ? 0. : srcPixels[channelForAlpha]);
+                        pix = convertPixelDepth<SRCPIX, DSTPIX>(channelForAlpha == -1 ? SRCPIX(0) : srcPixels[channelForAlpha]);
                         break;
                     case 1:
                         // just copy alpha disregarding channelForAlpha
@@ -422,7 +724,7 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
                                                                      Color::floatToInt<0xff01>(pixFloat) );
                                     pix = error[k] >> 8;
                                 } else if (dstMaxValue == 65535) {
-                                    pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
+                                    pix = dstLut ? DSTPIX( dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) ) :
                                           convertPixelDepth<float, DSTPIX>(pixFloat);
                                 } else {
                                     if (dstLut) {
@@ -695,6 +997,9 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                              dstColorSpace, copyBitmap);
                 break;
             case eImageBitDepthHalf:
+                convertToFormatInternal_sameComps<Half, unsigned char, 1, 255>(renderWindow, *this, *dstImg,
+                                                                               srcColorSpace,
+                                                                               dstColorSpace, copyBitmap);
                 break;
             case eImageBitDepthFloat:
                 convertToFormatInternal_sameComps<float, unsigned char, 1, 255>(renderWindow, *this, *dstImg,
@@ -721,6 +1026,9 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                                 dstColorSpace, copyBitmap);
                 break;
             case eImageBitDepthHalf:
+                convertToFormatInternal_sameComps<Half, unsigned short, 1, 65535>(renderWindow, *this, *dstImg,
+                                                                                  srcColorSpace,
+                                                                                  dstColorSpace, copyBitmap);
                 break;
             case eImageBitDepthFloat:
                 convertToFormatInternal_sameComps<float, unsigned short, 1, 65535>(renderWindow, *this, *dstImg,
@@ -733,8 +1041,34 @@ Image::convertToFormatCommon(const RectI & renderWindow,
             break;
         }
 
-        case eImageBitDepthHalf:
+        case eImageBitDepthHalf: {
+            switch ( getBitDepth() ) {
+            case eImageBitDepthByte:
+                convertToFormatInternal_sameComps<unsigned char, Half, 255, 1>(renderWindow, *this, *dstImg,
+                                                                               srcColorSpace,
+                                                                               dstColorSpace, copyBitmap);
+                break;
+            case eImageBitDepthShort:
+                convertToFormatInternal_sameComps<unsigned short, Half, 65535, 1>(renderWindow, *this, *dstImg,
+                                                                                  srcColorSpace,
+                                                                                  dstColorSpace, copyBitmap);
+                break;
+            case eImageBitDepthHalf:
+                ///Same as a copy
+                convertToFormatInternal_sameComps<Half, Half, 1, 1>(renderWindow, *this, *dstImg,
+                                                                    srcColorSpace,
+                                                                    dstColorSpace, copyBitmap);
+                break;
+            case eImageBitDepthFloat:
+                convertToFormatInternal_sameComps<float, Half, 1, 1>(renderWindow, *this, *dstImg,
+                                                                     srcColorSpace,
+                                                                     dstColorSpace, copyBitmap);
+                break;
+            case eImageBitDepthNone:
+                break;
+            }
             break;
+        }
 
         case eImageBitDepthFloat: {
             switch ( getBitDepth() ) {
@@ -749,6 +1083,9 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                    dstColorSpace, copyBitmap);
                 break;
             case eImageBitDepthHalf:
+                convertToFormatInternal_sameComps<Half, float, 1, 1>(renderWindow, *this, *dstImg,
+                                                                     srcColorSpace,
+                                                                     dstColorSpace, copyBitmap);
                 break;
             case eImageBitDepthFloat:
                 ///Same as a copy
@@ -786,6 +1123,12 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                            copyBitmap, requiresUnpremult);
                 break;
             case eImageBitDepthHalf:
+                convertToFormatInternalForDepth<Half, unsigned char, 1, 255>(renderWindow, *this, *dstImg,
+                                                                             srcColorSpace,
+                                                                             dstColorSpace,
+                                                                             channelForAlpha,
+                                                                             useAlpha0,
+                                                                             copyBitmap, requiresUnpremult);
                 break;
             case eImageBitDepthFloat:
                 convertToFormatInternalForDepth<float, unsigned char, 1, 255>(renderWindow, *this, *dstImg,
@@ -822,6 +1165,12 @@ Image::convertToFormatCommon(const RectI & renderWindow,
 
                 break;
             case eImageBitDepthHalf:
+                convertToFormatInternalForDepth<Half, unsigned short, 1, 65535>(renderWindow, *this, *dstImg,
+                                                                                srcColorSpace,
+                                                                                dstColorSpace,
+                                                                                channelForAlpha,
+                                                                                useAlpha0,
+                                                                                copyBitmap, requiresUnpremult);
                 break;
             case eImageBitDepthFloat:
                 convertToFormatInternalForDepth<float, unsigned short, 1, 65535>(renderWindow, *this, *dstImg,
@@ -836,8 +1185,45 @@ Image::convertToFormatCommon(const RectI & renderWindow,
             }
             break;
         }
-        case eImageBitDepthHalf:
+        case eImageBitDepthHalf: {
+            switch ( getBitDepth() ) {
+            case eImageBitDepthByte:
+                convertToFormatInternalForDepth<unsigned char, Half, 255, 1>(renderWindow, *this, *dstImg,
+                                                                             srcColorSpace,
+                                                                             dstColorSpace,
+                                                                             channelForAlpha,
+                                                                             useAlpha0,
+                                                                             copyBitmap, requiresUnpremult);
+                break;
+            case eImageBitDepthShort:
+                convertToFormatInternalForDepth<unsigned short, Half, 65535, 1>(renderWindow, *this, *dstImg,
+                                                                                srcColorSpace,
+                                                                                dstColorSpace,
+                                                                                channelForAlpha,
+                                                                                useAlpha0,
+                                                                                copyBitmap, requiresUnpremult);
+                break;
+            case eImageBitDepthHalf:
+                convertToFormatInternalForDepth<Half, Half, 1, 1>(renderWindow, *this, *dstImg,
+                                                                  srcColorSpace,
+                                                                  dstColorSpace,
+                                                                  channelForAlpha,
+                                                                  useAlpha0,
+                                                                  copyBitmap, requiresUnpremult);
+                break;
+            case eImageBitDepthFloat:
+                convertToFormatInternalForDepth<float, Half, 1, 1>(renderWindow, *this, *dstImg,
+                                                                   srcColorSpace,
+                                                                   dstColorSpace,
+                                                                   channelForAlpha,
+                                                                   useAlpha0,
+                                                                   copyBitmap, requiresUnpremult);
+                break;
+            case eImageBitDepthNone:
+                break;
+            }
             break;
+        }
         case eImageBitDepthFloat: {
             switch ( getBitDepth() ) {
             case eImageBitDepthByte:
@@ -858,6 +1244,12 @@ Image::convertToFormatCommon(const RectI & renderWindow,
 
                 break;
             case eImageBitDepthHalf:
+                convertToFormatInternalForDepth<Half, float, 1, 1>(renderWindow, *this, *dstImg,
+                                                                   srcColorSpace,
+                                                                   dstColorSpace,
+                                                                   channelForAlpha,
+                                                                   useAlpha0,
+                                                                   copyBitmap, requiresUnpremult);
                 break;
             case eImageBitDepthFloat:
                 convertToFormatInternalForDepth<float, float, 1, 1>(renderWindow, *this, *dstImg,
@@ -33,12 +33,14 @@
 #include <QtCore/QByteArray>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
 #include <QtCore/QDebug>
 
 #include "Global/GlobalDefines.h"
 
 #include "Engine/AppInstance.h"
 #include "Engine/AppManager.h"
+#include "Engine/CompiledExpression.h"
 #include "Engine/Curve.h"
 #include "Engine/DockablePanelI.h"
 #include "Engine/Hash64.h"
@@ -224,8 +226,15 @@ struct Expr
 
     //PyObject* code;
 
+    ///Set if the expression can be evaluated without Python
+    CompiledExpressionPtr compiled;
+
+    ///Why the expression was last evaluated by Python instead of the compiled expression
+    std::string fallbackReason;
+    U64 nativeEvaluations, pythonEvaluations;
+
     Expr()
-        : expression(), originalExpression(), exprInvalid(), hasRet(false) /*, code(0)*/ {}
+        : expression(), originalExpression(), exprInvalid(), hasRet(false) /*, code(0)*/, compiled(), fallbackReason(), nativeEvaluations(0), pythonEvaluations(0) {}
 };
 
 struct KnobHelperPrivate
@@ -438,6 +447,9 @@ KnobHelper::setHolder(KnobHolder* holder)
     _imp->holder = holder;
 }
 
+// The number of expressions, of all knobs, being evaluated by the current thread
+static QThreadStorage<int> threadExpressionRecursionLevel;
+
 void
 KnobHelper::incrementExpressionRecursionLevel() const
 {
@@ -445,6 +457,7 @@ KnobHelper::incrementExpressionRecursionLevel() const
 
     assert(tls);
     ++tls->expressionRecursionLevel;
+    ++threadExpressionRecursionLevel.localData();
 }
 
 void
@@ -455,6 +468,13 @@ KnobHelper::decrementExpressionRecursionLevel() const
     assert(tls);
     assert(tls->expressionRecursionLevel > 0);
     --tls->expressionRecursionLevel;
+    --threadExpressionRecursionLevel.localData();
+}
+
+bool
+KnobHelper::isEvaluatingExpressionInCurrentThread()
+{
+    return threadExpressionRecursionLevel.hasLocalData() && threadExpressionRecursionLevel.localData() > 0;
 }
 
 int
@@ -2614,6 +2634,19 @@ KnobHelper::setExpressionInternal(int dimension,
         }
     }
 
+    // Simple expressions are compiled so that they can be evaluated without taking the Python GIL
+    CompiledExpressionPtr compiled;
+    std::string fallbackReason;
+    if ( !exprInvalid.empty() ) {
+        fallbackReason = "the expression is invalid";
+    } else if (hasRetVariable) {
+        fallbackReason = "the expression uses the ret variable";
+    } else if ( !isTypePOD() ) {
+        fallbackReason = "the parameter is not numeric";
+    } else {
+        compiled = CompiledExpression::compile(expression, shared_from_this(), dimension, &fallbackReason);
+    }
+
     //Set internal fields
 
     {
@@ -2622,6 +2655,8 @@ KnobHelper::setExpressionInternal(int dimension,
         _imp->expressions[dimension].expression = exprCpy;
         _imp->expressions[dimension].originalExpression = expression;
         _imp->expressions[dimension].exprInvalid = exprInvalid;
+        _imp->expressions[dimension].compiled = compiled;
+        _imp->expressions[dimension].fallbackReason = fallbackReason;
 
         ///This may throw an exception upon failure
         //NATRON_PYTHON_NAMESPACE::compilePyScript(exprCpy, &_imp->expressions[dimension].code);
@@ -2714,6 +2749,10 @@ KnobHelper::clearExpression(int dimension,
         _imp->expressions[dimension].expression.clear();
         _imp->expressions[dimension].originalExpression.clear();
         _imp->expressions[dimension].exprInvalid.clear();
+        _imp->expressions[dimension].compiled.reset();
+        _imp->expressions[dimension].fallbackReason.clear();
+        _imp->expressions[dimension].nativeEvaluations = 0;
+        _imp->expressions[dimension].pythonEvaluations = 0;
         //Py_XDECREF(_imp->expressions[dimension].code); //< new ref
         //_imp->expressions[dimension].code = 0;
     }
@@ -2865,6 +2904,63 @@ KnobHelper::executeExpression(double time,
     return true;
 }
 
+bool
+KnobHelper::evaluateCompiledExpression(double time,
+                                       ViewIdx view,
+                                       int dimension,
+                                       double* value,
+                                       bool* isInt) const
+{
+    CompiledExpressionPtr compiled;
+    {
+        QMutexLocker k(&_imp->expressionMutex);
+        compiled = _imp->expressions[dimension].compiled;
+        if (!compiled) {
+            ++_imp->expressions[dimension].pythonEvaluations;
+
+            return false;
+        }
+    }
+
+    CompiledExpression::Value ret;
+    std::string reason;
+    bool ok = compiled->evaluate(time, view, &ret, &reason);
+    QMutexLocker k(&_imp->expressionMutex);
+    if (_imp->expressions[dimension].compiled != compiled) {
+        // The expression was changed meanwhile
+        return false;
+    }
+    if (ok) {
+        ++_imp->expressions[dimension].nativeEvaluations;
+        *value = ret.value;
+        *isInt = ret.isInt;
+    } else {
+        ++_imp->expressions[dimension].pythonEvaluations;
+        _imp->expressions[dimension].fallbackReason = reason;
+    }
+
+    return ok;
+}
+
+bool
+KnobHelper::getExpressionEvaluationStats(int dimension,
+                                         U64* nativeEvaluations,
+                                         U64* pythonEvaluations,
+                                         std::string* fallbackReason) const
+{
+    if (dimension == -1) {
+        dimension = 0;
+    }
+    QMutexLocker k(&_imp->expressionMutex);
+    const Expr& expr = _imp->expressions[dimension];
+
+    *nativeEvaluations = expr.nativeEvaluations;
+    *pythonEvaluations = expr.pythonEvaluations;
+    *fallbackReason = expr.fallbackReason;
+
+    return bool(expr.compiled);
+}
+
 std::string
 KnobHelper::getExpression(int dimension) const
 {
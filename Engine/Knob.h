@@ -38,6 +38,7 @@
 
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
 #include <QtCore/QString>
 #include <QtCore/QCoreApplication>
 
@@ -703,6 +704,14 @@ public:
      **/
     virtual bool getExpressionDependencies(int dimension, std::list<std::pair<KnobWPtr, int> >& dependencies) const = 0;
 
+    /**
+     * @brief Returns whether the expression at the given dimension could be compiled to be evaluated without Python.
+     * @param nativeEvaluations[out] The number of times the expression was evaluated without Python
+     * @param pythonEvaluations[out] The number of times the expression was evaluated by Python
+     * @param fallbackReason[out] Why the expression could not be compiled, or why the last evaluation fell back to Python
+     **/
+    virtual bool getExpressionEvaluationStats(int dimension, U64* nativeEvaluations, U64* pythonEvaluations, std::string* fallbackReason) const = 0;
+
 
     /**
      * @brief Calls setValueAtTime with a reason of eValueChangedReasonUserEdited.
@@ -1448,6 +1457,7 @@ public:
 
     virtual bool isExpressionUsingRetVariable(int dimension = 0) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool getExpressionDependencies(int dimension, std::list<std::pair<KnobWPtr, int> >& dependencies) const OVERRIDE FINAL;
+    virtual bool getExpressionEvaluationStats(int dimension, U64* nativeEvaluations, U64* pythonEvaluations, std::string* fallbackReason) const OVERRIDE FINAL;
     virtual std::string getExpression(int dimension) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual const std::vector< boost::shared_ptr<Curve>  > & getCurves() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual void setAnimationEnabled(bool val) OVERRIDE FINAL;
@@ -1573,6 +1583,13 @@ protected:
     ///The return value must be Py_DECRREF
     bool executeExpression(double time, ViewIdx view, int dimension, PyObject** ret, std::string* error) const;
 
+    /**
+     * @brief Evaluates the expression without Python if it could be compiled. This does not take the GIL.
+     * Returns false if the expression must be evaluated with executeExpression instead.
+     * @param isInt[out] Whether the result is an int or a bool in Python, or a float
+     **/
+    bool evaluateCompiledExpression(double time, ViewIdx view, int dimension, double* value, bool* isInt) const;
+
 public:
 
     virtual std::pair<int, KnobPtr > getMaster(int dimension) const OVERRIDE FINAL WARN_UNUSED_RETURN;
@@ -1597,6 +1614,11 @@ public:
 
     int getExpressionRecursionLevel() const;
 
+    /**
+     * @brief Returns true if the current thread is evaluating the expression of any knob
+     **/
+    static bool isEvaluatingExpressionInCurrentThread();
+
     class ExprRecursionLevel_RAII
     {
         const KnobHelper* _k;
@@ -1727,11 +1749,13 @@ public:
 
 
     /*
-       For each dimension, the results of the expressions at a given pair <frame, time> is stored so
-       that we're able to get the same value again for the same render.
+       For each dimension, the results of the expressions at a given pair <frame, view> is stored so
+       that we're able to get the same value again for the same render, and so that all the threads
+       rendering the same frame share a single evaluation of the expression.
        Of course, this saved in the project to retrieve the same values between 2 runs of the project.
      */
-    typedef std::map<double, T> FrameValueMap;
+    typedef std::pair<double, int> ExpressionResultKey; //< <time, view>
+    typedef std::map<ExpressionResultKey, T> FrameValueMap;
     typedef std::vector<FrameValueMap> ExprResults;
 
 
@@ -2094,8 +2118,24 @@ private:
         QMutexLocker k(&_valueMutex);
 
         _exprRes[dimension].clear();
+        ++_exprResAge[dimension];
     }
 
+    /**
+     * @brief Returns true and the cached result of the expression if it was already evaluated for the given key.
+     * Otherwise, returns false and the caller must evaluate the expression then call endExpressionEvaluation.
+     * If another thread is evaluating the expression for the same key, this waits for its result instead.
+     * @param age[out] The age of the results of the dimension, to pass to endExpressionEvaluation
+     * @param pending[out] True if the key was marked as being evaluated by the caller
+     **/
+    bool beginExpressionEvaluation(int dimension, const ExpressionResultKey& key, T* ret, U64* age, bool* pending);
+
+    /**
+     * @brief Caches the result of the expression, unless the results were cleared since beginExpressionEvaluation,
+     * and wakes up the threads waiting for it. result is NULL if the expression failed.
+     **/
+    void endExpressionEvaluation(int dimension, const ExpressionResultKey& key, U64 age, bool pending, const T* result);
+
 
 private:
 
@@ -2186,6 +2226,15 @@ private:
     std::vector<DefaultValue> _defaultValues;
     mutable ExprResults _exprRes;
 
+    ///Incremented each time the results of a dimension are cleared, protected by _valueMutex
+    std::vector<U64> _exprResAge;
+
+    ///The keys of the expressions being evaluated for each dimension.
+    ///_valueMutex is recursive and cannot be used with a wait condition, hence a separate mutex.
+    QMutex _exprPendingMutex;
+    QWaitCondition _exprPendingCond;
+    std::vector<std::set<ExpressionResultKey> > _exprPending;
+
     //Only for double and int
     mutable QReadWriteLock _minMaxMutex;
     std::vector<T>  _minimums, _maximums, _displayMins, _displayMaxs;
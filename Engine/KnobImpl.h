@@ -53,6 +53,7 @@ GCC_DIAG_ON(unused-parameter)
 
 #include "Engine/Curve.h"
 #include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
 #include "Engine/Project.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/KnobTypes.h"
@@ -107,6 +108,10 @@ Knob<T>::Knob(KnobHolder*  holder,
     , _guiValues(dimension)
     , _defaultValues(dimension)
     , _exprRes(dimension)
+    , _exprResAge(dimension)
+    , _exprPendingMutex()
+    , _exprPendingCond()
+    , _exprPending(dimension)
     , _minMaxMutex(QReadWriteLock::Recursive)
     , _minimums(dimension)
     , _maximums(dimension)
@@ -131,6 +136,12 @@ Knob<T>::signalMinMaxChanged(const T& mini,
                              const T& maxi,
                              int dimension)
 {
+    // The snapshot of the curve holds the range its values are clamped to
+    const std::vector<boost::shared_ptr<Curve> >& curves = getCurves();
+    if ( (dimension >= 0) && ( dimension < (int)curves.size() ) && curves[dimension] ) {
+        curves[dimension]->onOwnerMinMaxChanged();
+    }
+
     if (_signalSlotHandler) {
         _signalSlotHandler->s_minMaxChanged(mini, maxi, dimension);
     }
@@ -417,6 +428,47 @@ hashFunction(unsigned int a)
     return a;
 }
 
+/**
+ * @brief Same conversions as pyObjectToType for the result of a compiled expression
+ **/
+template <typename T>
+T compiledExpressionValueToType(double value, bool isInt);
+
+template <>
+inline int
+compiledExpressionValueToType(double value,
+                              bool /*isInt*/)
+{
+    return (int)value;
+}
+
+template <>
+inline bool
+compiledExpressionValueToType(double value,
+                              bool /*isInt*/)
+{
+    return value != 0.;
+}
+
+template <>
+inline double
+compiledExpressionValueToType(double value,
+                              bool /*isInt*/)
+{
+    return value;
+}
+
+template <>
+inline std::string
+compiledExpressionValueToType(double /*value*/,
+                              bool /*isInt*/)
+{
+    // String expressions are never compiled
+    assert(false);
+
+    return std::string();
+}
+
 template <typename T>
 bool
 Knob<T>::evaluateExpression(double time,
@@ -425,6 +477,16 @@ Knob<T>::evaluateExpression(double time,
                             T* value,
                             std::string* error)
 {
+    {
+        double compiledValue;
+        bool isInt;
+        if ( evaluateCompiledExpression(time, view, dimension, &compiledValue, &isInt) ) {
+            *value = compiledExpressionValueToType<T>(compiledValue, isInt);
+
+            return true;
+        }
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -447,6 +509,16 @@ Knob<T>::evaluateExpression_pod(double time,
                                 double* value,
                                 std::string* error)
 {
+    {
+        double compiledValue;
+        bool isInt;
+        if ( evaluateCompiledExpression(time, view, dimension, &compiledValue, &isInt) ) {
+            *value = isInt ? (double)(int)compiledValue : compiledValue;
+
+            return true;
+        }
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -473,6 +545,70 @@ Knob<T>::evaluateExpression_pod(double time,
     return true;
 }
 
+template <typename T>
+bool
+Knob<T>::beginExpressionEvaluation(int dimension,
+                                   const ExpressionResultKey& key,
+                                   T* ret,
+                                   U64* age,
+                                   bool* pending)
+{
+    // Never wait from the main thread, which may be running a Python script, nor from a thread already evaluating
+    // an expression: the thread evaluating the key may need a value that this thread is computing.
+    // Neither wait from a thread holding the GIL (e.g. a Python callback reading a parameter): the thread evaluating
+    // the key may need the GIL to run the expression.
+    bool canWait = !KnobHelper::isEvaluatingExpressionInCurrentThread() && ( QThread::currentThread() != qApp->thread() ) &&
+                   !appPTR->isPythonGILHeldByCurrentThread();
+    QMutexLocker l(&_exprPendingMutex);
+
+    for (;;) {
+        {
+            QMutexLocker k(&_valueMutex);
+            typename FrameValueMap::iterator found = _exprRes[dimension].find(key);
+            if ( found != _exprRes[dimension].end() ) {
+                *ret = found->second;
+
+                return true;
+            }
+            *age = _exprResAge[dimension];
+        }
+        if ( !_exprPending[dimension].count(key) ) {
+            _exprPending[dimension].insert(key);
+            *pending = true;
+
+            return false;
+        }
+        if (!canWait) {
+            *pending = false;
+
+            return false;
+        }
+        _exprPendingCond.wait(&_exprPendingMutex);
+    }
+}
+
+template <typename T>
+void
+Knob<T>::endExpressionEvaluation(int dimension,
+                                 const ExpressionResultKey& key,
+                                 U64 age,
+                                 bool pending,
+                                 const T* result)
+{
+    if (result) {
+        QMutexLocker k(&_valueMutex);
+        // If the results were cleared meanwhile, the result may have been computed with outdated values
+        if (_exprResAge[dimension] == age) {
+            _exprRes[dimension].insert( std::make_pair(key, *result) );
+        }
+    }
+    if (pending) {
+        QMutexLocker l(&_exprPendingMutex);
+        _exprPending[dimension].erase(key);
+        _exprPendingCond.wakeAll();
+    }
+}
+
 template <typename T>
 bool
 Knob<T>::getValueFromExpression(double time,
@@ -487,16 +623,13 @@ Knob<T>::getValueFromExpression(double time,
     }
 
 
-    ///Check first if a value was already computed:
+    ///Check first if a value was already computed, or wait for the thread computing it
 
-    {
-        QMutexLocker k(&_valueMutex);
-        typename FrameValueMap::iterator found = _exprRes[dimension].find(time);
-        if ( found != _exprRes[dimension].end() ) {
-            *ret = found->second;
-
-            return true;
-        }
+    ExpressionResultKey key( time, view.value() );
+    U64 age;
+    bool pending;
+    if ( beginExpressionEvaluation(dimension, key, ret, &age, &pending) ) {
+        return true;
     }
 
     bool exprWasValid = isExpressionValid(dimension, 0);
@@ -505,6 +638,7 @@ Knob<T>::getValueFromExpression(double time,
         std::string error;
         bool exprOk = evaluateExpression(time, view,  dimension, ret, &error);
         if (!exprOk) {
+            endExpressionEvaluation(dimension, key, age, pending, 0);
             setExpressionInvalid(dimension, false, error);
 
             return false;
@@ -519,8 +653,7 @@ Knob<T>::getValueFromExpression(double time,
         *ret =  clampToMinMax(*ret, dimension);
     }
 
-    QMutexLocker k(&_valueMutex);
-    _exprRes[dimension].insert( std::make_pair(time, *ret) );
+    endExpressionEvaluation(dimension, key, age, pending, ret);
 
     return true;
 }
@@ -575,15 +708,18 @@ Knob<T>::getValueFromExpression_pod(double time,
     }
 
 
-    ///Check first if a value was already computed:
+    ///Check first if a value was already computed, or wait for the thread computing it
 
+    ExpressionResultKey key( time, view.value() );
+    U64 age;
+    bool pending;
+    {
+        T cached;
+        if ( beginExpressionEvaluation(dimension, key, &cached, &age, &pending) ) {
+            *ret = cached;
 
-    QMutexLocker k(&_valueMutex);
-    typename FrameValueMap::iterator found = _exprRes[dimension].find(time);
-    if ( found != _exprRes[dimension].end() ) {
-        *ret = found->second;
-
-        return true;
+            return true;
+        }
     }
 
 
@@ -593,6 +729,7 @@ Knob<T>::getValueFromExpression_pod(double time,
         std::string error;
         bool exprOk = evaluateExpression_pod(time, view, dimension, ret, &error);
         if (!exprOk) {
+            endExpressionEvaluation(dimension, key, age, pending, 0);
             setExpressionInvalid(dimension, false, error);
 
             return false;
@@ -607,8 +744,8 @@ Knob<T>::getValueFromExpression_pod(double time,
         *ret =  clampToMinMax(*ret, dimension);
     }
 
-    //QWriteLocker k(&_valueMutex);
-    _exprRes[dimension].insert( std::make_pair(time, *ret) );
+    T result = *ret;
+    endExpressionEvaluation(dimension, key, age, pending, &result);
 
     return true;
 }
@@ -711,7 +848,7 @@ Knob<T>::getValue(int dimension,
     if ( !hasExpr.empty() ) {
         T ret;
         double time = getCurrentTime();
-        if ( getValueFromExpression(time, /*view*/ ViewIdx(0), dimension, clamp, &ret) ) {
+        if ( getValueFromExpression(time, view.isCurrent() ? getCurrentView() : ViewIdx( view.value() ), dimension, clamp, &ret) ) {
             return ret;
         }
     }
@@ -824,7 +961,7 @@ Knob<T>::getValueAtTime(double time,
     std::string hasExpr = getExpression(dimension);
     if ( !hasExpr.empty() ) {
         T ret;
-        if ( getValueFromExpression(time, /*view*/ ViewIdx(0), dimension, clamp, &ret) ) {
+        if ( getValueFromExpression(time, view.isCurrent() ? getCurrentView() : ViewIdx( view.value() ), dimension, clamp, &ret) ) {
             return ret;
         }
     }
@@ -900,7 +1037,7 @@ Knob<T>::getValueAtWithExpression(double time,
 
     if (!expr.empty() && exprValid) {
         double ret;
-        if ( getValueFromExpression_pod(time, /*view*/ ViewIdx(0), dimension, false, &ret) ) {
+        if ( getValueFromExpression_pod(time, view.isCurrent() ? getCurrentView() : ViewIdx( view.value() ), dimension, false, &ret) ) {
             return ret;
         }
     }
@@ -2696,6 +2833,7 @@ Knob<T>::cloneExpressionsResults(KnobI* other,
             otherKnob->getExpressionResults(i, results);
             QMutexLocker k(&_valueMutex);
             _exprRes[i] = results;
+            ++_exprResAge[i];
         }
     } else {
         if (otherDimension == -1) {
@@ -2705,6 +2843,7 @@ Knob<T>::cloneExpressionsResults(KnobI* other,
         otherKnob->getExpressionResults(otherDimension, results);
         QMutexLocker k(&_valueMutex);
         _exprRes[dimension] = results;
+        ++_exprResAge[dimension];
     }
 }
 
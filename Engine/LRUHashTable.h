@@ -146,6 +146,12 @@ public:
         return it;
     }
 
+    // Find the value for k without updating its access record
+    typename key_to_value_type::iterator find(const key_type & k)
+    {
+        return _key_to_value.find(k);
+    }
+
     void erase(typename key_to_value_type::iterator it)
     {
         _key_tracker.erase(it->second.second);
@@ -264,6 +270,12 @@ public:
         return it;
     }
 
+    // Find the value for k without updating its access record
+    typename container_type::left_iterator find(const key_type & k)
+    {
+        return _container.left.find(k);
+    }
+
     void erase(typename container_type::left_iterator it)
     {
         _container.left.erase(it);
@@ -380,6 +392,12 @@ public:
         return it;
     }
 
+    // Find the value for k without updating its access record
+    typename key_to_value_type::iterator find(const key_type & k)
+    {
+        return _key_to_value.find(k);
+    }
+
     void erase(typename key_to_value_type::iterator it)
     {
         _key_tracker.erase(it->second.second);
@@ -494,6 +512,12 @@ public:
         return it;
     }
 
+    // Find the value for k without updating its access record
+    typename container_type::left_iterator find(const key_type & k)
+    {
+        return _container.left.find(k);
+    }
+
     void erase(typename container_type::left_iterator it)
     {
         _container.left.erase(it);
@@ -596,6 +620,12 @@ public:
         return it;
     }
 
+    // Find the value for k without updating its access record
+    typename container_type::left_iterator find(const key_type & k)
+    {
+        return _container.left.find(k);
+    }
+
     void erase(typename container_type::left_iterator it)
     {
         _container.left.erase(it);
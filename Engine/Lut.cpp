@@ -28,7 +28,9 @@
 #include <algorithm> // min, max
 #include <cassert>
 #include <stdexcept>
+#include <vector>
 
+#include "Engine/LutSIMD.h"
 #include "Engine/RectI.h"
 
 /*
@@ -261,6 +263,28 @@ Lut::toColorSpaceUint8xxFromLinearFloatFast(float v) const
     return toFunc_hipart_to_uint8xx[hipart(v)];
 }
 
+void
+Lut::toColorSpaceUint8xxFromLinearFloatFast(const float* from,
+                                            int n,
+                                            unsigned short* to) const
+{
+    assert(init_);
+    // the output buffer holds the indices before the lookup
+    computeLutIndices(from, n, to);
+    for (int i = 0; i < n; ++i) {
+        to[i] = toFunc_hipart_to_uint8xx[to[i]];
+    }
+}
+
+void
+Lut::fromColorSpaceUint8ToLinearFloatFast(const unsigned char* from,
+                                          int n,
+                                          float* to) const
+{
+    assert(init_);
+    lookupUint8ToFloatRow(fromFunc_uint8_to_float, from, n, to);
+}
+
 // the following only works for increasing LUTs
 unsigned short
 Lut::toColorSpaceUint16FromLinearFloatFast(float v) const
@@ -464,6 +488,10 @@ Lut::to_byte_packed(unsigned char* to,
 
     validate();
 
+    const bool premultInput = inputHasAlpha && premult;
+    // indices in toFunc_hipart_to_uint8xx of the (premultiplied) input components of a scan-line
+    std::vector<unsigned short> rowIndices( (rect.x2 - rect.x1) * inPackingSize );
+
     for (int y = rect.y1; y < rect.y2; ++y) {
         // coverity[dont_call]
         int start = rand() % (rect.x2 - rect.x1) + rect.x1;
@@ -478,14 +506,20 @@ Lut::to_byte_packed(unsigned char* to,
         int dstY = dstBounds.y2 - y - 1;
         const float *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         unsigned char *dst_pixels = to + (dstY * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        if (premultInput) {
+            computeLutIndicesPremult(src_pixels + rect.x1 * inPackingSize, rect.x2 - rect.x1, &rowIndices[0]);
+        } else {
+            computeLutIndices(src_pixels + rect.x1 * inPackingSize, (rect.x2 - rect.x1) * inPackingSize, &rowIndices[0]);
+        }
         /* go fowards from starting point to end of line: */
         for (int x = start; x < rect.x2; ++x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
-            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
-            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inROffset] * a)];
-            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inGOffset] * a)];
-            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inBOffset] * a)];
+            const unsigned short* indices = &rowIndices[(x - rect.x1) * inPackingSize];
+            float a = premultInput ? src_pixels[inCol + inAOffset] : 1.f;
+            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[indices[inROffset]];
+            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[indices[inGOffset]];
+            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[indices[inBOffset]];
             assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
             dst_pixels[outCol + outROffset] = (unsigned char)(error_r >> 8);
             dst_pixels[outCol + outGOffset] = (unsigned char)(error_g >> 8);
@@ -500,10 +534,11 @@ Lut::to_byte_packed(unsigned char* to,
         for (int x = start - 1; x >= rect.x1; --x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
-            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
-            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inROffset] * a)];
-            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inGOffset] * a)];
-            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inBOffset] * a)];
+            const unsigned short* indices = &rowIndices[(x - rect.x1) * inPackingSize];
+            float a = premultInput ? src_pixels[inCol + inAOffset] : 1.f;
+            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[indices[inROffset]];
+            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[indices[inGOffset]];
+            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[indices[inBOffset]];
             assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
             dst_pixels[outCol + outROffset] = (unsigned char)(error_r >> 8);
             dst_pixels[outCol + outGOffset] = (unsigned char)(error_g >> 8);
@@ -675,6 +710,14 @@ Lut::from_byte_packed(float* to,
     outPackingSize = outputHasAlpha ? 4 : 3;
 
     validate();
+
+    const bool unpremultInput = inputHasAlpha && premult;
+    // linear values of the input components of a scan-line, when no unpremultiplication is needed
+    std::vector<float> rowValues;
+    if (!unpremultInput) {
+        rowValues.resize( (rect.x2 - rect.x1) * inPackingSize );
+    }
+
     for (int y = rect.y1; y < rect.y2; ++y) {
         int srcY = y;
         if (invertY) {
@@ -683,10 +726,13 @@ Lut::from_byte_packed(float* to,
 
         const unsigned char *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         float *dst_pixels = to + (y * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        if (!unpremultInput) {
+            lookupUint8ToFloatRow(fromFunc_uint8_to_float, src_pixels + rect.x1 * inPackingSize, (rect.x2 - rect.x1) * inPackingSize, &rowValues[0]);
+        }
         for (int x = rect.x1; x < rect.x2; ++x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
-            if (inputHasAlpha && premult) {
+            if (unpremultInput) {
                 float rf = 0., gf = 0., bf = 0.;
                 float a = Color::intToFloat<256>(src_pixels[inCol + inAOffset]);
                 if (a > 0) {
@@ -703,14 +749,10 @@ Lut::from_byte_packed(float* to,
                     dst_pixels[outCol + outAOffset] = a;
                 }
             } else {
-                int r8 = 0, g8 = 0, b8 = 0;
-                r8 = src_pixels[inCol + inROffset];
-                g8 = src_pixels[inCol + inGOffset];
-                b8 = src_pixels[inCol + inBOffset];
-                assert(r8 >= 0 && r8 < 256 && g8 >= 0 && g8 < 256 && b8 >= 0 && b8 < 256);
-                dst_pixels[outCol + outROffset] = fromFunc_uint8_to_float[r8];
-                dst_pixels[outCol + outGOffset] = fromFunc_uint8_to_float[g8];
-                dst_pixels[outCol + outBOffset] = fromFunc_uint8_to_float[b8];
+                const float* values = &rowValues[(x - rect.x1) * inPackingSize];
+                dst_pixels[outCol + outROffset] = values[inROffset];
+                dst_pixels[outCol + outGOffset] = values[inGOffset];
+                dst_pixels[outCol + outBOffset] = values[inBOffset];
                 if (outputHasAlpha) {
                     // alpha is linear
                     float a = Color::intToFloat<256>(src_pixels[inCol + inAOffset]);
@@ -210,6 +210,11 @@ public:
      */
     unsigned short toColorSpaceUint8xxFromLinearFloatFast(float v) const;
 
+    /* @brief Same as toColorSpaceUint8xxFromLinearFloatFast(float) for n contiguous values, using the SIMD kernels
+     * of LutSIMD.h when available.
+     */
+    void toColorSpaceUint8xxFromLinearFloatFast(const float* from, int n, unsigned short* to) const;
+
     /* @brief Converts a float ranging in [0 - 1.f] in linear color-space using the look-up tables.
      * @return An unsigned short in [0 - 65535] in the destination color-space.
      * This function uses localluy linear approximations of the transfer function.
@@ -221,6 +226,11 @@ public:
      */
     float fromColorSpaceUint8ToLinearFloatFast(unsigned char v) const;
 
+    /* @brief Same as fromColorSpaceUint8ToLinearFloatFast(unsigned char) for n contiguous values, using the SIMD kernels
+     * of LutSIMD.h when available.
+     */
+    void fromColorSpaceUint8ToLinearFloatFast(const unsigned char* from, int n, float* to) const;
+
     /* @brief Converts a short ranging in [0 - 65535] in the destination color-space using the look-up tables.
      * @return A float in [0 - 1.f] in linear color-space.
      */
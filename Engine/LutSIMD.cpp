@@ -0,0 +1,936 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "LutSIMD.h"
+
+#include <cstring> // for std::memcpy
+#include <cassert>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define NATRON_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#include "Engine/Half.h"
+#include "Engine/Lut.h"
+
+/*
+ * The vectorized functions are compiled with a target attribute rather than with -msse4.1/-mavx2 for the whole
+ * file, so that the binary still runs on CPUs that do not support them: they are only called after checking
+ * getSIMDInstructionSet().
+ * MSVC does not need any flag to compile intrinsics.
+ */
+#if defined(NATRON_SIMD_X86) && ( defined(__GNUC__) || defined(__clang__) )
+#define NATRON_TARGET_SSE41 __attribute__( ( target("sse4.1") ) )
+#define NATRON_TARGET_AVX2 __attribute__( ( target("avx2") ) )
+#define NATRON_TARGET_F16C __attribute__( ( target("avx,f16c") ) )
+#else
+#define NATRON_TARGET_SSE41
+#define NATRON_TARGET_AVX2
+#define NATRON_TARGET_F16C
+#endif
+
+NATRON_NAMESPACE_ENTER;
+
+namespace Color {
+static SIMDInstructionSetEnum
+detectSIMDInstructionSet()
+{
+#ifdef NATRON_SIMD_X86
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx2") ) {
+        return eSIMDInstructionSetAVX2;
+    }
+    if ( __builtin_cpu_supports("sse4.1") ) {
+        return eSIMDInstructionSetSSE41;
+    }
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int nIds = info[0];
+    if (nIds >= 1) {
+        __cpuid(info, 1);
+        bool hasSSE41 = (info[2] & (1 << 19)) != 0;
+        bool hasOSXSave = (info[2] & (1 << 27)) != 0;
+        bool hasAVX = (info[2] & (1 << 28)) != 0;
+        // AVX registers must also be saved by the OS
+        if ( (nIds >= 7) && hasOSXSave && hasAVX && ( (_xgetbv(0) & 6) == 6 ) ) {
+            __cpuidex(info, 7, 0);
+            if ( info[1] & (1 << 5) ) {
+                return eSIMDInstructionSetAVX2;
+            }
+        }
+        if (hasSSE41) {
+            return eSIMDInstructionSetSSE41;
+        }
+    }
+#endif
+#endif // NATRON_SIMD_X86
+
+    return eSIMDInstructionSetScalar;
+}
+
+/*
+ * F16C (half-float conversions) is not part of AVX2 but every AVX2 CPU has it: it is only used
+ * when the AVX2 kernels are selected and the CPU reports it.
+ */
+static bool
+detectF16C()
+{
+#ifdef NATRON_SIMD_X86
+#if defined(__GNUC__) || defined(__clang__)
+    unsigned int eax, ebx, ecx, edx;
+    if ( !__get_cpuid(1, &eax, &ebx, &ecx, &edx) ) {
+        return false;
+    }
+
+    return (ecx & bit_F16C) != 0;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+
+    return (info[2] & (1 << 29) ) != 0;
+#endif
+#endif // NATRON_SIMD_X86
+
+    return false;
+}
+
+static bool
+useF16C()
+{
+    static const bool supported = detectF16C();
+
+    return supported && getSIMDInstructionSet() == eSIMDInstructionSetAVX2;
+}
+
+// -1 means the supported instruction set is used
+static int forcedInstructionSet = -1;
+
+SIMDInstructionSetEnum
+getSupportedSIMDInstructionSet()
+{
+    static const SIMDInstructionSetEnum supported = detectSIMDInstructionSet();
+
+    return supported;
+}
+
+SIMDInstructionSetEnum
+getSIMDInstructionSet()
+{
+    SIMDInstructionSetEnum supported = getSupportedSIMDInstructionSet();
+
+    if ( (forcedInstructionSet >= 0) && (forcedInstructionSet < (int)supported) ) {
+        return (SIMDInstructionSetEnum)forcedInstructionSet;
+    }
+
+    return supported;
+}
+
+void
+setSIMDInstructionSet(SIMDInstructionSetEnum set)
+{
+    forcedInstructionSet = (int)set;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Scalar reference implementations
+///////////////////////////////////////////////////////////////////////////////
+
+static inline unsigned short
+lutIndexScalar(float f)
+{
+    unsigned int bits;
+
+    std::memcpy( &bits, &f, sizeof(float) );
+
+    return (unsigned short)(bits >> 16);
+}
+
+// Same as floatToInt<maxValue + 1>
+static inline int
+floatToIntScalar(float value,
+                 int maxValue)
+{
+    if (value <= 0) {
+        return 0;
+    } else if (value >= 1.) {
+        return maxValue;
+    }
+
+    return value * maxValue + 0.5;
+}
+
+static void
+computeLutIndicesScalar(const float* from,
+                        int n,
+                        unsigned short* to)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = lutIndexScalar(from[i]);
+    }
+}
+
+static void
+computeLutIndicesPremultScalar(const float* from,
+                               int nPixels,
+                               unsigned short* to)
+{
+    for (int i = 0; i < nPixels; ++i, from += 4, to += 4) {
+        const float a = from[3];
+        for (int c = 0; c < 3; ++c) {
+            to[c] = lutIndexScalar(from[c] * a);
+        }
+        to[3] = lutIndexScalar(a);
+    }
+}
+
+static void
+floatToIntRowScalar(const float* from,
+                    int n,
+                    int maxValue,
+                    int* to)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = floatToIntScalar(from[i], maxValue);
+    }
+}
+
+static void
+uint8ToFloatRowScalar(const unsigned char* from,
+                      int n,
+                      float* to)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = intToFloat<256>(from[i]);
+    }
+}
+
+static void
+uint16ToFloatRowScalar(const unsigned short* from,
+                       int n,
+                       float* to)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = intToFloat<65536>(from[i]);
+    }
+}
+
+static void
+lookupUint8ToFloatRowScalar(const float* table,
+                            const unsigned char* from,
+                            int n,
+                            float* to)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = table[from[i]];
+    }
+}
+
+static void
+premultRGBARowScalar(float* pixels,
+                     int nPixels)
+{
+    for (int i = 0; i < nPixels; ++i, pixels += 4) {
+        for (int c = 0; c < 3; ++c) {
+            pixels[c] = pixels[c] * pixels[3];
+        }
+    }
+}
+
+static void
+unpremultRGBARowScalar(float* pixels,
+                       int nPixels)
+{
+    for (int i = 0; i < nPixels; ++i, pixels += 4) {
+        if (pixels[3] != 0) {
+            for (int c = 0; c < 3; ++c) {
+                pixels[c] = pixels[c] / pixels[3];
+            }
+        }
+    }
+}
+
+static void
+shuffleRGBToRGBARowScalar(const float* from,
+                          int nPixels,
+                          float alpha,
+                          float* to)
+{
+    for (int i = 0; i < nPixels; ++i, from += 3, to += 4) {
+        to[0] = from[0];
+        to[1] = from[1];
+        to[2] = from[2];
+        to[3] = alpha;
+    }
+}
+
+static void
+shuffleRGBAToRGBRowScalar(const float* from,
+                          int nPixels,
+                          float* to)
+{
+    for (int i = 0; i < nPixels; ++i, from += 4, to += 3) {
+        to[0] = from[0];
+        to[1] = from[1];
+        to[2] = from[2];
+    }
+}
+
+static void
+halfToFloatRowScalar(const unsigned short* from,
+                     int n,
+                     float* to)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = Half::bitsToFloat(from[i]);
+    }
+}
+
+static void
+floatToHalfRowScalar(const float* from,
+                     int n,
+                     unsigned short* to)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = Half::floatToBits(from[i]);
+    }
+}
+
+#ifdef NATRON_SIMD_X86
+
+///////////////////////////////////////////////////////////////////////////////
+// SSE4.1 implementations
+///////////////////////////////////////////////////////////////////////////////
+
+NATRON_TARGET_SSE41
+static inline __m128i
+floatToIntSSE41(__m128 v,
+                __m128 maxValueF,
+                __m128i maxValueI)
+{
+    // the product is made in float and the rounding in double, like floatToInt()
+    const __m128d half = _mm_set1_pd(0.5);
+    __m128 p = _mm_mul_ps(v, maxValueF);
+    __m128i lo = _mm_cvttpd_epi32( _mm_add_pd(_mm_cvtps_pd(p), half) );
+    __m128i hi = _mm_cvttpd_epi32( _mm_add_pd(_mm_cvtps_pd( _mm_movehl_ps(p, p) ), half) );
+    __m128i ret = _mm_unpacklo_epi64(lo, hi);
+    __m128 isNegative = _mm_cmple_ps( v, _mm_setzero_ps() );
+    __m128 isOverOne = _mm_cmpge_ps( v, _mm_set1_ps(1.f) );
+
+    ret = _mm_blendv_epi8( ret, _mm_setzero_si128(), _mm_castps_si128(isNegative) );
+    ret = _mm_blendv_epi8( ret, maxValueI, _mm_castps_si128(isOverOne) );
+
+    return ret;
+}
+
+NATRON_TARGET_SSE41
+static void
+computeLutIndicesSSE41(const float* from,
+                       int n,
+                       unsigned short* to)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i lo = _mm_srli_epi32(_mm_castps_si128( _mm_loadu_ps(from + i) ), 16);
+        __m128i hi = _mm_srli_epi32(_mm_castps_si128( _mm_loadu_ps(from + i + 4) ), 16);
+        _mm_storeu_si128( (__m128i*)(to + i), _mm_packus_epi32(lo, hi) );
+    }
+    computeLutIndicesScalar(from + i, n - i, to + i);
+}
+
+NATRON_TARGET_SSE41
+static inline __m128
+premultPixelSSE41(__m128 v)
+{
+    // multiply by alpha and keep the original alpha
+    return _mm_blend_ps(_mm_mul_ps( v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)) ), v, 0x8);
+}
+
+NATRON_TARGET_SSE41
+static void
+computeLutIndicesPremultSSE41(const float* from,
+                              int nPixels,
+                              unsigned short* to)
+{
+    int i = 0;
+
+    for (; i + 2 <= nPixels; i += 2) {
+        __m128i lo = _mm_srli_epi32(_mm_castps_si128( premultPixelSSE41( _mm_loadu_ps(from + i * 4) ) ), 16);
+        __m128i hi = _mm_srli_epi32(_mm_castps_si128( premultPixelSSE41( _mm_loadu_ps(from + i * 4 + 4) ) ), 16);
+        _mm_storeu_si128( (__m128i*)(to + i * 4), _mm_packus_epi32(lo, hi) );
+    }
+    computeLutIndicesPremultScalar(from + i * 4, nPixels - i, to + i * 4);
+}
+
+NATRON_TARGET_SSE41
+static void
+floatToIntRowSSE41(const float* from,
+                   int n,
+                   int maxValue,
+                   int* to)
+{
+    const __m128 maxValueF = _mm_set1_ps( (float)maxValue );
+    const __m128i maxValueI = _mm_set1_epi32(maxValue);
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_si128( (__m128i*)(to + i), floatToIntSSE41(_mm_loadu_ps(from + i), maxValueF, maxValueI) );
+    }
+    floatToIntRowScalar(from + i, n - i, maxValue, to + i);
+}
+
+NATRON_TARGET_SSE41
+static void
+uint8ToFloatRowSSE41(const unsigned char* from,
+                     int n,
+                     float* to)
+{
+    const __m128 maxValue = _mm_set1_ps(255.f);
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        int packed;
+        std::memcpy(&packed, from + i, sizeof(int));
+        __m128 v = _mm_cvtepi32_ps( _mm_cvtepu8_epi32( _mm_cvtsi32_si128(packed) ) );
+        _mm_storeu_ps( to + i, _mm_div_ps(v, maxValue) );
+    }
+    uint8ToFloatRowScalar(from + i, n - i, to + i);
+}
+
+NATRON_TARGET_SSE41
+static void
+uint16ToFloatRowSSE41(const unsigned short* from,
+                      int n,
+                      float* to)
+{
+    const __m128 maxValue = _mm_set1_ps(65535.f);
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_cvtepi32_ps( _mm_cvtepu16_epi32( _mm_loadl_epi64( (const __m128i*)(from + i) ) ) );
+        _mm_storeu_ps( to + i, _mm_div_ps(v, maxValue) );
+    }
+    uint16ToFloatRowScalar(from + i, n - i, to + i);
+}
+
+NATRON_TARGET_SSE41
+static void
+premultRGBARowSSE41(float* pixels,
+                    int nPixels)
+{
+    for (int i = 0; i < nPixels; ++i, pixels += 4) {
+        _mm_storeu_ps( pixels, premultPixelSSE41( _mm_loadu_ps(pixels) ) );
+    }
+}
+
+NATRON_TARGET_SSE41
+static inline __m128
+unpremultPixelSSE41(__m128 v)
+{
+    __m128 a = _mm_shuffle_ps( v, v, _MM_SHUFFLE(3, 3, 3, 3) );
+    __m128 divided = _mm_div_ps(v, a);
+
+    // leave pixels with alpha == 0 untouched, and always keep the original alpha
+    divided = _mm_blendv_ps( v, divided, _mm_cmpneq_ps( a, _mm_setzero_ps() ) );
+
+    return _mm_blend_ps(divided, v, 0x8);
+}
+
+NATRON_TARGET_SSE41
+static void
+unpremultRGBARowSSE41(float* pixels,
+                      int nPixels)
+{
+    for (int i = 0; i < nPixels; ++i, pixels += 4) {
+        _mm_storeu_ps( pixels, unpremultPixelSSE41( _mm_loadu_ps(pixels) ) );
+    }
+}
+
+NATRON_TARGET_SSE41
+static void
+shuffleRGBToRGBARowSSE41(const float* from,
+                         int nPixels,
+                         float alpha,
+                         float* to)
+{
+    const __m128 alphaV = _mm_set1_ps(alpha);
+    int i = 0;
+
+    // the last pixel is done separately: loading 4 floats would read past the end of the buffer
+    for (; i + 1 < nPixels; ++i) {
+        _mm_storeu_ps( to + i * 4, _mm_blend_ps(_mm_loadu_ps(from + i * 3), alphaV, 0x8) );
+    }
+    shuffleRGBToRGBARowScalar(from + i * 3, nPixels - i, alpha, to + i * 4);
+}
+
+NATRON_TARGET_SSE41
+static void
+shuffleRGBAToRGBRowSSE41(const float* from,
+                         int nPixels,
+                         float* to)
+{
+    int i = 0;
+
+    // each store writes one float past the pixel, which is overwritten by the next pixel:
+    // the last pixel is done separately to not write past the end of the buffer
+    for (; i + 1 < nPixels; ++i) {
+        _mm_storeu_ps( to + i * 3, _mm_loadu_ps(from + i * 4) );
+    }
+    shuffleRGBAToRGBRowScalar(from + i * 4, nPixels - i, to + i * 3);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2 implementations
+///////////////////////////////////////////////////////////////////////////////
+
+NATRON_TARGET_AVX2
+static inline __m256i
+packLutIndicesAVX2(__m256 lo,
+                   __m256 hi)
+{
+    // packus works on each 128 bits lane, the permutation puts the 16 indices back in order
+    __m256i packed = _mm256_packus_epi32( _mm256_srli_epi32(_mm256_castps_si256(lo), 16),
+                                          _mm256_srli_epi32(_mm256_castps_si256(hi), 16) );
+
+    return _mm256_permute4x64_epi64( packed, _MM_SHUFFLE(3, 1, 2, 0) );
+}
+
+NATRON_TARGET_AVX2
+static void
+computeLutIndicesAVX2(const float* from,
+                      int n,
+                      unsigned short* to)
+{
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_si256( (__m256i*)(to + i), packLutIndicesAVX2( _mm256_loadu_ps(from + i), _mm256_loadu_ps(from + i + 8) ) );
+    }
+    computeLutIndicesSSE41(from + i, n - i, to + i);
+}
+
+NATRON_TARGET_AVX2
+static inline __m256
+premultPixelsAVX2(__m256 v)
+{
+    // 2 pixels: shuffle_ps broadcasts the alpha of each 128 bits lane
+    return _mm256_blend_ps(_mm256_mul_ps( v, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)) ), v, 0x88);
+}
+
+NATRON_TARGET_AVX2
+static void
+computeLutIndicesPremultAVX2(const float* from,
+                             int nPixels,
+                             unsigned short* to)
+{
+    int i = 0;
+
+    for (; i + 4 <= nPixels; i += 4) {
+        __m256 lo = premultPixelsAVX2( _mm256_loadu_ps(from + i * 4) );
+        __m256 hi = premultPixelsAVX2( _mm256_loadu_ps(from + i * 4 + 8) );
+        _mm256_storeu_si256( (__m256i*)(to + i * 4), packLutIndicesAVX2(lo, hi) );
+    }
+    computeLutIndicesPremultSSE41(from + i * 4, nPixels - i, to + i * 4);
+}
+
+NATRON_TARGET_AVX2
+static void
+floatToIntRowAVX2(const float* from,
+                  int n,
+                  int maxValue,
+                  int* to)
+{
+    const __m256 maxValueF = _mm256_set1_ps( (float)maxValue );
+    const __m256i maxValueI = _mm256_set1_epi32(maxValue);
+    const __m256d half = _mm256_set1_pd(0.5);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(from + i);
+        // the product is made in float and the rounding in double, like floatToInt()
+        __m256 p = _mm256_mul_ps(v, maxValueF);
+        __m128i lo = _mm256_cvttpd_epi32( _mm256_add_pd(_mm256_cvtps_pd( _mm256_castps256_ps128(p) ), half) );
+        __m128i hi = _mm256_cvttpd_epi32( _mm256_add_pd(_mm256_cvtps_pd( _mm256_extractf128_ps(p, 1) ), half) );
+        __m256i ret = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        __m256 isNegative = _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LE_OQ);
+        __m256 isOverOne = _mm256_cmp_ps(v, _mm256_set1_ps(1.f), _CMP_GE_OQ);
+        ret = _mm256_blendv_epi8( ret, _mm256_setzero_si256(), _mm256_castps_si256(isNegative) );
+        ret = _mm256_blendv_epi8( ret, maxValueI, _mm256_castps_si256(isOverOne) );
+        _mm256_storeu_si256( (__m256i*)(to + i), ret );
+    }
+    floatToIntRowSSE41(from + i, n - i, maxValue, to + i);
+}
+
+NATRON_TARGET_AVX2
+static void
+uint8ToFloatRowAVX2(const unsigned char* from,
+                    int n,
+                    float* to)
+{
+    const __m256 maxValue = _mm256_set1_ps(255.f);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)(from + i) ) ) );
+        _mm256_storeu_ps( to + i, _mm256_div_ps(v, maxValue) );
+    }
+    uint8ToFloatRowSSE41(from + i, n - i, to + i);
+}
+
+NATRON_TARGET_AVX2
+static void
+uint16ToFloatRowAVX2(const unsigned short* from,
+                     int n,
+                     float* to)
+{
+    const __m256 maxValue = _mm256_set1_ps(65535.f);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_cvtepi32_ps( _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)(from + i) ) ) );
+        _mm256_storeu_ps( to + i, _mm256_div_ps(v, maxValue) );
+    }
+    uint16ToFloatRowSSE41(from + i, n - i, to + i);
+}
+
+NATRON_TARGET_AVX2
+static void
+lookupUint8ToFloatRowAVX2(const float* table,
+                          const unsigned char* from,
+                          int n,
+                          float* to)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i indices = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)(from + i) ) );
+        _mm256_storeu_ps( to + i, _mm256_i32gather_ps(table, indices, 4) );
+    }
+    lookupUint8ToFloatRowScalar(table, from + i, n - i, to + i);
+}
+
+NATRON_TARGET_AVX2
+static void
+premultRGBARowAVX2(float* pixels,
+                   int nPixels)
+{
+    int i = 0;
+
+    for (; i + 2 <= nPixels; i += 2) {
+        _mm256_storeu_ps( pixels + i * 4, premultPixelsAVX2( _mm256_loadu_ps(pixels + i * 4) ) );
+    }
+    premultRGBARowSSE41(pixels + i * 4, nPixels - i);
+}
+
+NATRON_TARGET_AVX2
+static void
+unpremultRGBARowAVX2(float* pixels,
+                     int nPixels)
+{
+    int i = 0;
+
+    for (; i + 2 <= nPixels; i += 2) {
+        __m256 v = _mm256_loadu_ps(pixels + i * 4);
+        __m256 a = _mm256_shuffle_ps( v, v, _MM_SHUFFLE(3, 3, 3, 3) );
+        __m256 divided = _mm256_blendv_ps( v, _mm256_div_ps(v, a), _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_NEQ_UQ) );
+        _mm256_storeu_ps( pixels + i * 4, _mm256_blend_ps(divided, v, 0x88) );
+    }
+    unpremultRGBARowSSE41(pixels + i * 4, nPixels - i);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// F16C implementations
+///////////////////////////////////////////////////////////////////////////////
+
+NATRON_TARGET_F16C
+static void
+halfToFloatRowF16C(const unsigned short* from,
+                   int n,
+                   float* to)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps( to + i, _mm256_cvtph_ps( _mm_loadu_si128( (const __m128i*)(from + i) ) ) );
+    }
+    halfToFloatRowScalar(from + i, n - i, to + i);
+}
+
+NATRON_TARGET_F16C
+static void
+floatToHalfRowF16C(const float* from,
+                   int n,
+                   unsigned short* to)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_si128( (__m128i*)(to + i), _mm256_cvtps_ph(_mm256_loadu_ps(from + i), _MM_FROUND_TO_NEAREST_INT) );
+    }
+    floatToHalfRowScalar(from + i, n - i, to + i);
+}
+
+#endif // NATRON_SIMD_X86
+
+///////////////////////////////////////////////////////////////////////////////
+// Dispatch
+///////////////////////////////////////////////////////////////////////////////
+
+void
+computeLutIndices(const float* from,
+                  int n,
+                  unsigned short* to)
+{
+    switch ( getSIMDInstructionSet() ) {
+#ifdef NATRON_SIMD_X86
+    case eSIMDInstructionSetAVX2:
+        computeLutIndicesAVX2(from, n, to);
+        break;
+    case eSIMDInstructionSetSSE41:
+        computeLutIndicesSSE41(from, n, to);
+        break;
+#endif
+    default:
+        computeLutIndicesScalar(from, n, to);
+        break;
+    }
+}
+
+void
+computeLutIndicesPremult(const float* from,
+                         int nPixels,
+                         unsigned short* to)
+{
+    switch ( getSIMDInstructionSet() ) {
+#ifdef NATRON_SIMD_X86
+    case eSIMDInstructionSetAVX2:
+        computeLutIndicesPremultAVX2(from, nPixels, to);
+        break;
+    case eSIMDInstructionSetSSE41:
+        computeLutIndicesPremultSSE41(from, nPixels, to);
+        break;
+#endif
+    default:
+        computeLutIndicesPremultScalar(from, nPixels, to);
+        break;
+    }
+}
+
+void
+floatToIntRow(const float* from,
+              int n,
+              int maxValue,
+              int* to)
+{
+    switch ( getSIMDInstructionSet() ) {
+#ifdef NATRON_SIMD_X86
+    case eSIMDInstructionSetAVX2:
+        floatToIntRowAVX2(from, n, maxValue, to);
+        break;
+    case eSIMDInstructionSetSSE41:
+        floatToIntRowSSE41(from, n, maxValue, to);
+        break;
+#endif
+    default:
+        floatToIntRowScalar(from, n, maxValue, to);
+        break;
+    }
+}
+
+void
+uint8ToFloatRow(const unsigned char* from,
+                int n,
+                float* to)
+{
+    switch ( getSIMDInstructionSet() ) {
+#ifdef NATRON_SIMD_X86
+    case eSIMDInstructionSetAVX2:
+        uint8ToFloatRowAVX2(from, n, to);
+        break;
+    case eSIMDInstructionSetSSE41:
+        uint8ToFloatRowSSE41(from, n, to);
+        break;
+#endif
+    default:
+        uint8ToFloatRowScalar(from, n, to);
+        break;
+    }
+}
+
+void
+uint16ToFloatRow(const unsigned short* from,
+                 int n,
+                 float* to)
+{
+    switch ( getSIMDInstructionSet() ) {
+#ifdef NATRON_SIMD_X86
+    case eSIMDInstructionSetAVX2:
+        uint16ToFloatRowAVX2(from, n, to);
+        break;
+    case eSIMDInstructionSetSSE41:
+        uint16ToFloatRowSSE41(from, n, to);
+        break;
+#endif
+    default:
+        uint16ToFloatRowScalar(from, n, to);
+        break;
+    }
+}
+
+void
+lookupUint8ToFloatRow(const float* table,
+                      const unsigned char* from,
+                      int n,
+                      float* to)
+{
+    switch ( getSIMDInstructionSet() ) {
+#ifdef NATRON_SIMD_X86
+    case eSIMDInstructionSetAVX2:
+        lookupUint8ToFloatRowAVX2(table, from, n, to);
+        break;
+#endif
+    default:
+        // there is no gather instruction before AVX2
+        lookupUint8ToFloatRowScalar(table, from, n, to);
+        break;
+    }
+}
+
+void
+premultRGBARow(float* pixels,
+               int nPixels)
+{
+    switch ( getSIMDInstructionSet() ) {
+#ifdef NATRON_SIMD_X86
+    case eSIMDInstructionSetAVX2:
+        premultRGBARowAVX2(pixels, nPixels);
+        break;
+    case eSIMDInstructionSetSSE41:
+        premultRGBARowSSE41(pixels, nPixels);
+        break;
+#endif
+    default:
+        premultRGBARowScalar(pixels, nPixels);
+        break;
+    }
+}
+
+void
+unpremultRGBARow(float* pixels,
+                 int nPixels)
+{
+    switch ( getSIMDInstructionSet() ) {
+#ifdef NATRON_SIMD_X86
+    case eSIMDInstructionSetAVX2:
+        unpremultRGBARowAVX2(pixels, nPixels);
+        break;
+    case eSIMDInstructionSetSSE41:
+        unpremultRGBARowSSE41(pixels, nPixels);
+        break;
+#endif
+    default:
+        unpremultRGBARowScalar(pixels, nPixels);
+        break;
+    }
+}
+
+void
+shuffleRGBToRGBARow(const float* from,
+                    int nPixels,
+                    float alpha,
+                    float* to)
+{
+    switch ( getSIMDInstructionSet() ) {
+#ifdef NATRON_SIMD_X86
+    case eSIMDInstructionSetAVX2:
+    case eSIMDInstructionSetSSE41:
+        // shuffles are bound by memory accesses, AVX2 does not bring anything here
+        shuffleRGBToRGBARowSSE41(from, nPixels, alpha, to);
+        break;
+#endif
+    default:
+        shuffleRGBToRGBARowScalar(from, nPixels, alpha, to);
+        break;
+    }
+}
+
+void
+shuffleRGBAToRGBRow(const float* from,
+                    int nPixels,
+                    float* to)
+{
+    switch ( getSIMDInstructionSet() ) {
+#ifdef NATRON_SIMD_X86
+    case eSIMDInstructionSetAVX2:
+    case eSIMDInstructionSetSSE41:
+        // shuffles are bound by memory accesses, AVX2 does not bring anything here
+        shuffleRGBAToRGBRowSSE41(from, nPixels, to);
+        break;
+#endif
+    default:
+        shuffleRGBAToRGBRowScalar(from, nPixels, to);
+        break;
+    }
+}
+
+void
+halfToFloatRow(const unsigned short* from,
+               int n,
+               float* to)
+{
+#ifdef NATRON_SIMD_X86
+    if ( useF16C() ) {
+        halfToFloatRowF16C(from, n, to);
+
+        return;
+    }
+#endif
+    halfToFloatRowScalar(from, n, to);
+}
+
+void
+floatToHalfRow(const float* from,
+               int n,
+               unsigned short* to)
+{
+#ifdef NATRON_SIMD_X86
+    if ( useF16C() ) {
+        floatToHalfRowF16C(from, n, to);
+
+        return;
+    }
+#endif
+    floatToHalfRowScalar(from, n, to);
+}
+} // namespace Color
+
+NATRON_NAMESPACE_EXIT;
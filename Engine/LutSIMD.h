@@ -0,0 +1,117 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_LUTSIMD_H
+#define NATRON_ENGINE_LUTSIMD_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+///
+/// Vectorized versions of the per-pixel conversions found in Lut.h and ImageConvert.cpp.
+/// Each kernel has a scalar version, which is the reference implementation, and SSE4.1/AVX2 versions
+/// that are selected at runtime depending on the CPU. All versions produce bit-exact results.
+///
+
+NATRON_NAMESPACE_ENTER;
+namespace Color {
+/// @enum The instruction sets the kernels below can use
+enum SIMDInstructionSetEnum
+{
+    eSIMDInstructionSetScalar = 0,
+    eSIMDInstructionSetSSE41,
+    eSIMDInstructionSetAVX2
+};
+
+/**
+ * @brief Returns the best instruction set supported by this CPU. This is detected once.
+ **/
+SIMDInstructionSetEnum getSupportedSIMDInstructionSet();
+
+/**
+ * @brief Returns the instruction set currently used by the kernels.
+ **/
+SIMDInstructionSetEnum getSIMDInstructionSet();
+
+/**
+ * @brief Force the kernels to use the given instruction set. It is clamped to the one supported by the CPU.
+ * This is mainly used to compare the vectorized versions against the scalar reference.
+ **/
+void setSIMDInstructionSet(SIMDInstructionSetEnum set);
+
+/**
+ * @brief to[i] = index in the Lut tables of from[i] (the 16 high bits of the float)
+ **/
+void computeLutIndices(const float* from, int n, unsigned short* to);
+
+/**
+ * @brief Same as computeLutIndices for nPixels 4-components pixels with alpha as 4th component (RGBA or BGRA):
+ * the first 3 components are premultiplied by alpha before computing their index.
+ **/
+void computeLutIndicesPremult(const float* from, int nPixels, unsigned short* to);
+
+/**
+ * @brief to[i] = floatToInt<maxValue + 1>(from[i])
+ **/
+void floatToIntRow(const float* from, int n, int maxValue, int* to);
+
+/**
+ * @brief to[i] = intToFloat<256>(from[i])
+ **/
+void uint8ToFloatRow(const unsigned char* from, int n, float* to);
+
+/**
+ * @brief to[i] = intToFloat<65536>(from[i])
+ **/
+void uint16ToFloatRow(const unsigned short* from, int n, float* to);
+
+/**
+ * @brief to[i] = table[from[i]]
+ **/
+void lookupUint8ToFloatRow(const float* table, const unsigned char* from, int n, float* to);
+
+/**
+ * @brief Premultiply/Unpremultiply in place the first 3 components of nPixels RGBA pixels by the 4th one.
+ * Unpremultiplication leaves pixels with a zero alpha untouched.
+ **/
+void premultRGBARow(float* pixels, int nPixels);
+void unpremultRGBARow(float* pixels, int nPixels);
+
+/**
+ * @brief Component shuffles between RGB and RGBA pixels. alpha is the value written to the alpha channel
+ * when converting RGB to RGBA.
+ **/
+void shuffleRGBToRGBARow(const float* from, int nPixels, float alpha, float* to);
+void shuffleRGBAToRGBRow(const float* from, int nPixels, float* to);
+
+/**
+ * @brief Conversions between 16-bit half floats (stored as their bits) and floats, same as the Half class.
+ * These use the F16C instructions when the AVX2 kernels are selected and the CPU has them.
+ **/
+void halfToFloatRow(const unsigned short* from, int n, float* to);
+void floatToHalfRow(const float* from, int n, unsigned short* to);
+} // namespace Color
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_LUTSIMD_H
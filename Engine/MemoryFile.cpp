@@ -37,6 +37,7 @@
 #include <cerrno>
 #include <cstdio>
 #endif
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 #include <cassert>
@@ -365,6 +366,24 @@ MemoryFile::flush(bool async)
 #endif
 }
 
+void
+MemoryFile::prefetch(size_t offset,
+                     size_t length) const
+{
+    if ( !_imp->data || (offset >= _imp->size) || (length == 0) ) {
+        return;
+    }
+    length = std::min(length, _imp->size - offset);
+#if defined(__NATRON_UNIX__)
+    // madvise() needs an address aligned on a page
+    static const size_t pageSize = (size_t)::sysconf(_SC_PAGESIZE);
+    size_t alignedOffset = offset - (offset % pageSize);
+    ::madvise(_imp->data + alignedOffset, length + (offset - alignedOffset), MADV_WILLNEED);
+#elif defined(__NATRON_WIN32__)
+    // PrefetchVirtualMemory() is only available from Windows 8: pages are read on the first access
+#endif
+}
+
 MemoryFile::~MemoryFile()
 {
     if (_imp->data) {
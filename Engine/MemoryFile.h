@@ -137,6 +137,13 @@ public:
      **/
     bool flush(bool async);
 
+    /**
+     * @brief Hints the OS that the given range of the mapping will be accessed soon, so that it is read
+     * from the backing file in the background instead of page by page on the first access.
+     * This does not block and does nothing if the range is not mapped or on systems that do not support it.
+     **/
+    void prefetch(size_t offset, size_t length) const;
+
     /**
      * @brief Returns the filepath of the backing file.
      **/
@@ -82,6 +82,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/PrecompNode.h"
 #include "Engine/Project.h"
 #include "Engine/ReadNode.h"
+#include "Engine/RenderStats.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoStrokeItem.h"
@@ -261,6 +262,8 @@ public:
         , renderInstancesSharedMutex(QMutex::Recursive)
         , knobsAge(0)
         , knobsAgeMutex()
+        , localHash(0)
+        , localHashDirty(true)
         , masterNodeMutex()
         , masterNode()
         , nodeLinks()
@@ -337,6 +340,9 @@ public:
         , isRefreshingInputRelatedData(false)
         , streamWarnings()
         , requiresGLFinishBeforeRender(false)
+        , tilingHistory()
+        , writersRenderGroupMutex()
+        , writersRenderGroup()
     {
         ///Initialize timers
         gettimeofday(&lastRenderStartedSlotCallTime, 0);
@@ -443,6 +449,8 @@ public:
     U64 knobsAge; //< the age of the knobs in this effect. It gets incremented every times the effect has its evaluate() function called.
     mutable QReadWriteLock knobsAgeMutex; //< protects knobsAge and hash
     Hash64 hash; //< recomputed everytime knobsAge is changed.
+    U64 localHash; //< hash of the node's own state (knobsAge, script name), independent of the inputs. Protected by knobsAgeMutex
+    bool localHashDirty; //< when true, localHash must be recomputed before combining it with the inputs hash. Protected by knobsAgeMutex
     mutable QMutex masterNodeMutex; //< protects masterNode and nodeLinks
     NodeWPtr masterNode; //< this points to the master when the node is a clone
     KnobLinkList nodeLinks; //< these point to the parents of the params links
@@ -561,6 +569,13 @@ public:
     // Some plug-ins (mainly Hitfilm Ignite detected for now) use their own OpenGL context that is sharing resources with our OpenGL contexT.
     // as a result if we don't call glFinish() before calling the render action, the plug-in context might use textures that were not finished yet.
     bool requiresGLFinishBeforeRender;
+
+    // Time spent in the render action, shared by all render clones of the effect
+    mutable NodeTilingHistory tilingHistory;
+
+    // Set while the node is rendered for a group of writers rendered together
+    mutable QMutex writersRenderGroupMutex;
+    WritersRenderGroupPtr writersRenderGroup;
 };
 
 class RefreshingInputData_RAII
@@ -618,6 +633,28 @@ Node::isGLFinishRequiredBeforeRender() const
     return _imp->requiresGLFinishBeforeRender;
 }
 
+NodeTilingHistory*
+Node::getTilingHistory() const
+{
+    return &_imp->tilingHistory;
+}
+
+void
+Node::setWritersRenderGroup(const WritersRenderGroupPtr& group)
+{
+    QMutexLocker k(&_imp->writersRenderGroupMutex);
+
+    _imp->writersRenderGroup = group;
+}
+
+WritersRenderGroupPtr
+Node::getWritersRenderGroup() const
+{
+    QMutexLocker k(&_imp->writersRenderGroupMutex);
+
+    return _imp->writersRenderGroup;
+}
+
 bool
 Node::isPartOfProject() const
 {
@@ -1497,11 +1534,35 @@ Node::computeHashInternal()
 
         oldHash = _imp->hash.value();
 
+        ///With the legacy CRC-64 hashing, the values are appended in the order of older versions so that their
+        ///disk caches can be re-used: the node's own state is not hashed separately
+        const bool legacyHashing = Hash64::getAlgorithm() == Hash64::eHashAlgorithmCRC64;
+
+        ///The local hash only depends on the node's own state: it is only recomputed when it was marked dirty
+        ///(knobs age or script name changed). Nodes downstream of an edit only redo the combination step below.
+        if (!legacyHashing && _imp->localHashDirty) {
+            Hash64 localHash;
+
+            ///append the effect's own age
+            localHash.append(_imp->knobsAge);
+
+            ///Also append the effect's label to distinguish 2 instances with the same parameters
+            Hash64_appendQString( &localHash, QString::fromUtf8( getScriptName().c_str() ) );
+
+            localHash.computeHash();
+            _imp->localHash = localHash.value();
+            _imp->localHashDirty = false;
+        }
+
         ///reset the hash value
         _imp->hash.reset();
 
-        ///append the effect's own age
-        _imp->hash.append(_imp->knobsAge);
+        if (legacyHashing) {
+            ///append the effect's own age
+            _imp->hash.append(_imp->knobsAge);
+        } else {
+            _imp->hash.append(_imp->localHash);
+        }
 
         ///append all inputs hash
         boost::shared_ptr<RotoDrawableItem> attachedStroke = _imp->paintStroke.lock();
@@ -1549,8 +1610,10 @@ Node::computeHashInternal()
         //            _imp->hash.append(rotoAge);
         //        }
 
-        ///Also append the effect's label to distinguish 2 instances with the same parameters
-        Hash64_appendQString( &_imp->hash, QString::fromUtf8( getScriptName().c_str() ) );
+        if (legacyHashing) {
+            ///Also append the effect's label to distinguish 2 instances with the same parameters
+            Hash64_appendQString( &_imp->hash, QString::fromUtf8( getScriptName().c_str() ) );
+        }
 
         ///Also append the project's creation time in the hash because 2 projects openend concurrently
         ///could reproduce the same (especially simple graphs like Viewer-Reader)
@@ -1578,26 +1641,16 @@ Node::computeHashInternal()
 } // Node::computeHashInternal
 
 void
-Node::computeHashRecursive(std::list<Node*>& marked)
+Node::getOutputsForHashPropagation(std::list<Node*>* outputs) const
 {
-    if ( std::find(marked.begin(), marked.end(), this) != marked.end() ) {
-        return;
-    }
-
-    bool hasChanged = computeHashInternal();
-    marked.push_back(this);
-    if (!hasChanged) {
-        //Nothing changed, no need to recurse on outputs
+    if (!_imp->effect) {
         return;
     }
-
-
     bool isRotoPaint = _imp->effect->isRotoPaintNode();
+    NodesList directOutputs;
 
-    ///call it on all the outputs
-    NodesList outputs;
-    getOutputsWithGroupRedirection(outputs);
-    for (NodesList::iterator it = outputs.begin(); it != outputs.end(); ++it) {
+    getOutputsWithGroupRedirection(directOutputs);
+    for (NodesList::iterator it = directOutputs.begin(); it != directOutputs.end(); ++it) {
         assert(*it);
 
         //Since the rotopaint node is connected to the internal nodes of the tree, don't change their hash
@@ -1605,20 +1658,94 @@ Node::computeHashRecursive(std::list<Node*>& marked)
         if ( isRotoPaint && attachedStroke && (attachedStroke->getContext()->getNode().get() == this) ) {
             continue;
         }
-        (*it)->computeHashRecursive(marked);
+        outputs->push_back( it->get() );
     }
 
 
-    ///If the node has a rotopaint tree, compute the hash of the nodes in the tree
+    ///If the node has a rotopaint tree, the hash of the nodes in the tree depends on this node
     if (_imp->rotoContext) {
         NodesList allItems;
         _imp->rotoContext->getRotoPaintTreeNodes(&allItems);
         for (NodesList::iterator it = allItems.begin(); it != allItems.end(); ++it) {
-            (*it)->computeHashRecursive(marked);
+            outputs->push_back( it->get() );
         }
     }
 }
 
+void
+Node::sortHashDependenciesRecursive(std::set<Node*>* visited,
+                                    std::map<Node*, std::list<Node*> >* upstream,
+                                    std::list<Node*>* sorted)
+{
+    if ( !visited->insert(this).second ) {
+        return;
+    }
+
+    std::list<Node*> outputs;
+    getOutputsForHashPropagation(&outputs);
+    for (std::list<Node*>::iterator it = outputs.begin(); it != outputs.end(); ++it) {
+        (*upstream)[*it].push_back(this);
+        (*it)->sortHashDependenciesRecursive(visited, upstream, sorted);
+    }
+
+    //Post-order: all nodes depending on this one are already in the list, prepending yields a topological order
+    sorted->push_front(this);
+}
+
+void
+Node::computeHashes(const NodesList& nodes)
+{
+    ///Always called in the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+
+    ///The edited nodes are re-hashed first: the graph downstream of those whose hash did not change is not walked
+    std::set<Node*> rehashed;
+    std::set<Node*> changed;
+    for (NodesList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        if ( rehashed.insert( it->get() ).second && (*it)->computeHashInternal() ) {
+            changed.insert( it->get() );
+        }
+    }
+    if ( changed.empty() ) {
+        RenderStats::addHashPropagationInfos( (int)rehashed.size(), (int)rehashed.size() );
+
+        return;
+    }
+
+    std::set<Node*> visited;
+    std::map<Node*, std::list<Node*> > upstream;
+    std::list<Node*> sorted;
+    std::list<Node*> changedRoots( changed.begin(), changed.end() );
+    for (std::list<Node*>::iterator it = changedRoots.begin(); it != changedRoots.end(); ++it) {
+        (*it)->sortHashDependenciesRecursive(&visited, &upstream, &sorted);
+    }
+
+    ///Each node is visited after all the nodes it depends upon and is only combined again if the hash of one
+    ///of its inputs changed. An edited node is combined again only if it is downstream of another edited node.
+    for (std::list<Node*>::iterator it = sorted.begin(); it != sorted.end(); ++it) {
+        bool mustRecompute = false;
+        const std::list<Node*>& inputs = upstream[*it];
+        for (std::list<Node*>::const_iterator it2 = inputs.begin(); it2 != inputs.end(); ++it2) {
+            if ( changed.find(*it2) != changed.end() ) {
+                mustRecompute = true;
+                break;
+            }
+        }
+        if (!mustRecompute) {
+            continue;
+        }
+        rehashed.insert(*it);
+        if ( (*it)->computeHashInternal() ) {
+            changed.insert(*it);
+        }
+    }
+    for (std::set<Node*>::iterator it = rehashed.begin(); it != rehashed.end(); ++it) {
+        visited.insert(*it);
+    }
+
+    RenderStats::addHashPropagationInfos( (int)visited.size(), (int)rehashed.size() );
+} // Node::computeHashes
+
 void
 Node::removeAllImagesFromCacheWithMatchingIDAndDifferentKey(U64 nodeHashKey)
 {
@@ -1667,13 +1794,26 @@ Node::doComputeHashOnMainThread()
 void
 Node::computeHash()
 {
+    AppInstPtr app = getApp();
+
     if ( QThread::currentThread() != qApp->thread() ) {
-        Q_EMIT mustComputeHashOnMainThread();
+        if (app) {
+            ///Coalesced with the other requests made from other threads and propagated once on the main-thread
+            app->addNodeToHashBatch( shared_from_this() );
+        } else {
+            Q_EMIT mustComputeHashOnMainThread();
+        }
 
         return;
     }
-    std::list<Node*> marked;
-    computeHashRecursive(marked);
+    if ( app && app->isBatchingNodesHash() ) {
+        app->addNodeToHashBatch( shared_from_this() );
+
+        return;
+    }
+    NodesList nodes;
+    nodes.push_back( shared_from_this() );
+    computeHashes(nodes);
 } // computeHash
 
 void
@@ -2327,6 +2467,7 @@ Node::setKnobsAge(U64 newAge)
         changed = _imp->knobsAge != newAge || !_imp->hash.value();
         if (changed) {
             _imp->knobsAge = newAge;
+            _imp->localHashDirty = true;
         }
     }
     if (changed) {
@@ -2341,6 +2482,7 @@ Node::incrementKnobsAge_internal()
     {
         QWriteLocker l(&_imp->knobsAgeMutex);
         ++_imp->knobsAge;
+        _imp->localHashDirty = true;
 
         ///if the age of an effect somehow reaches the maximum age (will never happen)
         ///handle it by clearing the cache and resetting the age to 0.
@@ -2358,6 +2500,7 @@ Node::incrementKnobsAge()
     {
         QWriteLocker l(&_imp->knobsAgeMutex);
         ++_imp->knobsAge;
+        _imp->localHashDirty = true;
 
         ///if the age of an effect somehow reaches the maximum age (will never happen)
         ///handle it by clearing the cache and resetting the age to 0.
@@ -2978,7 +3121,8 @@ insertDependenciesRecursive(Node* node,
 void
 Node::setNameInternal(const std::string& name,
                       bool throwErrors,
-                      bool declareToPython)
+                      bool declareToPython,
+                      std::list<KnobPtr>* rewrittenExpressions)
 {
     std::string oldName = getScriptName_mt_safe();
     std::string fullOldName = getFullyQualifiedName();
@@ -3067,6 +3211,10 @@ Node::setNameInternal(const std::string& name,
             _imp->label = newName;
         }
     }
+    {
+        QWriteLocker l(&_imp->knobsAgeMutex);
+        _imp->localHashDirty = true;
+    }
     std::string fullySpecifiedName = getFullyQualifiedName();
 
     if (mustSetCacheID) {
@@ -3106,11 +3254,16 @@ Node::setNameInternal(const std::string& name,
                 if (!listener) {
                     continue;
                 }
+                bool rewritten = false;
                 for (std::size_t d = 0; d < it->second.size(); ++d) {
                     if (it->second[d].isListening && it->second[d].isExpr) {
                         listener->replaceNodeNameInExpression(d, oldName, newName);
+                        rewritten = true;
                     }
                 }
+                if (rewritten && rewrittenExpressions) {
+                    rewrittenExpressions->push_back(listener);
+                }
             }
         }
     }
@@ -3137,8 +3290,14 @@ Node::setScriptName(const std::string& name)
         return;
     }
 
+    std::string oldFullName = getFullyQualifiedName();
+    std::list<KnobPtr> rewrittenExpressions;
+    setNameInternal(newName, true, true, &rewrittenExpressions);
 
-    setNameInternal(newName, true, true);
+    // A node being created is journaled with its final name once created
+    if ( (QThread::currentThread() == qApp->thread()) && _imp->nodeCreated && !getApp()->isCreatingNodeTree() ) {
+        getApp()->getProject()->journalNodeRenamed(shared_from_this(), oldFullName, rewrittenExpressions);
+    }
 }
 
 AppInstPtr
@@ -5374,6 +5533,7 @@ Node::Implementation::ifGroupForceHashChangeOfInputs()
     if ( isGrp && !isGrp->getApp()->isCreatingNodeTree() ) {
         NodesList inputsOutputs;
         isGrp->getInputsOutputs(&inputsOutputs, false);
+        NodesHashBatch_RAII hashBatch( isGrp->getApp() );
         for (NodesList::iterator it = inputsOutputs.begin(); it != inputsOutputs.end(); ++it) {
             (*it)->incrementKnobsAge_internal();
             (*it)->computeHash();
@@ -5867,6 +6027,10 @@ Node::deactivate(const std::list< NodePtr > & outputsToDisconnect,
     //first tell the gui to clear any persistent message linked to this node
     clearPersistentMessage(false);
 
+    if ( QThread::currentThread() == qApp->thread() ) {
+        getApp()->getProject()->journalNodeRemoved( shared_from_this() );
+    }
+
 
 
     bool beingDestroyed;
@@ -6099,6 +6263,10 @@ Node::activate(const std::list< NodePtr > & outputsToRestore,
         return;
     }
 
+    if ( QThread::currentThread() == qApp->thread() ) {
+        getApp()->getProject()->journalNodeChanged( shared_from_this() );
+    }
+
 
     ///No need to lock, guiInputs is only written to by the main-thread
     NodePtr thisShared = shared_from_this();
@@ -6601,8 +6769,10 @@ Node::makePreviewImage(SequenceTime time,
             renderPreviewForDepth<unsigned short, 65535>(*img, elemCount, width, height, convertToSrgb, buf);
             break;
         }
-        case eImageBitDepthHalf:
+        case eImageBitDepthHalf: {
+            renderPreviewForDepth<Half, 1>(*img, elemCount, width, height, convertToSrgb, buf);
             break;
+        }
         case eImageBitDepthFloat: {
             renderPreviewForDepth<float, 1>(*img, elemCount, width, height, convertToSrgb, buf);
             break;
@@ -7606,6 +7776,10 @@ Node::onInputChanged(int inputNb,
     refreshMaskEnabledNess(inputNb);
     refreshLayersChoiceSecretness(inputNb);
 
+    if ( QThread::currentThread() == qApp->thread() ) {
+        getApp()->getProject()->journalNodeChanged( shared_from_this() );
+    }
+
     InspectorNode* isInspector = dynamic_cast<InspectorNode*>(this);
     if (isInspector) {
         isInspector->refreshActiveInputs(inputNb, isInputA);
@@ -8557,11 +8731,11 @@ Node::onEffectKnobValueChanged(KnobI* what,
             ///When a group is disabled we have to force a hash change of all nodes inside otherwise the image will stay cached
 
             NodesList nodes = isGroup->getNodes();
-            std::list<Node*> markedNodes;
+            NodesHashBatch_RAII hashBatch( getApp() );
             for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
                 //This will not trigger a hash recomputation
                 (*it)->incrementKnobsAge_internal();
-                (*it)->computeHashRecursive(markedNodes);
+                (*it)->computeHash();
             }
         }
     } else if ( what == _imp->nodeLabelKnob.lock().get() ) {
@@ -9177,6 +9351,7 @@ Node::getAllKnobsKeyframes(std::list<SequenceTime>* keyframes)
 ImageBitDepthEnum
 Node::getClosestSupportedBitDepth(ImageBitDepthEnum depth)
 {
+    bool foundHalf = false;
     bool foundShort = false;
     bool foundByte = false;
 
@@ -9185,14 +9360,19 @@ Node::getClosestSupportedBitDepth(ImageBitDepthEnum depth)
             return depth;
         } else if (*it == eImageBitDepthFloat) {
             return eImageBitDepthFloat;
+        } else if (*it == eImageBitDepthHalf) {
+            foundHalf = true;
         } else if (*it == eImageBitDepthShort) {
             foundShort = true;
         } else if (*it == eImageBitDepthByte) {
             foundByte = true;
         }
     }
+    // Half is only preferred to Byte, so that plug-ins supporting both Short and Half keep rendering in Short
     if (foundShort) {
         return eImageBitDepthShort;
+    } else if (foundHalf) {
+        return eImageBitDepthHalf;
     } else if (foundByte) {
         return eImageBitDepthByte;
     } else {
@@ -9206,6 +9386,7 @@ Node::getClosestSupportedBitDepth(ImageBitDepthEnum depth)
 ImageBitDepthEnum
 Node::getBestSupportedBitDepth() const
 {
+    bool foundHalf = false;
     bool foundShort = false;
     bool foundByte = false;
 
@@ -9220,6 +9401,7 @@ Node::getBestSupportedBitDepth() const
             break;
 
         case eImageBitDepthHalf:
+            foundHalf = true;
             break;
 
         case eImageBitDepthFloat:
@@ -9231,8 +9413,11 @@ Node::getBestSupportedBitDepth() const
         }
     }
 
+    // Same preference order as getClosestSupportedBitDepth
     if (foundShort) {
         return eImageBitDepthShort;
+    } else if (foundHalf) {
+        return eImageBitDepthHalf;
     } else if (foundByte) {
         return eImageBitDepthByte;
     } else {
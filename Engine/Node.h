@@ -31,6 +31,7 @@
 #include <string>
 #include <map>
 #include <list>
+#include <set>
 #include <bitset>
 
 CLANG_DIAG_OFF(deprecated)
@@ -168,6 +169,19 @@ public:
 
     bool isGLFinishRequiredBeforeRender() const;
 
+    /**
+     * @brief Timing history of the render action of this node, used to split the render window in tiles
+     * for host frame threading. This is MT-safe.
+     **/
+    NodeTilingHistory* getTilingHistory() const;
+
+    /**
+     * @brief The group of writers rendered together this node is the writer of, or is upstream of several writers of.
+     * When set, the images rendered by the node are pinned in the group (see WritersRenderGroup). This is MT-safe.
+     **/
+    void setWritersRenderGroup(const WritersRenderGroupPtr& group);
+    WritersRenderGroupPtr getWritersRenderGroup() const;
+
     void refreshAcceptedBitDepths();
 
     /**
@@ -1296,7 +1310,14 @@ private:
 
     bool setStreamWarningInternal(StreamWarningEnum warning, const QString& message);
 
-    void computeHashRecursive(std::list<Node*>& marked);
+    /**
+     * @brief Returns the nodes whose hash depends on the hash of this node.
+     **/
+    void getOutputsForHashPropagation(std::list<Node*>* outputs) const;
+
+    void sortHashDependenciesRecursive(std::set<Node*>* visited,
+                                       std::map<Node*, std::list<Node*> >* upstream,
+                                       std::list<Node*>* sorted);
 
     /**
      * @brief Refreshes the node hash depending on its context (knobs age, inputs etc...)
@@ -1328,7 +1349,7 @@ private:
 
     bool refreshDraftFlagInternal(const std::vector<NodeWPtr >& inputs);
 
-    void setNameInternal(const std::string& name, bool throwErrors, bool declareToPython);
+    void setNameInternal(const std::string& name, bool throwErrors, bool declareToPython, std::list<KnobPtr>* rewrittenExpressions = 0);
 
     std::string getFullyQualifiedNameInternal(const std::string& scriptName) const;
 
@@ -1469,6 +1490,17 @@ protected:
      **/
     void computeHash();
 
+public:
+
+    /**
+     * @brief Recomputes the hash of the given nodes and propagates the change downstream in a single pass:
+     * only the nodes downstream of a node whose hash changed are visited, each one after all its inputs, and it
+     * is only re-hashed if the hash of one of its inputs changed.
+     * This is what Node::computeHash() calls, unless a hash batch is opened on the app (see NodesHashBatch_RAII).
+     * Only called on the main-thread.
+     **/
+    static void computeHashes(const NodesList& nodes);
+
 private:
 
 
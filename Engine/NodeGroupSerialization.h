@@ -84,6 +84,11 @@ public:
         return _serializedNodes;
     }
 
+    std::list< boost::shared_ptr<NodeSerialization> > & getNodesSerialization()
+    {
+        return _serializedNodes;
+    }
+
     void addNodeSerialization(const boost::shared_ptr<NodeSerialization>& s)
     {
         _serializedNodes.push_back(s);
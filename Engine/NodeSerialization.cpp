@@ -31,6 +31,7 @@
 #include "Engine/Knob.h"
 #include "Engine/Node.h"
 #include "Engine/OfxEffectInstance.h"
+#include "Engine/ProjectBinaryArchive.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/NodeGroupSerialization.h"
 #include "Engine/RotoContext.h"
@@ -182,4 +183,68 @@ NodeSerialization::NodeSerialization(const NodePtr & n,
     }
 }
 
+void
+NodeSerialization::moveContextsToSections(const std::string& prefix,
+                                          ProjectBinaryArchiveWriter* writer)
+{
+    std::string fullName = prefix + _nodeScriptName;
+
+    if (_hasRotoContext) {
+        writer->addSection( NATRON_BINARY_PROJECT_SECTION_ROTO_PREFIX + fullName, encodeBinaryProjectSection(_rotoContext) );
+        _hasRotoContext = false;
+        _rotoContext = RotoContextSerialization();
+    }
+    if (_hasTrackerContext) {
+        writer->addSection( NATRON_BINARY_PROJECT_SECTION_TRACKER_PREFIX + fullName, encodeBinaryProjectSection(_trackerContext) );
+        _hasTrackerContext = false;
+        _trackerContext = TrackerContextSerialization();
+    }
+
+    std::string childrenPrefix = fullName + '.';
+    for (std::list< boost::shared_ptr<NodeSerialization> >::iterator it = _children.begin(); it != _children.end(); ++it) {
+        (*it)->moveContextsToSections(childrenPrefix, writer);
+    }
+}
+
+void
+NodeSerialization::setContextsSections(const std::string& prefix,
+                                       const boost::shared_ptr<ProjectBinaryArchiveReader>& reader)
+{
+    std::string fullName = prefix + _nodeScriptName;
+    std::string rotoSection = NATRON_BINARY_PROJECT_SECTION_ROTO_PREFIX + fullName;
+    std::string trackerSection = NATRON_BINARY_PROJECT_SECTION_TRACKER_PREFIX + fullName;
+
+    if ( reader->hasSection(rotoSection) ) {
+        _hasRotoContext = true;
+        _rotoContextSection = rotoSection;
+        _contextsArchive = reader;
+    }
+    if ( reader->hasSection(trackerSection) ) {
+        _hasTrackerContext = true;
+        _trackerContextSection = trackerSection;
+        _contextsArchive = reader;
+    }
+
+    std::string childrenPrefix = fullName + '.';
+    for (std::list< boost::shared_ptr<NodeSerialization> >::iterator it = _children.begin(); it != _children.end(); ++it) {
+        (*it)->setContextsSections(childrenPrefix, reader);
+    }
+}
+
+void
+NodeSerialization::decodeContextsSections() const
+{
+    assert(_contextsArchive);
+    if ( !_rotoContextSection.empty() ) {
+        decodeBinaryProjectSection(_contextsArchive->readSection(_rotoContextSection), &_rotoContext);
+        _rotoContextSection.clear();
+    }
+    if ( !_trackerContextSection.empty() ) {
+        decodeBinaryProjectSection(_contextsArchive->readSection(_trackerContextSection), &_trackerContext);
+        _trackerContextSection.clear();
+    }
+    // Node::load restores both contexts together, this node no longer needs the file
+    _contextsArchive.reset();
+}
+
 NATRON_NAMESPACE_EXIT;
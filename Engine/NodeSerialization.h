@@ -197,6 +197,10 @@ public:
 
     const RotoContextSerialization & getRotoContext() const
     {
+        if ( !_rotoContextSection.empty() ) {
+            decodeContextsSections();
+        }
+
         return _rotoContext;
     }
 
@@ -207,9 +211,26 @@ public:
 
     const TrackerContextSerialization& getTrackerContext() const
     {
+        if ( !_trackerContextSection.empty() ) {
+            decodeContextsSections();
+        }
+
         return _trackerContext;
     }
 
+    /**
+     * @brief Used by the binary project format, which stores the roto and tracker contexts of the nodes in their own sections.
+     * This encodes the contexts of this node and of its children in sections of the given writer and removes them from the
+     * serialization. The prefix is the fully qualified name of the parent group followed by a dot.
+     **/
+    void moveContextsToSections(const std::string& prefix, ProjectBinaryArchiveWriter* writer);
+
+    /**
+     * @brief Inverse of moveContextsToSections: the contexts of this node and of its children are decoded from the sections of
+     * the given reader the first time getRotoContext() or getTrackerContext() is called.
+     **/
+    void setContextsSections(const std::string& prefix, const boost::shared_ptr<ProjectBinaryArchiveReader>& reader);
+
     const std::string & getMultiInstanceParentName() const
     {
         return _multiInstanceParentName;
@@ -230,6 +251,11 @@ public:
         return _children;
     }
 
+    std::list< boost::shared_ptr<NodeSerialization> >& getNodesCollection()
+    {
+        return _children;
+    }
+
     const std::list<ImageComponents>& getUserCreatedComponents() const
     {
         return _userComponents;
@@ -249,9 +275,13 @@ private:
     std::map<std::string, std::string> _inputs;
     std::vector<std::string> _oldInputs;
     bool _hasRotoContext;
-    RotoContextSerialization _rotoContext;
+    mutable RotoContextSerialization _rotoContext;
     bool _hasTrackerContext;
-    TrackerContextSerialization _trackerContext;
+    mutable TrackerContextSerialization _trackerContext;
+
+    // Binary projects: the sections the contexts are decoded from on demand
+    mutable boost::shared_ptr<ProjectBinaryArchiveReader> _contextsArchive;
+    mutable std::string _rotoContextSection, _trackerContextSection;
     NodePtr _node;
     std::string _multiInstanceParentName;
     std::list<boost::shared_ptr<GroupKnobSerialization> > _userPages;
@@ -263,6 +293,8 @@ private:
     unsigned int _pythonModuleVersion;
     std::list<ImageComponents> _userComponents;
 
+    void decodeContextsSections() const;
+
     friend class ::boost::serialization::access;
     template<class Archive>
     void save(Archive & ar,
@@ -439,6 +439,14 @@ OutputEffectInstance::reportStats(int time,
     }
 
     ofile << "Time spent to render frame (wall clock time): " << Timer::printAsTime(wallTime, false).toStdString() << std::endl;
+    {
+        U64 nbHashPropagations, totalNbNodesRehashed;
+        int lastNbNodesVisited, lastNbNodesRehashed;
+        RenderStats::getHashPropagationInfos(&nbHashPropagations, &totalNbNodesRehashed, &lastNbNodesVisited, &lastNbNodesRehashed);
+        ofile << "Nb node hash propagations (edits): " << nbHashPropagations << std::endl;
+        ofile << "Nb nodes re-hashed (total): " << totalNbNodesRehashed << std::endl;
+        ofile << "Nb nodes re-hashed by the last edit: " << lastNbNodesRehashed << " (out of " << lastNbNodesVisited << " visited)" << std::endl;
+    }
     for (std::map<NodePtr, NodeRenderStats >::const_iterator it = stats.begin(); it != stats.end(); ++it) {
         ofile << "------------------------------- " << it->first->getScriptName_mt_safe() << "------------------------------- " << std::endl;
         ofile << "Time spent rendering: " << Timer::printAsTime(it->second.getTotalTimeSpentRendering(), false).toStdString() << std::endl;
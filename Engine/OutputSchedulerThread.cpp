@@ -57,6 +57,7 @@
 #include "Engine/GenericSchedulerThreadWatcher.h"
 #include "Engine/Project.h"
 #include "Engine/RenderStats.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoContext.h"
 #include "Engine/Settings.h"
 #include "Engine/Timer.h"
@@ -66,6 +67,7 @@
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/WriteNode.h"
+#include "Engine/WritersRenderGroup.h"
 
 #ifdef DEBUG
 //#define TRACE_SCHEDULER
@@ -88,6 +90,9 @@
 
 #define NATRON_SCHEDULER_ABORT_AFTER_X_UNSUCCESSFUL_ITERATIONS 5000
 
+// How long the ViewerPlaybackPrefetcher sleeps before checking again whether the viewer is idle
+#define NATRON_VIEWER_PREFETCH_IDLE_WAIT_MS 50
+
 NATRON_NAMESPACE_ENTER;
 
 
@@ -238,6 +243,8 @@ struct OutputSchedulerThreadPrivate
     QMutex bufferedOutputMutex;
     int lastBufferedOutputSize;
 
+    ///Splits the threads of the render between frames and tiles, MT-safe
+    RenderThreadsPlanner threadsPlanner;
 
     OutputSchedulerThreadPrivate(RenderEngine* engine,
                                  const boost::shared_ptr<OutputEffectInstance>& effect,
@@ -277,6 +284,7 @@ struct OutputSchedulerThreadPrivate
 #endif
         , bufferedOutputMutex()
         , lastBufferedOutputSize(0)
+        , threadsPlanner()
     {
     }
 
@@ -1052,18 +1060,21 @@ OutputSchedulerThread::startRender()
     _imp->engine->s_renderStarted(forward);
 
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
-    int nThreads;
     {
         QMutexLocker l(&_imp->renderThreadsMutex);
         _imp->removeAllQuitRenderThreads();
-        nThreads = (int)_imp->renderThreads.size();
     }
 
-    ///Start with one thread if it doesn't exist
-    if (nThreads == 0) {
-        int lastNThreads;
-        adjustNumberOfThreads(&nThreads, &lastNThreads);
+    ///Size the split between frame threads and tile threads up front and start all the frame threads at once.
+    ///When frames are ordered the number of frames is not bounded: the playback may loop
+    int nFrames = 0;
+    if (getSchedulingPolicy() == eSchedulingPolicyFFA) {
+        nFrames = (int)std::ceil( (double)(lastFrame - firstFrame + 1) / frameStep );
     }
+    _imp->threadsPlanner.startRender( getAvailableRenderThreads(), appPTR->getCurrentSettings()->getNumberOfParallelRenders(), nFrames );
+
+    int nThreads, lastNThreads;
+    adjustNumberOfThreads(&nThreads, &lastNThreads);
 #endif
 
     QMutexLocker l(&_imp->renderThreadsMutex);
@@ -1154,6 +1165,7 @@ OutputSchedulerThread::stopRender()
     stopRenderThreads(0);
 #endif
     _imp->waitForRenderThreadsToQuit();
+    _imp->threadsPlanner.stopRender();
 
     ///If the output effect is sequential (only WriteFFMPEG for now)
     EffectInstPtr effect = _imp->outputEffect.lock();
@@ -1490,52 +1502,46 @@ OutputSchedulerThread::executeOnMainThread(const ExecOnMTArgsPtr& inArgs)
 }
 
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+int
+OutputSchedulerThread::getAvailableRenderThreads() const
+{
+    ///How many threads are running for the other renders of the application
+    int otherRunningThreads = appPTR->getNRunningThreads() - getNRenderThreads();
+
+    return std::max( 1, appPTR->getHardwareIdealThreadCount() - std::max(0, otherRunningThreads) );
+}
+
 void
 OutputSchedulerThread::adjustNumberOfThreads(int* newNThreads,
                                              int *lastNThreads)
 {
-    ///////////
-    /////If we were analysing the CPU activity, now set the appropriate number of threads to render.
-    int optimalNThreads;
-
-    ///How many parallel renders the user wants
-    int userSettingParallelThreads = appPTR->getCurrentSettings()->getNumberOfParallelRenders();
-
-    ///How many threads are running in the application
-    int runningThreads = appPTR->getNRunningThreads() + QThreadPool::globalInstance()->activeThreadCount();
-
-    ///How many current threads are used by THIS renderer
-    int currentParallelRenders = getNRenderThreads();
+    ///How many current threads are used by THIS renderer, not counting the ones that are about to quit
+    int currentParallelRenders = 0;
+    {
+        QMutexLocker l(&_imp->renderThreadsMutex);
+        for (RenderThreads::const_iterator it = _imp->renderThreads.begin(); it != _imp->renderThreads.end(); ++it) {
+            if ( !it->thread->mustQuit() ) {
+                ++currentParallelRenders;
+            }
+        }
+    }
 
     *lastNThreads = currentParallelRenders;
 
-    if (userSettingParallelThreads == 0) {
-        ///User wants it to be automatically computed, do a simple heuristic: launch as many parallel renders
-        ///as there are cores
-        optimalNThreads = appPTR->getHardwareIdealThreadCount();
-    } else {
-        optimalNThreads = userSettingParallelThreads;
-    }
-    optimalNThreads = std::max(1, optimalNThreads);
+    ///Let the planner shrink or grow the frame threads when other renders start or stop
+    _imp->threadsPlanner.setAvailableThreads( getAvailableRenderThreads() );
 
+    int optimalNThreads = std::max(1, _imp->threadsPlanner.getPlan().nbFrameThreads);
 
-    if ( ( (runningThreads < optimalNThreads) && (currentParallelRenders < optimalNThreads) ) || (currentParallelRenders == 0) ) {
-        ////////
-        ///Launch 1 thread
+    if (currentParallelRenders < optimalNThreads) {
         QMutexLocker l(&_imp->renderThreadsMutex);
-
-        _imp->appendRunnable( createRunnable() );
-        *newNThreads = currentParallelRenders +  1;
-    } else if ( (runningThreads > optimalNThreads) && (currentParallelRenders > optimalNThreads) ) {
-        ////////
-        ///Stop 1 thread
-        stopRenderThreads(1);
-        *newNThreads = currentParallelRenders - 1;
-    } else {
-        /////////
-        ///Keep the current count
-        *newNThreads = std::max(1, currentParallelRenders);
+        for (int i = currentParallelRenders; i < optimalNThreads; ++i) {
+            _imp->appendRunnable( createRunnable() );
+        }
+    } else if (currentParallelRenders > optimalNThreads) {
+        stopRenderThreads(currentParallelRenders - optimalNThreads);
     }
+    *newNThreads = optimalNThreads;
 }
 
 #endif // ifndef NATRON_PLAYBACK_USES_THREAD_POOL
@@ -1551,6 +1557,11 @@ OutputSchedulerThread::notifyFrameRendered(int frame,
 
     bool isLastView = viewIndex == viewsToRender[viewsToRender.size() - 1] || viewIndex == -1;
 
+    // Rebalance the render threads with the measures of the frame before adjusting their number below
+    if ( isLastView && (policy == eSchedulingPolicyFFA) ) {
+        notifyFrameRenderMeasures(stats);
+    }
+
     // Report render stats if desired
     boost::shared_ptr<OutputEffectInstance> effect = _imp->outputEffect.lock();
     if (stats) {
@@ -1896,6 +1907,23 @@ OutputSchedulerThread::getNActiveRenderThreads() const
     return _imp->getNActiveRenderThreads();
 }
 
+RenderThreadsPlan
+OutputSchedulerThread::getThreadsPlan() const
+{
+    return _imp->threadsPlanner.getPlan();
+}
+
+void
+OutputSchedulerThread::notifyFrameRenderMeasures(const RenderStatsPtr& stats)
+{
+    if (!stats) {
+        return;
+    }
+    int nbCacheMisses, nbCacheHits;
+    stats->getCacheAccessInfos(&nbCacheMisses, &nbCacheHits);
+    _imp->threadsPlanner.addFrameSample(stats->getTimeSpentForFrame(), nbCacheHits, nbCacheMisses);
+}
+
 void
 OutputSchedulerThread::stopRenderThreads(int nThreadsToStop)
 {
@@ -2180,8 +2208,15 @@ private:
             return;
         }
 
+        RenderTrace::Scope traceScope( "frame", "renderFrame", output.get(), time, viewsToRender.empty() ? ViewIdx(0) : viewsToRender.front() );
         AbortableThread* isAbortableThread = dynamic_cast<AbortableThread*>( QThread::currentThread() );
 
+        ///When rendered together with other writers, stay in step with them so that their shared upstream nodes are rendered once per frame
+        WritersRenderGroupPtr writersGroup = output->getNode()->getWritersRenderGroup();
+        if (writersGroup) {
+            writersGroup->waitForFrameTurn(output.get(), time);
+        }
+
         ///Even if enableRenderStats is false, we at least profile the time spent rendering the frame when rendering with a Write node.
         ///Though we don't enable render stats for sequential renders (e.g: WriteFFMPEG) since this is 1 file.
         RenderStatsPtr stats( new RenderStats(enableRenderStats) );
@@ -2359,6 +2394,9 @@ private:
                 _imp->scheduler->notifyFrameRendered(time, viewsToRender[view], viewsToRender, stats, eSchedulingPolicyFFA);
                 //}
             }
+            if (writersGroup) {
+                writersGroup->notifyFrameRendered(output.get(), time);
+            }
         } catch (const std::exception& e) {
             _imp->scheduler->notifyRenderFailure( std::string("Error while rendering: ") + e.what() );
         }
@@ -2617,6 +2655,11 @@ DefaultScheduler::onRenderStopped(bool aborted)
 
     effect->notifyRenderFinished();
 
+    WritersRenderGroupPtr writersGroup = effect->getNode()->getWritersRenderGroup();
+    if (writersGroup) {
+        writersGroup->removeWriter( effect.get() );
+    }
+
     std::string cb = effect->getNode()->getAfterRenderCallback();
     if ( !cb.empty() ) {
         std::vector<std::string> args;
@@ -2791,11 +2834,9 @@ private:
                              const std::vector<ViewIdx>& viewsToRender,
                              bool enableRenderStats)
     {
-        RenderStatsPtr stats;
+        ///Even if enableRenderStats is false, we at least measure the frame for the threads planner of the scheduler
+        RenderStatsPtr stats( new RenderStats(enableRenderStats) );
 
-        if (enableRenderStats) {
-            stats.reset( new RenderStats(enableRenderStats) );
-        }
         ///The viewer always uses the scheduler thread to regulate the output rate, @see ViewerInstance::renderViewer_internal
         ///it calls appendToBuffer by itself
         ViewerInstance::ViewerRenderRetCode stat = ViewerInstance::eViewerRenderRetCodeRedraw;
@@ -2804,6 +2845,7 @@ private:
         assert(viewsToRender.size() == 1);
         ViewIdx view = viewsToRender.front();
         boost::shared_ptr<ViewerInstance> viewer = _viewer.lock();
+        RenderTrace::Scope traceScope("frame", "renderFrame", viewer.get(), time, view);
         U64 viewerHash = viewer->getHash();
         boost::shared_ptr<ViewerArgs> args[2];
         ViewerInstance::ViewerRenderRetCode status[2] = {
@@ -2870,6 +2912,7 @@ private:
                 }
             }
         }
+        _imp->scheduler->notifyFrameRenderMeasures(stats);
         _imp->scheduler->appendToBuffer(time, view, stats, toAppend);
     } // renderFrame
 };
@@ -2934,6 +2977,9 @@ struct RenderEnginePrivate
     PlaybackModeEnum pbMode;
     ViewerCurrentFrameRequestScheduler* currentFrameScheduler;
 
+    // Only for viewers, created with currentFrameScheduler
+    ViewerPlaybackPrefetcher* prefetcher;
+
     // Only used on the main-thread
     boost::scoped_ptr<RenderEngineWatcher> engineWatcher;
     struct RefreshRequest
@@ -2958,6 +3004,7 @@ struct RenderEnginePrivate
         , pbModeMutex()
         , pbMode(ePlaybackModeLoop)
         , currentFrameScheduler(0)
+        , prefetcher(0)
         , refreshQueue()
     {
     }
@@ -2971,6 +3018,8 @@ RenderEngine::RenderEngine(const boost::shared_ptr<OutputEffectInstance>& output
 
 RenderEngine::~RenderEngine()
 {
+    delete _imp->prefetcher;
+    _imp->prefetcher = 0;
     delete _imp->currentFrameScheduler;
     _imp->currentFrameScheduler = 0;
     delete _imp->scheduler;
@@ -2999,6 +3048,9 @@ RenderEngine::renderFrameRange(bool isBlocking,
                                RenderDirectionEnum forward)
 {
     setPlaybackAutoRestartEnabled(true);
+    if (_imp->prefetcher) {
+        _imp->prefetcher->abortThreadedTask();
+    }
 
     {
         QMutexLocker k(&_imp->schedulerCreationLock);
@@ -3016,6 +3068,9 @@ RenderEngine::renderFromCurrentFrame(bool enableRenderStats,
                                      RenderDirectionEnum forward)
 {
     setPlaybackAutoRestartEnabled(true);
+    if (_imp->prefetcher) {
+        _imp->prefetcher->abortThreadedTask();
+    }
 
     {
         QMutexLocker k(&_imp->schedulerCreationLock);
@@ -3064,6 +3119,10 @@ RenderEngine::renderCurrentFrameInternal(bool enableRenderStats,
         return;
     }
 
+    ///Frames being prefetched would slow down this render
+    if (_imp->prefetcher) {
+        _imp->prefetcher->abortThreadedTask();
+    }
 
     ///If the scheduler is already doing playback, continue it
     if (_imp->scheduler) {
@@ -3091,9 +3150,13 @@ RenderEngine::renderCurrentFrameInternal(bool enableRenderStats,
 
     if (!_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler = new ViewerCurrentFrameRequestScheduler(isViewer);
+        _imp->prefetcher = new ViewerPlaybackPrefetcher(this, isViewer);
     }
 
     _imp->currentFrameScheduler->renderCurrentFrame(enableRenderStats, canAbort);
+
+    ///Once the viewer is idle, render the next frames that playback would render
+    _imp->prefetcher->prefetchFrom( isViewer->getTimeline()->currentFrame() );
 }
 
 void
@@ -3134,6 +3197,10 @@ RenderEngine::quitEngine(bool allowRestarts)
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->quitThread(allowRestarts);
     }
+
+    if (_imp->prefetcher) {
+        _imp->prefetcher->quitThread(allowRestarts);
+    }
 }
 
 void
@@ -3146,6 +3213,10 @@ RenderEngine::waitForEngineToQuit_not_main_thread()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForThreadToQuit_not_main_thread();
     }
+
+    if (_imp->prefetcher) {
+        _imp->prefetcher->waitForThreadToQuit_not_main_thread();
+    }
 }
 
 void
@@ -3168,6 +3239,10 @@ RenderEngine::waitForEngineToQuit_enforce_blocking()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForThreadToQuit_enforce_blocking();
     }
+
+    if (_imp->prefetcher) {
+        _imp->prefetcher->waitForThreadToQuit_enforce_blocking();
+    }
 }
 
 bool
@@ -3179,6 +3254,11 @@ RenderEngine::abortRenderingInternal(bool keepOldestRender)
         ret |= _imp->currentFrameScheduler->abortThreadedTask(keepOldestRender);
     }
 
+    // Prefetching is not a render the user waits for: do not report it
+    if (_imp->prefetcher) {
+        _imp->prefetcher->abortThreadedTask();
+    }
+
     if ( _imp->scheduler && _imp->scheduler->isWorking() ) {
         //If any playback active, abort it
         ret |= _imp->scheduler->abortThreadedTask(keepOldestRender);
@@ -3218,6 +3298,9 @@ RenderEngine::waitForAbortToComplete_not_main_thread()
     if (_imp->scheduler) {
         _imp->scheduler->waitForAbortToComplete_not_main_thread();
     }
+    if (_imp->prefetcher) {
+        _imp->prefetcher->waitForAbortToComplete_not_main_thread();
+    }
 }
 
 void
@@ -3230,6 +3313,10 @@ RenderEngine::waitForAbortToComplete_enforce_blocking()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForAbortToComplete_enforce_blocking();
     }
+
+    if (_imp->prefetcher) {
+        _imp->prefetcher->waitForAbortToComplete_enforce_blocking();
+    }
 }
 
 void
@@ -3286,8 +3373,12 @@ RenderEngine::hasThreadsAlive() const
     if (_imp->currentFrameScheduler) {
         currentFrameSchedulerRunning = _imp->currentFrameScheduler->isRunning();
     }
+    bool prefetcherRunning = false;
+    if (_imp->prefetcher) {
+        prefetcherRunning = _imp->prefetcher->isRunning();
+    }
 
-    return schedulerRunning || currentFrameSchedulerRunning;
+    return schedulerRunning || currentFrameSchedulerRunning || prefetcherRunning;
 }
 
 bool
@@ -3346,6 +3437,29 @@ RenderEngine::getDesiredFPS() const
     return _imp->scheduler ? _imp->scheduler->getDesiredFPS() : 24;
 }
 
+RenderThreadsPlan
+RenderEngine::getThreadsPlan() const
+{
+    if (!_imp->scheduler) {
+        return RenderThreadsPlan();
+    }
+
+    return _imp->scheduler->getThreadsPlan();
+}
+
+RenderDirectionEnum
+RenderEngine::getPlaybackDirection() const
+{
+    RenderDirectionEnum direction = eRenderDirectionForward;
+
+    if (_imp->scheduler) {
+        std::vector<ViewIdx> views;
+        _imp->scheduler->getLastRunArgs(&direction, &views);
+    }
+
+    return direction;
+}
+
 void
 RenderEngine::notifyFrameProduced(const BufferableObjectList& frames,
                                   const RenderStatsPtr& stats,
@@ -3980,6 +4094,229 @@ ViewerCurrentFrameRequestRendererBackup::threadLoopOnce(const ThreadStartArgsPtr
     return eThreadStateActive;
 }
 
+////////////////////////ViewerPlaybackPrefetcher////////////////////////
+class ViewerPlaybackPrefetchArgs
+    : public GenericThreadStartArgs
+{
+public:
+
+    int frame;
+    int firstFrame, lastFrame;
+    int nFrames;
+    RenderDirectionEnum direction;
+    PlaybackModeEnum playbackMode;
+    ViewIdx view;
+    U64 viewerHash;
+
+    ViewerPlaybackPrefetchArgs()
+        : GenericThreadStartArgs()
+        , frame(0)
+        , firstFrame(0)
+        , lastFrame(0)
+        , nFrames(0)
+        , direction(eRenderDirectionForward)
+        , playbackMode(ePlaybackModeLoop)
+        , view(0)
+        , viewerHash(0)
+    {
+    }
+
+    virtual ~ViewerPlaybackPrefetchArgs()
+    {
+    }
+};
+
+struct ViewerPlaybackPrefetcherPrivate
+{
+    RenderEngine* engine;
+    ViewerInstance* viewer;
+
+    // Protects abortInfos and wakes up the thread waiting for the viewer to be idle when aborting
+    QMutex abortInfosMutex;
+    QWaitCondition abortRequestedCond;
+
+    // The abort infos of the frame being rendered
+    AbortableRenderInfoPtr abortInfos[2];
+
+    ViewerPlaybackPrefetcherPrivate(RenderEngine* engine,
+                                    ViewerInstance* viewer)
+        : engine(engine)
+        , viewer(viewer)
+        , abortInfosMutex()
+        , abortRequestedCond()
+        , abortInfos()
+    {
+    }
+
+    /**
+     * @brief Returns true if the viewer does not render anything else and the global thread pool has idle threads
+     **/
+    bool isViewerIdle() const
+    {
+        QThreadPool* threadPool = QThreadPool::globalInstance();
+
+        return !engine->hasThreadsWorking() && threadPool->activeThreadCount() < threadPool->maxThreadCount();
+    }
+};
+
+ViewerPlaybackPrefetcher::ViewerPlaybackPrefetcher(RenderEngine* engine,
+                                                   ViewerInstance* viewer)
+    : GenericSchedulerThread()
+    , _imp( new ViewerPlaybackPrefetcherPrivate(engine, viewer) )
+{
+    setThreadName("ViewerPlaybackPrefetcher");
+}
+
+ViewerPlaybackPrefetcher::~ViewerPlaybackPrefetcher()
+{
+}
+
+void
+ViewerPlaybackPrefetcher::prefetchFrom(int frame)
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    int nFrames = appPTR->getCurrentSettings()->getPlaybackPrefetchFrames();
+    if ( (nFrames <= 0) || (appPTR->getCurrentSettings()->getNumberOfThreads() == -1) ) {
+        return;
+    }
+
+    // Do not render frames that would not be displayed by playback: draft renders or renders of a viewer that is not visible
+    if ( !_imp->viewer->isViewerUIVisible() || _imp->viewer->getApp()->isDraftRenderEnabled() || _imp->viewer->isDoingPartialUpdates() ) {
+        return;
+    }
+    NodePtr rotoPaintNode;
+    boost::shared_ptr<RotoStrokeItem> curStroke;
+    bool isDrawing;
+    _imp->viewer->getApp()->getActiveRotoDrawingStroke(&rotoPaintNode, &curStroke, &isDrawing);
+    if (isDrawing) {
+        return;
+    }
+
+    boost::shared_ptr<ViewerPlaybackPrefetchArgs> args(new ViewerPlaybackPrefetchArgs);
+    args->frame = frame;
+    args->nFrames = nFrames;
+    args->direction = _imp->engine->getPlaybackDirection();
+    args->playbackMode = _imp->engine->getPlaybackMode();
+    args->view = _imp->viewer->getRenderViewsCount() > 0 ? _imp->viewer->getViewerCurrentView() : ViewIdx(0);
+    args->viewerHash = _imp->viewer->getHash();
+
+    // Same frame range as ViewerDisplayScheduler::getFrameRangeToRender
+    ViewerInstance* leadViewer = _imp->viewer->getApp()->getLastViewerUsingTimeline();
+    ( leadViewer ? leadViewer : _imp->viewer )->getTimelineBounds(&args->firstFrame, &args->lastFrame);
+    if (args->firstFrame > args->lastFrame) {
+        return;
+    }
+
+    startTask(args);
+}
+
+void
+ViewerPlaybackPrefetcher::onAbortRequested(bool /*keepOldestRender*/)
+{
+    QMutexLocker k(&_imp->abortInfosMutex);
+
+    for (int i = 0; i < 2; ++i) {
+        if (_imp->abortInfos[i]) {
+            _imp->abortInfos[i]->setAborted();
+        }
+    }
+    _imp->abortRequestedCond.wakeAll();
+}
+
+void
+ViewerPlaybackPrefetcher::onQuitRequested(bool /*allowRestarts*/)
+{
+    QMutexLocker k(&_imp->abortInfosMutex);
+
+    _imp->abortRequestedCond.wakeAll();
+}
+
+GenericSchedulerThread::ThreadStateEnum
+ViewerPlaybackPrefetcher::threadLoopOnce(const ThreadStartArgsPtr& inArgs)
+{
+    boost::shared_ptr<ViewerPlaybackPrefetchArgs> args = boost::dynamic_pointer_cast<ViewerPlaybackPrefetchArgs>(inArgs);
+
+    assert(args);
+
+    // Speculative renders must not slow down the renders the user is waiting for
+    setPriority(QThread::LowestPriority);
+
+    std::set<int> visitedFrames;
+    visitedFrames.insert(args->frame);
+    int frame = args->frame;
+    RenderDirectionEnum direction = args->direction;
+    for (int i = 0; i < args->nFrames; ++i) {
+        if ( !OutputSchedulerThreadPrivate::getNextFrameInSequence(args->playbackMode, direction, frame, args->firstFrame, args->lastFrame, 1, &frame, &direction) ) {
+            break;
+        }
+
+        // The frame range is shorter than the number of frames to prefetch
+        if ( !visitedFrames.insert(frame).second ) {
+            break;
+        }
+
+        // Wait for the viewer to be idle
+        for (;; ) {
+            ThreadStateEnum state = resolveState();
+            if ( (state == eThreadStateStopped) || (state == eThreadStateAborted) ) {
+                return state;
+            }
+            if ( _imp->isViewerIdle() ) {
+                break;
+            }
+            QMutexLocker k(&_imp->abortInfosMutex);
+            _imp->abortRequestedCond.wait(&_imp->abortInfosMutex, NATRON_VIEWER_PREFETCH_IDLE_WAIT_MS);
+        }
+
+        AbortableRenderInfoPtr abortInfos[2];
+        for (int j = 0; j < 2; ++j) {
+            abortInfos[j] = _imp->viewer->createRenderRequest(j, true);
+        }
+        {
+            QMutexLocker k(&_imp->abortInfosMutex);
+            for (int j = 0; j < 2; ++j) {
+                _imp->abortInfos[j] = abortInfos[j];
+            }
+        }
+
+        // An abort requested before the abort infos were set did not abort them
+        ThreadStateEnum state = resolveState();
+        ViewerInstance::ViewerRenderRetCode stat = ViewerInstance::eViewerRenderRetCodeFail;
+        if (state == eThreadStateActive) {
+            try {
+                stat = _imp->viewer->prefetchFrame(frame, args->view, args->viewerHash, abortInfos);
+            } catch (...) {
+                stat = ViewerInstance::eViewerRenderRetCodeFail;
+            }
+
+            ///This thread is done with this render, clean-up its TLS
+            appPTR->getAppTLS()->cleanupTLSForThread();
+        }
+
+        {
+            QMutexLocker k(&_imp->abortInfosMutex);
+            for (int j = 0; j < 2; ++j) {
+                _imp->abortInfos[j].reset();
+            }
+        }
+
+        if (state == eThreadStateActive) {
+            state = resolveState();
+        }
+        if ( (state == eThreadStateStopped) || (state == eThreadStateAborted) ) {
+            return state;
+        }
+
+        // The graph cannot be rendered, playback would stop here
+        if (stat == ViewerInstance::eViewerRenderRetCodeFail) {
+            break;
+        }
+    }
+
+    return eThreadStateActive;
+} // ViewerPlaybackPrefetcher::threadLoopOnce
+
 NATRON_NAMESPACE_EXIT;
 
 NATRON_NAMESPACE_USING;
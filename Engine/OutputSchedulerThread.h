@@ -295,6 +295,18 @@ public:
      **/
     int getNActiveRenderThreads() const;
 
+    /**
+     * @brief Returns how the threads of the current render are split between frames and tiles, and the measures
+     * the split was decided from (see RenderThreadsPlanner).
+     **/
+    RenderThreadsPlan getThreadsPlan() const;
+
+    /**
+     * @brief Called by the render threads once a frame is rendered: its render time and cache hit rate are used
+     * to rebalance the threads of the render.
+     **/
+    void notifyFrameRenderMeasures(const RenderStatsPtr& stats);
+
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
     /**
      * @brief Called by render-threads to pick some work to do or to get asleep if theres nothing to do
@@ -449,10 +461,15 @@ private:
     void pushAllFrameRange();
 
     /**
-     * @brief Starts/stops more threads according to CPU activity and user preferences
-     * @param optimalNThreads[out] Will be set to the new number of threads
+     * @brief Starts/stops threads so that as many frames as decided by the threads planner are rendered concurrently
+     * @param newNThreads[out] Will be set to the new number of threads
      **/
     void adjustNumberOfThreads(int* newNThreads, int *lastNThreads);
+
+    /**
+     * @brief Returns the number of threads of the hardware that are not rendering for another render
+     **/
+    int getAvailableRenderThreads() const;
 #else
     void startTasksFromLastStartedFrame();
     void startTasks(int startingFrame);
@@ -621,6 +638,50 @@ private:
     virtual ThreadStateEnum threadLoopOnce(const ThreadStartArgsPtr& inArgs) OVERRIDE FINAL WARN_UNUSED_RETURN;
 };
 
+/**
+ * @brief Renders in the background into the ViewerCache the frames that playback would render next from the current frame,
+ * so that starting playback or stepping through frames does not wait for them. It follows the playback direction, mode and
+ * frame range of the viewer (see OutputSchedulerThreadPrivate::getNextFrameInSequence).
+ * Frames are only rendered when the viewer has nothing else to render, one at a time in a low priority thread, and each
+ * render is aborted through its AbortableRenderInfo as soon as another render of the viewer starts.
+ **/
+struct ViewerPlaybackPrefetcherPrivate;
+class ViewerPlaybackPrefetcher
+    : public GenericSchedulerThread
+{
+public:
+
+    ViewerPlaybackPrefetcher(RenderEngine* engine,
+                             ViewerInstance* viewer);
+
+    virtual ~ViewerPlaybackPrefetcher();
+
+    /**
+     * @brief Prefetches the frames following the given frame, replacing any previous request.
+     * Must be called on the main-thread.
+     **/
+    void prefetchFrom(int frame);
+
+private:
+
+    virtual void onAbortRequested(bool keepOldestRender) OVERRIDE FINAL;
+    virtual void onQuitRequested(bool allowRestarts) OVERRIDE FINAL;
+
+    /**
+     * @brief How to pick the task to process from the consumer thread
+     **/
+    virtual TaskQueueBehaviorEnum tasksQueueBehaviour() const OVERRIDE FINAL
+    {
+        return eTaskQueueBehaviorSkipToMostRecent;
+    }
+
+    /**
+     * @brief Must be implemented to execute the work of the thread for 1 loop. This function will be called in a infinite loop by the thread
+     **/
+    virtual ThreadStateEnum threadLoopOnce(const ThreadStartArgsPtr& inArgs) OVERRIDE FINAL WARN_UNUSED_RETURN;
+    boost::scoped_ptr<ViewerPlaybackPrefetcherPrivate> _imp;
+};
+
 
 /**
  * @brief This class manages multiple OutputThreadScheduler so that each render request gets processed as soon as possible.
@@ -691,6 +752,17 @@ public:
      **/
     double getDesiredFPS() const;
 
+    /**
+     * @brief Returns the direction of the last playback started on this engine
+     **/
+    RenderDirectionEnum getPlaybackDirection() const;
+
+    /**
+     * @brief Returns how the threads of the current sequential render are split between frames and tiles,
+     * see OutputSchedulerThread::getThreadsPlan
+     **/
+    RenderThreadsPlan getThreadsPlan() const;
+
     /**
      * @brief Quit all processing, making sure all threads are finished, this is not blocking
      **/
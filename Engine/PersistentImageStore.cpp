@@ -0,0 +1,913 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "PersistentImageStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <set>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <vector>
+
+#ifdef __NATRON_WIN32__
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h> // flock
+#include <unistd.h>
+#endif
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/weak_ptr.hpp>
+#endif
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QDebug>
+
+#include "Engine/Cache.h"
+#include "Engine/FStreamsSupport.h"
+#include "Engine/Hash64.h"
+#include "Engine/Image.h"
+#include "Engine/ImageParamsSerialization.h"
+#include "Engine/ImageSerialization.h"
+#include "Engine/MemoryFile.h"
+
+#define NATRON_PERSISTENT_STORE_INDEX_FILE_NAME "index.bin"
+#define NATRON_PERSISTENT_STORE_INDEX_LOCK_FILE_NAME "index.lock"
+#define NATRON_PERSISTENT_STORE_DATA_LOCK_FILE_NAME "data.lock"
+#define NATRON_PERSISTENT_STORE_INDEX_MAGIC 0x4e505349 // NPSI
+#define NATRON_PERSISTENT_STORE_INDEX_VERSION 1
+#define NATRON_PERSISTENT_STORE_RECORD_MAGIC 0x4e505352 // NPSR
+
+// Number of slots of the index hash table, must be a power of 2. Each slot takes 32 bytes.
+#define NATRON_PERSISTENT_STORE_INDEX_SLOTS 65536
+
+// Entries are evicted when the table is more than this full, so that probe sequences remain short
+#define NATRON_PERSISTENT_STORE_MAX_LOAD_FACTOR 0.75
+
+// When evicting, the store is shrinked down to this fraction of its limits
+#define NATRON_PERSISTENT_STORE_EVICTION_TARGET 0.9
+
+#define NATRON_PERSISTENT_STORE_SECONDS_PER_DAY (24 * 3600)
+
+// Images reported while this many are waiting to be written are not written
+#define NATRON_PERSISTENT_STORE_MAX_QUEUED_IMAGES 256
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+/*
+ * The index file is a header followed by NATRON_PERSISTENT_STORE_INDEX_SLOTS slots, mapped as is.
+ * Collisions are resolved with linear probing, and removals shift back the following slots
+ * so that no tombstone is needed.
+ */
+struct PersistentStoreIndexHeader
+{
+    U32 magic;
+    U32 version;
+    U32 cacheVersion;
+    U32 hashAlgorithm;
+    U32 slotsCount;
+    U32 entriesCount;
+    U64 totalSize;
+};
+
+struct PersistentStoreIndexSlot
+{
+    U64 hash;
+    U64 size; // total size of the file of this hash
+    U64 lastAccess; // seconds since epoch
+    U32 used;
+    U32 padding;
+};
+
+U64
+getCurrentTime()
+{
+    return (U64)std::time(0);
+}
+
+/*
+ * An exclusive lock shared by all the processes that use the same store: the index is mapped by all of them
+ * and they all write to the data files. The lock file is shared by the threads of a process, which must hold
+ * the mutex protecting the same resource before locking it.
+ */
+class PersistentStoreProcessLock
+{
+#ifdef __NATRON_WIN32__
+    HANDLE _handle;
+#else
+    int _fd;
+#endif
+
+public:
+
+    PersistentStoreProcessLock()
+#ifdef __NATRON_WIN32__
+        : _handle(INVALID_HANDLE_VALUE)
+#else
+        : _fd(-1)
+#endif
+    {
+    }
+
+    ~PersistentStoreProcessLock()
+    {
+#ifdef __NATRON_WIN32__
+        if (_handle != INVALID_HANDLE_VALUE) {
+            ::CloseHandle(_handle);
+        }
+#else
+        if (_fd != -1) {
+            ::close(_fd);
+        }
+#endif
+    }
+
+    bool open(const std::string& path)
+    {
+#ifdef __NATRON_WIN32__
+        std::wstring wpath = Global::utf8_to_utf16(path);
+        _handle = ::CreateFileW(wpath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+
+        return _handle != INVALID_HANDLE_VALUE;
+#else
+        _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+        return _fd != -1;
+#endif
+    }
+
+    void lock()
+    {
+#ifdef __NATRON_WIN32__
+        OVERLAPPED overlapped;
+        std::memset( &overlapped, 0, sizeof(overlapped) );
+        ::LockFileEx(_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped);
+#else
+        while ( (::flock(_fd, LOCK_EX) == -1) && (errno == EINTR) ) {
+        }
+#endif
+    }
+
+    void unlock()
+    {
+#ifdef __NATRON_WIN32__
+        OVERLAPPED overlapped;
+        std::memset( &overlapped, 0, sizeof(overlapped) );
+        ::UnlockFileEx(_handle, 0, 1, 0, &overlapped);
+#else
+        ::flock(_fd, LOCK_UN);
+#endif
+    }
+};
+
+/*
+ * Locks the mutex of this process, then the lock of the other processes
+ */
+class PersistentStoreLocker
+{
+    QMutexLocker _mutexLocker;
+    PersistentStoreProcessLock* _processLock;
+
+public:
+
+    PersistentStoreLocker(QMutex* mutex,
+                          PersistentStoreProcessLock* processLock)
+        : _mutexLocker(mutex)
+        , _processLock(processLock)
+    {
+        _processLock->lock();
+    }
+
+    ~PersistentStoreLocker()
+    {
+        _processLock->unlock();
+    }
+};
+} // anon namespace
+
+class PersistentImageStoreWriterThread
+    : public QThread
+{
+    // The queue does not hold the images: one that is evicted from the cache before being written is not written,
+    // instead of being kept in RAM beyond the cache limits
+    typedef boost::weak_ptr<Image> ImageWPtr;
+
+    PersistentImageStore* _store;
+    mutable QMutex _queueMutex;
+    std::list<ImageWPtr> _queue;
+
+    // The images in _queue, ordered by owner so that an image queued twice is found in O(log n)
+    std::set<ImageWPtr> _queuedImages;
+    QWaitCondition _queueNotEmptyCond;
+    bool _mustQuit;
+
+public:
+
+    PersistentImageStoreWriterThread(PersistentImageStore* store)
+        : QThread()
+        , _store(store)
+        , _queueMutex()
+        , _queue()
+        , _queuedImages()
+        , _queueNotEmptyCond()
+        , _mustQuit(false)
+    {
+        setObjectName( QString::fromUtf8("PersistentCacheWriter") );
+    }
+
+    virtual ~PersistentImageStoreWriterThread()
+    {
+    }
+
+    void appendToQueue(const ImagePtr& image)
+    {
+        {
+            QMutexLocker k(&_queueMutex);
+            if ( _mustQuit || (_queue.size() >= NATRON_PERSISTENT_STORE_MAX_QUEUED_IMAGES) ) {
+                return;
+            }
+            // The same image is often reported several times by concurrent renders
+            if ( !_queuedImages.insert(image).second ) {
+                return;
+            }
+            _queue.push_back(image);
+            _queueNotEmptyCond.wakeOne();
+        }
+        if ( !isRunning() ) {
+            start(QThread::LowPriority);
+        }
+    }
+
+    void quitThread()
+    {
+        {
+            QMutexLocker k(&_queueMutex);
+            _mustQuit = true;
+            _queueNotEmptyCond.wakeOne();
+        }
+        wait();
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (;; ) {
+            ImagePtr front;
+            {
+                QMutexLocker k(&_queueMutex);
+                while ( _queue.empty() && !_mustQuit ) {
+                    _queueNotEmptyCond.wait(&_queueMutex);
+                }
+                if ( _queue.empty() ) {
+                    return;
+                }
+                front = _queue.front().lock();
+                _queuedImages.erase( _queue.front() );
+                _queue.pop_front();
+            }
+            if (front) {
+                _store->writeImage(front);
+            }
+        }
+    }
+};
+
+struct PersistentImageStorePrivate
+{
+    QString directory;
+
+    // Each version of the store has its own sub-directory, so that versions running concurrently do not wipe each other
+    QString storeDirectory;
+
+    // Protect the index, in this process and in the other processes. When both locks are needed, dataLock is taken first.
+    mutable QMutex indexMutex;
+    mutable PersistentStoreProcessLock indexLock;
+    MemoryFile index;
+    bool valid;
+    U64 maximumSize;
+    int maximumAgeDays;
+
+    // Protect the data files: only the writer thread (or a caller of writeImage) writes to them, and they are
+    // removed by the eviction, which holds both locks
+    QMutex writeMutex;
+    PersistentStoreProcessLock dataLock;
+    boost::scoped_ptr<PersistentImageStoreWriterThread> writer;
+
+    PersistentImageStorePrivate(const QString& directory)
+        : directory(directory)
+        , storeDirectory()
+        , indexMutex()
+        , indexLock()
+        , index()
+        , valid(false)
+        , maximumSize(0)
+        , maximumAgeDays(0)
+        , writeMutex()
+        , dataLock()
+        , writer()
+    {
+        storeDirectory = directory + QString::fromUtf8("/v%1.%2.%3").arg(NATRON_PERSISTENT_STORE_INDEX_VERSION).arg(NATRON_CACHE_VERSION).arg( (int)Hash64::getAlgorithm() );
+    }
+
+    PersistentStoreIndexHeader* header() const
+    {
+        return (PersistentStoreIndexHeader*)index.data();
+    }
+
+    PersistentStoreIndexSlot* slots() const
+    {
+        return (PersistentStoreIndexSlot*)( index.data() + sizeof(PersistentStoreIndexHeader) );
+    }
+
+    static std::size_t getIndexFileSize()
+    {
+        return sizeof(PersistentStoreIndexHeader) + NATRON_PERSISTENT_STORE_INDEX_SLOTS * sizeof(PersistentStoreIndexSlot);
+    }
+
+    std::string getFilePath(U64 hash) const
+    {
+        std::ostringstream oss;
+
+        oss << std::hex << std::setfill('0') << std::setw(16) << hash;
+        std::string hashStr = oss.str();
+        std::string ret = storeDirectory.toStdString();
+        ret += '/';
+        ret += hashStr.substr(0, 2);
+        ret += '/';
+        ret += hashStr;
+
+        return ret;
+    }
+
+    bool isHeaderValid() const
+    {
+        const PersistentStoreIndexHeader* h = header();
+
+        return index.size() == getIndexFileSize() &&
+               h->magic == NATRON_PERSISTENT_STORE_INDEX_MAGIC &&
+               h->version == NATRON_PERSISTENT_STORE_INDEX_VERSION &&
+               h->cacheVersion == NATRON_CACHE_VERSION &&
+               h->hashAlgorithm == (U32)Hash64::getAlgorithm() &&
+               h->slotsCount == NATRON_PERSISTENT_STORE_INDEX_SLOTS;
+    }
+
+    void initializeIndex_locked()
+    {
+        std::memset( index.data(), 0, index.size() );
+        PersistentStoreIndexHeader* h = header();
+        h->magic = NATRON_PERSISTENT_STORE_INDEX_MAGIC;
+        h->version = NATRON_PERSISTENT_STORE_INDEX_VERSION;
+        h->cacheVersion = NATRON_CACHE_VERSION;
+        h->hashAlgorithm = (U32)Hash64::getAlgorithm();
+        h->slotsCount = NATRON_PERSISTENT_STORE_INDEX_SLOTS;
+    }
+
+    void removeAllDataFiles()
+    {
+        QDir dir(storeDirectory);
+        QStringList subDirs = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+
+        for (QStringList::iterator it = subDirs.begin(); it != subDirs.end(); ++it) {
+            QDir subDir( dir.absoluteFilePath(*it) );
+            QStringList files = subDir.entryList(QDir::Files);
+            for (QStringList::iterator it2 = files.begin(); it2 != files.end(); ++it2) {
+                subDir.remove(*it2);
+            }
+        }
+    }
+
+    static U32 getHomeSlot(U64 hash)
+    {
+        // The low bits of the hash are well distributed with both hash algorithms
+        return (U32)( hash & (NATRON_PERSISTENT_STORE_INDEX_SLOTS - 1) );
+    }
+
+    int findSlot_locked(U64 hash) const
+    {
+        const PersistentStoreIndexSlot* s = slots();
+
+        for (U32 i = getHomeSlot(hash), n = 0; n < NATRON_PERSISTENT_STORE_INDEX_SLOTS; i = (i + 1) & (NATRON_PERSISTENT_STORE_INDEX_SLOTS - 1), ++n) {
+            if (!s[i].used) {
+                return -1;
+            }
+            if (s[i].hash == hash) {
+                return (int)i;
+            }
+        }
+
+        return -1;
+    }
+
+    int insertSlot_locked(U64 hash)
+    {
+        PersistentStoreIndexSlot* s = slots();
+
+        for (U32 i = getHomeSlot(hash), n = 0; n < NATRON_PERSISTENT_STORE_INDEX_SLOTS; i = (i + 1) & (NATRON_PERSISTENT_STORE_INDEX_SLOTS - 1), ++n) {
+            if (!s[i].used) {
+                s[i].used = 1;
+                s[i].hash = hash;
+                s[i].size = 0;
+                s[i].lastAccess = getCurrentTime();
+                ++header()->entriesCount;
+
+                return (int)i;
+            }
+            if (s[i].hash == hash) {
+                return (int)i;
+            }
+        }
+
+        return -1;
+    }
+
+    // The data lock must be held too, since the file of the slot is removed
+    void removeSlot_locked(U32 i)
+    {
+        PersistentStoreIndexSlot* s = slots();
+        PersistentStoreIndexHeader* h = header();
+
+        assert(s[i].used);
+        QFile::remove( QString::fromUtf8( getFilePath(s[i].hash).c_str() ) );
+        h->totalSize -= std::min(h->totalSize, s[i].size);
+        --h->entriesCount;
+        s[i].used = 0;
+
+        // Shift back the following slots of the cluster that can no longer be reached from their home slot
+        const U32 mask = NATRON_PERSISTENT_STORE_INDEX_SLOTS - 1;
+        U32 hole = i;
+        for (U32 j = (i + 1) & mask; s[j].used; j = (j + 1) & mask) {
+            U32 home = getHomeSlot(s[j].hash);
+            bool homeInHoleToJ = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+            if (!homeInHoleToJ) {
+                s[hole] = s[j];
+                s[j].used = 0;
+                hole = j;
+            }
+        }
+    }
+
+    // The data lock must be held too
+    void evictIfNeeded_locked()
+    {
+        PersistentStoreIndexHeader* h = header();
+        PersistentStoreIndexSlot* s = slots();
+        const U64 now = getCurrentTime();
+
+        if (maximumAgeDays > 0) {
+            const U64 maxAge = (U64)maximumAgeDays * NATRON_PERSISTENT_STORE_SECONDS_PER_DAY;
+            for (U32 i = 0; i < NATRON_PERSISTENT_STORE_INDEX_SLOTS; ++i) {
+                // Removing shifts a following slot into i, check it again
+                while ( s[i].used && (s[i].lastAccess + maxAge < now) ) {
+                    removeSlot_locked(i);
+                }
+            }
+        }
+
+        const U32 maxEntries = (U32)(NATRON_PERSISTENT_STORE_INDEX_SLOTS * NATRON_PERSISTENT_STORE_MAX_LOAD_FACTOR);
+        bool sizeExceeded = maximumSize > 0 && h->totalSize > maximumSize;
+        if ( !sizeExceeded && (h->entriesCount <= maxEntries) ) {
+            return;
+        }
+
+        // Evict the least recently used entries
+        std::vector<std::pair<U64, U64> > lru; // <lastAccess, hash>
+        lru.reserve(h->entriesCount);
+        for (U32 i = 0; i < NATRON_PERSISTENT_STORE_INDEX_SLOTS; ++i) {
+            if (s[i].used) {
+                lru.push_back( std::make_pair(s[i].lastAccess, s[i].hash) );
+            }
+        }
+        std::sort( lru.begin(), lru.end() );
+
+        const U64 targetSize = (U64)(maximumSize * NATRON_PERSISTENT_STORE_EVICTION_TARGET);
+        const U32 targetEntries = (U32)(maxEntries * NATRON_PERSISTENT_STORE_EVICTION_TARGET);
+        for (std::size_t i = 0; i < lru.size(); ++i) {
+            bool overSize = maximumSize > 0 && h->totalSize > targetSize;
+            if ( !overSize && (h->entriesCount <= targetEntries) ) {
+                break;
+            }
+            int slot = findSlot_locked(lru[i].second);
+            if (slot != -1) {
+                removeSlot_locked( (U32)slot );
+            }
+        }
+    }
+};
+
+PersistentImageStore::PersistentImageStore(const QString& directory)
+    : _imp( new PersistentImageStorePrivate(directory) )
+{
+    QDir dir(_imp->storeDirectory);
+
+    if ( !dir.mkpath( QChar::fromLatin1('.') ) ) {
+        qDebug() << "Could not create the persistent node cache directory" << _imp->storeDirectory;
+
+        return;
+    }
+    for (U32 i = 0x00; i <= 0xF; ++i) {
+        for (U32 j = 0x00; j <= 0xF; ++j) {
+            std::ostringstream oss;
+            oss << std::hex <<  i;
+            oss << std::hex << j;
+            dir.mkdir( QString::fromUtf8( oss.str().c_str() ) );
+        }
+    }
+
+    if ( !_imp->dataLock.open( dir.absoluteFilePath( QString::fromUtf8(NATRON_PERSISTENT_STORE_DATA_LOCK_FILE_NAME) ).toStdString() ) ||
+         !_imp->indexLock.open( dir.absoluteFilePath( QString::fromUtf8(NATRON_PERSISTENT_STORE_INDEX_LOCK_FILE_NAME) ).toStdString() ) ) {
+        qDebug() << "Could not create the persistent node cache lock files in" << _imp->storeDirectory;
+
+        return;
+    }
+
+    // Another process may be creating the index at the same time
+    PersistentStoreLocker w(&_imp->writeMutex, &_imp->dataLock);
+    PersistentStoreLocker k(&_imp->indexMutex, &_imp->indexLock);
+    std::string indexPath = dir.absoluteFilePath( QString::fromUtf8(NATRON_PERSISTENT_STORE_INDEX_FILE_NAME) ).toStdString();
+    try {
+        _imp->index.open(indexPath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate);
+        if ( !_imp->index.data() || !_imp->isHeaderValid() ) {
+            // New or corrupted index: the data files of this version cannot be looked-up anymore
+            _imp->index.resize( PersistentImageStorePrivate::getIndexFileSize() );
+            _imp->removeAllDataFiles();
+            _imp->initializeIndex_locked();
+            _imp->index.flush(false);
+        }
+    } catch (const std::exception& e) {
+        qDebug() << "Could not open the persistent node cache index:" << e.what();
+
+        return;
+    }
+    _imp->valid = true;
+    _imp->writer.reset( new PersistentImageStoreWriterThread(this) );
+}
+
+PersistentImageStore::~PersistentImageStore()
+{
+    quitWriterThread();
+    if (_imp->valid) {
+        _imp->index.flush(false);
+    }
+}
+
+bool
+PersistentImageStore::isValid() const
+{
+    return _imp->valid;
+}
+
+QString
+PersistentImageStore::getDirectory() const
+{
+    return _imp->directory;
+}
+
+void
+PersistentImageStore::setLimits(U64 maximumSize,
+                                int maximumAgeDays)
+{
+    if (!_imp->valid) {
+        QMutexLocker k(&_imp->indexMutex);
+        _imp->maximumSize = maximumSize;
+        _imp->maximumAgeDays = maximumAgeDays;
+
+        return;
+    }
+    PersistentStoreLocker w(&_imp->writeMutex, &_imp->dataLock);
+    PersistentStoreLocker k(&_imp->indexMutex, &_imp->indexLock);
+    _imp->maximumSize = maximumSize;
+    _imp->maximumAgeDays = maximumAgeDays;
+    _imp->evictIfNeeded_locked();
+}
+
+bool
+PersistentImageStore::contains(U64 hash) const
+{
+    if (!_imp->valid) {
+        return false;
+    }
+    PersistentStoreLocker k(&_imp->indexMutex, &_imp->indexLock);
+
+    return _imp->findSlot_locked(hash) != -1;
+}
+
+void
+PersistentImageStore::getStatistics(std::size_t* nEntries,
+                                    U64* totalSize) const
+{
+    *nEntries = 0;
+    *totalSize = 0;
+    if (!_imp->valid) {
+        return;
+    }
+    PersistentStoreLocker k(&_imp->indexMutex, &_imp->indexLock);
+    *nEntries = _imp->header()->entriesCount;
+    *totalSize = _imp->header()->totalSize;
+}
+
+void
+PersistentImageStore::clear()
+{
+    if (!_imp->valid) {
+        return;
+    }
+    PersistentStoreLocker w(&_imp->writeMutex, &_imp->dataLock);
+    PersistentStoreLocker k(&_imp->indexMutex, &_imp->indexLock);
+    _imp->removeAllDataFiles();
+    _imp->initializeIndex_locked();
+}
+
+void
+PersistentImageStore::appendToWriteQueue(const ImagePtr& image)
+{
+    if (!_imp->valid || !image) {
+        return;
+    }
+    _imp->writer->appendToQueue(image);
+}
+
+void
+PersistentImageStore::quitWriterThread()
+{
+    if (_imp->writer) {
+        _imp->writer->quitThread();
+    }
+}
+
+namespace {
+/*
+ * Each file contains one or more records:
+ * U32 magic, U32 metadata size, metadata (binary archive of the ImageKey and the ImageParams),
+ * U32 bitdepth, double pixel aspect ratio, U64 pixel data size, pixel data
+ */
+bool
+readRecordHeader(FStreamsSupport::ifstream& ifile,
+                 ImageKey* key,
+                 ImageParams* params,
+                 U64* dataSize)
+{
+    U32 magic = 0, metaSize = 0;
+
+    ifile.read( (char*)&magic, sizeof(magic) );
+    ifile.read( (char*)&metaSize, sizeof(metaSize) );
+    if ( !ifile || (magic != NATRON_PERSISTENT_STORE_RECORD_MAGIC) ) {
+        return false;
+    }
+    std::string meta(metaSize, '\0');
+    ifile.read(&meta[0], metaSize);
+    U32 bitdepth = 0;
+    double par = 1.;
+    ifile.read( (char*)&bitdepth, sizeof(bitdepth) );
+    ifile.read( (char*)&par, sizeof(par) );
+    ifile.read( (char*)dataSize, sizeof(*dataSize) );
+    if (!ifile) {
+        return false;
+    }
+    try {
+        std::istringstream iss(meta);
+        boost::archive::binary_iarchive ia(iss);
+        ia >> *key;
+        ia >> *params;
+    } catch (const std::exception& e) {
+        qDebug() << "Invalid persistent node cache record:" << e.what();
+
+        return false;
+    }
+    params->setBitDepth( (ImageBitDepthEnum)bitdepth );
+    params->setPixelAspectRatio(par);
+
+    return true;
+}
+
+std::size_t
+getStoredDataSize(const ImageParams& params)
+{
+    const CacheEntryStorageInfo& info = params.getStorageInfo();
+
+    return info.dataTypeSize * info.numComponents * info.bounds.area();
+}
+} // anon namespace
+
+bool
+PersistentImageStore::loadImages(const ImageKey& key,
+                                 Cache<Image>* cache,
+                                 std::list<ImagePtr>* images)
+{
+    if (!_imp->valid) {
+        return false;
+    }
+    U64 hash = key.getHash();
+    {
+        PersistentStoreLocker k(&_imp->indexMutex, &_imp->indexLock);
+        int slot = _imp->findSlot_locked(hash);
+        if (slot == -1) {
+            return false;
+        }
+        _imp->slots()[slot].lastAccess = getCurrentTime();
+    }
+
+    FStreamsSupport::ifstream ifile;
+    FStreamsSupport::open(&ifile, _imp->getFilePath(hash), std::ios_base::in | std::ios_base::binary);
+    if (!ifile) {
+        return false;
+    }
+
+    bool ret = false;
+    for (;;) {
+        ImageKey recordKey;
+        ImageParams recordParams;
+        U64 dataSize = 0;
+        if ( !readRecordHeader(ifile, &recordKey, &recordParams, &dataSize) ) {
+            break;
+        }
+        std::streamoff dataOffset = ifile.tellg();
+
+        // The hash may collide with another key, and the record must hold exactly the image described by its params
+        if ( ( recordKey == key ) && (dataSize == getStoredDataSize(recordParams) ) &&
+             ( recordParams.getStorageInfo().mode == eStorageModeRAM ) ) {
+            boost::shared_ptr<ImageParams> params( new ImageParams(recordParams) );
+            ImagePtr image;
+            bool alreadyCached = cache->getOrCreate(key, params, 0, &image);
+            if (image && !alreadyCached) {
+                image->allocateMemory();
+                bool readOk;
+                {
+                    Image::WriteAccess acc = image->getWriteRights();
+                    const RectI& bounds = params->getBounds();
+                    ifile.read( (char*)acc.pixelAt(bounds.x1, bounds.y1), dataSize );
+                    readOk = !ifile.fail();
+                }
+                if (!readOk) {
+                    cache->removeEntry(image);
+                    break;
+                }
+                image->markForRendered( params->getBounds() );
+            }
+            if (image) {
+                images->push_back(image);
+                ret = true;
+            }
+        }
+        ifile.seekg(dataOffset + (std::streamoff)dataSize);
+    }
+
+    return ret;
+} // PersistentImageStore::loadImages
+
+bool
+PersistentImageStore::writeImage(const ImagePtr& image)
+{
+    if ( !_imp->valid || !image || (image->getStorageMode() != eStorageModeRAM) ) {
+        return false;
+    }
+
+    const ImageKey& key = image->getKey();
+    boost::shared_ptr<ImageParams> params = image->getParams();
+    const RectI bounds = params->getBounds();
+    const std::size_t dataSize = getStoredDataSize(*params);
+
+    // Copy the pixels under the image lock, then write them without holding it so renders are not blocked on disk
+    std::vector<char> pixels;
+    {
+        Image::ReadAccess acc = image->getReadRights();
+        std::list<RectI> restToRender;
+        image->getRestToRender(bounds, restToRender);
+        if ( !restToRender.empty() ) {
+            // Only persist complete images, the bitmap is not stored
+            return false;
+        }
+        const char* src = (const char*)acc.pixelAt(bounds.x1, bounds.y1);
+        if (!src) {
+            return false;
+        }
+        pixels.assign(src, src + dataSize);
+    }
+
+    std::string meta;
+    try {
+        std::ostringstream oss;
+        boost::archive::binary_oarchive oa(oss);
+        oa << key;
+        oa << *params;
+        meta = oss.str();
+    } catch (const std::exception& e) {
+        qDebug() << "Could not serialize a persistent node cache record:" << e.what();
+
+        return false;
+    }
+
+    PersistentStoreLocker w(&_imp->writeMutex, &_imp->dataLock);
+    const U64 hash = image->getHashKey();
+    const std::string filePath = _imp->getFilePath(hash);
+    const QString qFilePath = QString::fromUtf8( filePath.c_str() );
+
+    // Do not store twice the same image
+    {
+        FStreamsSupport::ifstream ifile;
+        FStreamsSupport::open(&ifile, filePath, std::ios_base::in | std::ios_base::binary);
+        ImageKey recordKey;
+        ImageParams recordParams;
+        U64 recordDataSize = 0;
+        while ( ifile && readRecordHeader(ifile, &recordKey, &recordParams, &recordDataSize) ) {
+            if ( ( recordKey == key ) && ( recordParams == *params ) &&
+                 ( recordParams.getBitDepth() == params->getBitDepth() ) ) {
+                return true;
+            }
+            ifile.seekg( (std::streamoff)recordDataSize, std::ios_base::cur );
+        }
+    }
+
+    // The file may hold the records of other images with the same hash
+    QFileInfo fileInfo(qFilePath);
+    const qint64 sizeBeforeWrite = fileInfo.exists() ? fileInfo.size() : 0;
+    FStreamsSupport::ofstream ofile;
+    FStreamsSupport::open(&ofile, filePath, std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+    if (!ofile) {
+        return false;
+    }
+    const U32 magic = NATRON_PERSISTENT_STORE_RECORD_MAGIC;
+    const U32 metaSize = (U32)meta.size();
+    const U32 bitdepth = (U32)params->getBitDepth();
+    const double par = params->getPixelAspectRatio();
+    const U64 storedDataSize = dataSize;
+    ofile.write( (const char*)&magic, sizeof(magic) );
+    ofile.write( (const char*)&metaSize, sizeof(metaSize) );
+    ofile.write( meta.data(), meta.size() );
+    ofile.write( (const char*)&bitdepth, sizeof(bitdepth) );
+    ofile.write( (const char*)&par, sizeof(par) );
+    ofile.write( (const char*)&storedDataSize, sizeof(storedDataSize) );
+    ofile.write( &pixels[0], pixels.size() );
+    ofile.close();
+    if (!ofile) {
+        // Only remove the partial record, the previous ones are still referenced by the index
+        if (sizeBeforeWrite == 0) {
+            QFile::remove(qFilePath);
+        } else if ( !QFile::resize(qFilePath, sizeBeforeWrite) ) {
+            PersistentStoreLocker k(&_imp->indexMutex, &_imp->indexLock);
+            int slot = _imp->findSlot_locked(hash);
+            if (slot != -1) {
+                _imp->removeSlot_locked( (U32)slot );
+            } else {
+                QFile::remove(qFilePath);
+            }
+        }
+
+        return false;
+    }
+
+    const U64 recordSize = sizeof(magic) + sizeof(metaSize) + meta.size() + sizeof(bitdepth) + sizeof(par) + sizeof(storedDataSize) + dataSize;
+    {
+        PersistentStoreLocker k(&_imp->indexMutex, &_imp->indexLock);
+        int slot = _imp->insertSlot_locked(hash);
+        if (slot == -1) {
+            // The index is full, this cannot happen since eviction keeps it under its load factor.
+            // The hash is not in the index, so no other record of the file can be looked-up.
+            QFile::remove(qFilePath);
+
+            return false;
+        }
+        PersistentStoreIndexSlot& s = _imp->slots()[slot];
+        s.size += recordSize;
+        s.lastAccess = getCurrentTime();
+        _imp->header()->totalSize += recordSize;
+        _imp->evictIfNeeded_locked();
+    }
+
+    return true;
+} // PersistentImageStore::writeImage
+
+NATRON_NAMESPACE_EXIT;
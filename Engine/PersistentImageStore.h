@@ -0,0 +1,137 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_PERSISTENTIMAGESTORE_H
+#define NATRON_ENGINE_PERSISTENTIMAGESTORE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include <QtCore/QString>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+template<typename EntryType>
+class Cache;
+
+struct PersistentImageStorePrivate;
+
+/**
+ * @brief An on-disk store of the images of the NodeCache that outlives the application, so that re-opening a project
+ * re-uses the images rendered by a previous session.
+ *
+ * Images are content-addressed: each one is written in a file named after the hash of its ImageKey, which may hold
+ * several images (one per mipmap level/components/bitdepth). Which hashes are stored, their size and their last access
+ * time are recorded in a fixed-size open-addressing hash table that lives in a memory-mapped index file: opening the
+ * store only maps this file, there is no table of contents to parse, and looking-up a hash is O(1).
+ *
+ * Images are written by a background thread. When the store grows over its maximum size, the least recently used
+ * entries are evicted, and entries not accessed for longer than the maximum age are removed.
+ *
+ * Several processes may use the same store: the index and the data files are guarded by lock files.
+ *
+ * This class is MT-safe.
+ **/
+class PersistentImageStore
+{
+public:
+
+    /**
+     * @brief Opens (or creates) the store located in the given directory.
+     * Each version of the cache and hash algorithm has its own sub-directory, so that the entries of another version
+     * are never wiped. A corrupted index is re-initialized, and the data files of this version are removed.
+     * If the directory cannot be used, the store is invalid and all functions do nothing.
+     **/
+    PersistentImageStore(const QString& directory);
+
+    ~PersistentImageStore();
+
+    bool isValid() const;
+
+    QString getDirectory() const;
+
+    /**
+     * @brief Set the maximum size in bytes of the store (0 means no limit) and the number of days after which
+     * entries that were not accessed are removed (0 means no limit). Entries exceeding the new limits are evicted.
+     **/
+    void setLimits(U64 maximumSize, int maximumAgeDays);
+
+    /**
+     * @brief Returns true if images with the given hash are in the store. This only reads the index.
+     **/
+    bool contains(U64 hash) const;
+
+    /**
+     * @brief Reads all the images stored for the given key and inserts them in the given cache.
+     * Images that are already in the cache with the same parameters are returned as is.
+     * Returns true if at least one image was returned.
+     **/
+    bool loadImages(const ImageKey& key, Cache<Image>* cache, std::list<ImagePtr>* images);
+
+    /**
+     * @brief Queue the given image to be written to the store by the writer thread.
+     * The image is only written if it is entirely rendered, still alive and not already in the store with the same
+     * parameters at that time. The queue does not keep the image alive, and is bounded: images reported while it is
+     * full are not written.
+     **/
+    void appendToWriteQueue(const ImagePtr& image);
+
+    /**
+     * @brief Wait for the queued images to be written and stop the writer thread.
+     **/
+    void quitWriterThread();
+
+    /**
+     * @brief Removes all entries of the store.
+     **/
+    void clear();
+
+    /**
+     * @brief Returns the number of images hashes in the store and their total size in bytes.
+     **/
+    void getStatistics(std::size_t* nEntries, U64* totalSize) const;
+
+    /**
+     * @brief Writes the given image to the store immediately, in the calling thread. Returns false if the image
+     * could not be written. This is what the writer thread calls for each queued image.
+     **/
+    bool writeImage(const ImagePtr& image);
+
+private:
+
+    boost::scoped_ptr<PersistentImageStorePrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_PERSISTENTIMAGESTORE_H
@@ -27,6 +27,7 @@
 #include <fstream>
 #include <algorithm> // min, max
 #include <ios>
+#include <sstream>
 #include <cstdlib> // strtoul
 #include <cerrno> // errno
 #include <cassert>
@@ -74,6 +75,8 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/KnobFile.h"
 #include "Engine/Node.h"
 #include "Engine/OutputSchedulerThread.h"
+#include "Engine/ProjectBinaryArchive.h"
+#include "Engine/ProjectJournal.h"
 #include "Engine/ProjectPrivate.h"
 #include "Engine/ProjectSerialization.h"
 #include "Engine/RectDSerialization.h"
@@ -89,6 +92,30 @@ NATRON_NAMESPACE_ENTER;
 using std::cout; using std::endl;
 using std::make_pair;
 
+// Past this size, the auto-save journal is compacted into a full auto-save as soon as no render is running
+#define NATRON_AUTOSAVE_JOURNAL_MAX_SIZE (4 * 1024 * 1024)
+
+// Past this delay since the last full auto-save, the journal is compacted if no render is running
+#define NATRON_AUTOSAVE_JOURNAL_MAX_AGE_SECONDS 300
+
+static void
+applyAutoSaveJournal(const QString& autoSaveFilePath,
+                     ProjectSerialization* projectSerialization)
+{
+    QString journalFilePath = ProjectJournal::getJournalFilePath(autoSaveFilePath);
+
+    if ( !QFile::exists(journalFilePath) ) {
+        return;
+    }
+    std::list<ProjectJournal::Record> records;
+    try {
+        ProjectJournal::readRecords(journalFilePath, &records);
+        ProjectJournal::applyRecords(records, projectSerialization);
+    } catch (const std::exception& e) {
+        qDebug() << "Failed to apply the auto-save journal" << journalFilePath << ":" << e.what();
+    }
+}
+
 
 static std::string
 getUserName()
@@ -214,6 +241,7 @@ Project::loadProject(const QString & path,
                 }
                 if ( (ret == eStandardButtonNo) || (ret == eStandardButtonEscape) ) {
                     QFile::remove(realPath + autosaveFileName);
+                    QFile::remove( ProjectJournal::getJournalFilePath(realPath + autosaveFileName) );
                 } else {
                     realName = autosaveFileName;
                     isAutoSave = true;
@@ -270,13 +298,22 @@ Project::loadProjectInternal(const QString & path,
     }
 
     bool ret = false;
+    ProjectBinaryArchiveReaderPtr binaryReader;
     FStreamsSupport::ifstream ifile;
-    FStreamsSupport::open( &ifile, filePath.toStdString() );
-    if (!ifile) {
-        throw std::runtime_error( tr("Failed to open %1").arg(filePath).toStdString() );
+    if ( ProjectBinaryArchiveReader::isBinaryProjectFile( filePath.toStdString() ) ) {
+        try {
+            binaryReader.reset( new ProjectBinaryArchiveReader( filePath.toStdString() ) );
+        } catch (const std::exception& e) {
+            throw std::runtime_error( tr("Failed to open %1: %2").arg(filePath).arg( QString::fromUtf8( e.what() ) ).toStdString() );
+        }
+    } else {
+        FStreamsSupport::open( &ifile, filePath.toStdString() );
+        if (!ifile) {
+            throw std::runtime_error( tr("Failed to open %1").arg(filePath).toStdString() );
+        }
     }
 
-    if ( (NATRON_VERSION_MAJOR == 1) && (NATRON_VERSION_MINOR == 0) && (NATRON_VERSION_REVISION == 0) ) {
+    if ( !binaryReader && (NATRON_VERSION_MAJOR == 1) && (NATRON_VERSION_MINOR == 0) && (NATRON_VERSION_REVISION == 0) ) {
         ///Try to determine if the project was made during Natron v1.0.0 - RC2 or RC3 to detect a bug we introduced at that time
         ///in the BezierCP class serialisation
         bool foundV = false;
@@ -301,18 +338,41 @@ Project::loadProjectInternal(const QString & path,
 
     try {
         bool bgProject;
-        boost::archive::xml_iarchive iArchive(ifile);
-        {
-            FlagSetter __raii_loadingProjectInternal__(true, &_imp->isLoadingProjectInternal, &_imp->isLoadingProjectMutex);
-
-            iArchive >> boost::serialization::make_nvp("Background_project", bgProject);
-            ProjectSerialization projectSerializationObj( getApp() );
-            iArchive >> boost::serialization::make_nvp("Project", projectSerializationObj);
-            ret = load(projectSerializationObj, name, path, mustSave);
-        } // __raii_loadingProjectInternal__
+        if (binaryReader) {
+            {
+                FlagSetter __raii_loadingProjectInternal__(true, &_imp->isLoadingProjectInternal, &_imp->isLoadingProjectMutex);
+
+                ProjectSerialization projectSerializationObj( getApp() );
+                binaryReader->readProject(&bgProject, &projectSerializationObj);
+                if (isAutoSave) {
+                    applyAutoSaveJournal(filePath, &projectSerializationObj);
+                }
+                ret = load(projectSerializationObj, name, path, mustSave);
+            } // __raii_loadingProjectInternal__
+
+            // The Gui section is only read when there is a Gui
+            if ( !bgProject && !getApp()->isBackground() && binaryReader->hasSection(NATRON_BINARY_PROJECT_SECTION_GUI) ) {
+                std::istringstream guiStream( binaryReader->readSection(NATRON_BINARY_PROJECT_SECTION_GUI) );
+                boost::archive::xml_iarchive guiArchive(guiStream);
+                getApp()->loadProjectGui(isAutoSave, guiArchive);
+            }
+        } else {
+            boost::archive::xml_iarchive iArchive(ifile);
+            {
+                FlagSetter __raii_loadingProjectInternal__(true, &_imp->isLoadingProjectInternal, &_imp->isLoadingProjectMutex);
+
+                iArchive >> boost::serialization::make_nvp("Background_project", bgProject);
+                ProjectSerialization projectSerializationObj( getApp() );
+                iArchive >> boost::serialization::make_nvp("Project", projectSerializationObj);
+                if (isAutoSave) {
+                    applyAutoSaveJournal(filePath, &projectSerializationObj);
+                }
+                ret = load(projectSerializationObj, name, path, mustSave);
+            } // __raii_loadingProjectInternal__
 
-        if (!bgProject) {
-            getApp()->loadProjectGui(isAutoSave, iArchive);
+            if (!bgProject) {
+                getApp()->loadProjectGui(isAutoSave, iArchive);
+            }
         }
     } catch (...) {
         const ProjectBeingLoadedInfo& pInfo = getApp()->getProjectBeingLoadedInfo();
@@ -415,6 +475,11 @@ Project::saveProject_imp(const QString & path,
 
             ///We just saved, remove the last auto-save which is now obsolete
             removeLastAutosave();
+            {
+                ///There is no auto-save left to journal the next changes against
+                QMutexLocker k(&_imp->autoSaveJournalMutex);
+                _imp->journalMustCompact = true;
+            }
 
             //}
         } else {
@@ -448,6 +513,50 @@ Project::saveProject_imp(const QString & path,
     return true;
 } // Project::saveProject_imp
 
+void
+Project::writeProjectFile(std::ostream& ofile,
+                          ProjectFileFormatEnum format)
+{
+    bool bgProject = getApp()->isBackground();
+    ProjectSerialization projectSerializationObj( getApp() );
+
+    save(&projectSerializationObj);
+
+    if (format == eProjectFileFormatBinary) {
+        ProjectBinaryArchiveWriter writer;
+        writer.addProject(bgProject, projectSerializationObj);
+        if (!bgProject) {
+            std::ostringstream guiStream;
+            {
+                boost::archive::xml_oarchive guiArchive(guiStream);
+                getApp()->saveProjectGui(guiArchive);
+            }
+            writer.addSection( NATRON_BINARY_PROJECT_SECTION_GUI, guiStream.str() );
+        }
+        writer.write(ofile);
+    } else {
+        boost::archive::xml_oarchive oArchive(ofile);
+        oArchive << boost::serialization::make_nvp("Background_project", bgProject);
+        oArchive << boost::serialization::make_nvp("Project", projectSerializationObj);
+        if (!bgProject) {
+            getApp()->saveProjectGui(oArchive);
+        }
+    }
+}
+
+void
+Project::exportProjectFile(const QString& filePath,
+                           ProjectFileFormatEnum format)
+{
+    FStreamsSupport::ofstream ofile;
+
+    FStreamsSupport::open( &ofile, filePath.toStdString(), format == eProjectFileFormatBinary ? std::ios_base::out | std::ios_base::binary : std::ios_base::out );
+    if (!ofile) {
+        throw std::runtime_error( tr("Failed to open file ").toStdString() + filePath.toStdString() );
+    }
+    writeProjectFile(ofile, format);
+}
+
 static bool
 fileCopy(const QString & source,
          const QString & dest)
@@ -522,8 +631,9 @@ Project::saveProjectInternal(const QString & path,
     tmpFilename.append( QString::number( time.toMSecsSinceEpoch() ) );
 
     {
+        ProjectFileFormatEnum format = appPTR->getCurrentSettings()->isSaveProjectsInBinaryFormatEnabled() ? eProjectFileFormatBinary : eProjectFileFormatXML;
         FStreamsSupport::ofstream ofile;
-        FStreamsSupport::open( &ofile, tmpFilename.toStdString() );
+        FStreamsSupport::open( &ofile, tmpFilename.toStdString(), format == eProjectFileFormatBinary ? std::ios_base::out | std::ios_base::binary : std::ios_base::out );
         if (!ofile) {
             throw std::runtime_error( tr("Failed to open file ").toStdString() + tmpFilename.toStdString() );
         }
@@ -539,15 +649,7 @@ Project::saveProjectInternal(const QString & path,
         }
 
         try {
-            boost::archive::xml_oarchive oArchive(ofile);
-            bool bgProject = getApp()->isBackground();
-            oArchive << boost::serialization::make_nvp("Background_project", bgProject);
-            ProjectSerialization projectSerializationObj( getApp() );
-            save(&projectSerializationObj);
-            oArchive << boost::serialization::make_nvp("Project", projectSerializationObj);
-            if (!bgProject) {
-                getApp()->saveProjectGui(oArchive);
-            }
+            writeProjectFile(ofile, format);
         } catch (...) {
             if (!autoSave && updateProjectProperties) {
                 ///Reset the old project path in case of failure.
@@ -640,6 +742,145 @@ Project::triggerAutoSave()
     _imp->autoSaveTimer->start( appPTR->getCurrentSettings()->getAutoSaveDelayMS() );
 }
 
+void
+Project::journalNodeChanged(const NodePtr& node)
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    if ( !node || getApp()->isBackground() || isLoadingProject() || isProjectClosing() ) {
+        return;
+    }
+
+    // The children of a multi-instance are serialized by their parent
+    NodePtr serializedNode = node->getParentMultiInstance();
+    if (!serializedNode) {
+        serializedNode = node;
+    }
+    if ( !serializedNode->isPartOfProject() ) {
+        return;
+    }
+
+    QMutexLocker k(&_imp->autoSaveJournalMutex);
+    _imp->journalChangedNodes[serializedNode.get()] = serializedNode;
+}
+
+void
+Project::journalNodeRemoved(const NodePtr& node)
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    if ( !node || getApp()->isBackground() || isLoadingProject() || isProjectClosing() ) {
+        return;
+    }
+    if ( node->getParentMultiInstance() ) {
+        journalNodeChanged(node);
+
+        return;
+    }
+    if ( !node->isPartOfProject() ) {
+        return;
+    }
+
+    QMutexLocker k(&_imp->autoSaveJournalMutex);
+    _imp->journalChangedNodes.erase( node.get() );
+    _imp->journalRemovedNodes.push_back( node->getFullyQualifiedName() );
+}
+
+void
+Project::journalNodeRenamed(const NodePtr& node,
+                            const std::string& oldFullName,
+                            const std::list<KnobPtr>& rewrittenExpressions)
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    if ( !node || getApp()->isBackground() || isLoadingProject() || isProjectClosing() ) {
+        return;
+    }
+    if ( node->getParentMultiInstance() ) {
+        // Serialized by its parent
+        journalNodeChanged(node);
+
+        return;
+    }
+    if ( !node->isPartOfProject() ) {
+        return;
+    }
+
+    {
+        QMutexLocker k(&_imp->autoSaveJournalMutex);
+        _imp->journalRemovedNodes.push_back(oldFullName);
+    }
+    journalNodeChanged(node);
+
+    ///The outputs of the node refer to their inputs by script name
+    const NodesWList& outputs = node->getOutputs();
+    for (NodesWList::const_iterator it = outputs.begin(); it != outputs.end(); ++it) {
+        journalNodeChanged( it->lock() );
+    }
+    for (std::list<KnobPtr>::const_iterator it = rewrittenExpressions.begin(); it != rewrittenExpressions.end(); ++it) {
+        EffectInstance* effect = dynamic_cast<EffectInstance*>( (*it)->getHolder() );
+        if (effect) {
+            journalNodeChanged( effect->getNode() );
+        }
+    }
+}
+
+bool
+Project::appendAutoSaveJournal()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    QString autoSaveFilePath = getLastAutoSaveFilePath();
+    if ( autoSaveFilePath.isEmpty() || !QFile::exists(autoSaveFilePath) ) {
+        // There is no auto-save to append to
+        return false;
+    }
+
+    std::map<Node*, NodeWPtr> changedNodes;
+    std::list<std::string> removedNodes;
+    {
+        QMutexLocker k(&_imp->autoSaveJournalMutex);
+        if ( _imp->journalMustCompact || (_imp->journalFileSize > NATRON_AUTOSAVE_JOURNAL_MAX_SIZE) ) {
+            return false;
+        }
+        changedNodes.swap(_imp->journalChangedNodes);
+        removedNodes.swap(_imp->journalRemovedNodes);
+    }
+
+    // Compact a journal that has been growing for a while when it does not delay a render
+    bool isRendering = hasNodeRendering();
+    if ( !isRendering && (_imp->lastAutoSave.secsTo( QDateTime::currentDateTime() ) > NATRON_AUTOSAVE_JOURNAL_MAX_AGE_SECONDS) ) {
+        return false;
+    }
+
+    // Removals first: a node renamed and then created with its old name is replaced by the state of the new node
+    std::list<ProjectJournal::Record> records;
+    for (std::list<std::string>::const_iterator it = removedNodes.begin(); it != removedNodes.end(); ++it) {
+        records.push_back( ProjectJournal::makeNodeRemovedRecord(*it) );
+    }
+
+    QString journalFilePath = ProjectJournal::getJournalFilePath(autoSaveFilePath);
+    try {
+        for (std::map<Node*, NodeWPtr>::const_iterator it = changedNodes.begin(); it != changedNodes.end(); ++it) {
+            NodePtr node = it->second.lock();
+            if ( node && node->isActivated() ) {
+                records.push_back( ProjectJournal::makeNodeStateRecord(node) );
+            }
+        }
+        if ( records.empty() ) {
+            return true;
+        }
+        qint64 size = ProjectJournal::appendRecords(journalFilePath, records);
+        QMutexLocker k(&_imp->autoSaveJournalMutex);
+        _imp->journalFileSize = size;
+    } catch (const std::exception& e) {
+        qDebug() << "Failed to append to" << journalFilePath << ":" << e.what();
+        QMutexLocker k(&_imp->autoSaveJournalMutex);
+        _imp->journalMustCompact = true;
+
+        return false;
+    }
+
+    return true;
+} // Project::appendAutoSaveJournal
+
 void
 Project::onAutoSaveTimerTriggered()
 {
@@ -649,11 +890,31 @@ Project::onAutoSaveTimerTriggered()
         return;
     }
 
+    if ( getApp()->isShowingDialog() ) {
+        _imp->autoSaveTimer->start(2000);
+
+        return;
+    }
+
+    ///Between two full auto-saves, only append the nodes that changed to the journal of the last auto-save:
+    ///this is quick and does not wait for the renders to finish.
+    if ( _imp->autoSaveFutures.empty() && appendAutoSaveJournal() ) {
+        return;
+    }
+
     ///check that all schedulers are not working.
     ///If so launch an auto-save, otherwise, restart the timer.
-    bool canAutoSave = !hasNodeRendering() && !getApp()->isShowingDialog();
+    bool canAutoSave = !hasNodeRendering();
 
     if (canAutoSave) {
+        {
+            // The full auto-save compacts the journal: the changes made from now on are journaled after it
+            QMutexLocker k(&_imp->autoSaveJournalMutex);
+            _imp->journalChangedNodes.clear();
+            _imp->journalRemovedNodes.clear();
+            _imp->journalFileSize = 0;
+            _imp->journalMustCompact = false;
+        }
         boost::shared_ptr<QFutureWatcher<void> > watcher(new QFutureWatcher<void>);
         QObject::connect( watcher.get(), SIGNAL(finished()), this, SLOT(onAutoSaveFutureFinished()) );
         watcher->setFuture( QtConcurrent::run(this, &Project::autoSave) );
@@ -696,7 +957,7 @@ Project::findAutoSaveForProject(const QString& projectPath,
         QString autosaveSuffix( QString::fromUtf8(".autosave") );
         searchStr.append(autosaveSuffix);
         int suffixPos = entry.indexOf(searchStr);
-        if ( (suffixPos == -1) || entry.contains( QString::fromUtf8("RENDER_SAVE") ) ) {
+        if ( (suffixPos == -1) || entry.contains( QString::fromUtf8("RENDER_SAVE") ) || ProjectJournal::isJournalFile(entry) ) {
             continue;
         }
         QString filename = projectPath + entry.left( suffixPos + ntpExt.size() );
@@ -1455,6 +1716,12 @@ Project::onKnobValueChanged(KnobI* knob,
 {
     bool ret = true;
 
+    if ( (reason == eValueChangedReasonUserEdited) || (reason == eValueChangedReasonNatronGuiEdited) ) {
+        ///The auto-save journal only records nodes: save the project settings with a full auto-save
+        QMutexLocker k(&_imp->autoSaveJournalMutex);
+        _imp->journalMustCompact = true;
+    }
+
     if ( knob == _imp->viewsList.get() ) {
         /**
          * All cache entries are linked to a view index which may no longer be correct since the user changed the project settings.
@@ -1490,8 +1757,12 @@ Project::onKnobValueChanged(KnobI* knob,
         if (found) {
             if (reason == eValueChangedReasonUserEdited) {
                 ///Increase all nodes age in the project so all cache is invalidated: some effects images might rely on the project format
-                for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
-                    (*it)->incrementKnobsAge();
+                ///The hash of all nodes is propagated in a single pass once they all have been incremented
+                {
+                    NodesHashBatch_RAII hashBatch( getApp() );
+                    for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+                        (*it)->incrementKnobsAge();
+                    }
                 }
 
                 ///Format change, hence probably the PAR so run getClipPreferences again
@@ -1673,6 +1944,7 @@ Project::removeLastAutosave()
 
     if ( !filepath.isEmpty() ) {
         QFile::remove(filepath);
+        QFile::remove( ProjectJournal::getJournalFilePath(filepath) );
     }
 
     /*
@@ -1686,6 +1958,7 @@ Project::removeLastAutosave()
     if ( QFile::exists(autoSaveFilePath) ) {
         QFile::remove(autoSaveFilePath);
     }
+    QFile::remove( ProjectJournal::getJournalFilePath(autoSaveFilePath) );
 }
 
 void
@@ -28,6 +28,8 @@
 #include "Global/Macros.h"
 
 #include <map>
+#include <ostream>
+#include <string>
 #include <vector>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/noncopyable.hpp>
@@ -96,6 +98,12 @@ public:
 
     bool saveProject_imp(const QString & path, const QString & name, bool autoSave, bool updateProjectProperties, QString* newFilePath = 0);
 
+    /**
+     * @brief Writes the project to the given file in the given format. Unlike saveProject this does not change the path of
+     * the project nor remove its auto-saves. Throws on failure. This is used by NatronRenderer --convert-project.
+     **/
+    void exportProjectFile(const QString& filePath, ProjectFileFormatEnum format);
+
     /**
      * @brief Same as saveProject except that it will save the project in a temporary file
      * so it doesn't overwrite the project.
@@ -108,6 +116,24 @@ public:
      **/
     void triggerAutoSave();
 
+    /**
+     * @brief Records that the state of the node changed, so that the next auto-save appends it to the auto-save journal
+     * instead of saving the whole project (see ProjectJournal). Must be called on the main thread by the operations of
+     * the undo commands, along with triggerAutoSave().
+     **/
+    void journalNodeChanged(const NodePtr& node);
+
+    /**
+     * @brief Records that the node was removed from the project.
+     **/
+    void journalNodeRemoved(const NodePtr& node);
+
+    /**
+     * @brief Records that the node was renamed: it is removed under its old name and journaled under its new name,
+     * along with its outputs, which refer to it by name, and the nodes of the knobs whose expressions were rewritten.
+     **/
+    void journalNodeRenamed(const NodePtr& node, const std::string& oldFullName, const std::list<KnobPtr>& rewrittenExpressions);
+
     /**
      * @brief Returns the path to where the auto save files are stored on disk.
      **/
@@ -382,6 +408,14 @@ private:
 
     QString saveProjectInternal(const QString & path, const QString & name, bool autosave, bool updateProjectProperties);
 
+    void writeProjectFile(std::ostream& ofile, ProjectFileFormatEnum format);
+
+    /**
+     * @brief Appends the changes recorded since the last auto-save to the journal of the last auto-save.
+     * Returns false if a full auto-save is needed instead.
+     **/
+    bool appendAutoSaveJournal();
+
 
     /**
      * @brief Resets the project state clearing all nodes and the project name.
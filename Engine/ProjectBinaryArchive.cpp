@@ -0,0 +1,283 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ProjectBinaryArchive.h"
+
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+#include <QtCore/QMutex>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/FStreamsSupport.h"
+#include "Engine/NodeSerialization.h"
+#include "Engine/ProjectSerialization.h"
+
+// The file starts with these 8 bytes, which cannot start an xml project
+#define NATRON_BINARY_PROJECT_MAGIC "NTPBIN\r\n"
+#define NATRON_BINARY_PROJECT_MAGIC_SIZE 8
+#define NATRON_BINARY_PROJECT_VERSION 1
+
+// Written in the native byte order, to detect files written on an architecture of another byte order
+#define NATRON_BINARY_PROJECT_BYTE_ORDER_MARK 0x01020304
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+template <typename T>
+void
+writePOD(std::ostream& stream,
+         T value)
+{
+    stream.write( reinterpret_cast<const char*>(&value), sizeof(T) );
+}
+
+template <typename T>
+T
+readPOD(std::istream& stream)
+{
+    T value;
+
+    stream.read( reinterpret_cast<char*>(&value), sizeof(T) );
+    if (!stream) {
+        throw std::runtime_error("Unexpected end of file in the binary project header");
+    }
+
+    return value;
+}
+
+struct SectionLocation
+{
+    U64 offset;
+    U64 size;
+};
+}
+
+ProjectBinaryArchiveWriter::ProjectBinaryArchiveWriter()
+    : _sections()
+{
+}
+
+ProjectBinaryArchiveWriter::~ProjectBinaryArchiveWriter()
+{
+}
+
+void
+ProjectBinaryArchiveWriter::addSection(const std::string& name,
+                                       const std::string& data)
+{
+    _sections.push_back( std::make_pair(name, data) );
+}
+
+void
+ProjectBinaryArchiveWriter::addProject(bool isBackgroundProject,
+                                       ProjectSerialization& project)
+{
+    const std::list< boost::shared_ptr<NodeSerialization> >& nodes = project.getNodesSerialization().getNodesSerialization();
+
+    for (std::list< boost::shared_ptr<NodeSerialization> >::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        (*it)->moveContextsToSections(std::string(), this);
+    }
+
+    std::ostringstream ss;
+    {
+        boost::archive::binary_oarchive archive(ss);
+        archive << boost::serialization::make_nvp("Background_project", isBackgroundProject);
+        archive << boost::serialization::make_nvp("Project", project);
+    }
+    addSection( NATRON_BINARY_PROJECT_SECTION_PROJECT, ss.str() );
+}
+
+void
+ProjectBinaryArchiveWriter::write(std::ostream& stream) const
+{
+    // Header: magic, version, byte order mark, number of sections, then for each section its name, offset and size
+    U64 headerSize = NATRON_BINARY_PROJECT_MAGIC_SIZE + 3 * sizeof(U32);
+
+    for (std::size_t i = 0; i < _sections.size(); ++i) {
+        headerSize += sizeof(U32) + _sections[i].first.size() + 2 * sizeof(U64);
+    }
+
+    stream.write(NATRON_BINARY_PROJECT_MAGIC, NATRON_BINARY_PROJECT_MAGIC_SIZE);
+    writePOD<U32>(stream, NATRON_BINARY_PROJECT_VERSION);
+    writePOD<U32>(stream, NATRON_BINARY_PROJECT_BYTE_ORDER_MARK);
+    writePOD<U32>( stream, (U32)_sections.size() );
+
+    U64 offset = headerSize;
+    for (std::size_t i = 0; i < _sections.size(); ++i) {
+        writePOD<U32>( stream, (U32)_sections[i].first.size() );
+        stream.write( _sections[i].first.data(), _sections[i].first.size() );
+        writePOD<U64>(stream, offset);
+        writePOD<U64>( stream, (U64)_sections[i].second.size() );
+        offset += _sections[i].second.size();
+    }
+    for (std::size_t i = 0; i < _sections.size(); ++i) {
+        stream.write( _sections[i].second.data(), _sections[i].second.size() );
+    }
+    stream.flush();
+    if (!stream) {
+        throw std::runtime_error("Failed to write the binary project");
+    }
+}
+
+struct ProjectBinaryArchiveReaderPrivate
+{
+    // Protects file, the sections may be read from any thread
+    mutable QMutex fileMutex;
+    mutable FStreamsSupport::ifstream file;
+    std::map<std::string, SectionLocation> sections;
+    std::list<std::string> sectionNames; // in the order of the file
+
+    ProjectBinaryArchiveReaderPrivate()
+        : fileMutex()
+        , file()
+        , sections()
+        , sectionNames()
+    {
+    }
+};
+
+ProjectBinaryArchiveReader::ProjectBinaryArchiveReader(const std::string& filePath)
+    : _imp( new ProjectBinaryArchiveReaderPrivate() )
+{
+    FStreamsSupport::open(&_imp->file, filePath, std::ios_base::in | std::ios_base::binary);
+    if (!_imp->file) {
+        throw std::runtime_error("Failed to open " + filePath);
+    }
+
+    char magic[NATRON_BINARY_PROJECT_MAGIC_SIZE];
+    _imp->file.read(magic, NATRON_BINARY_PROJECT_MAGIC_SIZE);
+    if ( !_imp->file || std::memcmp(magic, NATRON_BINARY_PROJECT_MAGIC, NATRON_BINARY_PROJECT_MAGIC_SIZE) ) {
+        throw std::runtime_error(filePath + " is not a binary project");
+    }
+    U32 version = readPOD<U32>(_imp->file);
+    if (version > NATRON_BINARY_PROJECT_VERSION) {
+        throw std::runtime_error("The binary project was written by a more recent version of " NATRON_APPLICATION_NAME);
+    }
+    if (readPOD<U32>(_imp->file) != NATRON_BINARY_PROJECT_BYTE_ORDER_MARK) {
+        throw std::runtime_error("The binary project was written on a computer with another byte order, convert it to xml first");
+    }
+
+    // Check the sections against the size of the file so that a damaged file fails here rather than in boost
+    _imp->file.seekg(0, std::ios_base::end);
+    U64 fileSize = (U64)_imp->file.tellg();
+    _imp->file.seekg(NATRON_BINARY_PROJECT_MAGIC_SIZE + 2 * sizeof(U32), std::ios_base::beg);
+
+    U32 nSections = readPOD<U32>(_imp->file);
+    for (U32 i = 0; i < nSections; ++i) {
+        U32 nameSize = readPOD<U32>(_imp->file);
+        if (nameSize > fileSize) {
+            throw std::runtime_error("Damaged binary project header");
+        }
+        std::string name(nameSize, '\0');
+        if (nameSize > 0) {
+            _imp->file.read(&name[0], nameSize);
+        }
+        SectionLocation location;
+        location.offset = readPOD<U64>(_imp->file);
+        location.size = readPOD<U64>(_imp->file);
+        if ( (location.offset > fileSize) || (location.size > fileSize - location.offset) ) {
+            throw std::runtime_error("Damaged binary project header");
+        }
+        _imp->sections[name] = location;
+        _imp->sectionNames.push_back(name);
+    }
+}
+
+ProjectBinaryArchiveReader::~ProjectBinaryArchiveReader()
+{
+}
+
+bool
+ProjectBinaryArchiveReader::isBinaryProjectFile(const std::string& filePath)
+{
+    FStreamsSupport::ifstream file;
+
+    FStreamsSupport::open(&file, filePath, std::ios_base::in | std::ios_base::binary);
+    if (!file) {
+        return false;
+    }
+    char magic[NATRON_BINARY_PROJECT_MAGIC_SIZE];
+    file.read(magic, NATRON_BINARY_PROJECT_MAGIC_SIZE);
+
+    return file && !std::memcmp(magic, NATRON_BINARY_PROJECT_MAGIC, NATRON_BINARY_PROJECT_MAGIC_SIZE);
+}
+
+bool
+ProjectBinaryArchiveReader::hasSection(const std::string& name) const
+{
+    return _imp->sections.find(name) != _imp->sections.end();
+}
+
+std::list<std::string>
+ProjectBinaryArchiveReader::getSectionNames() const
+{
+    return _imp->sectionNames;
+}
+
+std::string
+ProjectBinaryArchiveReader::readSection(const std::string& name) const
+{
+    std::map<std::string, SectionLocation>::const_iterator found = _imp->sections.find(name);
+
+    if ( found == _imp->sections.end() ) {
+        throw std::runtime_error("The binary project has no section " + name);
+    }
+
+    std::string data(found->second.size, '\0');
+    if ( !data.empty() ) {
+        QMutexLocker k(&_imp->fileMutex);
+        _imp->file.clear();
+        _imp->file.seekg(found->second.offset, std::ios_base::beg);
+        _imp->file.read( &data[0], data.size() );
+        if (!_imp->file) {
+            throw std::runtime_error("Failed to read the section " + name + " of the binary project");
+        }
+    }
+
+    return data;
+}
+
+void
+ProjectBinaryArchiveReader::readProject(bool* isBackgroundProject,
+                                        ProjectSerialization* project)
+{
+    {
+        std::istringstream ss( readSection(NATRON_BINARY_PROJECT_SECTION_PROJECT) );
+        boost::archive::binary_iarchive archive(ss);
+        archive >> boost::serialization::make_nvp("Background_project", *isBackgroundProject);
+        archive >> boost::serialization::make_nvp("Project", *project);
+    }
+
+    ProjectBinaryArchiveReaderPtr thisShared = shared_from_this();
+    const std::list< boost::shared_ptr<NodeSerialization> >& nodes = project->getNodesSerialization().getNodesSerialization();
+    for (std::list< boost::shared_ptr<NodeSerialization> >::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        (*it)->setContextsSections(std::string(), thisShared);
+    }
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,162 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_PROJECTBINARYARCHIVE_H
+#define NATRON_ENGINE_PROJECTBINARYARCHIVE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+GCC_DIAG_OFF(unused-parameter)
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/nvp.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+GCC_DIAG_ON(unused-parameter)
+#endif
+
+#include "Engine/EngineFwd.h"
+
+#define NATRON_BINARY_PROJECT_SECTION_PROJECT "Project"
+#define NATRON_BINARY_PROJECT_SECTION_GUI "Gui"
+#define NATRON_BINARY_PROJECT_SECTION_ROTO_PREFIX "RotoContext/"
+#define NATRON_BINARY_PROJECT_SECTION_TRACKER_PREFIX "TrackerContext/"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief The binary project file format.
+ *
+ * The file is a header followed by a table of named sections and by the sections themselves. The table holds the offset
+ * and size of each section so that a reader only reads the sections it needs:
+ * - "Project" is the ProjectSerialization written with a boost binary_oarchive. It is always read.
+ * - "Gui" is the layout of the user interface, written by AppInstance::saveProjectGui in xml. It is not read in background mode.
+ * - "RotoContext/<node>" and "TrackerContext/<node>" hold the roto and tracker contexts of each node, which are the bulk of
+ * the large projects. They are read and decoded only when the node restores its contexts, i.e. never for the nodes that are not
+ * created (e.g. the nodes inside PyPlugs, which are created by the Python script).
+ *
+ * The binary archives are written in the native byte order, which is checked when reading: the xml format stays the interchange format.
+ **/
+class ProjectBinaryArchiveWriter
+{
+public:
+
+    ProjectBinaryArchiveWriter();
+
+    ~ProjectBinaryArchiveWriter();
+
+    void addSection(const std::string& name, const std::string& data);
+
+    /**
+     * @brief Encodes the project in the "Project" section. The roto and tracker contexts of the nodes are moved out of the
+     * given serialization into their own sections.
+     **/
+    void addProject(bool isBackgroundProject, ProjectSerialization& project);
+
+    /**
+     * @brief Writes the file. Throws std::runtime_error on failure.
+     **/
+    void write(std::ostream& stream) const;
+
+private:
+
+    std::vector<std::pair<std::string, std::string> > _sections;
+};
+
+struct ProjectBinaryArchiveReaderPrivate;
+class ProjectBinaryArchiveReader
+    : public boost::enable_shared_from_this<ProjectBinaryArchiveReader>
+{
+public:
+
+    /**
+     * @brief Opens the file and reads its table of sections. Throws std::runtime_error if the file is not a binary project
+     * or was written on an architecture with another byte order.
+     * The file stays open until the reader is destroyed, which is when the ProjectSerialization it decoded is destroyed.
+     **/
+    explicit ProjectBinaryArchiveReader(const std::string& filePath);
+
+    ~ProjectBinaryArchiveReader();
+
+    static bool isBinaryProjectFile(const std::string& filePath);
+
+    bool hasSection(const std::string& name) const;
+
+    std::list<std::string> getSectionNames() const;
+
+    /**
+     * @brief Reads the given section from the file. This is thread-safe. Throws std::runtime_error on failure.
+     **/
+    std::string readSection(const std::string& name) const;
+
+    /**
+     * @brief Decodes the "Project" section. The roto and tracker contexts of the nodes are not decoded: the node serializations
+     * keep a reference to this reader and decode them when they are requested.
+     **/
+    void readProject(bool* isBackgroundProject, ProjectSerialization* project);
+
+private:
+
+    boost::scoped_ptr<ProjectBinaryArchiveReaderPrivate> _imp;
+};
+
+typedef boost::shared_ptr<ProjectBinaryArchiveReader> ProjectBinaryArchiveReaderPtr;
+
+template <typename T>
+std::string
+encodeBinaryProjectSection(const T& object)
+{
+    std::ostringstream ss;
+    {
+        boost::archive::binary_oarchive archive(ss);
+        archive << boost::serialization::make_nvp("item", object);
+    }
+
+    return ss.str();
+}
+
+template <typename T>
+void
+decodeBinaryProjectSection(const std::string& data,
+                           T* object)
+{
+    std::istringstream ss(data);
+    boost::archive::binary_iarchive archive(ss);
+
+    archive >> boost::serialization::make_nvp("item", *object);
+}
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_PROJECTBINARYARCHIVE_H
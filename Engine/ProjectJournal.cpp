@@ -0,0 +1,253 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ProjectJournal.h"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include <QtCore/QFileInfo>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/FStreamsSupport.h"
+#include "Engine/Node.h"
+#include "Engine/NodeSerialization.h"
+#include "Engine/ProjectBinaryArchive.h"
+#include "Engine/ProjectSerialization.h"
+
+#define NATRON_AUTOSAVE_JOURNAL_MAGIC "NTPJRNL1"
+#define NATRON_AUTOSAVE_JOURNAL_MAGIC_SIZE 8
+#define NATRON_AUTOSAVE_JOURNAL_BYTE_ORDER_MARK 0x01020304
+
+// Ends each record: a record cut by a crash does not end with it
+#define NATRON_AUTOSAVE_JOURNAL_RECORD_END 0x4e54454e
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+template <typename T>
+void
+writePOD(std::ostream& stream,
+         T value)
+{
+    stream.write( reinterpret_cast<const char*>(&value), sizeof(T) );
+}
+
+template <typename T>
+bool
+readPOD(std::istream& stream,
+        T* value)
+{
+    stream.read( reinterpret_cast<char*>(value), sizeof(T) );
+
+    return (bool)stream;
+}
+
+void
+splitFullName(const std::string& fullName,
+              std::list<std::string>* names)
+{
+    std::size_t start = 0;
+
+    for (;; ) {
+        std::size_t found = fullName.find('.', start);
+        if (found == std::string::npos) {
+            names->push_back( fullName.substr(start) );
+
+            return;
+        }
+        names->push_back( fullName.substr(start, found - start) );
+        start = found + 1;
+    }
+}
+
+std::list< boost::shared_ptr<NodeSerialization> >::iterator
+findNode(std::list< boost::shared_ptr<NodeSerialization> >& nodes,
+         const std::string& scriptName)
+{
+    for (std::list< boost::shared_ptr<NodeSerialization> >::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        if ( (*it)->getNodeScriptName() == scriptName ) {
+            return it;
+        }
+    }
+
+    return nodes.end();
+}
+}
+
+QString
+ProjectJournal::getJournalFilePath(const QString& autoSaveFilePath)
+{
+    return autoSaveFilePath + QString::fromUtf8(NATRON_AUTOSAVE_JOURNAL_EXT);
+}
+
+bool
+ProjectJournal::isJournalFile(const QString& fileName)
+{
+    return fileName.endsWith( QString::fromUtf8(NATRON_AUTOSAVE_JOURNAL_EXT) );
+}
+
+ProjectJournal::Record
+ProjectJournal::makeNodeStateRecord(const NodePtr& node)
+{
+    Record ret;
+
+    ret.type = eRecordTypeNodeState;
+    ret.nodeFullName = node->getFullyQualifiedName();
+    NodeSerialization serialization(node);
+    ret.data = encodeBinaryProjectSection(serialization);
+
+    return ret;
+}
+
+ProjectJournal::Record
+ProjectJournal::makeNodeRemovedRecord(const std::string& nodeFullName)
+{
+    Record ret;
+
+    ret.type = eRecordTypeNodeRemoved;
+    ret.nodeFullName = nodeFullName;
+
+    return ret;
+}
+
+qint64
+ProjectJournal::appendRecords(const QString& filePath,
+                              const std::list<Record>& records)
+{
+    bool isNew = !QFileInfo(filePath).exists();
+    {
+        FStreamsSupport::ofstream ofile;
+        FStreamsSupport::open(&ofile, filePath.toStdString(), std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+        if (!ofile) {
+            throw std::runtime_error("Failed to open " + filePath.toStdString() );
+        }
+        if (isNew) {
+            ofile.write(NATRON_AUTOSAVE_JOURNAL_MAGIC, NATRON_AUTOSAVE_JOURNAL_MAGIC_SIZE);
+            writePOD<U32>(ofile, NATRON_AUTOSAVE_JOURNAL_BYTE_ORDER_MARK);
+        }
+        for (std::list<Record>::const_iterator it = records.begin(); it != records.end(); ++it) {
+            writePOD<U32>( ofile, (U32)it->type );
+            writePOD<U32>( ofile, (U32)it->nodeFullName.size() );
+            ofile.write( it->nodeFullName.data(), it->nodeFullName.size() );
+            writePOD<U64>( ofile, (U64)it->data.size() );
+            ofile.write( it->data.data(), it->data.size() );
+            writePOD<U32>(ofile, NATRON_AUTOSAVE_JOURNAL_RECORD_END);
+        }
+        ofile.flush();
+        if (!ofile) {
+            throw std::runtime_error("Failed to write " + filePath.toStdString() );
+        }
+    }
+
+    return QFileInfo(filePath).size();
+}
+
+void
+ProjectJournal::readRecords(const QString& filePath,
+                            std::list<Record>* records)
+{
+    FStreamsSupport::ifstream ifile;
+
+    FStreamsSupport::open(&ifile, filePath.toStdString(), std::ios_base::in | std::ios_base::binary);
+    if (!ifile) {
+        throw std::runtime_error("Failed to open " + filePath.toStdString() );
+    }
+
+    char magic[NATRON_AUTOSAVE_JOURNAL_MAGIC_SIZE];
+    ifile.read(magic, NATRON_AUTOSAVE_JOURNAL_MAGIC_SIZE);
+    U32 byteOrder;
+    if ( !ifile || std::memcmp(magic, NATRON_AUTOSAVE_JOURNAL_MAGIC, NATRON_AUTOSAVE_JOURNAL_MAGIC_SIZE) ||
+         !readPOD(ifile, &byteOrder) || (byteOrder != NATRON_AUTOSAVE_JOURNAL_BYTE_ORDER_MARK) ) {
+        throw std::runtime_error(filePath.toStdString() + " is not an auto-save journal");
+    }
+
+    qint64 fileSize = QFileInfo(filePath).size();
+    for (;; ) {
+        Record record;
+        U32 type, nameSize, end;
+        U64 dataSize;
+        if ( !readPOD(ifile, &type) || (type > (U32)eRecordTypeNodeRemoved) ||
+             !readPOD(ifile, &nameSize) || ( (qint64)nameSize > fileSize ) ) {
+            break;
+        }
+        record.type = (RecordTypeEnum)type;
+        record.nodeFullName.resize(nameSize);
+        if ( (nameSize > 0) && !ifile.read(&record.nodeFullName[0], nameSize) ) {
+            break;
+        }
+        if ( !readPOD(ifile, &dataSize) || ( dataSize > (U64)fileSize ) ) {
+            break;
+        }
+        record.data.resize(dataSize);
+        if ( (dataSize > 0) && !ifile.read(&record.data[0], dataSize) ) {
+            break;
+        }
+        if ( !readPOD(ifile, &end) || (end != NATRON_AUTOSAVE_JOURNAL_RECORD_END) ) {
+            break;
+        }
+        records->push_back(record);
+    }
+}
+
+void
+ProjectJournal::applyRecords(const std::list<Record>& records,
+                             ProjectSerialization* project)
+{
+    for (std::list<Record>::const_iterator it = records.begin(); it != records.end(); ++it) {
+        std::list<std::string> names;
+        splitFullName(it->nodeFullName, &names);
+
+        // Find the group holding the node
+        std::list< boost::shared_ptr<NodeSerialization> >* nodes = &project->getNodesSerialization().getNodesSerialization();
+        while (nodes && names.size() > 1) {
+            std::list< boost::shared_ptr<NodeSerialization> >::iterator group = findNode(*nodes, names.front());
+            nodes = group == nodes->end() ? 0 : &(*group)->getNodesCollection();
+            names.pop_front();
+        }
+        if (!nodes) {
+            // The group was removed by an earlier record
+            continue;
+        }
+
+        std::list< boost::shared_ptr<NodeSerialization> >::iterator found = findNode(*nodes, names.front());
+        if (it->type == eRecordTypeNodeRemoved) {
+            if ( found != nodes->end() ) {
+                nodes->erase(found);
+            }
+        } else {
+            boost::shared_ptr<NodeSerialization> serialization(new NodeSerialization);
+            decodeBinaryProjectSection(it->data, serialization.get());
+            if ( found != nodes->end() ) {
+                *found = serialization;
+            } else {
+                nodes->push_back(serialization);
+            }
+        }
+    }
+}
+
+NATRON_NAMESPACE_EXIT;
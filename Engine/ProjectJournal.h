@@ -0,0 +1,106 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_PROJECTJOURNAL_H
+#define NATRON_ENGINE_PROJECTJOURNAL_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <string>
+
+#include <QtCore/QString>
+
+#include "Engine/EngineFwd.h"
+
+// Appended to the file path of the auto-save the journal belongs to
+#define NATRON_AUTOSAVE_JOURNAL_EXT ".journal"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief The auto-save journal: an append-only log of the nodes changed since the last full auto-save.
+ *
+ * A full auto-save serializes the whole project and cannot run while a render is in progress. Between two full auto-saves,
+ * the Project records the nodes changed, created, renamed or removed by the operations of the undo commands (knob edits,
+ * roto and tracker edits, connections, creation and deletion), and when the auto-save timer fires only these nodes are
+ * serialized and appended to the journal, which is a file next to the auto-save. This does not wait for renders.
+ * The next full auto-save compacts the journal: it is deleted and replaced by the new snapshot.
+ *
+ * When an auto-save is restored, the records of its journal are applied in order to its ProjectSerialization before the
+ * nodes are created: a node state replaces the serialization of the node with the same fully qualified name, or is added
+ * to its group, and a removal erases it. A record truncated by a crash ends the journal.
+ **/
+class ProjectJournal
+{
+public:
+
+    enum RecordTypeEnum
+    {
+        eRecordTypeNodeState = 0,
+        eRecordTypeNodeRemoved
+    };
+
+    struct Record
+    {
+        RecordTypeEnum type;
+        std::string nodeFullName; // fully qualified script name, e.g. Group1.Blur1
+        std::string data; // the NodeSerialization of a node state, encoded with encodeBinaryProjectSection
+
+        Record()
+            : type(eRecordTypeNodeState)
+            , nodeFullName()
+            , data()
+        {
+        }
+    };
+
+    static QString getJournalFilePath(const QString& autoSaveFilePath);
+
+    static bool isJournalFile(const QString& fileName);
+
+    /**
+     * @brief Serializes the current state of the node. Must be called on the main thread.
+     **/
+    static Record makeNodeStateRecord(const NodePtr& node);
+
+    static Record makeNodeRemovedRecord(const std::string& nodeFullName);
+
+    /**
+     * @brief Appends the records to the journal, creating it if needed, and returns its new size in bytes.
+     * Throws std::runtime_error on failure.
+     **/
+    static qint64 appendRecords(const QString& filePath, const std::list<Record>& records);
+
+    /**
+     * @brief Reads the complete records of the journal. Throws std::runtime_error if the file is not a journal.
+     **/
+    static void readRecords(const QString& filePath, std::list<Record>* records);
+
+    static void applyRecords(const std::list<Record>& records, ProjectSerialization* project);
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_PROJECTJOURNAL_H
@@ -88,6 +88,12 @@ ProjectPrivate::ProjectPrivate(Project* project)
     , isSavingProjectMutex()
     , isSavingProject(false)
     , autoSaveTimer( new QTimer() )
+    , autoSaveFutures()
+    , autoSaveJournalMutex()
+    , journalChangedNodes()
+    , journalRemovedNodes()
+    , journalFileSize(0)
+    , journalMustCompact(true)
     , projectClosing(false)
     , tlsData( new TLSHolder<Project::ProjectTLSData>() )
 
@@ -29,6 +29,7 @@
 
 #include <map>
 #include <list>
+#include <string>
 
 CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
@@ -105,6 +106,11 @@ public:
     bool isSavingProject; //< true when the project is saving
     boost::shared_ptr<QTimer> autoSaveTimer;
     std::list<boost::shared_ptr<QFutureWatcher<void> > > autoSaveFutures;
+    mutable QMutex autoSaveJournalMutex; //< protects the fields below
+    std::map<Node*, NodeWPtr> journalChangedNodes; //< nodes changed since the last append to the auto-save journal
+    std::list<std::string> journalRemovedNodes; //< fully qualified names of the nodes removed since the last append
+    qint64 journalFileSize; //< size of the journal of lastAutoSaveFilePath
+    bool journalMustCompact; //< a change the journal cannot record was made: the next auto-save must be a full one
     mutable QMutex projectClosingMutex;
     bool projectClosing;
     boost::shared_ptr<TLSHolder<Project::ProjectTLSData> > tlsData;
@@ -134,6 +134,11 @@ public:
         return _nodes;
     }
 
+    NodeCollectionSerialization & getNodesSerialization()
+    {
+        return _nodes;
+    }
+
     qint64 getCreationDate() const
     {
         return _creationDate;
@@ -32,7 +32,11 @@
  * doesn't generate the Natron namespace
  **/
 
+#include <QtCore/QMap>
+#include <QtCore/QVariant>
+
 #include "Engine/AppManager.h"
+#include "Engine/CacheEntry.h"
 #include "Engine/PyAppInstance.h"
 #include "Global/MemoryInfo.h"
 #include "Engine/EngineFwd.h"
@@ -224,6 +228,37 @@ public:
     {
         appPTR->setOnProjectLoadedCallback( pythonFunctionName.toStdString() );
     }
+
+    inline QMap<QString, QVariant> getCacheStatistics(const QString& cacheName) const
+    {
+        QMap<QString, QVariant> ret;
+        CacheStatistics stats;
+
+        if ( !appPTR->getCacheStatistics(cacheName.toStdString(), &stats) ) {
+            return ret;
+        }
+        ret[QString::fromUtf8("memoryHits")] = (qulonglong)stats.memoryHits;
+        ret[QString::fromUtf8("diskHits")] = (qulonglong)stats.diskHits;
+        ret[QString::fromUtf8("misses")] = (qulonglong)stats.misses;
+        ret[QString::fromUtf8("hitRate")] = stats.getHitRate();
+        ret[QString::fromUtf8("memoryEvictions")] = (qulonglong)stats.memoryEvictions;
+        ret[QString::fromUtf8("memoryEvictedBytes")] = (qulonglong)stats.memoryEvictedBytes;
+        ret[QString::fromUtf8("diskEvictions")] = (qulonglong)stats.diskEvictions;
+        ret[QString::fromUtf8("diskEvictedBytes")] = (qulonglong)stats.diskEvictedBytes;
+        ret[QString::fromUtf8("swappedToDiskBytes")] = (qulonglong)stats.swappedToDiskBytes;
+        ret[QString::fromUtf8("reloadedFromDiskBytes")] = (qulonglong)stats.reloadedFromDiskBytes;
+        ret[QString::fromUtf8("memoryFullWaits")] = (qulonglong)stats.memoryFullWaits;
+        ret[QString::fromUtf8("memoryFullWaitMSecs")] = (qulonglong)stats.memoryFullWaitMSecs;
+        ret[QString::fromUtf8("deleterQueueSize")] = (qulonglong)stats.deleterQueueSize;
+        ret[QString::fromUtf8("deleterQueuePeakSize")] = (qulonglong)stats.deleterQueuePeakSize;
+
+        return ret;
+    }
+
+    inline void resetCacheStatistics()
+    {
+        appPTR->resetCachesStatistics();
+    }
 };
 
 NATRON_PYTHON_NAMESPACE_EXIT;
@@ -113,6 +113,26 @@ std::vector<RectI> RectI::splitIntoSmallerRects(int splitsCount) const
     return ret;
 } // RectI::splitIntoSmallerRects
 
+std::vector<RectI> RectI::splitIntoRowStrips(int stripsCount) const
+{
+    std::vector<RectI> ret;
+
+    if ( isNull() ) {
+        return ret;
+    }
+    stripsCount = std::max( 1, std::min( stripsCount, height() ) );
+    ret.reserve(stripsCount);
+    // same order as splitIntoSmallerRects: top strips first
+    for (int i = stripsCount - 1; i >= 0; --i) {
+        int y1_ = bottom() + i     * height() / stripsCount;
+        int y2_ = bottom() + (i + 1) * height() / stripsCount;
+        assert(y2_ > y1_);
+        ret.push_back( RectI(left(), y1_, right(), y2_) );
+    }
+
+    return ret;
+}
+
 void
 RectI::toCanonical(unsigned int thisLevel,
                    double par,
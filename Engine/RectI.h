@@ -432,6 +432,12 @@ public:
 
 #endif
     std::vector<RectI> splitIntoSmallerRects(int splitsCount) const;
+
+    /**
+     * @brief Split the rectangle in stripsCount full-width strips of scan-lines of (almost) equal height,
+     * from top to bottom. stripsCount is clamped to the height of the rectangle.
+     **/
+    std::vector<RectI> splitIntoRowStrips(int stripsCount) const;
     static RectI fromOfxRectI(const OfxRectI & r)
     {
         RectI ret(r.x1, r.y1, r.x2, r.y2);
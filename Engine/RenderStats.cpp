@@ -24,6 +24,7 @@
 
 #include "RenderStats.h"
 
+#include <algorithm>
 #include <bitset>
 #include <cassert>
 #include <stdexcept>
@@ -35,8 +36,333 @@
 #include "Engine/RectI.h"
 #include "Engine/RectD.h"
 
+// Target time (in seconds) to render one tile: below that, the cost of setting up the render action and of
+// fetching the input images for each tile is not negligible anymore
+#define NATRON_TILING_MIN_TILE_TIME 0.002
+
+// Maximum number of tiles per thread, more tiles help balancing the load between threads
+#define NATRON_TILING_TILES_PER_THREAD 4
+
+// Weight of the last rendered tile in the time per pixel average
+#define NATRON_TILING_HISTORY_WEIGHT 0.25
+
+// Minimum number of frames rendered with a split of the render threads before its throughput is measured
+#define NATRON_RENDER_THREADS_MIN_SAMPLES 4
+
+// Below this cache hit rate, the frames rendered concurrently compute most of their images
+#define NATRON_RENDER_THREADS_LOW_CACHE_HIT_RATE 0.25
+
+// Time (in seconds) above which a frame is long enough to be worth splitting in tiles for more threads
+#define NATRON_RENDER_THREADS_LONG_FRAME_TIME 0.5
+
+// A new split of the render threads is kept if its throughput is at least this ratio of the previous one
+#define NATRON_RENDER_THREADS_THROUGHPUT_TOLERANCE 0.9
+
+// Weight of the last rendered frame in the frame time and cache hit rate averages
+#define NATRON_RENDER_THREADS_HISTORY_WEIGHT 0.25
+
 NATRON_NAMESPACE_ENTER;
 
+struct NodeTilingHistoryPrivate
+{
+    mutable QMutex lock;
+
+    //Exponential moving average of the time spent rendering a pixel, 0 if no tile was rendered yet
+    double timePerPixel;
+
+    NodeTilingHistoryPrivate()
+        : lock()
+        , timePerPixel(0)
+    {
+    }
+};
+
+NodeTilingHistory::NodeTilingHistory()
+    : _imp( new NodeTilingHistoryPrivate() )
+{
+}
+
+NodeTilingHistory::~NodeTilingHistory()
+{
+}
+
+void
+NodeTilingHistory::addTileRenderTime(const RectI& tile,
+                                     double timeSpent)
+{
+    if ( tile.isNull() || (timeSpent <= 0) ) {
+        return;
+    }
+    double tileTimePerPixel = timeSpent / (double)tile.area();
+    QMutexLocker k(&_imp->lock);
+
+    if (_imp->timePerPixel == 0) {
+        _imp->timePerPixel = tileTimePerPixel;
+    } else {
+        _imp->timePerPixel += NATRON_TILING_HISTORY_WEIGHT * (tileTimePerPixel - _imp->timePerPixel);
+    }
+}
+
+double
+NodeTilingHistory::getTimePerPixel() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->timePerPixel;
+}
+
+void
+NodeTilingHistory::clear()
+{
+    QMutexLocker k(&_imp->lock);
+
+    _imp->timePerPixel = 0;
+}
+
+TilingPolicyEnum
+NodeTilingHistory::splitIntoTiles(const RectI& rect,
+                                  int nThreads,
+                                  std::vector<RectI>* tiles) const
+{
+    tiles->clear();
+    if ( rect.isNull() ) {
+        return eTilingPolicySingleTile;
+    }
+    if (nThreads <= 1) {
+        tiles->push_back(rect);
+
+        return eTilingPolicySingleTile;
+    }
+    double timePerPixel = getTimePerPixel();
+    if (timePerPixel == 0) {
+        *tiles = rect.splitIntoSmallerRects(0);
+
+        return eTilingPolicySquareTiles;
+    }
+
+    double estimatedTime = timePerPixel * (double)rect.area();
+    int nbTiles = (int)std::min( estimatedTime / NATRON_TILING_MIN_TILE_TIME, (double)nThreads * NATRON_TILING_TILES_PER_THREAD );
+    nbTiles = std::min( nbTiles, rect.height() );
+    if (nbTiles <= 1) {
+        tiles->push_back(rect);
+
+        return eTilingPolicySingleTile;
+    }
+    *tiles = rect.splitIntoRowStrips(nbTiles);
+
+    return eTilingPolicyRowStrips;
+} // NodeTilingHistory::splitIntoTiles
+
+struct RenderThreadsPlannerPrivate
+{
+    mutable QMutex lock;
+    RenderThreadsPlan plan;
+
+    //The frame threads set by the user, 0 if automatic
+    int nbFrameThreadsSetting;
+
+    //The frames to render, 0 if not bounded
+    int nbFrames;
+
+    //The frame threads wanted, regardless of the threads available and of the frames left to render
+    int nbWantedFrameThreads;
+
+    //The frames rendered with the current split
+    int nbWindowFrames;
+    double windowTimeSpent;
+    int windowCacheHits;
+    int windowCacheMisses;
+
+    //The previous split and its throughput in frames per second, 0 if the split was not changed yet
+    int previousFrameThreads;
+    double previousThroughput;
+
+    //When true the split is not probed anymore
+    bool converged;
+
+    //False until a rendered frame accessed the cache
+    bool hasCacheHitRate;
+
+    RenderThreadsPlannerPrivate()
+        : lock()
+        , plan()
+        , nbFrameThreadsSetting(0)
+        , nbFrames(0)
+        , nbWantedFrameThreads(0)
+        , nbWindowFrames(0)
+        , windowTimeSpent(0)
+        , windowCacheHits(0)
+        , windowCacheMisses(0)
+        , previousFrameThreads(0)
+        , previousThroughput(0)
+        , converged(false)
+        , hasCacheHitRate(false)
+    {
+    }
+
+    void resetWindow()
+    {
+        nbWindowFrames = 0;
+        windowTimeSpent = 0;
+        windowCacheHits = 0;
+        windowCacheMisses = 0;
+    }
+
+    // Must be called with lock held. Returns true if the plan changed.
+    bool updatePlan()
+    {
+        int nbFrameThreads = nbFrameThreadsSetting > 0 ? nbFrameThreadsSetting : std::min(nbWantedFrameThreads, plan.nbThreads);
+
+        if (nbFrames > 0) {
+            // Do not keep threads for frames that will not be rendered
+            int nbFramesLeft = nbFrames - plan.nbFramesRendered;
+            if (nbFramesLeft < nbFrameThreads) {
+                nbFrameThreads = nbFramesLeft;
+                converged = true;
+            }
+        }
+        nbFrameThreads = std::max(1, nbFrameThreads);
+        int nbTileThreads = std::max(1, plan.nbThreads / nbFrameThreads);
+        if ( (nbFrameThreads == plan.nbFrameThreads) && (nbTileThreads == plan.nbTileThreads) ) {
+            return false;
+        }
+        if (plan.nbFrameThreads > 0) {
+            ++plan.nbRebalances;
+        }
+        plan.nbFrameThreads = nbFrameThreads;
+        plan.nbTileThreads = nbTileThreads;
+
+        return true;
+    }
+
+    // Must be called with lock held, once enough frames were rendered with the current split
+    void rebalance()
+    {
+        double frameTime = windowTimeSpent / nbWindowFrames;
+        double throughput = frameTime > 0 ? plan.nbFrameThreads / frameTime : 0;
+        int nbCacheAccesses = windowCacheHits + windowCacheMisses;
+        double cacheHitRate = nbCacheAccesses > 0 ? (double)windowCacheHits / nbCacheAccesses : 1.;
+
+        resetWindow();
+        if ( (previousThroughput > 0) && (throughput < previousThroughput * NATRON_RENDER_THREADS_THROUGHPUT_TOLERANCE) ) {
+            // The previous split was better
+            nbWantedFrameThreads = previousFrameThreads;
+            converged = true;
+        } else if ( (cacheHitRate < NATRON_RENDER_THREADS_LOW_CACHE_HIT_RATE) && (frameTime >= NATRON_RENDER_THREADS_LONG_FRAME_TIME) &&
+                    (plan.nbFrameThreads > 1) ) {
+            // Long frames computing most of their images: try rendering fewer frames with more tiles each
+            previousFrameThreads = plan.nbFrameThreads;
+            previousThroughput = throughput;
+            nbWantedFrameThreads = plan.nbFrameThreads / 2;
+        } else {
+            converged = true;
+        }
+    }
+};
+
+RenderThreadsPlanner::RenderThreadsPlanner()
+    : _imp( new RenderThreadsPlannerPrivate() )
+{
+}
+
+RenderThreadsPlanner::~RenderThreadsPlanner()
+{
+}
+
+void
+RenderThreadsPlanner::startRender(int nbThreads,
+                                  int nbFrameThreadsSetting,
+                                  int nbFrames)
+{
+    QMutexLocker k(&_imp->lock);
+
+    _imp->plan = RenderThreadsPlan();
+    _imp->plan.nbThreads = std::max(1, nbThreads);
+    _imp->nbFrameThreadsSetting = std::max(0, nbFrameThreadsSetting);
+    _imp->nbFrames = std::max(0, nbFrames);
+    _imp->nbWantedFrameThreads = _imp->plan.nbThreads;
+    _imp->previousFrameThreads = 0;
+    _imp->previousThroughput = 0;
+    _imp->converged = _imp->nbFrameThreadsSetting > 0;
+    _imp->hasCacheHitRate = false;
+    _imp->resetWindow();
+    _imp->updatePlan();
+}
+
+void
+RenderThreadsPlanner::stopRender()
+{
+    QMutexLocker k(&_imp->lock);
+
+    // Keep the measures of the last render for the stats
+    _imp->plan.nbFrameThreads = 0;
+    _imp->plan.nbTileThreads = 0;
+}
+
+bool
+RenderThreadsPlanner::addFrameSample(double timeSpent,
+                                     int nbCacheHits,
+                                     int nbCacheMisses)
+{
+    QMutexLocker k(&_imp->lock);
+    RenderThreadsPlan& plan = _imp->plan;
+
+    if (plan.nbFrameThreads == 0) {
+        return false;
+    }
+    timeSpent = std::max(0., timeSpent);
+    if (plan.nbFramesRendered == 0) {
+        plan.averageFrameTime = timeSpent;
+    } else {
+        plan.averageFrameTime += (timeSpent - plan.averageFrameTime) * NATRON_RENDER_THREADS_HISTORY_WEIGHT;
+    }
+    int nbCacheAccesses = nbCacheHits + nbCacheMisses;
+    if (nbCacheAccesses > 0) {
+        double cacheHitRate = (double)nbCacheHits / nbCacheAccesses;
+        if (!_imp->hasCacheHitRate) {
+            plan.cacheHitRate = cacheHitRate;
+            _imp->hasCacheHitRate = true;
+        } else {
+            plan.cacheHitRate += (cacheHitRate - plan.cacheHitRate) * NATRON_RENDER_THREADS_HISTORY_WEIGHT;
+        }
+    }
+    ++plan.nbFramesRendered;
+
+    if (!_imp->converged) {
+        ++_imp->nbWindowFrames;
+        _imp->windowTimeSpent += timeSpent;
+        _imp->windowCacheHits += nbCacheHits;
+        _imp->windowCacheMisses += nbCacheMisses;
+        if ( _imp->nbWindowFrames >= std::max(NATRON_RENDER_THREADS_MIN_SAMPLES, plan.nbFrameThreads) ) {
+            _imp->rebalance();
+        }
+    }
+
+    return _imp->updatePlan();
+}
+
+bool
+RenderThreadsPlanner::setAvailableThreads(int nbThreads)
+{
+    QMutexLocker k(&_imp->lock);
+
+    nbThreads = std::max(1, nbThreads);
+    if ( (_imp->plan.nbFrameThreads == 0) || (nbThreads == _imp->plan.nbThreads) ) {
+        return false;
+    }
+    _imp->plan.nbThreads = nbThreads;
+
+    return _imp->updatePlan();
+}
+
+RenderThreadsPlan
+RenderThreadsPlanner::getPlan() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->plan;
+}
+
 struct NodeRenderStatsPrivate
 {
     //The accumulated time spent in the EffectInstance::renderHandler function
@@ -77,6 +403,9 @@ struct NodeRenderStatsPrivate
     //Premultiplication of the output imge
     ImagePremultiplicationEnum outputPremult;
 
+    //How each render window was split in tiles by the host
+    std::list<NodeTilingInfos> tilingInfos;
+
     NodeRenderStatsPrivate()
         : totalTimeSpentRendering(0)
         , rod()
@@ -92,6 +421,7 @@ struct NodeRenderStatsPrivate
         , renderScaleSupportEnabled(false)
         , channelsEnabled()
         , outputPremult(eImagePremultiplicationOpaque)
+        , tilingInfos()
     {
         for (int i = 0; i < 4; ++i) {
             channelsEnabled[i] = false;
@@ -133,6 +463,7 @@ NodeRenderStats::operator=(const NodeRenderStats& other)
         _imp->channelsEnabled[i] = other._imp->channelsEnabled[i];
     }
     _imp->outputPremult = other._imp->outputPremult;
+    _imp->tilingInfos = other._imp->tilingInfos;
 }
 
 void
@@ -301,6 +632,40 @@ NodeRenderStats::getOutputPremult() const
     return _imp->outputPremult;
 }
 
+void
+NodeRenderStats::addTilingInfos(const NodeTilingInfos& infos)
+{
+    _imp->tilingInfos.push_back(infos);
+}
+
+const std::list<NodeTilingInfos>&
+NodeRenderStats::getTilingInfos() const
+{
+    return _imp->tilingInfos;
+}
+
+namespace {
+struct HashPropagationInfos
+{
+    QMutex lock;
+    U64 nbPropagations;
+    U64 totalNbNodesRehashed;
+    int lastNbNodesVisited;
+    int lastNbNodesRehashed;
+
+    HashPropagationInfos()
+        : lock()
+        , nbPropagations(0)
+        , totalNbNodesRehashed(0)
+        , lastNbNodesVisited(0)
+        , lastNbNodesRehashed(0)
+    {
+    }
+};
+
+HashPropagationInfos hashPropagationInfos;
+}
+
 struct RenderStatsPrivate
 {
     mutable QMutex lock;
@@ -314,12 +679,17 @@ struct RenderStatsPrivate
     typedef std::map<NodeWPtr, NodeRenderStats > NodeInfosMap;
     NodeInfosMap nodeInfos;
 
+    //Cache accesses of all nodes for the frame, recorded even without in-depth profiling
+    int nbCacheMisses;
+    int nbCacheHits;
 
     RenderStatsPrivate()
         : lock()
         , totalTimeSpentForFrameTimer()
         , doNodesProfiling(false)
         , nodeInfos()
+        , nbCacheMisses(0)
+        , nbCacheHits(0)
     {
     }
 
@@ -408,12 +778,37 @@ RenderStats::addCacheInfosForNode(const NodePtr& node,
 {
     QMutexLocker k(&_imp->lock);
 
-    assert(_imp->doNodesProfiling);
+    if (isCacheMiss) {
+        ++_imp->nbCacheMisses;
+    } else {
+        ++_imp->nbCacheHits;
+    }
+    if (!_imp->doNodesProfiling) {
+        return;
+    }
 
     NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
     stats.addCacheAccessInfo(isCacheMiss, hasDownscaled);
 }
 
+void
+RenderStats::getCacheAccessInfos(int* nbCacheMisses,
+                                 int* nbCacheHits) const
+{
+    QMutexLocker k(&_imp->lock);
+
+    *nbCacheMisses = _imp->nbCacheMisses;
+    *nbCacheHits = _imp->nbCacheHits;
+}
+
+double
+RenderStats::getTimeSpentForFrame() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->totalTimeSpentForFrameTimer.getTimeSinceCreation();
+}
+
 void
 RenderStats::addRenderInfosForNode(const NodePtr& node,
                                    const NodePtr& identity,
@@ -435,6 +830,18 @@ RenderStats::addRenderInfosForNode(const NodePtr& node,
     stats.addPlaneRendered(plane);
 }
 
+void
+RenderStats::addTilingInfosForNode(const NodePtr& node,
+                                   const NodeTilingInfos& infos)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addTilingInfos(infos);
+}
+
 std::map<NodePtr, NodeRenderStats >
 RenderStats::getStats(double *totalTimeSpent) const
 {
@@ -453,4 +860,41 @@ RenderStats::getStats(double *totalTimeSpent) const
     return ret;
 }
 
+void
+RenderStats::addHashPropagationInfos(int nbNodesVisited,
+                                     int nbNodesRehashed)
+{
+    QMutexLocker k(&hashPropagationInfos.lock);
+
+    ++hashPropagationInfos.nbPropagations;
+    hashPropagationInfos.totalNbNodesRehashed += nbNodesRehashed;
+    hashPropagationInfos.lastNbNodesVisited = nbNodesVisited;
+    hashPropagationInfos.lastNbNodesRehashed = nbNodesRehashed;
+}
+
+void
+RenderStats::getHashPropagationInfos(U64* nbPropagations,
+                                     U64* totalNbNodesRehashed,
+                                     int* lastNbNodesVisited,
+                                     int* lastNbNodesRehashed)
+{
+    QMutexLocker k(&hashPropagationInfos.lock);
+
+    *nbPropagations = hashPropagationInfos.nbPropagations;
+    *totalNbNodesRehashed = hashPropagationInfos.totalNbNodesRehashed;
+    *lastNbNodesVisited = hashPropagationInfos.lastNbNodesVisited;
+    *lastNbNodesRehashed = hashPropagationInfos.lastNbNodesRehashed;
+}
+
+void
+RenderStats::resetHashPropagationInfos()
+{
+    QMutexLocker k(&hashPropagationInfos.lock);
+
+    hashPropagationInfos.nbPropagations = 0;
+    hashPropagationInfos.totalNbNodesRehashed = 0;
+    hashPropagationInfos.lastNbNodesVisited = 0;
+    hashPropagationInfos.lastNbNodesRehashed = 0;
+}
+
 NATRON_NAMESPACE_EXIT;
@@ -32,6 +32,7 @@
 #include <set>
 #include <string>
 #include <bitset>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
@@ -47,6 +48,167 @@
 
 NATRON_NAMESPACE_ENTER;
 
+/**
+ * @brief How the host splits the render window of a node in tiles when rendering with host frame threading
+ * (see NodeTilingHistory::splitIntoTiles)
+ **/
+enum TilingPolicyEnum
+{
+    eTilingPolicyNone = 0, // The render window was not split by the host
+    eTilingPolicySquareTiles, // No timing history yet: square tiles of at least 128x128 pixels
+    eTilingPolicyRowStrips, // Full-width strips of scan-lines, their count depends on the estimated render time
+    eTilingPolicySingleTile // The estimated render time is too short to be worth splitting
+};
+
+/**
+ * @brief How the host split one render window of a node in tiles
+ **/
+struct NodeTilingInfos
+{
+    RectI rect;
+    TilingPolicyEnum policy;
+    int nbTiles;
+    double timePerPixel; // The estimated time to render one pixel the tiles count was chosen from
+
+    NodeTilingInfos()
+        : rect()
+        , policy(eTilingPolicyNone)
+        , nbTiles(0)
+        , timePerPixel(0)
+    {
+    }
+};
+
+/**
+ * @brief Timing history of the render action of a node, used to choose how to split its render window in tiles
+ * for host frame threading. Contrary to NodeRenderStats this is always recorded and kept across frames. MT-safe.
+ **/
+struct NodeTilingHistoryPrivate;
+class NodeTilingHistory
+{
+public:
+
+    NodeTilingHistory();
+
+    ~NodeTilingHistory();
+
+    /**
+     * @brief Record the time (in seconds) spent in the render action to render the given tile.
+     **/
+    void addTileRenderTime(const RectI& tile, double timeSpent);
+
+    /**
+     * @brief Returns the estimated time (in seconds) to render one pixel, the most recent tiles weighing more.
+     * Returns 0 if no tile was rendered yet.
+     **/
+    double getTimePerPixel() const;
+
+    void clear();
+
+    /**
+     * @brief Split rect in tiles that can be rendered concurrently by nThreads threads.
+     * Without history, rect is split in square tiles (see RectI::splitIntoSmallerRects).
+     * Otherwise, the tiles count is chosen so that each tile takes about NATRON_TILING_MIN_TILE_TIME seconds to
+     * render, with at most NATRON_TILING_TILES_PER_THREAD tiles per thread for load balancing, and rect is split in
+     * full-width row strips: these read and write contiguous memory in the images and keep the overlap of the
+     * regions of interest in the inputs as small as possible.
+     * @returns The policy that was used.
+     **/
+    TilingPolicyEnum splitIntoTiles(const RectI& rect, int nThreads, std::vector<RectI>* tiles) const;
+
+private:
+
+    boost::scoped_ptr<NodeTilingHistoryPrivate> _imp;
+};
+
+/**
+ * @brief How the threads of a sequential render (playback or render on disk) are split between the frames rendered
+ * concurrently and the host frame threading tiles of each frame, as decided by RenderThreadsPlanner.
+ **/
+struct RenderThreadsPlan
+{
+    // Number of frames rendered concurrently, 0 if no render is in progress
+    int nbFrameThreads;
+
+    // Number of threads each frame splits its render windows for (see NodeTilingHistory::splitIntoTiles)
+    int nbTileThreads;
+
+    // Threads available to the render
+    int nbThreads;
+
+    // Frames rendered since the render started
+    int nbFramesRendered;
+
+    // Moving average of the time (in seconds) spent rendering a frame
+    double averageFrameTime;
+
+    // Moving average of the ratio of the image cache lookups that were hits, in [0, 1]
+    double cacheHitRate;
+
+    // Number of times the split was changed since the render started
+    int nbRebalances;
+
+    RenderThreadsPlan()
+        : nbFrameThreads(0)
+        , nbTileThreads(0)
+        , nbThreads(0)
+        , nbFramesRendered(0)
+        , averageFrameTime(0)
+        , cacheHitRate(0)
+        , nbRebalances(0)
+    {
+    }
+};
+
+/**
+ * @brief Sizes the split between frame threads and tile threads of a sequential render up front, then rebalances it
+ * from the measured render time and cache hit rate of the frames (see RenderStats). MT-safe.
+ *
+ * A render starts with as many frame threads as there are threads available (or frames to render), each frame using
+ * the remaining threads for its tiles. Frames are cheap to render in parallel, but each one holds its images in RAM:
+ * when frames are long to render and mostly miss the cache, the planner tries halving the frame threads, giving their
+ * threads to the tiles, and keeps the new split only if the measured throughput in frames per second did not drop.
+ * It stops probing as soon as a split does not improve, so that the split cannot oscillate.
+ * At the end of a render on disk, the threads of the frames that are not needed anymore go to the tiles.
+ **/
+struct RenderThreadsPlannerPrivate;
+class RenderThreadsPlanner
+{
+public:
+
+    RenderThreadsPlanner();
+
+    ~RenderThreadsPlanner();
+
+    /**
+     * @brief Sizes the plan for a new render.
+     * @param nbThreads The number of threads available to the render
+     * @param nbFrameThreadsSetting If > 0, the number of frame threads wanted by the user: it is never rebalanced
+     * @param nbFrames The number of frames to render, or 0 if it is not bounded (e.g. a playback loop)
+     **/
+    void startRender(int nbThreads, int nbFrameThreadsSetting, int nbFrames);
+
+    void stopRender();
+
+    /**
+     * @brief Records a rendered frame: the time spent rendering it (in seconds) and its cache accesses.
+     * @returns True if the plan changed.
+     **/
+    bool addFrameSample(double timeSpent, int nbCacheHits, int nbCacheMisses);
+
+    /**
+     * @brief Updates the number of threads available to the render, e.g. when another render starts or stops.
+     * @returns True if the plan changed.
+     **/
+    bool setAvailableThreads(int nbThreads);
+
+    RenderThreadsPlan getPlan() const;
+
+private:
+
+    boost::scoped_ptr<RenderThreadsPlannerPrivate> _imp;
+};
+
 /**
  * @brief Holds render infos for one frame for one node. Not MT-safe: MT-safety is handled by RenderStats.
  **/
@@ -99,6 +261,9 @@ public:
     void setOutputPremult(ImagePremultiplicationEnum premult);
     ImagePremultiplicationEnum getOutputPremult() const;
 
+    void addTilingInfos(const NodeTilingInfos& infos);
+    const std::list<NodeTilingInfos>& getTilingInfos() const;
+
 private:
 
     boost::scoped_ptr<NodeRenderStatsPrivate> _imp;
@@ -132,18 +297,48 @@ public:
                                      bool renderScaleSupported,
                                      unsigned int mipmapLevel);
 
+    /**
+     * @brief Record a cache access of the node. The totals for the frame (see getCacheAccessInfos) are recorded
+     * even when in-depth profiling is disabled.
+     **/
     void addCacheInfosForNode(const NodePtr& node,
                               bool isCacheMiss,
                               bool hasDownscaled);
 
+    void getCacheAccessInfos(int* nbCacheMisses, int* nbCacheHits) const;
+
+    /**
+     * @brief Returns the time (in seconds) elapsed since the render of the frame started.
+     **/
+    double getTimeSpentForFrame() const;
+
     void addRenderInfosForNode(const NodePtr& node,
                                const NodePtr& identity,
                                const std::string& plane,
                                const RectI& rectangle,
                                double timeSpent);
 
+    /**
+     * @brief Record how a render window of the node was split by the host,
+     * see NodeTilingHistory::splitIntoTiles
+     **/
+    void addTilingInfosForNode(const NodePtr& node,
+                               const NodeTilingInfos& infos);
+
     std::map<NodePtr, NodeRenderStats > getStats(double *totalTimeSpent) const;
 
+    /**
+     * @brief Hash propagation counters. Each edit of a node propagates its hash downstream (see Node::computeHashes):
+     * nbNodesVisited is the number of nodes walked by the propagation pass and nbNodesRehashed the number of nodes
+     * whose hash had to be combined again. These are global to the process since edits are not related to a frame.
+     **/
+    static void addHashPropagationInfos(int nbNodesVisited, int nbNodesRehashed);
+    static void getHashPropagationInfos(U64* nbPropagations,
+                                        U64* totalNbNodesRehashed,
+                                        int* lastNbNodesVisited,
+                                        int* lastNbNodesRehashed);
+    static void resetHashPropagationInfos();
+
 private:
 
     boost::scoped_ptr<RenderStatsPrivate> _imp;
@@ -0,0 +1,361 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderTrace.h"
+
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include "Engine/EffectInstance.h"
+#include "Engine/FStreamsSupport.h"
+#include "Engine/Node.h"
+#include "Engine/RectI.h"
+#include "Engine/ThreadPool.h"
+
+// Past this number of events, the next ones are dropped so that a long render does not use all the memory
+#define NATRON_RENDER_TRACE_MAX_EVENTS 4000000
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+struct TraceEvent
+{
+    const char* category;
+    const char* name;
+    std::string label;
+    std::string args;
+    qint64 beginUs;
+    qint64 durationUs;
+    int threadIndex;
+};
+
+struct RenderTraceData
+{
+    // Tested without locking the mutex by the scopes
+    QAtomicInt active;
+
+    // Protects all the fields below
+    QMutex lock;
+    QString filePath;
+    QElapsedTimer timer;
+    std::vector<TraceEvent> events;
+    std::size_t droppedEvents;
+    std::map<QThread*, int> threadIndices;
+    std::vector<std::string> threadNames;
+
+    RenderTraceData()
+        : active()
+        , lock()
+        , filePath()
+        , timer()
+        , events()
+        , droppedEvents(0)
+        , threadIndices()
+        , threadNames()
+    {
+    }
+
+    // Must be called with lock held
+    int getThreadIndex(QThread* thread)
+    {
+        std::map<QThread*, int>::const_iterator found = threadIndices.find(thread);
+
+        if ( found != threadIndices.end() ) {
+            return found->second;
+        }
+
+        int index = (int)threadNames.size();
+        std::string name;
+        AbortableThread* isAbortable = dynamic_cast<AbortableThread*>(thread);
+        if (isAbortable) {
+            name = isAbortable->getThreadName();
+        }
+        if ( name.empty() ) {
+            if ( qApp && (thread == qApp->thread()) ) {
+                name = "Main thread";
+            } else if ( !thread->objectName().isEmpty() ) {
+                name = thread->objectName().toStdString();
+            } else {
+                std::stringstream ss;
+                ss << "Thread " << index;
+                name = ss.str();
+            }
+        }
+        threadNames.push_back(name);
+        threadIndices[thread] = index;
+
+        return index;
+    }
+};
+
+RenderTraceData&
+traceData()
+{
+    static RenderTraceData data;
+
+    return data;
+}
+
+void
+appendEscaped(const std::string& str,
+              std::string* out)
+{
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        unsigned char c = (unsigned char)str[i];
+        if ( (c == '"') || (c == '\\') ) {
+            out->push_back('\\');
+            out->push_back( (char)c );
+        } else if (c < 0x20) {
+            const char* hexDigits = "0123456789abcdef";
+            out->append("\\u00");
+            out->push_back(hexDigits[c >> 4]);
+            out->push_back(hexDigits[c & 0xf]);
+        } else {
+            out->push_back( (char)c );
+        }
+    }
+}
+
+void
+appendKey(const char* key,
+          std::string* args)
+{
+    if ( !args->empty() ) {
+        args->push_back(',');
+    }
+    args->push_back('"');
+    appendEscaped(key, args);
+    args->append("\":");
+}
+}
+
+RenderTrace::Scope::Scope(const char* category,
+                          const char* name,
+                          const std::string& label)
+    : _recording(false)
+    , _category(category)
+    , _name(name)
+    , _label()
+    , _args()
+    , _beginUs(0)
+{
+    begin();
+    if (_recording) {
+        _label = label;
+    }
+}
+
+RenderTrace::Scope::Scope(const char* category,
+                          const char* name,
+                          const EffectInstance* effect,
+                          double time,
+                          ViewIdx view)
+    : _recording(false)
+    , _category(category)
+    , _name(name)
+    , _label()
+    , _args()
+    , _beginUs(0)
+{
+    begin();
+    if (_recording) {
+        NodePtr node = effect->getNode();
+        if (node) {
+            _label = node->getFullyQualifiedName();
+        }
+        addArg("time", time);
+        addArg("view", (double)view);
+    }
+}
+
+void
+RenderTrace::Scope::begin()
+{
+    RenderTraceData& data = traceData();
+    if ( (int)data.active == 0 ) {
+        return;
+    }
+    _recording = true;
+    // QElapsedTimer is MT-safe as long as it is not restarted, which only start() does
+    _beginUs = data.timer.nsecsElapsed() / 1000;
+}
+
+RenderTrace::Scope::~Scope()
+{
+    if (!_recording) {
+        return;
+    }
+
+    RenderTraceData& data = traceData();
+    qint64 endUs = data.timer.nsecsElapsed() / 1000;
+    QThread* thread = QThread::currentThread();
+    QMutexLocker k(&data.lock);
+
+    // The recording may have been stopped meanwhile
+    if ( (int)data.active == 0 ) {
+        return;
+    }
+    if (data.events.size() >= NATRON_RENDER_TRACE_MAX_EVENTS) {
+        ++data.droppedEvents;
+
+        return;
+    }
+
+    TraceEvent e;
+    e.category = _category;
+    e.name = _name;
+    e.label = _label;
+    e.args = _args;
+    e.beginUs = _beginUs;
+    e.durationUs = endUs - _beginUs;
+    e.threadIndex = data.getThreadIndex(thread);
+    data.events.push_back(e);
+}
+
+void
+RenderTrace::Scope::addArg(const char* key,
+                           double value)
+{
+    if (!_recording) {
+        return;
+    }
+    appendKey(key, &_args);
+    std::stringstream ss;
+    ss << value;
+    _args.append( ss.str() );
+}
+
+void
+RenderTrace::Scope::addArg(const char* key,
+                           const std::string& value)
+{
+    if (!_recording) {
+        return;
+    }
+    appendKey(key, &_args);
+    _args.push_back('"');
+    appendEscaped(value, &_args);
+    _args.push_back('"');
+}
+
+void
+RenderTrace::Scope::addArg(const char* key,
+                           const RectI& rect)
+{
+    if (!_recording) {
+        return;
+    }
+    appendKey(key, &_args);
+    std::stringstream ss;
+    ss << '[' << rect.x1 << ',' << rect.y1 << ',' << rect.x2 << ',' << rect.y2 << ']';
+    _args.append( ss.str() );
+}
+
+void
+RenderTrace::start(const QString& filePath)
+{
+    RenderTraceData& data = traceData();
+    QMutexLocker k(&data.lock);
+
+    data.filePath = filePath;
+    data.events.clear();
+    data.droppedEvents = 0;
+    data.threadIndices.clear();
+    data.threadNames.clear();
+    data.timer.start();
+    data.active.fetchAndStoreRelease(1);
+}
+
+bool
+RenderTrace::isActive()
+{
+    return (int)traceData().active != 0;
+}
+
+std::size_t
+RenderTrace::getEventsCount()
+{
+    RenderTraceData& data = traceData();
+    QMutexLocker k(&data.lock);
+
+    return data.events.size();
+}
+
+bool
+RenderTrace::stop()
+{
+    RenderTraceData& data = traceData();
+    std::vector<TraceEvent> events;
+    std::vector<std::string> threadNames;
+    std::size_t droppedEvents;
+    QString filePath;
+    {
+        QMutexLocker k(&data.lock);
+        if ( data.active.fetchAndStoreAcquire(0) == 0 ) {
+            return true;
+        }
+        events.swap(data.events);
+        threadNames.swap(data.threadNames);
+        data.threadIndices.clear();
+        droppedEvents = data.droppedEvents;
+        filePath = data.filePath;
+    }
+
+    FStreamsSupport::ofstream ofile;
+    FStreamsSupport::open( &ofile, filePath.toStdString() );
+    if (!ofile) {
+        return false;
+    }
+
+    ofile << "{\"traceEvents\":[\n";
+    bool first = true;
+    std::string escaped;
+    for (std::size_t i = 0; i < threadNames.size(); ++i) {
+        escaped.clear();
+        appendEscaped(threadNames[i], &escaped);
+        ofile << (first ? "" : ",\n") << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << escaped << "\"}}";
+        first = false;
+    }
+    for (std::vector<TraceEvent>::const_iterator it = events.begin(); it != events.end(); ++it) {
+        escaped.clear();
+        appendEscaped(it->label.empty() ? std::string(it->name) : it->label + ' ' + it->name, &escaped);
+        ofile << (first ? "" : ",\n") << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << it->threadIndex << ",\"cat\":\"" << it->category
+              << "\",\"name\":\"" << escaped << "\",\"ts\":" << it->beginUs << ",\"dur\":" << it->durationUs
+              << ",\"args\":{" << it->args << "}}";
+        first = false;
+    }
+    ofile << "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"droppedEvents\":" << droppedEvents << "}}\n";
+    ofile.flush();
+
+    return (bool)ofile;
+} // RenderTrace::stop
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,117 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_RENDERTRACE_H
+#define NATRON_ENGINE_RENDERTRACE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+
+#include <QtCore/QString>
+
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Records the actions called by the renders of all the nodes, with the thread they ran on, and writes them in the
+ * Chrome trace event format (https://github.com/catapult-project/catapult/tree/master/tracing), which can be opened
+ * in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Unlike RenderStats which sums the times per node and per frame, each call is an event with its begin time and duration,
+ * so that the timeline shows which thread was rendering what and what it was waiting for.
+ *
+ * The recording is global to the process and is enabled with the --render-trace command line option. When it is not
+ * recording, a Scope only costs the test of a flag. MT-safe.
+ **/
+class RenderTrace
+{
+public:
+
+    /**
+     * @brief An event lasting for the lifetime of the scope, recorded on the current thread.
+     * The category and name must be string literals.
+     **/
+    class Scope
+    {
+public:
+
+        Scope(const char* category, const char* name, const std::string& label);
+
+        /**
+         * @brief The label is the fully qualified name of the node of the effect, with the time and view as arguments.
+         **/
+        Scope(const char* category, const char* name, const EffectInstance* effect, double time, ViewIdx view);
+
+        ~Scope();
+
+        /**
+         * @brief Whether the event will be recorded: arguments that are costly to compute should only be added if true.
+         **/
+        bool isRecording() const
+        {
+            return _recording;
+        }
+
+        void addArg(const char* key, double value);
+        void addArg(const char* key, const std::string& value);
+        void addArg(const char* key, const RectI& rect);
+
+private:
+
+        void begin();
+
+        bool _recording;
+        const char* _category;
+        const char* _name;
+        std::string _label;
+        std::string _args;
+        qint64 _beginUs;
+    };
+
+    /**
+     * @brief Starts recording: the events will be written to the given file by stop().
+     * The events recorded before are discarded.
+     **/
+    static void start(const QString& filePath);
+
+    static bool isActive();
+
+    /**
+     * @brief Stops recording and writes the events. Returns false if the file could not be written.
+     * Does nothing and returns true if not recording.
+     **/
+    static bool stop();
+
+    /**
+     * @brief Returns the number of events recorded since start().
+     **/
+    static std::size_t getEventsCount();
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_RENDERTRACE_H
@@ -46,6 +46,12 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 //#define ROTO_RENDER_TRIANGLES_ONLY
 
+// Past this number of vertices, the least recently used tessellations of the Beziers are evicted (see RotoContextPrivate::getShapeGeometry)
+#define NATRON_ROTO_GEOMETRY_CACHE_MAX_VERTICES 2000000
+
+// Render the closed Beziers with RotoRasterizer, which antialiases their edges, instead of cairo. Strokes and open Beziers are still rendered with cairo.
+#define ROTO_RENDER_NATIVE_RASTERIZER
+
 #include "libtess.h"
 
 #include "Global/MemoryInfo.h"
@@ -65,8 +71,10 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/RotoContextSerialization.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/RotoLayer.h"
+#include "Engine/RotoRasterizer.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/Settings.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewerInstance.h"
@@ -809,6 +817,85 @@ RotoContext::getGlobalMotionBlurSettings(const double time,
 #endif
 }
 
+namespace {
+struct ShapeMaskToRender
+{
+    boost::shared_ptr<RotoDrawableItem> item;
+    ImageComponents components;
+    ImageBitDepthEnum depth;
+};
+
+void
+renderShapeMaskTask(const ShapeMaskToRender* shape,
+                    double time,
+                    ViewIdx view,
+                    unsigned int mipmapLevel)
+{
+    // The image is inserted in the cache, where the node of the item will find it
+    shape->item->renderMaskFromStroke(shape->components, time, view, shape->depth, mipmapLevel, RectD());
+}
+}
+
+void
+RotoContext::renderShapesMasks(const std::list<boost::shared_ptr<RotoDrawableItem> >& items,
+                               double time,
+                               ViewIdx view,
+                               unsigned int mipmapLevel,
+                               const RectD& roi) const
+{
+    NodePtr node = getNode();
+
+    // While drawing, the stroke is rendered incrementally from the last stroke image instead
+    if ( !node || node->isDuringPaintStrokeCreation() ) {
+        return;
+    }
+
+    std::vector<ShapeMaskToRender> shapes;
+    for (std::list<boost::shared_ptr<RotoDrawableItem> >::const_iterator it = items.begin(); it != items.end(); ++it) {
+        // An inverted mask covers the RoD of the RotoPaint source, which is only known to the node of the item
+        if ( (*it)->getInverted(time) ) {
+            continue;
+        }
+        if ( !(*it)->getBoundingBox(time).intersects(roi) ) {
+            continue;
+        }
+        NodePtr effectNode = (*it)->getEffectNode();
+        if (!effectNode) {
+            continue;
+        }
+        EffectInstPtr effect = effectNode->getEffectInstance();
+        int maskInput = -1;
+        int maxInputs = effect->getMaxInputCount();
+        for (int i = 0; i < maxInputs; ++i) {
+            if ( effect->isInputRotoBrush(i) || ( effect->isInputMask(i) && effect->isMaskEnabled(i) ) ) {
+                maskInput = i;
+                break;
+            }
+        }
+        if (maskInput == -1) {
+            continue;
+        }
+        ShapeMaskToRender shape;
+        shape.item = *it;
+        shape.components = effect->getComponents(maskInput);
+        shape.depth = effect->getBitDepth(maskInput);
+        shapes.push_back(shape);
+    }
+
+    // A single mask is rendered as well by its node without waiting
+    if (shapes.size() < 2) {
+        return;
+    }
+
+    RenderThreadPool* pool = appPTR->getRenderThreadPool();
+    RenderThreadPool::TaskGroup masks;
+    for (std::size_t i = 0; i < shapes.size(); ++i) {
+        pool->startTask( &masks, boost::bind(&renderShapeMaskTask, &shapes[i], time, view, mipmapLevel) );
+    }
+    // A mask that failed to render is rendered again by its node
+    ignore_result( pool->waitForGroup(&masks) );
+} // RotoContext::renderShapesMasks
+
 void
 RotoContext::getItemsRegionOfDefinition(const std::list<boost::shared_ptr<RotoItem> >& items,
                                         double time,
@@ -2284,6 +2371,89 @@ convertCairoImageToNatronImage_noColor(cairo_surface_t* cairoImg,
     }
 }
 
+#ifdef ROTO_RENDER_NATIVE_RASTERIZER
+template <typename PIX, int maxValue, int dstNComps>
+static void
+convertCoverageToNatronImageForDstComponents(const float* coverage,
+                                             std::size_t rowStride,
+                                             Image* image,
+                                             const RectI & pixelRod,
+                                             double shapeColor[3],
+                                             double opacity,
+                                             bool inverted)
+{
+    Image::WriteAccess acc = image->getWriteRights();
+    float r = (float)(shapeColor[0] * opacity);
+    float g = (float)(shapeColor[1] * opacity);
+    float b = (float)(shapeColor[2] * opacity);
+    float a = (float)opacity;
+    int width = pixelRod.width();
+
+    for (int y = 0; y < pixelRod.height(); ++y, coverage += rowStride) {
+        PIX* dstPix = (PIX*)acc.pixelAt(pixelRod.x1, pixelRod.y1 + y);
+        assert(dstPix);
+
+        // The coverage may be the destination itself, when it is a single-channel float image
+        for (int x = 0; x < width; ++x, dstPix += dstNComps) {
+            float c = (inverted ? 1.f - coverage[x] : coverage[x]) * maxValue;
+            switch (dstNComps) {
+            case 4:
+                dstPix[0] = PIX(c * r);
+                dstPix[1] = PIX(c * g);
+                dstPix[2] = PIX(c * b);
+                dstPix[3] = PIX(c * a);
+                break;
+            case 1:
+                dstPix[0] = PIX(c * a);
+                break;
+            case 3:
+                dstPix[0] = PIX(c * r);
+                dstPix[1] = PIX(c * g);
+                dstPix[2] = PIX(c * b);
+                break;
+            case 2:
+                dstPix[0] = PIX(c * r);
+                dstPix[1] = PIX(c * g);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+template <typename PIX, int maxValue>
+static void
+convertCoverageToNatronImage(const float* coverage,
+                             std::size_t rowStride,
+                             Image* image,
+                             const RectI & pixelRod,
+                             double shapeColor[3],
+                             double opacity,
+                             bool inverted)
+{
+    int comps = (int)image->getComponentsCount();
+
+    switch (comps) {
+    case 1:
+        convertCoverageToNatronImageForDstComponents<PIX, maxValue, 1>(coverage, rowStride, image, pixelRod, shapeColor, opacity, inverted);
+        break;
+    case 2:
+        convertCoverageToNatronImageForDstComponents<PIX, maxValue, 2>(coverage, rowStride, image, pixelRod, shapeColor, opacity, inverted);
+        break;
+    case 3:
+        convertCoverageToNatronImageForDstComponents<PIX, maxValue, 3>(coverage, rowStride, image, pixelRod, shapeColor, opacity, inverted);
+        break;
+    case 4:
+        convertCoverageToNatronImageForDstComponents<PIX, maxValue, 4>(coverage, rowStride, image, pixelRod, shapeColor, opacity, inverted);
+        break;
+    default:
+        break;
+    }
+}
+
+#endif // ROTO_RENDER_NATIVE_RASTERIZER
+
 #if 0
 template <typename PIX, int maxValue, int srcNComps, int dstNComps>
 static void
@@ -2489,6 +2659,103 @@ convertNatronImageToCairoImage(unsigned char* cairoImg,
     }
 }
 
+#ifdef ROTO_RENDER_NATIVE_RASTERIZER
+double
+RotoStrokeItem::renderSingleStroke(const RectD& pointsBbox,
+                                   const std::list<std::pair<Point, double> >& points,
+                                   unsigned int mipmapLevel,
+                                   double par,
+                                   const ImageComponents& components,
+                                   ImageBitDepthEnum depth,
+                                   double distToNext,
+                                   boost::shared_ptr<Image> *image)
+{
+    // The new points are stamped from the keyframes of the stroke, with the spacing of the dabs stamped before
+    Q_UNUSED(points);
+
+    double time = getContext()->getTimelineCurrentTime();
+    double shapeColor[3];
+    getColor(time, shapeColor);
+
+    boost::shared_ptr<Image> source = *image;
+    RectI pixelPointsBbox;
+    pointsBbox.toPixelEnclosing(mipmapLevel, par, &pixelPointsBbox);
+
+    NodePtr node = getContext()->getNode();
+    ImageFieldingOrderEnum fielding = node->getEffectInstance()->getFieldingOrder();
+    ImagePremultiplicationEnum premult = node->getEffectInstance()->getPremult();
+
+    // The pixels of the image to render again
+    RectI dirty;
+    if ( !source || (source->getMipMapLevel() != mipmapLevel) ) {
+        // The whole stroke is stamped again at the new mipmap level instead of resampling the image
+        RectD rod = pointsBbox;
+        if (source) {
+            rod.merge( source->getRoD() );
+        }
+        rod.toPixelEnclosing(mipmapLevel, par, &dirty);
+        source.reset( new Image(components,
+                                rod,
+                                dirty,
+                                mipmapLevel,
+                                par,
+                                depth,
+                                premult,
+                                fielding,
+                                false) );
+        *image = source;
+    } else {
+        RectD mergeRoD = pointsBbox;
+        mergeRoD.merge( source->getRoD() );
+        source->setRoD(mergeRoD);
+        source->ensureBounds(pixelPointsBbox, true);
+        dirty = pixelPointsBbox;
+    }
+
+    RotoStrokeRasterizer::BrushParams params;
+    if ( !RotoContextPrivate::getStrokeBrushParams(this, time, mipmapLevel, &params) ) {
+        source->fillZero(dirty);
+
+        return distToNext;
+    }
+
+    std::vector<float> coverage;
+    {
+        QMutexLocker k(&_imp->accumulationMutex);
+        RectI previousTailBounds;
+        if (_imp->accumulation) {
+            previousTailBounds = _imp->accumulation->tailBounds;
+        }
+        bool reset;
+        RotoStrokeAccumulation* acc = updateAccumulation(params, time, mipmapLevel, &reset);
+        distToNext = acc->state.distToNext;
+
+        // The segments stamped as the tail of the stroke by the previous render were stamped in the canvas, possibly elsewhere
+        RectI bounds = source->getBounds();
+        if (reset) {
+            dirty = bounds;
+        } else if ( !previousTailBounds.isNull() ) {
+            dirty.merge(previousTailBounds);
+        }
+        RectI toRender;
+        if ( !dirty.intersect(bounds, &toRender) ) {
+            return distToNext;
+        }
+        dirty = toRender;
+
+        coverage.resize( (std::size_t)dirty.width() * dirty.height() );
+        acc->canvas.copyTo( dirty, &coverage.front(), dirty.width() );
+        acc->tailBounds = stampAccumulationTail( acc, &coverage.front(), dirty, dirty.width() );
+    }
+
+    //Never use invert while drawing
+    const bool inverted = false;
+    convertCoverageToNatronImage<float, 1>(&coverage.front(), dirty.width(), source.get(), dirty, shapeColor, 1., inverted);
+
+    return distToNext;
+} // RotoStrokeItem::renderSingleStroke
+
+#else // ROTO_RENDER_NATIVE_RASTERIZER
 double
 RotoStrokeItem::renderSingleStroke(const RectD& pointsBbox,
                                    const std::list<std::pair<Point, double> >& points,
@@ -2681,6 +2948,38 @@ RotoStrokeItem::renderSingleStroke(const RectD& pointsBbox,
     return distToNext;
 } // RotoStrokeItem::renderSingleStroke
 
+#endif // ROTO_RENDER_NATIVE_RASTERIZER
+
+void
+RotoStrokeItem::renderStrokeCoverage(const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                     double time,
+                                     unsigned int mipmapLevel,
+                                     const RectI& roi,
+                                     float* coverage,
+                                     std::size_t rowStride)
+{
+    RotoStrokeRasterizer::BrushParams params;
+
+    if ( RotoContextPrivate::getStrokeBrushParams(this, time, mipmapLevel, &params) ) {
+        boost::shared_ptr<KnobDouble> visiblePortionKnob = getBrushVisiblePortionKnob();
+        bool wholeStrokeVisible = (visiblePortionKnob->getValueAtTime(time, 0) == 0.) && (visiblePortionKnob->getValueAtTime(time, 1) == 1.);
+        Transform::Matrix3x3 transform;
+        getTransformAtTime(time, &transform);
+
+        QMutexLocker k(&_imp->accumulationMutex);
+        if ( wholeStrokeVisible && isAccumulationValid(params, transform, mipmapLevel) ) {
+            // The dabs stamped while painting are the ones of the whole stroke: only its last segments remain to stamp
+            RotoStrokeAccumulation* acc = _imp->accumulation.get();
+            acc->canvas.copyTo(roi, coverage, rowStride);
+            stampAccumulationTail(acc, coverage, roi, rowStride);
+
+            return;
+        }
+    }
+
+    RotoContextPrivate::renderStroke_native(this, strokes, time, mipmapLevel, roi, coverage, rowStride);
+}
+
 boost::shared_ptr<Image>
 RotoDrawableItem::renderMaskFromStroke(const ImageComponents& components,
                                        const double time,
@@ -2838,6 +3137,63 @@ RotoDrawableItem::renderMaskInternal(const RectI & roi,
     NodePtr node = getContext()->getNode();
     RotoStrokeItem* isStroke = dynamic_cast<RotoStrokeItem*>(this);
     Bezier* isBezier = dynamic_cast<Bezier*>(this);
+
+    double shapeColor[3];
+    getColor(time, shapeColor);
+
+    double opacity = getOpacity(time);
+
+#ifdef ROTO_RENDER_NATIVE_RASTERIZER
+    // The opacity of the strokes is in their dabs
+    bool isClosedBezier = isBezier && !isBezier->isOpenBezier();
+    double coverageOpacity = isBezier ? opacity : 1.;
+
+    // A single-channel float image receives the coverage directly in its rows, the others through a temporary buffer
+    if ( isClosedBezier && (depth == eImageBitDepthFloat) && (image->getComponentsCount() == 1) ) {
+        // getRowElements() locks the image for reading, which is not possible while it is locked for writing
+        std::size_t rowStride = image->getRowElements();
+        Image::WriteAccess acc = image->getWriteRights();
+        float* coverage = (float*)acc.pixelAt(roi.x1, roi.y1);
+        if (!coverage) {
+            return image;
+        }
+        RotoContextPrivate::renderBezier_native(isBezier, time, startTime, endTime, timeStep, mipmapLevel, roi, coverage, rowStride);
+        convertCoverageToNatronImage<float, 1>(coverage, rowStride, image.get(), roi, shapeColor, coverageOpacity, inverted);
+
+        return image;
+    }
+
+    std::vector<float> coverage( (std::size_t)roi.width() * roi.height() );
+    if ( coverage.empty() ) {
+        return image;
+    }
+    if (isClosedBezier) {
+        RotoContextPrivate::renderBezier_native(isBezier, time, startTime, endTime, timeStep, mipmapLevel, roi, &coverage.front(), roi.width());
+    } else if (isStroke) {
+        isStroke->renderStrokeCoverage(strokes, time, mipmapLevel, roi, &coverage.front(), roi.width());
+    } else {
+        RotoContextPrivate::renderStroke_native(this, strokes, time, mipmapLevel, roi, &coverage.front(), roi.width());
+    }
+    switch (depth) {
+    case eImageBitDepthFloat:
+        convertCoverageToNatronImage<float, 1>(&coverage.front(), roi.width(), image.get(), roi, shapeColor, coverageOpacity, inverted);
+        break;
+    case eImageBitDepthByte:
+        convertCoverageToNatronImage<unsigned char, 255>(&coverage.front(), roi.width(), image.get(), roi, shapeColor, coverageOpacity, inverted);
+        break;
+    case eImageBitDepthShort:
+        convertCoverageToNatronImage<unsigned short, 65535>(&coverage.front(), roi.width(), image.get(), roi, shapeColor, coverageOpacity, inverted);
+        break;
+    case eImageBitDepthHalf:
+        convertCoverageToNatronImage<Half, 1>(&coverage.front(), roi.width(), image.get(), roi, shapeColor, coverageOpacity, inverted);
+        break;
+    case eImageBitDepthNone:
+        assert(false);
+        break;
+    }
+
+    return image;
+#else // ROTO_RENDER_NATIVE_RASTERIZER
     cairo_format_t cairoImgFormat;
     int srcNComps;
     bool doBuildUp = true;
@@ -2861,11 +3217,6 @@ RotoDrawableItem::renderMaskInternal(const RectI & roi,
     }
 
 
-    double shapeColor[3];
-    getColor(time, shapeColor);
-
-    double opacity = getOpacity(time);
-
     ////Allocate the cairo temporary buffer
     CairoImageWrapper imgWrapper;
 
@@ -2919,6 +3270,8 @@ RotoDrawableItem::renderMaskInternal(const RectI & roi,
         convertCairoImageToNatronImage_noColor<unsigned short, 65535>(imgWrapper.cairoImg, srcNComps, image.get(), roi, shapeColor, opacity, inverted, useOpacityToConvert);
         break;
     case eImageBitDepthHalf:
+        convertCairoImageToNatronImage_noColor<Half, 1>(imgWrapper.cairoImg, srcNComps, image.get(), roi, shapeColor, opacity, inverted, useOpacityToConvert);
+        break;
     case eImageBitDepthNone:
         assert(false);
         break;
@@ -2932,6 +3285,7 @@ RotoDrawableItem::renderMaskInternal(const RectI & roi,
     cairo_surface_flush(imgWrapper.cairoImg);
 
     return image;
+#endif // ROTO_RENDER_NATIVE_RASTERIZER
 } // RotoDrawableItem::renderMaskInternal
 
 static inline
@@ -3256,13 +3610,9 @@ RotoContextPrivate::renderBezier(cairo_t* cr,
 
 
 #ifdef ROTO_RENDER_TRIANGLES_ONLY
-        std::list<RotoFeatherVertex> featherMesh;
-        std::list<RotoTriangleFans> internalFans;
-        std::list<RotoTriangles> internalTriangles;
-        std::list<RotoTriangleStrips> internalStrips;
-        computeTriangles(bezier, t, mipmapLevel, featherDist, &featherMesh, &internalFans, &internalTriangles, &internalStrips);
-        renderFeather_cairo(featherMesh, shapeColor, fallOff, mesh);
-        renderInternalShape_cairo(internalTriangles, internalFans, internalStrips, shapeColor, mesh);
+        RotoShapeGeometryConstPtr geometry = getShapeGeometry(bezier, t, mipmapLevel, true);
+        renderFeather_cairo(geometry->featherMesh, shapeColor, fallOff, mesh);
+        renderInternalShape_cairo(geometry->internalTriangles, geometry->internalFans, geometry->internalStrips, shapeColor, mesh);
         Q_UNUSED(opacity);
 #else
         renderFeather(bezier, t, mipmapLevel, shapeColor, opacity, featherDist, fallOff, mesh);
@@ -3279,6 +3629,150 @@ RotoContextPrivate::renderBezier(cairo_t* cr,
     }
 } // RotoContextPrivate::renderBezier
 
+void
+RotoContextPrivate::renderBezier_native(const Bezier* bezier,
+                                        double time,
+                                        double startTime, double endTime, double mbFrameStep,
+                                        unsigned int mipmapLevel,
+                                        const RectI& roi,
+                                        float* coverage,
+                                        std::size_t rowStride)
+{
+    for (int y = 0; y < roi.height(); ++y) {
+        std::fill(coverage + y * rowStride, coverage + y * rowStride + roi.width(), 0.f);
+    }
+
+    ///render the bezier only if finished (closed) and activated
+    if ( !bezier->isCurveFinished() || !bezier->isActivated(time) || ( bezier->getControlPointsCount() <= 1 ) ) {
+        return;
+    }
+
+    bool firstSample = true;
+    for (double t = startTime; t <= endTime; t+=mbFrameStep) {
+
+        RotoShapeGeometryConstPtr geometry = getShapeGeometry(bezier, t, mipmapLevel, false);
+        const std::list<std::list<ParametricPoint> >& bezierPolygon = geometry->bezierPolygon;
+        const std::list<RotoFeatherVertex>& featherMesh = geometry->featherMesh;
+
+        RotoRasterizer rasterizer( roi, bezier->getFeatherFallOff(t) );
+
+        // The discretized segments follow each other: the polygon is closed by joining the last point to the first one
+        const ParametricPoint* firstPoint = 0;
+        const ParametricPoint* prevPoint = 0;
+        for (std::list<std::list<ParametricPoint> >::const_iterator it = bezierPolygon.begin(); it != bezierPolygon.end(); ++it) {
+            for (std::list<ParametricPoint>::const_iterator it2 = it->begin(); it2 != it->end(); ++it2) {
+                if (prevPoint) {
+                    rasterizer.addEdge(prevPoint->x, prevPoint->y, it2->x, it2->y);
+                } else {
+                    firstPoint = &(*it2);
+                }
+                prevPoint = &(*it2);
+            }
+        }
+        if (firstPoint && prevPoint) {
+            rasterizer.addEdge(prevPoint->x, prevPoint->y, firstPoint->x, firstPoint->y);
+        }
+
+        // Each triangle of the feather has 1 or 2 vertices on the shape and the others on the outer border of the feather
+        assert(featherMesh.size() % 3 == 0);
+        std::list<RotoFeatherVertex>::const_iterator vIt = featherMesh.begin();
+        for (std::size_t i = featherMesh.size() / 3; i > 0; --i) {
+            Point p[3];
+            double d[3];
+            for (int j = 0; j < 3; ++j, ++vIt) {
+                p[j].x = vIt->x;
+                p[j].y = vIt->y;
+                d[j] = vIt->isInner ? 0. : 1.;
+            }
+            rasterizer.addFeatherTriangle(p[0], d[0], p[1], d[1], p[2], d[2]);
+        }
+
+        rasterizer.render(coverage, rowStride, !firstSample);
+        firstSample = false;
+    }
+} // RotoContextPrivate::renderBezier_native
+
+bool
+RotoContextPrivate::getStrokeBrushParams(const RotoDrawableItem* stroke,
+                                         double time,
+                                         unsigned int mipmapLevel,
+                                         RotoStrokeRasterizer::BrushParams* params)
+{
+    // Same as RotoContextPrivate::renderStroke
+    if ( !stroke->isActivated(time) ) {
+        return false;
+    }
+
+    double brushSpacing = stroke->getBrushSpacingKnob()->getValueAtTime(time);
+    if (brushSpacing == 0.) {
+        return false;
+    }
+
+    boost::shared_ptr<KnobDouble> visiblePortionKnob = stroke->getBrushVisiblePortionKnob();
+    double writeOnStart = visiblePortionKnob->getValueAtTime(time, 0);
+    double writeOnEnd = visiblePortionKnob->getValueAtTime(time, 1);
+    if ( (writeOnEnd - writeOnStart) <= 0. ) {
+        return false;
+    }
+
+    params->brushSizePixel = stroke->getBrushSizeKnob()->getValueAtTime(time);
+    if (mipmapLevel != 0) {
+        params->brushSizePixel = std::max( 1., params->brushSizePixel / (1 << mipmapLevel) );
+    }
+    params->brushHardness = stroke->getBrushHardnessKnob()->getValueAtTime(time);
+    params->brushSpacing = std::max(brushSpacing, 0.05);
+    params->opacity = stroke->getOpacity(time);
+    params->pressureAffectsOpacity = stroke->getPressureOpacityKnob()->getValueAtTime(time);
+    params->pressureAffectsSize = stroke->getPressureSizeKnob()->getValueAtTime(time);
+    params->pressureAffectsHardness = stroke->getPressureHardnessKnob()->getValueAtTime(time);
+
+    // Open Beziers are always built up, as in RotoDrawableItem::renderMaskInternal
+    params->buildUp = dynamic_cast<const RotoStrokeItem*>(stroke) ? stroke->getBuildupKnob()->getValueAtTime(time) : true;
+
+    return true;
+} // RotoContextPrivate::getStrokeBrushParams
+
+void
+RotoContextPrivate::renderStroke_native(const RotoDrawableItem* stroke,
+                                        const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                        double time,
+                                        unsigned int mipmapLevel,
+                                        const RectI& roi,
+                                        float* coverage,
+                                        std::size_t rowStride)
+{
+    for (int y = 0; y < roi.height(); ++y) {
+        std::fill(coverage + y * rowStride, coverage + y * rowStride + roi.width(), 0.f);
+    }
+
+    RotoStrokeRasterizer::BrushParams params;
+    if ( strokes.empty() || !getStrokeBrushParams(stroke, time, mipmapLevel, &params) ) {
+        return;
+    }
+
+    boost::shared_ptr<KnobDouble> visiblePortionKnob = stroke->getBrushVisiblePortionKnob();
+    double writeOnStart = visiblePortionKnob->getValueAtTime(time, 0);
+    double writeOnEnd = visiblePortionKnob->getValueAtTime(time, 1);
+
+    ///The visible portion of each stroke, as in renderStroke
+    std::list<std::list<std::pair<Point, double> > > visibleStrokes;
+    for (std::list<std::list<std::pair<Point, double> > >::const_iterator strokeIt = strokes.begin(); strokeIt != strokes.end(); ++strokeIt) {
+        int firstPoint = (int)std::floor( (strokeIt->size() * writeOnStart) );
+        int endPoint = (int)std::ceil( (strokeIt->size() * writeOnEnd) );
+        if (endPoint <= firstPoint) {
+            break;
+        }
+        std::list<std::pair<Point, double> >::const_iterator startingIt = strokeIt->begin();
+        std::list<std::pair<Point, double> >::const_iterator endingIt = strokeIt->begin();
+        std::advance(startingIt, firstPoint);
+        std::advance(endingIt, endPoint);
+        visibleStrokes.push_back( std::list<std::pair<Point, double> >(startingIt, endingIt) );
+    }
+
+    RotoStrokeRasterizer rasterizer(params);
+    rasterizer.stampStrokes(visibleStrokes, 0., coverage, roi, rowStride);
+} // RotoContextPrivate::renderStroke_native
+
 void
 RotoContextPrivate::renderFeather(const Bezier* bezier,
                                   double time,
@@ -3763,11 +4257,9 @@ static void tess_intersection_combine_callback(double coords[3], void */*data*/[
 }
 
 void
-RotoContextPrivate::computeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel, double featherDist,
-                                     std::list<RotoFeatherVertex>* featherMesh,
-                                     std::list<RotoTriangleFans>* internalFans,
-                                     std::list<RotoTriangles>* internalTriangles,
-                                     std::list<RotoTriangleStrips>* internalStrips)
+RotoContextPrivate::computeFeatherTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel, double featherDist,
+                                            std::list<RotoFeatherVertex>* featherMesh,
+                                            std::list<std::list<ParametricPoint> >* bezierPolygonOut)
 {
     ///Note that we do not use the opacity when rendering the bezier, it is rendered with correct floating point opacity/color when converting
     ///to the Natron image.
@@ -3777,7 +4269,7 @@ RotoContextPrivate::computeTriangles(const Bezier * bezier, double time, unsigne
     const double absFeatherDist = std::abs(featherDist);
 
     std::list<std::list<ParametricPoint> > featherPolygon;
-    std::list<std::list<ParametricPoint> > bezierPolygon;
+    std::list<std::list<ParametricPoint> >& bezierPolygon = *bezierPolygonOut;
 
     RectD featherPolyBBox;
     featherPolyBBox.setupInfinity();
@@ -3937,8 +4429,15 @@ RotoContextPrivate::computeTriangles(const Bezier * bezier, double time, unsigne
 
 
     } // for all points in polygon
+} // RotoContextPrivate::computeFeatherTriangles
 
-    // Now tesselate the internal bezier using glu
+void
+RotoContextPrivate::tessellateInternalShape(const std::list<std::list<ParametricPoint> >& bezierPolygon,
+                                            std::list<RotoTriangleFans>* internalFans,
+                                            std::list<RotoTriangles>* internalTriangles,
+                                            std::list<RotoTriangleStrips>* internalStrips)
+{
+    // Tesselate the internal bezier using glu
     tessPolygonData tessData;
     tessData.internalStrips = internalStrips;
     tessData.internalFans = internalFans;
@@ -3961,7 +4460,7 @@ RotoContextPrivate::computeTriangles(const Bezier * bezier, double time, unsigne
     for (std::list<std::list<ParametricPoint> >::const_iterator it = bezierPolygon.begin(); it != bezierPolygon.end(); ++it) {
         for (std::list<ParametricPoint>::const_iterator it2 = it->begin(); it2 != it->end(); ++it2) {
             double coords[3] = {it2->x, it2->y, 1.};
-            libtess_gluTessVertex(tesselator, coords, (void*)&(*it2) /*per-vertex client data*/);
+            libtess_gluTessVertex(tesselator, coords, (void*)const_cast<ParametricPoint*>(&(*it2)) /*per-vertex client data*/);
         }
     }
 
@@ -3973,7 +4472,189 @@ RotoContextPrivate::computeTriangles(const Bezier * bezier, double time, unsigne
     // check for errors
     assert(tessData.error == 0);
 
-} // RotoContextPrivate::computeFeatherTriangles
+} // RotoContextPrivate::tessellateInternalShape
+
+namespace {
+struct ShapeGeometryKey
+{
+    const Bezier* bezier;
+    double time;
+    unsigned int mipmapLevel;
+
+    bool operator<(const ShapeGeometryKey& other) const
+    {
+        if (bezier != other.bezier) {
+            return bezier < other.bezier;
+        }
+        if (time != other.time) {
+            return time < other.time;
+        }
+
+        return mipmapLevel < other.mipmapLevel;
+    }
+};
+
+typedef std::list<ShapeGeometryKey> ShapeGeometryLRU;
+
+struct ShapeGeometryEntry
+{
+    U64 hash;
+    RotoShapeGeometryConstPtr geometry;
+    std::size_t verticesCount;
+    ShapeGeometryLRU::iterator lruIt;
+};
+
+typedef std::map<ShapeGeometryKey, ShapeGeometryEntry> ShapeGeometryEntries;
+
+struct ShapeGeometryCache
+{
+    // Protects all the fields below
+    QMutex lock;
+    ShapeGeometryEntries entries;
+
+    // The least recently used entry first
+    ShapeGeometryLRU lru;
+    std::size_t verticesCount;
+
+    ShapeGeometryCache()
+        : lock()
+        , entries()
+        , lru()
+        , verticesCount(0)
+    {
+    }
+
+    // Must be called with lock held
+    void erase(ShapeGeometryEntries::iterator it)
+    {
+        verticesCount -= it->second.verticesCount;
+        lru.erase(it->second.lruIt);
+        entries.erase(it);
+    }
+};
+
+ShapeGeometryCache&
+shapeGeometryCache()
+{
+    static ShapeGeometryCache cache;
+
+    return cache;
+}
+
+std::size_t
+countVertices(const RotoShapeGeometry& geometry)
+{
+    std::size_t ret = geometry.featherMesh.size();
+
+    for (std::list<std::list<ParametricPoint> >::const_iterator it = geometry.bezierPolygon.begin(); it != geometry.bezierPolygon.end(); ++it) {
+        ret += it->size();
+    }
+    for (std::list<RotoTriangleFans>::const_iterator it = geometry.internalFans.begin(); it != geometry.internalFans.end(); ++it) {
+        ret += it->vertices.size();
+    }
+    for (std::list<RotoTriangles>::const_iterator it = geometry.internalTriangles.begin(); it != geometry.internalTriangles.end(); ++it) {
+        ret += it->vertices.size();
+    }
+    for (std::list<RotoTriangleStrips>::const_iterator it = geometry.internalStrips.begin(); it != geometry.internalStrips.end(); ++it) {
+        ret += it->vertices.size();
+    }
+
+    return ret;
+}
+}
+
+RotoShapeGeometryConstPtr
+RotoContextPrivate::getShapeGeometry(const Bezier* bezier,
+                                     double time,
+                                     unsigned int mipmapLevel,
+                                     bool withInternalTriangles)
+{
+    ShapeGeometryCache& cache = shapeGeometryCache();
+    ShapeGeometryKey key;
+
+    key.bezier = bezier;
+    key.time = time;
+    key.mipmapLevel = mipmapLevel;
+    U64 hash = bezier->computeGeometryHash(time, mipmapLevel);
+
+    {
+        QMutexLocker k(&cache.lock);
+        ShapeGeometryEntries::iterator found = cache.entries.find(key);
+        if ( ( found != cache.entries.end() ) && (found->second.hash == hash) &&
+             ( !withInternalTriangles || found->second.geometry->hasInternalTriangles ) ) {
+            cache.lru.splice(cache.lru.end(), cache.lru, found->second.lruIt);
+
+            return found->second.geometry;
+        }
+    }
+
+    // Tessellate without holding the lock: the threads rendering other shapes do not wait. If several threads render
+    // the same shape at the same time, they each compute it and the last one is kept.
+    double featherDist = bezier->getFeatherDistance(time);
+
+    ///Adjust the feather distance so it takes the mipmap level into account
+    if (mipmapLevel != 0) {
+        featherDist /= (1 << mipmapLevel);
+    }
+
+    boost::shared_ptr<RotoShapeGeometry> geometry(new RotoShapeGeometry);
+    computeFeatherTriangles(bezier, time, mipmapLevel, featherDist, &geometry->featherMesh, &geometry->bezierPolygon);
+    if (withInternalTriangles) {
+        tessellateInternalShape(geometry->bezierPolygon, &geometry->internalFans, &geometry->internalTriangles, &geometry->internalStrips);
+        geometry->hasInternalTriangles = true;
+    }
+
+    QMutexLocker k(&cache.lock);
+    ShapeGeometryEntries::iterator found = cache.entries.find(key);
+    if ( found != cache.entries.end() ) {
+        // The shape was edited, or the triangles were not computed
+        cache.erase(found);
+    }
+    ShapeGeometryEntry& entry = cache.entries[key];
+    entry.hash = hash;
+    entry.geometry = geometry;
+    entry.verticesCount = countVertices(*geometry);
+    entry.lruIt = cache.lru.insert(cache.lru.end(), key);
+    cache.verticesCount += entry.verticesCount;
+
+    // Evict the least recently used tessellations, but always keep the one just computed
+    while ( (cache.verticesCount > NATRON_ROTO_GEOMETRY_CACHE_MAX_VERTICES) && (cache.entries.size() > 1) ) {
+        cache.erase( cache.entries.find( cache.lru.front() ) );
+    }
+
+    return geometry;
+} // RotoContextPrivate::getShapeGeometry
+
+void
+RotoContextPrivate::removeShapeGeometries(const Bezier* bezier)
+{
+    ShapeGeometryCache& cache = shapeGeometryCache();
+    ShapeGeometryKey key;
+
+    key.bezier = bezier;
+    key.time = -std::numeric_limits<double>::infinity();
+    key.mipmapLevel = 0;
+
+    QMutexLocker k(&cache.lock);
+    ShapeGeometryEntries::iterator it = cache.entries.lower_bound(key);
+    while ( ( it != cache.entries.end() ) && (it->first.bezier == bezier) ) {
+        ShapeGeometryEntries::iterator next = it;
+        ++next;
+        cache.erase(it);
+        it = next;
+    }
+}
+
+void
+RotoContextPrivate::getShapeGeometryCacheInfos(std::size_t* nbEntries,
+                                               std::size_t* verticesCount)
+{
+    ShapeGeometryCache& cache = shapeGeometryCache();
+    QMutexLocker k(&cache.lock);
+
+    *nbEntries = cache.entries.size();
+    *verticesCount = cache.verticesCount;
+}
 
 void
 RotoContextPrivate::renderInternalShape_cairo(const std::list<RotoTriangles>& triangles,
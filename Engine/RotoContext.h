@@ -210,6 +210,17 @@ public:
                                      double* endTime,
                                      double* timeStep) const;
 
+    /**
+     * @brief Renders concurrently the masks of the given items whose bounding box intersects the roi (in canonical coordinates),
+     * so that the nodes of the RotoPaint tree find them in the cache instead of rendering them one after another
+     * while compositing. Inverted items and items of a paint stroke being drawn are left to their node.
+     **/
+    void renderShapesMasks(const std::list<boost::shared_ptr<RotoDrawableItem> >& items,
+                           double time,
+                           ViewIdx view,
+                           unsigned int mipmapLevel,
+                           const RectD& roi) const;
+
 private:
 
 
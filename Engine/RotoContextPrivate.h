@@ -36,6 +36,7 @@
 #include <stdexcept>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 #endif
@@ -56,6 +57,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Global/GlobalDefines.h"
 
 #include "Engine/AppManager.h"
+#include "Engine/Bezier.h"
 #include "Engine/BezierCP.h"
 #include "Engine/Curve.h"
 #include "Engine/EffectInstance.h"
@@ -65,6 +67,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/Node.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoPaint.h"
+#include "Engine/RotoStrokeRasterizer.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
@@ -381,6 +384,35 @@ struct RotoTriangles
     std::list<Point> vertices;
 };
 
+/**
+ * @brief The tessellation of a Bezier at a given time and mipmap level, shared by all the renders of the shape
+ * (see RotoContextPrivate::getShapeGeometry).
+ **/
+struct RotoShapeGeometry
+{
+    // The discretized segments of the Bezier
+    std::list<std::list<ParametricPoint> > bezierPolygon;
+    std::list<RotoFeatherVertex> featherMesh;
+
+    // The triangles of the inside of the shape, only computed when requested
+    bool hasInternalTriangles;
+    std::list<RotoTriangleFans> internalFans;
+    std::list<RotoTriangles> internalTriangles;
+    std::list<RotoTriangleStrips> internalStrips;
+
+    RotoShapeGeometry()
+        : bezierPolygon()
+        , featherMesh()
+        , hasInternalTriangles(false)
+        , internalFans()
+        , internalTriangles()
+        , internalStrips()
+    {
+    }
+};
+
+typedef boost::shared_ptr<const RotoShapeGeometry> RotoShapeGeometryConstPtr;
+
 struct BezierPrivate
 {
     BezierCPs points; //< the control points of the curve
@@ -1230,6 +1262,64 @@ public:
     }
 };
 
+/**
+ * @brief Where the stamping of the dabs of a stroke stopped: the next segment starts at a keyframe of one of its strokes,
+ * and its polyline continues the one of the previous segment.
+ **/
+struct RotoStrokeStampState
+{
+    int strokeIndex;
+    int keyframeIndex;
+
+    // The last point of the polyline stamped so far in the stroke, if any
+    bool hasLastPoint;
+    std::pair<Point, double> lastPoint;
+    double distToNext;
+
+    RotoStrokeStampState()
+        : strokeIndex(0)
+        , keyframeIndex(0)
+        , hasLastPoint(false)
+        , lastPoint()
+        , distToNext(0.)
+    {
+    }
+};
+
+/**
+ * @brief The dabs of a stroke stamped while it is painted, so that each render of the stroke only stamps its new points.
+ *
+ * A segment of the stroke is interpolated with the Catmull-Rom tangents of its keyframes, which depend on the next keyframe:
+ * the canvas only holds the segments that the next points can no longer change, and the last segment of the stroke
+ * being painted is stamped at each render over a copy of the canvas. The canvas is thus exactly what rendering these
+ * segments at once gives, and the neat render at the end of the stroke only has to stamp its last segment.
+ **/
+struct RotoStrokeAccumulation
+{
+    boost::scoped_ptr<RotoStrokeRasterizer> rasterizer;
+    Transform::Matrix3x3 transform;
+    unsigned int mipmapLevel;
+    RotoStrokeCanvas canvas;
+
+    // The x curve of each stroke stamped so far, to detect a stroke that was removed or replaced
+    std::vector<boost::shared_ptr<Curve> > curves;
+    RotoStrokeStampState state;
+
+    // The pixels where the last render stamped the segments that were not final, over a copy of the canvas
+    RectI tailBounds;
+
+    RotoStrokeAccumulation()
+        : rasterizer()
+        , transform()
+        , mipmapLevel(0)
+        , canvas()
+        , curves()
+        , state()
+        , tailBounds()
+    {
+    }
+};
+
 struct RotoStrokeItemPrivate
 {
     RotoStrokeType type;
@@ -1250,6 +1340,12 @@ struct RotoStrokeItemPrivate
     mutable QMutex strokeDotPatternsMutex;
     std::vector<cairo_pattern_t*> strokeDotPatterns;
 
+    // Protects accumulation
+    mutable QMutex accumulationMutex;
+
+    // The dabs stamped while the stroke is painted, released when it is finished
+    boost::scoped_ptr<RotoStrokeAccumulation> accumulation;
+
     RotoStrokeItemPrivate(RotoStrokeType type)
         : type(type)
         , finished(false)
@@ -1260,6 +1356,8 @@ struct RotoStrokeItemPrivate
         , wholeStrokeBboxWhilePainting()
         , strokeDotPatternsMutex()
         , strokeDotPatterns()
+        , accumulationMutex()
+        , accumulation()
     {
         bbox.x1 = std::numeric_limits<double>::infinity();
         bbox.x2 = -std::numeric_limits<double>::infinity();
@@ -2194,7 +2292,44 @@ public:
                                           const std::list<RotoTriangleFans>& fans,
                                           const std::list<RotoTriangleStrips>& strips,
                                           double shapeColor[3],  cairo_pattern_t * mesh);
-    static void computeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel,  double featherDist, std::list<RotoFeatherVertex>* featherMesh, std::list<RotoTriangleFans>* internalFans, std::list<RotoTriangles>* internalTriangles,std::list<RotoTriangleStrips>* internalStrips);
+    static void computeFeatherTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel,  double featherDist, std::list<RotoFeatherVertex>* featherMesh, std::list<std::list<ParametricPoint> >* bezierPolygon);
+    static void tessellateInternalShape(const std::list<std::list<ParametricPoint> >& bezierPolygon, std::list<RotoTriangleFans>* internalFans, std::list<RotoTriangles>* internalTriangles,std::list<RotoTriangleStrips>* internalStrips);
+
+    /**
+     * @brief Returns the tessellation of the Bezier at the given time and mipmap level, computing it only if the shape
+     * changed since the last call for the same time and mipmap level (see Bezier::computeGeometryHash).
+     * The tiles of a frame, the renders of the viewer when it pans and the frames where the shape does not move thus share
+     * one tessellation. MT-safe.
+     **/
+    static RotoShapeGeometryConstPtr getShapeGeometry(const Bezier* bezier, double time, unsigned int mipmapLevel, bool withInternalTriangles);
+
+    /**
+     * @brief Forgets the tessellations of the Bezier, called when it is destroyed.
+     **/
+    static void removeShapeGeometries(const Bezier* bezier);
+
+    /**
+     * @brief Returns the number of tessellations kept by getShapeGeometry and their total number of vertices. MT-safe.
+     **/
+    static void getShapeGeometryCacheInfos(std::size_t* nbEntries, std::size_t* verticesCount);
+
+    /**
+     * @brief Same as renderBezier but computes the coverage of the shape with a RotoRasterizer instead of cairo.
+     * coverage is the pixel at the bottom-left corner of the roi and rowStride the number of floats between two rows.
+     **/
+    static void renderBezier_native(const Bezier* bezier, double time, double startTime, double endTime, double mbFrameStep, unsigned int mipmapLevel, const RectI& roi, float* coverage, std::size_t rowStride);
+
+    /**
+     * @brief Returns in params the brush of the stroke at the given time and mipmap level, as used by renderStroke, or false
+     * if the stroke is not rendered at that time.
+     **/
+    static bool getStrokeBrushParams(const RotoDrawableItem* stroke, double time, unsigned int mipmapLevel, RotoStrokeRasterizer::BrushParams* params);
+
+    /**
+     * @brief Same as renderStroke but stamps the dabs with a RotoStrokeRasterizer instead of cairo, with the same arguments
+     * as renderBezier_native.
+     **/
+    static void renderStroke_native(const RotoDrawableItem* stroke, const std::list<std::list<std::pair<Point, double> > >& strokes, double time, unsigned int mipmapLevel, const RectI& roi, float* coverage, std::size_t rowStride);
     static void renderInternalShape(double time, unsigned int mipmapLevel, double shapeColor[3], double opacity, const Transform::Matrix3x3 & transform, cairo_t * cr, cairo_pattern_t * mesh, const BezierCPs &cps);
     static void bezulate(double time, const BezierCPs& cps, std::list<BezierCPs>* patches);
     static void applyAndDestroyMask(cairo_t* cr, cairo_pattern_t* mesh);
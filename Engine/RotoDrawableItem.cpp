@@ -656,6 +656,7 @@ RotoDrawableItem::incrementNodesAge()
     if ( getContext()->getNode()->getApp()->getProject()->isLoadingProject() ) {
         return;
     }
+    NodesHashBatch_RAII hashBatch( getContext()->getNode()->getApp() );
     if (_imp->effectNode) {
         _imp->effectNode->incrementKnobsAge();
     }
@@ -29,6 +29,7 @@
 #include <stdexcept>
 
 #include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
 #include "Engine/Image.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
@@ -43,6 +44,7 @@
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/RotoPoint.h"
 #include "Engine/RotoUndoCommand.h"
+#include "Engine/Settings.h"
 #include "Engine/RotoPaintInteract.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Transform.h"
@@ -1484,6 +1486,13 @@ RotoPaint::render(const RenderActionArgs& args)
                                     this,
                                     eStorageModeRAM /*returnOpenGLtex*/,
                                     args.time);
+        if ( appPTR->getCurrentSettings()->isParallelRotoShapesRenderEnabled() ) {
+            // Render the masks of the shapes concurrently before the tree composites them in order
+            RectD canonicalRoI;
+            args.roi.toCanonical_noClipping( mipMapLevel, getAspectRatio(-1), &canonicalRoI );
+            roto->renderShapesMasks(items, args.time, args.view, mipMapLevel, canonicalRoI);
+        }
+
         std::map<ImageComponents, ImagePtr> rotoPaintImages;
         RenderRoIRetCode code = bottomMerge->getEffectInstance()->renderRoI(rotoPaintArgs, &rotoPaintImages);
         if (code == eRenderRoIRetCodeFailed) {
@@ -0,0 +1,352 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RotoRasterizer.h"
+
+#include <algorithm> // min, max, swap
+#include <cassert>
+#include <cmath>
+
+// Number of entries of the table of the feather fall-off
+#define ROTO_RASTERIZER_FALLOFF_LUT_SIZE 1024
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+/*
+ * Position along the side of the cairo mesh patch going from the shape (0) to the outer border of the feather (1), for the
+ * parameter u of the patch, whose color goes from 1 to 0. The control points are those of RotoContextPrivate::renderFeather.
+ */
+double
+fallOffCurve(double u,
+             double c1,
+             double c2)
+{
+    double v = 1. - u;
+
+    return 3. * u * v * v * c1 + 3. * u * u * v * c2 + u * u * u;
+}
+}
+
+RotoRasterizer::RotoRasterizer(const RectI& roi,
+                               double featherFallOff)
+    : _roi(roi)
+    , _width( std::max(0, roi.width() ) )
+    , _height( std::max(0, roi.height() ) )
+    , _accumulation( (std::size_t)(_width + 2) * _height, 0.f )
+    , _feather()
+    , _fallOffLut()
+{
+    if ( (featherFallOff > 0) && (featherFallOff != 1.) ) {
+        double fallOffInverse = 1. / featherFallOff;
+        double c1 = fallOffInverse / (featherFallOff * 2. + fallOffInverse);
+        double c2 = 2. * fallOffInverse / (featherFallOff + 2. * fallOffInverse);
+
+        // 0 < c1 < c2 < 1, so the curve is increasing and can be inverted by bisection
+        _fallOffLut.resize(ROTO_RASTERIZER_FALLOFF_LUT_SIZE);
+        for (int i = 0; i < ROTO_RASTERIZER_FALLOFF_LUT_SIZE; ++i) {
+            double d = (double)i / (ROTO_RASTERIZER_FALLOFF_LUT_SIZE - 1);
+            double low = 0., high = 1.;
+            for (int j = 0; j < 30; ++j) {
+                double mid = (low + high) / 2.;
+                if (fallOffCurve(mid, c1, c2) < d) {
+                    low = mid;
+                } else {
+                    high = mid;
+                }
+            }
+            _fallOffLut[i] = (float)( 1. - (low + high) / 2. );
+        }
+    }
+}
+
+RotoRasterizer::~RotoRasterizer()
+{
+}
+
+void
+RotoRasterizer::addEdge(double x0,
+                        double y0,
+                        double x1,
+                        double y1)
+{
+    if ( (y0 == y1) || (_width == 0) || (_height == 0) ) {
+        return;
+    }
+
+    // Work in coordinates relative to the roi, from top to bottom
+    float dir = 1.f;
+    x0 -= _roi.x1;
+    x1 -= _roi.x1;
+    y0 -= _roi.y1;
+    y1 -= _roi.y1;
+    if (y0 > y1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+        dir = -1.f;
+    }
+    if ( (y1 <= 0) || (y0 >= _height) ) {
+        return;
+    }
+
+    // The parts above and below the roi do not cover any of its rows
+    double dxdy = (x1 - x0) / (y1 - y0);
+    if (y0 < 0) {
+        x0 -= y0 * dxdy;
+        y0 = 0;
+    }
+    if (y1 > _height) {
+        x1 -= (y1 - _height) * dxdy;
+        y1 = _height;
+    }
+
+    // The parts left and right of the roi are moved onto its borders: on the left they still cover the whole rows,
+    // on the right they do not cover any pixel
+    double ts[4] = {0., 0., 0., 1.};
+    int nTs = 1;
+    if (x0 != x1) {
+        double tLeft = (0. - x0) / (x1 - x0);
+        double tRight = (_width - x0) / (x1 - x0);
+        if ( (tLeft > 0.) && (tLeft < 1.) ) {
+            ts[nTs++] = tLeft;
+        }
+        if ( (tRight > 0.) && (tRight < 1.) ) {
+            ts[nTs++] = tRight;
+        }
+        if ( (nTs == 3) && (ts[1] > ts[2]) ) {
+            std::swap(ts[1], ts[2]);
+        }
+    }
+    ts[nTs] = 1.;
+
+    double prevX = x0, prevY = y0;
+    for (int i = 1; i <= nTs; ++i) {
+        double x = (i == nTs) ? x1 : x0 + ts[i] * (x1 - x0);
+        double y = (i == nTs) ? y1 : y0 + ts[i] * (y1 - y0);
+        accumulateLine( (float)std::min(std::max(prevX, 0.), (double)_width), (float)prevY,
+                        (float)std::min(std::max(x, 0.), (double)_width), (float)y, dir );
+        prevX = x;
+        prevY = y;
+    }
+} // RotoRasterizer::addEdge
+
+void
+RotoRasterizer::accumulateLine(float x0,
+                               float y0,
+                               float x1,
+                               float y1,
+                               float dir)
+{
+    // y0 <= y1, and the line is within the roi: 0 <= x <= width, 0 <= y <= height
+    if (y0 >= y1) {
+        return;
+    }
+
+    const std::size_t stride = _width + 2;
+    const float dxdy = (x1 - x0) / (y1 - y0);
+    float x = x0;
+    int yEnd = std::min( _height, (int)std::ceil(y1) );
+
+    for (int y = (int)y0; y < yEnd; ++y) {
+        float* row = &_accumulation[y * stride];
+        // The height of the part of the line in this row
+        float dy = std::min( (float)(y + 1), y1 ) - std::max( (float)y, y0 );
+        float xNext = x + dxdy * dy;
+        float d = dy * dir;
+        float xLeft = std::min(x, xNext);
+        float xRight = std::max(x, xNext);
+        float xLeftFloor = std::floor(xLeft);
+        int xLeftI = (int)xLeftFloor;
+        float xRightCeil = std::ceil(xRight);
+        int xRightI = (int)xRightCeil;
+
+        if (xRightI <= xLeftI + 1) {
+            // The line crosses a single pixel: it covers the part of the pixel on its right
+            float xMid = 0.5f * (x + xNext) - xLeftFloor;
+            row[xLeftI] += d - d * xMid;
+            row[xLeftI + 1] += d * xMid;
+        } else {
+            // Spread the area of the trapezoids cut by the line in each pixel it crosses
+            float s = 1.f / (xRight - xLeft);
+            float xLeftFrac = xLeft - xLeftFloor;
+            float a0 = 0.5f * s * (1.f - xLeftFrac) * (1.f - xLeftFrac);
+            float xRightFrac = xRight - xRightCeil + 1.f;
+            float am = 0.5f * s * xRightFrac * xRightFrac;
+            row[xLeftI] += d * a0;
+            if (xRightI == xLeftI + 2) {
+                row[xLeftI + 1] += d * (1.f - a0 - am);
+            } else {
+                float a1 = s * (1.5f - xLeftFrac);
+                row[xLeftI + 1] += d * (a1 - a0);
+                for (int xi = xLeftI + 2; xi < xRightI - 1; ++xi) {
+                    row[xi] += d * s;
+                }
+                float a2 = a1 + (xRightI - xLeftI - 3) * s;
+                row[xRightI - 1] += d * (1.f - a2 - am);
+            }
+            row[xRightI] += d * am;
+        }
+        x = xNext;
+    }
+} // RotoRasterizer::accumulateLine
+
+float
+RotoRasterizer::getFeatherCoverage(float d) const
+{
+    d = std::min(std::max(d, 0.f), 1.f);
+    if ( _fallOffLut.empty() ) {
+        return 1.f - d;
+    }
+    float pos = d * (ROTO_RASTERIZER_FALLOFF_LUT_SIZE - 1);
+    int i = std::min( (int)pos, ROTO_RASTERIZER_FALLOFF_LUT_SIZE - 2 );
+    float frac = pos - i;
+
+    return _fallOffLut[i] + (_fallOffLut[i + 1] - _fallOffLut[i]) * frac;
+}
+
+void
+RotoRasterizer::addFeatherTriangle(const Point& p0,
+                                   double d0,
+                                   const Point& p1,
+                                   double d1,
+                                   const Point& p2,
+                                   double d2)
+{
+    if ( (_width == 0) || (_height == 0) ) {
+        return;
+    }
+
+    // Vertices relative to the roi, sorted from top to bottom
+    double x[3] = {p0.x - _roi.x1, p1.x - _roi.x1, p2.x - _roi.x1};
+    double y[3] = {p0.y - _roi.y1, p1.y - _roi.y1, p2.y - _roi.y1};
+    double d[3] = {d0, d1, d2};
+
+    // The fraction of the feather distance is a plane: d = a * x + b * y + c
+    double det = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (det == 0) {
+        return;
+    }
+    double a = ( (d[1] - d[0]) * (y[2] - y[0]) - (d[2] - d[0]) * (y[1] - y[0]) ) / det;
+    double b = ( (x[1] - x[0]) * (d[2] - d[0]) - (x[2] - x[0]) * (d[1] - d[0]) ) / det;
+    double c = d[0] - a * x[0] - b * y[0];
+
+    if (y[0] > y[1]) {
+        std::swap(x[0], x[1]);
+        std::swap(y[0], y[1]);
+    }
+    if (y[1] > y[2]) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+    }
+    if (y[0] > y[1]) {
+        std::swap(x[0], x[1]);
+        std::swap(y[0], y[1]);
+    }
+
+    // Rows whose center is inside the triangle
+    int yBegin = std::max( 0, (int)std::ceil(y[0] - 0.5) );
+    int yEnd = std::min( _height, (int)std::ceil(y[2] - 0.5) );
+    if ( (yBegin >= yEnd) || (std::max(x[0], std::max(x[1], x[2])) <= 0) || (std::min(x[0], std::min(x[1], x[2])) >= _width) ) {
+        return;
+    }
+
+    if ( _feather.empty() ) {
+        _feather.resize( (std::size_t)_width * _height, 0.f );
+    }
+
+    const bool linear = _fallOffLut.empty();
+    for (int py = yBegin; py < yEnd; ++py) {
+        double yc = py + 0.5;
+        // Intersect the row with the long edge and with the short edge on the same side of the middle vertex
+        double xLong = x[0] + (x[2] - x[0]) * (yc - y[0]) / (y[2] - y[0]);
+        double xShort;
+        if (yc < y[1]) {
+            xShort = x[0] + (x[1] - x[0]) * (yc - y[0]) / (y[1] - y[0]);
+        } else {
+            xShort = (y[2] == y[1]) ? x[1] : x[1] + (x[2] - x[1]) * (yc - y[1]) / (y[2] - y[1]);
+        }
+        // Pixels whose center is inside the span
+        int xBegin = std::max( 0, (int)std::ceil(std::min(xLong, xShort) - 0.5) );
+        int xEnd = std::min( _width, (int)std::ceil(std::max(xLong, xShort) - 0.5) );
+        if (xBegin >= xEnd) {
+            continue;
+        }
+
+        float* dst = &_feather[(std::size_t)py * _width + xBegin];
+        const float dStart = (float)(a * (xBegin + 0.5) + b * yc + c);
+        const float dStep = (float)a;
+        const int n = xEnd - xBegin;
+        if (linear) {
+            // Kept free of calls and branches so that the compiler vectorizes it
+            for (int i = 0; i < n; ++i) {
+                float v = 1.f - (dStart + dStep * i);
+                v = std::min(std::max(v, 0.f), 1.f);
+                dst[i] = std::max(dst[i], v);
+            }
+        } else {
+            for (int i = 0; i < n; ++i) {
+                dst[i] = std::max( dst[i], getFeatherCoverage(dStart + dStep * i) );
+            }
+        }
+    }
+} // RotoRasterizer::addFeatherTriangle
+
+void
+RotoRasterizer::render(float* dst,
+                       std::size_t rowStride,
+                       bool over) const
+{
+    const std::size_t stride = _width + 2;
+    std::vector<float> coverage(_width);
+
+    for (int y = 0; y < _height; ++y, dst += rowStride) {
+        // The sum of the signed areas from the left is the winding number of the pixel, weighted by its coverage
+        const float* acc = &_accumulation[y * stride];
+        float sum = 0.f;
+        for (int x = 0; x < _width; ++x) {
+            sum += acc[x];
+            coverage[x] = std::min(std::abs(sum), 1.f);
+        }
+
+        // The loops below are kept free of calls and branches so that the compiler vectorizes them
+        float* cov = coverage.empty() ? 0 : &coverage[0];
+        if ( !_feather.empty() ) {
+            const float* feather = &_feather[(std::size_t)y * _width];
+            for (int x = 0; x < _width; ++x) {
+                cov[x] = std::max(cov[x], feather[x]);
+            }
+        }
+        if (over) {
+            for (int x = 0; x < _width; ++x) {
+                dst[x] = dst[x] + cov[x] - dst[x] * cov[x];
+            }
+        } else {
+            for (int x = 0; x < _width; ++x) {
+                dst[x] = cov[x];
+            }
+        }
+    }
+} // RotoRasterizer::render
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,113 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_ROTORASTERIZER_H
+#define NATRON_ENGINE_ROTORASTERIZER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/RectI.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Computes the coverage of a Roto shape and of its feather over a rectangle of pixels, without cairo.
+ *
+ * The shape is given by the edges of its closed contours and is filled with the non-zero winding rule. The area of each pixel
+ * covered by the shape is computed exactly from the edges (analytic antialiasing), by accumulating in each row the signed
+ * area of the edges and summing it from left to right.
+ *
+ * The feather is given by triangles with, at each vertex, the fraction of the feather distance: 0 on the shape and 1 at the
+ * outer border of the feather. It is interpolated inside the triangles and converted to a coverage with the same fall-off
+ * curve as the cairo mesh patterns used by RotoContextPrivate::renderFeather.
+ *
+ * Only the rectangle is rasterized: the parts of the edges and triangles outside of it are clipped, so that a tile of a large
+ * shape costs in proportion of the tile size. Not MT-safe: each render uses its own rasterizer.
+ **/
+class RotoRasterizer
+{
+public:
+
+    /**
+     * @param roi The rectangle of pixels to rasterize, in the same coordinates as the edges and triangles
+     * @param featherFallOff The fall-off of the feather, as returned by Bezier::getFeatherFallOff
+     **/
+    RotoRasterizer(const RectI& roi,
+                   double featherFallOff);
+
+    ~RotoRasterizer();
+
+    const RectI& getRoI() const
+    {
+        return _roi;
+    }
+
+    /**
+     * @brief Adds an edge of a closed contour of the shape. The contours must be closed, i.e. their last edge ends at the
+     * start of their first edge, but their edges may be added in any order.
+     **/
+    void addEdge(double x0, double y0, double x1, double y1);
+
+    /**
+     * @brief Adds a triangle of the feather. d0, d1 and d2 are the fractions of the feather distance at each vertex, between 0 and 1.
+     **/
+    void addFeatherTriangle(const Point& p0, double d0,
+                            const Point& p1, double d1,
+                            const Point& p2, double d2);
+
+    /**
+     * @brief Writes the coverage of the shape and its feather, between 0 and 1, to the given rows. dst is the pixel at the
+     * bottom-left corner of the roi and rowStride the number of floats between two rows.
+     * If over is true, the coverage is composited over the values already in dst instead of replacing them, as done
+     * for the samples of the motion-blur.
+     **/
+    void render(float* dst, std::size_t rowStride, bool over) const;
+
+private:
+
+    void accumulateLine(float x0, float y0, float x1, float y1, float dir);
+
+    float getFeatherCoverage(float d) const;
+
+    RectI _roi;
+    int _width, _height;
+
+    // Signed area of the edges in each pixel, in rows of _width + 2 elements
+    std::vector<float> _accumulation;
+
+    // Coverage of the feather, allocated by the first feather triangle
+    std::vector<float> _feather;
+
+    // Maps the fraction of the feather distance to its coverage, empty for a linear fall-off
+    std::vector<float> _fallOffLut;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_ROTORASTERIZER_H
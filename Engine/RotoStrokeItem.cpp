@@ -292,6 +292,11 @@ RotoStrokeItem::setStrokeFinished()
         }
         _imp->strokeDotPatterns.clear();
     }
+    {
+        // The neat render of the stroke is done, the dabs are not needed anymore
+        QMutexLocker k(&_imp->accumulationMutex);
+        _imp->accumulation.reset();
+    }
 
     resetTransformCenter();
 
@@ -299,20 +304,22 @@ RotoStrokeItem::setStrokeFinished()
     NodePtr mergeNode = getMergeNode();
     NodePtr timeOffsetNode = getTimeOffsetNode();
     NodePtr frameHoldNode = getFrameHoldNode();
-
-    if (effectNode) {
-        effectNode->setWhileCreatingPaintStroke(false);
-        effectNode->incrementKnobsAge();
-    }
-    mergeNode->setWhileCreatingPaintStroke(false);
-    mergeNode->incrementKnobsAge();
-    if (timeOffsetNode) {
-        timeOffsetNode->setWhileCreatingPaintStroke(false);
-        timeOffsetNode->incrementKnobsAge();
-    }
-    if (frameHoldNode) {
-        frameHoldNode->setWhileCreatingPaintStroke(false);
-        frameHoldNode->incrementKnobsAge();
+    {
+        NodesHashBatch_RAII hashBatch( getContext()->getNode()->getApp() );
+        if (effectNode) {
+            effectNode->setWhileCreatingPaintStroke(false);
+            effectNode->incrementKnobsAge();
+        }
+        mergeNode->setWhileCreatingPaintStroke(false);
+        mergeNode->incrementKnobsAge();
+        if (timeOffsetNode) {
+            timeOffsetNode->setWhileCreatingPaintStroke(false);
+            timeOffsetNode->incrementKnobsAge();
+        }
+        if (frameHoldNode) {
+            frameHoldNode->setWhileCreatingPaintStroke(false);
+            frameHoldNode->incrementKnobsAge();
+        }
     }
 
     getContext()->setWhileCreatingPaintStrokeOnMergeNodes(false);
@@ -640,6 +647,26 @@ RotoStrokeItem::getMostRecentStrokeChangesSinceAge(double time,
     bool pressureSize = getPressureSizeKnob()->getValue();
     evaluateStrokeInternal(realX, realY, realP, transform, 0, halfBrushSize, pressureSize, points, pointsBbox);
 
+    if (lastAge > 0) {
+        // The tangent of the previous keyframe changed with the new ones: the segment ending at it is rendered again
+        KeyFrameSet prevX, prevY, prevP;
+        KeyFrameSet::iterator prevXIt = xCurve.begin();
+        KeyFrameSet::iterator prevYIt = yCurve.begin();
+        KeyFrameSet::iterator prevPIt = pCurve.begin();
+        std::advance(prevXIt, lastAge - 1);
+        std::advance(prevYIt, lastAge - 1);
+        std::advance(prevPIt, lastAge - 1);
+        for (int i = 0; i < 2; ++i, ++prevXIt, ++prevYIt, ++prevPIt) {
+            prevX.insert(*prevXIt);
+            prevY.insert(*prevYIt);
+            prevP.insert(*prevPIt);
+        }
+        std::list<std::pair<Point, double> > prevPoints;
+        RectD prevBbox;
+        evaluateStrokeInternal(prevX, prevY, prevP, transform, 0, halfBrushSize, pressureSize, &prevPoints, &prevBbox);
+        pointsBbox->merge(prevBbox);
+    }
+
     if ( !wholeStrokeBbox->isNull() ) {
         wholeStrokeBbox->merge(*pointsBbox);
     } else {
@@ -932,5 +959,171 @@ RotoStrokeItem::evaluateStroke(unsigned int mipMapLevel,
     }
 }
 
-NATRON_NAMESPACE_EXIT;
+bool
+RotoStrokeItem::isAccumulationValid(const RotoStrokeRasterizer::BrushParams& params,
+                                    const Transform::Matrix3x3& transform,
+                                    unsigned int mipmapLevel) const
+{
+    assert( !_imp->accumulationMutex.tryLock() );
+
+    const RotoStrokeAccumulation* acc = _imp->accumulation.get();
+    if ( !acc || !acc->rasterizer || (acc->mipmapLevel != mipmapLevel) || (acc->rasterizer->getParams() != params) ) {
+        return false;
+    }
+
+    const Transform::Matrix3x3& m = acc->transform;
+    if ( (m.a != transform.a) || (m.b != transform.b) || (m.c != transform.c) ||
+         (m.d != transform.d) || (m.e != transform.e) || (m.f != transform.f) ||
+         (m.g != transform.g) || (m.h != transform.h) || (m.i != transform.i) ) {
+        return false;
+    }
+
+    // The strokes stamped so far must still be there, with at least the keyframes stamped
+    QMutexLocker k(&itemMutex);
+    if ( acc->curves.size() > _imp->strokes.size() ) {
+        return false;
+    }
+    for (std::size_t i = 0; i < acc->curves.size(); ++i) {
+        if (acc->curves[i] != _imp->strokes[i].xCurve) {
+            return false;
+        }
+    }
+    if ( ( acc->state.strokeIndex < (int)_imp->strokes.size() ) &&
+         ( _imp->strokes[acc->state.strokeIndex].xCurve->getKeyFramesCount() <= acc->state.keyframeIndex ) ) {
+        return false;
+    }
+
+    return true;
+}
+
+RotoStrokeAccumulation*
+RotoStrokeItem::updateAccumulation(const RotoStrokeRasterizer::BrushParams& params,
+                                   double time,
+                                   unsigned int mipmapLevel,
+                                   bool* reset)
+{
+    assert( !_imp->accumulationMutex.tryLock() );
+
+    Transform::Matrix3x3 transform;
+    getTransformAtTime(time, &transform);
 
+    *reset = !isAccumulationValid(params, transform, mipmapLevel);
+    if (*reset) {
+        _imp->accumulation.reset(new RotoStrokeAccumulation);
+        _imp->accumulation->rasterizer.reset( new RotoStrokeRasterizer(params) );
+        _imp->accumulation->transform = transform;
+        _imp->accumulation->mipmapLevel = mipmapLevel;
+    }
+
+    RotoStrokeAccumulation* acc = _imp->accumulation.get();
+    std::list<std::list<std::pair<Point, double> > > polylines;
+    getSegmentsToStamp(transform, mipmapLevel, true, &acc->state, &acc->curves, &polylines);
+    if ( !polylines.empty() ) {
+        acc->canvas.ensureBounds( acc->rasterizer->getStrokesBounds(polylines) );
+        acc->state.distToNext = acc->rasterizer->stampStrokes( polylines, acc->state.distToNext, acc->canvas.getPixels(), acc->canvas.getBounds(), acc->canvas.getRowStride() );
+    }
+
+    return acc;
+}
+
+void
+RotoStrokeItem::getSegmentsToStamp(const Transform::Matrix3x3& transform,
+                                   unsigned int mipmapLevel,
+                                   bool onlyFinal,
+                                   RotoStrokeStampState* state,
+                                   std::vector<boost::shared_ptr<Curve> >* curves,
+                                   std::list<std::list<std::pair<Point, double> > >* polylines) const
+{
+    std::vector<RotoStrokeItemPrivate::StrokeCurves> strokes;
+    {
+        QMutexLocker k(&itemMutex);
+        strokes = _imp->strokes;
+    }
+
+    while ( state->strokeIndex < (int)strokes.size() ) {
+        const RotoStrokeItemPrivate::StrokeCurves& stroke = strokes[state->strokeIndex];
+        KeyFrameSet xSet, ySet, pSet;
+        {
+            QMutexLocker k(&itemMutex);
+            xSet = stroke.xCurve->getKeyFrames_mt_safe();
+            ySet = stroke.yCurve->getKeyFrames_mt_safe();
+            pSet = stroke.pressureCurve->getKeyFrames_mt_safe();
+        }
+        assert( xSet.size() == ySet.size() && xSet.size() == pSet.size() );
+        if ( curves && ( (int)curves->size() == state->strokeIndex ) ) {
+            curves->push_back(stroke.xCurve);
+        }
+
+        int nKeys = (int)xSet.size();
+        if (nKeys == 0) {
+            // As RotoContextPrivate::renderStroke, stop at the first empty stroke
+            return;
+        }
+
+        // The last segment of the stroke being painted depends on the tangent of its end, which the next point changes
+        bool isBeingPainted = onlyFinal && ( state->strokeIndex == (int)strokes.size() - 1 );
+        int lastKey = isBeingPainted ? nKeys - 2 : nKeys - 1;
+        if (nKeys == 1) {
+            if (isBeingPainted) {
+                return;
+            }
+            std::list<std::pair<Point, double> > points;
+            evaluateStrokeInternal(xSet, ySet, pSet, transform, mipmapLevel, 0., false, &points, 0);
+            polylines->push_back(points);
+        } else if (lastKey > state->keyframeIndex) {
+            KeyFrameSet xSub, ySub, pSub;
+            KeyFrameSet::const_iterator xIt = xSet.begin();
+            KeyFrameSet::const_iterator yIt = ySet.begin();
+            KeyFrameSet::const_iterator pIt = pSet.begin();
+            std::advance(xIt, state->keyframeIndex);
+            std::advance(yIt, state->keyframeIndex);
+            std::advance(pIt, state->keyframeIndex);
+            for (int i = state->keyframeIndex; i <= lastKey; ++i, ++xIt, ++yIt, ++pIt) {
+                xSub.insert(*xIt);
+                ySub.insert(*yIt);
+                pSub.insert(*pIt);
+            }
+
+            std::list<std::pair<Point, double> > points;
+            evaluateStrokeInternal(xSub, ySub, pSub, transform, mipmapLevel, 0., false, &points, 0);
+            if ( !points.empty() ) {
+                // Continue the polyline stamped so far, so that the dabs are spaced as if it was stamped at once
+                if (state->hasLastPoint) {
+                    points.push_front(state->lastPoint);
+                }
+                state->lastPoint = points.back();
+                state->hasLastPoint = true;
+                polylines->push_back(points);
+            }
+            state->keyframeIndex = lastKey;
+        }
+
+        if (isBeingPainted) {
+            return;
+        }
+        ++state->strokeIndex;
+        state->keyframeIndex = 0;
+        state->hasLastPoint = false;
+    }
+} // RotoStrokeItem::getSegmentsToStamp
+
+RectI
+RotoStrokeItem::stampAccumulationTail(RotoStrokeAccumulation* acc,
+                                      float* dst,
+                                      const RectI& bounds,
+                                      std::size_t rowStride) const
+{
+    // Stamp the segments that are not final without moving the state of the accumulation
+    RotoStrokeStampState state = acc->state;
+    std::list<std::list<std::pair<Point, double> > > polylines;
+
+    getSegmentsToStamp(acc->transform, acc->mipmapLevel, false, &state, 0, &polylines);
+    if ( polylines.empty() ) {
+        return RectI();
+    }
+    acc->rasterizer->stampStrokes(polylines, acc->state.distToNext, dst, bounds, rowStride);
+
+    return acc->rasterizer->getStrokesBounds(polylines);
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -46,6 +46,7 @@ CLANG_DIAG_ON(deprecated-declarations)
 #include "Global/GlobalDefines.h"
 #include "Engine/FitCurve.h"
 #include "Engine/RotoDrawableItem.h"
+#include "Engine/RotoStrokeRasterizer.h"
 #include "Engine/EngineFwd.h"
 
 NATRON_NAMESPACE_ENTER;
@@ -59,6 +60,8 @@ NATRON_NAMESPACE_ENTER;
  * @class Base class for all strokes
  **/
 struct RotoStrokeItemPrivate;
+struct RotoStrokeAccumulation;
+struct RotoStrokeStampState;
 class RotoStrokeItem
     : public RotoDrawableItem
 {
@@ -105,6 +108,18 @@ public:
                               double distToNext,
                               boost::shared_ptr<Image> *wholeStrokeImage);
 
+    /**
+     * @brief Stamps the given strokes, evaluated with evaluateStroke(), in coverage over roi, which is in pixel coordinates
+     * at mipmapLevel. While the stroke is painted, the dabs already stamped by renderSingleStroke() are reused instead of
+     * stamped again.
+     **/
+    void renderStrokeCoverage(const std::list<std::list<std::pair<Point, double> > >& strokes,
+                              double time,
+                              unsigned int mipmapLevel,
+                              const RectI& roi,
+                              float* coverage,
+                              std::size_t rowStride);
+
 
     bool getMostRecentStrokeChangesSinceAge(double time,
                                             int lastAge,
@@ -152,6 +167,42 @@ private:
 
     RectD computeBoundingBoxInternal(double time) const;
 
+    /**
+     * @brief Returns true if the accumulated dabs were stamped with the same brush, transform and mipmap level along
+     * the current strokes. Must be called with accumulationMutex locked.
+     **/
+    bool isAccumulationValid(const RotoStrokeRasterizer::BrushParams& params,
+                             const Transform::Matrix3x3& transform,
+                             unsigned int mipmapLevel) const;
+
+    /**
+     * @brief Stamps in the accumulation the segments of the strokes which became final since the last call, resetting it
+     * first if it is not valid anymore. Must be called with accumulationMutex locked.
+     **/
+    RotoStrokeAccumulation* updateAccumulation(const RotoStrokeRasterizer::BrushParams& params,
+                                               double time,
+                                               unsigned int mipmapLevel,
+                                               bool* reset);
+
+    /**
+     * @brief Returns in polylines the points of the segments of the strokes after state, up to the last final segment
+     * if onlyFinal is true, or up to the end of the strokes otherwise, and advances state past them.
+     **/
+    void getSegmentsToStamp(const Transform::Matrix3x3& transform,
+                            unsigned int mipmapLevel,
+                            bool onlyFinal,
+                            RotoStrokeStampState* state,
+                            std::vector<boost::shared_ptr<Curve> >* curves,
+                            std::list<std::list<std::pair<Point, double> > >* polylines) const;
+
+    /**
+     * @brief Stamps in dst the segments that are not final yet, and returns the pixels they cover.
+     **/
+    RectI stampAccumulationTail(RotoStrokeAccumulation* acc,
+                                float* dst,
+                                const RectI& bounds,
+                                std::size_t rowStride) const;
+
     boost::scoped_ptr<RotoStrokeItemPrivate> _imp;
 };
 
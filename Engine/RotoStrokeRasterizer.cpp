@@ -0,0 +1,409 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RotoStrokeRasterizer.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cmath>
+#include <cstring> // for std::memcpy, std::memset
+
+// Same as in RotoContext.cpp: the pressure is quantized to this number of levels to pick the profile of a dab
+#define ROTO_PRESSURE_LEVELS 512
+
+// Number of entries of the opacity profile of a dab, indexed by the squared distance to its center
+#define ROTO_STROKE_PROFILE_SIZE 1024
+
+// Minimum number of pixels by which the canvas grows on each side
+#define ROTO_STROKE_CANVAS_MIN_MARGIN 64
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+// 2 hyperbolas + 1 parabola to approximate a gauss function, as hardnessGaussLookup in RotoContext.cpp
+double
+hardnessGaussLookup(double f)
+{
+    if (f < -0.5) {
+        f = -1. - f;
+
+        return (2. * f * f);
+    }
+
+    if (f < 0.5) {
+        return (1. - 2. * f * f);
+    }
+    f = 1. - f;
+
+    return (2. * f * f);
+}
+
+/*
+ * Stamps the pixels from begin to end of a row of a dab. dx0 is the distance to the center of the dab of the pixel at 0,
+ * which is the first pixel of the dab before it is clipped, so that the pixels get the same coverage whatever the buffer.
+ */
+template <bool buildUp, bool hasProfile>
+void
+stampDabRow(float* row,
+            int begin,
+            int end,
+            float dx0,
+            float dySquared,
+            float invRadiusSquared,
+            const float* profile,
+            float opacity)
+{
+    const float profileScale = (float)(ROTO_STROKE_PROFILE_SIZE - 1);
+
+    for (int x = begin; x < end; ++x) {
+        float dx = dx0 + (float)x;
+        float u = (dx * dx + dySquared) * invRadiusSquared;
+        float s;
+        if (hasProfile) {
+            int i = (int)(std::min(u, 1.f) * profileScale + 0.5f);
+            s = u < 1.f ? profile[i] : 0.f;
+        } else {
+            s = u < 1.f ? opacity : 0.f;
+        }
+        if (buildUp) {
+            row[x - begin] = row[x - begin] + s - row[x - begin] * s;
+        } else {
+            row[x - begin] = std::max(row[x - begin], s);
+        }
+    }
+}
+}
+
+RotoStrokeRasterizer::BrushParams::BrushParams()
+    : brushSizePixel(1.)
+    , brushHardness(0.)
+    , brushSpacing(0.1)
+    , opacity(1.)
+    , pressureAffectsOpacity(false)
+    , pressureAffectsSize(false)
+    , pressureAffectsHardness(false)
+    , buildUp(false)
+{
+}
+
+bool
+RotoStrokeRasterizer::BrushParams::operator==(const BrushParams& other) const
+{
+    return brushSizePixel == other.brushSizePixel &&
+           brushHardness == other.brushHardness &&
+           brushSpacing == other.brushSpacing &&
+           opacity == other.opacity &&
+           pressureAffectsOpacity == other.pressureAffectsOpacity &&
+           pressureAffectsSize == other.pressureAffectsSize &&
+           pressureAffectsHardness == other.pressureAffectsHardness &&
+           buildUp == other.buildUp;
+}
+
+RotoStrokeRasterizer::RotoStrokeRasterizer(const BrushParams& params)
+    : _params(params)
+    , _footprints()
+{
+    assert(_params.brushSpacing > 0.);
+    // Without pressure, all the dabs share the same footprint
+    bool pressureAffectsFootprint = _params.pressureAffectsOpacity || _params.pressureAffectsSize || _params.pressureAffectsHardness;
+    _footprints.resize(pressureAffectsFootprint ? ROTO_PRESSURE_LEVELS : 1);
+}
+
+RotoStrokeRasterizer::~RotoStrokeRasterizer()
+{
+}
+
+double
+RotoStrokeRasterizer::getMaxDabRadius() const
+{
+    return std::max(_params.brushSizePixel, 1.) / 2.;
+}
+
+double
+RotoStrokeRasterizer::getSpacing(double pressure) const
+{
+    double brushSizePixel = _params.pressureAffectsSize ? _params.brushSizePixel * pressure : _params.brushSizePixel;
+
+    return std::max(brushSizePixel, 1.) * _params.brushSpacing;
+}
+
+const RotoStrokeRasterizer::Footprint&
+RotoStrokeRasterizer::getFootprint(double pressure)
+{
+    int level = 0;
+
+    if (_footprints.size() > 1) {
+        // sometimes, Qt gives a pressure level > 1... so we clamp it
+        level = (int)(std::max( 0., std::min(pressure, 1.) ) * (ROTO_PRESSURE_LEVELS - 1) + 0.5);
+        pressure = (double)level / (ROTO_PRESSURE_LEVELS - 1);
+    }
+    Footprint& footprint = _footprints[level];
+    if (footprint.computed) {
+        return footprint;
+    }
+
+    // Same parameters as getRenderDotParams in RotoContext.cpp
+    double brushSizePixel = _params.pressureAffectsSize ? _params.brushSizePixel * pressure : _params.brushSizePixel;
+    double brushHardness = _params.pressureAffectsHardness ? _params.brushHardness * pressure : _params.brushHardness;
+    double alpha = _params.pressureAffectsOpacity ? _params.opacity * pressure : _params.opacity;
+    double internalRadius = std::max(brushSizePixel * brushHardness, 1.) / 2.;
+    double externalRadius = std::max(brushSizePixel, 1.) / 2.;
+
+    footprint.radius = (float)externalRadius;
+    footprint.invRadiusSquared = (float)( 1. / (externalRadius * externalRadius) );
+    if (brushHardness == 1.) {
+        // A plain disc, whose opacity does not depend on the pressure, as in RotoContextPrivate::renderDot
+        footprint.opacity = (float)_params.opacity;
+    } else {
+        // The stops of the radial gradient from the internal to the external radius
+        const int nStops = 8;
+        double exp = 0.4 / (1.0 - brushHardness);
+        double stops[nStops + 1];
+        for (int i = 0; i <= nStops; ++i) {
+            stops[i] = hardnessGaussLookup( std::pow( (double)i / nStops, exp ) ) * alpha;
+        }
+
+        footprint.profile.resize(ROTO_STROKE_PROFILE_SIZE);
+        double gradientLength = externalRadius - internalRadius;
+        for (int i = 0; i < ROTO_STROKE_PROFILE_SIZE; ++i) {
+            double distance = std::sqrt( (double)i / (ROTO_STROKE_PROFILE_SIZE - 1) ) * externalRadius;
+            double t = gradientLength > 0. ? (distance - internalRadius) / gradientLength : 0.;
+            t = std::max( 0., std::min(t, 1.) ) * nStops;
+            int stop = std::min( (int)t, nStops - 1 );
+            double frac = t - stop;
+            footprint.profile[i] = (float)( stops[stop] * (1. - frac) + stops[stop + 1] * frac );
+        }
+    }
+    footprint.computed = true;
+
+    return footprint;
+} // RotoStrokeRasterizer::getFootprint
+
+void
+RotoStrokeRasterizer::stampDab(const Point& center,
+                               double pressure,
+                               float* dst,
+                               const RectI& bounds,
+                               std::size_t rowStride)
+{
+    const Footprint& footprint = getFootprint(pressure);
+
+    // The pixels whose center may be inside the dab
+    int dabX1 = (int)std::floor(center.x - footprint.radius);
+    int x1 = std::max(bounds.x1, dabX1);
+    int x2 = std::min( bounds.x2, (int)std::ceil(center.x + footprint.radius) );
+    int y1 = std::max( bounds.y1, (int)std::floor(center.y - footprint.radius) );
+    int y2 = std::min( bounds.y2, (int)std::ceil(center.y + footprint.radius) );
+    if ( (x1 >= x2) || (y1 >= y2) ) {
+        return;
+    }
+
+    float dx0 = (float)(dabX1 + 0.5 - center.x);
+    int begin = x1 - dabX1;
+    int end = x2 - dabX1;
+    const float* profile = footprint.profile.empty() ? 0 : &footprint.profile.front();
+    for (int y = y1; y < y2; ++y) {
+        float dy = (float)(y + 0.5 - center.y);
+        float* row = dst + (std::size_t)(y - bounds.y1) * rowStride + (x1 - bounds.x1);
+        if (_params.buildUp) {
+            if (profile) {
+                stampDabRow<true, true>(row, begin, end, dx0, dy * dy, footprint.invRadiusSquared, profile, footprint.opacity);
+            } else {
+                stampDabRow<true, false>(row, begin, end, dx0, dy * dy, footprint.invRadiusSquared, profile, footprint.opacity);
+            }
+        } else {
+            if (profile) {
+                stampDabRow<false, true>(row, begin, end, dx0, dy * dy, footprint.invRadiusSquared, profile, footprint.opacity);
+            } else {
+                stampDabRow<false, false>(row, begin, end, dx0, dy * dy, footprint.invRadiusSquared, profile, footprint.opacity);
+            }
+        }
+    }
+} // RotoStrokeRasterizer::stampDab
+
+double
+RotoStrokeRasterizer::stampStrokes(const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                   double distToNext,
+                                   float* dst,
+                                   const RectI& bounds,
+                                   std::size_t rowStride)
+{
+    for (std::list<std::list<std::pair<Point, double> > >::const_iterator strokeIt = strokes.begin(); strokeIt != strokes.end(); ++strokeIt) {
+        if ( strokeIt->empty() ) {
+            return distToNext;
+        }
+
+        std::list<std::pair<Point, double> >::const_iterator it = strokeIt->begin();
+        if (strokeIt->size() == 1) {
+            stampDab(it->first, it->second, dst, bounds, rowStride);
+            continue;
+        }
+
+        std::list<std::pair<Point, double> >::const_iterator next = it;
+        ++next;
+
+        // The same walk as RotoContextPrivate::renderStroke, so that the dabs are at the same positions
+        while ( next != strokeIt->end() ) {
+            double dist = std::sqrt( (next->first.x - it->first.x) * (next->first.x - it->first.x) +  (next->first.y - it->first.y) * (next->first.y - it->first.y) );
+
+            // while the next point can be drawn on this segment, draw a point and advance
+            while (distToNext <= dist) {
+                double a = dist == 0. ? 0. : distToNext / dist;
+                Point center = {
+                    it->first.x * (1 - a) + next->first.x * a,
+                    it->first.y * (1 - a) + next->first.y * a
+                };
+                double pressure = it->second * (1 - a) + next->second * a;
+                stampDab(center, pressure, dst, bounds, rowStride);
+
+                distToNext += getSpacing(pressure);
+            }
+
+            // go to the next segment
+            distToNext -= dist;
+            ++next;
+            ++it;
+        }
+    }
+
+    return distToNext;
+} // RotoStrokeRasterizer::stampStrokes
+
+RectI
+RotoStrokeRasterizer::getStrokesBounds(const std::list<std::list<std::pair<Point, double> > >& strokes) const
+{
+    double x1 = 0., y1 = 0., x2 = 0., y2 = 0.;
+    bool empty = true;
+
+    for (std::list<std::list<std::pair<Point, double> > >::const_iterator strokeIt = strokes.begin(); strokeIt != strokes.end(); ++strokeIt) {
+        for (std::list<std::pair<Point, double> >::const_iterator it = strokeIt->begin(); it != strokeIt->end(); ++it) {
+            if (empty) {
+                x1 = x2 = it->first.x;
+                y1 = y2 = it->first.y;
+                empty = false;
+            } else {
+                x1 = std::min(x1, it->first.x);
+                x2 = std::max(x2, it->first.x);
+                y1 = std::min(y1, it->first.y);
+                y2 = std::max(y2, it->first.y);
+            }
+        }
+    }
+    if (empty) {
+        return RectI();
+    }
+
+    // The dabs are between the points, so the bounding box of the points padded by the radius contains them
+    double radius = getMaxDabRadius();
+
+    return RectI( (int)std::floor(x1 - radius), (int)std::floor(y1 - radius), (int)std::ceil(x2 + radius) + 1, (int)std::ceil(y2 + radius) + 1 );
+}
+
+RotoStrokeCanvas::RotoStrokeCanvas()
+    : _bounds()
+    , _pixels()
+{
+}
+
+RotoStrokeCanvas::~RotoStrokeCanvas()
+{
+}
+
+float*
+RotoStrokeCanvas::getPixels()
+{
+    return _pixels.empty() ? 0 : &_pixels.front();
+}
+
+void
+RotoStrokeCanvas::ensureBounds(const RectI& rect)
+{
+    if ( rect.isNull() || _bounds.contains(rect) ) {
+        return;
+    }
+
+    RectI newBounds = rect;
+    if ( !_bounds.isNull() ) {
+        newBounds.merge(_bounds);
+    }
+
+    // Grow the sides that must grow by a fraction of the size, so that the number of copies is logarithmic in the size of the stroke
+    int marginX = std::max( ROTO_STROKE_CANVAS_MIN_MARGIN, newBounds.width() / 4 );
+    int marginY = std::max( ROTO_STROKE_CANVAS_MIN_MARGIN, newBounds.height() / 4 );
+    if ( !_bounds.isNull() ) {
+        if (newBounds.x1 < _bounds.x1) {
+            newBounds.x1 -= marginX;
+        }
+        if (newBounds.x2 > _bounds.x2) {
+            newBounds.x2 += marginX;
+        }
+        if (newBounds.y1 < _bounds.y1) {
+            newBounds.y1 -= marginY;
+        }
+        if (newBounds.y2 > _bounds.y2) {
+            newBounds.y2 += marginY;
+        }
+    }
+
+    std::vector<float> pixels( (std::size_t)newBounds.width() * newBounds.height(), 0.f );
+    if ( !_bounds.isNull() ) {
+        copyTo( newBounds, &pixels.front(), (std::size_t)newBounds.width() );
+    }
+    _pixels.swap(pixels);
+    _bounds = newBounds;
+}
+
+void
+RotoStrokeCanvas::copyTo(const RectI& rect,
+                         float* dst,
+                         std::size_t rowStride) const
+{
+    RectI inter;
+    bool intersects = rect.intersect(_bounds, &inter);
+
+    for (int y = rect.y1; y < rect.y2; ++y) {
+        float* dstRow = dst + (std::size_t)(y - rect.y1) * rowStride;
+        if ( !intersects || (y < inter.y1) || (y >= inter.y2) ) {
+            std::memset( dstRow, 0, sizeof(float) * rect.width() );
+            continue;
+        }
+        if (inter.x1 > rect.x1) {
+            std::memset( dstRow, 0, sizeof(float) * (inter.x1 - rect.x1) );
+        }
+        const float* srcRow = &_pixels.front() + (std::size_t)(y - _bounds.y1) * _bounds.width() + (inter.x1 - _bounds.x1);
+        std::memcpy( dstRow + (inter.x1 - rect.x1), srcRow, sizeof(float) * inter.width() );
+        if (inter.x2 < rect.x2) {
+            std::memset( dstRow + (inter.x2 - rect.x1), 0, sizeof(float) * (rect.x2 - inter.x2) );
+        }
+    }
+}
+
+void
+RotoStrokeCanvas::clear()
+{
+    _bounds.clear();
+    std::vector<float>().swap(_pixels);
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,199 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_ROTOSTROKERASTERIZER_H
+#define NATRON_ENGINE_ROTOSTROKERASTERIZER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <list>
+#include <utility>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/RectI.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Stamps the dabs of a paint stroke in a float coverage buffer, without cairo.
+ *
+ * The dabs are placed along the points of the stroke as RotoContextPrivate::renderStroke does, and each dab covers the
+ * pixels whose center is inside its radius with the radial opacity profile of the brush hardness. The profiles are
+ * computed once per pressure level, as a table indexed by the squared distance to the center, so that stamping a dab
+ * is a loop over its rows without any square root or branch, which the compiler vectorizes.
+ *
+ * The coverage of the dabs is composited "over" the buffer when the brush builds up, and with "lighten" otherwise.
+ * Not MT-safe: the profiles are computed lazily.
+ **/
+class RotoStrokeRasterizer
+{
+public:
+
+    struct BrushParams
+    {
+        // The brush size in pixels at the mipmap level of the buffer
+        double brushSizePixel;
+        double brushHardness;
+
+        // Fraction of the brush size between two dabs, strictly positive
+        double brushSpacing;
+        double opacity;
+        bool pressureAffectsOpacity;
+        bool pressureAffectsSize;
+        bool pressureAffectsHardness;
+        bool buildUp;
+
+        BrushParams();
+
+        bool operator==(const BrushParams& other) const;
+
+        bool operator!=(const BrushParams& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    explicit RotoStrokeRasterizer(const BrushParams& params);
+
+    ~RotoStrokeRasterizer();
+
+    const BrushParams& getParams() const
+    {
+        return _params;
+    }
+
+    /**
+     * @brief Returns the radius beyond which no dab of the brush covers any pixel, whatever the pressure.
+     **/
+    double getMaxDabRadius() const;
+
+    /**
+     * @brief Returns the pixels that the dabs stamped along the given strokes may cover.
+     **/
+    RectI getStrokesBounds(const std::list<std::list<std::pair<Point, double> > >& strokes) const;
+
+    /**
+     * @brief Stamps a single dab. dst is the pixel at the bottom-left corner of bounds and rowStride the number of floats
+     * between two rows. The part of the dab outside of bounds is clipped.
+     **/
+    void stampDab(const Point& center, double pressure, float* dst, const RectI& bounds, std::size_t rowStride);
+
+    /**
+     * @brief Stamps the dabs along each polyline of strokes, in pixel coordinates with the pressure of each point, and
+     * returns the distance from the end of the last polyline to the next dab. The first dab is at distToNext from the
+     * start of the first polyline, and a polyline of a single point gets a single dab.
+     *
+     * Walking a polyline in several pieces, each starting with the last point of the previous one, stamps exactly the
+     * same dabs as walking it at once, which is what allows a stroke to be stamped incrementally while it is painted.
+     **/
+    double stampStrokes(const std::list<std::list<std::pair<Point, double> > >& strokes,
+                        double distToNext,
+                        float* dst,
+                        const RectI& bounds,
+                        std::size_t rowStride);
+
+private:
+
+    struct Footprint
+    {
+        bool computed;
+        float radius;
+        float invRadiusSquared;
+
+        // Opacity of the dab if the profile is empty
+        float opacity;
+
+        // Opacity of the dab for the squared distance to the center divided by the squared radius
+        std::vector<float> profile;
+
+        Footprint()
+            : computed(false)
+            , radius(0.f)
+            , invRadiusSquared(0.f)
+            , opacity(0.f)
+            , profile()
+        {
+        }
+    };
+
+    const Footprint& getFootprint(double pressure);
+
+    double getSpacing(double pressure) const;
+
+    BrushParams _params;
+    std::vector<Footprint> _footprints;
+};
+
+/**
+ * @brief A float coverage buffer in which the dabs of a stroke are stamped, which grows with the stroke and keeps the
+ * pixels already stamped.
+ **/
+class RotoStrokeCanvas
+{
+public:
+
+    RotoStrokeCanvas();
+
+    ~RotoStrokeCanvas();
+
+    const RectI& getBounds() const
+    {
+        return _bounds;
+    }
+
+    std::size_t getRowStride() const
+    {
+        return (std::size_t)_bounds.width();
+    }
+
+    /**
+     * @brief Returns the pixel at the bottom-left corner of the bounds, or NULL if the canvas is empty.
+     **/
+    float* getPixels();
+
+    /**
+     * @brief Grows the canvas so that it contains rect. The new pixels are 0. The canvas grows by more than needed, so that
+     * a stroke extending little by little does not copy it for each new dab.
+     **/
+    void ensureBounds(const RectI& rect);
+
+    /**
+     * @brief Copies the pixels of the canvas over rect to dst, with 0 outside of the canvas.
+     **/
+    void copyTo(const RectI& rect, float* dst, std::size_t rowStride) const;
+
+    void clear();
+
+private:
+
+    RectI _bounds;
+    std::vector<float> _pixels;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_ROTOSTROKERASTERIZER_H
@@ -24,6 +24,7 @@
 
 #include "Settings.h"
 
+#include <algorithm> // min, max
 #include <cassert>
 #include <stdexcept>
 
@@ -184,6 +185,15 @@ Settings::initializeKnobsGeneral()
                                                  "Disabling this will no longer save un-saved project.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _generalTab->addKnob(_autoSaveUnSavedProjects);
 
+    _saveProjectsInBinaryFormat = AppManager::createKnob<KnobBool>( this, tr("Save projects in binary format") );
+    _saveProjectsInBinaryFormat->setName("saveProjectsInBinaryFormat");
+    _saveProjectsInBinaryFormat->setHintToolTip( tr("When activated, projects and auto-saves are written in a compact binary format "
+                                                    "which is much faster to save and load than the default XML format for large projects. "
+                                                    "Binary projects can only be opened by this version of %1 or a more recent one, "
+                                                    "on a computer of the same architecture. Both formats can always be loaded, and "
+                                                    "%1Renderer --convert-project converts a project from one format to the other.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
+    _generalTab->addKnob(_saveProjectsInBinaryFormat);
+
 
     _hostName = AppManager::createKnob<KnobChoice>( this, tr("Appear to plug-ins as") );
     _hostName->setName("pluginHostName");
@@ -344,6 +354,14 @@ Settings::initializeKnobsThreading()
     _nThreadsPerEffect->disableSlider();
     _threadingPage->addKnob(_nThreadsPerEffect);
 
+    _parallelRotoShapesRender = AppManager::createKnob<KnobBool>( this, tr("Render Roto shapes in parallel") );
+    _parallelRotoShapesRender->setName("parallelRotoShapes");
+    _parallelRotoShapesRender->setHintToolTip( tr("When checked, the masks of the shapes and strokes of a Roto or RotoPaint node "
+                                                  "are rendered concurrently before they are composited in their render order. "
+                                                  "Otherwise they are rendered one after another while compositing, which uses "
+                                                  "a single core for a frame of a node with many shapes.") );
+    _threadingPage->addKnob(_parallelRotoShapesRender);
+
     _renderInSeparateProcess = AppManager::createKnob<KnobBool>( this, tr("Render in a separate process") );
     _renderInSeparateProcess->setName("renderNewProcess");
     _renderInSeparateProcess->setHintToolTip( tr("If true, %1 will render frames to disk in "
@@ -355,6 +373,25 @@ Settings::initializeKnobsThreading()
                                       "other prior tasks are done.") );
     _queueRenders->setName("queueRenders");
     _threadingPage->addKnob(_queueRenders);
+
+    _renderWritersTogether = AppManager::createKnob<KnobBool>( this, tr("Render writers together") );
+    _renderWritersTogether->setName("renderWritersTogether");
+    _renderWritersTogether->setHintToolTip( tr("When checked, the writers rendered at once (e.g. with Render All Writers or from the "
+                                               "command line) are rendered concurrently, frame by frame, instead of one after the other: "
+                                               "the nodes upstream of several writers are rendered once per frame and their images are "
+                                               "kept in memory until all the writers have used them. This has no effect when rendering in "
+                                               "a separate process.") );
+    _renderWritersTogether->setAddNewLine(false);
+    _threadingPage->addKnob(_renderWritersTogether);
+
+    _renderWritersTogetherMemoryMB = AppManager::createKnob<KnobInt>( this, tr("Shared images memory (MiB)") );
+    _renderWritersTogetherMemoryMB->setName("renderWritersTogetherMemory");
+    _renderWritersTogetherMemoryMB->setHintToolTip( tr("When rendering writers together, the maximum amount of memory used to keep the "
+                                                       "images of the nodes upstream of several writers until all the writers have used them. "
+                                                       "Past it, these images may be removed from the cache and rendered again.") );
+    _renderWritersTogetherMemoryMB->setMinimum(0);
+    _renderWritersTogetherMemoryMB->disableSlider();
+    _threadingPage->addKnob(_renderWritersTogetherMemoryMB);
 } // Settings::initializeKnobsThreading
 
 void
@@ -1113,6 +1150,17 @@ Settings::initializeKnobsViewers()
     _maximumNodeViewerUIOpened->setHintToolTip( tr("Controls the maximum amount of nodes that can have their interface showing up at the same time in the viewer") );
     _viewersTab->addKnob(_maximumNodeViewerUIOpened);
 
+    _playbackPrefetchFrames = AppManager::createKnob<KnobInt>( this, tr("Playback prefetch frames") );
+    _playbackPrefetchFrames->setName("playbackPrefetchFrames");
+    _playbackPrefetchFrames->setMinimum(0);
+    _playbackPrefetchFrames->setMaximum(100);
+    _playbackPrefetchFrames->disableSlider();
+    _playbackPrefetchFrames->setHintToolTip( tr("When the viewer is not playing, the number of frames following the current frame "
+                                                "in the playback direction that are rendered in the background with the idle threads, "
+                                                "so that playback starts without waiting for them. These renders are "
+                                                "stopped as soon as anything else is rendered. 0 disables it.") );
+    _viewersTab->addKnob(_playbackPrefetchFrames);
+
     _viewerKeys = AppManager::createKnob<KnobBool>( this, tr("Use number keys for the viewer") );
     _viewerKeys->setName("viewerNumberKeys");
     _viewerKeys->setHintToolTip( tr("When enabled, the row of number keys on the keyboard "
@@ -1204,6 +1252,15 @@ Settings::initializeKnobsCaching()
                                            "output has its settings panel opened.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _cachingTab->addKnob(_aggressiveCaching);
 
+    _cacheFloatImagesAsHalf = AppManager::createKnob<KnobBool>( this, tr("Cache 32-bit float images as 16-bit half") );
+    _cacheFloatImagesAsHalf->setName("cacheFloatImagesAsHalf");
+    _cacheFloatImagesAsHalf->setHintToolTip( tr("When checked, images rendered in 32-bit floating point are stored in the RAM cache "
+                                                "as 16-bit half floating point images, as in OpenEXR files, so that twice as many images "
+                                                "fit in the cache. Nodes still render and receive 32-bit float images, the conversions are done "
+                                                "when images enter and leave the cache. Values are rounded to 11 significant bits, which "
+                                                "is usually enough for images read from half OpenEXR files.") );
+    _cachingTab->addKnob(_cacheFloatImagesAsHalf);
+
     _maxRAMPercent = AppManager::createKnob<KnobInt>( this, tr("Maximum amount of RAM memory used for caching (% of total RAM)") );
     _maxRAMPercent->setName("maxRAMPercent");
     _maxRAMPercent->disableSlider();
@@ -1266,6 +1323,26 @@ Settings::initializeKnobsCaching()
     _maxDiskCacheNodeGB->setHintToolTip( tr("The maximum size that may be used by the DiskCache node on disk (in GiB)") );
     _cachingTab->addKnob(_maxDiskCacheNodeGB);
 
+    _cacheShardsCount = AppManager::createKnob<KnobInt>( this, tr("Number of cache shards") );
+    _cacheShardsCount->setName("cacheShards");
+    _cacheShardsCount->disableSlider();
+    _cacheShardsCount->setMinimum(0);
+    _cacheShardsCount->setMaximum(256);
+    _cacheShardsCount->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                          "The caches are partitioned into this many independently locked shards so that "
+                                          "render threads looking up different images do not wait on each other. "
+                                          "A value of 1 uses a single lock for each cache. "
+                                          "A value of 0 picks a number of shards based on the number of cores of this computer.") );
+    _cachingTab->addKnob(_cacheShardsCount);
+
+    _legacyCacheHashing = AppManager::createKnob<KnobBool>( this, tr("Legacy cache hashing") );
+    _legacyCacheHashing->setName("legacyCacheHashing");
+    _legacyCacheHashing->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                            "When checked, the keys of cached images are computed with the CRC-64 algorithm of older versions "
+                                            "of %1, which is slower. This allows the disk caches written by these versions to be re-used. "
+                                            "When the algorithm changes, the disk caches are wiped on startup.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
+    _cachingTab->addKnob(_legacyCacheHashing);
+
 
     _diskCachePath = AppManager::createKnob<KnobPath>( this, tr("Disk cache path (empty = default)") );
     _diskCachePath->setName("diskCachePath");
@@ -1280,6 +1357,41 @@ Settings::initializeKnobsCaching()
     _diskCachePath->setHintToolTip( diskCacheTt + defaultLocation );
     _cachingTab->addKnob(_diskCachePath);
 
+    _persistentNodeCache = AppManager::createKnob<KnobBool>( this, tr("Persistent node cache") );
+    _persistentNodeCache->setName("persistentNodeCache");
+    _persistentNodeCache->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                             "When checked, the images fully rendered in the RAM cache are also written to an on-disk store, "
+                                             "so that re-opening the same project, in this session or a later one, re-uses them instead of "
+                                             "rendering them again. Images are looked-up in the store by the same hash as in the RAM cache.") );
+    _cachingTab->addKnob(_persistentNodeCache);
+
+    _maxPersistentNodeCacheGB = AppManager::createKnob<KnobInt>( this, tr("Maximum persistent node cache size (GiB)") );
+    _maxPersistentNodeCacheGB->setName("maxPersistentNodeCache");
+    _maxPersistentNodeCacheGB->disableSlider();
+    _maxPersistentNodeCacheGB->setMinimum(0);
+    _maxPersistentNodeCacheGB->setMaximum(1000);
+    _maxPersistentNodeCacheGB->setHintToolTip( tr("The maximum size that may be used by the persistent node cache on disk (in GiB). "
+                                                  "When exceeded, the least recently used images are removed.") );
+    _maxPersistentNodeCacheGB->setAddNewLine(false);
+    _cachingTab->addKnob(_maxPersistentNodeCacheGB);
+
+    _persistentNodeCacheMaxAgeDays = AppManager::createKnob<KnobInt>( this, tr("Maximum age (days)") );
+    _persistentNodeCacheMaxAgeDays->setName("persistentNodeCacheMaxAge");
+    _persistentNodeCacheMaxAgeDays->disableSlider();
+    _persistentNodeCacheMaxAgeDays->setMinimum(0);
+    _persistentNodeCacheMaxAgeDays->setMaximum(365);
+    _persistentNodeCacheMaxAgeDays->setHintToolTip( tr("Images of the persistent node cache that were not used for this many days are removed. "
+                                                       "A value of 0 keeps images regardless of their age.") );
+    _cachingTab->addKnob(_persistentNodeCacheMaxAgeDays);
+
+    _persistentNodeCachePath = AppManager::createKnob<KnobPath>( this, tr("Persistent node cache path (empty = default)") );
+    _persistentNodeCachePath->setName("persistentNodeCachePath");
+    _persistentNodeCachePath->setMultiPath(false);
+    _persistentNodeCachePath->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                                 "The location of the persistent node cache. This should point to a fast disk with enough space. "
+                                                 "If empty, the store is located in the disk cache path.") );
+    _cachingTab->addKnob(_persistentNodeCachePath);
+
     _wipeDiskCache = AppManager::createKnob<KnobButton>( this, tr("Wipe Disk Cache") );
     _wipeDiskCache->setHintToolTip( tr("Cleans-up all caches, deleting all folders that may contain cached data. "
                                        "This is provided in case %1 lost track of cached images "
@@ -1430,6 +1542,7 @@ Settings::setDefaultValues()
     _notifyOnFileChange->setDefaultValue(true);
     _autoSaveDelay->setDefaultValue(5, 0);
     _autoSaveUnSavedProjects->setDefaultValue(true);
+    _saveProjectsInBinaryFormat->setDefaultValue(false);
     _maxUndoRedoNodeGraph->setDefaultValue(20, 0);
     _linearPickers->setDefaultValue(true, 0);
     _convertNaNValues->setDefaultValue(true);
@@ -1448,8 +1561,11 @@ Settings::setDefaultValues()
     _enableOpenGL->setDefaultValue((int)eEnableOpenGLDisabled);
     _useThreadPool->setDefaultValue(true);
     _nThreadsPerEffect->setDefaultValue(0);
+    _parallelRotoShapesRender->setDefaultValue(true);
     _renderInSeparateProcess->setDefaultValue(false, 0);
     _queueRenders->setDefaultValue(false);
+    _renderWritersTogether->setDefaultValue(false);
+    _renderWritersTogetherMemoryMB->setDefaultValue(2048);
     _autoPreviewEnabledForNewProjects->setDefaultValue(true, 0);
     _firstReadSetProjectFormat->setDefaultValue(true);
     _fixPathsOnProjectPathChanged->setDefaultValue(true);
@@ -1476,16 +1592,23 @@ Settings::setDefaultValues()
     _autoProxyWhenScrubbingTimeline->setDefaultValue(true);
     _autoProxyLevel->setDefaultValue(1);
     _maximumNodeViewerUIOpened->setDefaultValue(2);
+    _playbackPrefetchFrames->setDefaultValue(8);
     _viewerKeys->setDefaultValue(true);
 
     _warnOcioConfigKnobChanged->setDefaultValue(true);
     _ocioStartupCheck->setDefaultValue(true);
 
     _aggressiveCaching->setDefaultValue(false);
+    _cacheFloatImagesAsHalf->setDefaultValue(false);
     _maxRAMPercent->setDefaultValue(50, 0);
     _unreachableRAMPercent->setDefaultValue(5);
     _maxViewerDiskCacheGB->setDefaultValue(5, 0);
     _maxDiskCacheNodeGB->setDefaultValue(10, 0);
+    _cacheShardsCount->setDefaultValue(1);
+    _legacyCacheHashing->setDefaultValue(false);
+    _persistentNodeCache->setDefaultValue(false);
+    _maxPersistentNodeCacheGB->setDefaultValue(20, 0);
+    _persistentNodeCacheMaxAgeDays->setDefaultValue(14, 0);
     setCachingLabels();
     _autoScroll->setDefaultValue(false);
     _autoTurbo->setDefaultValue(false);
@@ -2157,6 +2280,10 @@ Settings::onKnobValueChanged(KnobI* k,
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumDiskSpace( getMaximumDiskCacheNodeSize() );
         }
+    } else if ( ( k == _maxPersistentNodeCacheGB.get() ) || ( k == _persistentNodeCacheMaxAgeDays.get() ) ) {
+        if (!_restoringSettings) {
+            appPTR->setPersistentNodeCacheLimits( getMaximumPersistentNodeCacheSize(), getPersistentNodeCacheMaximumAge() );
+        }
     } else if ( k == _maxRAMPercent.get() ) {
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumMemoryPercent( getRamMaximumPercent() );
@@ -2358,6 +2485,12 @@ Settings::getMaxOpenedNodesViewerContext() const
     return _maximumNodeViewerUIOpened->getValue();
 }
 
+int
+Settings::getPlaybackPrefetchFrames() const
+{
+    return _playbackPrefetchFrames->getValue();
+}
+
 bool
 Settings::isViewerKeysEnabled() const
 {
@@ -2373,6 +2506,12 @@ Settings::isAggressiveCachingEnabled() const
     return _aggressiveCaching->getValue();
 }
 
+bool
+Settings::isCacheFloatImagesAsHalfEnabled() const
+{
+    return _cacheFloatImagesAsHalf->getValue();
+}
+
 double
 Settings::getRamMaximumPercent() const
 {
@@ -2391,6 +2530,49 @@ Settings::getMaximumDiskCacheNodeSize() const
     return (U64)( _maxDiskCacheNodeGB->getValue() ) * std::pow(1024., 3.);
 }
 
+bool
+Settings::isLegacyCacheHashingEnabled() const
+{
+    return _legacyCacheHashing->getValue();
+}
+
+bool
+Settings::isPersistentNodeCacheEnabled() const
+{
+    return _persistentNodeCache->getValue();
+}
+
+U64
+Settings::getMaximumPersistentNodeCacheSize() const
+{
+    return (U64)( _maxPersistentNodeCacheGB->getValue() ) * std::pow(1024., 3.);
+}
+
+int
+Settings::getPersistentNodeCacheMaximumAge() const
+{
+    return _persistentNodeCacheMaxAgeDays->getValue();
+}
+
+std::string
+Settings::getPersistentNodeCachePath() const
+{
+    return _persistentNodeCachePath->getValue();
+}
+
+int
+Settings::getCacheShardsCount() const
+{
+    int nShards = _cacheShardsCount->getValue();
+
+    if (nShards <= 0) {
+        // Use a few more shards than cores so that concurrent lookups rarely collide
+        nShards = std::max(1, appPTR->getHardwareIdealThreadCount() * 2);
+    }
+
+    return nShards;
+}
+
 ///////////////////////////////////////////////////
 
 double
@@ -2411,6 +2593,12 @@ Settings::getNumberOfThreadsPerEffect() const
     return _nThreadsPerEffect->getValue();
 }
 
+bool
+Settings::isParallelRotoShapesRenderEnabled() const
+{
+    return _parallelRotoShapesRender->getValue();
+}
+
 int
 Settings::getNumberOfThreads() const
 {
@@ -2605,6 +2793,12 @@ Settings::isAutoSaveEnabledForUnsavedProjects() const
     return _autoSaveUnSavedProjects->getValue();
 }
 
+bool
+Settings::isSaveProjectsInBinaryFormatEnabled() const
+{
+    return _saveProjectsInBinaryFormat->getValue();
+}
+
 bool
 Settings::isSnapToNodeEnabled() const
 {
@@ -3529,6 +3723,25 @@ Settings::isRenderQueuingEnabled() const
     return _queueRenders->getValue();
 }
 
+bool
+Settings::isRenderWritersTogetherEnabled() const
+{
+    return _renderWritersTogether->getValue();
+}
+
+void
+Settings::setRenderWritersTogetherEnabled(bool enabled)
+{
+    _renderWritersTogether->setValue(enabled);
+    saveSetting( _renderWritersTogether.get() );
+}
+
+std::size_t
+Settings::getRenderWritersTogetherMemoryBudget() const
+{
+    return (std::size_t)std::max(0, _renderWritersTogetherMemoryMB->getValue() ) * 1024 * 1024;
+}
+
 bool
 Settings::isFileDialogEnabledForNewWriters() const
 {
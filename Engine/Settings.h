@@ -109,6 +109,18 @@ public:
 
     U64 getMaximumDiskCacheNodeSize() const;
 
+    int getCacheShardsCount() const;
+
+    bool isLegacyCacheHashingEnabled() const;
+
+    bool isPersistentNodeCacheEnabled() const;
+
+    U64 getMaximumPersistentNodeCacheSize() const;
+
+    int getPersistentNodeCacheMaximumAge() const;
+
+    std::string getPersistentNodeCachePath() const;
+
     double getUnreachableRamPercent() const;
 
     bool getColorPickerLinear() const;
@@ -123,6 +135,8 @@ public:
 
     int getNumberOfThreadsPerEffect() const;
 
+    bool isParallelRotoShapesRenderEnabled() const;
+
     bool useGlobalThreadPool() const;
 
     void setUseGlobalThreadPool(bool use);
@@ -162,6 +176,15 @@ public:
 
     void setRenderQueuingEnabled(bool enabled);
 
+    bool isRenderWritersTogetherEnabled() const;
+
+    void setRenderWritersTogetherEnabled(bool enabled);
+
+    /**
+     * @brief Maximum memory in bytes used to keep the images shared by the writers rendered together
+     **/
+    std::size_t getRenderWritersTogetherMemoryBudget() const;
+
     void restoreDefault();
 
     int getMaximumUndoRedoNodeGraph() const;
@@ -170,6 +193,8 @@ public:
 
     bool isAutoSaveEnabledForUnsavedProjects() const;
 
+    bool isSaveProjectsInBinaryFormatEnabled() const;
+
     bool isSnapToNodeEnabled() const;
 
     bool isCheckForUpdatesEnabled() const;
@@ -242,6 +267,7 @@ public:
     bool isAutoProxyEnabled() const;
     unsigned int getAutoProxyMipMapLevel() const;
     int getMaxOpenedNodesViewerContext() const;
+    int getPlaybackPrefetchFrames() const;
     bool isViewerKeysEnabled() const;
     ///////////////////////////////////////////////////////
 
@@ -267,6 +293,8 @@ public:
 
     bool isAggressiveCachingEnabled() const;
 
+    bool isCacheFloatImagesAsHalfEnabled() const;
+
     bool isAutoTurboEnabled() const;
 
     void setAutoTurboModeEnabled(bool e);
@@ -413,6 +441,7 @@ private:
     boost::shared_ptr<KnobBool> _enableCrashReports;
     boost::shared_ptr<KnobButton> _testCrashReportButton;
     boost::shared_ptr<KnobBool> _autoSaveUnSavedProjects;
+    boost::shared_ptr<KnobBool> _saveProjectsInBinaryFormat;
     boost::shared_ptr<KnobInt> _autoSaveDelay;
     boost::shared_ptr<KnobChoice> _hostName;
     boost::shared_ptr<KnobString> _customHostName;
@@ -423,8 +452,11 @@ private:
     boost::shared_ptr<KnobInt> _numberOfParallelRenders;
     boost::shared_ptr<KnobBool> _useThreadPool;
     boost::shared_ptr<KnobInt> _nThreadsPerEffect;
+    boost::shared_ptr<KnobBool> _parallelRotoShapesRender;
     boost::shared_ptr<KnobBool> _renderInSeparateProcess;
     boost::shared_ptr<KnobBool> _queueRenders;
+    boost::shared_ptr<KnobBool> _renderWritersTogether;
+    boost::shared_ptr<KnobInt> _renderWritersTogetherMemoryMB;
 
     // General/Rendering
     boost::shared_ptr<KnobPage> _renderingPage;
@@ -478,6 +510,7 @@ private:
     // Caching
     boost::shared_ptr<KnobPage> _cachingTab;
     boost::shared_ptr<KnobBool> _aggressiveCaching;
+    boost::shared_ptr<KnobBool> _cacheFloatImagesAsHalf;
     ///The percentage of the value held by _maxRAMPercent to dedicate to playback cache (viewer cache's in-RAM portion) only
     boost::shared_ptr<KnobString> _maxPlaybackLabel;
 
@@ -498,7 +531,13 @@ private:
     ///The total disk space allowed for all Natron's caches
     boost::shared_ptr<KnobInt> _maxViewerDiskCacheGB;
     boost::shared_ptr<KnobInt> _maxDiskCacheNodeGB;
+    boost::shared_ptr<KnobInt> _cacheShardsCount;
+    boost::shared_ptr<KnobBool> _legacyCacheHashing;
     boost::shared_ptr<KnobPath> _diskCachePath;
+    boost::shared_ptr<KnobBool> _persistentNodeCache;
+    boost::shared_ptr<KnobInt> _maxPersistentNodeCacheGB;
+    boost::shared_ptr<KnobInt> _persistentNodeCacheMaxAgeDays;
+    boost::shared_ptr<KnobPath> _persistentNodeCachePath;
     boost::shared_ptr<KnobButton> _wipeDiskCache;
 
     // Viewer
@@ -512,6 +551,7 @@ private:
     boost::shared_ptr<KnobBool> _autoProxyWhenScrubbingTimeline;
     boost::shared_ptr<KnobChoice> _autoProxyLevel;
     boost::shared_ptr<KnobInt> _maximumNodeViewerUIOpened;
+    boost::shared_ptr<KnobInt> _playbackPrefetchFrames;
     boost::shared_ptr<KnobBool> _viewerKeys;
 
     // Nodegraph
@@ -98,8 +98,7 @@ public:
             return sizeof(float);
         case eDataTypeHalf:
 
-            // Fixme when we support half
-            return sizeof(float);
+            return sizeof(unsigned short);
         case eDataTypeNone:
         default:
 
@@ -24,13 +24,20 @@
 
 #include "ThreadPool.h"
 
+#include <algorithm>
 #include <string>
 #include <sstream>
+#include <deque>
+#include <vector>
+#include <stdexcept>
 
 #include <QtCore/QAtomicInt>
+#include <QtCore/QDebug>
 #include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
 #include <QtCore/QThread>
 #include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
 
 #include "Engine/AbortableRenderInfo.h"
 #include "Engine/Node.h"
@@ -218,5 +225,383 @@ ThreadPool::createThreadPoolThread() const
 
 #endif // ifdef QT_CUSTOM_THREADPOOL
 
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct ScheduledTask
+{
+    RenderThreadPool::Task task;
+    RenderThreadPool::TaskGroup* group;
+
+    ScheduledTask()
+        : task()
+        , group(0)
+    {
+    }
+
+    ScheduledTask(RenderThreadPool::TaskGroup* group,
+                  const RenderThreadPool::Task& task)
+        : task(task)
+        , group(group)
+    {
+    }
+};
+
+/*
+ * A deque of tasks, with its own lock so that threads pushing and popping tasks in their own deque
+ * do not contend with each other.
+ */
+struct TaskDeque
+{
+    QMutex mutex;
+    std::deque<ScheduledTask> tasks;
+
+    TaskDeque()
+        : mutex()
+        , tasks()
+    {
+    }
+
+    void push(const ScheduledTask& task)
+    {
+        QMutexLocker k(&mutex);
+
+        tasks.push_back(task);
+    }
+
+    // Pop the most recently pushed task
+    bool popBack(ScheduledTask* task)
+    {
+        QMutexLocker k(&mutex);
+
+        if ( tasks.empty() ) {
+            return false;
+        }
+        *task = tasks.back();
+        tasks.pop_back();
+
+        return true;
+    }
+
+    // Steal the oldest task
+    bool popFront(ScheduledTask* task)
+    {
+        QMutexLocker k(&mutex);
+
+        if ( tasks.empty() ) {
+            return false;
+        }
+        *task = tasks.front();
+        tasks.pop_front();
+
+        return true;
+    }
+
+    // Pop the most recently pushed task of the given group
+    bool popBackForGroup(const RenderThreadPool::TaskGroup* group,
+                         ScheduledTask* task)
+    {
+        QMutexLocker k(&mutex);
+
+        for (std::deque<ScheduledTask>::reverse_iterator it = tasks.rbegin(); it != tasks.rend(); ++it) {
+            if (it->group == group) {
+                *task = *it;
+                tasks.erase( (it + 1).base() );
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+class RenderThreadPoolThread
+    : public QThread
+      , public AbortableThread
+{
+public:
+
+    RenderThreadPoolThread(RenderThreadPoolPrivate* pool,
+                           int index)
+        : QThread()
+        , AbortableThread(this)
+        , pool(pool)
+        , index(index)
+        , deque()
+    {
+        setThreadName("Render Thread (Pooled)");
+    }
+
+    virtual ~RenderThreadPoolThread() {}
+
+    RenderThreadPoolPrivate* pool;
+    int index;
+    TaskDeque deque;
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
+struct RenderThreadPoolPrivate
+{
+    // Protects the threads vector, which only grows
+    mutable QReadWriteLock threadsLock;
+    std::vector<RenderThreadPoolThread*> threads;
+    QAtomicInt maxThreadCount;
+
+    // The deque of the tasks started by threads that are not in the pool
+    TaskDeque externalDeque;
+
+    // The number of tasks in all deques
+    QAtomicInt nScheduledTasks;
+
+    // Idle threads wait on workAvailable, threads above maxThreadCount on threadCountChanged
+    QMutex sleepMutex;
+    QWaitCondition workAvailable;
+    QWaitCondition threadCountChanged;
+    bool mustQuit;
+
+    RenderThreadPoolPrivate()
+        : threadsLock()
+        , threads()
+        , maxThreadCount( QThread::idealThreadCount() )
+        , externalDeque()
+        , nScheduledTasks()
+        , sleepMutex()
+        , workAvailable()
+        , threadCountChanged()
+        , mustQuit(false)
+    {
+    }
+
+    RenderThreadPoolThread* getCurrentPoolThread()
+    {
+        RenderThreadPoolThread* thread = dynamic_cast<RenderThreadPoolThread*>( QThread::currentThread() );
+
+        return (thread && thread->pool == this) ? thread : 0;
+    }
+
+    void startThreadsIfNeeded()
+    {
+        int nThreads = std::max(1, (int)maxThreadCount);
+        {
+            QReadLocker k(&threadsLock);
+            if ( (int)threads.size() >= nThreads ) {
+                return;
+            }
+        }
+        QWriteLocker k(&threadsLock);
+        {
+            QMutexLocker k2(&sleepMutex);
+            if (mustQuit) {
+                return;
+            }
+        }
+        while ( (int)threads.size() < nThreads ) {
+            RenderThreadPoolThread* thread = new RenderThreadPoolThread(this, (int)threads.size());
+            threads.push_back(thread);
+            thread->start();
+        }
+    }
+
+    bool stealTask(const RenderThreadPoolThread* thief,
+                   ScheduledTask* task)
+    {
+        if ( externalDeque.popFront(task) ) {
+            return true;
+        }
+        QReadLocker k(&threadsLock);
+        int nThreads = (int)threads.size();
+        // Start with the next thread so that all threads do not steal from the same one
+        int first = thief ? thief->index + 1 : 0;
+        for (int i = 0; i < nThreads; ++i) {
+            RenderThreadPoolThread* victim = threads[(first + i) % nThreads];
+            if ( (victim != thief) && victim->deque.popFront(task) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void runTask(const ScheduledTask& task)
+    {
+        nScheduledTasks.fetchAndAddRelaxed(-1);
+        bool failed = false;
+        try {
+            task.task();
+        } catch (const std::exception& e) {
+            qDebug() << "Exception in render thread pool task:" << e.what();
+            failed = true;
+        } catch (...) {
+            qDebug() << "Unknown exception in render thread pool task";
+            failed = true;
+        }
+
+        QMutexLocker k(&task.group->_mutex);
+        if (failed) {
+            task.group->_failed = true;
+        }
+        --task.group->_nPendingTasks;
+        assert(task.group->_nPendingTasks >= 0);
+        if (task.group->_nPendingTasks == 0) {
+            task.group->_allTasksDone.wakeAll();
+        }
+    }
+
+    void threadLoop(RenderThreadPoolThread* thread)
+    {
+        for (;;) {
+            ScheduledTask task;
+            bool isThreadUsed = thread->index < (int)maxThreadCount;
+            if ( isThreadUsed && ( thread->deque.popBack(&task) || stealTask(thread, &task) ) ) {
+                runTask(task);
+                continue;
+            }
+
+            QMutexLocker k(&sleepMutex);
+            if (mustQuit) {
+                return;
+            }
+            if (!isThreadUsed) {
+                threadCountChanged.wait(&sleepMutex);
+            } else if ( (int)nScheduledTasks == 0 ) {
+                // startTask() increments nScheduledTasks before waking us up under sleepMutex, so we cannot miss it
+                workAvailable.wait(&sleepMutex);
+            }
+        }
+    }
+};
+
+void
+RenderThreadPoolThread::run()
+{
+    pool->threadLoop(this);
+}
+
+RenderThreadPool::TaskGroup::TaskGroup()
+    : _mutex()
+    , _allTasksDone()
+    , _nPendingTasks(0)
+    , _failed(false)
+{
+}
+
+RenderThreadPool::TaskGroup::~TaskGroup()
+{
+    assert(_nPendingTasks == 0);
+}
+
+RenderThreadPool::RenderThreadPool()
+    : _imp( new RenderThreadPoolPrivate() )
+{
+}
+
+RenderThreadPool::~RenderThreadPool()
+{
+    quit();
+}
+
+void
+RenderThreadPool::setMaxThreadCount(int nThreads)
+{
+    if (nThreads <= 0) {
+        nThreads = QThread::idealThreadCount();
+    }
+    _imp->maxThreadCount.fetchAndStoreRelaxed(nThreads);
+
+    QMutexLocker k(&_imp->sleepMutex);
+    _imp->threadCountChanged.wakeAll();
+}
+
+int
+RenderThreadPool::getMaxThreadCount() const
+{
+    return (int)_imp->maxThreadCount;
+}
+
+void
+RenderThreadPool::startTask(TaskGroup* group,
+                            const Task& task)
+{
+    assert(group);
+    {
+        QMutexLocker k(&group->_mutex);
+        ++group->_nPendingTasks;
+    }
+
+    _imp->startThreadsIfNeeded();
+
+    RenderThreadPoolThread* thread = _imp->getCurrentPoolThread();
+    TaskDeque& deque = thread ? thread->deque : _imp->externalDeque;
+    deque.push( ScheduledTask(group, task) );
+    _imp->nScheduledTasks.fetchAndAddRelaxed(1);
+
+    QMutexLocker k(&_imp->sleepMutex);
+    _imp->workAvailable.wakeOne();
+}
+
+bool
+RenderThreadPool::waitForGroup(TaskGroup* group)
+{
+    assert(group);
+    RenderThreadPoolThread* thread = _imp->getCurrentPoolThread();
+    TaskDeque& deque = thread ? thread->deque : _imp->externalDeque;
+
+    // Run the tasks of the group that were not stolen
+    ScheduledTask task;
+    while ( deque.popBackForGroup(group, &task) ) {
+        _imp->runTask(task);
+    }
+
+    // The remaining tasks are running in other threads. Tasks of other groups are never run here: this thread
+    // may be in the middle of a render and hold the locks of its effects, and the tasks of other renders may
+    // wait for images this render is producing.
+    QMutexLocker k(&group->_mutex);
+    while (group->_nPendingTasks > 0) {
+        group->_allTasksDone.wait(&group->_mutex);
+    }
+
+    return !group->_failed;
+}
+
+void
+RenderThreadPool::quit()
+{
+    {
+        QMutexLocker k(&_imp->sleepMutex);
+        _imp->mustQuit = true;
+        _imp->workAvailable.wakeAll();
+        _imp->threadCountChanged.wakeAll();
+    }
+    // Do not hold the lock while waiting: the threads take it to steal tasks.
+    // No thread can be started once mustQuit is set.
+    std::vector<RenderThreadPoolThread*> threads;
+    {
+        QReadLocker k(&_imp->threadsLock);
+        threads = _imp->threads;
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->wait();
+    }
+
+    QWriteLocker k(&_imp->threadsLock);
+    for (std::size_t i = 0; i < _imp->threads.size(); ++i) {
+        delete _imp->threads[i];
+    }
+    _imp->threads.clear();
+}
+
+bool
+RenderThreadPool::isPoolThread() const
+{
+    return _imp->getCurrentPoolThread() != 0;
+}
+
 NATRON_NAMESPACE_EXIT;
 
@@ -28,10 +28,13 @@
 #include "Global/Macros.h"
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/function.hpp>
 #include <boost/scoped_ptr.hpp>
 #endif
 
+#include <QtCore/QMutex>
 #include <QtCore/QThreadPool> // defines QT_CUSTOM_THREADPOOL (or not)
+#include <QtCore/QWaitCondition>
 
 #include "Engine/EngineFwd.h"
 
@@ -132,6 +135,94 @@ private:
 
 #endif // QT_CUSTOM_THREADPOOL
 
+
+/**
+ * @brief A pool of render threads which schedules tasks by work-stealing. This is used for host frame threading
+ * (the tiles of eRenderSafetyFullySafeFrame effects, see EffectInstance::renderRoIInternal).
+ *
+ * Each thread of the pool owns a deque of tasks: the tasks a thread starts are pushed at the back of its own deque
+ * and it pops them from the back, whereas idle threads steal tasks from the front of the other deques.
+ * Tasks started by threads which are not in the pool go in a shared deque that is treated the same way.
+ *
+ * A thread waiting for a group of tasks in waitForGroup() runs the tasks of the group that were not stolen
+ * instead of blocking: when a tile render needs to render its inputs, the tiles of the upstream nodes are
+ * rendered by the thread itself and by the idle threads, so nested renders never wait for a free thread.
+ * A waiting thread only runs the tasks of the group it waits for and otherwise blocks: it may be in the middle
+ * of a render, holding the locks of its effects and its thread local storage, and tasks of other renders may
+ * wait for the images it is producing.
+ **/
+struct RenderThreadPoolPrivate;
+class RenderThreadPool
+{
+public:
+
+    typedef boost::function0<void> Task;
+
+    /**
+     * @brief A set of tasks that are waited for together. Tasks of a group must all be started
+     * by the thread that calls waitForGroup() on it.
+     **/
+    class TaskGroup
+    {
+public:
+
+        TaskGroup();
+
+        ~TaskGroup();
+
+private:
+
+        friend class RenderThreadPool;
+        friend struct RenderThreadPoolPrivate;
+
+        QMutex _mutex;
+        QWaitCondition _allTasksDone;
+        int _nPendingTasks;
+
+        // True if a task of the group threw an exception
+        bool _failed;
+    };
+
+    RenderThreadPool();
+
+    ~RenderThreadPool();
+
+    /**
+     * @brief Set the number of threads of the pool. If 0, the ideal thread count of the system is used.
+     * Threads are only started when the first task is started.
+     **/
+    void setMaxThreadCount(int nThreads);
+
+    int getMaxThreadCount() const;
+
+    /**
+     * @brief Schedule the given task as part of the given group.
+     **/
+    void startTask(TaskGroup* group, const Task& task);
+
+    /**
+     * @brief Returns when all the tasks of the group are done, running the tasks of the group that were
+     * not taken yet by another thread in the calling thread.
+     * @returns False if a task of the group threw an exception.
+     **/
+    bool waitForGroup(TaskGroup* group) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Stops all the threads of the pool and waits for them. The threads run the tasks that are
+     * already scheduled before exiting.
+     **/
+    void quit();
+
+    /**
+     * @brief Returns true if the calling thread is one of the threads of this pool.
+     **/
+    bool isPoolThread() const;
+
+private:
+
+    boost::scoped_ptr<RenderThreadPoolPrivate> _imp;
+};
+
 NATRON_NAMESPACE_EXIT;
 
 #endif // Natron_Engine_ThreadPool_h
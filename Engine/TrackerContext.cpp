@@ -1492,13 +1492,11 @@ struct TrackArgsPrivate
     int step;
     boost::shared_ptr<TimeLine> timeline;
     ViewerInstance* viewer;
-    boost::shared_ptr<mv::AutoTrack> libmvAutotrack;
     boost::shared_ptr<TrackerFrameAccessor> fa;
     std::vector<boost::shared_ptr<TrackMarkerAndOptions> > tracks;
 
     //Store the format size because LibMV internally has a top-down Y axis
     double formatWidth, formatHeight;
-    mutable QMutex autoTrackMutex;
     
     bool autoKeyingOnEnabledParamEnabled;
 
@@ -1508,7 +1506,6 @@ struct TrackArgsPrivate
         , step(1)
         , timeline()
         , viewer(0)
-        , libmvAutotrack()
         , fa()
         , tracks()
         , formatWidth(0)
@@ -1528,7 +1525,6 @@ TrackArgs::TrackArgs(int start,
                      int step,
                      const boost::shared_ptr<TimeLine>& timeline,
                      ViewerInstance* viewer,
-                     const boost::shared_ptr<mv::AutoTrack>& autoTrack,
                      const boost::shared_ptr<TrackerFrameAccessor>& fa,
                      const std::vector<boost::shared_ptr<TrackMarkerAndOptions> >& tracks,
                      double formatWidth,
@@ -1542,7 +1538,6 @@ TrackArgs::TrackArgs(int start,
     _imp->step = step;
     _imp->timeline = timeline;
     _imp->viewer = viewer;
-    _imp->libmvAutotrack = autoTrack;
     _imp->fa = fa;
     _imp->tracks = tracks;
     _imp->formatWidth = formatWidth;
@@ -1569,7 +1564,6 @@ TrackArgs::operator=(const TrackArgs& other)
     _imp->step = other._imp->step;
     _imp->timeline = other._imp->timeline;
     _imp->viewer = other._imp->viewer;
-    _imp->libmvAutotrack = other._imp->libmvAutotrack;
     _imp->fa = other._imp->fa;
     _imp->tracks = other._imp->tracks;
     _imp->formatWidth = other._imp->formatWidth;
@@ -1595,12 +1589,6 @@ TrackArgs::getFormatWidth() const
     return _imp->formatWidth;
 }
 
-QMutex*
-TrackArgs::getAutoTrackMutex() const
-{
-    return &_imp->autoTrackMutex;
-}
-
 int
 TrackArgs::getStart() const
 {
@@ -1643,10 +1631,10 @@ TrackArgs::getTracks() const
     return _imp->tracks;
 }
 
-boost::shared_ptr<mv::AutoTrack>
-TrackArgs::getLibMVAutoTrack() const
+boost::shared_ptr<TrackerFrameAccessor>
+TrackArgs::getFrameAccessor() const
 {
-    return _imp->libmvAutotrack;
+    return _imp->fa;
 }
 
 void
@@ -1862,6 +1850,9 @@ TrackScheduler::threadLoopOnce(const ThreadStartArgsPtr& inArgs)
 
 
         while (cur != end) {
+            // Render the regions of all the tracks at once for each frame they read, before solving them in parallel
+            TrackerContextPrivate::prefetchTrackStepImages(*args, cur);
+
             ///Launch parallel thread for each track using the global thread pool
             QFuture<bool> future = QtConcurrent::mapped( trackIndexes,
                                                          boost::bind(&TrackSchedulerPrivate::trackStepFunctor,
@@ -1945,6 +1936,9 @@ TrackScheduler::threadLoopOnce(const ThreadStartArgsPtr& inArgs)
                 break;
             }
         } // while (cur != end) {
+
+        // The arguments of the track are held until the next one is started: do not keep the prefetched images until then
+        args->getFrameAccessor()->releasePrefetchedFrames( std::set<int>() );
     } // IsTrackingFlagSetter_RAII
     TrackerContext* isContext = dynamic_cast<TrackerContext*>(_imp->paramsProvider);
     if (isContext) {
@@ -432,7 +432,6 @@ public:
               int step,
               const boost::shared_ptr<TimeLine>& timeline,
               ViewerInstance* viewer,
-              const boost::shared_ptr<mv::AutoTrack>& autoTrack,
               const boost::shared_ptr<TrackerFrameAccessor>& fa,
               const std::vector<boost::shared_ptr<TrackMarkerAndOptions> >& tracks,
               double formatWidth,
@@ -449,7 +448,6 @@ public:
     double getFormatHeight() const;
     double getFormatWidth() const;
 
-    QMutex* getAutoTrackMutex() const;
     int getStart() const;
 
     int getEnd() const;
@@ -461,7 +459,7 @@ public:
 
     int getNumTracks() const;
     const std::vector<boost::shared_ptr<TrackMarkerAndOptions> >& getTracks() const;
-    boost::shared_ptr<mv::AutoTrack> getLibMVAutoTrack() const;
+    boost::shared_ptr<TrackerFrameAccessor> getFrameAccessor() const;
 
     void getEnabledChannels(bool* r, bool* g, bool* b) const;
 
@@ -24,6 +24,9 @@
 
 #include "TrackerContextPrivate.h"
 
+#include <map>
+#include <set>
+
 #include <QtCore/QThreadPool>
 
 #include "Engine/AppInstance.h"
@@ -1031,24 +1034,20 @@ TrackerContextPrivate::trackStepLibMV(int trackIndex,
 
     const std::vector<boost::shared_ptr<TrackMarkerAndOptions> >& tracks = args.getTracks();
     const boost::shared_ptr<TrackMarkerAndOptions>& track = tracks[trackIndex];
-    boost::shared_ptr<mv::AutoTrack> autoTrack = args.getLibMVAutoTrack();
-    QMutex* autoTrackMutex = args.getAutoTrackMutex();
+    const boost::shared_ptr<mv::AutoTrack>& autoTrack = track->mvAutoTrack;
     bool enabledChans[3];
     args.getEnabledChannels(&enabledChans[0], &enabledChans[1], &enabledChans[2]);
 
 
-    {
-        // Add a marker to the auto-track at the tracked time: the mv::Marker struct is filled with the values of the Natron TrackMarker at the trackTime
-        QMutexLocker k(autoTrackMutex);
-        if ( trackTime == args.getStart() ) {
-            bool foundStartMarker = autoTrack->GetMarker(0, trackTime, trackIndex, &track->mvMarker);
-            assert(foundStartMarker);
-            Q_UNUSED(foundStartMarker);
-            track->mvMarker.source = mv::Marker::MANUAL;
-        } else {
-            natronTrackerToLibMVTracker(false, enabledChans, *track->natronMarker, trackIndex, trackTime, args.getStep(), args.getFormatHeight(), &track->mvMarker);
-            autoTrack->AddMarker(track->mvMarker);
-        }
+    // Add a marker to the auto-track at the tracked time: the mv::Marker struct is filled with the values of the Natron TrackMarker at the trackTime
+    if ( trackTime == args.getStart() ) {
+        bool foundStartMarker = autoTrack->GetMarker(0, trackTime, trackIndex, &track->mvMarker);
+        assert(foundStartMarker);
+        Q_UNUSED(foundStartMarker);
+        track->mvMarker.source = mv::Marker::MANUAL;
+    } else {
+        natronTrackerToLibMVTracker(false, enabledChans, *track->natronMarker, trackIndex, trackTime, args.getStep(), args.getFormatHeight(), &track->mvMarker);
+        autoTrack->AddMarker(track->mvMarker);
     }
 
     if (track->mvMarker.source == mv::Marker::MANUAL) {
@@ -1061,7 +1060,6 @@ TrackerContextPrivate::trackStepLibMV(int trackIndex,
     } else {
         // Make sure the reference frame is in the auto-track: the mv::Marker struct is filled with the values of the Natron TrackMarker at the reference_frame
         {
-            QMutexLocker k(autoTrackMutex);
             mv::Marker m;
             if ( !autoTrack->GetMarker(0, track->mvMarker.reference_frame, trackIndex, &m) ) {
                 natronTrackerToLibMVTracker(true, enabledChans, *track->natronMarker, track->mvMarker.track, track->mvMarker.reference_frame, args.getStep(), args.getFormatHeight(), &m);
@@ -1101,7 +1099,6 @@ TrackerContextPrivate::trackStepLibMV(int trackIndex,
 
         //Add the marker to the autotrack
         /*{
-           QMutexLocker k(autoTrackMutex);
            autoTrack->AddMarker(track->mvMarker);
            }*/
     } // if (track->mvMarker.source == mv::Marker::MANUAL) {
@@ -1110,6 +1107,71 @@ TrackerContextPrivate::trackStepLibMV(int trackIndex,
     return true;
 } // TrackerContextPrivate::trackStepLibMV
 
+void
+TrackerContextPrivate::prefetchTrackStepImages(const TrackArgs& args,
+                                               int trackTime)
+{
+    boost::shared_ptr<TrackerFrameAccessor> accessor = args.getFrameAccessor();
+    const std::vector<boost::shared_ptr<TrackMarkerAndOptions> >& tracks = args.getTracks();
+    const int formatHeight = (int)args.getFormatHeight();
+    bool enabledChans[3];
+
+    args.getEnabledChannels(&enabledChans[0], &enabledChans[1], &enabledChans[2]);
+
+    // The union of the regions read by the tracks at each frame
+    std::map<int, RectI> framesRoI;
+    for (std::size_t i = 0; i < tracks.size(); ++i) {
+        const boost::shared_ptr<TrackMarkerAndOptions>& track = tracks[i];
+        if ( dynamic_cast<TrackMarkerPM*>( track->natronMarker.get() ) || !track->natronMarker->isEnabled(trackTime) ) {
+            continue;
+        }
+        if ( ( trackTime == args.getStart() ) || track->natronMarker->isUserKeyframe(trackTime) ) {
+            // Not tracked, see trackStepLibMV
+            continue;
+        }
+
+        // The search region at the tracked time is the one predicted by TrackMarker: predict it with a copy of the
+        // state so that the state of the track is left untouched
+        mv::Marker trackedMarker;
+        mv::KalmanFilterState state = track->mvState;
+        state.PredictForward(trackTime, &trackedMarker);
+
+        // The reference marker is the one trackStepLibMV will find or add in the auto-track
+        int referenceFrame = track->natronMarker->getReferenceFrame(trackTime, args.getStep());
+        mv::Marker referenceMarker;
+        if ( !track->mvAutoTrack->GetMarker(0, referenceFrame, (int)i, &referenceMarker) ) {
+            natronTrackerToLibMVTracker(true, enabledChans, *track->natronMarker, (int)i, referenceFrame, args.getStep(), args.getFormatHeight(), &referenceMarker);
+        }
+
+        const mv::Marker* markers[2] = {&trackedMarker, &referenceMarker};
+        for (int m = 0; m < 2; ++m) {
+            // Same rounding as the one applied by libmv before calling TrackerFrameAccessor::GetImage
+            RectI roi;
+            TrackerFrameAccessor::convertLibMVRegionToRectI(markers[m]->search_region.Rounded(), formatHeight, &roi);
+            if ( roi.isNull() ) {
+                continue;
+            }
+            std::map<int, RectI>::iterator found = framesRoI.find(markers[m]->frame);
+            if ( found == framesRoI.end() ) {
+                framesRoI.insert( std::make_pair(markers[m]->frame, roi) );
+            } else {
+                found->second.merge(roi);
+            }
+        }
+    }
+
+    // Frames that no track reads anymore are released, the others are rendered if their previous image does not contain
+    // the new union. A frame which fails to render is left to the frame accessor, which renders each region.
+    std::set<int> frames;
+    for (std::map<int, RectI>::iterator it = framesRoI.begin(); it != framesRoI.end(); ++it) {
+        frames.insert(it->first);
+    }
+    accessor->releasePrefetchedFrames(frames);
+    for (std::map<int, RectI>::iterator it = framesRoI.begin(); it != framesRoI.end(); ++it) {
+        accessor->prefetchFrame(it->first, 0, it->second);
+    }
+} // TrackerContextPrivate::prefetchTrackStepImages
+
 struct PreviouslyComputedTrackFrame
 {
     int frame;
@@ -1167,7 +1229,6 @@ TrackerContext::trackMarkers(const std::list<TrackMarkerPtr >& markers,
     
     /// The accessor and its cache is local to a track operation, it is wiped once the whole sequence track is finished.
     boost::shared_ptr<TrackerFrameAccessor> accessor( new TrackerFrameAccessor(this, enabledChannels, formatHeight) );
-    boost::shared_ptr<mv::AutoTrack> trackContext( new mv::AutoTrack( accessor.get() ) );
     std::vector<boost::shared_ptr<TrackMarkerAndOptions> > trackAndOptions;
     mv::TrackRegionOptions mvOptions;
     /*
@@ -1190,6 +1251,7 @@ TrackerContext::trackMarkers(const std::list<TrackMarkerPtr >& markers,
         
         boost::shared_ptr<TrackMarkerAndOptions> t(new TrackMarkerAndOptions);
         t->natronMarker = *it;
+        t->mvAutoTrack.reset( new mv::AutoTrack( accessor.get() ) );
 
         // Set a keyframe on the marker to initialize its position
         (*it)->setKeyFrameOnCenterAndPatternAtTime(start);
@@ -1247,7 +1309,7 @@ TrackerContext::trackMarkers(const std::list<TrackMarkerPtr >& markers,
                     mv::Marker mvMarker;
 
                     TrackerContextPrivate::natronTrackerToLibMVTracker(true, enabledChannels, *t->natronMarker, trackIndex, prevFramesIt->frame, frameStep, formatHeight, &mvMarker);
-                    trackContext->AddMarker(mvMarker);
+                    t->mvAutoTrack->AddMarker(mvMarker);
 
                     // insert in the front of the list so that the order is reversed
                     previouslyComputedMarkersOrdered.push_front(mvMarker);
@@ -1263,7 +1325,7 @@ TrackerContext::trackMarkers(const std::list<TrackMarkerPtr >& markers,
                     mv::Marker mvMarker;
 
                     TrackerContextPrivate::natronTrackerToLibMVTracker(true, enabledChannels, *t->natronMarker, trackIndex, prevFramesIt->frame, frameStep, formatHeight, &mvMarker);
-                    trackContext->AddMarker(mvMarker);
+                    t->mvAutoTrack->AddMarker(mvMarker);
 
                     // insert in the front of the list so that the order is reversed
                     previouslyComputedMarkersOrdered.push_front(mvMarker);
@@ -1273,7 +1335,7 @@ TrackerContext::trackMarkers(const std::list<TrackMarkerPtr >& markers,
                     mv::Marker mvMarker;
 
                     TrackerContextPrivate::natronTrackerToLibMVTracker(true, enabledChannels, *t->natronMarker, trackIndex, prevFramesIt->frame, frameStep, formatHeight, &mvMarker);
-                    trackContext->AddMarker(mvMarker);
+                    t->mvAutoTrack->AddMarker(mvMarker);
 
                     // insert in the front of the list so that the order is reversed
                     previouslyComputedMarkersOrdered.push_front(mvMarker);
@@ -1311,7 +1373,7 @@ TrackerContext::trackMarkers(const std::list<TrackMarkerPtr >& markers,
     /*
        Launch tracking in the scheduler thread.
      */
-    boost::shared_ptr<TrackArgs> args( new TrackArgs(start, end, frameStep, getNode()->getApp()->getTimeLine(), viewer, trackContext, accessor, trackAndOptions, formatWidth, formatHeight, autoKeyingOnEnabledParamEnabled) );
+    boost::shared_ptr<TrackArgs> args( new TrackArgs(start, end, frameStep, getNode()->getApp()->getTimeLine(), viewer, accessor, trackAndOptions, formatWidth, formatHeight, autoKeyingOnEnabledParamEnabled) );
     _imp->scheduler.track(args);
 } // TrackerContext::trackMarkers
 
@@ -341,6 +341,10 @@ struct TrackMarkerAndOptions
     mv::Marker mvMarker;
     mv::TrackRegionOptions mvOptions;
     mv::KalmanFilterState mvState;
+
+    // Each track has its own auto-track, all sharing the frame accessor, so that the tracks are solved in parallel
+    // without locking
+    boost::shared_ptr<mv::AutoTrack> mvAutoTrack;
 };
 
 
@@ -554,6 +558,14 @@ public:
                                            const libmv::TrackRegionResult* result,
                                            const TrackMarkerPtr& natronMarker);
     static bool trackStepLibMV(int trackIndex, const TrackArgs& args, int time);
+
+    /**
+     * @brief Renders once, for each frame that the libmv tracks read to track the given time, the union of the regions
+     * they read, so that the frame accessor crops their regions out of it instead of rendering each of them.
+     * The search region of each track is predicted with a copy of its Kalman filter state, as trackStepLibMV will.
+     * This must be called before the tracks are stepped at this time, and not concurrently with them.
+     **/
+    static void prefetchTrackStepImages(const TrackArgs& args, int time);
     static bool trackStepTrackerPM(TrackMarkerPM* tracker, const TrackArgs& args, int time);
 
 
@@ -114,6 +114,9 @@ struct FrameAccessorCacheEntry
 {
     boost::shared_ptr<MvFloatImage> image;
 
+    // The region requested by libmv
+    RectI roi;
+
     // If null, this is the full image
     RectI bounds;
     unsigned int referenceCount;
@@ -121,6 +124,15 @@ struct FrameAccessorCacheEntry
 
 typedef std::multimap<FrameAccessorCacheKey, FrameAccessorCacheEntry, CacheKey_compare_less > FrameAccessorCache;
 
+// An image of the input rendered once for the regions of all the tracks at a frame
+struct PrefetchedFrame
+{
+    ImagePtr image;
+    RectI roi;
+};
+
+typedef std::map<FrameAccessorCacheKey, PrefetchedFrame, CacheKey_compare_less > PrefetchedFrames;
+
 
 template <bool doR, bool doG, bool doB>
 void
@@ -200,6 +212,24 @@ natronImageToLibMvFloatImage(bool enabledChannels[3],
         }
     }
 }
+
+struct FetchInfos
+{
+    QMutex lock;
+    U64 nbFramesPrefetched;
+    U64 nbFramesReleased;
+    U64 nbRegionsRendered;
+
+    FetchInfos()
+        : lock()
+        , nbFramesPrefetched(0)
+        , nbFramesReleased(0)
+        , nbRegionsRendered(0)
+    {
+    }
+};
+
+FetchInfos fetchInfos;
 } // anon namespace
 
 
@@ -209,6 +239,9 @@ struct TrackerFrameAccessorPrivate
     boost::shared_ptr<Node> trackerInput;
     mutable QMutex cacheMutex;
     FrameAccessorCache cache;
+
+    // Protected by cacheMutex
+    PrefetchedFrames prefetchedFrames;
     bool enabledChannels[3];
     int formatHeight;
 
@@ -219,6 +252,7 @@ struct TrackerFrameAccessorPrivate
         , trackerInput()
         , cacheMutex()
         , cache()
+        , prefetchedFrames()
         , enabledChannels()
         , formatHeight(formatHeight)
     {
@@ -228,8 +262,92 @@ struct TrackerFrameAccessorPrivate
             this->enabledChannels[i] = enabledChannels[i];
         }
     }
+
+    /**
+     * @brief Returns the prefetched image of the frame if it contains roi, or NULL.
+     **/
+    ImagePtr getPrefetchedImage(const FrameAccessorCacheKey& key,
+                                const RectI& roi) const
+    {
+        QMutexLocker k(&cacheMutex);
+        PrefetchedFrames::const_iterator found = prefetchedFrames.find(key);
+
+        if ( ( found == prefetchedFrames.end() ) || !found->second.roi.contains(roi) ) {
+            return ImagePtr();
+        }
+
+        return found->second.image;
+    }
+
+    /**
+     * @brief Renders roi of the input of the tracker in RGB float. If precomputedRoD is not null, roi is the whole image.
+     **/
+    ImagePtr renderImage(int frame,
+                         int downscale,
+                         const RectI& roi,
+                         const RectD& precomputedRoD) const;
 };
 
+ImagePtr
+TrackerFrameAccessorPrivate::renderImage(int frame,
+                                         int downscale,
+                                         const RectI& roi,
+                                         const RectD& precomputedRoD) const
+{
+    RenderScale scale;
+
+    scale.y = scale.x = Image::getScaleFromMipMapLevel( (unsigned int)downscale );
+
+    std::list<ImageComponents> components;
+    components.push_back( ImageComponents::getRGBComponents() );
+
+    NodePtr node = context->getNode();
+    const bool isRenderUserInteraction = true;
+    const bool isSequentialRender = false;
+    AbortableRenderInfoPtr abortInfo( new AbortableRenderInfo(false, 0) );
+    AbortableThread* isAbortable = dynamic_cast<AbortableThread*>( QThread::currentThread() );
+    if (isAbortable) {
+        isAbortable->setAbortInfo( isRenderUserInteraction, abortInfo, node->getEffectInstance() );
+    }
+    ParallelRenderArgsSetter frameRenderArgs( frame,
+                                              ViewIdx(0), //<  view 0 (left)
+                                              isRenderUserInteraction, //<isRenderUserInteraction
+                                              isSequentialRender, //isSequential
+                                              abortInfo, //abort info
+                                              node, //  requester
+                                              0, //texture index
+                                              node->getApp()->getTimeLine().get(), //Timeline
+                                              NodePtr(), // rotoPaintNode
+                                              true, //isAnalysis
+                                              false, //draftMode
+                                              boost::shared_ptr<RenderStats>() ); // Stats
+    EffectInstance::RenderRoIArgs args( frame,
+                                        scale,
+                                        downscale,
+                                        ViewIdx(0),
+                                        false,
+                                        roi,
+                                        precomputedRoD,
+                                        components,
+                                        eImageBitDepthFloat,
+                                        true,
+                                        node->getEffectInstance().get(),
+                                        eStorageModeRAM /*returnOpenGLTex*/,
+                                        frame);
+    std::map<ImageComponents, ImagePtr> planes;
+    EffectInstance::RenderRoIRetCode stat = trackerInput->getEffectInstance()->renderRoI(args, &planes);
+    if ( (stat != EffectInstance::eRenderRoIRetCodeOk) || planes.empty() ) {
+#ifdef TRACE_LIB_MV
+        qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Failed to call renderRoI on input at frame" << frame << "with RoI x1="
+                 << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2;
+#endif
+
+        return ImagePtr();
+    }
+
+    return planes.begin()->second;
+} // TrackerFrameAccessorPrivate::renderImage
+
 TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
                                            bool enabledChannels[3],
                                            int formatHeight)
@@ -240,6 +358,7 @@ TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
 
 TrackerFrameAccessor::~TrackerFrameAccessor()
 {
+    releasePrefetchedFrames( std::set<int>() );
 }
 
 void
@@ -270,6 +389,83 @@ TrackerFrameAccessor::convertLibMVRegionToRectI(const mv::Region& region,
     roi->y2 = invertYCoordinate(region.min(1), formatHeight);
 }
 
+bool
+TrackerFrameAccessor::prefetchFrame(int frame,
+                                    int downscale,
+                                    const RectI& roi)
+{
+    FrameAccessorCacheKey key;
+
+    key.frame = frame;
+    key.mipMapLevel = downscale;
+    key.mode = mv::FrameAccessor::MONO;
+
+    if ( _imp->getPrefetchedImage(key, roi) ) {
+        return true;
+    }
+
+    ImagePtr image = _imp->renderImage( frame, downscale, roi, RectD() );
+    if (!image) {
+        return false;
+    }
+
+    {
+        QMutexLocker k(&fetchInfos.lock);
+        ++fetchInfos.nbFramesPrefetched;
+    }
+
+    QMutexLocker k(&_imp->cacheMutex);
+    PrefetchedFrame& prefetched = _imp->prefetchedFrames[key];
+    prefetched.image = image;
+    prefetched.roi = roi;
+
+    return true;
+}
+
+void
+TrackerFrameAccessor::releasePrefetchedFrames(const std::set<int>& framesToKeep)
+{
+    U64 nbReleased = 0;
+    {
+        QMutexLocker k(&_imp->cacheMutex);
+
+        for (PrefetchedFrames::iterator it = _imp->prefetchedFrames.begin(); it != _imp->prefetchedFrames.end();) {
+            if ( framesToKeep.find(it->first.frame) == framesToKeep.end() ) {
+                _imp->prefetchedFrames.erase(it++);
+                ++nbReleased;
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (nbReleased) {
+        QMutexLocker k(&fetchInfos.lock);
+        fetchInfos.nbFramesReleased += nbReleased;
+    }
+}
+
+void
+TrackerFrameAccessor::getFetchInfos(U64* nbFramesPrefetched,
+                                    U64* nbFramesReleased,
+                                    U64* nbRegionsRendered)
+{
+    QMutexLocker k(&fetchInfos.lock);
+
+    *nbFramesPrefetched = fetchInfos.nbFramesPrefetched;
+    *nbFramesReleased = fetchInfos.nbFramesReleased;
+    *nbRegionsRendered = fetchInfos.nbRegionsRendered;
+}
+
+void
+TrackerFrameAccessor::resetFetchInfos()
+{
+    QMutexLocker k(&fetchInfos.lock);
+
+    fetchInfos.nbFramesPrefetched = 0;
+    fetchInfos.nbFramesReleased = 0;
+    fetchInfos.nbRegionsRendered = 0;
+}
+
 /*
  * @brief This is called by LibMV to retrieve an image either for reference or as search frame.
  */
@@ -293,7 +489,8 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     key.mode = input_mode;
 
     /*
-       Check if a frame exists in the cache with matching key and bounds enclosing the given region
+       Check if a frame exists in the cache with matching key and region: libmv addresses the returned image
+       relatively to the bottom-left corner of the region, so an image of a larger region cannot be returned
      */
     RectI roi;
     if (region) {
@@ -302,8 +499,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
         QMutexLocker k(&_imp->cacheMutex);
         std::pair<FrameAccessorCache::iterator, FrameAccessorCache::iterator> range = _imp->cache.equal_range(key);
         for (FrameAccessorCache::iterator it = range.first; it != range.second; ++it) {
-            if ( (roi.x1 >= it->second.bounds.x1) && (roi.x2 <= it->second.bounds.x2) &&
-                 ( roi.y1 >= it->second.bounds.y1) && ( roi.y2 <= it->second.bounds.y2) ) {
+            if (it->second.roi == roi) {
 #ifdef TRACE_LIB_MV
                 qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Found cached image at frame" << frame << "with RoI x1="
                          << region->min(0) << "y1=" << region->max(1) << "x2=" << region->max(0) << "y2=" << region->min(1);
@@ -320,13 +516,11 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
         }
     }
 
-    // Not in accessor cache, call renderRoI
-    RenderScale scale;
-    scale.y = scale.x = Image::getScaleFromMipMapLevel( (unsigned int)downscale );
-
-
     RectD precomputedRoD;
     if (!region) {
+        RenderScale scale;
+        scale.y = scale.x = Image::getScaleFromMipMapLevel( (unsigned int)downscale );
+
         bool isProjectFormat;
         StatusEnum stat = _imp->trackerInput->getEffectInstance()->getRegionOfDefinition_public(_imp->trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
         if (stat == eStatusFailed) {
@@ -336,55 +530,21 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
         precomputedRoD.toPixelEnclosing( (unsigned int)downscale, par, &roi );
     }
 
-    std::list<ImageComponents> components;
-    components.push_back( ImageComponents::getRGBComponents() );
-
-    NodePtr node = _imp->context->getNode();
-    const bool isRenderUserInteraction = true;
-    const bool isSequentialRender = false;
-    AbortableRenderInfoPtr abortInfo( new AbortableRenderInfo(false, 0) );
-    AbortableThread* isAbortable = dynamic_cast<AbortableThread*>( QThread::currentThread() );
-    if (isAbortable) {
-        isAbortable->setAbortInfo( isRenderUserInteraction, abortInfo, node->getEffectInstance() );
+    // Crop the region out of the image prefetched for all the tracks at this frame if it contains it
+    ImagePtr sourceImage;
+    if (region) {
+        sourceImage = _imp->getPrefetchedImage(key, roi);
     }
-    ParallelRenderArgsSetter frameRenderArgs( frame,
-                                              ViewIdx(0), //<  view 0 (left)
-                                              isRenderUserInteraction, //<isRenderUserInteraction
-                                              isSequentialRender, //isSequential
-                                              abortInfo, //abort info
-                                              node, //  requester
-                                              0, //texture index
-                                              node->getApp()->getTimeLine().get(), //Timeline
-                                              NodePtr(), // rotoPaintNode
-                                              true, //isAnalysis
-                                              false, //draftMode
-                                              boost::shared_ptr<RenderStats>() ); // Stats
-    EffectInstance::RenderRoIArgs args( frame,
-                                        scale,
-                                        downscale,
-                                        ViewIdx(0),
-                                        false,
-                                        roi,
-                                        precomputedRoD,
-                                        components,
-                                        eImageBitDepthFloat,
-                                        true,
-                                        _imp->context->getNode()->getEffectInstance().get(),
-                                        eStorageModeRAM /*returnOpenGLTex*/,
-                                        frame);
-    std::map<ImageComponents, ImagePtr> planes;
-    EffectInstance::RenderRoIRetCode stat = _imp->trackerInput->getEffectInstance()->renderRoI(args, &planes);
-    if ( (stat != EffectInstance::eRenderRoIRetCodeOk) || planes.empty() ) {
-#ifdef TRACE_LIB_MV
-        qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Failed to call renderRoI on input at frame" << frame << "with RoI x1="
-                 << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2;
-#endif
-
-        return (mv::FrameAccessor::Key)0;
+    if (!sourceImage) {
+        // Not prefetched, call renderRoI
+        sourceImage = _imp->renderImage(frame, downscale, roi, precomputedRoD);
+        if (!sourceImage) {
+            return (mv::FrameAccessor::Key)0;
+        }
+        QMutexLocker k(&fetchInfos.lock);
+        ++fetchInfos.nbRegionsRendered;
     }
 
-    assert( !planes.empty() );
-    const ImagePtr& sourceImage = planes.begin()->second;
     RectI sourceBounds = sourceImage->getBounds();
     RectI intersectedRoI;
     if ( !roi.intersect(sourceBounds, &intersectedRoI) ) {
@@ -406,6 +566,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
      */
     FrameAccessorCacheEntry entry;
     entry.image.reset( new MvFloatImage( intersectedRoI.height(), intersectedRoI.width() ) );
+    entry.roi = roi;
     entry.bounds = intersectedRoI;
     entry.referenceCount = 1;
     natronImageToLibMvFloatImage(_imp->enabledChannels,
@@ -27,6 +27,10 @@
 
 #include "Global/Macros.h"
 
+#include <set>
+
+#include "Global/GlobalDefines.h"
+
 #include "Engine/EngineFwd.h"
 
 #include <libmv/autotrack/frame_accessor.h>
@@ -49,6 +53,30 @@ public:
 
     void getEnabledChannels(bool* r, bool* g, bool* b) const;
 
+    /**
+     * @brief Renders roi of the input at the given frame once, so that GetImage crops the regions it contains out of it
+     * instead of rendering each of them. This is used to render the union of the regions of all the tracks at a frame.
+     * If the frame was already prefetched with a region containing roi, this does nothing.
+     * Returns false if the render failed, in which case GetImage renders the regions individually.
+     **/
+    bool prefetchFrame(int frame, int downscale, const RectI& roi);
+
+    /**
+     * @brief Releases the images prefetched at frames that are not in framesToKeep.
+     **/
+    void releasePrefetchedFrames(const std::set<int>& framesToKeep);
+
+    /**
+     * @brief Input fetch counters of all the frame accessors: nbFramesPrefetched is the number of renders made by prefetchFrame,
+     * nbFramesReleased the number of prefetched images released and nbRegionsRendered the number of renders GetImage
+     * had to make itself because the region was not prefetched. These are global to the process,
+     * so that they can still be read once the accessor of a track is gone.
+     **/
+    static void getFetchInfos(U64* nbFramesPrefetched,
+                              U64* nbFramesReleased,
+                              U64* nbRegionsRendered);
+    static void resetFetchInfos();
+
 
     // Get a possibly-filtered version of a frame of a video. Downscale will
     // cause the input image to get downscaled by 2^downscale for pyramid access.
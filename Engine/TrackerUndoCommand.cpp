@@ -27,6 +27,7 @@
 #include "Engine/TrackerContext.h"
 #include "Engine/Node.h"
 #include "Engine/AppInstance.h"
+#include "Engine/Project.h"
 
 
 NATRON_NAMESPACE_ENTER;
@@ -55,6 +56,7 @@ AddTrackCommand::undo()
         context->removeMarker(*it);
     }
     context->endEditSelection(TrackerContext::eTrackSelectionInternal);
+    context->getNode()->getApp()->getProject()->journalNodeChanged( context->getNode() );
     context->getNode()->getApp()->triggerAutoSave();
 }
 
@@ -73,6 +75,7 @@ AddTrackCommand::redo()
         context->addTrackToSelection(*it, TrackerContext::eTrackSelectionInternal);
     }
     context->endEditSelection(TrackerContext::eTrackSelectionInternal);
+    context->getNode()->getApp()->getProject()->journalNodeChanged( context->getNode() );
     context->getNode()->getApp()->triggerAutoSave();
 }
 
@@ -116,6 +119,7 @@ RemoveTracksCommand::undo()
         context->addTrackToSelection(it->track, TrackerContext::eTrackSelectionInternal);
     }
     context->endEditSelection(TrackerContext::eTrackSelectionInternal);
+    context->getNode()->getApp()->getProject()->journalNodeChanged( context->getNode() );
     context->getNode()->getApp()->triggerAutoSave();
 }
 
@@ -138,6 +142,7 @@ RemoveTracksCommand::redo()
         context->addTrackToSelection(nextMarker, TrackerContext::eTrackSelectionInternal);
     }
     context->endEditSelection(TrackerContext::eTrackSelectionInternal);
+    context->getNode()->getApp()->getProject()->journalNodeChanged( context->getNode() );
     context->getNode()->getApp()->triggerAutoSave();
 }
 
@@ -77,6 +77,7 @@ CLANG_DIAG_ON(deprecated)
 #endif
 
 #define NATRON_TIME_ELASPED_BEFORE_PROGRESS_REPORT 4. //!< do not display the progress report if estimated total time is less than this (in seconds)
+#define NATRON_VIEWER_PLAYBACK_PREFETCH_FRAMES 4 //!< number of frames ahead of the playback whose cached tiles are read in the background
 
 NATRON_NAMESPACE_ENTER;
 
@@ -120,6 +121,37 @@ static void renderFunctor(const RectI& roi,
                           ViewerInstance* viewer,
                           UpdateViewerParams::CachedTile tile);
 
+/**
+ * @brief Returns the key of the viewer cache tile covering rect for the given time
+ **/
+static FrameKey
+makeViewerTileKey(const ViewerInstance* viewer,
+                  const ViewerArgs & args,
+                  double time,
+                  U64 viewerHash,
+                  const TextureRect& rect,
+                  unsigned int mipmapLevel,
+                  const std::string& inputToRenderName,
+                  bool isDraftMode)
+{
+    return FrameKey(viewer->getNode().get(),
+                    time,
+                    viewerHash,
+                    args.params->gain,
+                    args.params->gamma,
+                    args.params->lut,
+                    (int)args.params->depth,
+                    args.channels,
+                    args.params->view,
+                    rect,
+                    mipmapLevel,
+                    inputToRenderName,
+                    args.params->layer,
+                    args.params->alphaLayer.getLayerName() + args.params->alphaChannelName,
+                    args.params->depth == eImageBitDepthFloat,
+                    isDraftMode);
+}
+
 /**
  *@brief Actually converting to ARGB... but it is called BGRA by
    the texture format GL_UNSIGNED_INT_8_8_8_8_REV
@@ -828,6 +860,73 @@ ViewerInstance::getRenderViewerArgsAndCheckCache_public(SequenceTime time,
     return stat;
 }
 
+AbortableRenderInfoPtr
+ViewerInstance::createRenderRequest(int textureIndex,
+                                    bool canAbort)
+{
+    return _imp->createNewRenderRequest(textureIndex, canAbort);
+}
+
+ViewerInstance::ViewerRenderRetCode
+ViewerInstance::prefetchFrame(SequenceTime time,
+                              ViewIdx view,
+                              U64 viewerHash,
+                              const AbortableRenderInfoPtr abortInfos[2])
+{
+    boost::shared_ptr<ViewerArgs> args[2];
+    bool hasTextureToRender = false;
+
+    if (!_imp->uiContext) {
+        return eViewerRenderRetCodeFail;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        args[i].reset(new ViewerArgs);
+        args[i]->forceRender = false;
+        ViewerRenderRetCode stat = getRenderViewerArgsAndCheckCache( time, true, view, i, viewerHash, NodePtr(), abortInfos[i], boost::shared_ptr<RenderStats>(), args[i].get() );
+
+        if (args[i]->forceRender) {
+            // The next render of the current frame must still by-pass the cache
+            QMutexLocker forceRenderLocker(&_imp->forceRenderMutex);
+            _imp->forceRender[i] = true;
+        }
+
+        // Do not display anything: a failed or black frame will be rendered again by playback, which handles it
+        if ( (stat != eViewerRenderRetCodeRender) || !args[i]->params || args[i]->params->isViewerPaused ||
+             ( !args[i]->mustComputeRoDAndLookupCache && ( args[i]->params->nbCachedTile == (int)args[i]->params->tiles.size() ) ) ||
+             args[i]->forceRender || args[i]->userRoIEnabled || args[i]->autoContrast || args[i]->isDoingPartialUpdates ) {
+            args[i].reset();
+        } else {
+            hasTextureToRender = true;
+        }
+    }
+
+    if (!hasTextureToRender) {
+        return eViewerRenderRetCodeRedraw;
+    }
+
+    /*
+       Rendered as playback: the render is not compared to the renders displayed by the viewer and only its abort info can abort it.
+       Unlike renderViewer(), the textures displayed are never touched whatever the result.
+     */
+    ViewerRenderRetCode ret = eViewerRenderRetCodeRedraw;
+    for (int i = 0; i < 2; ++i) {
+        if (!args[i]) {
+            continue;
+        }
+        ViewerRenderRetCode stat = renderViewer_internal(view, false, true, viewerHash, true, NodePtr(), true, boost::shared_ptr<ViewerCurrentFrameRequestSchedulerStartArgs>(),
+                                                         boost::shared_ptr<RenderStats>(), *args[i]);
+        args[i]->isRenderingFlag.reset();
+        if (stat == eViewerRenderRetCodeFail) {
+            return stat;
+        } else if (stat == eViewerRenderRetCodeRender) {
+            ret = stat;
+        }
+    }
+
+    return ret;
+} // ViewerInstance::prefetchFrame
+
 void
 ViewerInstance::setupMinimalUpdateViewerParams(const SequenceTime time,
                                                const ViewIdx view,
@@ -1048,22 +1147,7 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
     if (useCache) {
         FrameEntryLocker entryLocker(_imp.get());
         for (std::list<UpdateViewerParams::CachedTile>::iterator it = outArgs->params->tiles.begin(); it != outArgs->params->tiles.end(); ++it) {
-            FrameKey key(getNode().get(),
-                         outArgs->params->time,
-                         viewerHash,
-                         outArgs->params->gain,
-                         outArgs->params->gamma,
-                         outArgs->params->lut,
-                         (int)outArgs->params->depth,
-                         outArgs->channels,
-                         outArgs->params->view,
-                         it->rect,
-                         mipmapLevel,
-                         inputToRenderName,
-                         outArgs->params->layer,
-                         outArgs->params->alphaLayer.getLayerName() + outArgs->params->alphaChannelName,
-                         outArgs->params->depth == eImageBitDepthFloat,
-                         isDraftMode);
+            FrameKey key = makeViewerTileKey(this, *outArgs, outArgs->params->time, viewerHash, it->rect, mipmapLevel, inputToRenderName, isDraftMode);
             std::list<FrameEntryPtr> entries;
             bool hasTextureCached = appPTR->getTexture(key, &entries);
             if ( stats  && stats->isInDepthProfilingEnabled() ) {
@@ -1116,6 +1200,21 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
                 it->ramBuffer = foundCachedEntry->data();
                 assert(it->ramBuffer);
                 ++outArgs->params->nbCachedTile;
+
+                // The tile points directly into the tile cache file mapping: if it was paged out, read it back
+                // in one go rather than page by page when the texture is uploaded
+                foundCachedEntry->prefetchData();
+            }
+        }
+
+        // During playback, do the same for the tiles of the next frames so that the texture upload never waits for the disk
+        if (outArgs->params->isSequential) {
+            const int step = getRenderEngine()->getPlaybackDirection() == eRenderDirectionForward ? 1 : -1;
+            for (int i = 1; i <= NATRON_VIEWER_PLAYBACK_PREFETCH_FRAMES; ++i) {
+                const double prefetchTime = outArgs->params->time + i * step;
+                for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = outArgs->params->tiles.begin(); it != outArgs->params->tiles.end(); ++it) {
+                    appPTR->prefetchTexture( makeViewerTileKey(this, *outArgs, prefetchTime, viewerHash, it->rect, mipmapLevel, inputToRenderName, isDraftMode) );
+                }
             }
         }
     }
@@ -1725,22 +1824,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                     assert(!it->ramBuffer);
 
 
-                    FrameKey key(getNode().get(),
-                                 inArgs.params->time,
-                                 viewerHash,
-                                 inArgs.params->gain,
-                                 inArgs.params->gamma,
-                                 inArgs.params->lut,
-                                 (int)inArgs.params->depth,
-                                 inArgs.channels,
-                                 inArgs.params->view,
-                                 it->rect,
-                                 inArgs.params->mipMapLevel,
-                                 inputToRenderName,
-                                 inArgs.params->layer,
-                                 inArgs.params->alphaLayer.getLayerName() + inArgs.params->alphaChannelName,
-                                 inArgs.params->depth == eImageBitDepthFloat,
-                                 inArgs.draftModeEnabled);
+                    FrameKey key = makeViewerTileKey(this, inArgs, inArgs.params->time, viewerHash, it->rect, inArgs.params->mipMapLevel, inputToRenderName, inArgs.draftModeEnabled);
 
 
 
@@ -1858,7 +1942,8 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                     vmin = vMinMax.min;
                     vmax = vMinMax.max;
                 } else {
-                    std::vector<RectI> splitRects = viewerRenderRoI.splitIntoSmallerRects( appPTR->getHardwareIdealThreadCount() );
+                    // Finding the min/max is bound by memory bandwidth: full-width strips read contiguous memory
+                    std::vector<RectI> splitRects = viewerRenderRoI.splitIntoRowStrips( appPTR->getHardwareIdealThreadCount() );
                     QFuture<MinMaxVal> future = QtConcurrent::mapped( splitRects,
                                                                                        boost::bind(findAutoContrastVminVmax,
                                                                                                    colorImage,
@@ -2116,7 +2201,6 @@ scaleToTexture8bits_generic(const RectI& roi,
                             const UpdateViewerParams::CachedTile& tile,
                             U32* tileBuffer)
 {
-    const size_t pixelSize = sizeof(PIX);
     const bool luminance = (args.channels == eDisplayChannelsY);
     Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
     const RectI srcImgBounds = args.inputImage->getBounds();
@@ -2170,36 +2254,36 @@ scaleToTexture8bits_generic(const RectI& roi,
                 int uA = 0;
                 double a = 0;
                 if (nComps >= 4) {
-                    r = (src_pixels ? src_pixels[index * nComps + rOffset] : 0.);
-                    g = (src_pixels ? src_pixels[index * nComps + gOffset] : 0.);
-                    b = (src_pixels ? src_pixels[index * nComps + bOffset] : 0.);
+                    r = (src_pixels ? (double)src_pixels[index * nComps + rOffset] : 0.);
+                    g = (src_pixels ? (double)src_pixels[index * nComps + gOffset] : 0.);
+                    b = (src_pixels ? (double)src_pixels[index * nComps + bOffset] : 0.);
                     if (opaque) {
                         a = 1;
                         uA = 255;
                     } else {
-                        a = src_pixels ? src_pixels[index * nComps + 3] : 0;
+                        a = src_pixels ? (double)src_pixels[index * nComps + 3] : 0;
                         uA = Color::floatToInt<256>(a);
                     }
                 } else if (nComps == 3) {
                     // coverity[dead_error_line]
-                    r = (src_pixels && rOffset < nComps) ? src_pixels[index * nComps + rOffset] : 0.;
+                    r = (src_pixels && rOffset < nComps) ? (double)src_pixels[index * nComps + rOffset] : 0.;
                     // coverity[dead_error_line]
-                    g = (src_pixels && gOffset < nComps) ? src_pixels[index * nComps + gOffset] : 0.;
+                    g = (src_pixels && gOffset < nComps) ? (double)src_pixels[index * nComps + gOffset] : 0.;
                     // coverity[dead_error_line]
-                    b = (src_pixels && bOffset < nComps) ? src_pixels[index * nComps + bOffset] : 0.;
+                    b = (src_pixels && bOffset < nComps) ? (double)src_pixels[index * nComps + bOffset] : 0.;
                     a = (src_pixels ? 1 : 0);
                     uA = a * 255;
                 } else if (nComps == 2) {
                     // coverity[dead_error_line]
-                    r = (src_pixels && rOffset < nComps) ? src_pixels[index * nComps + rOffset] : 0.;
+                    r = (src_pixels && rOffset < nComps) ? (double)src_pixels[index * nComps + rOffset] : 0.;
                     // coverity[dead_error_line]
-                    g = (src_pixels && gOffset < nComps) ? src_pixels[index * nComps + gOffset] : 0.;
+                    g = (src_pixels && gOffset < nComps) ? (double)src_pixels[index * nComps + gOffset] : 0.;
                     b = 0;
                     a = (src_pixels ? 1 : 0);
                     uA = a * 255;
                 } else if (nComps == 1) {
                     // coverity[dead_error_line]
-                    r = (src_pixels && rOffset < nComps) ? src_pixels[index * nComps + rOffset] : 0.;
+                    r = (src_pixels && rOffset < nComps) ? (double)src_pixels[index * nComps + rOffset] : 0.;
                     g = b = r;
                     a = (src_pixels ? 1 : 0);
                     uA = a * 255;
@@ -2208,8 +2292,8 @@ scaleToTexture8bits_generic(const RectI& roi,
                 }
 
 
-                switch (pixelSize) {
-                case sizeof(unsigned char):     //byte
+                switch (maxValue) {
+                case 255:     //byte
                     if (args.srcColorSpace) {
                         r = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)r );
                         g = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)g );
@@ -2220,7 +2304,7 @@ scaleToTexture8bits_generic(const RectI& roi,
                         b = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)b );
                     }
                     break;
-                case sizeof(unsigned short):     //short
+                case 65535:     //short
                     if (args.srcColorSpace) {
                         r = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)r );
                         g = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)g );
@@ -2231,7 +2315,7 @@ scaleToTexture8bits_generic(const RectI& roi,
                         b = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)b );
                     }
                     break;
-                case sizeof(float):     //float
+                case 1:     //float and half
                     if (args.srcColorSpace) {
                         r = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(r);
                         g = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(g);
@@ -2303,11 +2387,11 @@ scaleToTexture8bits_generic(const RectI& roi,
                         const PIX* src_pixels = (const PIX*)matteAcc->pixelAt(x1 + index, y);
                         if (src_pixels) {
                             alphaMatteValue = (double)src_pixels[args.alphaChannelIndex];
-                            switch (pixelSize) {
-                            case sizeof(unsigned char):     //byte
+                            switch (maxValue) {
+                            case 255:     //byte
                                 alphaMatteValue = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
                                 break;
-                            case sizeof(unsigned short):     //short
+                            case 65535:     //short
                                 alphaMatteValue = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned short)r );
                                 break;
                             default:
@@ -2491,7 +2575,7 @@ scaleToTexture8bits(const RectI& roi,
         scaleToTexture8bitsForDepth<unsigned short, 65535>(roi, args, viewer, tile, output);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        scaleToTexture8bitsForDepth<Half, 1>(roi, args, viewer, tile, output);
         break;
     case eImageBitDepthNone:
         break;
@@ -2536,7 +2620,6 @@ scaleToTexture32bitsGeneric(const RectI& roi,
                             const UpdateViewerParams::CachedTile& tile,
                             float *tileBuffer)
 {
-    const size_t pixelSize = sizeof(PIX);
     const bool luminance = (args.channels == eDisplayChannelsY);
     const int dstRowElements = args.renderOnlyRoI ? tile.rect.width() * 4 : args.tileRowElements;
     Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
@@ -2560,7 +2643,7 @@ scaleToTexture32bitsGeneric(const RectI& roi,
     const int y2 = args.renderOnlyRoI ? roi.y2 : tile.rect.y2;
     const int x1 = args.renderOnlyRoI ? roi.x1 : tile.rect.x1;
     const int x2 = args.renderOnlyRoI ? roi.x2 : tile.rect.x2;
-    const float* src_pixels = (const float*)acc.pixelAt(x1, y1);
+    const PIX* src_pixels = (const PIX*)acc.pixelAt(x1, y1);
     const int srcRowElements = (const int)args.inputImage->getRowElements();
 
     for (int y = y1; y < y2;
@@ -2574,32 +2657,32 @@ scaleToTexture32bitsGeneric(const RectI& roi,
             double a = 0.;
 
             if (nComps >= 4) {
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
-                g = (src_pixels && gOffset < nComps) ? src_pixels[x * nComps + gOffset] : 0.;
-                b = (src_pixels && bOffset < nComps) ? src_pixels[x * nComps + bOffset] : 0.;
+                r = (src_pixels && rOffset < nComps) ? (double)src_pixels[x * nComps + rOffset] : 0.;
+                g = (src_pixels && gOffset < nComps) ? (double)src_pixels[x * nComps + gOffset] : 0.;
+                b = (src_pixels && bOffset < nComps) ? (double)src_pixels[x * nComps + bOffset] : 0.;
                 if (opaque) {
                     a = 1.;
                 } else {
-                    a = src_pixels ? src_pixels[x * nComps + 3] : 0.;
+                    a = src_pixels ? (double)src_pixels[x * nComps + 3] : 0.;
                 }
             } else if (nComps == 3) {
                 // coverity[dead_error_line]
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
+                r = (src_pixels && rOffset < nComps) ? (double)src_pixels[x * nComps + rOffset] : 0.;
                 // coverity[dead_error_line]
-                g = (src_pixels && gOffset < nComps) ? src_pixels[x * nComps + gOffset] : 0.;
+                g = (src_pixels && gOffset < nComps) ? (double)src_pixels[x * nComps + gOffset] : 0.;
                 // coverity[dead_error_line]
-                b = (src_pixels && bOffset < nComps) ? src_pixels[x * nComps + bOffset] : 0.;
+                b = (src_pixels && bOffset < nComps) ? (double)src_pixels[x * nComps + bOffset] : 0.;
                 a = 1.;
             } else if (nComps == 2) {
                 // coverity[dead_error_line]
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
+                r = (src_pixels && rOffset < nComps) ? (double)src_pixels[x * nComps + rOffset] : 0.;
                 // coverity[dead_error_line]
-                g = (src_pixels && gOffset < nComps) ? src_pixels[x * nComps + gOffset] : 0.;
+                g = (src_pixels && gOffset < nComps) ? (double)src_pixels[x * nComps + gOffset] : 0.;
                 b = 0.;
                 a = 1.;
             } else if (nComps == 1) {
                 // coverity[dead_error_line]
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
+                r = (src_pixels && rOffset < nComps) ? (double)src_pixels[x * nComps + rOffset] : 0.;
                 g = b = r;
                 a = 1.;
             } else {
@@ -2607,8 +2690,8 @@ scaleToTexture32bitsGeneric(const RectI& roi,
             }
 
 
-            switch (pixelSize) {
-            case sizeof(unsigned char):
+            switch (maxValue) {
+            case 255:
                 if (args.srcColorSpace) {
                     r = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)r );
                     g = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)g );
@@ -2619,7 +2702,7 @@ scaleToTexture32bitsGeneric(const RectI& roi,
                     b = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)b );
                 }
                 break;
-            case sizeof(unsigned short):
+            case 65535:
                 if (args.srcColorSpace) {
                     r = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)r );
                     g = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)g );
@@ -2630,7 +2713,7 @@ scaleToTexture32bitsGeneric(const RectI& roi,
                     b = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)b );
                 }
                 break;
-            case sizeof(float):
+            case 1: //float and half
                 if (args.srcColorSpace) {
                     r = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(r);
                     g = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(g);
@@ -2671,11 +2754,11 @@ scaleToTexture32bitsGeneric(const RectI& roi,
                     const PIX* src_pixels = (const PIX*)matteAcc->pixelAt(x, y);
                     if (src_pixels) {
                         alphaMatteValue = (double)src_pixels[args.alphaChannelIndex];
-                        switch (pixelSize) {
-                        case sizeof(unsigned char):     //byte
+                        switch (maxValue) {
+                        case 255:     //byte
                             alphaMatteValue = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
                             break;
-                        case sizeof(unsigned short):     //short
+                        case 65535:     //short
                             alphaMatteValue = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned short)r );
                             break;
                         default:
@@ -2844,7 +2927,7 @@ scaleToTexture32bits(const RectI& roi,
         scaleToTexture32bitsForPremult<unsigned short, 65535>(roi, args, tile, output);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        scaleToTexture32bitsForPremult<Half, 1>(roi, args, tile, output);
         break;
     case eImageBitDepthNone:
         break;
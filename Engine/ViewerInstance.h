@@ -124,6 +124,21 @@ public:
                                                                 const boost::shared_ptr<RenderStats>& stats,
                                                                 ViewerArgs* outArgs);
 
+    /**
+     * @brief Returns the abort info identifying a new render of the given texture, to pass to prefetchFrame().
+     **/
+    AbortableRenderInfoPtr createRenderRequest(int textureIndex, bool canAbort);
+
+    /**
+     * @brief Renders the textures of the given frame into the ViewerCache without displaying them, as playback does.
+     * The render of each texture is identified by the given abort info, so that it can be aborted from another thread.
+     * Textures that are already cached or that would not be cached are not rendered.
+     **/
+    ViewerRenderRetCode prefetchFrame(SequenceTime time,
+                                      ViewIdx view,
+                                      U64 viewerHash,
+                                      const AbortableRenderInfoPtr abortInfos[2]) WARN_UNUSED_RETURN;
+
 private:
     /**
      * @brief Look-up the cache and try to find a matching texture for the portion to render.
@@ -0,0 +1,347 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "WritersRenderGroup.h"
+
+#include <algorithm> // max
+#include <cassert>
+#include <climits>
+#include <list>
+#include <map>
+#include <set>
+#include <utility>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include "Engine/Image.h"
+#include "Engine/Node.h"
+#include "Engine/OutputEffectInstance.h"
+#include "Engine/OutputSchedulerThread.h"
+
+// How long a waiting render thread sleeps before checking whether its render was aborted
+#define NATRON_WRITERS_RENDER_GROUP_WAIT_MS 100
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+struct WriterState
+{
+    NodeWPtr node;
+    const OutputEffectInstance* writer;
+    int firstFrame, lastFrame, frameStep;
+
+    // All the frames before this one are rendered
+    int lowWaterMark;
+
+    // The frames rendered after lowWaterMark
+    std::set<int> renderedFrames;
+};
+
+void
+collectUpstreamNodes(const NodePtr& node,
+                     std::set<Node*>* visited,
+                     std::list<NodePtr>* upstream)
+{
+    int maxInputs = node->getMaxInputCount();
+
+    for (int i = 0; i < maxInputs; ++i) {
+        NodePtr input = node->getInput(i);
+        if ( !input || !visited->insert( input.get() ).second ) {
+            continue;
+        }
+        upstream->push_back(input);
+        collectUpstreamNodes(input, visited, upstream);
+    }
+}
+}
+
+typedef std::list<WriterState> WriterStates;
+
+struct WritersRenderGroupPrivate
+{
+    // Protects all the fields below
+    mutable QMutex lock;
+
+    // Woken up whenever a writer renders a frame or leaves the group
+    QWaitCondition frameRenderedCond;
+    WriterStates writers;
+    std::map<const Node*, NodeWPtr> sharedNodes;
+
+    // A writer may start a frame this many frames ahead of the slowest other writer
+    int framesWindow;
+
+    // The pinned images and their size when they were pinned, by frame
+    std::map<int, std::map<ImagePtr, std::size_t> > pinnedImages;
+    std::size_t pinnedMemory;
+    std::size_t memoryBudget;
+
+    WritersRenderGroupPrivate(std::size_t memoryBudget)
+        : lock()
+        , frameRenderedCond()
+        , writers()
+        , sharedNodes()
+        , framesWindow( std::max(2, QThread::idealThreadCount() ) )
+        , pinnedImages()
+        , pinnedMemory(0)
+        , memoryBudget(memoryBudget)
+    {
+    }
+
+    WriterStates::iterator findWriter(const OutputEffectInstance* writer)
+    {
+        for (WriterStates::iterator it = writers.begin(); it != writers.end(); ++it) {
+            if (it->writer == writer) {
+                return it;
+            }
+        }
+
+        return writers.end();
+    }
+
+    bool canStartFrame(const WriterState& state,
+                       int time) const
+    {
+        for (WriterStates::const_iterator it = writers.begin(); it != writers.end(); ++it) {
+            if ( (&*it != &state) && (time >= it->lowWaterMark + framesWindow * it->frameStep) ) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Must be called with lock held
+    void releasePinnedImages()
+    {
+        int minLowWaterMark = INT_MAX;
+
+        for (WriterStates::const_iterator it = writers.begin(); it != writers.end(); ++it) {
+            minLowWaterMark = std::min(minLowWaterMark, it->lowWaterMark);
+        }
+        while ( !pinnedImages.empty() && (pinnedImages.begin()->first < minLowWaterMark) ) {
+            const std::map<ImagePtr, std::size_t>& images = pinnedImages.begin()->second;
+            for (std::map<ImagePtr, std::size_t>::const_iterator it = images.begin(); it != images.end(); ++it) {
+                pinnedMemory -= it->second;
+            }
+            pinnedImages.erase( pinnedImages.begin() );
+        }
+    }
+};
+
+WritersRenderGroup::WritersRenderGroup(std::size_t memoryBudget)
+    : _imp( new WritersRenderGroupPrivate(memoryBudget) )
+{
+}
+
+WritersRenderGroup::~WritersRenderGroup()
+{
+}
+
+void
+WritersRenderGroup::addWriter(const OutputEffectInstance* writer,
+                              int firstFrame,
+                              int lastFrame,
+                              int frameStep)
+{
+    WriterState state;
+
+    state.node = writer->getNode();
+    state.writer = writer;
+    state.firstFrame = firstFrame;
+    state.lastFrame = lastFrame;
+    state.frameStep = std::max(1, frameStep);
+    state.lowWaterMark = firstFrame;
+
+    QMutexLocker k(&_imp->lock);
+    _imp->writers.push_back(state);
+}
+
+void
+WritersRenderGroup::start()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    std::list<NodePtr> writerNodes;
+    {
+        QMutexLocker k(&_imp->lock);
+        for (WriterStates::const_iterator it = _imp->writers.begin(); it != _imp->writers.end(); ++it) {
+            NodePtr node = it->node.lock();
+            if (node) {
+                writerNodes.push_back(node);
+            }
+        }
+    }
+
+    // Count the writers each upstream node is rendered for
+    std::map<Node*, int> writersCount;
+    std::map<Node*, NodePtr> upstreamNodes;
+    for (std::list<NodePtr>::const_iterator it = writerNodes.begin(); it != writerNodes.end(); ++it) {
+        std::set<Node*> visited;
+        std::list<NodePtr> upstream;
+        visited.insert( it->get() );
+        collectUpstreamNodes(*it, &visited, &upstream);
+        for (std::list<NodePtr>::const_iterator it2 = upstream.begin(); it2 != upstream.end(); ++it2) {
+            ++writersCount[it2->get()];
+            upstreamNodes[it2->get()] = *it2;
+        }
+    }
+
+    WritersRenderGroupPtr thisShared = shared_from_this();
+    std::list<NodePtr> sharedNodes;
+    {
+        QMutexLocker k(&_imp->lock);
+        for (std::map<Node*, int>::const_iterator it = writersCount.begin(); it != writersCount.end(); ++it) {
+            if (it->second > 1) {
+                NodePtr node = upstreamNodes[it->first];
+                _imp->sharedNodes[it->first] = node;
+                sharedNodes.push_back(node);
+            }
+        }
+    }
+    for (std::list<NodePtr>::const_iterator it = sharedNodes.begin(); it != sharedNodes.end(); ++it) {
+        (*it)->setWritersRenderGroup(thisShared);
+    }
+    for (std::list<NodePtr>::const_iterator it = writerNodes.begin(); it != writerNodes.end(); ++it) {
+        (*it)->setWritersRenderGroup(thisShared);
+    }
+} // WritersRenderGroup::start
+
+void
+WritersRenderGroup::waitForFrameTurn(const OutputEffectInstance* writer,
+                                     int time)
+{
+    QMutexLocker k(&_imp->lock);
+
+    for (;; ) {
+        WriterStates::iterator found = _imp->findWriter(writer);
+        if ( ( found == _imp->writers.end() ) || _imp->canStartFrame(*found, time) ) {
+            return;
+        }
+
+        // Do not hold the render of the writer when it is aborted
+        boost::shared_ptr<RenderEngine> engine = writer->getRenderEngine();
+        if ( !engine || engine->isSequentialRenderBeingAborted() ) {
+            return;
+        }
+        _imp->frameRenderedCond.wait(&_imp->lock, NATRON_WRITERS_RENDER_GROUP_WAIT_MS);
+    }
+}
+
+void
+WritersRenderGroup::notifyFrameRendered(const OutputEffectInstance* writer,
+                                        int time)
+{
+    QMutexLocker k(&_imp->lock);
+    WriterStates::iterator found = _imp->findWriter(writer);
+
+    if ( found == _imp->writers.end() ) {
+        return;
+    }
+    found->renderedFrames.insert(time);
+    while ( found->renderedFrames.erase(found->lowWaterMark) ) {
+        found->lowWaterMark += found->frameStep;
+    }
+    _imp->releasePinnedImages();
+    _imp->frameRenderedCond.wakeAll();
+}
+
+void
+WritersRenderGroup::removeWriter(const OutputEffectInstance* writer)
+{
+    NodePtr writerNode;
+    std::list<NodePtr> sharedNodes;
+    {
+        QMutexLocker k(&_imp->lock);
+        WriterStates::iterator found = _imp->findWriter(writer);
+        if ( found == _imp->writers.end() ) {
+            return;
+        }
+        writerNode = found->node.lock();
+        _imp->writers.erase(found);
+        _imp->releasePinnedImages();
+        if ( _imp->writers.empty() ) {
+            // The last render stopped: the shared nodes no longer pin their images
+            for (std::map<const Node*, NodeWPtr>::const_iterator it = _imp->sharedNodes.begin(); it != _imp->sharedNodes.end(); ++it) {
+                NodePtr node = it->second.lock();
+                if (node) {
+                    sharedNodes.push_back(node);
+                }
+            }
+            _imp->sharedNodes.clear();
+        }
+        _imp->frameRenderedCond.wakeAll();
+    }
+
+    // Hold a reference: this may be the last one
+    WritersRenderGroupPtr thisShared = shared_from_this();
+    if ( writerNode && (writerNode->getWritersRenderGroup() == thisShared) ) {
+        writerNode->setWritersRenderGroup( WritersRenderGroupPtr() );
+    }
+    for (std::list<NodePtr>::const_iterator it = sharedNodes.begin(); it != sharedNodes.end(); ++it) {
+        if ( (*it)->getWritersRenderGroup() == thisShared ) {
+            (*it)->setWritersRenderGroup( WritersRenderGroupPtr() );
+        }
+    }
+}
+
+void
+WritersRenderGroup::pinImage(const Node* node,
+                             const ImagePtr& image)
+{
+    if (!image) {
+        return;
+    }
+
+    std::size_t imageSize = image->size();
+    int time = (int)image->getTime();
+
+    QMutexLocker k(&_imp->lock);
+    if ( ( _imp->sharedNodes.find(node) == _imp->sharedNodes.end() ) || (_imp->pinnedMemory + imageSize > _imp->memoryBudget) ) {
+        return;
+    }
+    if ( _imp->pinnedImages[time].insert( std::make_pair(image, imageSize) ).second ) {
+        _imp->pinnedMemory += imageSize;
+    }
+}
+
+bool
+WritersRenderGroup::isSharedNode(const Node* node) const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->sharedNodes.find(node) != _imp->sharedNodes.end();
+}
+
+std::size_t
+WritersRenderGroup::getPinnedMemory() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->pinnedMemory;
+}
+
+NATRON_NAMESPACE_EXIT;
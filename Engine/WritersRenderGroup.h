@@ -0,0 +1,118 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_WRITERSRENDERGROUP_H
+#define NATRON_ENGINE_WRITERSRENDERGROUP_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Renders several writers together, frame by frame, so that the nodes upstream of more than one of them are
+ * rendered once per frame instead of once per writer.
+ *
+ * Each writer is still rendered by its own scheduler, but before rendering a frame its render threads wait until none of
+ * the other writers of the group is more than a few frames behind. The writers thus render the same frames at the same
+ * time: the first thread that needs an image of a shared upstream node renders it, and the others wait for it (see
+ * EffectInstance::renderRoI) and find it in the NodeCache.
+ *
+ * The images rendered by the shared nodes are pinned, i.e. referenced by the group so that the cache cannot evict them,
+ * until every writer of the group has rendered their frame. Pinned images are limited by a memory budget: past it, images
+ * are not pinned and may be evicted and rendered again, as in a regular render.
+ *
+ * The group is set on the writer nodes and on the shared nodes (see Node::getWritersRenderGroup) and is released when the
+ * render of the last writer stops. MT-safe.
+ **/
+struct WritersRenderGroupPrivate;
+class WritersRenderGroup
+    : public boost::enable_shared_from_this<WritersRenderGroup>
+{
+public:
+
+    /**
+     * @param memoryBudget Maximum size in bytes of the pinned images
+     **/
+    explicit WritersRenderGroup(std::size_t memoryBudget);
+
+    ~WritersRenderGroup();
+
+    /**
+     * @brief Adds a writer with the frame range it renders. Must be called before start().
+     **/
+    void addWriter(const OutputEffectInstance* writer, int firstFrame, int lastFrame, int frameStep);
+
+    /**
+     * @brief Finds the nodes upstream of at least 2 writers and sets the group on them and on the writers.
+     * Must be called on the main thread, before the renders start.
+     **/
+    void start();
+
+    /**
+     * @brief Blocks the calling render thread of the given writer until the other writers have caught up with the given frame,
+     * or their renders stopped, or the render of the writer is aborted.
+     **/
+    void waitForFrameTurn(const OutputEffectInstance* writer, int time);
+
+    /**
+     * @brief Called once all the views of the given frame were rendered by the writer. Releases the pinned images that
+     * all the writers are done with.
+     **/
+    void notifyFrameRendered(const OutputEffectInstance* writer, int time);
+
+    /**
+     * @brief Called when the render of the writer stops, whether it is finished or aborted: the other writers no longer wait for it.
+     **/
+    void removeWriter(const OutputEffectInstance* writer);
+
+    /**
+     * @brief Keeps a reference to an image rendered by the given node until all writers have rendered its frame, if the node
+     * is upstream of several writers and the memory budget allows it.
+     **/
+    void pinImage(const Node* node, const ImagePtr& image);
+
+    bool isSharedNode(const Node* node) const;
+
+    /**
+     * @brief Returns the size in bytes of the images currently pinned.
+     **/
+    std::size_t getPinnedMemory() const;
+
+private:
+
+    boost::scoped_ptr<WritersRenderGroupPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_WRITERSRENDERGROUP_H
@@ -669,6 +669,12 @@ enum MergingFunctionEnum
     eMergeXOR
 };
 
+enum ProjectFileFormatEnum
+{
+    eProjectFileFormatXML = 0,
+    eProjectFileFormatBinary
+};
+
 
 //typedef QFlags<StandardButtonEnum> StandardButtons;
 Q_DECLARE_FLAGS(StandardButtons, StandardButtonEnum)
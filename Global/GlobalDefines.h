@@ -117,6 +117,8 @@ typedef OfxRangeD RangeD;
 //Increment this to wipe all disk cache structure and ensure that the user has a clean cache when starting the next version of Natron
 #define NATRON_CACHE_VERSION 4
 #define kNatronCacheVersionSettingsKey "NatronCacheVersionSettingsKey"
+//The hash algorithm (Hash64::HashAlgorithmEnum) used to produce the keys of the disk caches. When absent, the keys were produced with CRC-64
+#define kNatronCacheHashAlgorithmSettingsKey "NatronCacheHashAlgorithmSettingsKey"
 
 
 #define kNodeGraphObjectName "nodeGraph"
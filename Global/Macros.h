@@ -240,6 +240,10 @@ namespace NATRON_PYTHON_NAMESPACE { }
 //In this context, the reader of the bitmap should then wait for the pixel to be available.
 #define NATRON_ENABLE_TRIMAP 1
 
+//The bitmap of an image stores the render state of its pixels with 2 bits per square tile of 2^NATRON_BITMAP_TILE_SIZE_LOG2 pixels.
+//Tiles which are only partially marked keep the state of each of their pixels until they become uniform again.
+#define NATRON_BITMAP_TILE_SIZE_LOG2 4
+
 //Use this to have all readers inside the same Read meta-node and all the writers
 //into the same Write meta-node
 #define NATRON_ENABLE_IO_META_NODES 1
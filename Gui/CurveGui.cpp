@@ -326,25 +326,40 @@ CurveGui::drawCurve(int curveIndex,
             std::list<double>::const_iterator lastUpperItCoords = keysWidgetCoords.end();
             KeyFrameSet::const_iterator lastUpperIt = keyframes.end();
 
+            // Collect the points first so that the curve is evaluated at all of them in a single pass
+            std::vector<double> xs, ys;
+            std::vector<bool> isKey;
             while ( x1 < (widgetWidth - 1) ) {
-                double x, y;
                 if (!isX1AKey) {
-                    x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                    y = evaluate(false, x);
+                    xs.push_back( _curveWidget->toZoomCoordinates(x1, 0).x() );
+                    ys.push_back(0.);
+                    isKey.push_back(false);
                 } else {
-                    x = x1Key.getTime();
-                    y = x1Key.getValue();
+                    xs.push_back( x1Key.getTime() );
+                    ys.push_back( x1Key.getValue() );
+                    isKey.push_back(true);
                 }
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
                 nextPointForSegment(x1, keyframes, keysWidgetCoords, curveYRange, xminCurveWidgetCoord, xmaxCurveWidgetCoord, &lastUpperIt, &lastUpperItCoords, &x2, &x1Key, &isX1AKey);
                 x1 = x2;
             }
             //also add the last point
-            {
-                double x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                double y = evaluate(false, x);
-                vertices.push_back( (float)x );
+            xs.push_back( _curveWidget->toZoomCoordinates(x1, 0).x() );
+            ys.push_back(0.);
+            isKey.push_back(false);
+
+            std::vector<double> evaluatedXs, evaluatedYs;
+            for (std::size_t i = 0; i < xs.size(); ++i) {
+                if (!isKey[i]) {
+                    evaluatedXs.push_back(xs[i]);
+                }
+            }
+            evaluatedYs.resize( evaluatedXs.size() );
+            evaluate( false, &evaluatedXs[0], &evaluatedYs[0], evaluatedXs.size() );
+
+            std::size_t evaluatedIndex = 0;
+            for (std::size_t i = 0; i < xs.size(); ++i) {
+                double y = isKey[i] ? ys[i] : evaluatedYs[evaluatedIndex++];
+                vertices.push_back( (float)xs[i] );
                 vertices.push_back( (float)y );
             }
         } catch (...) {
@@ -635,6 +650,38 @@ KnobCurveGui::onKnobInterpolationChanged()
     _curveWidget->update();
 }
 
+void
+CurveGui::evaluate(bool useExpr,
+                   const double* x,
+                   double* y,
+                   std::size_t count) const
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        y[i] = evaluate(useExpr, x[i]);
+    }
+}
+
+void
+KnobCurveGui::evaluate(bool useExpr,
+                       const double* x,
+                       double* y,
+                       std::size_t count) const
+{
+    if (useExpr) {
+        CurveGui::evaluate(useExpr, x, y, count);
+
+        return;
+    }
+    KnobPtr knob = getInternalKnob();
+    KnobParametric* isParametric = dynamic_cast<KnobParametric*>( knob.get() );
+    if (isParametric) {
+        isParametric->getParametricCurve(_dimension)->getValuesAt(x, y, count);
+    } else {
+        assert(_internalCurve);
+        _internalCurve->getValuesAt(x, y, count, false);
+    }
+}
+
 double
 KnobCurveGui::evaluate(bool useExpr,
                        double x) const
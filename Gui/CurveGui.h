@@ -116,6 +116,11 @@ public:
      * The coordinates are those of the curve, not of the widget.
      **/
     virtual double evaluate(bool useExpr, double x) const = 0;
+
+    /**
+     * @brief Evaluates the curve at the count abscissae x, which are usually increasing, and writes the results in y.
+     **/
+    virtual void evaluate(bool useExpr, const double* x, double* y, std::size_t count) const;
     virtual boost::shared_ptr<Curve>  getInternalCurve() const;
 
     void drawCurve(int curveIndex, int curvesCount);
@@ -197,6 +202,7 @@ public:
     }
 
     virtual double evaluate(bool useExpr, double x) const OVERRIDE FINAL WARN_UNUSED_RETURN;
+    virtual void evaluate(bool useExpr, const double* x, double* y, std::size_t count) const OVERRIDE FINAL;
     boost::shared_ptr<RotoContext> getRotoContext() const { return _roto; }
 
     KnobPtr getInternalKnob() const;
@@ -240,6 +246,7 @@ public:
 
     boost::shared_ptr<Bezier> getBezier() const;
     virtual double evaluate(bool useExpr, double x) const OVERRIDE FINAL WARN_UNUSED_RETURN;
+    using CurveGui::evaluate;
     virtual Curve::YRange getCurveYRange() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool areKeyFramesTimeClampedToIntegers() const OVERRIDE FINAL WARN_UNUSED_RETURN { return true; }
 
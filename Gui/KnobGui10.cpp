@@ -496,6 +496,29 @@ KnobGui::getScriptNameHtml() const
     return QString::fromUtf8("<font size = 4><b>%1</b></font>").arg( QString::fromUtf8( getKnob()->getName().c_str() ) );
 }
 
+static QString
+expressionEvaluationToolTip(const KnobPtr& knob,
+                            int dimension,
+                            bool isMarkdown)
+{
+    U64 nativeEvaluations, pythonEvaluations;
+    std::string fallbackReason;
+    bool compiled = knob->getExpressionEvaluationStats(dimension, &nativeEvaluations, &pythonEvaluations, &fallbackReason);
+    QString ret;
+
+    if (compiled) {
+        ret = QObject::tr("Evaluated without Python: %1 times, with Python: %2 times").arg( (qulonglong)nativeEvaluations ).arg( (qulonglong)pythonEvaluations );
+    } else {
+        ret = QObject::tr("Evaluated with Python: %1 times").arg( (qulonglong)pythonEvaluations );
+    }
+    if ( !fallbackReason.empty() ) {
+        ret += QString::fromUtf8(" (%1)").arg( QString::fromUtf8( fallbackReason.c_str() ) );
+    }
+    ret += isMarkdown ? QString::fromUtf8("\n\n") : QString::fromUtf8("<br />");
+
+    return ret;
+}
+
 QString
 KnobGui::toolTip() const
 {
@@ -535,6 +558,7 @@ KnobGui::toolTip() const
             } else {
                 exprTt = QString::fromUtf8("ret = <b>%1</b><br />").arg( QString::fromUtf8( expressions[0].c_str() ) );
             }
+            exprTt.append( expressionEvaluationToolTip(knob, 0, isMarkdown) );
         }
     } else {
         for (int i = 0; i < knob->getDimension(); ++i) {
@@ -546,6 +570,9 @@ KnobGui::toolTip() const
                 toAppend = QString::fromUtf8("%1 = <b>%2</b><br />").arg( QString::fromUtf8( dimName.c_str() ) ).arg( QString::fromUtf8( expressions[i].c_str() ) );
             }
             exprTt.append(toAppend);
+            if ( !expressions[i].empty() ) {
+                exprTt.append( expressionEvaluationToolTip(knob, i, isMarkdown) );
+            }
         }
     }
 
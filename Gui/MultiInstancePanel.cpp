@@ -1616,6 +1616,7 @@ MultiInstancePanel::resetInstances(const std::list<Node*> & instances)
     if ( next != instances.end() ) {
         ++next;
     }
+    NodesHashBatch_RAII hashBatch( getApp() );
     for (std::list<Node*>::const_iterator it = instances.begin();
          it != instances.end();
          ++it) {
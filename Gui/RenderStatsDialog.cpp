@@ -64,8 +64,9 @@
 #define COL_NB_CACHE_HIT 13
 #define COL_NB_CACHE_HIT_DOWNSCALED 14
 #define COL_NB_CACHE_MISS 15
+#define COL_TILING 16
 
-#define NUM_COLS 16
+#define NUM_COLS 17
 
 NATRON_NAMESPACE_ENTER;
 
@@ -645,6 +646,52 @@ public:
                 }
             }
         }
+        {
+            TableItem* item = 0;
+            if (exists) {
+                item = view->item(row, COL_TILING);
+            } else {
+                item = new TableItem;
+                QString tt = GuiUtils::convertFromPlainText(tr("How the host split each render window of this node in tiles "
+                                                               "rendered concurrently, with the estimated time to render one "
+                                                               "pixel used to choose the tiles count."), Qt::WhiteSpaceNormal);
+                item->setToolTip(tt);
+                item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+            }
+            assert(item);
+            const std::list<NodeTilingInfos>& tilingInfos = stats.getTilingInfos();
+            QString str;
+            for (std::list<NodeTilingInfos>::const_iterator it = tilingInfos.begin(); it != tilingInfos.end(); ++it) {
+                if ( !str.isEmpty() ) {
+                    str.append( QString::fromUtf8(", ") );
+                }
+                switch (it->policy) {
+                case eTilingPolicyNone:
+                    str.append( tr("None") );
+                    break;
+                case eTilingPolicySquareTiles:
+                    str.append( tr("%1 square tiles").arg(it->nbTiles) );
+                    break;
+                case eTilingPolicyRowStrips:
+                    str.append( tr("%1 row strips (%2 ns/pixel)").arg(it->nbTiles).arg(it->timePerPixel * 1e9, 0, 'f', 1) );
+                    break;
+                case eTilingPolicySingleTile:
+                    str.append( tr("Single tile (%1 ns/pixel)").arg(it->timePerPixel * 1e9, 0, 'f', 1) );
+                    break;
+                }
+            }
+            if ( str.isEmpty() ) {
+                str = tr("None");
+            }
+            item->setText(str);
+            if (nodeUi) {
+                item->setTextColor(Qt::black);
+                item->setBackgroundColor(c);
+            }
+            if (!exists) {
+                view->setItem(row, COL_TILING, item);
+            }
+        }
         if (!exists) {
             rows.push_back(node);
         }
@@ -890,7 +937,8 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
         << tr("Rendered Planes")
         << tr("Cache Hits")
         << tr("Cache Hits Higher Scale")
-        << tr("Cache Misses");
+        << tr("Cache Misses")
+        << tr("Tiling");
 
     _imp->view->setColumnCount( dimensionNames.size() );
     _imp->view->setHorizontalHeaderLabels(dimensionNames);
@@ -964,6 +1012,7 @@ RenderStatsDialog::refreshAdvancedColsVisibility()
     _imp->view->setColumnHidden(COL_NB_CACHE_HIT, !checked);
     _imp->view->setColumnHidden(COL_NB_CACHE_HIT_DOWNSCALED, !checked);
     _imp->view->setColumnHidden(COL_NB_CACHE_MISS, !checked);
+    _imp->view->setColumnHidden(COL_TILING, !checked);
 }
 
 void
@@ -4384,6 +4384,14 @@ ViewerGL::getColorAt(double x,
                                                            dstColorSpace,
                                                            r, g, b, a);
         break;
+    case eImageBitDepthHalf:
+        gotval = getColorAtInternal<Half, 1>(image,
+                                             xPixel, yPixel,
+                                             forceLinear,
+                                             srcColorSpace,
+                                             dstColorSpace,
+                                             r, g, b, a);
+        break;
     case eImageBitDepthFloat:
         gotval = getColorAtInternal<float, 1>(image,
                                               xPixel, yPixel,
@@ -4559,6 +4567,12 @@ ViewerGL::getColorAtRect(const RectD &rect, // rectangle in canonical coordinate
                                                                    &rPix, &gPix, &bPix, &aPix);
                 break;
             case eImageBitDepthHalf:
+                gotval = getColorAtInternal<Half, 1>(image,
+                                                     xPixel, yPixel,
+                                                     forceLinear,
+                                                     srcColorSpace,
+                                                     dstColorSpace,
+                                                     &rPix, &gPix, &bPix, &aPix);
                 break;
             case eImageBitDepthFloat:
                 gotval = getColorAtInternal<float, 1>(image,
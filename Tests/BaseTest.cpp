@@ -35,9 +35,13 @@
 #include "Engine/KnobTypes.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Plugin.h"
+#include "Engine/OutputEffectInstance.h"
+#include "Engine/RenderStats.h"
+#include "Engine/Settings.h"
 #include "Engine/Curve.h"
 #include "Engine/CLArgs.h"
 #include "Engine/ViewIdx.h"
+#include "Engine/WritersRenderGroup.h"
 
 NATRON_NAMESPACE_USING
 
@@ -263,6 +267,81 @@ TEST_F(BaseTest, GenerateDot)
     QFile::remove(filePath);
 }
 
+///High level test: render 2 writers of the same generator together
+TEST_F(BaseTest, RenderWritersTogether)
+{
+    NodePtr generator = createNode(_generatorPluginID);
+    NodePtr writer1 = createNode(_writeOIIOPluginID);
+    NodePtr writer2 = createNode(_writeOIIOPluginID);
+
+    ASSERT_TRUE(generator && writer1 && writer2);
+    connectNodes(generator, writer1, 0, true);
+    connectNodes(generator, writer2, 0, true);
+
+    Format f(0, 0, 200, 200, "toto", 1.);
+    getApp()->getProject()->setOrAddProjectFormat(f);
+
+    OutputEffectInstance* output1 = dynamic_cast<OutputEffectInstance*>( writer1->getEffectInstance().get() );
+    OutputEffectInstance* output2 = dynamic_cast<OutputEffectInstance*>( writer2->getEffectInstance().get() );
+    ASSERT_TRUE(output1 && output2);
+
+    // Only the generator is upstream of both writers
+    {
+        WritersRenderGroupPtr group( new WritersRenderGroup(1024 * 1024) );
+        group->addWriter(output1, 1, 3, 1);
+        group->addWriter(output2, 1, 3, 1);
+        group->start();
+        EXPECT_TRUE( group->isSharedNode( generator.get() ) );
+        EXPECT_FALSE( group->isSharedNode( writer1.get() ) );
+        EXPECT_EQ( group, generator->getWritersRenderGroup() );
+        EXPECT_EQ( group, writer1->getWritersRenderGroup() );
+
+        // The first writer may not run ahead of the second one
+        group->notifyFrameRendered(output1, 1);
+        group->removeWriter(output1);
+        EXPECT_FALSE( writer1->getWritersRenderGroup() );
+        EXPECT_EQ( group, generator->getWritersRenderGroup() );
+        group->removeWriter(output2);
+        EXPECT_FALSE( generator->getWritersRenderGroup() );
+        EXPECT_EQ( (std::size_t)0, group->getPinnedMemory() );
+    }
+
+    const QString& binPath = appPTR->getApplicationBinaryPath();
+    QString filePath1 = binPath + QString::fromUtf8("/test_render_together_1_###.jpg");
+    QString filePath2 = binPath + QString::fromUtf8("/test_render_together_2_###.jpg");
+    writer1->setOutputFilesForWriter( filePath1.toStdString() );
+    writer2->setOutputFilesForWriter( filePath2.toStdString() );
+
+    bool wasEnabled = appPTR->getCurrentSettings()->isRenderWritersTogetherEnabled();
+    appPTR->getCurrentSettings()->setRenderWritersTogetherEnabled(true);
+
+    ///This call is blocking.
+    std::list<AppInstance::RenderWork> works;
+    AppInstance::RenderWork w;
+    w.firstFrame = 1;
+    w.lastFrame = 3;
+    w.frameStep = 1;
+    w.useRenderStats = false;
+    w.writer = output1;
+    works.push_back(w);
+    w.writer = output2;
+    works.push_back(w);
+    getApp()->startWritersRendering(true, works);
+
+    appPTR->getCurrentSettings()->setRenderWritersTogetherEnabled(wasEnabled);
+
+    EXPECT_FALSE( generator->getWritersRenderGroup() );
+    for (int i = 1; i <= 3; ++i) {
+        QString frame = QString::fromUtf8("%1").arg(i, 3, 10, QLatin1Char('0'));
+        QString file1 = binPath + QString::fromUtf8("/test_render_together_1_") + frame + QString::fromUtf8(".jpg");
+        QString file2 = binPath + QString::fromUtf8("/test_render_together_2_") + frame + QString::fromUtf8(".jpg");
+        EXPECT_TRUE( QFile::exists(file1) );
+        EXPECT_TRUE( QFile::exists(file2) );
+        QFile::remove(file1);
+        QFile::remove(file2);
+    }
+}
+
 TEST_F(BaseTest, SetValues)
 {
     NodePtr generator = createNode(_generatorPluginID);
@@ -303,3 +382,45 @@ TEST_F(BaseTest, SimpleNodeConnections) {
     disconnectNodes(generator, writer, false);
     connectNodes(generator, writer, 0, true);
 }
+
+///Knob changes made while a hash batch is opened must be propagated downstream in a single pass when it is closed
+TEST_F(BaseTest, BatchedHashPropagation) {
+    NodePtr generator = createNode(_generatorPluginID);
+    NodePtr writer = createNode(_writeOIIOPluginID);
+
+    ASSERT_TRUE(writer && generator);
+    connectNodes(generator, writer, 0, true);
+
+    U64 generatorHash = generator->getHashValue();
+    U64 writerHash = writer->getHashValue();
+
+    U64 nbPropagationsBefore, nbRehashedBefore;
+    int lastVisited, lastRehashed;
+    RenderStats::getHashPropagationInfos(&nbPropagationsBefore, &nbRehashedBefore, &lastVisited, &lastRehashed);
+
+    {
+        NodesHashBatch_RAII hashBatch( getApp() );
+        for (int i = 0; i < 10; ++i) {
+            generator->incrementKnobsAge();
+            writer->incrementKnobsAge();
+        }
+
+        //Nothing is propagated while the batch is opened
+        EXPECT_EQ( generatorHash, generator->getHashValue() );
+        EXPECT_EQ( writerHash, writer->getHashValue() );
+    }
+
+    EXPECT_NE( generatorHash, generator->getHashValue() );
+    EXPECT_NE( writerHash, writer->getHashValue() );
+
+    U64 nbPropagations, nbRehashed;
+    RenderStats::getHashPropagationInfos(&nbPropagations, &nbRehashed, &lastVisited, &lastRehashed);
+    EXPECT_EQ(nbPropagationsBefore + 1, nbPropagations);
+    EXPECT_GE(lastRehashed, 2);
+    EXPECT_GE(lastVisited, lastRehashed);
+
+    //An unbatched edit of the generator re-hashes the writer through the combination step only
+    writerHash = writer->getHashValue();
+    generator->incrementKnobsAge();
+    EXPECT_NE( writerHash, writer->getHashValue() );
+}
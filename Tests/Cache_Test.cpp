@@ -0,0 +1,361 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm> // max
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <QtCore/QDir>
+#include <QtCore/QThread>
+
+#include "Engine/Cache.h"
+#include "Engine/Image.h"
+#include "Engine/ImageParams.h"
+#include "Engine/PersistentImageStore.h"
+#include "Engine/Timer.h"
+#include "Engine/ViewIdx.h"
+
+#include "BaseTest.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+/**
+ * @brief Performs many lookups on the same cache from a separate thread so that
+ * the contention on the cache locks can be measured.
+ **/
+class CacheLookupThread
+    : public QThread
+{
+    Cache<Image>* _cache;
+    const std::vector<U64>* _nodeHashes;
+    boost::shared_ptr<ImageParams> _params;
+    int _nLookups;
+    unsigned int _seed;
+
+public:
+
+    int nHits;
+
+    CacheLookupThread(Cache<Image>* cache,
+                      const std::vector<U64>* nodeHashes,
+                      const boost::shared_ptr<ImageParams>& params,
+                      int nLookups,
+                      unsigned int seed)
+        : QThread()
+        , _cache(cache)
+        , _nodeHashes(nodeHashes)
+        , _params(params)
+        , _nLookups(nLookups)
+        , _seed(seed)
+        , nHits(0)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (int i = 0; i < _nLookups; ++i) {
+            // Simple LCG so that each thread has its own deterministic sequence
+            _seed = _seed * 1103515245 + 12345;
+            U64 nodeHash = (*_nodeHashes)[(_seed >> 16) % _nodeHashes->size()];
+            ImageKey key = Image::makeKey(0, nodeHash, false, 0, ViewIdx(0), false, false);
+            ImagePtr image;
+            if ( _cache->getOrCreate(key, _params, 0, &image) ) {
+                ++nHits;
+            }
+        }
+    }
+};
+
+double
+runCacheLookups(int nShards,
+                int nThreads,
+                int nLookupsPerThread,
+                const std::vector<U64>& nodeHashes,
+                int* nHits)
+{
+    Cache<Image> cache("CacheTest", 1, 1024ULL * 1024ULL * 1024ULL, 1., nShards);
+    RectD rod(0, 0, 16, 16);
+    boost::shared_ptr<ImageParams> params = Image::makeParams( rod, 1., 0, false, ImageComponents::getRGBAComponents(),
+                                                               eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone );
+
+    // Populate the cache so that the benchmark only measures lookups
+    for (std::size_t i = 0; i < nodeHashes.size(); ++i) {
+        ImagePtr image;
+        cache.getOrCreate(Image::makeKey(0, nodeHashes[i], false, 0, ViewIdx(0), false, false), params, 0, &image);
+    }
+
+    std::vector<boost::shared_ptr<CacheLookupThread> > threads;
+    for (int i = 0; i < nThreads; ++i) {
+        threads.push_back( boost::shared_ptr<CacheLookupThread>( new CacheLookupThread(&cache, &nodeHashes, params, nLookupsPerThread, i + 1) ) );
+    }
+
+    TimeLapse timer;
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->start();
+    }
+    *nHits = 0;
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->wait();
+        *nHits += threads[i]->nHits;
+    }
+    double elapsed = timer.getTimeSinceCreation();
+
+    cache.waitForDeleterThread();
+
+    return elapsed;
+}
+} // anon namespace
+
+
+TEST_F(BaseTest, CacheShardedLookup)
+{
+    const int nShards = 16;
+    Cache<Image> cache("CacheTest", 1, 1024ULL * 1024ULL * 1024ULL, 1., nShards);
+
+    ASSERT_EQ(nShards, cache.getShardsCount());
+
+    RectD rod(0, 0, 16, 16);
+    boost::shared_ptr<ImageParams> params = Image::makeParams( rod, 1., 0, false, ImageComponents::getRGBAComponents(),
+                                                               eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone );
+    std::vector<ImagePtr> images;
+    for (U64 i = 0; i < 100; ++i) {
+        ImagePtr image;
+        EXPECT_FALSE( cache.getOrCreate(Image::makeKey(0, i, false, 0, ViewIdx(0), false, false), params, 0, &image) ) << "Entries should be created the first time";
+        ASSERT_TRUE(image);
+        images.push_back(image);
+    }
+
+    for (U64 i = 0; i < 100; ++i) {
+        std::list<ImagePtr> found;
+        ASSERT_TRUE( cache.get(Image::makeKey(0, i, false, 0, ViewIdx(0), false, false), &found) ) << "Entries should be found in whichever shard they live";
+        ASSERT_EQ( (std::size_t)1, found.size() );
+        EXPECT_EQ( images[i], found.front() );
+    }
+
+    std::list<ImagePtr> copy;
+    cache.getCopy(&copy);
+    EXPECT_EQ( images.size(), copy.size() );
+
+    cache.removeEntry(images[0]);
+    std::list<ImagePtr> found;
+    EXPECT_FALSE( cache.get(Image::makeKey(0, 0, false, 0, ViewIdx(0), false, false), &found) );
+
+    cache.waitForDeleterThread();
+}
+
+TEST_F(BaseTest, CacheStatistics)
+{
+    Cache<Image> cache("CacheTest", 1, 1024ULL * 1024ULL * 1024ULL, 1., 4);
+    RectD rod(0, 0, 16, 16);
+    boost::shared_ptr<ImageParams> params = Image::makeParams( rod, 1., 0, false, ImageComponents::getRGBAComponents(),
+                                                               eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone );
+    std::vector<ImagePtr> images;
+
+    for (U64 i = 0; i < 10; ++i) {
+        ImagePtr image;
+        cache.getOrCreate(Image::makeKey(0, i, false, 0, ViewIdx(0), false, false), params, 0, &image);
+        images.push_back(image);
+    }
+    for (U64 i = 0; i < 10; ++i) {
+        std::list<ImagePtr> found;
+        cache.get(Image::makeKey(0, i, false, 0, ViewIdx(0), false, false), &found);
+    }
+    std::list<ImagePtr> found;
+    cache.get(Image::makeKey(0, 1000, false, 0, ViewIdx(0), false, false), &found);
+
+    CacheStatistics stats = cache.getStatistics();
+    EXPECT_EQ(10U, stats.memoryHits);
+    EXPECT_EQ(0U, stats.diskHits);
+    EXPECT_EQ(11U, stats.misses);
+    EXPECT_DOUBLE_EQ(10. / 21., stats.getHitRate());
+    EXPECT_EQ(0U, stats.memoryEvictions);
+
+    cache.resetStatistics();
+    stats = cache.getStatistics();
+    EXPECT_EQ(0U, stats.memoryHits);
+    EXPECT_EQ(0U, stats.misses);
+    EXPECT_DOUBLE_EQ(0., stats.getHitRate());
+
+    cache.waitForDeleterThread();
+}
+
+// The LRU table of the caches (see Cache::CacheContainer), with plain shared pointers as entries
+#ifdef NATRON_CACHE_USE_BOOST
+typedef BoostLRUHashTable<U64, boost::shared_ptr<int> > TestLRUTable;
+#else
+typedef StlLRUHashTable<U64, boost::shared_ptr<int> > TestLRUTable;
+#endif
+
+TEST(CacheLRU, LookupPromotesFindDoesNot)
+{
+    TestLRUTable table;
+
+    for (U64 i = 1; i <= 3; ++i) {
+        table.insert( i, boost::shared_ptr<int>( new int(i) ) );
+    }
+
+    // A look-up makes 1 the most recently used entry, so it survives the next eviction
+    ASSERT_TRUE( table(1) != table.end() );
+    EXPECT_EQ( (U64)2, table.evict().first );
+
+    // find(), used by Cache::prefetch, leaves the order untouched: 3 is still evicted before 1
+    ASSERT_TRUE( table.find(3) != table.end() );
+    EXPECT_EQ( (U64)3, table.evict().first );
+    EXPECT_EQ( (U64)1, table.evict().first );
+    EXPECT_EQ( 0U, table.size() );
+}
+
+TEST_F(BaseTest, CachePrefetchIsNotAHit)
+{
+    Cache<Image> cache("CacheTest", 1, 1024ULL * 1024ULL * 1024ULL, 1., 4);
+    RectD rod(0, 0, 16, 16);
+    boost::shared_ptr<ImageParams> params = Image::makeParams( rod, 1., 0, false, ImageComponents::getRGBAComponents(),
+                                                               eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone );
+    ImageKey key = Image::makeKey(0, 1, false, 0, ViewIdx(0), false, false);
+    ImagePtr image;
+
+    ASSERT_FALSE( cache.getOrCreate(key, params, 0, &image) );
+    ASSERT_TRUE(image);
+    cache.resetStatistics();
+
+    // Prefetching finds the entry, and a missing one, without counting them as look-ups
+    EXPECT_TRUE( cache.prefetch(key) );
+    EXPECT_FALSE( cache.prefetch( Image::makeKey(0, 2, false, 0, ViewIdx(0), false, false) ) );
+    CacheStatistics stats = cache.getStatistics();
+    EXPECT_EQ(0U, stats.memoryHits);
+    EXPECT_EQ(0U, stats.diskHits);
+    EXPECT_EQ(0U, stats.misses);
+
+    // The render reading the prefetched entry is the hit
+    std::list<ImagePtr> found;
+    ASSERT_TRUE( cache.get(key, &found) );
+    EXPECT_EQ( image, found.front() );
+    stats = cache.getStatistics();
+    EXPECT_EQ(1U, stats.memoryHits);
+    EXPECT_EQ(0U, stats.misses);
+
+    cache.waitForDeleterThread();
+}
+
+TEST_F(BaseTest, CacheLookupContentionBenchmark)
+{
+    const int nThreads = std::max(2, QThread::idealThreadCount());
+    const int nLookupsPerThread = 20000;
+
+    srand(2000);
+    std::vector<U64> nodeHashes(1000);
+    for (std::size_t i = 0; i < nodeHashes.size(); ++i) {
+        // coverity[dont_call]
+        nodeHashes[i] = ( (U64)rand() << 32 ) | (U64)rand();
+    }
+
+    int nHitsSingle = 0;
+    double singleLockTime = runCacheLookups(1, nThreads, nLookupsPerThread, nodeHashes, &nHitsSingle);
+    int nHitsSharded = 0;
+    double shardedTime = runCacheLookups(nThreads * 2, nThreads, nLookupsPerThread, nodeHashes, &nHitsSharded);
+
+    std::cout << nThreads << " threads, " << nLookupsPerThread << " lookups per thread:" << std::endl;
+    std::cout << "  1 shard:  " << singleLockTime << " s" << std::endl;
+    std::cout << "  " << nThreads * 2 << " shards: " << shardedTime << " s" << std::endl;
+
+    // All entries were created before the lookups, so every lookup should hit regardless of the number of shards
+    EXPECT_EQ(nThreads * nLookupsPerThread, nHitsSingle);
+    EXPECT_EQ(nThreads * nLookupsPerThread, nHitsSharded);
+}
+
+TEST_F(BaseTest, PersistentImageStore)
+{
+    QString storePath = QDir::tempPath() + QString::fromUtf8("/NatronPersistentImageStoreTest");
+    RectD rod(0, 0, 16, 16);
+    boost::shared_ptr<ImageParams> params = Image::makeParams( rod, 1., 0, false, ImageComponents::getRGBAComponents(),
+                                                               eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone );
+    ImageKey key = Image::makeKey(0, 1234, false, 0, ViewIdx(0), false, false);
+    {
+        Cache<Image> cache("CacheTest", 1, 1024ULL * 1024ULL * 1024ULL, 1., 1);
+        PersistentImageStore store(storePath);
+        ASSERT_TRUE( store.isValid() );
+        store.clear();
+
+        ImagePtr image;
+        cache.getOrCreate(key, params, 0, &image);
+        ASSERT_TRUE(image);
+        image->allocateMemory();
+        image->fill(image->getBounds(), 0.25, 0.5, 0.75, 1.);
+
+        // Incomplete images are not stored
+        EXPECT_FALSE( store.writeImage(image) );
+        image->markForRendered( image->getBounds() );
+        EXPECT_TRUE( store.writeImage(image) );
+        EXPECT_TRUE( store.contains( key.getHash() ) );
+        EXPECT_FALSE( store.contains(key.getHash() + 1) );
+        cache.waitForDeleterThread();
+    }
+
+    // Re-opening the store only maps the index, the image is read back on look-up
+    {
+        Cache<Image> cache("CacheTest", 1, 1024ULL * 1024ULL * 1024ULL, 1., 1);
+        PersistentImageStore store(storePath);
+        ASSERT_TRUE( store.contains( key.getHash() ) );
+        std::size_t nEntries;
+        U64 totalSize;
+        store.getStatistics(&nEntries, &totalSize);
+        EXPECT_EQ( (std::size_t)1, nEntries );
+        EXPECT_GT( totalSize, (U64)(16 * 16 * 4 * sizeof(float)) );
+
+        std::list<ImagePtr> images;
+        ASSERT_TRUE( store.loadImages(key, &cache, &images) );
+        ASSERT_EQ( (std::size_t)1, images.size() );
+        ImagePtr image = images.front();
+        EXPECT_TRUE( *image->getParams() == *params );
+        {
+            Image::ReadAccess acc = image->getReadRights();
+            const float* pix = (const float*)acc.pixelAt(8, 8);
+            EXPECT_EQ(0.25f, pix[0]);
+            EXPECT_EQ(0.5f, pix[1]);
+            EXPECT_EQ(0.75f, pix[2]);
+            EXPECT_EQ(1.f, pix[3]);
+        }
+        std::list<ImagePtr> found;
+        EXPECT_TRUE( cache.get(key, &found) ) << "Loaded images are inserted in the cache";
+
+        ImageKey otherKey = Image::makeKey(0, 1234, false, 1, ViewIdx(0), false, false);
+        std::list<ImagePtr> others;
+        EXPECT_FALSE( store.loadImages(otherKey, &cache, &others) );
+
+        // Exceeding the maximum size evicts the least recently used entries
+        store.setLimits(1, 0);
+        EXPECT_FALSE( store.contains( key.getHash() ) );
+        store.getStatistics(&nEntries, &totalSize);
+        EXPECT_EQ( (std::size_t)0, nEntries );
+        EXPECT_EQ( (U64)0, totalSize );
+        store.clear();
+        cache.waitForDeleterThread();
+    }
+}
@@ -124,3 +124,38 @@ TEST(Curve, Basic)
 }
 
 
+
+TEST(Curve, GetValuesAt)
+{
+    Curve c;
+
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(0., 10.) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(5., 20.) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(10., 0., 0., 0., eKeyframeTypeConstant) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(20., 30.) ) );
+
+    // increasing times, with some before/after the keyframes and exactly on them, then decreasing times
+    const double times[] = { -5., 0., 0.5, 2., 5., 5., 7.5, 10., 15., 20., 25., 3., -1., 12. };
+    const std::size_t count = sizeof(times) / sizeof(times[0]);
+    double values[count];
+    c.getValuesAt(times, values, count);
+    for (std::size_t i = 0; i < count; ++i) {
+        EXPECT_EQ( c.getValueAt(times[i]), values[i] );
+    }
+    EXPECT_EQ( 10., values[0] );
+    EXPECT_EQ( 20., values[4] );
+    EXPECT_EQ( 0., values[8] ); // constant interpolation
+
+    // the values must follow the changes of the keyframes
+    EXPECT_FALSE( c.addKeyFrame( KeyFrame(5., 40.) ) );
+    EXPECT_EQ( 40., c.getValueAt(5.) );
+    c.getValuesAt(times, values, count);
+    EXPECT_EQ( 40., values[4] );
+
+    c.clearKeyFrames();
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(0., 1.) ) );
+    c.getValuesAt(times, values, count);
+    for (std::size_t i = 0; i < count; ++i) {
+        EXPECT_EQ( 1., values[i] );
+    }
+}
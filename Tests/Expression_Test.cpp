@@ -0,0 +1,223 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "Engine/CompiledExpression.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/ViewIdx.h"
+
+#include "BaseTest.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+// Returns false if the expression cannot be compiled or evaluated
+bool
+evaluate(const std::string& expression,
+         double time,
+         CompiledExpression::Value* ret)
+{
+    std::string reason;
+    CompiledExpressionPtr expr = CompiledExpression::compile(expression, KnobPtr(), 1, &reason);
+
+    if (!expr) {
+        EXPECT_FALSE( reason.empty() );
+
+        return false;
+    }
+
+    return expr->evaluate(time, ViewIdx(0), ret, &reason);
+}
+
+::testing::AssertionResult
+isInt(const std::string& expression,
+      double expected,
+      double time = 7.)
+{
+    CompiledExpression::Value v;
+
+    if ( !evaluate(expression, time, &v) ) {
+        return ::testing::AssertionFailure() << expression << " was not evaluated";
+    }
+    if ( !v.isInt || (v.value != expected) ) {
+        return ::testing::AssertionFailure() << expression << " returned " << v.value << (v.isInt ? " (int)" : " (float)");
+    }
+
+    return ::testing::AssertionSuccess();
+}
+
+::testing::AssertionResult
+isFloat(const std::string& expression,
+        double expected,
+        double time = 7.)
+{
+    CompiledExpression::Value v;
+
+    if ( !evaluate(expression, time, &v) ) {
+        return ::testing::AssertionFailure() << expression << " was not evaluated";
+    }
+    if ( v.isInt || (std::fabs(v.value - expected) > 1e-12) ) {
+        return ::testing::AssertionFailure() << expression << " returned " << v.value << (v.isInt ? " (int)" : " (float)");
+    }
+
+    return ::testing::AssertionSuccess();
+}
+}
+
+// The expected results are the ones of the Python 2 interpreter, with "from math import *"
+TEST(CompiledExpression, Arithmetic)
+{
+    EXPECT_TRUE( isInt("1 + 2 * 3", 7) );
+    EXPECT_TRUE( isInt("(1 + 2) * 3", 9) );
+    EXPECT_TRUE( isInt("7 / 2", 3) );
+    EXPECT_TRUE( isInt("-7 / 2", -4) );
+    EXPECT_TRUE( isFloat("7 / 2.", 3.5) );
+    EXPECT_TRUE( isInt("-7 // 2", -4) );
+    EXPECT_TRUE( isFloat("-7.5 // 2", -4.) );
+    EXPECT_TRUE( isInt("-7 % 3", 2) );
+    EXPECT_TRUE( isInt("7 % -3", -2) );
+    EXPECT_TRUE( isFloat("7.5 % -2", -0.5) );
+    EXPECT_TRUE( isInt("2 ** 3 ** 2", 512) );
+    EXPECT_TRUE( isInt("-2 ** 2", -4) );
+    EXPECT_TRUE( isFloat("2 ** -1", 0.5) );
+    EXPECT_TRUE( isFloat(".5 + 1e1", 10.5) );
+}
+
+TEST(CompiledExpression, Logic)
+{
+    EXPECT_TRUE( isInt("1 < 2 < 3", 1) );
+    EXPECT_TRUE( isInt("3 > 2 > 2", 0) );
+    EXPECT_TRUE( isInt("3 == 3.", 1) );
+    EXPECT_TRUE( isInt("not 0", 1) );
+    EXPECT_TRUE( isInt("True and 3", 3) );
+    EXPECT_TRUE( isFloat("0 or 2.5", 2.5) );
+    EXPECT_TRUE( isInt("1 if frame > 3 else 2", 1) );
+    EXPECT_TRUE( isInt("1 if frame > 3 else 2", 2, 1.) );
+}
+
+TEST(CompiledExpression, Functions)
+{
+    EXPECT_TRUE( isFloat("sqrt(4)", 2.) );
+    EXPECT_TRUE( isFloat("floor(2.5)", 2.) );
+    EXPECT_TRUE( isFloat("ceil(-2.5)", -2.) );
+    EXPECT_TRUE( isFloat("pow(2, 3)", 8.) );
+    EXPECT_TRUE( isFloat("round(2.5)", 3.) );
+    EXPECT_TRUE( isFloat("round(-0.5)", -1.) );
+    EXPECT_TRUE( isInt("int(-3.7)", -3) );
+    EXPECT_TRUE( isInt("abs(-3)", 3) );
+    EXPECT_TRUE( isInt("min(1, 1.)", 1) );
+    EXPECT_TRUE( isFloat("max(1., 1)", 1.) );
+    EXPECT_TRUE( isFloat("sin(pi / 2)", 1.) );
+}
+
+TEST(CompiledExpression, Variables)
+{
+    EXPECT_TRUE( isInt("frame * 2", 14) );
+    EXPECT_TRUE( isFloat("frame * 2", 15., 7.5) );
+    EXPECT_TRUE( isInt("frame / 2", 3) );
+    EXPECT_TRUE( isInt("view", 0) );
+    EXPECT_TRUE( isInt("dimension", 1) );
+}
+
+TEST(CompiledExpression, Fallback)
+{
+    CompiledExpression::Value v;
+
+    // Not compiled
+    EXPECT_FALSE( evaluate("random()", 0., &v) );
+    EXPECT_FALSE( evaluate("thisGroup.Blur1.size.get()", 0., &v) );
+    EXPECT_FALSE( evaluate("thisParam.getValue()", 0., &v) ); // no parameter
+    EXPECT_FALSE( evaluate("'a'", 0., &v) );
+    EXPECT_FALSE( evaluate("1, 2", 0., &v) );
+    EXPECT_FALSE( evaluate("math.sin(1)", 0., &v) );
+    EXPECT_FALSE( evaluate("1 +", 0., &v) );
+
+    // Errors raised by Python
+    EXPECT_FALSE( evaluate("1 / 0", 0., &v) );
+    EXPECT_FALSE( evaluate("1. % 0", 0., &v) );
+    EXPECT_FALSE( evaluate("log(0)", 0., &v) );
+    EXPECT_FALSE( evaluate("sqrt(-1)", 0., &v) );
+    EXPECT_FALSE( evaluate("exp(1000)", 0., &v) );
+    EXPECT_FALSE( evaluate("2 ** 100", 0., &v) ); // would be a long
+}
+
+// Knobs of this node and of the sibling nodes are bound when the expression is compiled
+TEST_F(BaseTest, CompiledExpressionKnobReferences)
+{
+    NodePtr thisNode = createNode(_generatorPluginID);
+    NodePtr other = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(thisNode && other);
+    KnobPtr thisParam = thisNode->getKnobByName("noiseZSlope");
+    KnobDouble* thisSlope = dynamic_cast<KnobDouble*>( thisParam.get() );
+    KnobDouble* otherSlope = dynamic_cast<KnobDouble*>( other->getKnobByName("noiseZSlope").get() );
+    ASSERT_TRUE(thisSlope && otherSlope);
+    thisSlope->setValue(1.);
+    otherSlope->setValueAtTime(0, 0., ViewSpec::all(), 0);
+    otherSlope->setValueAtTime(10, 0.25, ViewSpec::all(), 0);
+
+    const std::string otherName = other->getScriptName_mt_safe();
+    std::string reason;
+    CompiledExpression::Value v;
+
+    CompiledExpressionPtr thisExpr = CompiledExpression::compile("thisNode.noiseZSlope.getValue() + 1", thisParam, 0, &reason);
+    ASSERT_TRUE(thisExpr);
+    EXPECT_TRUE( thisExpr->evaluate(0., ViewIdx(0), &v, &reason) );
+    EXPECT_TRUE( !v.isInt && (v.value == 2.) );
+
+    CompiledExpressionPtr otherExpr = CompiledExpression::compile(otherName + ".noiseZSlope.getValueAtTime(frame) * 2", thisParam, 0, &reason);
+    ASSERT_TRUE(otherExpr);
+    EXPECT_TRUE( otherExpr->evaluate(10., ViewIdx(0), &v, &reason) );
+    EXPECT_TRUE( !v.isInt && (v.value == 0.5) );
+    EXPECT_TRUE( otherExpr->evaluate(0., ViewIdx(0), &v, &reason) );
+    EXPECT_TRUE( !v.isInt && (v.value == 0.) );
+
+    // Not compiled
+    EXPECT_FALSE( CompiledExpression::compile(otherName + ".unknownParam.get()", thisParam, 0, &reason) );
+    EXPECT_FALSE( CompiledExpression::compile("thisNode.noiseZSlope.get().x", thisParam, 0, &reason) ); // 1 dimension
+
+    // Errors raised by Python
+    CompiledExpressionPtr badDimension = CompiledExpression::compile("thisNode.noiseZSlope.getValue(1)", thisParam, 0, &reason);
+    ASSERT_TRUE(badDimension);
+    EXPECT_FALSE( badDimension->evaluate(0., ViewIdx(0), &v, &reason) );
+
+    // A removed node is not a Python variable anymore: its bound knobs must fall back to Python
+    other->deactivate(std::list<NodePtr>(), true, false, true, false);
+    reason.clear();
+    EXPECT_FALSE( otherExpr->evaluate(10., ViewIdx(0), &v, &reason) );
+    EXPECT_FALSE( reason.empty() );
+    EXPECT_FALSE( CompiledExpression::compile(otherName + ".noiseZSlope.get()", thisParam, 0, &reason) );
+    EXPECT_TRUE( thisExpr->evaluate(0., ViewIdx(0), &v, &reason) );
+
+    other->activate(std::list<NodePtr>(), true, false);
+    EXPECT_TRUE( otherExpr->evaluate(10., ViewIdx(0), &v, &reason) );
+    EXPECT_TRUE( !v.isInt && (v.value == 0.5) );
+}
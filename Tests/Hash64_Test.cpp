@@ -25,9 +25,13 @@
 #include "Global/Macros.h"
 
 #include <cstdlib>
+#include <iostream>
 #include <gtest/gtest.h>
 
+#include <QtCore/QString>
+
 #include "Engine/Hash64.h"
+#include "Engine/Timer.h"
 
 NATRON_NAMESPACE_USING
 
@@ -90,3 +94,76 @@ TEST(Hash64,
     EXPECT_NE(hash1, hash2);
 } // TEST
 
+
+TEST(Hash64,
+     AlgorithmsTest)
+{
+    const Hash64::HashAlgorithmEnum algorithms[2] = {Hash64::eHashAlgorithmStreaming, Hash64::eHashAlgorithmCRC64};
+    const Hash64::HashAlgorithmEnum defaultAlgorithm = Hash64::getAlgorithm();
+
+    for (int a = 0; a < 2; ++a) {
+        Hash64::setAlgorithm(algorithms[a]);
+
+        Hash64 hash1, hash2, hash3;
+        for (int i = 0; i < 100; ++i) {
+            hash1.append<int>(i);
+            hash2.append<int>(i);
+            hash3.append<int>(99 - i);
+        }
+        hash1.computeHash();
+        hash2.computeHash();
+        hash3.computeHash();
+        ASSERT_TRUE( hash1.valid() );
+        EXPECT_EQ(hash1, hash2) << "Hashs with same elements should be equal.";
+        EXPECT_NE(hash1, hash3) << "The order of the elements should matter.";
+
+        // The hash must be incremental: appending after computeHash() continues the same sequence
+        Hash64 hash4;
+        for (int i = 0; i < 50; ++i) {
+            hash4.append<int>(i);
+        }
+        hash4.computeHash();
+        for (int i = 50; i < 100; ++i) {
+            hash4.append<int>(i);
+        }
+        hash4.computeHash();
+        EXPECT_EQ(hash1, hash4);
+
+        Hash64 str1, str2, str3;
+        Hash64_appendQString( &str1, QString::fromUtf8("Blur1.size") );
+        Hash64_appendQString( &str2, QString::fromUtf8("Blur1.size") );
+        Hash64_appendQString( &str3, QString::fromUtf8("Blur1.sizf") );
+        str1.computeHash();
+        str2.computeHash();
+        str3.computeHash();
+        EXPECT_EQ(str1, str2);
+        EXPECT_NE(str1, str3);
+    }
+
+    Hash64::setAlgorithm(defaultAlgorithm);
+}
+
+TEST(Hash64,
+     ThroughputBenchmark)
+{
+    const Hash64::HashAlgorithmEnum defaultAlgorithm = Hash64::getAlgorithm();
+    const int nValues = 1000000;
+    double elapsed[2];
+
+    for (int a = 0; a < 2; ++a) {
+        Hash64::setAlgorithm(a == 0 ? Hash64::eHashAlgorithmStreaming : Hash64::eHashAlgorithmCRC64);
+        TimeLapse timer;
+        Hash64 hash;
+        for (int i = 0; i < nValues; ++i) {
+            hash.append<double>(i * 0.5);
+        }
+        hash.computeHash();
+        elapsed[a] = timer.getTimeSinceCreation();
+        ASSERT_TRUE( hash.valid() );
+    }
+    Hash64::setAlgorithm(defaultAlgorithm);
+
+    std::cout << "Hashing " << nValues << " values:" << std::endl;
+    std::cout << "  streaming: " << elapsed[0] << " s (" << (nValues * sizeof(U64) / elapsed[0]) / (1024. * 1024.) << " MiB/s)" << std::endl;
+    std::cout << "  CRC-64:    " << elapsed[1] << " s (" << (nValues * sizeof(U64) / elapsed[1]) / (1024. * 1024.) << " MiB/s)" << std::endl;
+}
@@ -24,10 +24,14 @@
 
 #include "Global/Macros.h"
 
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include "Engine/Image.h"
+#include "Engine/LutSIMD.h"
 #include "Engine/ViewIdx.h"
 
 NATRON_NAMESPACE_USING
@@ -51,8 +55,7 @@ TEST(BitmapTest,
     ASSERT_TRUE(rod == nonRenderedRectsUnion);
 
     ///assert that the "underlying" bitmap is clean
-    const char* map = bm.getBitmap();
-    ASSERT_TRUE( !memchr( map, 1, rod.area() ) );
+    ASSERT_TRUE( bm.getStatesInRect(rod) == Bitmap::eBitmapStateFlagUnrendered );
 
     RectI halfRoD(0, 0, 100, 50);
     bm.markForRendered(halfRoD);
@@ -66,14 +69,12 @@ TEST(BitmapTest,
 
 
     ///assert that the underlying bitmap is marked as expected
-    const char* start = map;
 
     ///check that there are only ones in the rendered half
-    ASSERT_TRUE( !memchr( start, 0, halfRoD.area() ) );
+    ASSERT_TRUE( bm.getStatesInRect(halfRoD) == Bitmap::eBitmapStateFlagRendered );
 
     ///check that there are only 0s in the non rendered half
-    start = map + halfRoD.area();
-    ASSERT_TRUE( !memchr( start, 1, halfRoD.area() ) );
+    ASSERT_TRUE( bm.getStatesInRect(nonRenderedHalf) == Bitmap::eBitmapStateFlagUnrendered );
 
     ///mark for renderer the other half of the rod
     bm.markForRendered(nonRenderedHalf);
@@ -82,7 +83,7 @@ TEST(BitmapTest,
     nonRenderedRects.clear();
     bm.minimalNonMarkedRects(rod, nonRenderedRects);
     ASSERT_TRUE( nonRenderedRects.empty() );
-    ASSERT_TRUE( !memchr( map, 0, rod.area() ) );
+    ASSERT_TRUE( bm.getStatesInRect(rod) == Bitmap::eBitmapStateFlagRendered );
 
     ///More complex example where A,B,C,D are not rendered check that both trimap & bitmap yield the same result
     // BBBBBBBBBBBBBB
@@ -114,6 +115,85 @@ TEST(BitmapTest,
     EXPECT_TRUE(nonRenderedRects.size() == 3);
 } // TEST
 
+// The tiled bitmap must give the same results as if the state of each pixel was stored,
+// whatever the tile size and the alignment of the rectangles marked
+TEST(BitmapTest,
+     TilesMatchPixels)
+{
+    srand(2000);
+    const RectI bounds(-37, -5, 83, 70);
+
+    for (int tileSizeLog2 = 0; tileSizeLog2 <= 5; ++tileSizeLog2) {
+        Bitmap bm(bounds, tileSizeLog2);
+        std::vector<char> pixels(bounds.area(), Bitmap::eBitmapStateUnrendered);
+
+        for (int i = 0; i < 100; ++i) {
+            // coverity[dont_call]
+            int x1 = bounds.x1 + rand() % bounds.width();
+            // coverity[dont_call]
+            int y1 = bounds.y1 + rand() % bounds.height();
+            // coverity[dont_call]
+            RectI rect( x1, y1, x1 + 1 + rand() % (bounds.x2 - x1), y1 + 1 + rand() % (bounds.y2 - y1) );
+            // coverity[dont_call]
+            Bitmap::BitmapStateEnum state = (Bitmap::BitmapStateEnum)(rand() % 3);
+            if (state == Bitmap::eBitmapStateUnrendered) {
+                bm.clear(rect);
+            } else if (state == Bitmap::eBitmapStateRendered) {
+                bm.markForRendered(rect);
+            } else {
+                bm.markForRendering(rect);
+            }
+            RectI bbox;
+            bool hasUnrendered = false;
+            for (int y = bounds.y1; y < bounds.y2; ++y) {
+                for (int x = bounds.x1; x < bounds.x2; ++x) {
+                    char& pix = pixels[(y - bounds.y1) * bounds.width() + (x - bounds.x1)];
+                    if ( rect.contains(x, y) ) {
+                        pix = state;
+                    }
+                    ASSERT_EQ( (int)pix, (int)bm.getPixelState(x, y) );
+                    if (pix != Bitmap::eBitmapStateRendered) {
+                        if (!hasUnrendered) {
+                            bbox = RectI(x, y, x + 1, y + 1);
+                            hasUnrendered = true;
+                        } else {
+                            bbox.merge( RectI(x, y, x + 1, y + 1) );
+                        }
+                    }
+                }
+            }
+
+            // the minimal bbox is the bbox of the pixels which are not rendered
+            RectI minimalBbox = bm.minimalNonMarkedBbox(bounds);
+            if (hasUnrendered) {
+                EXPECT_TRUE(minimalBbox == bbox);
+            } else {
+                EXPECT_TRUE( minimalBbox.isNull() );
+            }
+
+            // all the pixels which are not rendered must be in the rectangles left to render
+            std::list<RectI> rects;
+            bm.minimalNonMarkedRects(bounds, rects);
+            for (int y = bounds.y1; y < bounds.y2; ++y) {
+                for (int x = bounds.x1; x < bounds.x2; ++x) {
+                    if (pixels[(y - bounds.y1) * bounds.width() + (x - bounds.x1)] == Bitmap::eBitmapStateRendered) {
+                        continue;
+                    }
+                    bool found = false;
+                    for (std::list<RectI>::iterator it = rects.begin(); it != rects.end() && !found; ++it) {
+                        found = it->contains(x, y);
+                    }
+                    ASSERT_TRUE(found);
+                }
+            }
+        }
+        // mixed tiles memory is released once they are uniform again
+        bm.markForRendered(bounds);
+        EXPECT_TRUE( bm.getStatesInRect(bounds) == Bitmap::eBitmapStateFlagRendered );
+        EXPECT_EQ( Bitmap(bounds, tileSizeLog2).getMemorySize(), bm.getMemorySize() );
+    }
+} // TEST
+
 TEST(ImageKeyTest, Equality) {
     srand(2000);
     // coverity[dont_call]
@@ -157,3 +237,189 @@ TEST(ImageKeyTest, Difference) {
     ASSERT_TRUE(keyHash1 != keyHash2);
 }
 
+static ImagePtr
+createFloatImage(const ImageComponents& comps,
+                 const RectI& bounds,
+                 ImageBitDepthEnum depth = eImageBitDepthFloat)
+{
+    RectD rod;
+
+    bounds.toCanonical_noClipping(0, 1., &rod);
+
+    return ImagePtr( new Image(comps, rod, bounds, 0, 1., depth, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone) );
+}
+
+static void
+fillRandom(const ImagePtr& img)
+{
+    Image::WriteAccess acc( img.get() );
+    const RectI& bounds = img->getBounds();
+    const int nComps = img->getComponentsCount();
+
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        float* pix = (float*)acc.pixelAt(bounds.x1, y);
+        for (int i = 0; i < bounds.width() * nComps; ++i) {
+            // coverity[dont_call]
+            pix[i] = rand() / (float)RAND_MAX * 1.4f - 0.2f;
+        }
+    }
+}
+
+static bool
+imagesBitExact(const ImagePtr& a,
+               const ImagePtr& b)
+{
+    Image::ReadAccess accA( a.get() );
+    Image::ReadAccess accB( b.get() );
+    const RectI& bounds = a->getBounds();
+    const std::size_t rowBytes = bounds.width() * a->getComponentsCount() * getSizeOfForBitDepth( a->getBitDepth() );
+
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        if ( std::memcmp(accA.pixelAt(bounds.x1, y), accB.pixelAt(bounds.x1, y), rowBytes) != 0 ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Image conversions and premultiplication must give the same results whatever instruction set is used
+TEST(ImageConvertTest, SIMDBitExactness)
+{
+    using namespace NATRON_NAMESPACE::Color;
+    const SIMDInstructionSetEnum supported = getSupportedSIMDInstructionSet();
+    const RectI bounds(-3, 2, 61, 19);
+
+    srand(2000);
+    ImagePtr rgba = createFloatImage(ImageComponents::getRGBAComponents(), bounds);
+    fillRandom(rgba);
+    ImagePtr rgb = createFloatImage(ImageComponents::getRGBComponents(), bounds);
+    fillRandom(rgb);
+
+    ImagePtr toByte[3], toShort[3], toRGB[3], toRGBA[3], premulted[3], unpremulted[3];
+    for (int set = 0; set <= (int)supported; ++set) {
+        setSIMDInstructionSet( (SIMDInstructionSetEnum)set );
+
+        toByte[set] = createFloatImage(ImageComponents::getRGBAComponents(), bounds, eImageBitDepthByte);
+        // the error diffusion starts at a random position in each scan-line
+        srand(1234);
+        rgba->convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceSRGB, 3, false, false, toByte[set].get() );
+
+        toShort[set] = createFloatImage(ImageComponents::getRGBAComponents(), bounds, eImageBitDepthShort);
+        rgba->convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceLinear, 3, false, false, toShort[set].get() );
+
+        toRGB[set] = createFloatImage(ImageComponents::getRGBComponents(), bounds);
+        rgba->convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceLinear, 3, false, false, toRGB[set].get() );
+
+        toRGBA[set] = createFloatImage(ImageComponents::getRGBAComponents(), bounds);
+        rgb->convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceLinear, 3, false, false, toRGBA[set].get() );
+
+        premulted[set] = createFloatImage(ImageComponents::getRGBAComponents(), bounds);
+        premulted[set]->pasteFrom(*rgba, bounds, false);
+        premulted[set]->premultImage(bounds);
+
+        unpremulted[set] = createFloatImage(ImageComponents::getRGBAComponents(), bounds);
+        unpremulted[set]->pasteFrom(*rgba, bounds, false);
+        unpremulted[set]->unpremultImage(bounds);
+    }
+    setSIMDInstructionSet(supported);
+
+    for (int set = 1; set <= (int)supported; ++set) {
+        EXPECT_TRUE( imagesBitExact(toByte[0], toByte[set]) );
+        EXPECT_TRUE( imagesBitExact(toShort[0], toShort[set]) );
+        EXPECT_TRUE( imagesBitExact(toRGB[0], toRGB[set]) );
+        EXPECT_TRUE( imagesBitExact(toRGBA[0], toRGBA[set]) );
+        EXPECT_TRUE( imagesBitExact(premulted[0], premulted[set]) );
+        EXPECT_TRUE( imagesBitExact(unpremulted[0], unpremulted[set]) );
+    }
+}
+
+// Half images store the values of float images rounded to the nearest half, and processing them is done in float
+TEST(ImageConvertTest, HalfImages)
+{
+    const RectI bounds(-4, 2, 60, 20);
+    const ImageComponents& rgbaComps = ImageComponents::getRGBAComponents();
+    const int nElements = bounds.width() * 4;
+
+    srand(2000);
+    ImagePtr rgba = createFloatImage(rgbaComps, bounds);
+    fillRandom(rgba);
+
+    // float -> half -> float: values are rounded to half
+    ImagePtr half = createFloatImage(rgbaComps, bounds, eImageBitDepthHalf);
+    rgba->convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceLinear, 3, false, false, half.get() );
+    ImagePtr back = createFloatImage(rgbaComps, bounds);
+    half->convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceLinear, 3, false, false, back.get() );
+    {
+        Image::ReadAccess accSrc( rgba.get() );
+        Image::ReadAccess accHalf( half.get() );
+        Image::ReadAccess accBack( back.get() );
+        for (int y = bounds.y1; y < bounds.y2; ++y) {
+            const float* src = (const float*)accSrc.pixelAt(bounds.x1, y);
+            const Half* h = (const Half*)accHalf.pixelAt(bounds.x1, y);
+            const float* b = (const float*)accBack.pixelAt(bounds.x1, y);
+            for (int i = 0; i < nElements; ++i) {
+                EXPECT_EQ( Half(src[i]).bits(), h[i].bits() );
+                EXPECT_EQ( (float)h[i], b[i] );
+                EXPECT_NEAR( src[i], b[i], std::fabs(src[i]) / 2048. + 1e-7 );
+            }
+        }
+    }
+
+    // half -> half copies are exact
+    ImagePtr pasted = createFloatImage(rgbaComps, bounds, eImageBitDepthHalf);
+    pasted->pasteFrom(*half, bounds, false);
+    EXPECT_TRUE( imagesBitExact(half, pasted) );
+
+    // fill
+    ImagePtr filled = createFloatImage(rgbaComps, bounds, eImageBitDepthHalf);
+    filled->fill(bounds, 0.25f, 0.5f, 2.f, 1.f);
+    {
+        Image::ReadAccess acc( filled.get() );
+        const Half* h = (const Half*)acc.pixelAt(bounds.x1 + 3, bounds.y1 + 5);
+        EXPECT_EQ( 0.25f, (float)h[0] );
+        EXPECT_EQ( 0.5f, (float)h[1] );
+        EXPECT_EQ( 2.f, (float)h[2] );
+        EXPECT_EQ( 1.f, (float)h[3] );
+    }
+
+    // premultiplication is done in float then rounded
+    ImagePtr premulted = createFloatImage(rgbaComps, bounds, eImageBitDepthHalf);
+    premulted->pasteFrom(*half, bounds, false);
+    premulted->premultImage(bounds);
+    {
+        Image::ReadAccess accHalf( half.get() );
+        Image::ReadAccess accPremult( premulted.get() );
+        for (int y = bounds.y1; y < bounds.y2; ++y) {
+            const Half* h = (const Half*)accHalf.pixelAt(bounds.x1, y);
+            const Half* p = (const Half*)accPremult.pixelAt(bounds.x1, y);
+            for (int i = 0; i < nElements; i += 4) {
+                for (int c = 0; c < 3; ++c) {
+                    EXPECT_EQ( Half( (float)h[i + c] * (float)h[i + 3] ).bits(), p[i + c].bits() );
+                }
+                EXPECT_EQ( h[i + 3].bits(), p[i + 3].bits() );
+            }
+        }
+    }
+
+    // mipmaps: each pixel is the average of 4 pixels, computed in float
+    RectD rod;
+    bounds.toCanonical_noClipping(0, 1., &rod);
+    const RectI halvedBounds = bounds.downscalePowerOfTwoSmallestEnclosing(1);
+    ImagePtr halved( new Image(rgbaComps, rod, halvedBounds, 1, 1., eImageBitDepthHalf, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone) );
+    half->downscaleMipMap(rod, bounds, 0, 1, false, halved.get() );
+    {
+        Image::ReadAccess accHalf( half.get() );
+        Image::ReadAccess accHalved( halved.get() );
+        for (int y = halvedBounds.y1; y < halvedBounds.y2; ++y) {
+            const Half* row0 = (const Half*)accHalf.pixelAt(2 * halvedBounds.x1, 2 * y);
+            const Half* row1 = (const Half*)accHalf.pixelAt(2 * halvedBounds.x1, 2 * y + 1);
+            const Half* dst = (const Half*)accHalved.pixelAt(halvedBounds.x1, y);
+            for (int i = 0; i < halvedBounds.width() * 4; ++i) {
+                const int x = (i / 4) * 8 + (i % 4);
+                const float sum = (float)row0[x] + (float)row0[x + 4] + (float)row1[x] + (float)row1[x + 4];
+                EXPECT_EQ( Half(sum / 4).bits(), dst[i].bits() );
+            }
+        }
+    }
+}
@@ -25,8 +25,14 @@
 #include "Global/Macros.h"
 
 #include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
 #include <gtest/gtest.h>
+#include "Engine/Half.h"
 #include "Engine/Lut.h"
+#include "Engine/LutSIMD.h"
+#include "Engine/RectI.h"
 
 NATRON_NAMESPACE_USING
 using namespace NATRON_NAMESPACE::Color;
@@ -51,3 +57,205 @@ TEST(Lut, IntConversions) {
         EXPECT_EQ( i, uint8xxToChar( charToUint8xx(i) ) );
     }
 }
+
+// Random float pixel values, including values outside of [0,1], infinities and denormals.
+// NaNs are excluded since their payload after a multiplication depends on the operands order chosen by the compiler.
+static void
+fillRandomFloats(std::vector<float>* values)
+{
+    const float specialValues[] = {
+        0.f, -0.f, 1.f, -1.f, 0.5f, 1e-40f, 0.99999994f, 1.0000001f,
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()
+    };
+    const int nSpecialValues = sizeof(specialValues) / sizeof(specialValues[0]);
+
+    for (std::size_t i = 0; i < values->size(); ++i) {
+        // coverity[dont_call]
+        if (rand() % 10 == 0) {
+            // coverity[dont_call]
+            (*values)[i] = specialValues[rand() % nSpecialValues];
+        } else {
+            // coverity[dont_call]
+            (*values)[i] = rand() / (float)RAND_MAX * 1.4f - 0.2f;
+        }
+    }
+}
+
+template <typename T>
+static bool
+isBitExact(const std::vector<T>& a,
+           const std::vector<T>& b)
+{
+    return a.size() == b.size() && std::memcmp( &a[0], &b[0], a.size() * sizeof(T) ) == 0;
+}
+
+// The SIMD kernels must give the same results as the scalar reference, for all sizes (remainders are done separately)
+TEST(Lut, SIMDKernelsBitExactness) {
+    srand(2000);
+    const SIMDInstructionSetEnum supported = getSupportedSIMDInstructionSet();
+    std::vector<float> table(256);
+    fillRandomFloats(&table);
+
+    for (int nPixels = 1; nPixels < 70; ++nPixels) {
+        const int n = nPixels * 4;
+        std::vector<float> floats(n);
+        fillRandomFloats(&floats);
+        std::vector<unsigned char> bytes(n);
+        std::vector<unsigned short> shorts(n);
+        for (int i = 0; i < n; ++i) {
+            // coverity[dont_call]
+            bytes[i] = (unsigned char)rand();
+            // coverity[dont_call]
+            shorts[i] = (unsigned short)rand();
+        }
+
+        std::vector<unsigned short> indices[3], indicesPremult[3];
+        std::vector<int> bytesFromFloat[3], shortsFromFloat[3], uint8xxFromFloat[3];
+        std::vector<float> floatsFromBytes[3], floatsFromShorts[3], lookedUp[3], premulted[3], unpremulted[3], rgba[3], rgb[3];
+        for (int set = 0; set <= (int)supported; ++set) {
+            setSIMDInstructionSet( (SIMDInstructionSetEnum)set );
+            indices[set].resize(n);
+            computeLutIndices(&floats[0], n, &indices[set][0]);
+            indicesPremult[set].resize(n);
+            computeLutIndicesPremult(&floats[0], nPixels, &indicesPremult[set][0]);
+            bytesFromFloat[set].resize(n);
+            floatToIntRow(&floats[0], n, 255, &bytesFromFloat[set][0]);
+            shortsFromFloat[set].resize(n);
+            floatToIntRow(&floats[0], n, 65535, &shortsFromFloat[set][0]);
+            uint8xxFromFloat[set].resize(n);
+            floatToIntRow(&floats[0], n, 0xff00, &uint8xxFromFloat[set][0]);
+            floatsFromBytes[set].resize(n);
+            uint8ToFloatRow(&bytes[0], n, &floatsFromBytes[set][0]);
+            floatsFromShorts[set].resize(n);
+            uint16ToFloatRow(&shorts[0], n, &floatsFromShorts[set][0]);
+            lookedUp[set].resize(n);
+            lookupUint8ToFloatRow(&table[0], &bytes[0], n, &lookedUp[set][0]);
+            premulted[set] = floats;
+            premultRGBARow(&premulted[set][0], nPixels);
+            unpremulted[set] = floats;
+            unpremultRGBARow(&unpremulted[set][0], nPixels);
+            rgba[set].resize(n);
+            shuffleRGBToRGBARow(&floats[0], nPixels, 1.f, &rgba[set][0]);
+            rgb[set].resize(nPixels * 3);
+            shuffleRGBAToRGBRow(&floats[0], nPixels, &rgb[set][0]);
+        }
+        setSIMDInstructionSet(supported);
+
+        // the scalar reference must match the functions in Lut.h
+        for (int i = 0; i < n; ++i) {
+            EXPECT_EQ( floatToInt<256>(floats[i]), bytesFromFloat[0][i] );
+            EXPECT_EQ( floatToInt<65536>(floats[i]), shortsFromFloat[0][i] );
+            EXPECT_EQ( floatToInt<0xff01>(floats[i]), uint8xxFromFloat[0][i] );
+            EXPECT_EQ( intToFloat<256>(bytes[i]), floatsFromBytes[0][i] );
+            EXPECT_EQ( intToFloat<65536>(shorts[i]), floatsFromShorts[0][i] );
+        }
+
+        for (int set = 1; set <= (int)supported; ++set) {
+            EXPECT_TRUE( isBitExact(indices[0], indices[set]) );
+            EXPECT_TRUE( isBitExact(indicesPremult[0], indicesPremult[set]) );
+            EXPECT_TRUE( isBitExact(bytesFromFloat[0], bytesFromFloat[set]) );
+            EXPECT_TRUE( isBitExact(shortsFromFloat[0], shortsFromFloat[set]) );
+            EXPECT_TRUE( isBitExact(uint8xxFromFloat[0], uint8xxFromFloat[set]) );
+            EXPECT_TRUE( isBitExact(floatsFromBytes[0], floatsFromBytes[set]) );
+            EXPECT_TRUE( isBitExact(floatsFromShorts[0], floatsFromShorts[set]) );
+            EXPECT_TRUE( isBitExact(lookedUp[0], lookedUp[set]) );
+            EXPECT_TRUE( isBitExact(premulted[0], premulted[set]) );
+            EXPECT_TRUE( isBitExact(unpremulted[0], unpremulted[set]) );
+            EXPECT_TRUE( isBitExact(rgba[0], rgba[set]) );
+            EXPECT_TRUE( isBitExact(rgb[0], rgb[set]) );
+        }
+    }
+}
+
+// The packed conversions must give the same results whatever instruction set is used
+TEST(Lut, PackedConversionsBitExactness) {
+    const Lut* lut = LutManager::sRGBLut();
+    lut->validate();
+    const SIMDInstructionSetEnum supported = getSupportedSIMDInstructionSet();
+    const RectI bounds(0, 0, 67, 13);
+    const int nElements = bounds.width() * bounds.height() * 4;
+
+    srand(2000);
+    std::vector<float> floats(nElements);
+    fillRandomFloats(&floats);
+    std::vector<unsigned char> bytes(nElements);
+    for (int i = 0; i < nElements; ++i) {
+        // coverity[dont_call]
+        bytes[i] = (unsigned char)rand();
+    }
+
+    for (int premult = 0; premult < 2; ++premult) {
+        std::vector<unsigned char> toBytes[3];
+        std::vector<float> fromBytes[3];
+        for (int set = 0; set <= (int)supported; ++set) {
+            setSIMDInstructionSet( (SIMDInstructionSetEnum)set );
+            toBytes[set].resize(nElements);
+            // the error diffusion starts at a random position in each scan-line
+            srand(1234);
+            lut->to_byte_packed(&toBytes[set][0], &floats[0], bounds, bounds, bounds, ePixelPackingRGBA, ePixelPackingBGRA, true, premult);
+            fromBytes[set].resize(nElements);
+            lut->from_byte_packed(&fromBytes[set][0], &bytes[0], bounds, bounds, bounds, ePixelPackingBGRA, ePixelPackingRGBA, false, premult);
+        }
+        setSIMDInstructionSet(supported);
+        for (int set = 1; set <= (int)supported; ++set) {
+            EXPECT_TRUE( isBitExact(toBytes[0], toBytes[set]) );
+            EXPECT_TRUE( isBitExact(fromBytes[0], fromBytes[set]) );
+        }
+    }
+}
+
+// Half conversions: known values, and the row conversions must match the Half class for all instruction sets
+TEST(Lut, HalfConversions) {
+    EXPECT_EQ( 0x3c00, Half(1.f).bits() );
+    EXPECT_EQ( 0xc000, Half(-2.f).bits() );
+    EXPECT_EQ( 0x7bff, Half(65504.f).bits() );
+    EXPECT_EQ( 0x7bff, Half(65519.f).bits() ); // rounds down to the largest half
+    EXPECT_EQ( 0x7c00, Half(65520.f).bits() ); // rounds up to infinity
+    EXPECT_EQ( 0x0001, Half(5.9604645e-8f).bits() ); // smallest denormal
+    EXPECT_EQ( 0x0000, Half(2.9802322e-8f).bits() ); // half of it rounds to even
+    EXPECT_EQ( 0x3c00, Half(1.00048828125f).bits() ); // 1 + 2^-11 rounds to even
+    EXPECT_EQ( 0x3c02, Half(1.00146484375f).bits() ); // 1 + 3 * 2^-11 rounds to even
+    EXPECT_EQ( 1.f, (float)Half::fromBits(0x3c00) );
+    EXPECT_EQ( 65504.f, (float)Half::fromBits(0x7bff) );
+
+    // all halves are exactly representable as floats
+    std::vector<unsigned short> allHalves(0x10000);
+    for (int i = 0; i < 0x10000; ++i) {
+        allHalves[i] = (unsigned short)i;
+        if ( (i & 0x7fff) <= 0x7c00 ) {
+            EXPECT_EQ( i, Half::floatToBits( Half::bitsToFloat(i) ) );
+        }
+    }
+
+    srand(2000);
+    const int n = 0x10000 + 13;
+    std::vector<float> floats(n);
+    fillRandomFloats(&floats);
+    for (int i = 0; i < n; i += 3) {
+        // random bit patterns, including denormals, infinities and NaNs
+        // coverity[dont_call]
+        unsigned int x = ( (unsigned int)rand() << 16 ) ^ (unsigned int)rand();
+        std::memcpy( &floats[i], &x, sizeof(float) );
+    }
+
+    const SIMDInstructionSetEnum supported = getSupportedSIMDInstructionSet();
+    for (int set = 0; set <= (int)supported; ++set) {
+        setSIMDInstructionSet( (SIMDInstructionSetEnum)set );
+        std::vector<float> fromHalf(0x10000);
+        halfToFloatRow(&allHalves[0], 0x10000, &fromHalf[0]);
+        std::vector<unsigned short> toHalf(n);
+        floatToHalfRow(&floats[0], n, &toHalf[0]);
+        setSIMDInstructionSet(supported);
+
+        std::vector<float> expectedFromHalf(0x10000);
+        for (int i = 0; i < 0x10000; ++i) {
+            expectedFromHalf[i] = Half::bitsToFloat(i);
+        }
+        std::vector<unsigned short> expectedToHalf(n);
+        for (int i = 0; i < n; ++i) {
+            expectedToHalf[i] = Half::floatToBits(floats[i]);
+        }
+        EXPECT_TRUE( isBitExact(expectedFromHalf, fromHalf) );
+        EXPECT_TRUE( isBitExact(expectedToHalf, toHalf) );
+    }
+}
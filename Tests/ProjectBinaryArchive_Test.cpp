@@ -0,0 +1,203 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include "Engine/CurveSerialization.h"
+#include "Engine/FStreamsSupport.h"
+#include "Engine/ProjectBinaryArchive.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+// Stands for the animation of a dense roto or tracker context: many curves with a keyframe per frame
+struct DenseAnimation
+{
+    std::vector<Curve> curves;
+
+    template<class Archive>
+    void save(Archive & ar,
+              const unsigned int /*version*/) const
+    {
+        int count = (int)curves.size();
+
+        ar & ::boost::serialization::make_nvp("Count", count);
+        for (std::size_t i = 0; i < curves.size(); ++i) {
+            ar & ::boost::serialization::make_nvp("item", curves[i]);
+        }
+    }
+
+    template<class Archive>
+    void load(Archive & ar,
+              const unsigned int /*version*/)
+    {
+        int count;
+
+        ar & ::boost::serialization::make_nvp("Count", count);
+        curves.resize(count);
+        for (int i = 0; i < count; ++i) {
+            ar & ::boost::serialization::make_nvp("item", curves[i]);
+        }
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+};
+
+std::string
+tempFilePath(const char* name)
+{
+    return ( QDir::tempPath() + QLatin1Char('/') + QString::fromUtf8(name) ).toStdString();
+}
+
+void
+writeFile(const std::string& filePath,
+          const ProjectBinaryArchiveWriter& writer)
+{
+    FStreamsSupport::ofstream ofile;
+
+    FStreamsSupport::open(&ofile, filePath, std::ios_base::out | std::ios_base::binary);
+    ASSERT_TRUE(ofile);
+    writer.write(ofile);
+}
+}
+
+TEST(ProjectBinaryArchive, Sections)
+{
+    std::string filePath = tempFilePath("ProjectBinaryArchive_Sections.ntp");
+    {
+        ProjectBinaryArchiveWriter writer;
+        writer.addSection( "Empty", std::string() );
+        writer.addSection( "A", std::string("first section") );
+        writer.addSection( "B", std::string("second\0section", 14) );
+        writeFile(filePath, writer);
+    }
+
+    EXPECT_TRUE( ProjectBinaryArchiveReader::isBinaryProjectFile(filePath) );
+    {
+        ProjectBinaryArchiveReader reader(filePath);
+        EXPECT_EQ( 3U, reader.getSectionNames().size() );
+        EXPECT_TRUE( reader.hasSection("A") );
+        EXPECT_FALSE( reader.hasSection("C") );
+        // sections can be read in any order
+        EXPECT_EQ( std::string("second\0section", 14), reader.readSection("B") );
+        EXPECT_EQ( std::string("first section"), reader.readSection("A") );
+        EXPECT_EQ( std::string(), reader.readSection("Empty") );
+        EXPECT_THROW( reader.readSection("C"), std::runtime_error );
+    }
+
+    // A truncated file fails when opened
+    {
+        QFile f( QString::fromUtf8( filePath.c_str() ) );
+        ASSERT_TRUE( f.open(QIODevice::ReadWrite) );
+        f.resize(f.size() - 4);
+    }
+    EXPECT_THROW( ProjectBinaryArchiveReader reader(filePath), std::runtime_error );
+    QFile::remove( QString::fromUtf8( filePath.c_str() ) );
+
+    // An xml project is not a binary project
+    {
+        FStreamsSupport::ofstream ofile;
+        FStreamsSupport::open(&ofile, filePath);
+        ofile << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\" ?>" << std::endl;
+    }
+    EXPECT_FALSE( ProjectBinaryArchiveReader::isBinaryProjectFile(filePath) );
+    EXPECT_THROW( ProjectBinaryArchiveReader reader(filePath), std::runtime_error );
+    QFile::remove( QString::fromUtf8( filePath.c_str() ) );
+}
+
+// Compares the time taken to load the same animation from an xml archive and from a section of a binary project
+TEST(ProjectBinaryArchive, LoadBenchmark)
+{
+    const int nCurves = 200;
+    const int nKeys = 500;
+    DenseAnimation animation;
+
+    animation.curves.resize(nCurves);
+    for (int i = 0; i < nCurves; ++i) {
+        for (int t = 0; t < nKeys; ++t) {
+            KeyFrame k(t, i + std::sin(t * 0.1), 0.5 * t, -0.5 * t);
+            ignore_result( animation.curves[i].addKeyFrame(k) );
+        }
+    }
+
+    std::string xml;
+    {
+        std::ostringstream ss;
+        {
+            boost::archive::xml_oarchive archive(ss);
+            archive << boost::serialization::make_nvp("Animation", animation);
+        }
+        xml = ss.str();
+    }
+
+    std::string filePath = tempFilePath("ProjectBinaryArchive_LoadBenchmark.ntp");
+    {
+        ProjectBinaryArchiveWriter writer;
+        writer.addSection( "Animation", encodeBinaryProjectSection(animation) );
+        writeFile(filePath, writer);
+    }
+
+    TimeLapse timer;
+    DenseAnimation fromXml;
+    {
+        std::istringstream ss(xml);
+        boost::archive::xml_iarchive archive(ss);
+        archive >> boost::serialization::make_nvp("Animation", fromXml);
+    }
+    double xmlSeconds = timer.getTimeElapsedReset();
+
+    DenseAnimation fromBinary;
+    {
+        ProjectBinaryArchiveReader reader(filePath);
+        decodeBinaryProjectSection(reader.readSection("Animation"), &fromBinary);
+    }
+    double binarySeconds = timer.getTimeElapsedReset();
+
+    std::cout << nCurves << " curves of " << nKeys << " keyframes loaded in " << xmlSeconds << " s from xml ("
+              << xml.size() << " bytes), " << binarySeconds << " s from binary ("
+              << QFile( QString::fromUtf8( filePath.c_str() ) ).size() << " bytes)" << std::endl;
+    QFile::remove( QString::fromUtf8( filePath.c_str() ) );
+
+    ASSERT_EQ( nCurves, (int)fromBinary.curves.size() );
+    ASSERT_EQ( nCurves, (int)fromXml.curves.size() );
+    for (int i = 0; i < nCurves; i += 17) {
+        EXPECT_EQ( nKeys, fromBinary.curves[i].getKeyFramesCount() );
+        for (double t = 0; t < nKeys; t += 3.3) {
+            EXPECT_EQ( animation.curves[i].getValueAt(t), fromBinary.curves[i].getValueAt(t) );
+            EXPECT_DOUBLE_EQ( animation.curves[i].getValueAt(t), fromXml.curves[i].getValueAt(t) );
+        }
+    }
+}
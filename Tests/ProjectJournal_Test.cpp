@@ -0,0 +1,109 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include "Engine/ProjectJournal.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+ProjectJournal::Record
+makeRecord(ProjectJournal::RecordTypeEnum type,
+           const std::string& name,
+           const std::string& data)
+{
+    ProjectJournal::Record ret;
+
+    ret.type = type;
+    ret.nodeFullName = name;
+    ret.data = data;
+
+    return ret;
+}
+}
+
+TEST(ProjectJournal, AppendAndRead)
+{
+    QString autoSaveFilePath = QDir::tempPath() + QString::fromUtf8("/ProjectJournal_Test.ntp.autosave");
+    QString filePath = ProjectJournal::getJournalFilePath(autoSaveFilePath);
+
+    EXPECT_TRUE( ProjectJournal::isJournalFile(filePath) );
+    EXPECT_FALSE( ProjectJournal::isJournalFile(autoSaveFilePath) );
+    QFile::remove(filePath);
+
+    // Each append adds to the records of the previous ones
+    std::list<ProjectJournal::Record> records;
+    records.push_back( makeRecord( ProjectJournal::eRecordTypeNodeState, "Group1.Blur1", std::string("state\0of Blur1", 14) ) );
+    records.push_back( makeRecord( ProjectJournal::eRecordTypeNodeRemoved, "Read1", std::string() ) );
+    qint64 firstSize = ProjectJournal::appendRecords(filePath, records);
+    records.clear();
+    records.push_back( makeRecord( ProjectJournal::eRecordTypeNodeState, "Read2", std::string("state of Read2") ) );
+    qint64 secondSize = ProjectJournal::appendRecords(filePath, records);
+    EXPECT_GT(secondSize, firstSize);
+
+    std::list<ProjectJournal::Record> read;
+    ProjectJournal::readRecords(filePath, &read);
+    ASSERT_EQ( 3U, read.size() );
+    std::list<ProjectJournal::Record>::const_iterator it = read.begin();
+    EXPECT_EQ(ProjectJournal::eRecordTypeNodeState, it->type);
+    EXPECT_EQ(std::string("Group1.Blur1"), it->nodeFullName);
+    EXPECT_EQ(std::string("state\0of Blur1", 14), it->data);
+    ++it;
+    EXPECT_EQ(ProjectJournal::eRecordTypeNodeRemoved, it->type);
+    EXPECT_EQ(std::string("Read1"), it->nodeFullName);
+    EXPECT_TRUE( it->data.empty() );
+    ++it;
+    EXPECT_EQ(std::string("Read2"), it->nodeFullName);
+
+    // A record cut by a crash is ignored along with what follows it
+    {
+        QFile f(filePath);
+        ASSERT_TRUE( f.open(QIODevice::ReadWrite) );
+        f.resize(f.size() - 1);
+    }
+    read.clear();
+    ProjectJournal::readRecords(filePath, &read);
+    EXPECT_EQ( 2U, read.size() );
+    QFile::remove(filePath);
+
+    // A file that is not a journal is rejected
+    {
+        QFile f(filePath);
+        ASSERT_TRUE( f.open(QIODevice::WriteOnly) );
+        f.write("<?xml version=\"1.0\"");
+    }
+    read.clear();
+    EXPECT_THROW( ProjectJournal::readRecords(filePath, &read), std::runtime_error );
+    QFile::remove(filePath);
+}
@@ -0,0 +1,210 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/RectI.h"
+#include "Engine/RenderStats.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(TilingTest, RowStrips)
+{
+    const RectI rect(-10, 5, 1910, 1085);
+    std::vector<RectI> strips = rect.splitIntoRowStrips(7);
+
+    ASSERT_EQ(7, (int)strips.size());
+    // top to bottom, full-width, no gaps nor overlaps
+    int y = rect.y2;
+    for (std::size_t i = 0; i < strips.size(); ++i) {
+        EXPECT_EQ(rect.x1, strips[i].x1);
+        EXPECT_EQ(rect.x2, strips[i].x2);
+        EXPECT_EQ(y, strips[i].y2);
+        EXPECT_GE(strips[i].height(), rect.height() / 7);
+        EXPECT_LE(strips[i].height(), rect.height() / 7 + 1);
+        y = strips[i].y1;
+    }
+    EXPECT_EQ(rect.y1, y);
+
+    // never more strips than scan-lines
+    EXPECT_EQ( 3, (int)RectI(0, 0, 100, 3).splitIntoRowStrips(16).size() );
+    EXPECT_TRUE( RectI().splitIntoRowStrips(4).empty() );
+}
+
+TEST(TilingTest, AdaptiveTileCount)
+{
+    const RectI rect(0, 0, 1920, 1080);
+    NodeTilingHistory history;
+    std::vector<RectI> tiles;
+
+    // no history: square tiles
+    EXPECT_EQ( eTilingPolicySquareTiles, history.splitIntoTiles(rect, 8, &tiles) );
+    EXPECT_EQ( rect.splitIntoSmallerRects(0).size(), tiles.size() );
+
+    // cheap node (the whole image in 1 ms): not worth splitting
+    history.addTileRenderTime( rect, 0.001 );
+    EXPECT_EQ( eTilingPolicySingleTile, history.splitIntoTiles(rect, 8, &tiles) );
+    ASSERT_EQ(1, (int)tiles.size());
+    EXPECT_TRUE(tiles[0] == rect);
+
+    // expensive node (the whole image in 1 s): at most 4 strips per thread
+    history.clear();
+    history.addTileRenderTime( RectI(0, 0, 1920, 10), 1. * 10 / 1080 );
+    EXPECT_EQ( eTilingPolicyRowStrips, history.splitIntoTiles(rect, 8, &tiles) );
+    EXPECT_EQ( 32, (int)tiles.size() );
+
+    // a single thread never splits
+    EXPECT_EQ( eTilingPolicySingleTile, history.splitIntoTiles(rect, 1, &tiles) );
+    EXPECT_EQ( 1, (int)tiles.size() );
+
+    // in between (the whole image in 11 ms): tiles of about 2 ms
+    history.clear();
+    history.addTileRenderTime( rect, 0.011 );
+    EXPECT_EQ( eTilingPolicyRowStrips, history.splitIntoTiles(rect, 8, &tiles) );
+    EXPECT_EQ( 5, (int)tiles.size() );
+}
+
+// Each render window split by the host is recorded, not only the last one
+TEST(TilingTest, NodeRenderStatsTilingInfos)
+{
+    NodeRenderStats stats;
+
+    EXPECT_TRUE( stats.getTilingInfos().empty() );
+
+    NodeTilingInfos infos;
+    infos.rect = RectI(0, 0, 1920, 540);
+    infos.policy = eTilingPolicyRowStrips;
+    infos.nbTiles = 16;
+    infos.timePerPixel = 1e-8;
+    stats.addTilingInfos(infos);
+    infos.rect = RectI(0, 540, 1920, 1080);
+    infos.policy = eTilingPolicySingleTile;
+    infos.nbTiles = 1;
+    stats.addTilingInfos(infos);
+
+    NodeRenderStats copy(stats);
+    const std::list<NodeTilingInfos>& tilingInfos = copy.getTilingInfos();
+    ASSERT_EQ( 2, (int)tilingInfos.size() );
+    EXPECT_EQ( eTilingPolicyRowStrips, tilingInfos.front().policy );
+    EXPECT_EQ( 16, tilingInfos.front().nbTiles );
+    EXPECT_TRUE( tilingInfos.back().rect == RectI(0, 540, 1920, 1080) );
+    EXPECT_EQ( eTilingPolicySingleTile, tilingInfos.back().policy );
+}
+
+TEST(TilingTest, RenderThreadsPlanner)
+{
+    RenderThreadsPlanner planner;
+
+    // all the threads go to frames up front
+    planner.startRender(8, 0, 100);
+    RenderThreadsPlan plan = planner.getPlan();
+    EXPECT_EQ(8, plan.nbFrameThreads);
+    EXPECT_EQ(1, plan.nbTileThreads);
+
+    // short frames: the split is kept
+    for (int i = 0; i < 92; ++i) {
+        EXPECT_FALSE( planner.addFrameSample(0.05, 3, 1) );
+    }
+    plan = planner.getPlan();
+    EXPECT_EQ(92, plan.nbFramesRendered);
+    EXPECT_NEAR(0.05, plan.averageFrameTime, 1e-9);
+    EXPECT_NEAR(0.75, plan.cacheHitRate, 1e-9);
+    EXPECT_EQ(0, plan.nbRebalances);
+
+    // the last frames: their threads go to tiles
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE( planner.addFrameSample(0.05, 3, 1) );
+    }
+    plan = planner.getPlan();
+    EXPECT_EQ(4, plan.nbFrameThreads);
+    EXPECT_EQ(2, plan.nbTileThreads);
+    for (int i = 0; i < 3; ++i) {
+        planner.addFrameSample(0.05, 3, 1);
+    }
+    plan = planner.getPlan();
+    EXPECT_EQ(1, plan.nbFrameThreads);
+    EXPECT_EQ(8, plan.nbTileThreads);
+    planner.stopRender();
+    EXPECT_EQ(0, planner.getPlan().nbFrameThreads);
+    EXPECT_FALSE( planner.addFrameSample(0.05, 3, 1) );
+
+    // long frames missing the cache: fewer frames with more tiles are tried, and kept if the throughput is better
+    planner.startRender(8, 0, 0);
+    for (int i = 0; i < 7; ++i) {
+        EXPECT_FALSE( planner.addFrameSample(1., 0, 10) );
+    }
+    EXPECT_TRUE( planner.addFrameSample(1., 0, 10) );
+    plan = planner.getPlan();
+    EXPECT_EQ(4, plan.nbFrameThreads);
+    EXPECT_EQ(2, plan.nbTileThreads);
+    EXPECT_EQ(1, plan.nbRebalances);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_FALSE( planner.addFrameSample(0.45, 0, 10) );
+    }
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_FALSE( planner.addFrameSample(0.45, 0, 10) );
+    }
+    EXPECT_EQ(4, planner.getPlan().nbFrameThreads);
+
+    // ... and reverted otherwise, without probing again
+    planner.startRender(8, 0, 0);
+    for (int i = 0; i < 8; ++i) {
+        planner.addFrameSample(1., 0, 10);
+    }
+    EXPECT_EQ(4, planner.getPlan().nbFrameThreads);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_FALSE( planner.addFrameSample(0.6, 0, 10) );
+    }
+    EXPECT_TRUE( planner.addFrameSample(0.6, 0, 10) );
+    plan = planner.getPlan();
+    EXPECT_EQ(8, plan.nbFrameThreads);
+    EXPECT_EQ(1, plan.nbTileThreads);
+    EXPECT_EQ(2, plan.nbRebalances);
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_FALSE( planner.addFrameSample(1., 0, 10) );
+    }
+
+    // fewer threads available when another render starts
+    EXPECT_TRUE( planner.setAvailableThreads(4) );
+    EXPECT_EQ(4, planner.getPlan().nbFrameThreads);
+    EXPECT_TRUE( planner.setAvailableThreads(8) );
+    EXPECT_EQ(8, planner.getPlan().nbFrameThreads);
+
+    // the frame threads set by the user are never rebalanced
+    planner.startRender(8, 3, 0);
+    plan = planner.getPlan();
+    EXPECT_EQ(3, plan.nbFrameThreads);
+    EXPECT_EQ(2, plan.nbTileThreads);
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_FALSE( planner.addFrameSample(1., 0, 10) );
+    }
+    EXPECT_TRUE( planner.setAvailableThreads(2) );
+    plan = planner.getPlan();
+    EXPECT_EQ(3, plan.nbFrameThreads);
+    EXPECT_EQ(1, plan.nbTileThreads);
+}
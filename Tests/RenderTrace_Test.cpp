@@ -0,0 +1,86 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include "Engine/RectI.h"
+#include "Engine/RenderTrace.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(RenderTrace, WriteEvents)
+{
+    QString filePath = QDir::tempPath() + QString::fromUtf8("/RenderTrace_Test.json");
+
+    QFile::remove(filePath);
+
+    // Nothing is recorded until the trace is started
+    {
+        RenderTrace::Scope scope("render", "render", std::string("Blur1") );
+        EXPECT_FALSE( scope.isRecording() );
+    }
+    EXPECT_TRUE( RenderTrace::stop() );
+    EXPECT_FALSE( QFile::exists(filePath) );
+
+    RenderTrace::start(filePath);
+    EXPECT_TRUE( RenderTrace::isActive() );
+    {
+        RenderTrace::Scope frameScope("frame", "renderFrame", std::string("Write1") );
+        ASSERT_TRUE( frameScope.isRecording() );
+        {
+            RenderTrace::Scope scope("render", "render", std::string("Group1.\"Blur1\"") );
+            scope.addArg( "rect", RectI(0, 0, 64, 32) );
+            scope.addArg("mipMapLevel", 1.);
+        }
+        frameScope.addArg( "status", std::string("ok") );
+    }
+    EXPECT_EQ( 2U, RenderTrace::getEventsCount() );
+    EXPECT_TRUE( RenderTrace::stop() );
+    EXPECT_FALSE( RenderTrace::isActive() );
+
+    QFile f(filePath);
+    ASSERT_TRUE( f.open(QIODevice::ReadOnly) );
+    std::string json = QString::fromUtf8( f.readAll() ).toStdString();
+    f.close();
+    QFile::remove(filePath);
+
+    EXPECT_EQ(0U, json.find("{\"traceEvents\":["));
+    EXPECT_NE( std::string::npos, json.find("\"name\":\"thread_name\"") );
+    // The inner event ends first
+    std::size_t renderPos = json.find("\"cat\":\"render\",\"name\":\"Group1.\\\"Blur1\\\" render\"");
+    std::size_t framePos = json.find("\"cat\":\"frame\",\"name\":\"Write1 renderFrame\"");
+    ASSERT_NE(std::string::npos, renderPos);
+    ASSERT_NE(std::string::npos, framePos);
+    EXPECT_LT(renderPos, framePos);
+    EXPECT_NE( std::string::npos, json.find("\"args\":{\"rect\":[0,0,64,32],\"mipMapLevel\":1}") );
+    EXPECT_NE( std::string::npos, json.find("\"args\":{\"status\":\"ok\"}") );
+}
@@ -0,0 +1,250 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QElapsedTimer>
+
+#include <cairo/cairo.h>
+
+#include "Engine/RotoRasterizer.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+/*
+ * A star-like closed shape around (cx, cy), with 8 vertices per control point as the discretization of a Bezier would give,
+ * and its feather: the shape pushed outward by featherDist along the normals.
+ */
+struct TestShape
+{
+    std::vector<Point> inner;
+    std::vector<Point> outer;
+};
+
+TestShape
+makeShape(int nControlPoints,
+          double cx,
+          double cy,
+          double radius,
+          double featherDist)
+{
+    TestShape ret;
+    int n = nControlPoints * 8;
+
+    for (int i = 0; i < n; ++i) {
+        double a = 2. * M_PI * i / n;
+        double r = radius * ( 1. + 0.1 * std::sin(a * nControlPoints) );
+        Point p;
+        p.x = cx + r * std::cos(a);
+        p.y = cy + r * std::sin(a);
+        ret.inner.push_back(p);
+    }
+    for (int i = 0; i < n; ++i) {
+        const Point& prev = ret.inner[(i + n - 1) % n];
+        const Point& next = ret.inner[(i + 1) % n];
+        double dx = next.y - prev.y;
+        double dy = prev.x - next.x;
+        double norm = std::sqrt(dx * dx + dy * dy);
+        Point p;
+        p.x = ret.inner[i].x + dx / norm * featherDist;
+        p.y = ret.inner[i].y + dy / norm * featherDist;
+        ret.outer.push_back(p);
+    }
+
+    return ret;
+}
+
+void
+rasterizeNative(const TestShape& shape,
+                const RectI& roi,
+                std::vector<float>* coverage)
+{
+    RotoRasterizer rasterizer(roi, 1.);
+    std::size_t n = shape.inner.size();
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const Point& p0 = shape.inner[i];
+        const Point& p1 = shape.inner[(i + 1) % n];
+        rasterizer.addEdge(p0.x, p0.y, p1.x, p1.y);
+        rasterizer.addFeatherTriangle(p0, 0., shape.outer[i], 1., p1, 0.);
+        rasterizer.addFeatherTriangle(p1, 0., shape.outer[i], 1., shape.outer[(i + 1) % n], 1.);
+    }
+    coverage->resize( (std::size_t)roi.width() * roi.height() );
+    rasterizer.render(&coverage->front(), roi.width(), false);
+}
+
+// Does what RotoDrawableItem::renderMaskInternal did for Beziers: rasterize with cairo in a A8 surface and convert it to floats
+void
+rasterizeCairo(const TestShape& shape,
+               const RectI& roi,
+               std::vector<float>* coverage)
+{
+    cairo_surface_t* surface = cairo_image_surface_create( CAIRO_FORMAT_A8, roi.width(), roi.height() );
+
+    cairo_surface_set_device_offset(surface, -roi.x1, -roi.y1);
+    cairo_t* cr = cairo_create(surface);
+    cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+
+    std::size_t n = shape.inner.size();
+    cairo_pattern_t* mesh = cairo_pattern_create_mesh();
+    for (std::size_t i = 0; i < n; ++i) {
+        const Point& p0 = shape.inner[i];
+        const Point& p1 = shape.outer[i];
+        const Point& p2 = shape.outer[(i + 1) % n];
+        const Point& p3 = shape.inner[(i + 1) % n];
+        cairo_mesh_pattern_begin_patch(mesh);
+        cairo_mesh_pattern_move_to(mesh, p0.x, p0.y);
+        cairo_mesh_pattern_line_to(mesh, p1.x, p1.y);
+        cairo_mesh_pattern_line_to(mesh, p2.x, p2.y);
+        cairo_mesh_pattern_line_to(mesh, p3.x, p3.y);
+        cairo_mesh_pattern_line_to(mesh, p0.x, p0.y);
+        cairo_mesh_pattern_set_corner_color_rgba(mesh, 0, 1., 1., 1., 1.);
+        cairo_mesh_pattern_set_corner_color_rgba(mesh, 1, 1., 1., 1., 0.);
+        cairo_mesh_pattern_set_corner_color_rgba(mesh, 2, 1., 1., 1., 0.);
+        cairo_mesh_pattern_set_corner_color_rgba(mesh, 3, 1., 1., 1., 1.);
+        cairo_mesh_pattern_end_patch(mesh);
+    }
+    cairo_set_source(cr, mesh);
+    cairo_paint(cr);
+    cairo_pattern_destroy(mesh);
+
+    cairo_set_source_rgba(cr, 1., 1., 1., 1.);
+    cairo_move_to(cr, shape.inner[0].x, shape.inner[0].y);
+    for (std::size_t i = 1; i < n; ++i) {
+        cairo_line_to(cr, shape.inner[i].x, shape.inner[i].y);
+    }
+    cairo_close_path(cr);
+    cairo_fill(cr);
+    cairo_surface_flush(surface);
+
+    coverage->resize( (std::size_t)roi.width() * roi.height() );
+    const unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    for (int y = 0; y < roi.height(); ++y) {
+        for (int x = 0; x < roi.width(); ++x) {
+            (*coverage)[y * roi.width() + x] = data[y * stride + x] / 255.f;
+        }
+    }
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+}
+}
+
+TEST(RotoRasterizer, AnalyticCoverage)
+{
+    // A square from (1.25, 1.5) to (3.75, 3) covers a quarter, half or 3 quarters of its border pixels
+    RectI roi(0, 0, 5, 5);
+    RotoRasterizer rasterizer(roi, 1.);
+
+    rasterizer.addEdge(1.25, 1.5, 3.75, 1.5);
+    rasterizer.addEdge(3.75, 1.5, 3.75, 3.);
+    rasterizer.addEdge(3.75, 3., 1.25, 3.);
+    rasterizer.addEdge(1.25, 3., 1.25, 1.5);
+    std::vector<float> coverage(25);
+    rasterizer.render(&coverage.front(), 5, false);
+
+    EXPECT_NEAR(0., coverage[0], 1e-6);
+    EXPECT_NEAR(0.75 * 0.5, coverage[1 * 5 + 1], 1e-6);
+    EXPECT_NEAR(0.5, coverage[1 * 5 + 2], 1e-6);
+    EXPECT_NEAR(0.75 * 0.5, coverage[1 * 5 + 3], 1e-6);
+    EXPECT_NEAR(0.75, coverage[2 * 5 + 1], 1e-6);
+    EXPECT_NEAR(1., coverage[2 * 5 + 2], 1e-6);
+    EXPECT_NEAR(0.75, coverage[2 * 5 + 3], 1e-6);
+    EXPECT_NEAR(0., coverage[3 * 5 + 2], 1e-6);
+
+    // Compositing over itself gives 1 - (1 - c)^2
+    rasterizer.render(&coverage.front(), 5, true);
+    EXPECT_NEAR(1. - 0.5 * 0.5, coverage[1 * 5 + 2], 1e-6);
+}
+
+TEST(RotoRasterizer, TilesMatchFullImage)
+{
+    // The shape overflows the full image on the left and the top
+    TestShape shape = makeShape(20, 20., 30., 40., 10.);
+    RectI full(0, 0, 96, 96);
+    std::vector<float> fullCoverage;
+
+    rasterizeNative(shape, full, &fullCoverage);
+
+    // The feather falls off linearly
+    EXPECT_NEAR(1., fullCoverage[30 * 96 + 20], 1e-6);
+    EXPECT_EQ(0., fullCoverage[95 * 96 + 95]);
+
+    for (int ty = 0; ty < 96; ty += 32) {
+        for (int tx = 0; tx < 96; tx += 32) {
+            RectI tile(tx, ty, tx + 32, ty + 32);
+            std::vector<float> tileCoverage;
+            rasterizeNative(shape, tile, &tileCoverage);
+            for (int y = 0; y < 32; ++y) {
+                for (int x = 0; x < 32; ++x) {
+                    ASSERT_NEAR(fullCoverage[(ty + y) * 96 + tx + x], tileCoverage[y * 32 + x], 1e-4);
+                }
+            }
+        }
+    }
+}
+
+TEST(RotoRasterizer, BenchmarkAgainstCairo)
+{
+    RectI roi(0, 0, 1024, 1024);
+    const int nControlPoints[] = {10, 50, 100, 500};
+    const int iterations = 5;
+
+    for (int i = 0; i < 4; ++i) {
+        TestShape shape = makeShape(nControlPoints[i], 512., 512., 380., 40.);
+        std::vector<float> nativeCoverage, cairoCoverage;
+        QElapsedTimer timer;
+
+        timer.start();
+        for (int j = 0; j < iterations; ++j) {
+            rasterizeNative(shape, roi, &nativeCoverage);
+        }
+        qint64 nativeMs = timer.elapsed();
+
+        timer.restart();
+        for (int j = 0; j < iterations; ++j) {
+            rasterizeCairo(shape, roi, &cairoCoverage);
+        }
+        qint64 cairoMs = timer.elapsed();
+
+        // Both differ only by the antialiasing of the edges and the interpolation of the feather
+        double diff = 0.;
+        for (std::size_t p = 0; p < nativeCoverage.size(); ++p) {
+            diff += std::abs(nativeCoverage[p] - cairoCoverage[p]);
+        }
+        diff /= nativeCoverage.size();
+        EXPECT_LT(diff, 0.01);
+
+        std::cout << nControlPoints[i] << " control points: native " << (double)nativeMs / iterations << " ms, cairo "
+                  << (double)cairoMs / iterations << " ms, mean difference " << diff << std::endl;
+    }
+}
@@ -0,0 +1,102 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include "Engine/Bezier.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/RotoContext.h"
+#include "Engine/RotoContextPrivate.h"
+
+#include "BaseTest.h"
+
+NATRON_NAMESPACE_USING;
+
+static RotoShapeGeometryConstPtr
+getGeometry(const boost::shared_ptr<Bezier>& bezier,
+            double time,
+            bool withInternalTriangles = false)
+{
+    return RotoContextPrivate::getShapeGeometry(bezier.get(), time, 0, withInternalTriangles);
+}
+
+TEST_F(BaseTest, RotoShapeGeometryCache)
+{
+    NodePtr roto = createNode( QString::fromUtf8(PLUGINID_NATRON_ROTO) );
+
+    ASSERT_TRUE(roto);
+    boost::shared_ptr<RotoContext> context = roto->getRotoContext();
+    ASSERT_TRUE(context);
+    boost::shared_ptr<Bezier> bezier = context->makeEllipse(100., 100., 50., true, 1.);
+    ASSERT_TRUE(bezier);
+
+    std::size_t nbEntriesBefore, nbEntries, verticesCount;
+    RotoContextPrivate::getShapeGeometryCacheInfos(&nbEntriesBefore, &verticesCount);
+
+    // An unchanged shape at the same time and mipmap level is tessellated once
+    RotoShapeGeometryConstPtr geometry = getGeometry(bezier, 1.);
+    ASSERT_TRUE(geometry);
+    EXPECT_FALSE( geometry->bezierPolygon.empty() );
+    EXPECT_FALSE(geometry->hasInternalTriangles);
+    EXPECT_EQ( geometry, getGeometry(bezier, 1.) );
+
+    // The triangles of the inside are computed once requested, and the renders which do not need them reuse them
+    RotoShapeGeometryConstPtr withTriangles = getGeometry(bezier, 1., true);
+    EXPECT_NE(geometry, withTriangles);
+    EXPECT_TRUE(withTriangles->hasInternalTriangles);
+    EXPECT_EQ( withTriangles, getGeometry(bezier, 1.) );
+
+    // Another time is another tessellation, which does not replace the first one
+    RotoShapeGeometryConstPtr otherTime = getGeometry(bezier, 2.);
+    EXPECT_NE(withTriangles, otherTime);
+    EXPECT_EQ( otherTime, getGeometry(bezier, 2.) );
+    EXPECT_EQ( withTriangles, getGeometry(bezier, 1.) );
+
+    // Moving a control point
+    bezier->movePointByIndex(0, 1., 10., 0.);
+    RotoShapeGeometryConstPtr moved = getGeometry(bezier, 1.);
+    EXPECT_NE(withTriangles, moved);
+    EXPECT_EQ( moved, getGeometry(bezier, 1.) );
+
+    // Changing the feather
+    boost::shared_ptr<KnobDouble> feather = bezier->getFeatherKnob();
+    feather->setValueAtTime(1., feather->getValueAtTime(1.) + 10., ViewSpec::all(), 0);
+    RotoShapeGeometryConstPtr feathered = getGeometry(bezier, 1.);
+    EXPECT_NE(moved, feathered);
+    EXPECT_EQ( feathered, getGeometry(bezier, 1.) );
+
+    // A changed shape replaces its entry rather than adding one
+    RotoContextPrivate::getShapeGeometryCacheInfos(&nbEntries, &verticesCount);
+    EXPECT_EQ(nbEntriesBefore + 2, nbEntries);
+
+    // Removing the shape evicts all its entries
+    RotoContextPrivate::removeShapeGeometries( bezier.get() );
+    RotoContextPrivate::getShapeGeometryCacheInfos(&nbEntries, &verticesCount);
+    EXPECT_EQ(nbEntriesBefore, nbEntries);
+    EXPECT_NE( feathered, getGeometry(bezier, 1.) );
+}
@@ -0,0 +1,228 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QElapsedTimer>
+
+#include "Engine/RotoStrokeRasterizer.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+typedef std::list<std::pair<Point, double> > Polyline;
+typedef std::list<Polyline> Polylines;
+
+// A spiral of radius 150 around (cx, cy) with a varying pressure
+Polyline
+makeSpiral(int nPoints,
+           double cx,
+           double cy)
+{
+    Polyline ret;
+
+    for (int i = 0; i < nPoints; ++i) {
+        double a = 7. * i / nPoints;
+        double r = 10. + 2. * a * 10.;
+        Point p;
+        p.x = cx + r * std::cos(a);
+        p.y = cy + r * std::sin(a);
+        ret.push_back( std::make_pair( p, 0.5 + 0.5 * std::sin(a * 3.) ) );
+    }
+
+    return ret;
+}
+
+RotoStrokeRasterizer::BrushParams
+makeBrush(bool buildUp)
+{
+    RotoStrokeRasterizer::BrushParams params;
+
+    params.brushSizePixel = 25.;
+    params.brushHardness = 0.2;
+    params.brushSpacing = 0.1;
+    params.opacity = 0.8;
+    params.pressureAffectsOpacity = true;
+    params.pressureAffectsSize = true;
+    params.buildUp = buildUp;
+
+    return params;
+}
+
+// Stamps the polyline in pieces of piecePoints points, each continuing from the last point of the previous one
+void
+stampInPieces(const Polyline& polyline,
+              int piecePoints,
+              RotoStrokeRasterizer& rasterizer,
+              RotoStrokeCanvas* canvas)
+{
+    double distToNext = 0.;
+    bool hasLastPoint = false;
+    std::pair<Point, double> lastPoint;
+    Polyline::const_iterator it = polyline.begin();
+
+    while ( it != polyline.end() ) {
+        Polylines piece(1);
+        if (hasLastPoint) {
+            piece.back().push_back(lastPoint);
+        }
+        for (int i = 0; i < piecePoints && it != polyline.end(); ++i, ++it) {
+            piece.back().push_back(*it);
+        }
+        lastPoint = piece.back().back();
+        hasLastPoint = true;
+        canvas->ensureBounds( rasterizer.getStrokesBounds(piece) );
+        distToNext = rasterizer.stampStrokes( piece, distToNext, canvas->getPixels(), canvas->getBounds(), canvas->getRowStride() );
+    }
+}
+}
+
+TEST(RotoStrokeRasterizer, HardDab)
+{
+    RotoStrokeRasterizer::BrushParams params;
+
+    params.brushSizePixel = 10.;
+    params.brushHardness = 1.;
+    params.opacity = 0.5;
+    RotoStrokeRasterizer rasterizer(params);
+
+    RectI bounds(0, 0, 20, 20);
+    std::vector<float> coverage(20 * 20, 0.f);
+    Point center = {10., 10.};
+    rasterizer.stampDab(center, 1., &coverage.front(), bounds, 20);
+
+    // A hard brush covers the pixels whose center is inside the dab with its opacity
+    for (int y = 0; y < 20; ++y) {
+        for (int x = 0; x < 20; ++x) {
+            double dx = x + 0.5 - center.x;
+            double dy = y + 0.5 - center.y;
+            double d = std::sqrt(dx * dx + dy * dy);
+            if (d < 4.9) {
+                EXPECT_EQ(0.5f, coverage[y * 20 + x]);
+            } else if (d > 5.1) {
+                EXPECT_EQ(0.f, coverage[y * 20 + x]);
+            }
+        }
+    }
+
+    // Building up composites the dab over itself, otherwise the maximum is kept
+    params.buildUp = true;
+    RotoStrokeRasterizer buildUpRasterizer(params);
+    buildUpRasterizer.stampDab(center, 1., &coverage.front(), bounds, 20);
+    EXPECT_FLOAT_EQ(0.75f, coverage[10 * 20 + 10]);
+    rasterizer.stampDab(center, 1., &coverage.front(), bounds, 20);
+    EXPECT_FLOAT_EQ(0.75f, coverage[10 * 20 + 10]);
+}
+
+TEST(RotoStrokeRasterizer, IncrementalMatchesWholeStroke)
+{
+    Polyline spiral = makeSpiral(500, 200., 200.);
+
+    for (int b = 0; b < 2; ++b) {
+        RotoStrokeRasterizer::BrushParams params = makeBrush(b == 1);
+
+        // The whole stroke at once in a buffer which is larger than needed
+        RotoStrokeRasterizer wholeRasterizer(params);
+        Polylines strokes(1, spiral);
+        RectI bounds(0, 0, 400, 400);
+        std::vector<float> whole( (std::size_t)bounds.width() * bounds.height(), 0.f );
+        wholeRasterizer.stampStrokes(strokes, 0., &whole.front(), bounds, bounds.width());
+
+        // The same stroke a few points at a time in a canvas which grows with it
+        RotoStrokeRasterizer incrementalRasterizer(params);
+        RotoStrokeCanvas canvas;
+        stampInPieces(spiral, 7, incrementalRasterizer, &canvas);
+        std::vector<float> incremental( whole.size() );
+        canvas.copyTo(bounds, &incremental.front(), bounds.width());
+
+        for (std::size_t i = 0; i < whole.size(); ++i) {
+            ASSERT_EQ(whole[i], incremental[i]);
+        }
+    }
+}
+
+TEST(RotoStrokeRasterizer, CanvasGrowth)
+{
+    RotoStrokeCanvas canvas;
+
+    canvas.ensureBounds( RectI(10, 10, 20, 20) );
+    canvas.getPixels()[0] = 1.f;
+    EXPECT_TRUE( canvas.getBounds().contains( RectI(10, 10, 20, 20) ) );
+
+    // Growing keeps the pixels and leaves a margin on the sides that grew
+    canvas.ensureBounds( RectI(15, 15, 40, 40) );
+    const RectI& bounds = canvas.getBounds();
+    EXPECT_EQ(10, bounds.x1);
+    EXPECT_EQ(10, bounds.y1);
+    EXPECT_GT(bounds.x2, 40);
+    EXPECT_GT(bounds.y2, 40);
+
+    float pixels[4];
+    canvas.copyTo(RectI(9, 10, 11, 11), pixels, 2);
+    EXPECT_EQ(0.f, pixels[0]);
+    EXPECT_EQ(1.f, pixels[1]);
+}
+
+TEST(RotoStrokeRasterizer, BenchmarkIncremental)
+{
+    // A render while painting stamps the new points only, instead of the whole stroke so far
+    Polyline spiral = makeSpiral(2000, 512., 512.);
+    RotoStrokeRasterizer::BrushParams params = makeBrush(true);
+    const int piecePoints = 10;
+    QElapsedTimer timer;
+
+    timer.start();
+    {
+        RotoStrokeRasterizer rasterizer(params);
+        RotoStrokeCanvas canvas;
+        stampInPieces(spiral, piecePoints, rasterizer, &canvas);
+    }
+    qint64 incrementalMs = timer.elapsed();
+
+    timer.restart();
+    RectI bounds(0, 0, 1024, 1024);
+    std::vector<float> coverage( (std::size_t)bounds.width() * bounds.height() );
+    Polylines strokes(1);
+    Polyline::const_iterator it = spiral.begin();
+    while ( it != spiral.end() ) {
+        for (int i = 0; i < piecePoints && it != spiral.end(); ++i, ++it) {
+            strokes.back().push_back(*it);
+        }
+        RotoStrokeRasterizer rasterizer(params);
+        std::fill(coverage.begin(), coverage.end(), 0.f);
+        rasterizer.stampStrokes(strokes, 0., &coverage.front(), bounds, bounds.width());
+    }
+    qint64 wholeMs = timer.elapsed();
+
+    std::cout << spiral.size() << " points by " << piecePoints << ": incremental " << incrementalMs << " ms, whole stroke each time "
+              << wholeMs << " ms" << std::endl;
+}
@@ -25,7 +25,7 @@ CONFIG += static-gui static-engine static-host-support static-breakpadclient sta
 QT += gui core opengl network
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
-CONFIG += openmvg-flags glad-flags
+CONFIG += libmv-flags openmvg-flags glad-flags
 
 !noexpat: CONFIG += expat
 
@@ -44,11 +44,21 @@ SOURCES += \
     google-test/src/gtest_main.cc \
     google-mock/src/gmock-all.cc \
     BaseTest.cpp \
+    Cache_Test.cpp \
+    Expression_Test.cpp \
     Hash64_Test.cpp \
     Image_Test.cpp \
     Lut_Test.cpp \
+    ProjectBinaryArchive_Test.cpp \
+    ProjectJournal_Test.cpp \
+    RenderStats_Test.cpp \
+    RenderTrace_Test.cpp \
+    RotoRasterizer_Test.cpp \
+    RotoShapeGeometry_Test.cpp \
+    RotoStrokeRasterizer_Test.cpp \
     KnobFile_Test.cpp \
     Curve_Test.cpp \
+    ThreadPool_Test.cpp \
     Tracker_Test.cpp
 
 HEADERS += \
@@ -0,0 +1,200 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <stdexcept>
+#include <vector>
+
+#include <boost/bind.hpp>
+
+#include <QtCore/QAtomicInt>
+
+#include <gtest/gtest.h>
+
+#include "Engine/ThreadPool.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+struct TileCounter
+{
+    QAtomicInt nTiles;
+
+    TileCounter()
+        : nTiles()
+    {
+    }
+};
+
+void
+renderTile(TileCounter* counter)
+{
+    counter->nTiles.fetchAndAddRelaxed(1);
+}
+
+void
+throwingTile()
+{
+    throw std::runtime_error("tile failed");
+}
+
+// Blocks the thread until release is set
+void
+blockingTile(QAtomicInt* started,
+             QAtomicInt* release)
+{
+    started->fetchAndStoreRelaxed(1);
+    while ( (int)*release == 0 ) {
+    }
+}
+
+// A tile which renders its "input" with tiles too, as nested renderRoI calls do
+void
+renderNestedTile(RenderThreadPool* pool,
+                 TileCounter* counter,
+                 int depth)
+{
+    RenderThreadPool::TaskGroup inputTiles;
+
+    for (int i = 0; i < 8; ++i) {
+        if (depth > 0) {
+            pool->startTask( &inputTiles, boost::bind(&renderNestedTile, pool, counter, depth - 1) );
+        } else {
+            pool->startTask( &inputTiles, boost::bind(&renderTile, counter) );
+        }
+    }
+    EXPECT_TRUE( pool->waitForGroup(&inputTiles) );
+    counter->nTiles.fetchAndAddRelaxed(1);
+}
+}
+
+TEST(RenderThreadPoolTest, AllTasksRun)
+{
+    RenderThreadPool pool;
+
+    pool.setMaxThreadCount(4);
+    EXPECT_EQ( 4, pool.getMaxThreadCount() );
+    EXPECT_FALSE( pool.isPoolThread() );
+
+    TileCounter counter;
+    {
+        RenderThreadPool::TaskGroup tiles;
+        for (int i = 0; i < 1000; ++i) {
+            pool.startTask( &tiles, boost::bind(&renderTile, &counter) );
+        }
+        EXPECT_TRUE( pool.waitForGroup(&tiles) );
+    }
+    EXPECT_EQ( 1000, (int)counter.nTiles );
+
+    // an empty group does not wait
+    RenderThreadPool::TaskGroup empty;
+    EXPECT_TRUE( pool.waitForGroup(&empty) );
+}
+
+// Nested groups are rendered by the waiting threads themselves: with a single thread in the pool,
+// 3 levels of nested tiles must not dead-lock
+TEST(RenderThreadPoolTest, NestedGroups)
+{
+    for (int nThreads = 1; nThreads <= 4; nThreads *= 2) {
+        RenderThreadPool pool;
+        pool.setMaxThreadCount(nThreads);
+
+        TileCounter counter;
+        RenderThreadPool::TaskGroup tiles;
+        for (int i = 0; i < 8; ++i) {
+            pool.startTask( &tiles, boost::bind(&renderNestedTile, &pool, &counter, 2) );
+        }
+        EXPECT_TRUE( pool.waitForGroup(&tiles) );
+        // 8 + 8^2 + 8^3 nested tiles and 8^4 leaf tiles
+        EXPECT_EQ( 8 + 64 + 512 + 4096, (int)counter.nTiles );
+    }
+}
+
+// A task which throws fails its group, but not the other tasks of the group
+TEST(RenderThreadPoolTest, FailedTask)
+{
+    RenderThreadPool pool;
+    pool.setMaxThreadCount(4);
+
+    TileCounter counter;
+    {
+        RenderThreadPool::TaskGroup tiles;
+        for (int i = 0; i < 100; ++i) {
+            pool.startTask( &tiles, boost::bind(&renderTile, &counter) );
+        }
+        pool.startTask( &tiles, boost::bind(&throwingTile) );
+        EXPECT_FALSE( pool.waitForGroup(&tiles) );
+    }
+    EXPECT_EQ( 100, (int)counter.nTiles );
+
+    RenderThreadPool::TaskGroup tiles;
+    pool.startTask( &tiles, boost::bind(&renderTile, &counter) );
+    EXPECT_TRUE( pool.waitForGroup(&tiles) );
+}
+
+// A waiting thread only runs the tasks of its own group, never the ones of other groups
+TEST(RenderThreadPoolTest, WaiterOnlyRunsItsGroup)
+{
+    RenderThreadPool pool;
+    pool.setMaxThreadCount(1);
+
+    TileCounter counter, othersCounter;
+    QAtomicInt started, release;
+    RenderThreadPool::TaskGroup blocking;
+    pool.startTask( &blocking, boost::bind(&blockingTile, &started, &release) );
+    // Wait for the only thread of the pool to take the blocking task
+    while ( (int)started == 0 ) {
+    }
+    RenderThreadPool::TaskGroup others, tiles;
+    pool.startTask( &others, boost::bind(&renderTile, &othersCounter) );
+    for (int i = 0; i < 10; ++i) {
+        pool.startTask( &tiles, boost::bind(&renderTile, &counter) );
+    }
+    // The pool thread is stuck: the tiles are all run by this thread, which leaves the task of the other group
+    EXPECT_TRUE( pool.waitForGroup(&tiles) );
+    EXPECT_EQ( 10, (int)counter.nTiles );
+    EXPECT_EQ( 0, (int)othersCounter.nTiles );
+
+    release.fetchAndStoreRelaxed(1);
+    EXPECT_TRUE( pool.waitForGroup(&others) );
+    EXPECT_TRUE( pool.waitForGroup(&blocking) );
+    EXPECT_EQ( 1, (int)othersCounter.nTiles );
+}
+
+// Threads are stopped by quit(), after having run the scheduled tasks
+TEST(RenderThreadPoolTest, Quit)
+{
+    TileCounter counter;
+    RenderThreadPool::TaskGroup tiles;
+    RenderThreadPool pool;
+    pool.setMaxThreadCount(2);
+
+    // quit() while the tasks are still scheduled: they must all run before the threads exit
+    for (int i = 0; i < 1000; ++i) {
+        pool.startTask( &tiles, boost::bind(&renderTile, &counter) );
+    }
+    pool.quit();
+    EXPECT_EQ( 1000, (int)counter.nTiles );
+}
@@ -24,20 +24,33 @@
 
 #include "Global/Macros.h"
 
+#include <list>
+#include <set>
 #include <vector>
 #include <cmath>
 #include <cstdlib>
 
 #include <gtest/gtest.h>
 
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <openMVG/robust_estimation/robust_estimator_Prosac.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include "Engine/EngineFwd.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/TrackMarker.h"
+#include "Engine/TrackerContext.h"
+#include "Engine/TrackerFrameAccessor.h"
 #include "Engine/Transform.h"
 #include "Global/GlobalDefines.h"
 
+#include "BaseTest.h"
+
 NATRON_NAMESPACE_USING;
 
 using namespace openMVG::robust;
@@ -464,3 +477,73 @@ TEST(ModelSearch, HomographyNPoints)
     }
     testHomography(x1);
 }
+
+// Waits until all the markers have a keyframe at lastTrackedFrame and the tracker thread is idle again
+static bool
+waitForTracking(const boost::shared_ptr<TrackerContext>& context,
+                const std::list<TrackMarkerPtr>& markers,
+                int lastTrackedFrame)
+{
+    QMutex mutex;
+    QWaitCondition timer;
+    QMutexLocker k(&mutex);
+
+    for (int i = 0; i < 6000; ++i) {
+        bool reachedEnd = true;
+        for (std::list<TrackMarkerPtr>::const_iterator it = markers.begin(); it != markers.end(); ++it) {
+            std::set<double> keys;
+            (*it)->getCenterKeyframes(&keys);
+            if ( keys.find(lastTrackedFrame) == keys.end() ) {
+                reachedEnd = false;
+                break;
+            }
+        }
+        if ( reachedEnd && !context->isCurrentlyTracking() ) {
+            return true;
+        }
+        timer.wait(&mutex, 10);
+    }
+
+    return false;
+}
+
+TEST_F(BaseTest, TrackerPrefetchesEachFrameOnce)
+{
+    NodePtr generator = createNode(_generatorPluginID);
+    NodePtr tracker = createNode( QString::fromUtf8(PLUGINID_NATRON_TRACKER) );
+
+    ASSERT_TRUE(generator && tracker);
+
+    // A still noise, so that the markers find their pattern at the same place on every frame
+    KnobDouble* slope = dynamic_cast<KnobDouble*>( generator->getKnobByName("noiseZSlope").get() );
+    ASSERT_TRUE(slope);
+    slope->setValue(0.);
+    connectNodes(generator, tracker, 0, true);
+
+    boost::shared_ptr<TrackerContext> context = tracker->getTrackerContext();
+    ASSERT_TRUE(context);
+
+    std::list<TrackMarkerPtr> markers;
+    for (int i = 0; i < 3; ++i) {
+        TrackMarkerPtr marker = context->createMarker();
+        boost::shared_ptr<KnobDouble> center = marker->getCenterKnob();
+        center->setValue(center->getValue(0) + (i - 1) * 100., ViewSpec::current(), 0);
+        markers.push_back(marker);
+    }
+
+    const int start = 1;
+    const int end = 5;
+    TrackerFrameAccessor::resetFetchInfos();
+    context->trackMarkers(markers, start, end, 1, 0);
+    ASSERT_TRUE( waitForTracking(context, markers, end - 1) );
+
+    U64 nbFramesPrefetched, nbFramesReleased, nbRegionsRendered;
+    TrackerFrameAccessor::getFetchInfos(&nbFramesPrefetched, &nbFramesReleased, &nbRegionsRendered);
+
+    // The reference frame (the start keyframe) and each tracked frame are rendered once for all the markers...
+    EXPECT_EQ( (U64)(end - start), nbFramesPrefetched );
+    // ...libmv gets its regions out of these images...
+    EXPECT_EQ( (U64)0, nbRegionsRendered );
+    // ...and they are all released once the track is done
+    EXPECT_EQ(nbFramesPrefetched, nbFramesReleased);
+}